@@ -25,6 +25,7 @@ typedef struct IOTHUB_CLIENT_INSTANCE_TAG* IOTHUB_CLIENT_HANDLE;
 #include <stdint.h>
 
 #include "iothub_client_ll.h"
+#include "iothub_client_worker_pool.h"
 #include "azure_c_shared_utility/umock_c_prod.h"
 
 #ifdef __cplusplus
@@ -116,6 +117,24 @@ extern "C"
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SendEventAsync, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Same as ::IoTHubClient_SendEventAsync, except that the message is not cloned:
+    * 			on success the IoT Hub client takes ownership of @p eventMessageHandle and
+    * 			destroys it once the message is completed.
+    *
+    * @param	iotHubClientHandle		   	The handle created by a call to the create function.
+    * @param	eventMessageHandle		   	The handle to an IoT Hub message. The caller must not use
+    * 										or destroy it after this function returns IOTHUB_CLIENT_OK.
+    * 										On failure, the caller still owns it.
+    * @param	eventConfirmationCallback  	The callback specified by the device for receiving
+    * 										confirmation of the delivery of the IoT Hub message.
+    * @param	userContextCallback			User specified context that will be provided to the
+    * 										callback. This can be @c NULL.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SendEventAsync_TakeOwnership, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
+
     /**
     * @brief	This function returns the current sending status for IoTHubClient.
     *
@@ -247,10 +266,65 @@ extern "C"
     *				- @b messageTimeout - the maximum time in milliseconds until a message
     *                 is timeouted. The time starts at IoTHubClient_SendEventAsync. By default,
     *                 messages do not expire. @p is a pointer to a uint64_t
+    *				- @b do_work_freq_ms - the maximum time in milliseconds an idle worker
+    *                 thread waits between calls to IoTHubClient_LL_DoWork, that is how long
+    *                 incoming messages and connection handshake steps can wait to be
+    *                 picked up. While messages are being sent the thread runs every 1 ms.
+    *                 Between 1 and 100, 1 by default.
+    *                 @p value is a pointer to a tickcounter_ms_t.
+    *				- @b message_pool_size - the number of per message records preallocated by
+    *                 the client, and by the MQTT transport, instead of calling malloc for
+    *                 every message. 0 (the default) disables the pool. @p value is a pointer
+    *                 to a size_t.
     * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SetOption, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, const char*, optionName, const void*, value);
 
+    /**
+    * @brief	This function returns in the out parameter @p statistics the usage of the
+    * 			message pool configured with the @b message_pool_size option.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	statistics			Out parameter receiving the statistics of the pool.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success, IOTHUB_CLIENT_ERROR if no pool is configured
+    * 			or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_GetMessagePoolStatistics, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS*, statistics);
+
+    /**
+    * @brief	This function returns in the out parameter @p status the number of messages,
+    * 			and their total payload size, accepted by IoTHubClient_SendEventAsync whose
+    * 			confirmation callback has not been called yet. The limits of this queue are
+    * 			set with the @b send_queue_max_messages and @b send_queue_max_bytes options.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	status				Out parameter receiving the current depth of the send queue.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_GetSendQueueStatus, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_SEND_QUEUE_STATUS*, status);
+
+    /**
+    * @brief	This API sets a callback receiving in one call the confirmations of a batch
+    * 			of events sent with IoTHubClient_SendEventAsync without a confirmation
+    * 			callback, instead of one queued callback per event.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	batchCallback		The callback, or NULL to go back to no confirmation
+    * 								for events sent without a callback.
+    * @param	userContextCallback	User specified context that will be provided to the
+    * 								callback. This can be @c NULL.
+    *
+    *			@b NOTE: The callback is invoked by the thread dispatching user callbacks, and
+    *			the confirmations array is only valid for the duration of the call. While a
+    *			batch callback is set, the context given to IoTHubClient_SendEventAsync with
+    *			a NULL callback is the one reported for the event.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SetEventConfirmationBatchCallback, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK, batchCallback, void*, userContextCallback);
+
     /**
     * @brief	This API specifies a call back to be used when the device receives a state update.
     *
@@ -341,6 +415,22 @@ extern "C"
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_UploadToBlobAsync, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, const char*, destinationFileName, const unsigned char*, source, size_t, size, IOTHUB_CLIENT_FILE_UPLOAD_CALLBACK, iotHubClientFileUploadCallback, void*, context);
 #endif
+
+    /**
+    * @brief	Makes the client be serviced by the threads of @p workerPool instead of
+    *			a dedicated worker thread.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to IoTHubClient_Create or
+    *								IoTHubClient_CreateFromConnectionString.
+    * @param	workerPool			The handle created by a call to IoTHubClient_WorkerPool_Create.
+    *								The pool must outlive the client.
+    *
+    *			Must be called before any API that starts the worker thread. Clients created
+    *			with IoTHubClient_CreateWithTransport use IoTHubTransport_SetWorkerPool instead.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SetWorkerPool, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool);
 #ifdef __cplusplus
 }
 #endif
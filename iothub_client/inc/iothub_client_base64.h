@@ -0,0 +1,45 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_base64.h
+*	@brief	 Base64 encoding and decoding into caller provided buffers.
+*
+*	@details The codec never allocates: the caller sizes the destination with
+*			 IoTHubClient_Base64_GetEncodedLength or IoTHubClient_Base64_GetDecodedMaxLength.
+*			 Encoding always produces the padded form. Decoding accepts the last group with
+*			 or without its padding, but rejects characters that are not part of the alphabet
+*			 and a last group whose unused bits are not zero.
+*			 Where the compiler targets SSSE3 (x86/x64) or NEON (AArch64) the encoder
+*			 processes 12 or 48 bytes at a time with vector instructions, otherwise it
+*			 falls back to portable C.
+*/
+
+#ifndef IOTHUB_CLIENT_BASE64_H
+#define IOTHUB_CLIENT_BASE64_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BASE64_ALPHABET_VALUES \
+    BASE64_ALPHABET_STANDARD, \
+    BASE64_ALPHABET_URL
+
+/*BASE64_ALPHABET_STANDARD uses '+' and '/' for 62 and 63, BASE64_ALPHABET_URL uses '-' and '_' (RFC 4648, section 5)*/
+DEFINE_ENUM(BASE64_ALPHABET, BASE64_ALPHABET_VALUES);
+
+    MOCKABLE_FUNCTION(, size_t, IoTHubClient_Base64_GetEncodedLength, size_t, size);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_Base64_Encode, char*, destination, const unsigned char*, source, size_t, size, BASE64_ALPHABET, alphabet);
+    MOCKABLE_FUNCTION(, size_t, IoTHubClient_Base64_GetDecodedMaxLength, size_t, length);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_Base64_Decode, unsigned char*, destination, const char*, source, size_t, length, BASE64_ALPHABET, alphabet, size_t*, decodedSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_BASE64_H */
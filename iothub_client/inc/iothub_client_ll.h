@@ -31,7 +31,8 @@
     IOTHUB_CLIENT_INVALID_ARG,            \
     IOTHUB_CLIENT_ERROR,                  \
     IOTHUB_CLIENT_INVALID_SIZE,           \
-    IOTHUB_CLIENT_INDEFINITE_TIME
+    IOTHUB_CLIENT_INDEFINITE_TIME,        \
+    IOTHUB_CLIENT_QUEUE_FULL
 
 /** @brief Enumeration specifying the status of calls to various APIs in this module.
 */
@@ -96,6 +97,36 @@ DEFINE_ENUM(IOTHUB_PROCESS_ITEM_RESULT, IOTHUB_PROCESS_ITEM_RESULT_VALUE);
 */
 DEFINE_ENUM(IOTHUB_CLIENT_IOTHUB_METHOD_STATUS, IOTHUB_CLIENT_IOTHUB_METHOD_STATUS_VALUES);
 
+/** @brief Usage of the message pool configured with the "message_pool_size" option,
+*		   returned by ::IoTHubClient_LL_GetMessagePoolStatistics.
+*/
+typedef struct IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS_TAG
+{
+    size_t capacity; /*number of records preallocated by the pool*/
+    size_t inUse; /*number of preallocated records currently used by queued messages*/
+    size_t hits; /*number of messages queued using a preallocated record*/
+    size_t misses; /*number of messages queued with a malloc'd record because the pool was exhausted*/
+} IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS;
+
+#define IOTHUB_CLIENT_QUEUE_FULL_POLICY_VALUES       \
+    IOTHUB_CLIENT_QUEUE_FULL_REJECT,                 \
+    IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST,            \
+    IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY
+
+/** @brief What IoTHubClient_LL_SendEventAsync does when a new message would exceed
+*		   the "send_queue_max_messages" or "send_queue_max_bytes" options.
+*/
+DEFINE_ENUM(IOTHUB_CLIENT_QUEUE_FULL_POLICY, IOTHUB_CLIENT_QUEUE_FULL_POLICY_VALUES);
+
+/** @brief Messages accepted by IoTHubClient_LL_SendEventAsync whose confirmation
+*		   callback has not been called yet, returned by ::IoTHubClient_LL_GetSendQueueStatus.
+*/
+typedef struct IOTHUB_CLIENT_SEND_QUEUE_STATUS_TAG
+{
+    size_t messageCount; /*number of messages waiting to be sent or waiting for their confirmation*/
+    size_t byteCount; /*sum of the payload sizes of these messages*/
+} IOTHUB_CLIENT_SEND_QUEUE_STATUS;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -105,7 +136,8 @@ extern "C"
     IOTHUB_CLIENT_CONFIRMATION_OK,                   \
     IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY,      \
     IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT,      \
-    IOTHUB_CLIENT_CONFIRMATION_ERROR                 \
+    IOTHUB_CLIENT_CONFIRMATION_ERROR,                \
+    IOTHUB_CLIENT_CONFIRMATION_DROPPED               \
 
     /** @brief Enumeration passed in by the IoT Hub when the event confirmation
     *		   callback is invoked to indicate status of the event processing in
@@ -161,6 +193,17 @@ extern "C"
     DEFINE_ENUM(DEVICE_TWIN_UPDATE_STATE, DEVICE_TWIN_UPDATE_STATE_VALUES);
 
     typedef void(*IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK)(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback);
+
+    /** @brief One of the confirmations passed to an ::IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK,
+    *		   the context is the one given to IoTHubClient_LL_SendEventAsync.
+    */
+    typedef struct IOTHUB_CLIENT_EVENT_CONFIRMATION_TAG
+    {
+        void* userContextCallback;
+        IOTHUB_CLIENT_CONFIRMATION_RESULT result;
+    } IOTHUB_CLIENT_EVENT_CONFIRMATION;
+
+    typedef void(*IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK)(const IOTHUB_CLIENT_EVENT_CONFIRMATION* confirmations, size_t confirmationCount, void* userContextCallback);
     typedef void(*IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK)(IOTHUB_CLIENT_CONNECTION_STATUS result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason, void* userContextCallback);
     typedef IOTHUBMESSAGE_DISPOSITION_RESULT (*IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC)(IOTHUB_MESSAGE_HANDLE message, void* userContextCallback);
     typedef const TRANSPORT_PROVIDER*(*IOTHUB_CLIENT_TRANSPORT_PROVIDER)(void);
@@ -306,6 +349,25 @@ extern "C"
     */
      MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SendEventAsync, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Same as ::IoTHubClient_LL_SendEventAsync, except that the message is not cloned:
+    * 			on success the IoT Hub client takes ownership of @p eventMessageHandle and
+    * 			destroys it once the message is completed. Use this for large messages, where
+    * 			the copy made by ::IoTHubClient_LL_SendEventAsync is expensive.
+    *
+    * @param	iotHubClientHandle		   	The handle created by a call to the create function.
+    * @param	eventMessageHandle		   	The handle to an IoT Hub message. The caller must not use
+    * 										or destroy it after this function returns IOTHUB_CLIENT_OK.
+    * 										On failure, the caller still owns it.
+    * @param	eventConfirmationCallback  	The callback specified by the device for receiving
+    * 										confirmation of the delivery of the IoT Hub message.
+    * @param	userContextCallback			User specified context that will be provided to the
+    * 										callback. This can be @c NULL.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SendEventAsync_TakeOwnership, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
+
     /**
     * @brief	This function returns the current sending status for IoTHubClient.
     *
@@ -451,11 +513,90 @@ extern "C"
     *                interval in seconds when pings are sent to the server.
     *              - @b logtrace - available for MQTT protocol.  Boolean value that turns on and
     *                off the diagnostic logging.
+    *              - @b message_pool_size - the number of per message records preallocated by
+    *                the client, and by the MQTT transport, instead of calling malloc for
+    *                every message. 0 (the default) disables the pool. @p value is a pointer
+    *                to a size_t.
+    *              - @b send_queue_max_messages - the maximum number of messages accepted by
+    *                IoTHubClient_LL_SendEventAsync and not confirmed yet. 0 (the default)
+    *                means no limit. @p value is a pointer to a size_t.
+    *              - @b send_queue_max_bytes - the maximum sum of the payload sizes of these
+    *                messages. 0 (the default) means no limit. @p value is a pointer to a size_t.
+    *              - @b send_queue_full_policy - what happens to a message that would exceed
+    *                one of the limits above: IOTHUB_CLIENT_QUEUE_FULL_REJECT (the default)
+    *                fails the send with IOTHUB_CLIENT_QUEUE_FULL, IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST
+    *                and IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY make room by dropping messages
+    *                not yet handed to the transport, completing them with
+    *                IOTHUB_CLIENT_CONFIRMATION_DROPPED. @p value is a pointer to an
+    *                IOTHUB_CLIENT_QUEUE_FULL_POLICY.
+    *              - @b persistent_queue_segment_size - the size in bytes after which the
+    *                persistent queue starts a new segment file. Defaults to 1 MB.
+    *                @p value is a pointer to a size_t.
+    *              - @b persistent_queue_sync_count - the persistent queue flushes its files
+    *                every that many writes, and in IoTHubClient_LL_DoWork at most every 100 ms.
+    *                0 flushes only in IoTHubClient_LL_DoWork. Defaults to 16; a crash can lose
+    *                the messages written since the last flush. @p value is a pointer to a size_t.
+    *              - @b persistent_queue_replay_window - the messages recovered from the
+    *                persistent queue are put back in the send queue only while fewer than
+    *                that many messages are waiting to be confirmed. Defaults to 16.
+    *                @p value is a pointer to a size_t.
+    *              - @b persistent_queue_directory - an existing directory where every message
+    *                given to IoTHubClient_LL_SendEventAsync is written until it is confirmed,
+    *                times out or is dropped. The messages still there when the client is
+    *                created again (for example after a restart) are sent again, without a
+    *                confirmation callback. The options above must be set before this one,
+    *                which can only be set once. @p value is a const char*.
     *
     * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
     */
      MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SetOption, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, const char*, optionName, const void*, value);
 
+    /**
+    * @brief	This function returns in the out parameter @p statistics the usage of the
+    * 			message pool configured with the @b message_pool_size option.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	statistics			Out parameter receiving the statistics of the pool.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success, IOTHUB_CLIENT_ERROR if no pool is configured
+    * 			or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetMessagePoolStatistics, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS*, statistics);
+
+    /**
+    * @brief	This function returns in the out parameter @p status the number of messages,
+    * 			and their total payload size, accepted by IoTHubClient_LL_SendEventAsync
+    * 			whose confirmation callback has not been called yet.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	status				Out parameter receiving the current depth of the send queue.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetSendQueueStatus, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_SEND_QUEUE_STATUS*, status);
+
+    /**
+    * @brief	This API sets a callback receiving in one call the confirmations of the
+    * 			events sent without a confirmation callback, instead of one call per event.
+    * 			The confirmations collected while completing the list given to
+    * 			IoTHubClient_LL_SendComplete, or during one IoTHubClient_LL_DoWork,
+    * 			are delivered together.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	batchCallback		The callback, or NULL to go back to no confirmation
+    * 								for events sent without a callback.
+    * @param	userContextCallback	User specified context that will be provided to the
+    * 								callback. This can be @c NULL.
+    *
+    *			While a batch callback is set, IoTHubClient_LL_SendEventAsync accepts a NULL
+    *			eventConfirmationCallback with a non-NULL userContextCallback, that context is
+    *			the one reported for the event. Events sent with a confirmation callback keep
+    *			getting it, in no particular order relative to the batches.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SetEventConfirmationBatchCallback, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK, batchCallback, void*, userContextCallback);
+
     /**
     * @brief	This API specifies a call back to be used when the device receives a desired state update.
     *
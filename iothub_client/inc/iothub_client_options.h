@@ -32,6 +32,34 @@ extern "C"
     static const char* OPTION_MIN_POLLING_TIME = "MinimumPollingTime";
     static const char* OPTION_BATCHING = "Batching";
 
+    static const char* OPTION_DO_WORK_FREQUENCY_IN_MS = "do_work_freq_ms";
+    static const char* OPTION_DISPATCH_CALLBACKS_ON_THREAD = "dispatch_callbacks_on_thread";
+
+    static const char* OPTION_MESSAGE_POOL_SIZE = "message_pool_size";
+
+    static const char* OPTION_MQTT_MAX_IN_FLIGHT = "mqtt_max_in_flight";
+    static const char* OPTION_MQTT_MAX_MESSAGES_PER_SECOND = "mqtt_max_messages_per_second";
+    static const char* OPTION_MQTT_MAX_BYTES_PER_SECOND = "mqtt_max_bytes_per_second";
+    static const char* OPTION_MQTT_RESEND_TIMEOUT = "mqtt_resend_timeout";
+    static const char* OPTION_MQTT_MAX_SEND_COUNT = "mqtt_max_send_count";
+
+    static const char* OPTION_AMQP_BATCH_MAX_BYTES = "amqp_batch_max_bytes";
+    static const char* OPTION_AMQP_BATCH_LINGER_MS = "amqp_batch_linger_ms";
+    static const char* OPTION_AMQP_INCOMING_WINDOW = "amqp_incoming_window";
+    static const char* OPTION_AMQP_OUTGOING_WINDOW = "amqp_outgoing_window";
+    static const char* OPTION_AMQP_SENDER_MAX_MESSAGE_SIZE = "amqp_sender_max_message_size";
+    static const char* OPTION_AMQP_RECEIVER_MAX_MESSAGE_SIZE = "amqp_receiver_max_message_size";
+    static const char* OPTION_AMQP_MAX_PENDING_AUTHENTICATIONS = "amqp_max_pending_authentications";
+
+    static const char* OPTION_SEND_QUEUE_MAX_MESSAGES = "send_queue_max_messages";
+    static const char* OPTION_SEND_QUEUE_MAX_BYTES = "send_queue_max_bytes";
+    static const char* OPTION_SEND_QUEUE_FULL_POLICY = "send_queue_full_policy";
+
+    static const char* OPTION_PERSISTENT_QUEUE_DIRECTORY = "persistent_queue_directory";
+    static const char* OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE = "persistent_queue_segment_size";
+    static const char* OPTION_PERSISTENT_QUEUE_SYNC_COUNT = "persistent_queue_sync_count";
+    static const char* OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW = "persistent_queue_replay_window";
+
 #ifdef __cplusplus
 }
 #endif
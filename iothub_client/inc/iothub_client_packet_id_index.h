@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_packet_id_index.h
+*	@brief	 A hash index of in-flight records keyed by their 16 bit MQTT packet id.
+*
+*	@details The index is intrusive, like DLIST_ENTRY: a record that needs to be found by
+*			 packet id embeds a PACKET_ID_INDEX_ENTRY and is recovered from it with
+*			 containingRecord. Packet ids are handed out sequentially, so the bucket is
+*			 simply the low bits of the id. The first PACKET_ID_INDEX_INLINE_BUCKETS buckets
+*			 live inside the PACKET_ID_INDEX itself; when there are more entries than buckets
+*			 the bucket array is doubled (up to one bucket per packet id). If that allocation
+*			 fails the index keeps working with longer chains, so inserting never fails.
+*			 The index is not thread safe, it is meant to be used under the lock
+*			 of the handle owning it.
+*/
+
+#ifndef IOTHUB_CLIENT_PACKET_ID_INDEX_H
+#define IOTHUB_CLIENT_PACKET_ID_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PACKET_ID_INDEX_INLINE_BUCKETS 16
+
+typedef struct PACKET_ID_INDEX_ENTRY_TAG
+{
+    struct PACKET_ID_INDEX_ENTRY_TAG* next;
+    uint16_t packetId;
+} PACKET_ID_INDEX_ENTRY;
+
+typedef struct PACKET_ID_INDEX_TAG
+{
+    PACKET_ID_INDEX_ENTRY** buckets; /*either inlineBuckets or an allocated array of bucketCount buckets*/
+    size_t bucketCount; /*always a power of 2*/
+    size_t count;
+    PACKET_ID_INDEX_ENTRY* inlineBuckets[PACKET_ID_INDEX_INLINE_BUCKETS];
+} PACKET_ID_INDEX;
+
+    MOCKABLE_FUNCTION(, void, IoTHubClient_PacketIdIndex_Init, PACKET_ID_INDEX*, index);
+    MOCKABLE_FUNCTION(, void, IoTHubClient_PacketIdIndex_Deinit, PACKET_ID_INDEX*, index);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_PacketIdIndex_Insert, PACKET_ID_INDEX*, index, PACKET_ID_INDEX_ENTRY*, entry, uint16_t, packetId);
+    MOCKABLE_FUNCTION(, PACKET_ID_INDEX_ENTRY*, IoTHubClient_PacketIdIndex_Remove, PACKET_ID_INDEX*, index, uint16_t, packetId);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_PacketIdIndex_RemoveEntry, PACKET_ID_INDEX*, index, PACKET_ID_INDEX_ENTRY*, entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_PACKET_ID_INDEX_H */
@@ -0,0 +1,58 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_persistent_queue.h
+*	@brief	 An append-only log of the messages waiting to be sent, kept in a directory.
+*
+*	@details The log is made of segment files named after consecutive segment ids.
+*			 Every message appended to the queue is serialized (payload, message id,
+*			 correlation id, priority and properties) at the end of the newest segment
+*			 and stays pending until it is marked done. A segment whose entries are all
+*			 done is deleted once every older segment was deleted, so the directory only
+*			 holds the messages that might still need to be sent.
+*			 When a queue is created over a directory that already holds segments, the
+*			 pending entries found there are handed out one at a time by
+*			 IoTHubClient_PersistentQueue_GetNextRecovered, so they can be replayed
+*			 without reading the whole backlog in memory.
+*			 Writes are flushed, and synced to the storage where the platform allows it,
+*			 every syncCount writes and by IoTHubClient_PersistentQueue_Flush; only the
+*			 segments written since their last sync are synced. Only the segment being
+*			 appended to is kept open, older segments are opened again when an entry in
+*			 them is marked done or read back.
+*			 A persistent queue is not thread safe, it is meant to be used under the lock
+*			 of the handle owning it.
+*/
+
+#ifndef IOTHUB_CLIENT_PERSISTENT_QUEUE_H
+#define IOTHUB_CLIENT_PERSISTENT_QUEUE_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+#include "iothub_message.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct PERSISTENT_QUEUE_TAG* PERSISTENT_QUEUE_HANDLE;
+
+/*identifies an entry of the queue so that it can be marked done*/
+typedef struct PERSISTENT_QUEUE_ENTRY_TAG
+{
+    size_t segmentId;
+    long offset;
+} PERSISTENT_QUEUE_ENTRY;
+
+    MOCKABLE_FUNCTION(, PERSISTENT_QUEUE_HANDLE, IoTHubClient_PersistentQueue_Create, const char*, directory, size_t, segmentSize, size_t, syncCount);
+    MOCKABLE_FUNCTION(, void, IoTHubClient_PersistentQueue_Destroy, PERSISTENT_QUEUE_HANDLE, persistentQueue);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_PersistentQueue_Append, PERSISTENT_QUEUE_HANDLE, persistentQueue, IOTHUB_MESSAGE_HANDLE, message, PERSISTENT_QUEUE_ENTRY*, entry);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_PersistentQueue_MarkDone, PERSISTENT_QUEUE_HANDLE, persistentQueue, const PERSISTENT_QUEUE_ENTRY*, entry);
+    MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_HANDLE, IoTHubClient_PersistentQueue_GetNextRecovered, PERSISTENT_QUEUE_HANDLE, persistentQueue, PERSISTENT_QUEUE_ENTRY*, entry);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_PersistentQueue_Flush, PERSISTENT_QUEUE_HANDLE, persistentQueue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_PERSISTENT_QUEUE_H */
@@ -15,6 +15,7 @@
 
 #include "iothub_message.h"
 #include "iothub_client_ll.h"
+#include "iothub_client_persistent_queue.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -38,6 +39,7 @@ MOCKABLE_FUNCTION(, IOTHUBMESSAGE_DISPOSITION_RESULT, IoTHubClient_LL_MessageCal
 MOCKABLE_FUNCTION(, void, IoTHubClient_LL_RetrievePropertyComplete, IOTHUB_CLIENT_LL_HANDLE, handle, DEVICE_TWIN_UPDATE_STATE, update_state, const unsigned char*, payLoad, size_t, size);
 MOCKABLE_FUNCTION(, int, IoTHubClient_LL_DeviceMethodComplete, IOTHUB_CLIENT_LL_HANDLE, handle, const char*, method_name, const unsigned char*, payLoad, size_t, size, METHOD_HANDLE, response_id);
 MOCKABLE_FUNCTION(, void, IotHubClient_LL_ConnectionStatusCallBack, IOTHUB_CLIENT_LL_HANDLE, handle, IOTHUB_CLIENT_CONNECTION_STATUS, status, IOTHUB_CLIENT_CONNECTION_STATUS_REASON, reason);
+MOCKABLE_FUNCTION(, int, IoTHubClient_LL_GetTimeToNextTimeout, IOTHUB_CLIENT_LL_HANDLE, handle, tickcounter_ms_t*, time_to_next_timeout);
 typedef struct IOTHUB_MESSAGE_LIST_TAG
 {
     IOTHUB_MESSAGE_HANDLE messageHandle;
@@ -45,6 +47,13 @@ typedef struct IOTHUB_MESSAGE_LIST_TAG
     void* context; 
     DLIST_ENTRY entry;
     tickcounter_ms_t ms_timesOutAfter; /* a value of "0" means "no timeout", if the IOTHUBCLIENT_LL's handle tickcounter > msTimesOutAfer then the message shall timeout*/
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK userCallback; /*callback and context above point to IoTHubClient_LL, which accounts for the message before calling these*/
+    void* userContext;
+    IOTHUB_CLIENT_LL_HANDLE ownerHandle;
+    size_t byteCount;
+    bool isPersisted; /*true when the message has an entry in the persistent queue of its owner*/
+    PERSISTENT_QUEUE_ENTRY persistentEntry;
+    uint64_t sequenceNumber; /*set by IoTHubClient_LL when the message is added to waitingToSend, never 0*/
 }IOTHUB_MESSAGE_LIST;
 
 typedef struct IOTHUB_DEVICE_TWIN_TAG
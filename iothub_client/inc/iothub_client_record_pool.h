@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_record_pool.h
+*	@brief	 A fixed size free list for the small records allocated for every message.
+*
+*	@details A record pool preallocates capacity records of recordSize bytes in a single
+*			 block and hands them out from a free list. When the pool is exhausted (or when
+*			 the pool handle is NULL) records are allocated with malloc, so callers never
+*			 need to know where a record came from: every record obtained from
+*			 IoTHubClient_RecordPool_Alloc is released with IoTHubClient_RecordPool_Free.
+*			 A pool can be destroyed while some of its records are still in use; the
+*			 memory is then released when the last record is freed.
+*			 A record pool is not thread safe, it is meant to be used under the lock
+*			 of the handle owning it.
+*/
+
+#ifndef IOTHUB_CLIENT_RECORD_POOL_H
+#define IOTHUB_CLIENT_RECORD_POOL_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RECORD_POOL_TAG* RECORD_POOL_HANDLE;
+
+typedef struct RECORD_POOL_STATISTICS_TAG
+{
+    size_t capacity; /*number of records preallocated by the pool*/
+    size_t inUse; /*number of preallocated records currently handed out*/
+    size_t hits; /*number of allocations served from the pool*/
+    size_t misses; /*number of allocations that had to use malloc because the pool was exhausted*/
+} RECORD_POOL_STATISTICS;
+
+    MOCKABLE_FUNCTION(, RECORD_POOL_HANDLE, IoTHubClient_RecordPool_Create, size_t, recordSize, size_t, capacity);
+    MOCKABLE_FUNCTION(, void, IoTHubClient_RecordPool_Destroy, RECORD_POOL_HANDLE, recordPool);
+    MOCKABLE_FUNCTION(, void*, IoTHubClient_RecordPool_Alloc, RECORD_POOL_HANDLE, recordPool, size_t, recordSize);
+    MOCKABLE_FUNCTION(, void, IoTHubClient_RecordPool_Free, void*, record);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_RecordPool_GetStatistics, RECORD_POOL_HANDLE, recordPool, RECORD_POOL_STATISTICS*, statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_RECORD_POOL_H */
@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IOTHUB_CLIENT_SHARED_TRANSPORT_PRIVATE_H
+#define IOTHUB_CLIENT_SHARED_TRANSPORT_PRIVATE_H
+
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifndef IOTHUB_CLIENT_INSTANCE_TYPE
+typedef struct IOTHUB_CLIENT_INSTANCE_TAG* IOTHUB_CLIENT_HANDLE;
+#define IOTHUB_CLIENT_INSTANCE_TYPE
+#endif // IOTHUB_CLIENT_INSTANCE
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*used by iothubtransport.c to schedule the clients sharing a transport, must be called with the transport lock taken, not part of the public API*/
+MOCKABLE_FUNCTION(, tickcounter_ms_t, IoTHubClient_GetTimeToWait, IOTHUB_CLIENT_HANDLE, iotHubClientHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_SHARED_TRANSPORT_PRIVATE_H */
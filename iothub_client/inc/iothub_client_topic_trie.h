@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_topic_trie.h
+*	@brief	 A trie of MQTT topic filters used to route received publishes in one pass.
+*
+*	@details Each node of the trie is one level of a topic filter (the text between two '/').
+*			 A level can be a wildcard: '+' matches exactly one level of the topic and
+*			 '#' matches all the remaining levels, none included. Matching prefers a literal
+*			 level over '+' and '+' over '#', and reports where every '+' level and the
+*			 '#' remainder are in the topic, so the caller can read the fields it needs in
+*			 place. The nodes live inside the TOPIC_TRIE and point into the filter strings,
+*			 so neither adding nor matching allocates; the filters must outlive the trie.
+*			 The trie is not thread safe, it is meant to be used under the lock
+*			 of the handle owning it.
+*/
+
+#ifndef IOTHUB_CLIENT_TOPIC_TRIE_H
+#define IOTHUB_CLIENT_TOPIC_TRIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define TOPIC_TRIE_MAX_NODES 32
+#define TOPIC_TRIE_MAX_CAPTURES 4
+
+typedef struct TOPIC_TRIE_NODE_TAG
+{
+    const char* level;
+    size_t levelLength;
+    uint8_t firstChild; /*index in nodes, 0 (the root) means none*/
+    uint8_t nextSibling;
+    int value; /*-1 when no filter ends at this node*/
+} TOPIC_TRIE_NODE;
+
+typedef struct TOPIC_TRIE_TAG
+{
+    TOPIC_TRIE_NODE nodes[TOPIC_TRIE_MAX_NODES];
+    size_t nodeCount;
+} TOPIC_TRIE;
+
+typedef struct TOPIC_TRIE_MATCH_TAG
+{
+    int value;
+    size_t captureCount;
+    const char* captures[TOPIC_TRIE_MAX_CAPTURES]; /*the levels matched by '+', in order*/
+    size_t captureLengths[TOPIC_TRIE_MAX_CAPTURES];
+    const char* remainder; /*the levels matched by '#', an empty string when the filter has no '#'*/
+} TOPIC_TRIE_MATCH;
+
+    MOCKABLE_FUNCTION(, void, IoTHubClient_TopicTrie_Init, TOPIC_TRIE*, trie);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_TopicTrie_Add, TOPIC_TRIE*, trie, const char*, filter, int, value);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_TopicTrie_Match, const TOPIC_TRIE*, trie, const char*, topic, TOPIC_TRIE_MATCH*, match);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_TOPIC_TRIE_H */
@@ -0,0 +1,34 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_url_encode.h
+*	@brief	 Percent-encoding (RFC 3986) into caller provided buffers.
+*
+*	@details The codec never allocates: the caller sizes the destination with
+*			 IoTHubClient_UrlEncode_GetEncodedLength, and a decoded string is never
+*			 longer than its encoded form. Only the unreserved characters (letters,
+*			 digits, '-', '.', '_' and '~') are left as they are; every other byte is
+*			 written as '%' followed by two upper case hexadecimal digits. Neither
+*			 function writes a terminating '\0'.
+*/
+
+#ifndef IOTHUB_CLIENT_URL_ENCODE_H
+#define IOTHUB_CLIENT_URL_ENCODE_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    MOCKABLE_FUNCTION(, size_t, IoTHubClient_UrlEncode_GetEncodedLength, const char*, source, size_t, length);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_UrlEncode_Encode, char*, destination, const char*, source, size_t, length);
+    MOCKABLE_FUNCTION(, int, IoTHubClient_UrlEncode_Decode, char*, destination, const char*, source, size_t, length, size_t*, decodedLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_URL_ENCODE_H */
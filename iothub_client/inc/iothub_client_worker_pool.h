@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_worker_pool.h
+*	@brief	 A fixed set of worker threads that can service many IoTHubClient
+*			 and shared transport handles.
+*
+*	@details By default every IoTHubClient handle (or every shared TRANSPORT_HANDLE)
+*			 starts a dedicated worker thread. A worker pool created with
+*			 IoTHubClient_WorkerPool_Create and attached with IoTHubClient_SetWorkerPool
+*			 or IoTHubTransport_SetWorkerPool replaces those threads with
+*			 threadCount threads shared by all the attached handles. A handle is never
+*			 worked on by two threads at the same time and keeps its own lock, so
+*			 the threading guarantees of the IoTHubClient APIs are unchanged.
+*			 The pool should outlive every handle attached to it.
+*/
+
+#ifndef IOTHUB_CLIENT_WORKER_POOL_H
+#define IOTHUB_CLIENT_WORKER_POOL_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct IOTHUB_CLIENT_WORKER_POOL_TAG* IOTHUB_CLIENT_WORKER_POOL_HANDLE;
+
+    /**
+    * @brief	Creates a worker pool with threadCount threads.
+    *
+    * @param	threadCount	The number of threads servicing the handles attached to the pool. Must be greater than 0.
+    *
+    * @return	A non-NULL @c IOTHUB_CLIENT_WORKER_POOL_HANDLE value or NULL on failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_WORKER_POOL_HANDLE, IoTHubClient_WorkerPool_Create, size_t, threadCount);
+
+    /**
+    * @brief	Stops and joins the threads of the pool and frees its resources. The handles
+    *			attached to the pool should be destroyed before calling this function; any
+    *			handle still attached is no longer serviced and releases its part of the
+    *			pool when it is destroyed.
+    *
+    * @param	workerPool	The handle created by a call to IoTHubClient_WorkerPool_Create.
+    */
+    MOCKABLE_FUNCTION(, void, IoTHubClient_WorkerPool_Destroy, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_WORKER_POOL_H */
@@ -0,0 +1,31 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IOTHUB_CLIENT_WORKER_POOL_PRIVATE_H
+#define IOTHUB_CLIENT_WORKER_POOL_PRIVATE_H
+
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#include "iothub_client_worker_pool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct WORKER_POOL_ITEM_TAG* WORKER_POOL_ITEM_HANDLE;
+
+/*runs one unit of work for the item and returns the number of milliseconds after which the item wants to run again*/
+typedef tickcounter_ms_t(*WORKER_POOL_DO_WORK)(void* context);
+
+/*used by iothub_client.c and iothubtransport.c to attach their handles to the pool, not part of the public API*/
+MOCKABLE_FUNCTION(, WORKER_POOL_ITEM_HANDLE, IoTHubClient_WorkerPool_Add, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool, WORKER_POOL_DO_WORK, doWork, void*, context);
+MOCKABLE_FUNCTION(, void, IoTHubClient_WorkerPool_Signal, WORKER_POOL_ITEM_HANDLE, item);
+MOCKABLE_FUNCTION(, void, IoTHubClient_WorkerPool_Remove, WORKER_POOL_ITEM_HANDLE, item);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_WORKER_POOL_PRIVATE_H */
@@ -44,6 +44,11 @@ DEFINE_ENUM(IOTHUBMESSAGE_CONTENT_TYPE, IOTHUBMESSAGE_CONTENT_TYPE_VALUES);
 
 typedef struct IOTHUB_MESSAGE_HANDLE_DATA_TAG* IOTHUB_MESSAGE_HANDLE;
 
+/** @brief Called when a message created by ::IoTHubMessage_CreateFromByteArrayWithRelease
+  * no longer needs the memory it refers to.
+  */
+typedef void(*IOTHUB_MESSAGE_RELEASE_CALLBACK)(void* releaseContext);
+
 /**
  * @brief   Creates a new IoT hub message from a byte array. The type of the
  *          message will be set to @c IOTHUBMESSAGE_BYTEARRAY.
@@ -56,6 +61,23 @@ typedef struct IOTHUB_MESSAGE_HANDLE_DATA_TAG* IOTHUB_MESSAGE_HANDLE;
  */
 MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_HANDLE, IoTHubMessage_CreateFromByteArray, const unsigned char*, byteArray, size_t, size);
 
+/**
+ * @brief   Creates a new IoT hub message that refers to @p byteArray instead of
+ *          copying it. The type of the message will be set to
+ *          @c IOTHUBMESSAGE_BYTEARRAY. The memory must stay valid and unchanged
+ *          until @p releaseCallback is called by ::IoTHubMessage_Destroy.
+ *
+ * @param   byteArray       The byte array the message refers to.
+ * @param   size            The size of the byte array.
+ * @param   releaseCallback Called when the message is destroyed. This can be @c NULL.
+ * @param   releaseContext  User specified context that will be provided to
+ *                          @p releaseCallback.
+ *
+ * @return  A valid @c IOTHUB_MESSAGE_HANDLE if the message was successfully
+ *          created or @c NULL in case an error occurs.
+ */
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_HANDLE, IoTHubMessage_CreateFromByteArrayWithRelease, const unsigned char*, byteArray, size_t, size, IOTHUB_MESSAGE_RELEASE_CALLBACK, releaseCallback, void*, releaseContext);
+
 /**
  * @brief   Creates a new IoT hub message from a null terminated string.  The
  *          type of the message will be set to @c IOTHUBMESSAGE_STRING.
@@ -167,6 +189,29 @@ MOCKABLE_FUNCTION(, const char*, IoTHubMessage_GetCorrelationId, IOTHUB_MESSAGE_
 */
 MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetCorrelationId, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, const char*, correlationId);
 
+/**
+* @brief   Sets the priority of the message. The priority is not sent to the
+*          IoT hub, it only decides which message is dropped first when the send
+*          queue of the client is full and the "send_queue_full_policy" option is
+*          IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY.
+*
+* @param   iotHubMessageHandle Handle to the message.
+* @param   priority The priority of the message, higher values are dropped last.
+*
+* @return  Returns IOTHUB_MESSAGE_OK if the priority was set successfully
+*          or an error code otherwise.
+*/
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetPriority, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, int, priority);
+
+/**
+* @brief   Gets the priority of the message.
+*
+* @param   iotHubMessageHandle Handle to the message.
+*
+* @return  The priority of the message, 0 if it was never set.
+*/
+MOCKABLE_FUNCTION(, int, IoTHubMessage_GetPriority, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
+
 /**
  * @brief   Frees all resources associated with the given message handle.
  *
@@ -13,6 +13,7 @@ typedef struct TRANSPORT_HANDLE_DATA_TAG* TRANSPORT_HANDLE;
 #include "iothub_client_ll.h"
 #include "iothub_client_private.h"
 #include "iothub_transport_ll.h"
+#include "iothub_client_worker_pool.h"
 
 #ifndef IOTHUB_CLIENT_INSTANCE_TYPE
 typedef struct IOTHUB_CLIENT_INSTANCE_TAG* IOTHUB_CLIENT_HANDLE;
@@ -32,6 +33,8 @@ extern "C"
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubTransport_StartWorkerThread, TRANSPORT_HANDLE, transportHandle, IOTHUB_CLIENT_HANDLE, clientHandle);
     MOCKABLE_FUNCTION(, bool, IoTHubTransport_SignalEndWorkerThread, TRANSPORT_HANDLE, transportHandle, IOTHUB_CLIENT_HANDLE, clientHandle);
     MOCKABLE_FUNCTION(, void, IoTHubTransport_JoinWorkerThread, TRANSPORT_HANDLE, transportHandle, IOTHUB_CLIENT_HANDLE, clientHandle);
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubTransport_SetWorkerPool, TRANSPORT_HANDLE, transportHandle, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool);
+    MOCKABLE_FUNCTION(, void, IoTHubTransport_SignalWork, TRANSPORT_HANDLE, transportHandle);
 
 #ifdef __cplusplus
 }
@@ -15,6 +15,15 @@ extern "C"
 
 typedef XIO_HANDLE(*AMQP_GET_IO_TRANSPORT)(const char* target_fqdn);
 
+/*how quickly the devices of the transport authenticate, returned by IoTHubTransport_AMQP_Common_GetAuthenticationStatistics*/
+typedef struct AMQP_TRANSPORT_AUTHENTICATION_STATISTICS_TAG
+{
+    size_t pending_authentications; /*devices currently waiting on a CBS put-token started by the transport*/
+    size_t devices_ready; /*devices whose event sender opened after the transport authenticated them*/
+    double total_time_to_ready; /*seconds from authenticating each of these devices to its event sender opening, added up*/
+    double max_time_to_ready; /*longest of these times, in seconds*/
+} AMQP_TRANSPORT_AUTHENTICATION_STATISTICS;
+
 MOCKABLE_FUNCTION(, TRANSPORT_LL_HANDLE, IoTHubTransport_AMQP_Common_Create, const IOTHUBTRANSPORT_CONFIG*, config, AMQP_GET_IO_TRANSPORT, get_io_transport);
 MOCKABLE_FUNCTION(, void, IoTHubTransport_AMQP_Common_Destroy, TRANSPORT_LL_HANDLE, handle);
 MOCKABLE_FUNCTION(, int, IoTHubTransport_AMQP_Common_Subscribe, IOTHUB_DEVICE_HANDLE, handle);
@@ -32,6 +41,7 @@ MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubTransport_AMQP_Common_SetOption,
 MOCKABLE_FUNCTION(, IOTHUB_DEVICE_HANDLE, IoTHubTransport_AMQP_Common_Register, TRANSPORT_LL_HANDLE, handle, const IOTHUB_DEVICE_CONFIG*, device, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, PDLIST_ENTRY, waitingToSend);
 MOCKABLE_FUNCTION(, void, IoTHubTransport_AMQP_Common_Unregister, IOTHUB_DEVICE_HANDLE, deviceHandle);
 MOCKABLE_FUNCTION(, STRING_HANDLE, IoTHubTransport_AMQP_Common_GetHostname, TRANSPORT_LL_HANDLE, handle);
+MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubTransport_AMQP_Common_GetAuthenticationStatistics, TRANSPORT_LL_HANDLE, handle, AMQP_TRANSPORT_AUTHENTICATION_STATISTICS*, statistics);
 
 #ifdef __cplusplus
 }
@@ -5,7 +5,9 @@
 #define UAMQP_MESSAGING_H
 
 #include "iothub_message.h"
+#include "azure_c_shared_utility/map.h"
 #include "azure_uamqp_c/message.h"
+#include "azure_uamqp_c/amqpvalue.h"
 #include "azure_c_shared_utility/umock_c_prod.h"
 
 #ifdef __cplusplus
@@ -13,8 +15,20 @@ extern "C"
 {
 #endif
 
+	/* The application properties of the last message converted with a cache and the uAMQP map built out of them.
+	   Messages with the same properties (same keys and values, in the same order) reuse the map instead of building it again.
+	   Zero it before first use and release it with message_clear_application_properties_cache(). */
+	typedef struct UAMQP_APPLICATION_PROPERTIES_CACHE_TAG
+	{
+		MAP_HANDLE properties;
+		AMQP_VALUE uamqp_map;
+	} UAMQP_APPLICATION_PROPERTIES_CACHE;
+
 	MOCKABLE_FUNCTION(, int, IoTHubMessage_CreateFromUamqpMessage, MESSAGE_HANDLE, uamqp_message, IOTHUB_MESSAGE_HANDLE*, iothubclient_message);
 	MOCKABLE_FUNCTION(, int, message_create_from_iothub_message, IOTHUB_MESSAGE_HANDLE, iothub_message, MESSAGE_HANDLE*, uamqp_message);
+	MOCKABLE_FUNCTION(, int, message_create_from_iothub_message_with_cache, IOTHUB_MESSAGE_HANDLE, iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE*, cache, MESSAGE_HANDLE*, uamqp_message);
+	MOCKABLE_FUNCTION(, int, message_create_uamqp_encoding_from_iothub_message, IOTHUB_MESSAGE_HANDLE, iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE*, cache, BINARY_DATA*, body_binary_data);
+	MOCKABLE_FUNCTION(, void, message_clear_application_properties_cache, UAMQP_APPLICATION_PROPERTIES_CACHE*, cache);
 
 #ifdef __cplusplus
 }
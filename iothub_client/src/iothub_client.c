@@ -7,15 +7,25 @@
 
 #include <signal.h>
 #include <stddef.h>
+#include <string.h>
 #include "azure_c_shared_utility/crt_abstractions.h"
 #include "iothub_client.h"
 #include "iothub_client_ll.h"
 #include "iothubtransport.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/vector.h"
+#include "iothub_client_options.h"
+#include "iothub_client_private.h"
+#include "iothub_client_worker_pool_private.h"
+#include "iothub_client_shared_transport_private.h"
+
+#define DO_WORK_FREQ_DEFAULT_MS 1
+#define DO_WORK_MAXIMUM_ALLOWED_FREQUENCY_MS 100
+#define DO_WORK_BUSY_FREQ_MS 1
 
 struct IOTHUB_QUEUE_CONTEXT_TAG;
 
@@ -25,14 +35,26 @@ typedef struct IOTHUB_CLIENT_INSTANCE_TAG
     TRANSPORT_HANDLE TransportHandle;
     THREAD_HANDLE ThreadHandle;
     LOCK_HANDLE LockHandle;
+    COND_HANDLE WorkCondition; /*signalled whenever there is work for ScheduleWork_Thread, only exists while the instance owns its thread*/
+    int work_pending;
+    tickcounter_ms_t do_work_freq_ms;
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE WorkerPool; /*when set, the instance is serviced by the pool instead of ScheduleWork_Thread*/
+    WORKER_POOL_ITEM_HANDLE WorkerPoolItem;
     sig_atomic_t StopThread;
 #ifndef DONT_USE_UPLOADTOBLOB
     SINGLYLINKEDLIST_HANDLE savedDataToBeCleaned; /*list containing UPLOADTOBLOB_SAVED_DATA*/
 #endif
     int created_with_transport_handle;
-    VECTOR_HANDLE saved_user_callback_list;
+    LOCK_HANDLE CallbackLock; /*guards only the two callback lists below, never held while a user callback runs*/
+    VECTOR_HANDLE saved_user_callback_list; /*callbacks queued by DoWork, waiting to be dispatched*/
+    VECTOR_HANDLE dispatching_user_callback_list; /*spare list swapped with saved_user_callback_list by the dispatcher, NULL while a batch is being dispatched*/
+    THREAD_HANDLE DispatchThreadHandle; /*only exists when OPTION_DISPATCH_CALLBACKS_ON_THREAD was set*/
+    COND_HANDLE DispatchCondition; /*signalled under CallbackLock whenever a callback is queued while DispatchThreadHandle exists*/
+    int StopDispatchThread;
     IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK desired_state_callback;
     IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK event_confirm_callback;
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK event_confirm_batch_callback;
+    void* event_confirm_batch_user_context;
     IOTHUB_CLIENT_REPORTED_STATE_CALLBACK reported_state_callback;
     IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connection_status_callback;
     IOTHUB_CLIENT_INBOUND_DEVICE_METHOD_CALLBACK device_method_callback;
@@ -60,13 +82,15 @@ typedef struct UPLOADTOBLOB_SAVED_DATA_TAG
     CALLBACK_TYPE_EVENT_CONFIRM,    \
     CALLBACK_TYPE_REPORTED_STATE,   \
     CALLBACK_TYPE_CONNECTION_STATUS, \
-    CALLBACK_TYPE_DEVICE_METHOD
+    CALLBACK_TYPE_DEVICE_METHOD,    \
+    CALLBACK_TYPE_EVENT_CONFIRM_BATCH
 
 DEFINE_ENUM(USER_CALLBACK_TYPE, USER_CALLBACK_TYPE_VALUES)
 DEFINE_ENUM_STRINGS(USER_CALLBACK_TYPE, USER_CALLBACK_TYPE_VALUES)
 
 typedef struct DEVICE_TWIN_CALLBACK_INFO_TAG
 {
+    IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK callback;
     DEVICE_TWIN_UPDATE_STATE update_state;
     unsigned char* payLoad;
     size_t size;
@@ -74,22 +98,33 @@ typedef struct DEVICE_TWIN_CALLBACK_INFO_TAG
 
 typedef struct EVENT_CONFIRM_CALLBACK_INFO_TAG
 {
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK callback;
     IOTHUB_CLIENT_CONFIRMATION_RESULT confirm_result;
 } EVENT_CONFIRM_CALLBACK_INFO;
 
+typedef struct EVENT_CONFIRM_BATCH_CALLBACK_INFO_TAG
+{
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK callback;
+    IOTHUB_CLIENT_EVENT_CONFIRMATION* confirmations;
+    size_t confirmationCount;
+} EVENT_CONFIRM_BATCH_CALLBACK_INFO;
+
 typedef struct REPORTED_STATE_CALLBACK_INFO_TAG
 {
+    IOTHUB_CLIENT_REPORTED_STATE_CALLBACK callback;
     int status_code;
 } REPORTED_STATE_CALLBACK_INFO;
 
 typedef struct CONNECTION_STATUS_CALLBACK_INFO_TAG
 {
+    IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK callback;
     IOTHUB_CLIENT_CONNECTION_STATUS connection_status;
     IOTHUB_CLIENT_CONNECTION_STATUS_REASON status_reason;
 } CONNECTION_STATUS_CALLBACK_INFO;
 
 typedef struct METHOD_CALLBACK_INFO_TAG
 {
+    IOTHUB_CLIENT_INBOUND_DEVICE_METHOD_CALLBACK callback;
     STRING_HANDLE method_name;
     BUFFER_HANDLE payload;
     METHOD_HANDLE method_id;
@@ -103,6 +138,7 @@ typedef struct USER_CALLBACK_INFO_TAG
     {
         DEVICE_TWIN_CALLBACK_INFO dev_twin_cb_info;
         EVENT_CONFIRM_CALLBACK_INFO event_confirm_cb_info;
+        EVENT_CONFIRM_BATCH_CALLBACK_INFO event_confirm_batch_cb_info;
         REPORTED_STATE_CALLBACK_INFO reported_state_cb_info;
         CONNECTION_STATUS_CALLBACK_INFO connection_status_cb_info;
         METHOD_CALLBACK_INFO method_cb_info;
@@ -117,6 +153,7 @@ typedef struct IOTHUB_QUEUE_CONTEXT_TAG
 
 /*used by unittests only*/
 const size_t IoTHubClient_ThreadTerminationOffset = offsetof(IOTHUB_CLIENT_INSTANCE, StopThread);
+const size_t IoTHubClient_DispatchThreadTerminationOffset = offsetof(IOTHUB_CLIENT_INSTANCE, StopDispatchThread);
 
 #ifndef DONT_USE_UPLOADTOBLOB
 /*this function is called from _Destroy and from ScheduleWork_Thread to join finished blobUpload threads and free that memory*/
@@ -167,6 +204,38 @@ static void garbageCollectorImpl(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
 }
 #endif
 
+/*called by the IoTHubClient_LL callbacks below, that is from IoTHubClient_LL_DoWork with LockHandle taken*/
+static int push_user_callback(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, const USER_CALLBACK_INFO* queue_cb_info)
+{
+    int result;
+
+    /*Codes_SRS_IOTHUBCLIENT_41_022: [ Each callback received from IoTHubClient_LL shall be queued, together with the user callback set at that time, under a lock that only guards the queue. ]*/
+    if (Lock(iotHubClientInstance->CallbackLock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = __LINE__;
+    }
+    else
+    {
+        if (VECTOR_push_back(iotHubClientInstance->saved_user_callback_list, queue_cb_info, 1) != 0)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_023: [ If callbacks are dispatched on their own thread, queueing a callback shall wake that thread up. ]*/
+            if ((iotHubClientInstance->DispatchCondition != NULL) &&
+                (Condition_Post(iotHubClientInstance->DispatchCondition) != COND_OK))
+            {
+                LogError("unable to Condition_Post, the callback will be dispatched with the next one");
+            }
+            result = 0;
+        }
+        (void)Unlock(iotHubClientInstance->CallbackLock);
+    }
+    return result;
+}
+
 static IOTHUBMESSAGE_DISPOSITION_RESULT iothub_ll_message_callback(IOTHUB_MESSAGE_HANDLE message, void* userContextCallback)
 {
     (void)message;
@@ -185,6 +254,7 @@ static int iothub_ll_inbound_device_method_callback(const char* method_name, con
         USER_CALLBACK_INFO queue_cb_info;
         queue_cb_info.type = CALLBACK_TYPE_DEVICE_METHOD;
         queue_cb_info.userContextCallback = queue_context->userContextCallback;
+        queue_cb_info.iothub_callback.method_cb_info.callback = queue_context->iotHubClientHandle->device_method_callback;
         queue_cb_info.iothub_callback.method_cb_info.method_id = method_id;
         if ( (queue_cb_info.iothub_callback.method_cb_info.method_name = STRING_construct(method_name)) == NULL)
         {
@@ -199,7 +269,7 @@ static int iothub_ll_inbound_device_method_callback(const char* method_name, con
             LogError("Failure: BUFFER_create");
             result = __LINE__;
         }
-        else if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
+        else if (push_user_callback(queue_context->iotHubClientHandle, &queue_cb_info) != 0)
         {
             STRING_delete(queue_cb_info.iothub_callback.method_cb_info.method_name);
             BUFFER_delete(queue_cb_info.iothub_callback.method_cb_info.payload);
@@ -231,9 +301,10 @@ static void iothub_ll_connection_status_callback(IOTHUB_CLIENT_CONNECTION_STATUS
         USER_CALLBACK_INFO queue_cb_info;
         queue_cb_info.type = CALLBACK_TYPE_CONNECTION_STATUS;
         queue_cb_info.userContextCallback = queue_context->userContextCallback;
+        queue_cb_info.iothub_callback.connection_status_cb_info.callback = queue_context->iotHubClientHandle->connection_status_callback;
         queue_cb_info.iothub_callback.connection_status_cb_info.status_reason = reason;
         queue_cb_info.iothub_callback.connection_status_cb_info.connection_status = result;
-        if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
+        if (push_user_callback(queue_context->iotHubClientHandle, &queue_cb_info) != 0)
         {
             LogError("connection status callback vector push failed.");
         }
@@ -248,8 +319,9 @@ static void iothub_ll_event_confirm_callback(IOTHUB_CLIENT_CONFIRMATION_RESULT r
         USER_CALLBACK_INFO queue_cb_info;
         queue_cb_info.type = CALLBACK_TYPE_EVENT_CONFIRM;
         queue_cb_info.userContextCallback = queue_context->userContextCallback;
+        queue_cb_info.iothub_callback.event_confirm_cb_info.callback = queue_context->iotHubClientHandle->event_confirm_callback;
         queue_cb_info.iothub_callback.event_confirm_cb_info.confirm_result = result;
-        if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
+        if (push_user_callback(queue_context->iotHubClientHandle, &queue_cb_info) != 0)
         {
             LogError("event confirm callback vector push failed.");
         }
@@ -257,6 +329,31 @@ static void iothub_ll_event_confirm_callback(IOTHUB_CLIENT_CONFIRMATION_RESULT r
     }
 }
 
+static void iothub_ll_event_confirm_batch_callback(const IOTHUB_CLIENT_EVENT_CONFIRMATION* confirmations, size_t confirmationCount, void* userContextCallback)
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)userContextCallback;
+    USER_CALLBACK_INFO queue_cb_info;
+    /*Codes_SRS_IOTHUBCLIENT_41_035: [ When IoTHubClient_LL reports a batch of confirmations, the whole batch shall be copied and queued as one callback, dispatched with a single call to the batch callback. ]*/
+    queue_cb_info.type = CALLBACK_TYPE_EVENT_CONFIRM_BATCH;
+    queue_cb_info.userContextCallback = iotHubClientInstance->event_confirm_batch_user_context;
+    queue_cb_info.iothub_callback.event_confirm_batch_cb_info.callback = iotHubClientInstance->event_confirm_batch_callback;
+    queue_cb_info.iothub_callback.event_confirm_batch_cb_info.confirmationCount = confirmationCount;
+    queue_cb_info.iothub_callback.event_confirm_batch_cb_info.confirmations = (IOTHUB_CLIENT_EVENT_CONFIRMATION*)malloc(confirmationCount * sizeof(IOTHUB_CLIENT_EVENT_CONFIRMATION));
+    if (queue_cb_info.iothub_callback.event_confirm_batch_cb_info.confirmations == NULL)
+    {
+        LogError("failure allocating %zu event confirmations", confirmationCount);
+    }
+    else
+    {
+        (void)memcpy(queue_cb_info.iothub_callback.event_confirm_batch_cb_info.confirmations, confirmations, confirmationCount * sizeof(IOTHUB_CLIENT_EVENT_CONFIRMATION));
+        if (push_user_callback(iotHubClientInstance, &queue_cb_info) != 0)
+        {
+            LogError("event confirm batch callback vector push failed.");
+            free(queue_cb_info.iothub_callback.event_confirm_batch_cb_info.confirmations);
+        }
+    }
+}
+
 static void iothub_ll_reported_state_callback(int status_code, void* userContextCallback)
 {
     IOTHUB_QUEUE_CONTEXT* queue_context = (IOTHUB_QUEUE_CONTEXT*)userContextCallback;
@@ -265,8 +362,9 @@ static void iothub_ll_reported_state_callback(int status_code, void* userContext
         USER_CALLBACK_INFO queue_cb_info;
         queue_cb_info.type = CALLBACK_TYPE_REPORTED_STATE;
         queue_cb_info.userContextCallback = queue_context->userContextCallback;
+        queue_cb_info.iothub_callback.reported_state_cb_info.callback = queue_context->iotHubClientHandle->reported_state_callback;
         queue_cb_info.iothub_callback.reported_state_cb_info.status_code = status_code;
-        if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
+        if (push_user_callback(queue_context->iotHubClientHandle, &queue_cb_info) != 0)
         {
             LogError("reported state callback vector push failed.");
         }
@@ -284,6 +382,7 @@ static void iothub_ll_device_twin_callback(DEVICE_TWIN_UPDATE_STATE update_state
         USER_CALLBACK_INFO queue_cb_info;
         queue_cb_info.type = CALLBACK_TYPE_DEVICE_TWIN;
         queue_cb_info.userContextCallback = queue_context->userContextCallback;
+        queue_cb_info.iothub_callback.dev_twin_cb_info.callback = queue_context->iotHubClientHandle->desired_state_callback;
         queue_cb_info.iothub_callback.dev_twin_cb_info.update_state = update_state;
         if (payLoad == NULL)
         {
@@ -309,7 +408,7 @@ static void iothub_ll_device_twin_callback(DEVICE_TWIN_UPDATE_STATE update_state
         }
         if (push_to_vector == 0)
         {
-            if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
+            if (push_user_callback(queue_context->iotHubClientHandle, &queue_cb_info) != 0)
             {
                 if (queue_cb_info.iothub_callback.dev_twin_cb_info.payLoad != NULL)
                 {
@@ -325,134 +424,362 @@ static void iothub_ll_device_twin_callback(DEVICE_TWIN_UPDATE_STATE update_state
     }
 }
 
+static void dispatch_user_callback(USER_CALLBACK_INFO* queued_cb)
+{
+    switch (queued_cb->type)
+    {
+        case CALLBACK_TYPE_DEVICE_TWIN:
+            if (queued_cb->iothub_callback.dev_twin_cb_info.callback)
+            {
+                queued_cb->iothub_callback.dev_twin_cb_info.callback(queued_cb->iothub_callback.dev_twin_cb_info.update_state, queued_cb->iothub_callback.dev_twin_cb_info.payLoad, queued_cb->iothub_callback.dev_twin_cb_info.size, queued_cb->userContextCallback);
+            }
+            if (queued_cb->iothub_callback.dev_twin_cb_info.payLoad)
+            {
+                free(queued_cb->iothub_callback.dev_twin_cb_info.payLoad);
+            }
+            break;
+        case CALLBACK_TYPE_EVENT_CONFIRM:
+            if (queued_cb->iothub_callback.event_confirm_cb_info.callback)
+            {
+                queued_cb->iothub_callback.event_confirm_cb_info.callback(queued_cb->iothub_callback.event_confirm_cb_info.confirm_result, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_EVENT_CONFIRM_BATCH:
+            if (queued_cb->iothub_callback.event_confirm_batch_cb_info.callback)
+            {
+                queued_cb->iothub_callback.event_confirm_batch_cb_info.callback(queued_cb->iothub_callback.event_confirm_batch_cb_info.confirmations, queued_cb->iothub_callback.event_confirm_batch_cb_info.confirmationCount, queued_cb->userContextCallback);
+            }
+            free(queued_cb->iothub_callback.event_confirm_batch_cb_info.confirmations);
+            break;
+        case CALLBACK_TYPE_REPORTED_STATE:
+            if (queued_cb->iothub_callback.reported_state_cb_info.callback)
+            {
+                queued_cb->iothub_callback.reported_state_cb_info.callback(queued_cb->iothub_callback.reported_state_cb_info.status_code, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_CONNECTION_STATUS:
+            if (queued_cb->iothub_callback.connection_status_cb_info.callback)
+            {
+                queued_cb->iothub_callback.connection_status_cb_info.callback(queued_cb->iothub_callback.connection_status_cb_info.connection_status, queued_cb->iothub_callback.connection_status_cb_info.status_reason, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_DEVICE_METHOD:
+            if (queued_cb->iothub_callback.method_cb_info.callback)
+            {
+                const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
+                const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
+                size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
+                queued_cb->iothub_callback.method_cb_info.callback(method_name, payload, payload_len, queued_cb->iothub_callback.method_cb_info.method_id, queued_cb->userContextCallback);
+            }
+            BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
+            STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
+            break;
+        default:
+            LogError("Invalid callback type '%s'", ENUM_TO_STRING(USER_CALLBACK_TYPE, queued_cb->type));
+            break;
+    }
+}
+
+/*takes everything queued so far as one batch and dispatches it without holding any lock, so neither DoWork nor the queueing of new callbacks waits for user code*/
 static void dispatch_user_callbacks(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
 {
-    if (Lock(iotHubClientInstance->LockHandle) == LOCK_OK)
+    if (Lock(iotHubClientInstance->CallbackLock) != LOCK_OK)
     {
-        size_t callbacks_length = VECTOR_size(iotHubClientInstance->saved_user_callback_list);
-        size_t index = 0;
-        for (index = 0; index < callbacks_length; index++)
+        LogError("Unable to aquire lock");
+    }
+    else
+    {
+        VECTOR_HANDLE batch;
+        size_t callbacks_length;
+
+        /*Codes_SRS_IOTHUBCLIENT_41_024: [ Dispatching shall take all the queued callbacks at once by swapping the queue with an empty one under the queue lock. ]*/
+        if (iotHubClientInstance->dispatching_user_callback_list == NULL)
+        {
+            /*another thread is still dispatching the previous batch, what is queued now goes with its next pass*/
+            batch = NULL;
+            callbacks_length = 0;
+        }
+        else if ((callbacks_length = VECTOR_size(iotHubClientInstance->saved_user_callback_list)) == 0)
         {
-            USER_CALLBACK_INFO* queued_cb = (USER_CALLBACK_INFO*)VECTOR_element(iotHubClientInstance->saved_user_callback_list, index);
-            if (queued_cb != NULL)
+            batch = NULL;
+        }
+        else
+        {
+            batch = iotHubClientInstance->saved_user_callback_list;
+            iotHubClientInstance->saved_user_callback_list = iotHubClientInstance->dispatching_user_callback_list;
+            iotHubClientInstance->dispatching_user_callback_list = NULL;
+        }
+        (void)Unlock(iotHubClientInstance->CallbackLock);
+
+        if (batch != NULL)
+        {
+            size_t index;
+
+            /*Codes_SRS_IOTHUBCLIENT_41_025: [ The callbacks of a batch shall be called in the order they were queued, without holding the serializing lock or the queue lock. ]*/
+            for (index = 0; index < callbacks_length; index++)
             {
-                switch (queued_cb->type)
+                USER_CALLBACK_INFO* queued_cb = (USER_CALLBACK_INFO*)VECTOR_element(batch, index);
+                if (queued_cb != NULL)
                 {
-                    case CALLBACK_TYPE_DEVICE_TWIN:
-                        if (iotHubClientInstance->desired_state_callback)
-                        {
-                            (void)Unlock(iotHubClientInstance->LockHandle);
-                            iotHubClientInstance->desired_state_callback(queued_cb->iothub_callback.dev_twin_cb_info.update_state, queued_cb->iothub_callback.dev_twin_cb_info.payLoad, queued_cb->iothub_callback.dev_twin_cb_info.size, queued_cb->userContextCallback);
-                            if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
-                            {
-                                LogError("Failed locking desired callback");
-                            }
-                        }
-                        if (queued_cb->iothub_callback.dev_twin_cb_info.payLoad)
-                        {
-                            free(queued_cb->iothub_callback.dev_twin_cb_info.payLoad);
-                        }
-                        break;
-                    case CALLBACK_TYPE_EVENT_CONFIRM:
-                        if (iotHubClientInstance->event_confirm_callback)
-                        {
-                            (void)Unlock(iotHubClientInstance->LockHandle);
-                            iotHubClientInstance->event_confirm_callback(queued_cb->iothub_callback.event_confirm_cb_info.confirm_result, queued_cb->userContextCallback);
-                            if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
-                            {
-                                LogError("Failed locking after event confirm callback");
-                            }
-                        }
-                        break;
-                    case CALLBACK_TYPE_REPORTED_STATE:
-                        if (iotHubClientInstance->reported_state_callback)
-                        {
-                            (void)Unlock(iotHubClientInstance->LockHandle);
-                            iotHubClientInstance->reported_state_callback(queued_cb->iothub_callback.reported_state_cb_info.status_code, queued_cb->userContextCallback);
-                            if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
-                            {
-                                LogError("Failed locking after reported state callback");
-                            }
-                        }
-                        break;
-                    case CALLBACK_TYPE_CONNECTION_STATUS:
-                        if (iotHubClientInstance->connection_status_callback)
-                        {
-                            (void)Unlock(iotHubClientInstance->LockHandle);
-                            iotHubClientInstance->connection_status_callback(queued_cb->iothub_callback.connection_status_cb_info.connection_status, queued_cb->iothub_callback.connection_status_cb_info.status_reason, queued_cb->userContextCallback);
-                            if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
-                            {
-                                LogError("Failed locking after connection status callback");
-                            }
-                        }
-                        break;
-                    case CALLBACK_TYPE_DEVICE_METHOD:
-                        if (iotHubClientInstance->device_method_callback)
-                        {
-                            (void)Unlock(iotHubClientInstance->LockHandle);
-                            const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
-                            const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
-                            size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
-                            iotHubClientInstance->device_method_callback(method_name, payload, payload_len, queued_cb->iothub_callback.method_cb_info.method_id, queued_cb->userContextCallback);
-                            if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
-                            {
-                                LogError("Failed locking after connection status callback");
-                            }
-                            BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
-                            STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
-                        }
-                        break;
-                    default:
-                        LogError("Invalid callback type '%s'", ENUM_TO_STRING(USER_CALLBACK_TYPE, queued_cb->type));
-                        break;
+                    dispatch_user_callback(queued_cb);
                 }
             }
+            VECTOR_clear(batch);
+
+            if (Lock(iotHubClientInstance->CallbackLock) != LOCK_OK)
+            {
+                LogError("Unable to aquire lock, giving the emptied batch back without it");
+                iotHubClientInstance->dispatching_user_callback_list = batch;
+            }
+            else
+            {
+                iotHubClientInstance->dispatching_user_callback_list = batch;
+                (void)Unlock(iotHubClientInstance->CallbackLock);
+            }
+        }
+    }
+}
+
+/*must be called with LockHandle taken*/
+static void signal_work_available(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    if (iotHubClientInstance->WorkCondition != NULL)
+    {
+        iotHubClientInstance->work_pending = 1;
+        if (Condition_Post(iotHubClientInstance->WorkCondition) != COND_OK)
+        {
+            LogError("unable to Condition_Post, work will be picked up at the next do work interval");
+        }
+    }
+    else if (iotHubClientInstance->WorkerPoolItem != NULL)
+    {
+        iotHubClientInstance->work_pending = 1;
+        IoTHubClient_WorkerPool_Signal(iotHubClientInstance->WorkerPoolItem);
+    }
+    else if (iotHubClientInstance->TransportHandle != NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_038: [ If the transport connection is shared, signalling work shall call IoTHubTransport_SignalWork. ]*/
+        IoTHubTransport_SignalWork(iotHubClientInstance->TransportHandle);
+    }
+}
+
+/*must be called with LockHandle taken, returns 0 when DoWork needs to be called again right away*/
+static tickcounter_ms_t get_time_to_wait(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    tickcounter_ms_t result;
+    if ((iotHubClientInstance->StopThread != 0) || (iotHubClientInstance->work_pending != 0))
+    {
+        result = 0;
+    }
+    else
+    {
+        IOTHUB_CLIENT_STATUS send_status;
+        tickcounter_ms_t time_to_next_timeout;
+        /*Codes_SRS_IOTHUBCLIENT_41_036: [ While IoTHubClient_LL_GetSendStatus reports items being sent, the thread shall wait for at most 1 ms so that their acknowledgements are picked up without delay. ]*/
+        if ((IoTHubClient_LL_GetSendStatus(iotHubClientInstance->IoTHubClientLLHandle, &send_status) != IOTHUB_CLIENT_OK) ||
+            (send_status == IOTHUB_CLIENT_SEND_STATUS_BUSY))
+        {
+            result = DO_WORK_BUSY_FREQ_MS;
+        }
+        else
+        {
+            /*idle: nothing but incoming traffic (which the transport only sees when polled) or a message timeout can need DoWork, so a longer wait delays incoming messages and connection handshakes*/
+            result = iotHubClientInstance->do_work_freq_ms;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_41_001: [ Between calls to IoTHubClient_LL_DoWork the thread shall wait on a condition for at most the configured do work frequency (1 ms by default), or until the next message timeout reported by IoTHubClient_LL_GetTimeToNextTimeout is due, whichever comes first. ]*/
+        if ((IoTHubClient_LL_GetTimeToNextTimeout(iotHubClientInstance->IoTHubClientLLHandle, &time_to_next_timeout) == 0) &&
+            (time_to_next_timeout < result))
+        {
+            result = time_to_next_timeout;
+        }
+    }
+    return result;
+}
+
+/*blocks the worker thread until new work is signalled, the do work interval elapses or the next message timeout is due - whichever comes first*/
+static void wait_for_work(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        (void)ThreadAPI_Sleep((unsigned int)iotHubClientInstance->do_work_freq_ms);
+    }
+    else
+    {
+        tickcounter_ms_t wait_ms = get_time_to_wait(iotHubClientInstance);
+
+        /*a timeout of 0 means "wait forever" for Condition_Wait, so an already due timeout skips the wait altogether*/
+        if (wait_ms > 0)
+        {
+            if (Condition_Wait(iotHubClientInstance->WorkCondition, iotHubClientInstance->LockHandle, (int)wait_ms) == COND_ERROR)
+            {
+                LogError("Condition_Wait failed");
+            }
         }
-        VECTOR_clear(iotHubClientInstance->saved_user_callback_list);
         (void)Unlock(iotHubClientInstance->LockHandle);
     }
+}
+
+/*runs one iteration of the worker loop, returns non-zero when the instance is being destroyed*/
+static int do_scheduled_work(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    int result = 0;
+    bool dispatch_callbacks = false;
+
+    if (Lock(iotHubClientInstance->LockHandle) == LOCK_OK)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_01_038: [ The thread shall exit when IoTHubClient_Destroy is called. ]*/
+        if (iotHubClientInstance->StopThread)
+        {
+            (void)Unlock(iotHubClientInstance->LockHandle);
+            result = __LINE__;
+        }
+        else
+        {
+            /* Codes_SRS_IOTHUBCLIENT_01_037: [The thread created by IoTHubClient_SendEvent or IoTHubClient_SetMessageCallback shall call IoTHubClient_LL_DoWork every 1 ms, unless a longer idle wait is configured with OPTION_DO_WORK_FREQUENCY_IN_MS.] */
+            /* Codes_SRS_IOTHUBCLIENT_01_039: [All calls to IoTHubClient_LL_DoWork shall be protected by the lock created in IotHubClient_Create.] */
+            /*anything signalled up to this point is picked up by this DoWork*/
+            iotHubClientInstance->work_pending = 0;
+            IoTHubClient_LL_DoWork(iotHubClientInstance->IoTHubClientLLHandle);
+
+#ifndef DONT_USE_UPLOADTOBLOB
+            garbageCollectorImpl(iotHubClientInstance);
+#endif
+            /*Codes_SRS_IOTHUBCLIENT_41_026: [ If callbacks are dispatched on their own thread, the worker thread shall not dispatch them. ]*/
+            dispatch_callbacks = (iotHubClientInstance->DispatchThreadHandle == NULL);
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
     else
     {
-        LogError("Unable to aquire lock");
+        /*Codes_SRS_IOTHUBCLIENT_01_040: [If acquiring the lock fails, IoTHubClient_LL_DoWork shall not be called.]*/
+        /*no code, shall retry*/
     }
+
+    if (dispatch_callbacks)
+    {
+        dispatch_user_callbacks(iotHubClientInstance);
+    }
+    return result;
 }
 
 static int ScheduleWork_Thread(void* threadArgument)
 {
     IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)threadArgument;
 
-    while (1)
+    while (do_scheduled_work(iotHubClientInstance) == 0)
     {
-        if (Lock(iotHubClientInstance->LockHandle) == LOCK_OK)
+        wait_for_work(iotHubClientInstance);
+    }
+
+    return 0;
+}
+
+static int DispatchCallbacks_Thread(void* threadArgument)
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)threadArgument;
+    int stop = 0;
+
+    while (stop == 0)
+    {
+        if (Lock(iotHubClientInstance->CallbackLock) != LOCK_OK)
         {
-            /*Codes_SRS_IOTHUBCLIENT_01_038: [ The thread shall exit when IoTHubClient_Destroy is called. ]*/
-            if (iotHubClientInstance->StopThread)
+            LogError("unable to Lock");
+            (void)ThreadAPI_Sleep((unsigned int)iotHubClientInstance->do_work_freq_ms);
+        }
+        else
+        {
+            /*a timeout of 0 means "wait forever" for Condition_Wait, queueing a callback or IoTHubClient_Destroy wakes the thread up*/
+            if ((iotHubClientInstance->StopDispatchThread == 0) &&
+                (VECTOR_size(iotHubClientInstance->saved_user_callback_list) == 0) &&
+                (Condition_Wait(iotHubClientInstance->DispatchCondition, iotHubClientInstance->CallbackLock, 0) == COND_ERROR))
             {
-                (void)Unlock(iotHubClientInstance->LockHandle);
-                break; /*gets out of the thread*/
+                LogError("Condition_Wait failed");
             }
-            else
-            {
-                /* Codes_SRS_IOTHUBCLIENT_01_037: [The thread created by IoTHubClient_SendEvent or IoTHubClient_SetMessageCallback shall call IoTHubClient_LL_DoWork every 1 ms.] */
-                /* Codes_SRS_IOTHUBCLIENT_01_039: [All calls to IoTHubClient_LL_DoWork shall be protected by the lock created in IotHubClient_Create.] */
-                IoTHubClient_LL_DoWork(iotHubClientInstance->IoTHubClientLLHandle);
+            stop = iotHubClientInstance->StopDispatchThread;
+            (void)Unlock(iotHubClientInstance->CallbackLock);
 
-#ifndef DONT_USE_UPLOADTOBLOB
-                garbageCollectorImpl(iotHubClientInstance);
-#endif
-                (void)Unlock(iotHubClientInstance->LockHandle);
+            if (stop == 0)
+            {
+                dispatch_user_callbacks(iotHubClientInstance);
             }
         }
+    }
+
+    return 0;
+}
+
+/*must be called with LockHandle taken*/
+static IOTHUB_CLIENT_RESULT StartDispatchThreadIfNeeded(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if (iotHubClientInstance->DispatchThreadHandle != NULL)
+    {
+        result = IOTHUB_CLIENT_OK;
+    }
+    else if ((iotHubClientInstance->DispatchCondition = Condition_Init()) == NULL)
+    {
+        LogError("unable to Condition_Init");
+        result = IOTHUB_CLIENT_ERROR;
+    }
+    else
+    {
+        iotHubClientInstance->StopDispatchThread = 0;
+        if (ThreadAPI_Create(&iotHubClientInstance->DispatchThreadHandle, DispatchCallbacks_Thread, iotHubClientInstance) != THREADAPI_OK)
+        {
+            LogError("unable to ThreadAPI_Create");
+            Condition_Deinit(iotHubClientInstance->DispatchCondition);
+            iotHubClientInstance->DispatchCondition = NULL;
+            iotHubClientInstance->DispatchThreadHandle = NULL;
+            result = IOTHUB_CLIENT_ERROR;
+        }
         else
         {
-            /*Codes_SRS_IOTHUBCLIENT_01_040: [If acquiring the lock fails, IoTHubClient_LL_DoWork shall not be called.]*/
-            /*no code, shall retry*/
+            result = IOTHUB_CLIENT_OK;
         }
-        dispatch_user_callbacks(iotHubClientInstance);
-        (void)ThreadAPI_Sleep(1);
     }
+    return result;
+}
 
-    return 0;
+/*called by a thread of the worker pool, never by two threads at the same time for the same instance*/
+static tickcounter_ms_t worker_pool_do_work(void* context)
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)context;
+    tickcounter_ms_t result;
+
+    /*Codes_SRS_IOTHUBCLIENT_41_007: [ Each time the worker pool runs the client it shall do the same work as one iteration of the worker thread and ask to be run again after the same time the worker thread would wait. ]*/
+    if (do_scheduled_work(iotHubClientInstance) != 0)
+    {
+        /*being destroyed, the item is removed from the pool by IoTHubClient_Destroy*/
+        result = iotHubClientInstance->do_work_freq_ms;
+    }
+    else if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = iotHubClientInstance->do_work_freq_ms;
+    }
+    else
+    {
+        result = get_time_to_wait(iotHubClientInstance);
+        (void)Unlock(iotHubClientInstance->LockHandle);
+    }
+    return result;
+}
+
+tickcounter_ms_t IoTHubClient_GetTimeToWait(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
+{
+    tickcounter_ms_t result;
+    if (iotHubClientHandle == NULL)
+    {
+        LogError("invalid arg");
+        result = DO_WORK_BUSY_FREQ_MS;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_037: [ IoTHubClient_GetTimeToWait shall return the time the worker thread of the client would wait before calling IoTHubClient_LL_DoWork again. ]*/
+        result = get_time_to_wait((IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle);
+    }
+    return result;
 }
 
 static IOTHUB_CLIENT_RESULT StartWorkerThreadIfNeeded(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
@@ -460,10 +787,39 @@ static IOTHUB_CLIENT_RESULT StartWorkerThreadIfNeeded(IOTHUB_CLIENT_INSTANCE* io
     IOTHUB_CLIENT_RESULT result;
     if (iotHubClientInstance->TransportHandle == NULL)
     {
-        if (iotHubClientInstance->ThreadHandle == NULL)
+        if (iotHubClientInstance->WorkerPool != NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_008: [ If a worker pool was set, the client shall be added to the worker pool instead of starting a thread. ]*/
+            if (iotHubClientInstance->WorkerPoolItem != NULL)
+            {
+                result = IOTHUB_CLIENT_OK;
+            }
+            else
+            {
+                iotHubClientInstance->StopThread = 0;
+                iotHubClientInstance->work_pending = 0;
+                if ((iotHubClientInstance->WorkerPoolItem = IoTHubClient_WorkerPool_Add(iotHubClientInstance->WorkerPool, worker_pool_do_work, iotHubClientInstance)) == NULL)
+                {
+                    LogError("unable to IoTHubClient_WorkerPool_Add");
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+                else
+                {
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+        }
+        else if (iotHubClientInstance->ThreadHandle == NULL)
         {
             iotHubClientInstance->StopThread = 0;
-            if (ThreadAPI_Create(&iotHubClientInstance->ThreadHandle, ScheduleWork_Thread, iotHubClientInstance) != THREADAPI_OK)
+            iotHubClientInstance->work_pending = 0;
+            if ((iotHubClientInstance->WorkCondition == NULL) &&
+                ((iotHubClientInstance->WorkCondition = Condition_Init()) == NULL))
+            {
+                LogError("unable to Condition_Init");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else if (ThreadAPI_Create(&iotHubClientInstance->ThreadHandle, ScheduleWork_Thread, iotHubClientInstance) != THREADAPI_OK)
             {
                 iotHubClientInstance->ThreadHandle = NULL;
                 result = IOTHUB_CLIENT_ERROR;
@@ -501,6 +857,22 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
             free(result);
             result = NULL;
         }
+        else if ((result->dispatching_user_callback_list = VECTOR_create(sizeof(USER_CALLBACK_INFO))) == NULL)
+        {
+            LogError("Failed creating VECTOR");
+            VECTOR_destroy(result->saved_user_callback_list);
+            free(result);
+            result = NULL;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_41_027: [ IoTHubClient_Create shall create the lock guarding the queued callbacks; if that fails it shall fail and return NULL. ]*/
+        else if ((result->CallbackLock = Lock_Init()) == NULL)
+        {
+            LogError("Failure creating Lock object");
+            VECTOR_destroy(result->dispatching_user_callback_list);
+            VECTOR_destroy(result->saved_user_callback_list);
+            free(result);
+            result = NULL;
+        }
         else
         {
 #ifndef DONT_USE_UPLOADTOBLOB
@@ -509,6 +881,8 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
             {
                 /*Codes_SRS_IOTHUBCLIENT_02_061: [ If creating the SINGLYLINKEDLIST_HANDLE fails then IoTHubClient_Create shall fail and return NULL. ]*/
                 LogError("unable to singlylinkedlist_create");
+                Lock_Deinit(result->CallbackLock);
+                VECTOR_destroy(result->dispatching_user_callback_list);
                 VECTOR_destroy(result->saved_user_callback_list);
                 free(result);
                 result = NULL;
@@ -612,6 +986,8 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                     singlylinkedlist_destroy(result->savedDataToBeCleaned);
 #endif
                     LogError("Failure creating iothub handle");
+                    Lock_Deinit(result->CallbackLock);
+                    VECTOR_destroy(result->dispatching_user_callback_list);
                     VECTOR_destroy(result->saved_user_callback_list);
                     free(result);
                     result = NULL;
@@ -619,12 +995,24 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                 else
                 {
                     result->ThreadHandle = NULL;
+                    result->WorkCondition = NULL;
+                    result->WorkerPool = NULL;
+                    result->WorkerPoolItem = NULL;
+                    result->StopThread = 0;
+                    result->DispatchThreadHandle = NULL;
+                    result->DispatchCondition = NULL;
+                    result->StopDispatchThread = 0;
+                    result->work_pending = 0;
+                    result->do_work_freq_ms = DO_WORK_FREQ_DEFAULT_MS;
                     result->desired_state_callback = NULL;
                     result->event_confirm_callback = NULL;
+                    result->event_confirm_batch_callback = NULL;
+                    result->event_confirm_batch_user_context = NULL;
                     result->reported_state_callback = NULL;
                     result->devicetwin_user_context = NULL;
                     result->connection_status_callback = NULL;
                     result->connection_status_user_context = NULL;
+                    result->device_method_callback = NULL;
                 }
             }
         }
@@ -697,6 +1085,30 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
 
         IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
 
+        if (iotHubClientInstance->DispatchThreadHandle != NULL)
+        {
+            int res;
+
+            /*Codes_SRS_IOTHUBCLIENT_41_028: [ IoTHubClient_Destroy shall stop and join the thread dispatching callbacks (if any) before taking the serializing lock. ]*/
+            if (Lock(iotHubClientInstance->CallbackLock) != LOCK_OK)
+            {
+                LogError("unable to Lock - - will still proceed to try to end the dispatch thread without locking");
+                iotHubClientInstance->StopDispatchThread = 1;
+                (void)Condition_Post(iotHubClientInstance->DispatchCondition);
+            }
+            else
+            {
+                iotHubClientInstance->StopDispatchThread = 1;
+                (void)Condition_Post(iotHubClientInstance->DispatchCondition);
+                (void)Unlock(iotHubClientInstance->CallbackLock);
+            }
+
+            if (ThreadAPI_Join(iotHubClientInstance->DispatchThreadHandle, &res) != THREADAPI_OK)
+            {
+                LogError("ThreadAPI_Join failed");
+            }
+        }
+
         /*Codes_SRS_IOTHUBCLIENT_02_043: [ IoTHubClient_Destroy shall lock the serializing lock and signal the worker thread (if any) to end ]*/
         if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
         {
@@ -711,9 +1123,10 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
             garbageCollectorImpl(iotHubClientInstance);
         }
 #endif
-        if (iotHubClientInstance->ThreadHandle != NULL)
+        if ((iotHubClientInstance->ThreadHandle != NULL) || (iotHubClientInstance->WorkerPoolItem != NULL))
         {
             iotHubClientInstance->StopThread = 1;
+            signal_work_available(iotHubClientInstance);
             okToJoin = true;
         }
         else
@@ -755,6 +1168,12 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
                 }
             }
 
+            if (iotHubClientInstance->WorkerPoolItem != NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_41_009: [ If the client was added to a worker pool, IoTHubClient_Destroy shall remove it from the pool after unlocking the serializing lock. ]*/
+                IoTHubClient_WorkerPool_Remove(iotHubClientInstance->WorkerPoolItem);
+            }
+
             if (iotHubClientInstance->TransportHandle != NULL)
             {
                 /*Codes_SRS_IOTHUBCLIENT_01_007: [ The thread created as part of executing IoTHubClient_SendEventAsync or IoTHubClient_SetNotificationMessageCallback shall be joined. ]*/
@@ -762,6 +1181,7 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
             }
         }
 
+        /*all the threads are gone, so the spare list is back and only the queued list can hold callbacks*/
         vector_size = VECTOR_size(iotHubClientInstance->saved_user_callback_list);
         size_t index = 0;
         for (index = 0; index < vector_size; index++)
@@ -781,9 +1201,25 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
                         free(queue_cb_info->iothub_callback.dev_twin_cb_info.payLoad);
                     }
                 }
+                else if (queue_cb_info->type == CALLBACK_TYPE_EVENT_CONFIRM_BATCH)
+                {
+                    free(queue_cb_info->iothub_callback.event_confirm_batch_cb_info.confirmations);
+                }
             }
         }
         VECTOR_destroy(iotHubClientInstance->saved_user_callback_list);
+        VECTOR_destroy(iotHubClientInstance->dispatching_user_callback_list);
+        Lock_Deinit(iotHubClientInstance->CallbackLock);
+
+        if (iotHubClientInstance->WorkCondition != NULL)
+        {
+            Condition_Deinit(iotHubClientInstance->WorkCondition);
+        }
+
+        if (iotHubClientInstance->DispatchCondition != NULL)
+        {
+            Condition_Deinit(iotHubClientInstance->DispatchCondition);
+        }
 
         if (iotHubClientInstance->TransportHandle == NULL)
         {
@@ -802,7 +1238,22 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
     }
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+static IOTHUB_CLIENT_RESULT ll_send_event_async(IOTHUB_CLIENT_LL_HANDLE iotHubClientLLHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if (takeOwnership)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_015: [ IoTHubClient_SendEventAsync_TakeOwnership shall call IoTHubClient_LL_SendEventAsync_TakeOwnership instead of IoTHubClient_LL_SendEventAsync. ]*/
+        result = IoTHubClient_LL_SendEventAsync_TakeOwnership(iotHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback);
+    }
+    else
+    {
+        result = IoTHubClient_LL_SendEventAsync(iotHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback);
+    }
+    return result;
+}
+
+static IOTHUB_CLIENT_RESULT send_event_async(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
 {
     IOTHUB_CLIENT_RESULT result;
 
@@ -840,7 +1291,7 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClie
             {
                 if (iotHubClientInstance->created_with_transport_handle != 0 || eventConfirmationCallback == NULL)
                 {
-                    result = IoTHubClient_LL_SendEventAsync(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback);
+                    result = ll_send_event_async(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, takeOwnership);
                 }
                 else
                 {
@@ -857,7 +1308,7 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClie
                         queue_context->userContextCallback = userContextCallback;
                         /* Codes_SRS_IOTHUBCLIENT_01_012: [IoTHubClient_SendEventAsync shall call IoTHubClient_LL_SendEventAsync, while passing the IoTHubClient_LL handle created by IoTHubClient_Create and the parameters eventMessageHandle, eventConfirmationCallback and userContextCallback.] */
                         /* Codes_SRS_IOTHUBCLIENT_01_013: [When IoTHubClient_LL_SendEventAsync is called, IoTHubClient_SendEventAsync shall return the result of IoTHubClient_LL_SendEventAsync.] */
-                        result = IoTHubClient_LL_SendEventAsync(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, iothub_ll_event_confirm_callback, queue_context);
+                        result = ll_send_event_async(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, iothub_ll_event_confirm_callback, queue_context, takeOwnership);
                         if (result != IOTHUB_CLIENT_OK)
                         {
                             LogError("IoTHubClient_LL_SendEventAsync failed");
@@ -865,6 +1316,11 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClie
                         }
                     }
                 }
+
+                if (result == IOTHUB_CLIENT_OK)
+                {
+                    signal_work_available(iotHubClientInstance);
+                }
             }
 
             /* Codes_SRS_IOTHUBCLIENT_01_025: [IoTHubClient_SendEventAsync shall be made thread-safe by using the lock created in IoTHubClient_Create.] */
@@ -875,6 +1331,17 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClie
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, false);
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync_TakeOwnership(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    /*Codes_SRS_IOTHUBCLIENT_41_014: [ IoTHubClient_SendEventAsync_TakeOwnership shall behave like IoTHubClient_SendEventAsync. ]*/
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, true);
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_GetSendStatus(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATUS *iotHubClientStatus)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1149,6 +1616,155 @@ IOTHUB_CLIENT_RESULT IoTHubClient_GetLastMessageReceiveTime(IOTHUB_CLIENT_HANDLE
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_GetMessagePoolStatistics(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS* statistics)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_016: [ If iotHubClientHandle is NULL, IoTHubClient_GetMessagePoolStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL iothubClientHandle");
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_41_017: [ IoTHubClient_GetMessagePoolStatistics shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_018: [ IoTHubClient_GetMessagePoolStatistics shall call IoTHubClient_LL_GetMessagePoolStatistics and return its result. ]*/
+            result = IoTHubClient_LL_GetMessagePoolStatistics(iotHubClientInstance->IoTHubClientLLHandle, statistics);
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_GetSendQueueStatus(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_SEND_QUEUE_STATUS* status)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_019: [ If iotHubClientHandle is NULL, IoTHubClient_GetSendQueueStatus shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL iothubClientHandle");
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_41_020: [ IoTHubClient_GetSendQueueStatus shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_021: [ IoTHubClient_GetSendQueueStatus shall call IoTHubClient_LL_GetSendQueueStatus and return its result. ]*/
+            result = IoTHubClient_LL_GetSendQueueStatus(iotHubClientInstance->IoTHubClientLLHandle, status);
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_SetEventConfirmationBatchCallback(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK batchCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_41_031: [ If iotHubClientHandle is NULL, IoTHubClient_SetEventConfirmationBatchCallback shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL iothubClientHandle");
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_41_032: [ IoTHubClient_SetEventConfirmationBatchCallback shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else if ((iotHubClientInstance->created_with_transport_handle != 0) || (batchCallback == NULL))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_033: [ If the transport is shared or batchCallback is NULL, IoTHubClient_SetEventConfirmationBatchCallback shall call IoTHubClient_LL_SetEventConfirmationBatchCallback with batchCallback and userContextCallback and return its result. ]*/
+            result = IoTHubClient_LL_SetEventConfirmationBatchCallback(iotHubClientInstance->IoTHubClientLLHandle, batchCallback, userContextCallback);
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_034: [ Otherwise IoTHubClient_SetEventConfirmationBatchCallback shall call IoTHubClient_LL_SetEventConfirmationBatchCallback with its own batch callback, which queues every batch to be dispatched to batchCallback like the other user callbacks, and return its result. ]*/
+            /*batches already queued keep the callback that was set when they were reported*/
+            result = IoTHubClient_LL_SetEventConfirmationBatchCallback(iotHubClientInstance->IoTHubClientLLHandle, iothub_ll_event_confirm_batch_callback, iotHubClientInstance);
+            if (result == IOTHUB_CLIENT_OK)
+            {
+                iotHubClientInstance->event_confirm_batch_callback = batchCallback;
+                iotHubClientInstance->event_confirm_batch_user_context = userContextCallback;
+            }
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_SetWorkerPool(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_41_010: [ If iotHubClientHandle or workerPool is NULL, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if ((iotHubClientHandle == NULL) || (workerPool == NULL))
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("invalid arg IOTHUB_CLIENT_HANDLE iotHubClientHandle=%p, IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool=%p", iotHubClientHandle, workerPool);
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        if (iotHubClientInstance->TransportHandle != NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_41_011: [ If the client was created with IoTHubClient_CreateWithTransport, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]*/
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("the client uses a shared transport, use IoTHubTransport_SetWorkerPool instead");
+        }
+        else if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else
+        {
+            if ((iotHubClientInstance->ThreadHandle != NULL) || (iotHubClientInstance->WorkerPoolItem != NULL))
+            {
+                /*Codes_SRS_IOTHUBCLIENT_41_012: [ If the worker thread was already started, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]*/
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("the worker thread of the client has already been started");
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_41_013: [ Otherwise IoTHubClient_SetWorkerPool shall remember workerPool, to be used when the worker thread would have been started, and return IOTHUB_CLIENT_OK. ]*/
+                iotHubClientInstance->WorkerPool = workerPool;
+                result = IOTHUB_CLIENT_OK;
+            }
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_SetOption(IOTHUB_CLIENT_HANDLE iotHubClientHandle, const char* optionName, const void* value)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1177,11 +1793,46 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SetOption(IOTHUB_CLIENT_HANDLE iotHubClientHan
         }
         else
         {
-            /*Codes_SRS_IOTHUBCLIENT_02_038: [If optionName doesn't match one of the options handled by this module then IoTHubClient_SetOption shall call IoTHubClient_LL_SetOption passing the same parameters and return what IoTHubClient_LL_SetOption returns.] */
-            result = IoTHubClient_LL_SetOption(iotHubClientInstance->IoTHubClientLLHandle, optionName, value);
-            if (result != IOTHUB_CLIENT_OK)
+            if (strcmp(OPTION_DO_WORK_FREQUENCY_IN_MS, optionName) == 0)
             {
-                LogError("IoTHubClient_LL_SetOption failed");
+                tickcounter_ms_t do_work_freq_ms = *(const tickcounter_ms_t*)value;
+                if ((do_work_freq_ms == 0) || (do_work_freq_ms > DO_WORK_MAXIMUM_ALLOWED_FREQUENCY_MS))
+                {
+                    result = IOTHUB_CLIENT_INVALID_ARG;
+                    LogError("%s must be between 1 and %d ms", OPTION_DO_WORK_FREQUENCY_IN_MS, DO_WORK_MAXIMUM_ALLOWED_FREQUENCY_MS);
+                }
+                else
+                {
+                    iotHubClientInstance->do_work_freq_ms = do_work_freq_ms;
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+            else if (strcmp(OPTION_DISPATCH_CALLBACKS_ON_THREAD, optionName) == 0)
+            {
+                if (*(const bool*)value)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_41_029: [ If optionName is OPTION_DISPATCH_CALLBACKS_ON_THREAD and value is true, IoTHubClient_SetOption shall start a thread dispatching the user callbacks, unless it runs already. ]*/
+                    result = StartDispatchThreadIfNeeded(iotHubClientInstance);
+                }
+                else if (iotHubClientInstance->DispatchThreadHandle != NULL)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_41_030: [ If value is false and the dispatch thread runs already, IoTHubClient_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+                    LogError("%s cannot be turned off once the dispatch thread runs", OPTION_DISPATCH_CALLBACKS_ON_THREAD);
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+                else
+                {
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_02_038: [If optionName doesn't match one of the options handled by this module then IoTHubClient_SetOption shall call IoTHubClient_LL_SetOption passing the same parameters and return what IoTHubClient_LL_SetOption returns.] */
+                result = IoTHubClient_LL_SetOption(iotHubClientInstance->IoTHubClientLLHandle, optionName, value);
+                if (result != IOTHUB_CLIENT_OK)
+                {
+                    LogError("IoTHubClient_LL_SetOption failed");
+                }
             }
 
             (void)Unlock(iotHubClientInstance->LockHandle);
@@ -1330,6 +1981,11 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendReportedState(IOTHUB_CLIENT_HANDLE iotHubC
                         }
                     }
                 }
+
+                if (result == IOTHUB_CLIENT_OK)
+                {
+                    signal_work_available(iotHubClientInstance);
+                }
             }
             (void)Unlock(iotHubClientInstance->LockHandle);
         }
@@ -1483,6 +2139,10 @@ IOTHUB_CLIENT_RESULT IoTHubClient_DeviceMethodResponse(IOTHUB_CLIENT_HANDLE iotH
             {
                 LogError("IoTHubClient_LL_DeviceMethodResponse failed");
             }
+            else
+            {
+                signal_work_available(iotHubClientInstance);
+            }
             (void)Unlock(iotHubClientInstance->LockHandle);
         }
     }
@@ -0,0 +1,424 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_base64.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BASE64_NEON
+/*NEON is part of every AArch64 processor*/
+#define BASE64_HAS_VECTOR() 1
+#define BASE64_VECTOR_FUNCTION static
+#elif (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && \
+    (defined(__SSSE3__) || defined(__AVX__) || defined(_MSC_VER) || defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#include <tmmintrin.h>
+#define BASE64_SSSE3
+#if defined(__SSSE3__) || defined(__AVX__)
+/*the whole build targets SSSE3*/
+#define BASE64_HAS_VECTOR() 1
+#define BASE64_VECTOR_FUNCTION static
+#else
+/*the SSSE3 functions are compiled for SSSE3 alone (MSVC needs no switch for that) and only called when the processor has it*/
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define BASE64_VECTOR_FUNCTION __attribute__((target("ssse3"))) static
+#else
+#define BASE64_VECTOR_FUNCTION static
+#endif
+#define BASE64_HAS_VECTOR() hasSsse3()
+#define BASE64_CPUID_SSSE3 (1 << 9)
+
+/*0 until the processor was asked, then 1 when it has SSSE3 and 2 when it does not - concurrent first calls all store the same value*/
+static volatile int ssse3Support = 0;
+
+static int hasSsse3(void)
+{
+    if (ssse3Support == 0)
+    {
+#if defined(_MSC_VER)
+        int registers[4];
+        __cpuid(registers, 1);
+        ssse3Support = ((registers[2] & BASE64_CPUID_SSSE3) != 0) ? 1 : 2;
+#else
+        unsigned int eax, ebx, ecx, edx;
+        ssse3Support = ((__get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0) && ((ecx & BASE64_CPUID_SSSE3) != 0)) ? 1 : 2;
+#endif
+    }
+    return (ssse3Support == 1);
+}
+#endif
+#endif
+
+#define BASE64_PAD '='
+#define BASE64_INVALID 0xFF
+
+static const char base64StandardAlphabet[64] =
+{
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
+};
+
+static const char base64UrlAlphabet[64] =
+{
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-', '_'
+};
+
+/*value of every 7 bit character in the alphabet, BASE64_INVALID for the characters that are not part of it*/
+static const unsigned char base64StandardValues[128] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static const unsigned char base64UrlValues[128] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+#if defined(BASE64_SSSE3)
+/*encodes 12 bytes into 16 characters for as long as 16 bytes can be read from source, returns the number of bytes consumed*/
+/*the 6 bit indexes are unpacked with 2 multiplications and turned into characters by adding an offset picked with a byte shuffle*/
+BASE64_VECTOR_FUNCTION size_t encodeVector(char* destination, const unsigned char* source, size_t size, BASE64_ALPHABET alphabet)
+{
+    const __m128i shuffleInput = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        (char)(((alphabet == BASE64_ALPHABET_URL) ? '-' : '+') - 62),
+        (char)(((alphabet == BASE64_ALPHABET_URL) ? '_' : '/') - 63),
+        'A', 0, 0);
+    size_t consumed = 0;
+
+    while (size - consumed >= 16)
+    {
+        __m128i input = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source + consumed)), shuffleInput);
+        __m128i indexes = _mm_or_si128(
+            _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040)),
+            _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010)));
+        /*0..25 select offset 13 ('A'), 26..51 select offset 0, 52..61 select 1..10, 62 selects 11 and 63 selects 12*/
+        __m128i offsetIndexes = _mm_or_si128(
+            _mm_subs_epu8(indexes, _mm_set1_epi8(51)),
+            _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+        _mm_storeu_si128((__m128i*)destination, _mm_add_epi8(indexes, _mm_shuffle_epi8(offsets, offsetIndexes)));
+        destination += 16;
+        consumed += 12;
+    }
+    return consumed;
+}
+
+/*true for the bytes of v between low and high, all the characters of the alphabets are below 0x80 so signed compares will do*/
+#define BASE64_IN_RANGE(v, low, high) _mm_and_si128(_mm_cmpgt_epi8((v), _mm_set1_epi8((char)((low) - 1))), _mm_cmplt_epi8((v), _mm_set1_epi8((char)((high) + 1))))
+
+/*decodes 16 characters into 12 bytes at a time, returns the number of characters consumed - it stops before 16 characters that are not all part of the alphabet*/
+/*the characters are classified with compares, turned into their values by adding the offset of their class and packed with 2 multiplications*/
+BASE64_VECTOR_FUNCTION size_t decodeVector(unsigned char* destination, const char* source, size_t length, BASE64_ALPHABET alphabet)
+{
+    const char char62 = (alphabet == BASE64_ALPHABET_URL) ? '-' : '+';
+    const char char63 = (alphabet == BASE64_ALPHABET_URL) ? '_' : '/';
+    const __m128i packOutput = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t consumed = 0;
+
+    while (length - consumed >= 16)
+    {
+        __m128i input = _mm_loadu_si128((const __m128i*)(source + consumed));
+        __m128i upper = BASE64_IN_RANGE(input, 'A', 'Z');
+        __m128i lower = BASE64_IN_RANGE(input, 'a', 'z');
+        __m128i digit = BASE64_IN_RANGE(input, '0', '9');
+        __m128i is62 = _mm_cmpeq_epi8(input, _mm_set1_epi8(char62));
+        __m128i is63 = _mm_cmpeq_epi8(input, _mm_set1_epi8(char63));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, is62)), is63)) != 0xFFFF)
+        {
+            break;
+        }
+        else
+        {
+            __m128i offsets = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                    _mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8((char)(62 - char62))), _mm_and_si128(is63, _mm_set1_epi8((char)(63 - char63))))));
+            /*values a, b, c, d become the 12 bit pairs ab and cd, which become the 24 bit abcd, stored big endian*/
+            __m128i pairs = _mm_maddubs_epi16(_mm_add_epi8(input, offsets), _mm_set1_epi32(0x01400140));
+            __m128i output = _mm_shuffle_epi8(_mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000)), packOutput);
+            int last4 = _mm_cvtsi128_si32(_mm_srli_si128(output, 8));
+            _mm_storel_epi64((__m128i*)destination, output);
+            (void)memcpy(destination + 8, &last4, 4);
+            destination += 12;
+            consumed += 16;
+        }
+    }
+    return consumed;
+}
+#elif defined(BASE64_NEON)
+/*encodes 48 bytes into 64 characters at a time, the 64 characters alphabet is looked up with a single table instruction*/
+static size_t encodeVector(char* destination, const unsigned char* source, size_t size, BASE64_ALPHABET alphabet)
+{
+    const unsigned char* characters = (const unsigned char*)((alphabet == BASE64_ALPHABET_URL) ? base64UrlAlphabet : base64StandardAlphabet);
+    uint8x16x4_t table;
+    size_t consumed = 0;
+
+    table.val[0] = vld1q_u8(characters);
+    table.val[1] = vld1q_u8(characters + 16);
+    table.val[2] = vld1q_u8(characters + 32);
+    table.val[3] = vld1q_u8(characters + 48);
+
+    while (size - consumed >= 48)
+    {
+        uint8x16x3_t input = vld3q_u8(source + consumed);
+        uint8x16x4_t output;
+        output.val[0] = vqtbl4q_u8(table, vshrq_n_u8(input.val[0], 2));
+        output.val[1] = vqtbl4q_u8(table, vorrq_u8(vshlq_n_u8(vandq_u8(input.val[0], vdupq_n_u8(0x03)), 4), vshrq_n_u8(input.val[1], 4)));
+        output.val[2] = vqtbl4q_u8(table, vorrq_u8(vshlq_n_u8(vandq_u8(input.val[1], vdupq_n_u8(0x0F)), 2), vshrq_n_u8(input.val[2], 6)));
+        output.val[3] = vqtbl4q_u8(table, vandq_u8(input.val[2], vdupq_n_u8(0x3F)));
+        vst4q_u8((unsigned char*)destination, output);
+        destination += 64;
+        consumed += 48;
+    }
+    return consumed;
+}
+
+/*decodes 64 characters into 48 bytes at a time, returns the number of characters consumed - it stops before 64 characters that are not all part of the alphabet*/
+/*the values of the 128 ASCII characters are looked up with 2 table instructions, the characters above 0x7F are made invalid with their sign bit*/
+static size_t decodeVector(unsigned char* destination, const char* source, size_t length, BASE64_ALPHABET alphabet)
+{
+    const unsigned char* values = (alphabet == BASE64_ALPHABET_URL) ? base64UrlValues : base64StandardValues;
+    uint8x16x4_t lowValues;
+    uint8x16x4_t highValues;
+    size_t consumed = 0;
+
+    lowValues.val[0] = vld1q_u8(values);
+    lowValues.val[1] = vld1q_u8(values + 16);
+    lowValues.val[2] = vld1q_u8(values + 32);
+    lowValues.val[3] = vld1q_u8(values + 48);
+    highValues.val[0] = vld1q_u8(values + 64);
+    highValues.val[1] = vld1q_u8(values + 80);
+    highValues.val[2] = vld1q_u8(values + 96);
+    highValues.val[3] = vld1q_u8(values + 112);
+
+    while (length - consumed >= 64)
+    {
+        uint8x16x4_t input = vld4q_u8((const unsigned char*)(source + consumed));
+        uint8x16x4_t decoded;
+        uint8x16x3_t output;
+        int i;
+
+        for (i = 0; i < 4; i++)
+        {
+            /*characters 0x00..0x3F are found in lowValues, 0x40..0x7F (flipped to 0x00..0x3F) in highValues, everything else keeps 0 and gets 0xFF from its sign*/
+            decoded.val[i] = vorrq_u8(
+                vqtbx4q_u8(vqtbl4q_u8(lowValues, input.val[i]), highValues, veorq_u8(input.val[i], vdupq_n_u8(0x40))),
+                vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(input.val[i]), 7)));
+        }
+        if (vmaxvq_u8(vorrq_u8(vorrq_u8(decoded.val[0], decoded.val[1]), vorrq_u8(decoded.val[2], decoded.val[3]))) > 0x3F)
+        {
+            break;
+        }
+        output.val[0] = vorrq_u8(vshlq_n_u8(decoded.val[0], 2), vshrq_n_u8(decoded.val[1], 4));
+        output.val[1] = vorrq_u8(vshlq_n_u8(decoded.val[1], 4), vshrq_n_u8(decoded.val[2], 2));
+        output.val[2] = vorrq_u8(vshlq_n_u8(decoded.val[2], 6), decoded.val[3]);
+        vst3q_u8(destination, output);
+        destination += 48;
+        consumed += 64;
+    }
+    return consumed;
+}
+#endif
+
+size_t IoTHubClient_Base64_GetEncodedLength(size_t size)
+{
+    /*Codes_SRS_IOTHUBCLIENT_BASE64_41_001: [ IoTHubClient_Base64_GetEncodedLength shall return 4 characters for every started group of 3 bytes. ]*/
+    return ((size + 2) / 3) * 4;
+}
+
+int IoTHubClient_Base64_Encode(char* destination, const unsigned char* source, size_t size, BASE64_ALPHABET alphabet)
+{
+    int result;
+    if ((destination == NULL) || ((source == NULL) && (size > 0)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_BASE64_41_002: [ If destination is NULL, or source is NULL while size is not 0, IoTHubClient_Base64_Encode shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments destination=%p, source=%p, size=%zu", destination, source, size);
+        result = __LINE__;
+    }
+    else
+    {
+        const char* characters = (alphabet == BASE64_ALPHABET_URL) ? base64UrlAlphabet : base64StandardAlphabet;
+        size_t i = 0;
+
+        /*Codes_SRS_IOTHUBCLIENT_BASE64_41_003: [ IoTHubClient_Base64_Encode shall write the IoTHubClient_Base64_GetEncodedLength(size) characters of the padded encoding of source at destination, without a terminating '\0'. ]*/
+#if defined(BASE64_SSSE3) || defined(BASE64_NEON)
+        /*Codes_SRS_IOTHUBCLIENT_BASE64_41_004: [ When the processor offers vector instructions, IoTHubClient_Base64_Encode shall encode the bulk of source with them. ]*/
+        if (BASE64_HAS_VECTOR())
+        {
+            i = encodeVector(destination, source, size, alphabet);
+            destination += (i / 3) * 4;
+        }
+#endif
+        for (; size - i >= 3; i += 3)
+        {
+            uint32_t triple = ((uint32_t)source[i] << 16) | ((uint32_t)source[i + 1] << 8) | source[i + 2];
+            destination[0] = characters[(triple >> 18) & 0x3F];
+            destination[1] = characters[(triple >> 12) & 0x3F];
+            destination[2] = characters[(triple >> 6) & 0x3F];
+            destination[3] = characters[triple & 0x3F];
+            destination += 4;
+        }
+
+        if (size - i == 2)
+        {
+            destination[0] = characters[source[i] >> 2];
+            destination[1] = characters[((source[i] & 0x03) << 4) | (source[i + 1] >> 4)];
+            destination[2] = characters[(source[i + 1] & 0x0F) << 2];
+            destination[3] = BASE64_PAD;
+        }
+        else if (size - i == 1)
+        {
+            destination[0] = characters[source[i] >> 2];
+            destination[1] = characters[(source[i] & 0x03) << 4];
+            destination[2] = BASE64_PAD;
+            destination[3] = BASE64_PAD;
+        }
+        result = 0;
+    }
+    return result;
+}
+
+size_t IoTHubClient_Base64_GetDecodedMaxLength(size_t length)
+{
+    /*Codes_SRS_IOTHUBCLIENT_BASE64_41_005: [ IoTHubClient_Base64_GetDecodedMaxLength shall return 3 bytes for every started group of 4 characters. ]*/
+    return ((length + 3) / 4) * 3;
+}
+
+/*returns the value of a character, BASE64_INVALID if the character is not part of the alphabet*/
+static unsigned char valueOf(const unsigned char* values, char c)
+{
+    return (((unsigned char)c) < 128) ? values[(unsigned char)c] : BASE64_INVALID;
+}
+
+int IoTHubClient_Base64_Decode(unsigned char* destination, const char* source, size_t length, BASE64_ALPHABET alphabet, size_t* decodedSize)
+{
+    int result;
+    if ((destination == NULL) || (decodedSize == NULL) || ((source == NULL) && (length > 0)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_BASE64_41_006: [ If destination or decodedSize is NULL, or source is NULL while length is not 0, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments destination=%p, source=%p, length=%zu, decodedSize=%p", destination, source, length, decodedSize);
+        result = __LINE__;
+    }
+    else
+    {
+        const unsigned char* values = (alphabet == BASE64_ALPHABET_URL) ? base64UrlValues : base64StandardValues;
+        unsigned char* start = destination;
+        size_t dataLength = length;
+        size_t i;
+
+        /*the padding of the last group is optional*/
+        if ((dataLength % 4 == 0) && (dataLength > 0) && (source[dataLength - 1] == BASE64_PAD))
+        {
+            dataLength -= (source[dataLength - 2] == BASE64_PAD) ? 2 : 1;
+        }
+
+        result = 0;
+        i = 0;
+#if defined(BASE64_SSSE3) || defined(BASE64_NEON)
+        /*Codes_SRS_IOTHUBCLIENT_BASE64_41_011: [ When the processor offers vector instructions, IoTHubClient_Base64_Decode shall decode the bulk of source with them. ]*/
+        if (BASE64_HAS_VECTOR())
+        {
+            i = decodeVector(destination, source, dataLength, alphabet);
+            destination += (i / 4) * 3;
+        }
+#endif
+        for (; (result == 0) && (dataLength - i >= 4); i += 4)
+        {
+            unsigned char v0 = valueOf(values, source[i]);
+            unsigned char v1 = valueOf(values, source[i + 1]);
+            unsigned char v2 = valueOf(values, source[i + 2]);
+            unsigned char v3 = valueOf(values, source[i + 3]);
+            if ((v0 | v1 | v2 | v3) == BASE64_INVALID)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                destination[0] = (unsigned char)((v0 << 2) | (v1 >> 4));
+                destination[1] = (unsigned char)((v1 << 4) | (v2 >> 2));
+                destination[2] = (unsigned char)((v2 << 6) | v3);
+                destination += 3;
+            }
+        }
+
+        if (result != 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_BASE64_41_007: [ If source contains a character that is not part of the alphabet (other than the padding of the last group), IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+            LogError("invalid base64 character");
+        }
+        else if (dataLength - i == 3)
+        {
+            unsigned char v0 = valueOf(values, source[i]);
+            unsigned char v1 = valueOf(values, source[i + 1]);
+            unsigned char v2 = valueOf(values, source[i + 2]);
+            /*Codes_SRS_IOTHUBCLIENT_BASE64_41_008: [ If the bits of the last group that do not make a whole byte are not zero, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+            if (((v0 | v1 | v2) == BASE64_INVALID) || ((v2 & 0x03) != 0))
+            {
+                LogError("invalid base64 ending");
+                result = __LINE__;
+            }
+            else
+            {
+                destination[0] = (unsigned char)((v0 << 2) | (v1 >> 4));
+                destination[1] = (unsigned char)((v1 << 4) | (v2 >> 2));
+                destination += 2;
+            }
+        }
+        else if (dataLength - i == 2)
+        {
+            unsigned char v0 = valueOf(values, source[i]);
+            unsigned char v1 = valueOf(values, source[i + 1]);
+            if (((v0 | v1) == BASE64_INVALID) || ((v1 & 0x0F) != 0))
+            {
+                LogError("invalid base64 ending");
+                result = __LINE__;
+            }
+            else
+            {
+                destination[0] = (unsigned char)((v0 << 2) | (v1 >> 4));
+                destination += 1;
+            }
+        }
+        else if (dataLength - i == 1)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_BASE64_41_009: [ If the last group has a single character, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+            LogError("invalid base64 length");
+            result = __LINE__;
+        }
+
+        if (result == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_BASE64_41_010: [ Otherwise IoTHubClient_Base64_Decode shall write the decoded bytes at destination, set decodedSize to their number and return 0. ]*/
+            *decodedSize = (size_t)(destination - start);
+        }
+    }
+    return result;
+}
@@ -12,6 +12,9 @@
 
 #include "iothub_client_ll.h"
 #include "iothub_client_private.h"
+#include "iothub_client_options.h"
+#include "iothub_client_record_pool.h"
+#include "iothub_client_persistent_queue.h"
 #include "iothub_client_version.h"
 #include "iothub_transport_ll.h"
 #include <stdint.h>
@@ -22,6 +25,12 @@
 
 #define LOG_ERROR_RESULT LogError("result = %s", ENUM_TO_STRING(IOTHUB_CLIENT_RESULT, result));
 #define INDEFINITE_TIME ((time_t)(-1))
+#define NO_TIMEOUT_ORDER_KEY ((tickcounter_ms_t)(-1))
+#define DEFAULT_PERSISTENT_QUEUE_SEGMENT_SIZE (1024 * 1024)
+#define DEFAULT_PERSISTENT_QUEUE_SYNC_COUNT 16
+#define PERSISTENT_QUEUE_FLUSH_PERIOD_MS 100
+#define DEFAULT_PERSISTENT_QUEUE_REPLAY_WINDOW 16
+#define EVENT_CONFIRMATION_BATCH_SIZE 32
 
 DEFINE_ENUM_STRINGS(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_RESULT_VALUES);
 DEFINE_ENUM_STRINGS(IOTHUB_CLIENT_CONFIRMATION_RESULT, IOTHUB_CLIENT_CONFIRMATION_RESULT_VALUES);
@@ -29,6 +38,23 @@ DEFINE_ENUM_STRINGS(IOTHUB_CLIENT_CONFIRMATION_RESULT, IOTHUB_CLIENT_CONFIRMATIO
 typedef struct IOTHUB_CLIENT_LL_HANDLE_DATA_TAG
 {
     DLIST_ENTRY waitingToSend;
+    uint64_t waitingToSendLastSeenTail; /*sequence number of the tail of waitingToSend (0 when empty) - the transport moves messages out of (and back into) waitingToSend on its own, a different tail means the list changed behind our back*/
+    uint64_t lastSequenceNumber; /*given to the last message added to waitingToSend, records are reused so their address does not identify them*/
+    bool waitingToSendInTimeoutOrder; /*true when the messages in waitingToSend are sorted by ms_timesOutAfter, "no timeout" last*/
+    RECORD_POOL_HANDLE messagePool; /*IOTHUB_MESSAGE_LIST records, NULL until OPTION_MESSAGE_POOL_SIZE is set*/
+    size_t sendQueueMaxMessages; /*0 means no limit*/
+    size_t sendQueueMaxBytes; /*0 means no limit*/
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY sendQueueFullPolicy;
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS sendQueueStatus; /*messages accepted by SendEventAsync and not completed yet, in waitingToSend or in the transport*/
+    PERSISTENT_QUEUE_HANDLE persistentQueue; /*NULL until OPTION_PERSISTENT_QUEUE_DIRECTORY is set*/
+    size_t persistentQueueSegmentSize;
+    size_t persistentQueueSyncCount;
+    size_t persistentQueueReplayWindow; /*recovered messages are replayed only while fewer messages than this are outstanding*/
+    tickcounter_ms_t persistentQueueLastFlush; /*when DoWork last flushed the persistent queue*/
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK eventConfirmationBatchCallback; /*NULL unless set, then it gets the confirmations of the messages sent without a callback*/
+    void* eventConfirmationBatchContext;
+    IOTHUB_CLIENT_EVENT_CONFIRMATION pendingConfirmations[EVENT_CONFIRMATION_BATCH_SIZE];
+    size_t pendingConfirmationCount;
     DLIST_ENTRY iot_msg_queue;
     DLIST_ENTRY iot_ack_queue;
     TRANSPORT_LL_HANDLE transportHandle;
@@ -84,6 +110,19 @@ static uint32_t get_next_item_id(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
     return handleData->data_msg_id;
 }
 
+static void flush_event_confirmations(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    if (handleData->pendingConfirmationCount > 0)
+    {
+        /*the batch is copied out first, so the callback can send (and complete) messages on this handle*/
+        IOTHUB_CLIENT_EVENT_CONFIRMATION confirmations[EVENT_CONFIRMATION_BATCH_SIZE];
+        size_t confirmationCount = handleData->pendingConfirmationCount;
+        (void)memcpy(confirmations, handleData->pendingConfirmations, confirmationCount * sizeof(IOTHUB_CLIENT_EVENT_CONFIRMATION));
+        handleData->pendingConfirmationCount = 0;
+        handleData->eventConfirmationBatchCallback(confirmations, confirmationCount, handleData->eventConfirmationBatchContext);
+    }
+}
+
 static IOTHUB_DEVICE_TWIN* dev_twin_data_create(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, uint32_t id, const unsigned char* reportedState, size_t size, IOTHUB_CLIENT_REPORTED_STATE_CALLBACK reportedStateCallback, void* userContextCallback)
 {
     IOTHUB_DEVICE_TWIN* result = (IOTHUB_DEVICE_TWIN*)malloc(sizeof(IOTHUB_DEVICE_TWIN) );
@@ -463,6 +502,23 @@ IOTHUB_CLIENT_LL_HANDLE IoTHubClient_LL_Create(const IOTHUB_CLIENT_CONFIG* confi
                     /*Codes_SRS_IOTHUBCLIENT_LL_02_004: [Otherwise IoTHubClient_LL_Create shall initialize a new DLIST (further called "waitingToSend") containing records with fields of the following types: IOTHUB_MESSAGE_HANDLE, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, void*.]*/
                     IOTHUBTRANSPORT_CONFIG lowerLayerConfig;
                     DList_InitializeListHead(&(handleData->waitingToSend));
+                    handleData->waitingToSendLastSeenTail = 0;
+                    handleData->lastSequenceNumber = 0;
+                    handleData->waitingToSendInTimeoutOrder = true;
+                    handleData->messagePool = NULL;
+                    handleData->sendQueueMaxMessages = 0;
+                    handleData->sendQueueMaxBytes = 0;
+                    handleData->sendQueueFullPolicy = IOTHUB_CLIENT_QUEUE_FULL_REJECT;
+                    handleData->sendQueueStatus.messageCount = 0;
+                    handleData->sendQueueStatus.byteCount = 0;
+                    handleData->persistentQueue = NULL;
+                    handleData->persistentQueueSegmentSize = DEFAULT_PERSISTENT_QUEUE_SEGMENT_SIZE;
+                    handleData->persistentQueueSyncCount = DEFAULT_PERSISTENT_QUEUE_SYNC_COUNT;
+                    handleData->persistentQueueReplayWindow = DEFAULT_PERSISTENT_QUEUE_REPLAY_WINDOW;
+                    handleData->persistentQueueLastFlush = 0;
+                    handleData->eventConfirmationBatchCallback = NULL;
+                    handleData->eventConfirmationBatchContext = NULL;
+                    handleData->pendingConfirmationCount = 0;
                     DList_InitializeListHead(&(handleData->iot_msg_queue));
                     DList_InitializeListHead(&(handleData->iot_ack_queue));
                     setTransportProtocol(handleData, (TRANSPORT_PROVIDER*)config->protocol());
@@ -635,6 +691,23 @@ IOTHUB_CLIENT_LL_HANDLE IoTHubClient_LL_CreateWithTransport(const IOTHUB_CLIENT_
                         {
                             /*Codes_SRS_IOTHUBCLIENT_LL_17_004: [IoTHubClient_LL_CreateWithTransport shall initialize a new DLIST (further called "waitingToSend") containing records with fields of the following types: IOTHUB_MESSAGE_HANDLE, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, void*.]*/
                             DList_InitializeListHead(&(handleData->waitingToSend));
+                            handleData->waitingToSendLastSeenTail = 0;
+                            handleData->lastSequenceNumber = 0;
+                            handleData->waitingToSendInTimeoutOrder = true;
+                            handleData->messagePool = NULL;
+                            handleData->sendQueueMaxMessages = 0;
+                            handleData->sendQueueMaxBytes = 0;
+                            handleData->sendQueueFullPolicy = IOTHUB_CLIENT_QUEUE_FULL_REJECT;
+                            handleData->sendQueueStatus.messageCount = 0;
+                            handleData->sendQueueStatus.byteCount = 0;
+                            handleData->persistentQueue = NULL;
+                            handleData->persistentQueueSegmentSize = DEFAULT_PERSISTENT_QUEUE_SEGMENT_SIZE;
+                            handleData->persistentQueueSyncCount = DEFAULT_PERSISTENT_QUEUE_SYNC_COUNT;
+                            handleData->persistentQueueReplayWindow = DEFAULT_PERSISTENT_QUEUE_REPLAY_WINDOW;
+                            handleData->persistentQueueLastFlush = 0;
+                            handleData->eventConfirmationBatchCallback = NULL;
+                            handleData->eventConfirmationBatchContext = NULL;
+                            handleData->pendingConfirmationCount = 0;
                             DList_InitializeListHead(&(handleData->iot_msg_queue));
                             DList_InitializeListHead(&(handleData->iot_ack_queue));
                             handleData->messageCallback = NULL;
@@ -719,8 +792,10 @@ void IoTHubClient_LL_Destroy(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
                 temp->callback(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, temp->context);
             }
             IoTHubMessage_Destroy(temp->messageHandle);
-            free(temp);
+            IoTHubClient_RecordPool_Free(temp);
         }
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_050: [ IoTHubClient_LL_Destroy shall pass the pending confirmations to the batch callback after completing the messages in waitingToSend. ]*/
+        flush_event_confirmations(handleData);
 
         /* Codes_SRS_IOTHUBCLIENT_LL_07_007: [ IoTHubClient_LL_Destroy shall iterate the device twin queues and destroy any remaining items. ] */
         while ((unsend = DList_RemoveHeadList(&(handleData->iot_msg_queue))) != &(handleData->iot_msg_queue))
@@ -739,6 +814,12 @@ void IoTHubClient_LL_Destroy(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
 #ifndef DONT_USE_UPLOADTOBLOB
         IoTHubClient_LL_UploadToBlob_Destroy(handleData->uploadToBlobHandle);
 #endif
+        IoTHubClient_RecordPool_Destroy(handleData->messagePool);
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_037: [ IoTHubClient_LL_Destroy shall close the persistent queue after completing the messages, leaving the messages completed with IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY pending in it. ]*/
+        if (handleData->persistentQueue != NULL)
+        {
+            IoTHubClient_PersistentQueue_Destroy(handleData->persistentQueue);
+        }
         free(handleData);
     }
 }
@@ -771,7 +852,213 @@ static int attach_ms_timesOutAfter(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOT
     return result;
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+/*messages that do not timeout sort after all the others*/
+static tickcounter_ms_t get_timeout_order_key(const IOTHUB_MESSAGE_LIST* message)
+{
+    return (message->ms_timesOutAfter == 0) ? NO_TIMEOUT_ORDER_KEY : message->ms_timesOutAfter;
+}
+
+static uint64_t get_waiting_to_send_tail(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    return (handleData->waitingToSend.Blink == &(handleData->waitingToSend)) ? 0 : containingRecord(handleData->waitingToSend.Blink, IOTHUB_MESSAGE_LIST, entry)->sequenceNumber;
+}
+
+static bool is_waiting_to_send_in_timeout_order(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    uint64_t tail = get_waiting_to_send_tail(handleData);
+    if (tail == 0)
+    {
+        /*an empty list is always in order*/
+        handleData->waitingToSendInTimeoutOrder = true;
+    }
+    else if (tail != handleData->waitingToSendLastSeenTail)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_052: [ IoTHubClient_LL shall tell the tail of waitingToSend apart by a sequence number given to every message added to waitingToSend, not by the address of its record. ]*/
+        /*the transport put messages back, or took the tail out - the order is not known anymore until the list is scanned again*/
+        handleData->waitingToSendInTimeoutOrder = false;
+    }
+    handleData->waitingToSendLastSeenTail = tail;
+    return handleData->waitingToSendInTimeoutOrder;
+}
+
+static void add_to_waiting_to_send(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* newEntry)
+{
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_004: [ IoTHubClient_LL_SendEventAsync shall keep track of whether the messages in waitingToSend are in the order in which they timeout. ]*/
+    if (is_waiting_to_send_in_timeout_order(handleData) &&
+        (handleData->waitingToSend.Blink != &(handleData->waitingToSend)) &&
+        (get_timeout_order_key(containingRecord(handleData->waitingToSend.Blink, IOTHUB_MESSAGE_LIST, entry)) > get_timeout_order_key(newEntry)))
+    {
+        /*this happens when "messageTimeout" is lowered while messages are waiting*/
+        handleData->waitingToSendInTimeoutOrder = false;
+    }
+    newEntry->sequenceNumber = ++handleData->lastSequenceNumber;
+    DList_InsertTailList(&(handleData->waitingToSend), &(newEntry->entry));
+    handleData->waitingToSendLastSeenTail = newEntry->sequenceNumber;
+}
+
+/*every IOTHUB_MESSAGE_LIST created by SendEventAsync is completed through here, no matter if by IoTHubClient_LL or directly by the transport*/
+static void on_send_queue_message_completed(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* context)
+{
+    IOTHUB_MESSAGE_LIST* message = (IOTHUB_MESSAGE_LIST*)context;
+    IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)message->ownerHandle;
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_020: [ When the confirmation callback of a message is called, for whatever reason, the message and its payload size shall be removed from the send queue status. ]*/
+    handleData->sendQueueStatus.messageCount--;
+    handleData->sendQueueStatus.byteCount -= message->byteCount;
+    if (message->isPersisted && (result != IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY) &&
+        (IoTHubClient_PersistentQueue_MarkDone(handleData->persistentQueue, &(message->persistentEntry)) != 0))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_034: [ When the confirmation callback of a persisted message is called with any result but IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, its entry shall be marked done in the persistent queue. ]*/
+        LogError("unable to mark the message done in the persistent queue, it will be sent again after a restart");
+    }
+    if (message->userCallback != NULL)
+    {
+        message->userCallback(result, message->userContext);
+    }
+    else if (handleData->eventConfirmationBatchCallback != NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_045: [ When a message sent without a confirmation callback completes while a batch callback is set, its context and result shall be appended to the pending confirmations instead. ]*/
+        handleData->pendingConfirmations[handleData->pendingConfirmationCount].userContextCallback = message->userContext;
+        handleData->pendingConfirmations[handleData->pendingConfirmationCount].result = result;
+        handleData->pendingConfirmationCount++;
+        if (handleData->pendingConfirmationCount == EVENT_CONFIRMATION_BATCH_SIZE)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_046: [ When EVENT_CONFIRMATION_BATCH_SIZE confirmations are pending, they shall be passed to the batch callback right away. ]*/
+            flush_event_confirmations(handleData);
+        }
+    }
+}
+
+static size_t get_message_byte_count(IOTHUB_MESSAGE_HANDLE messageHandle)
+{
+    size_t result;
+    IOTHUBMESSAGE_CONTENT_TYPE contentType = IoTHubMessage_GetContentType(messageHandle);
+    if (contentType == IOTHUBMESSAGE_BYTEARRAY)
+    {
+        const unsigned char* byteArray;
+        result = 0;
+        if (IoTHubMessage_GetByteArray(messageHandle, &byteArray, &result) != IOTHUB_MESSAGE_OK)
+        {
+            LogError("unable to get the byte array of the message, counting it as 0 bytes");
+            result = 0;
+        }
+    }
+    else if (contentType == IOTHUBMESSAGE_STRING)
+    {
+        const char* string = IoTHubMessage_GetString(messageHandle);
+        result = (string == NULL) ? 0 : strlen(string);
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+/*freedMessageCount and freedByteCount are what dropping some of the queued messages would give back*/
+static bool is_send_queue_full(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, size_t byteCount, size_t freedMessageCount, size_t freedByteCount)
+{
+    return
+        ((handleData->sendQueueMaxMessages != 0) && (handleData->sendQueueStatus.messageCount - freedMessageCount >= handleData->sendQueueMaxMessages)) ||
+        ((handleData->sendQueueMaxBytes != 0) && (handleData->sendQueueStatus.byteCount - freedByteCount + byteCount > handleData->sendQueueMaxBytes));
+}
+
+static void drop_message(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* message)
+{
+    /*removing an entry keeps the rest in timeout order, but the tail left by the transport has to be looked at before it changes*/
+    (void)is_waiting_to_send_in_timeout_order(handleData);
+    DList_RemoveEntryList(&(message->entry));
+    handleData->waitingToSendLastSeenTail = get_waiting_to_send_tail(handleData);
+    message->callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, message->context);
+    IoTHubMessage_Destroy(message->messageHandle);
+    IoTHubClient_RecordPool_Free(message);
+}
+
+/*returns 0 when there is room for newMessage (of byteCount bytes) in the send queue, dropping messages if the policy allows it*/
+static int make_room_in_send_queue(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_HANDLE newMessage, size_t byteCount)
+{
+    int result;
+    if ((handleData->sendQueueMaxBytes != 0) && (byteCount > handleData->sendQueueMaxBytes))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_022: [ If the payload of the message alone is larger than OPTION_SEND_QUEUE_MAX_BYTES, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL whatever the policy. ]*/
+        LogError("message of %zu bytes can never fit in a send queue of %zu bytes", byteCount, handleData->sendQueueMaxBytes);
+        result = __LINE__;
+    }
+    else if (!is_send_queue_full(handleData, byteCount, 0, 0))
+    {
+        result = 0;
+    }
+    else if (handleData->sendQueueFullPolicy == IOTHUB_CLIENT_QUEUE_FULL_REJECT)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_023: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_REJECT, or if all the queued messages have already been handed to the transport, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+        LogError("send queue is full (%zu messages, %zu bytes)", handleData->sendQueueStatus.messageCount, handleData->sendQueueStatus.byteCount);
+        result = __LINE__;
+    }
+    else
+    {
+        /*messages handed to the transport count in the send queue but cannot be dropped, so first find out whether dropping is of any use*/
+        int newPriority = (handleData->sendQueueFullPolicy == IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY) ? IoTHubMessage_GetPriority(newMessage) : 0;
+        size_t freedMessageCount = 0;
+        size_t freedByteCount = 0;
+        PDLIST_ENTRY current;
+        for (current = handleData->waitingToSend.Flink;
+            (current != &(handleData->waitingToSend)) && is_send_queue_full(handleData, byteCount, freedMessageCount, freedByteCount);
+            current = current->Flink)
+        {
+            IOTHUB_MESSAGE_LIST* candidate = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
+            if ((handleData->sendQueueFullPolicy == IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST) ||
+                (IoTHubMessage_GetPriority(candidate->messageHandle) <= newPriority))
+            {
+                freedMessageCount++;
+                freedByteCount += candidate->byteCount;
+            }
+        }
+
+        if (is_send_queue_full(handleData, byteCount, freedMessageCount, freedByteCount))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_023: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_REJECT, or if all the queued messages have already been handed to the transport, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_030: [ If the new message has a lower priority than all the messages in waitingToSend, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_053: [ If dropping all the messages in waitingToSend that the policy allows to drop would still not make room for the new message, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL without dropping any message. ]*/
+            LogError("send queue is full (%zu messages, %zu bytes) and dropping messages would not make room", handleData->sendQueueStatus.messageCount, handleData->sendQueueStatus.byteCount);
+            result = __LINE__;
+        }
+        else
+        {
+            /*the messages below are the ones counted above, the loop stops once they are all gone at the latest*/
+            while (is_send_queue_full(handleData, byteCount, 0, 0))
+            {
+                if (handleData->sendQueueFullPolicy == IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_41_024: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST, IoTHubClient_LL_SendEventAsync shall drop the message at the head of waitingToSend until the new message fits. ]*/
+                    drop_message(handleData, containingRecord(handleData->waitingToSend.Flink, IOTHUB_MESSAGE_LIST, entry));
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_41_025: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY, IoTHubClient_LL_SendEventAsync shall drop the oldest of the messages in waitingToSend with the lowest priority until the new message fits. ]*/
+                    IOTHUB_MESSAGE_LIST* lowest;
+                    int lowestPriority;
+                    current = handleData->waitingToSend.Flink;
+                    lowest = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
+                    lowestPriority = IoTHubMessage_GetPriority(lowest->messageHandle);
+                    for (current = current->Flink; current != &(handleData->waitingToSend); current = current->Flink)
+                    {
+                        IOTHUB_MESSAGE_LIST* candidate = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
+                        int candidatePriority = IoTHubMessage_GetPriority(candidate->messageHandle);
+                        if (candidatePriority < lowestPriority)
+                        {
+                            lowest = candidate;
+                            lowestPriority = candidatePriority;
+                        }
+                    }
+                    drop_message(handleData, lowest);
+                }
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static IOTHUB_CLIENT_RESULT send_event_async(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
 {
     IOTHUB_CLIENT_RESULT result;
     /*Codes_SRS_IOTHUBCLIENT_LL_02_011: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle or eventMessageHandle is NULL.]*/
@@ -779,7 +1066,8 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotH
         (iotHubClientHandle == NULL) ||
         (eventMessageHandle == NULL) ||
         /*Codes_SRS_IOTHUBCLIENT_LL_02_012: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter eventConfirmationCallback is NULL and userContextCallback is not NULL.] */
-        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL))
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_044: [ While a batch callback is set, IoTHubClient_LL_SendEventAsync shall accept a NULL eventConfirmationCallback with a non-NULL userContextCallback. ]*/
+        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL) && (((IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle)->eventConfirmationBatchCallback == NULL))
         )
     {
         result = IOTHUB_CLIENT_INVALID_ARG;
@@ -787,47 +1075,98 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotH
     }
     else
     {
-        IOTHUB_MESSAGE_LIST *newEntry = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST));
-        if (newEntry == NULL)
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        IOTHUB_MESSAGE_LIST *newEntry;
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_021: [ IoTHubClient_LL_SendEventAsync shall add the payload size of eventMessageHandle to the send queue status. ]*/
+        size_t byteCount = get_message_byte_count(eventMessageHandle);
+        if (make_room_in_send_queue(handleData, eventMessageHandle, byteCount) != 0)
+        {
+            result = IOTHUB_CLIENT_QUEUE_FULL;
+            LOG_ERROR_RESULT;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_011: [ IoTHubClient_LL_SendEventAsync shall take the record added to waitingToSend from the message pool if one was configured with OPTION_MESSAGE_POOL_SIZE, and allocate it otherwise. ]*/
+        else if ((newEntry = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(handleData->messagePool, sizeof(IOTHUB_MESSAGE_LIST))) == NULL)
         {
             result = IOTHUB_CLIENT_ERROR;
             LOG_ERROR_RESULT;
         }
         else
         {
-            IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
-
             if (attach_ms_timesOutAfter(handleData, newEntry) != 0)
             {
                 result = IOTHUB_CLIENT_ERROR;
                 LOG_ERROR_RESULT;
-                free(newEntry);
+                IoTHubClient_RecordPool_Free(newEntry);
             }
             else
             {
-                /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
-                if ((newEntry->messageHandle = IoTHubMessage_Clone(eventMessageHandle)) == NULL)
+                if (takeOwnership)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_41_008: [ IoTHubClient_LL_SendEventAsync_TakeOwnership shall add eventMessageHandle itself to waitingToSend, without cloning it. ]*/
+                    newEntry->messageHandle = eventMessageHandle;
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
+                    newEntry->messageHandle = IoTHubMessage_Clone(eventMessageHandle);
+                }
+
+                if (newEntry->messageHandle == NULL)
                 {
                     /*Codes_SRS_IOTHUBCLIENT_LL_02_014: [If cloning and/or adding the information fails for any reason, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR.] */
                     result = IOTHUB_CLIENT_ERROR;
-                    free(newEntry);
+                    IoTHubClient_RecordPool_Free(newEntry);
+                    LOG_ERROR_RESULT;
+                }
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_032: [ If a persistent queue is open, IoTHubClient_LL_SendEventAsync shall append the message to it before adding it to waitingToSend. ]*/
+                else if ((newEntry->isPersisted = (handleData->persistentQueue != NULL)) &&
+                    (IoTHubClient_PersistentQueue_Append(handleData->persistentQueue, newEntry->messageHandle, &(newEntry->persistentEntry)) != 0))
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_41_033: [ If appending the message to the persistent queue fails, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+                    result = IOTHUB_CLIENT_ERROR;
+                    if (!takeOwnership)
+                    {
+                        IoTHubMessage_Destroy(newEntry->messageHandle);
+                    }
+                    IoTHubClient_RecordPool_Free(newEntry);
                     LOG_ERROR_RESULT;
                 }
                 else
                 {
                     /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
-                    newEntry->callback = eventConfirmationCallback;
-                    newEntry->context = userContextCallback;
-                    DList_InsertTailList(&(iotHubClientHandle->waitingToSend), &(newEntry->entry));
+                    newEntry->userCallback = eventConfirmationCallback;
+                    newEntry->userContext = userContextCallback;
+                    newEntry->callback = on_send_queue_message_completed;
+                    newEntry->context = newEntry;
+                    newEntry->ownerHandle = iotHubClientHandle;
+                    newEntry->byteCount = byteCount;
+                    add_to_waiting_to_send(handleData, newEntry);
+                    handleData->sendQueueStatus.messageCount++;
+                    handleData->sendQueueStatus.byteCount += byteCount;
                     /*Codes_SRS_IOTHUBCLIENT_LL_02_015: [Otherwise IoTHubClient_LL_SendEventAsync shall succeed and return IOTHUB_CLIENT_OK.] */
                     result = IOTHUB_CLIENT_OK;
                 }
             }
         }
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_047: [ IoTHubClient_LL_SendEventAsync shall pass the confirmations of the messages it dropped to make room to the batch callback before returning. ]*/
+        flush_event_confirmations(handleData);
     }
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, false);
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync_TakeOwnership(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_007: [ IoTHubClient_LL_SendEventAsync_TakeOwnership shall validate its arguments and fail the same way IoTHubClient_LL_SendEventAsync does. ]*/
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_009: [ If IoTHubClient_LL_SendEventAsync_TakeOwnership fails, the ownership of eventMessageHandle shall remain with the caller. ]*/
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_010: [ Otherwise eventMessageHandle shall be destroyed by IoTHubClient_LL once the message has been sent, has timed out or the handle is destroyed, and IoTHubClient_LL_SendEventAsync_TakeOwnership shall return IOTHUB_CLIENT_OK. ]*/
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, true);
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC messageCallback, void* userContextCallback)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -870,6 +1209,59 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback(IOTHUB_CLIENT_LL_HANDLE
     return result;
 }
 
+static void timeout_message(IOTHUB_MESSAGE_LIST* fullEntry)
+{
+    DList_RemoveEntryList(&(fullEntry->entry));
+    if (fullEntry->callback != NULL)
+    {
+        fullEntry->callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, fullEntry->context);
+    }
+    IoTHubMessage_Destroy(fullEntry->messageHandle); /*because it has been cloned*/
+    IoTHubClient_RecordPool_Free(fullEntry);
+}
+
+/*puts the messages recovered by the persistent queue back in waitingToSend, without holding more than persistentQueueReplayWindow messages in memory*/
+static void DoPersistentQueueReplay(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_035: [ IoTHubClient_LL_DoWork shall add the messages recovered by the persistent queue to waitingToSend, without a confirmation callback, as long as fewer than OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW messages are in the send queue. ]*/
+    while (handleData->sendQueueStatus.messageCount < handleData->persistentQueueReplayWindow)
+    {
+        IOTHUB_MESSAGE_LIST* newEntry;
+        if ((newEntry = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(handleData->messagePool, sizeof(IOTHUB_MESSAGE_LIST))) == NULL)
+        {
+            LogError("unable to allocate a record for a recovered message");
+            break;
+        }
+        else if ((newEntry->messageHandle = IoTHubClient_PersistentQueue_GetNextRecovered(handleData->persistentQueue, &(newEntry->persistentEntry))) == NULL)
+        {
+            /*nothing left to replay, or the next entry could not be read - it is tried again at the next DoWork*/
+            IoTHubClient_RecordPool_Free(newEntry);
+            break;
+        }
+        else if (attach_ms_timesOutAfter(handleData, newEntry) != 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_036: [ If a recovered message cannot be added to waitingToSend, it shall be left pending in the persistent queue to be sent after the next restart. ]*/
+            LogError("unable to attach a timeout to a recovered message");
+            IoTHubMessage_Destroy(newEntry->messageHandle);
+            IoTHubClient_RecordPool_Free(newEntry);
+            break;
+        }
+        else
+        {
+            newEntry->isPersisted = true;
+            newEntry->userCallback = NULL;
+            newEntry->userContext = NULL;
+            newEntry->callback = on_send_queue_message_completed;
+            newEntry->context = newEntry;
+            newEntry->ownerHandle = handleData;
+            newEntry->byteCount = get_message_byte_count(newEntry->messageHandle);
+            add_to_waiting_to_send(handleData, newEntry);
+            handleData->sendQueueStatus.messageCount++;
+            handleData->sendQueueStatus.byteCount += newEntry->byteCount;
+        }
+    }
+}
+
 static void DoTimeouts(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
 {
     tickcounter_ms_t nowTick;
@@ -877,31 +1269,105 @@ static void DoTimeouts(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
     {
         LogError("unable to get the current ms, timeouts will not be processed");
     }
+    else if (is_waiting_to_send_in_timeout_order(handleData))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_005: [ If the messages in waitingToSend are in timeout order, IoTHubClient_LL_DoWork shall only inspect the messages at the head of waitingToSend up to the first one that has not timed out. ]*/
+        while (handleData->waitingToSend.Flink != &(handleData->waitingToSend))
+        {
+            IOTHUB_MESSAGE_LIST* fullEntry = containingRecord(handleData->waitingToSend.Flink, IOTHUB_MESSAGE_LIST, entry);
+            /*Codes_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+            if (get_timeout_order_key(fullEntry) >= nowTick)
+            {
+                break;
+            }
+            timeout_message(fullEntry);
+        }
+    }
     else
     {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_006: [ Otherwise IoTHubClient_LL_DoWork shall inspect all the messages in waitingToSend and find out again whether the remaining ones are in timeout order. ]*/
+        bool inTimeoutOrder = true;
+        tickcounter_ms_t previousKey = 0;
         DLIST_ENTRY* currentItemInWaitingToSend = handleData->waitingToSend.Flink;
         while (currentItemInWaitingToSend != &(handleData->waitingToSend)) /*while we are not at the end of the list*/
         {
             IOTHUB_MESSAGE_LIST* fullEntry = containingRecord(currentItemInWaitingToSend, IOTHUB_MESSAGE_LIST, entry);
+            PDLIST_ENTRY theNext = currentItemInWaitingToSend->Flink; /*need to save the next item, because the below operations are destructive*/
             /*Codes_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
             if ((fullEntry->ms_timesOutAfter != 0) && (fullEntry->ms_timesOutAfter < nowTick))
             {
-                PDLIST_ENTRY theNext = currentItemInWaitingToSend->Flink; /*need to save the next item, because the below operations are destructive*/
-                DList_RemoveEntryList(currentItemInWaitingToSend);
-                if (fullEntry->callback != NULL)
+                timeout_message(fullEntry);
+            }
+            else
+            {
+                if (get_timeout_order_key(fullEntry) < previousKey)
                 {
-                    fullEntry->callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, fullEntry->context);
+                    inTimeoutOrder = false;
                 }
-                IoTHubMessage_Destroy(fullEntry->messageHandle); /*because it has been cloned*/
-                free(fullEntry);
-                currentItemInWaitingToSend = theNext;
+                previousKey = get_timeout_order_key(fullEntry);
             }
-            else
+            currentItemInWaitingToSend = theNext;
+        }
+        handleData->waitingToSendInTimeoutOrder = inTimeoutOrder;
+        handleData->waitingToSendLastSeenTail = get_waiting_to_send_tail(handleData);
+    }
+}
+
+int IoTHubClient_LL_GetTimeToNextTimeout(IOTHUB_CLIENT_LL_HANDLE handle, tickcounter_ms_t* time_to_next_timeout)
+{
+    int result;
+    tickcounter_ms_t nowTick;
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_001: [ If handle or time_to_next_timeout is NULL then IoTHubClient_LL_GetTimeToNextTimeout shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (time_to_next_timeout == NULL))
+    {
+        LogError("invalid arg IOTHUB_CLIENT_LL_HANDLE handle=%p, tickcounter_ms_t* time_to_next_timeout=%p", handle, time_to_next_timeout);
+        result = __LINE__;
+    }
+    else if (tickcounter_get_current_ms(((IOTHUB_CLIENT_LL_HANDLE_DATA*)handle)->tickCounter, &nowTick) != 0)
+    {
+        LogError("unable to get the current ms");
+        result = __LINE__;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)handle;
+        tickcounter_ms_t earliest = 0;
+        if (is_waiting_to_send_in_timeout_order(handleData))
+        {
+            /*the head of the list times out first (0 means none of the messages does)*/
+            if (handleData->waitingToSend.Flink != &(handleData->waitingToSend))
+            {
+                earliest = containingRecord(handleData->waitingToSend.Flink, IOTHUB_MESSAGE_LIST, entry)->ms_timesOutAfter;
+            }
+        }
+        else
+        {
+            DLIST_ENTRY* currentItemInWaitingToSend = handleData->waitingToSend.Flink;
+            while (currentItemInWaitingToSend != &(handleData->waitingToSend))
             {
+                IOTHUB_MESSAGE_LIST* fullEntry = containingRecord(currentItemInWaitingToSend, IOTHUB_MESSAGE_LIST, entry);
+                if ((fullEntry->ms_timesOutAfter != 0) && ((earliest == 0) || (fullEntry->ms_timesOutAfter < earliest)))
+                {
+                    earliest = fullEntry->ms_timesOutAfter;
+                }
                 currentItemInWaitingToSend = currentItemInWaitingToSend->Flink;
             }
         }
+
+        if (earliest == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_002: [ If no message waiting to be sent has a timeout then IoTHubClient_LL_GetTimeToNextTimeout shall return a non-zero value. ]*/
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_003: [ Otherwise IoTHubClient_LL_GetTimeToNextTimeout shall set time_to_next_timeout to the number of milliseconds until the earliest message timeout (0 if it is already due) and return 0. ]*/
+            /*DoTimeouts expires a message once the tick counter is strictly past ms_timesOutAfter*/
+            *time_to_next_timeout = (earliest < nowTick) ? 0 : (earliest - nowTick + 1);
+            result = 0;
+        }
     }
+    return result;
 }
 
 void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
@@ -911,6 +1377,10 @@ void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
     {
         IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
         DoTimeouts(handleData);
+        if (handleData->persistentQueue != NULL)
+        {
+            DoPersistentQueueReplay(handleData);
+        }
 
         /*Codes_SRS_IOTHUBCLIENT_LL_07_008: [ IoTHubClient_LL_DoWork shall iterate the message queue and execute the underlying transports IoTHubTransport_ProcessItem function for each item. ] */
         DLIST_ENTRY* client_item = handleData->iot_msg_queue.Flink;
@@ -948,6 +1418,27 @@ void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
 
         /*Codes_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.]*/
         handleData->IoTHubTransport_DoWork(handleData->transportHandle, iotHubClientHandle);
+
+        if (handleData->persistentQueue != NULL)
+        {
+            tickcounter_ms_t nowTick;
+            if (tickcounter_get_current_ms(handleData->tickCounter, &nowTick) != 0)
+            {
+                LogError("unable to get the current time, the persistent queue is not flushed");
+            }
+            else if (nowTick - handleData->persistentQueueLastFlush >= PERSISTENT_QUEUE_FLUSH_PERIOD_MS)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_042: [ After the underlying layer's _DoWork, IoTHubClient_LL_DoWork shall flush the persistent queue if it was not flushed by IoTHubClient_LL_DoWork in the last 100 ms, so the done marks written by the transport reach the disk in batches. ]*/
+                handleData->persistentQueueLastFlush = nowTick;
+                if (IoTHubClient_PersistentQueue_Flush(handleData->persistentQueue) != 0)
+                {
+                    LogError("unable to flush the persistent queue");
+                }
+            }
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_048: [ IoTHubClient_LL_DoWork shall end by passing the pending confirmations, such as those of the messages that timed out, to the batch callback. ]*/
+        flush_event_confirmations(handleData);
     }
 }
 
@@ -998,8 +1489,10 @@ void IoTHubClient_LL_SendComplete(IOTHUB_CLIENT_LL_HANDLE handle, PDLIST_ENTRY c
                 messageList->callback(result, messageList->context);
             }
             IoTHubMessage_Destroy(messageList->messageHandle);
-            free(messageList);
+            IoTHubClient_RecordPool_Free(messageList);
         }
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_049: [ IoTHubClient_LL_SendComplete shall pass the confirmations collected from completed to the batch callback in one call. ]*/
+        flush_event_confirmations((IOTHUB_CLIENT_LL_HANDLE_DATA*)handle);
     }
 }
 
@@ -1301,6 +1794,108 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetOption(IOTHUB_CLIENT_LL_HANDLE iotHubCli
             handleData->currentMessageTimeout = *(const tickcounter_ms_t*)value;
             result = IOTHUB_CLIENT_OK;
         }
+        else if (strcmp(optionName, OPTION_MESSAGE_POOL_SIZE) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_012: [ OPTION_MESSAGE_POOL_SIZE - IoTHubClient_LL_SetOption shall replace the message pool with one holding value records (a pointer to size_t); 0 disables the pool. Records still in use are returned to the pool they came from. ]*/
+            size_t poolSize = *(const size_t*)value;
+            RECORD_POOL_HANDLE newPool;
+            if (poolSize == 0)
+            {
+                newPool = NULL;
+                result = IOTHUB_CLIENT_OK;
+            }
+            else if ((newPool = IoTHubClient_RecordPool_Create(sizeof(IOTHUB_MESSAGE_LIST), poolSize)) == NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_013: [ If creating the message pool fails, IoTHubClient_LL_SetOption shall keep the current pool and return IOTHUB_CLIENT_ERROR. ]*/
+                result = IOTHUB_CLIENT_ERROR;
+                LOG_ERROR_RESULT;
+            }
+            else
+            {
+                result = IOTHUB_CLIENT_OK;
+            }
+
+            if (result == IOTHUB_CLIENT_OK)
+            {
+                IoTHubClient_RecordPool_Destroy(handleData->messagePool);
+                handleData->messagePool = newPool;
+
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_014: [ OPTION_MESSAGE_POOL_SIZE shall also be passed to the transport, which may pool its own per message records; the transport not supporting the option is not an error. ]*/
+                /*only some transports pool their records and the others may fail unknown options, so the client pool being set is what the result reports*/
+                if (handleData->IoTHubTransport_SetOption(handleData->transportHandle, optionName, value) != IOTHUB_CLIENT_OK)
+                {
+                    LogInfo("underlying transport did not set %s, only the client message pool is used", optionName);
+                }
+            }
+        }
+        else if (strcmp(optionName, OPTION_SEND_QUEUE_MAX_MESSAGES) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_026: [ OPTION_SEND_QUEUE_MAX_MESSAGES - IoTHubClient_LL_SetOption shall limit the number of messages in the send queue to value (a pointer to size_t); 0 removes the limit. Messages already queued are not dropped. ]*/
+            handleData->sendQueueMaxMessages = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_SEND_QUEUE_MAX_BYTES) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_027: [ OPTION_SEND_QUEUE_MAX_BYTES - IoTHubClient_LL_SetOption shall limit the sum of the payload sizes of the messages in the send queue to value (a pointer to size_t); 0 removes the limit. Messages already queued are not dropped. ]*/
+            handleData->sendQueueMaxBytes = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_SEND_QUEUE_FULL_POLICY) == 0)
+        {
+            IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = *(const IOTHUB_CLIENT_QUEUE_FULL_POLICY*)value;
+            if ((policy != IOTHUB_CLIENT_QUEUE_FULL_REJECT) &&
+                (policy != IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST) &&
+                (policy != IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY))
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_029: [ If value is not a IOTHUB_CLIENT_QUEUE_FULL_POLICY, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+                result = IOTHUB_CLIENT_INVALID_ARG;
+                LogError("invalid send queue full policy %d", (int)policy);
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_028: [ OPTION_SEND_QUEUE_FULL_POLICY - IoTHubClient_LL_SetOption shall set what IoTHubClient_LL_SendEventAsync does when a message would exceed either limit of the send queue. value is a pointer to IOTHUB_CLIENT_QUEUE_FULL_POLICY. ]*/
+                handleData->sendQueueFullPolicy = policy;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(optionName, OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_039: [ OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE, OPTION_PERSISTENT_QUEUE_SYNC_COUNT and OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW - IoTHubClient_LL_SetOption shall store value (a pointer to size_t) to be used by the persistent queue opened next. ]*/
+            handleData->persistentQueueSegmentSize = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_PERSISTENT_QUEUE_SYNC_COUNT) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_039: [ OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE, OPTION_PERSISTENT_QUEUE_SYNC_COUNT and OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW - IoTHubClient_LL_SetOption shall store value (a pointer to size_t) to be used by the persistent queue opened next. ]*/
+            handleData->persistentQueueSyncCount = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW) == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_039: [ OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE, OPTION_PERSISTENT_QUEUE_SYNC_COUNT and OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW - IoTHubClient_LL_SetOption shall store value (a pointer to size_t) to be used by the persistent queue opened next. ]*/
+            handleData->persistentQueueReplayWindow = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_PERSISTENT_QUEUE_DIRECTORY) == 0)
+        {
+            if (handleData->persistentQueue != NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_041: [ If a persistent queue is already open, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("the persistent queue is already open");
+            }
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_040: [ OPTION_PERSISTENT_QUEUE_DIRECTORY - IoTHubClient_LL_SetOption shall open a persistent queue in the directory value (a const char*) with the stored segment size and sync count. ]*/
+            else if ((handleData->persistentQueue = IoTHubClient_PersistentQueue_Create((const char*)value, handleData->persistentQueueSegmentSize, handleData->persistentQueueSyncCount)) == NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_41_038: [ If opening the persistent queue fails, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("unable to open the persistent queue in %s", (const char*)value);
+            }
+            else
+            {
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
         else
         {
 
@@ -1339,6 +1934,77 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetOption(IOTHUB_CLIENT_LL_HANDLE iotHubCli
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetMessagePoolStatistics(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS* statistics)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_015: [ If iotHubClientHandle or statistics is NULL, IoTHubClient_LL_GetMessagePoolStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if ((iotHubClientHandle == NULL) || (statistics == NULL))
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("invalid arg IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle=%p, IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS* statistics=%p", iotHubClientHandle, statistics);
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        RECORD_POOL_STATISTICS poolStatistics;
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_016: [ If no message pool is configured, IoTHubClient_LL_GetMessagePoolStatistics shall return IOTHUB_CLIENT_ERROR. ]*/
+        if (IoTHubClient_RecordPool_GetStatistics(handleData->messagePool, &poolStatistics) != 0)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("no message pool is configured");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_41_017: [ Otherwise IoTHubClient_LL_GetMessagePoolStatistics shall fill statistics with the capacity, records in use, hits and misses of the message pool and return IOTHUB_CLIENT_OK. ]*/
+            statistics->capacity = poolStatistics.capacity;
+            statistics->inUse = poolStatistics.inUse;
+            statistics->hits = poolStatistics.hits;
+            statistics->misses = poolStatistics.misses;
+            result = IOTHUB_CLIENT_OK;
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetSendQueueStatus(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_SEND_QUEUE_STATUS* status)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_018: [ If iotHubClientHandle or status is NULL, IoTHubClient_LL_GetSendQueueStatus shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if ((iotHubClientHandle == NULL) || (status == NULL))
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("invalid arg IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle=%p, IOTHUB_CLIENT_SEND_QUEUE_STATUS* status=%p", iotHubClientHandle, status);
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_019: [ Otherwise IoTHubClient_LL_GetSendQueueStatus shall fill status with the number of messages accepted by IoTHubClient_LL_SendEventAsync whose confirmation callback has not been called yet and the sum of their payload sizes, and return IOTHUB_CLIENT_OK. ]*/
+        *status = ((IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle)->sendQueueStatus;
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetEventConfirmationBatchCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK batchCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_41_043: [ If iotHubClientHandle is NULL, IoTHubClient_LL_SetEventConfirmationBatchCallback shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if (iotHubClientHandle == NULL)
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("invalid arg IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle=%p", iotHubClientHandle);
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        /*Codes_SRS_IOTHUBCLIENT_LL_41_051: [ IoTHubClient_LL_SetEventConfirmationBatchCallback shall pass the pending confirmations to the previous batch callback, then store batchCallback and userContextCallback (NULL stops batching) and return IOTHUB_CLIENT_OK. ]*/
+        flush_event_confirmations(handleData);
+        handleData->eventConfirmationBatchCallback = batchCallback;
+        handleData->eventConfirmationBatchContext = userContextCallback;
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetDeviceTwinCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK deviceTwinCallback, void* userContextCallback)
 {
     IOTHUB_CLIENT_RESULT result;
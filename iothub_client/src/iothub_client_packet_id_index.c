@@ -0,0 +1,186 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_packet_id_index.h"
+
+/*one bucket per possible packet id, there is no point in growing further*/
+#define PACKET_ID_INDEX_MAX_BUCKETS ((size_t)UINT16_MAX + 1)
+
+static void grow_buckets(PACKET_ID_INDEX* index)
+{
+    size_t newBucketCount = index->bucketCount * 2;
+    PACKET_ID_INDEX_ENTRY** newBuckets = (PACKET_ID_INDEX_ENTRY**)malloc(newBucketCount * sizeof(PACKET_ID_INDEX_ENTRY*));
+    if (newBuckets == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_008: [ If allocating the larger bucket array fails, IoTHubClient_PacketIdIndex_Insert shall keep the current buckets and still succeed. ]*/
+        LogError("unable to malloc %zu buckets, keeping %zu", newBucketCount, index->bucketCount);
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < newBucketCount; i++)
+        {
+            newBuckets[i] = NULL;
+        }
+
+        for (i = 0; i < index->bucketCount; i++)
+        {
+            PACKET_ID_INDEX_ENTRY* entry = index->buckets[i];
+            while (entry != NULL)
+            {
+                PACKET_ID_INDEX_ENTRY* next = entry->next;
+                size_t bucket = entry->packetId & (newBucketCount - 1);
+                entry->next = newBuckets[bucket];
+                newBuckets[bucket] = entry;
+                entry = next;
+            }
+        }
+
+        if (index->buckets != index->inlineBuckets)
+        {
+            free(index->buckets);
+        }
+        index->buckets = newBuckets;
+        index->bucketCount = newBucketCount;
+    }
+}
+
+void IoTHubClient_PacketIdIndex_Init(PACKET_ID_INDEX* index)
+{
+    if (index == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_001: [ If index is NULL, IoTHubClient_PacketIdIndex_Init shall do nothing. ]*/
+        LogError("invalid argument index=NULL");
+    }
+    else
+    {
+        size_t i;
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_002: [ IoTHubClient_PacketIdIndex_Init shall make index empty, using its PACKET_ID_INDEX_INLINE_BUCKETS inline buckets. ]*/
+        for (i = 0; i < PACKET_ID_INDEX_INLINE_BUCKETS; i++)
+        {
+            index->inlineBuckets[i] = NULL;
+        }
+        index->buckets = index->inlineBuckets;
+        index->bucketCount = PACKET_ID_INDEX_INLINE_BUCKETS;
+        index->count = 0;
+    }
+}
+
+void IoTHubClient_PacketIdIndex_Deinit(PACKET_ID_INDEX* index)
+{
+    if (index == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_003: [ If index is NULL, IoTHubClient_PacketIdIndex_Deinit shall do nothing. ]*/
+        LogError("invalid argument index=NULL");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_004: [ IoTHubClient_PacketIdIndex_Deinit shall free the bucket array if it was allocated and leave index empty; the entries themselves are not touched. ]*/
+        if (index->buckets != index->inlineBuckets)
+        {
+            free(index->buckets);
+        }
+        IoTHubClient_PacketIdIndex_Init(index);
+    }
+}
+
+int IoTHubClient_PacketIdIndex_Insert(PACKET_ID_INDEX* index, PACKET_ID_INDEX_ENTRY* entry, uint16_t packetId)
+{
+    int result;
+    if ((index == NULL) || (entry == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_005: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_Insert shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments index=%p, entry=%p", index, entry);
+        result = __LINE__;
+    }
+    else
+    {
+        size_t bucket;
+
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_007: [ When inserting would leave index with more entries than buckets and index has fewer buckets than packet ids, IoTHubClient_PacketIdIndex_Insert shall allocate twice as many buckets and move all the entries to them. ]*/
+        if ((index->count >= index->bucketCount) && (index->bucketCount < PACKET_ID_INDEX_MAX_BUCKETS))
+        {
+            grow_buckets(index);
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_006: [ IoTHubClient_PacketIdIndex_Insert shall store packetId in entry, link entry in the bucket selected by the low bits of packetId and return 0. ]*/
+        bucket = packetId & (index->bucketCount - 1);
+        entry->packetId = packetId;
+        entry->next = index->buckets[bucket];
+        index->buckets[bucket] = entry;
+        index->count++;
+        result = 0;
+    }
+    return result;
+}
+
+PACKET_ID_INDEX_ENTRY* IoTHubClient_PacketIdIndex_Remove(PACKET_ID_INDEX* index, uint16_t packetId)
+{
+    PACKET_ID_INDEX_ENTRY* result;
+    if (index == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_009: [ If index is NULL, IoTHubClient_PacketIdIndex_Remove shall fail and return NULL. ]*/
+        LogError("invalid argument index=NULL");
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_010: [ IoTHubClient_PacketIdIndex_Remove shall unlink and return the most recently inserted entry with packetId, or return NULL if there is none. ]*/
+        PACKET_ID_INDEX_ENTRY** link = &index->buckets[packetId & (index->bucketCount - 1)];
+        while ((*link != NULL) && ((*link)->packetId != packetId))
+        {
+            link = &(*link)->next;
+        }
+
+        result = *link;
+        if (result != NULL)
+        {
+            *link = result->next;
+            result->next = NULL;
+            index->count--;
+        }
+    }
+    return result;
+}
+
+int IoTHubClient_PacketIdIndex_RemoveEntry(PACKET_ID_INDEX* index, PACKET_ID_INDEX_ENTRY* entry)
+{
+    int result;
+    if ((index == NULL) || (entry == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_011: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_RemoveEntry shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments index=%p, entry=%p", index, entry);
+        result = __LINE__;
+    }
+    else
+    {
+        /*looking for the entry itself (not its packet id) is what makes this safe when a packet id has wrapped around*/
+        PACKET_ID_INDEX_ENTRY** link = &index->buckets[entry->packetId & (index->bucketCount - 1)];
+        while ((*link != NULL) && (*link != entry))
+        {
+            link = &(*link)->next;
+        }
+
+        if (*link == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_012: [ If entry is not in index, IoTHubClient_PacketIdIndex_RemoveEntry shall fail and return a non-zero value. ]*/
+            LogError("entry %p is not in the index", entry);
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_013: [ Otherwise IoTHubClient_PacketIdIndex_RemoveEntry shall unlink entry and return 0. ]*/
+            *link = entry->next;
+            entry->next = NULL;
+            index->count--;
+            result = 0;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,908 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/map.h"
+#include "iothub_client_persistent_queue.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#define SYNC_FILE(file) _commit(_fileno(file))
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define SYNC_FILE(file) fsync(fileno(file))
+#else
+/*platforms without a file descriptor API only get what fflush gives*/
+#define SYNC_FILE(file) 0
+#endif
+
+/*an entry is a 13 bytes header followed by the serialized message (the body)*/
+#define ENTRY_MAGIC 0x51544F49 /*"IOTQ"*/
+#define ENTRY_HEADER_SIZE 13 /*magic, body size, body checksum, state*/
+#define ENTRY_STATE_OFFSET 12
+#define ENTRY_STATE_PENDING 'P'
+#define ENTRY_STATE_DONE 'D'
+
+/*the body stores strings with their '\0', a size of 0 stands for a NULL string*/
+#define CONTENT_BYTEARRAY 1
+#define CONTENT_STRING 2
+
+#define INDEX_FILE_NAME "/iothub_queue.idx" /*holds the id of the oldest segment*/
+#define SEGMENT_FILE_NAME_FORMAT "%s/%08lu.iotq"
+#define MAX_FILE_NAME_LENGTH 26 /*'/', up to 20 digits and ".iotq"*/
+
+typedef struct SEGMENT_TAG
+{
+    FILE* file; /*NULL while the segment is closed*/
+    long size; /*end of the last valid entry*/
+    size_t pendingCount;
+    bool isDirty; /*written since it was last synced*/
+} SEGMENT;
+
+typedef struct PERSISTENT_QUEUE_TAG
+{
+    char* directory;
+    char* path; /*room for the path of any file of the queue*/
+    size_t segmentSize;
+    size_t syncCount;
+    size_t firstSegmentId;
+    VECTOR_HANDLE segments; /*SEGMENT firstSegmentId + i is at index i*/
+    size_t recoveredSegmentCount; /*the segments found by IoTHubClient_PersistentQueue_Create come first*/
+    size_t replaySegment; /*index of the segment read by IoTHubClient_PersistentQueue_GetNextRecovered*/
+    long replayOffset;
+    bool canAppendToLastSegment; /*false for recovered segments and after a failed write*/
+    size_t unflushedCount;
+    unsigned char* scratch; /*serialized entries are built and read here*/
+    size_t scratchSize;
+} PERSISTENT_QUEUE;
+
+typedef struct BODY_READER_TAG
+{
+    const unsigned char* position;
+    size_t remaining;
+} BODY_READER;
+
+static unsigned char* put_uint32(unsigned char* destination, uint32_t value)
+{
+    destination[0] = (unsigned char)(value & 0xFF);
+    destination[1] = (unsigned char)((value >> 8) & 0xFF);
+    destination[2] = (unsigned char)((value >> 16) & 0xFF);
+    destination[3] = (unsigned char)((value >> 24) & 0xFF);
+    return destination + 4;
+}
+
+static uint32_t get_uint32(const unsigned char* source)
+{
+    return (uint32_t)source[0] | ((uint32_t)source[1] << 8) | ((uint32_t)source[2] << 16) | ((uint32_t)source[3] << 24);
+}
+
+static size_t get_string_size(const char* value)
+{
+    return (value == NULL) ? 0 : strlen(value) + 1;
+}
+
+static unsigned char* put_string(unsigned char* destination, const char* value)
+{
+    size_t size = get_string_size(value);
+    destination = put_uint32(destination, (uint32_t)size);
+    if (size > 0)
+    {
+        (void)memcpy(destination, value, size);
+    }
+    return destination + size;
+}
+
+/*FNV-1a, enough to find a torn write*/
+static uint32_t compute_checksum(const unsigned char* data, size_t size)
+{
+    uint32_t result = 2166136261u;
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        result ^= data[i];
+        result *= 16777619u;
+    }
+    return result;
+}
+
+static int ensure_scratch_size(PERSISTENT_QUEUE* persistentQueue, size_t size)
+{
+    int result;
+    if (size <= persistentQueue->scratchSize)
+    {
+        result = 0;
+    }
+    else
+    {
+        unsigned char* newScratch = (unsigned char*)realloc(persistentQueue->scratch, size);
+        if (newScratch == NULL)
+        {
+            LogError("unable to realloc %zu bytes", size);
+            result = __LINE__;
+        }
+        else
+        {
+            persistentQueue->scratch = newScratch;
+            persistentQueue->scratchSize = size;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static const char* make_segment_path(PERSISTENT_QUEUE* persistentQueue, size_t segmentId)
+{
+    (void)sprintf(persistentQueue->path, SEGMENT_FILE_NAME_FORMAT, persistentQueue->directory, (unsigned long)segmentId);
+    return persistentQueue->path;
+}
+
+static const char* make_index_path(PERSISTENT_QUEUE* persistentQueue)
+{
+    (void)strcpy(persistentQueue->path, persistentQueue->directory);
+    (void)strcat(persistentQueue->path, INDEX_FILE_NAME);
+    return persistentQueue->path;
+}
+
+static int write_index(PERSISTENT_QUEUE* persistentQueue, size_t firstSegmentId)
+{
+    int result;
+    FILE* indexFile = fopen(make_index_path(persistentQueue), "wb");
+    if (indexFile == NULL)
+    {
+        LogError("unable to open %s", persistentQueue->path);
+        result = __LINE__;
+    }
+    else
+    {
+        if ((fprintf(indexFile, "%lu\n", (unsigned long)firstSegmentId) < 0) ||
+            (fflush(indexFile) != 0) ||
+            (SYNC_FILE(indexFile) != 0))
+        {
+            LogError("unable to write %s", persistentQueue->path);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        (void)fclose(indexFile);
+    }
+    return result;
+}
+
+static size_t read_index(PERSISTENT_QUEUE* persistentQueue)
+{
+    size_t result = 0;
+    FILE* indexFile = fopen(make_index_path(persistentQueue), "rb");
+    if (indexFile != NULL)
+    {
+        unsigned long firstSegmentId;
+        if (fscanf(indexFile, "%lu", &firstSegmentId) == 1)
+        {
+            result = (size_t)firstSegmentId;
+        }
+        (void)fclose(indexFile);
+    }
+    return result;
+}
+
+/*serializes message after the header room at the start of scratch*/
+static int serialize_message(PERSISTENT_QUEUE* persistentQueue, IOTHUB_MESSAGE_HANDLE message, size_t* bodySize)
+{
+    int result;
+    IOTHUBMESSAGE_CONTENT_TYPE contentType = IoTHubMessage_GetContentType(message);
+    const unsigned char* content;
+    size_t contentSize;
+    MAP_HANDLE properties;
+    const char*const* keys;
+    const char*const* values;
+    size_t propertyCount;
+
+    if (contentType == IOTHUBMESSAGE_BYTEARRAY)
+    {
+        result = (IoTHubMessage_GetByteArray(message, &content, &contentSize) == IOTHUB_MESSAGE_OK) ? 0 : __LINE__;
+    }
+    else if (contentType == IOTHUBMESSAGE_STRING)
+    {
+        content = (const unsigned char*)IoTHubMessage_GetString(message);
+        contentSize = get_string_size((const char*)content);
+        result = (content == NULL) ? __LINE__ : 0;
+    }
+    else
+    {
+        result = __LINE__;
+    }
+
+    if (result != 0)
+    {
+        LogError("unable to get the content of the message");
+    }
+    else if (((properties = IoTHubMessage_Properties(message)) == NULL) ||
+        (Map_GetInternals(properties, &keys, &values, &propertyCount) != MAP_OK))
+    {
+        LogError("unable to get the properties of the message");
+        result = __LINE__;
+    }
+    else
+    {
+        const char* messageId = IoTHubMessage_GetMessageId(message);
+        const char* correlationId = IoTHubMessage_GetCorrelationId(message);
+        size_t size = 1 + 4 + contentSize + 4 + get_string_size(messageId) + 4 + get_string_size(correlationId) + 4 + 4;
+        size_t i;
+        for (i = 0; i < propertyCount; i++)
+        {
+            size += 4 + get_string_size(keys[i]) + 4 + get_string_size(values[i]);
+        }
+
+        if (size > UINT32_MAX - ENTRY_HEADER_SIZE)
+        {
+            LogError("message too large to be persisted");
+            result = __LINE__;
+        }
+        else if (ensure_scratch_size(persistentQueue, ENTRY_HEADER_SIZE + size) != 0)
+        {
+            LogError("unable to grow the scratch buffer");
+            result = __LINE__;
+        }
+        else
+        {
+            unsigned char* position = persistentQueue->scratch + ENTRY_HEADER_SIZE;
+            *position++ = (contentType == IOTHUBMESSAGE_BYTEARRAY) ? CONTENT_BYTEARRAY : CONTENT_STRING;
+            position = put_uint32(position, (uint32_t)contentSize);
+            if (contentSize > 0)
+            {
+                (void)memcpy(position, content, contentSize);
+            }
+            position += contentSize;
+            position = put_string(position, messageId);
+            position = put_string(position, correlationId);
+            position = put_uint32(position, (uint32_t)IoTHubMessage_GetPriority(message));
+            position = put_uint32(position, (uint32_t)propertyCount);
+            for (i = 0; i < propertyCount; i++)
+            {
+                position = put_string(position, keys[i]);
+                position = put_string(position, values[i]);
+            }
+            *bodySize = size;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static bool read_uint32(BODY_READER* reader, uint32_t* value)
+{
+    bool result;
+    if (reader->remaining < 4)
+    {
+        result = false;
+    }
+    else
+    {
+        *value = get_uint32(reader->position);
+        reader->position += 4;
+        reader->remaining -= 4;
+        result = true;
+    }
+    return result;
+}
+
+static bool read_string(BODY_READER* reader, const char** value)
+{
+    bool result;
+    uint32_t size;
+    if (!read_uint32(reader, &size) || (size > reader->remaining))
+    {
+        result = false;
+    }
+    else if (size == 0)
+    {
+        *value = NULL;
+        result = true;
+    }
+    else if (reader->position[size - 1] != '\0')
+    {
+        result = false;
+    }
+    else
+    {
+        *value = (const char*)reader->position;
+        reader->position += size;
+        reader->remaining -= size;
+        result = true;
+    }
+    return result;
+}
+
+static IOTHUB_MESSAGE_HANDLE deserialize_message(const unsigned char* body, size_t bodySize)
+{
+    IOTHUB_MESSAGE_HANDLE result;
+    BODY_READER reader;
+    unsigned char contentType;
+    uint32_t contentSize;
+    const char* messageId;
+    const char* correlationId;
+    uint32_t priority;
+    uint32_t propertyCount;
+
+    reader.position = body + 1;
+    reader.remaining = (bodySize == 0) ? 0 : bodySize - 1;
+    contentType = (bodySize == 0) ? 0 : body[0];
+
+    if (!read_uint32(&reader, &contentSize) || (contentSize > reader.remaining))
+    {
+        LogError("invalid entry content");
+        result = NULL;
+    }
+    else
+    {
+        const unsigned char* content = reader.position;
+        reader.position += contentSize;
+        reader.remaining -= contentSize;
+
+        if (!read_string(&reader, &messageId) ||
+            !read_string(&reader, &correlationId) ||
+            !read_uint32(&reader, &priority) ||
+            !read_uint32(&reader, &propertyCount) ||
+            ((contentType != CONTENT_BYTEARRAY) && (contentType != CONTENT_STRING)) ||
+            ((contentType == CONTENT_STRING) && ((contentSize == 0) || (content[contentSize - 1] != '\0'))))
+        {
+            LogError("invalid entry");
+            result = NULL;
+        }
+        else if ((result = (contentType == CONTENT_BYTEARRAY) ? IoTHubMessage_CreateFromByteArray(content, contentSize) : IoTHubMessage_CreateFromString((const char*)content)) == NULL)
+        {
+            LogError("unable to create the message");
+        }
+        else
+        {
+            MAP_HANDLE properties = IoTHubMessage_Properties(result);
+            uint32_t i;
+            bool succeeded =
+                (properties != NULL) &&
+                ((messageId == NULL) || (IoTHubMessage_SetMessageId(result, messageId) == IOTHUB_MESSAGE_OK)) &&
+                ((correlationId == NULL) || (IoTHubMessage_SetCorrelationId(result, correlationId) == IOTHUB_MESSAGE_OK)) &&
+                (IoTHubMessage_SetPriority(result, (int)priority) == IOTHUB_MESSAGE_OK);
+
+            for (i = 0; succeeded && (i < propertyCount); i++)
+            {
+                const char* key;
+                const char* value;
+                succeeded =
+                    read_string(&reader, &key) && (key != NULL) &&
+                    read_string(&reader, &value) && (value != NULL) &&
+                    (Map_AddOrUpdate(properties, key, value) == MAP_OK);
+            }
+
+            if (!succeeded)
+            {
+                LogError("unable to restore the properties of the message");
+                IoTHubMessage_Destroy(result);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+/*reads the entry at offset, its body ends up at the start of scratch. Returns 0 only for a complete entry.*/
+static int read_entry(PERSISTENT_QUEUE* persistentQueue, FILE* file, long offset, size_t* bodySize, unsigned char* state)
+{
+    int result;
+    unsigned char header[ENTRY_HEADER_SIZE];
+    if ((fseek(file, offset, SEEK_SET) != 0) ||
+        (fread(header, 1, ENTRY_HEADER_SIZE, file) != ENTRY_HEADER_SIZE) ||
+        (get_uint32(header) != ENTRY_MAGIC))
+    {
+        /*end of the segment, or the header of the last entry was not written completely*/
+        result = __LINE__;
+    }
+    else
+    {
+        *bodySize = get_uint32(header + 4);
+        *state = header[ENTRY_STATE_OFFSET];
+        if ((ensure_scratch_size(persistentQueue, *bodySize) != 0) ||
+            (fread(persistentQueue->scratch, 1, *bodySize, file) != *bodySize) ||
+            (compute_checksum(persistentQueue->scratch, *bodySize) != get_uint32(header + 8)))
+        {
+            LogError("entry at offset %ld is incomplete", offset);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static void scan_segment(PERSISTENT_QUEUE* persistentQueue, SEGMENT* segment)
+{
+    size_t bodySize;
+    unsigned char state;
+    segment->size = 0;
+    segment->pendingCount = 0;
+    while (read_entry(persistentQueue, segment->file, segment->size, &bodySize, &state) == 0)
+    {
+        if (state == ENTRY_STATE_PENDING)
+        {
+            segment->pendingCount++;
+        }
+        segment->size += (long)(ENTRY_HEADER_SIZE + bodySize);
+    }
+}
+
+/*deletes the oldest segments as long as all their entries are done*/
+static void compact(PERSISTENT_QUEUE* persistentQueue)
+{
+    size_t segmentCount = VECTOR_size(persistentQueue->segments);
+    size_t removableCount = 0;
+    while (removableCount < segmentCount)
+    {
+        SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, removableCount);
+        if ((segment->pendingCount != 0) ||
+            ((removableCount == segmentCount - 1) && persistentQueue->canAppendToLastSegment))
+        {
+            break;
+        }
+        removableCount++;
+    }
+
+    /*the index moves first: a crash in between leaves files behind instead of losing the segments after them*/
+    /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_025: [ The index file shall be written and synced to the storage before any segment is deleted, and no segment shall be deleted if that fails. ]*/
+    if ((removableCount > 0) && (write_index(persistentQueue, persistentQueue->firstSegmentId + removableCount) == 0))
+    {
+        size_t i;
+        for (i = 0; i < removableCount; i++)
+        {
+            SEGMENT* segment = (SEGMENT*)VECTOR_front(persistentQueue->segments);
+            if (segment->file != NULL)
+            {
+                (void)fclose(segment->file);
+            }
+            if (remove(make_segment_path(persistentQueue, persistentQueue->firstSegmentId)) != 0)
+            {
+                LogError("unable to remove %s", persistentQueue->path);
+            }
+            VECTOR_erase(persistentQueue->segments, segment, 1);
+            persistentQueue->firstSegmentId++;
+
+            if (persistentQueue->recoveredSegmentCount > 0)
+            {
+                persistentQueue->recoveredSegmentCount--;
+                if (persistentQueue->replaySegment > 0)
+                {
+                    persistentQueue->replaySegment--;
+                }
+                else
+                {
+                    persistentQueue->replayOffset = 0;
+                }
+            }
+        }
+    }
+}
+
+static int sync_segment(PERSISTENT_QUEUE* persistentQueue, size_t index)
+{
+    int result;
+    SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, index);
+    if ((segment->file == NULL) || !segment->isDirty)
+    {
+        result = 0;
+    }
+    else if ((fflush(segment->file) != 0) ||
+        (SYNC_FILE(segment->file) != 0))
+    {
+        LogError("unable to flush segment %lu", (unsigned long)(persistentQueue->firstSegmentId + index));
+        result = __LINE__;
+    }
+    else
+    {
+        segment->isDirty = false;
+        result = 0;
+    }
+    return result;
+}
+
+static int flush_segments(PERSISTENT_QUEUE* persistentQueue)
+{
+    int result = 0;
+    size_t segmentCount = VECTOR_size(persistentQueue->segments);
+    size_t i;
+    for (i = 0; i < segmentCount; i++)
+    {
+        if (sync_segment(persistentQueue, i) != 0)
+        {
+            result = __LINE__;
+        }
+    }
+    persistentQueue->unflushedCount = 0;
+    return result;
+}
+
+static void close_segment(PERSISTENT_QUEUE* persistentQueue, size_t index)
+{
+    SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, index);
+    if (segment->file != NULL)
+    {
+        (void)sync_segment(persistentQueue, index);
+        (void)fclose(segment->file);
+        segment->file = NULL;
+    }
+}
+
+/*sealed segments are only touched by MarkDone and GetNextRecovered, so at most one of them is kept open at a time*/
+static FILE* open_segment(PERSISTENT_QUEUE* persistentQueue, size_t index)
+{
+    SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, index);
+    if (segment->file == NULL)
+    {
+        size_t sealedCount = VECTOR_size(persistentQueue->segments) - (persistentQueue->canAppendToLastSegment ? 1 : 0);
+        size_t i;
+        for (i = 0; i < sealedCount; i++)
+        {
+            close_segment(persistentQueue, i);
+        }
+
+        if ((segment->file = fopen(make_segment_path(persistentQueue, persistentQueue->firstSegmentId + index), "r+b")) == NULL)
+        {
+            LogError("unable to open %s", persistentQueue->path);
+        }
+    }
+    return segment->file;
+}
+
+static void destroy_persistent_queue(PERSISTENT_QUEUE* persistentQueue)
+{
+    if (persistentQueue->segments != NULL)
+    {
+        size_t segmentCount = VECTOR_size(persistentQueue->segments);
+        size_t i;
+        for (i = 0; i < segmentCount; i++)
+        {
+            SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, i);
+            if (segment->file != NULL)
+            {
+                (void)fclose(segment->file);
+            }
+        }
+        VECTOR_destroy(persistentQueue->segments);
+    }
+    free(persistentQueue->scratch);
+    free(persistentQueue->path);
+    free(persistentQueue->directory);
+    free(persistentQueue);
+}
+
+PERSISTENT_QUEUE_HANDLE IoTHubClient_PersistentQueue_Create(const char* directory, size_t segmentSize, size_t syncCount)
+{
+    PERSISTENT_QUEUE* result;
+    if ((directory == NULL) || (segmentSize == 0))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_001: [ If directory is NULL or segmentSize is 0, IoTHubClient_PersistentQueue_Create shall fail and return NULL. ]*/
+        LogError("invalid arguments directory=%p, segmentSize=%zu", directory, segmentSize);
+        result = NULL;
+    }
+    else if ((result = (PERSISTENT_QUEUE*)malloc(sizeof(PERSISTENT_QUEUE))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_004: [ If any allocation fails, or a segment file cannot be read, IoTHubClient_PersistentQueue_Create shall release everything it opened and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        size_t directoryLength = strlen(directory);
+        (void)memset(result, 0, sizeof(PERSISTENT_QUEUE));
+        result->segmentSize = segmentSize;
+        result->syncCount = syncCount;
+
+        if (((result->directory = (char*)malloc(directoryLength + 1)) == NULL) ||
+            ((result->path = (char*)malloc(directoryLength + MAX_FILE_NAME_LENGTH + 1)) == NULL) ||
+            ((result->segments = VECTOR_create(sizeof(SEGMENT))) == NULL))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_004: [ If any allocation fails, or a segment file cannot be read, IoTHubClient_PersistentQueue_Create shall release everything it opened and return NULL. ]*/
+            LogError("unable to allocate the persistent queue");
+            destroy_persistent_queue(result);
+            result = NULL;
+        }
+        else
+        {
+            SEGMENT segment;
+            bool succeeded = true;
+            (void)memcpy(result->directory, directory, directoryLength + 1);
+
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_002: [ IoTHubClient_PersistentQueue_Create shall open the segments of directory, starting with the one named in its index file, and count their pending entries. The segments end at the first incomplete entry. ]*/
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_023: [ IoTHubClient_PersistentQueue_Create shall close every segment once it is counted, a segment that is not appended to is opened again only to mark an entry done or to read it back. ]*/
+            result->firstSegmentId = read_index(result);
+            while (succeeded &&
+                ((segment.file = fopen(make_segment_path(result, result->firstSegmentId + VECTOR_size(result->segments)), "r+b")) != NULL))
+            {
+                scan_segment(result, &segment);
+                (void)fclose(segment.file);
+                segment.file = NULL;
+                segment.isDirty = false;
+                if (VECTOR_push_back(result->segments, &segment, 1) != 0)
+                {
+                    LogError("unable to add a segment");
+                    succeeded = false;
+                }
+            }
+
+            if (!succeeded)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_004: [ If any allocation fails, or a segment file cannot be read, IoTHubClient_PersistentQueue_Create shall release everything it opened and return NULL. ]*/
+                destroy_persistent_queue(result);
+                result = NULL;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_003: [ New entries shall never be appended to a segment found by IoTHubClient_PersistentQueue_Create, and the leading segments without pending entries shall be deleted. ]*/
+                result->recoveredSegmentCount = VECTOR_size(result->segments);
+                result->canAppendToLastSegment = false;
+                compact(result);
+            }
+        }
+    }
+    return result;
+}
+
+void IoTHubClient_PersistentQueue_Destroy(PERSISTENT_QUEUE_HANDLE persistentQueue)
+{
+    /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_005: [ If persistentQueue is NULL, IoTHubClient_PersistentQueue_Destroy shall do nothing. ]*/
+    if (persistentQueue != NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_006: [ Otherwise IoTHubClient_PersistentQueue_Destroy shall flush and close all the segments and free the queue. Pending entries stay in the directory. ]*/
+        (void)flush_segments(persistentQueue);
+        destroy_persistent_queue(persistentQueue);
+    }
+}
+
+int IoTHubClient_PersistentQueue_Append(PERSISTENT_QUEUE_HANDLE persistentQueue, IOTHUB_MESSAGE_HANDLE message, PERSISTENT_QUEUE_ENTRY* entry)
+{
+    int result;
+    size_t bodySize;
+    if ((persistentQueue == NULL) || (message == NULL) || (entry == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_007: [ If persistentQueue, message or entry is NULL, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments persistentQueue=%p, message=%p, entry=%p", persistentQueue, message, entry);
+        result = __LINE__;
+    }
+    else if (serialize_message(persistentQueue, message, &bodySize) != 0)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_011: [ If the message cannot be serialized or written, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value; after a failed write the next entry goes to a new segment. ]*/
+        LogError("unable to serialize the message");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t entrySize = ENTRY_HEADER_SIZE + bodySize;
+        size_t segmentCount = VECTOR_size(persistentQueue->segments);
+        SEGMENT* segment = (segmentCount == 0) ? NULL : (SEGMENT*)VECTOR_back(persistentQueue->segments);
+
+        result = 0;
+        if ((segment == NULL) ||
+            (!persistentQueue->canAppendToLastSegment) ||
+            ((segment->size > 0) && ((size_t)segment->size + entrySize > persistentQueue->segmentSize)))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_009: [ IoTHubClient_PersistentQueue_Append shall start a new segment when the entry would make the current one larger than segmentSize. ]*/
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_024: [ Before starting a new segment, IoTHubClient_PersistentQueue_Append shall sync and close the current one. ]*/
+            SEGMENT newSegment;
+            if (segment != NULL)
+            {
+                close_segment(persistentQueue, segmentCount - 1);
+                persistentQueue->canAppendToLastSegment = false;
+            }
+
+            newSegment.size = 0;
+            newSegment.pendingCount = 0;
+            newSegment.isDirty = false;
+            if ((newSegment.file = fopen(make_segment_path(persistentQueue, persistentQueue->firstSegmentId + segmentCount), "w+b")) == NULL)
+            {
+                LogError("unable to create %s", persistentQueue->path);
+                result = __LINE__;
+            }
+            else if (VECTOR_push_back(persistentQueue->segments, &newSegment, 1) != 0)
+            {
+                LogError("unable to add a segment");
+                (void)fclose(newSegment.file);
+                (void)remove(persistentQueue->path);
+                result = __LINE__;
+            }
+            else
+            {
+                persistentQueue->canAppendToLastSegment = true;
+                /*the segment that just got full may be done already*/
+                compact(persistentQueue);
+                segment = (SEGMENT*)VECTOR_back(persistentQueue->segments);
+            }
+        }
+
+        if (result != 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_011: [ If the message cannot be serialized or written, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value; after a failed write the next entry goes to a new segment. ]*/
+            LogError("unable to get a segment to append to");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_008: [ IoTHubClient_PersistentQueue_Append shall serialize the payload, message id, correlation id, priority and properties of message and write them at the end of the current segment as a pending entry, then fill entry. ]*/
+            unsigned char* header = persistentQueue->scratch;
+            (void)put_uint32(header, ENTRY_MAGIC);
+            (void)put_uint32(header + 4, (uint32_t)bodySize);
+            (void)put_uint32(header + 8, compute_checksum(persistentQueue->scratch + ENTRY_HEADER_SIZE, bodySize));
+            header[ENTRY_STATE_OFFSET] = ENTRY_STATE_PENDING;
+
+            if ((fseek(segment->file, segment->size, SEEK_SET) != 0) ||
+                (fwrite(persistentQueue->scratch, 1, entrySize, segment->file) != entrySize))
+            {
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_011: [ If the message cannot be serialized or written, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value; after a failed write the next entry goes to a new segment. ]*/
+                LogError("unable to write the entry");
+                persistentQueue->canAppendToLastSegment = false;
+                result = __LINE__;
+            }
+            else
+            {
+                entry->segmentId = persistentQueue->firstSegmentId + VECTOR_size(persistentQueue->segments) - 1;
+                entry->offset = segment->size;
+                segment->size += (long)entrySize;
+                segment->pendingCount++;
+                segment->isDirty = true;
+                persistentQueue->unflushedCount++;
+
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_010: [ If syncCount is not 0, IoTHubClient_PersistentQueue_Append shall flush the segments once syncCount writes (entries or done marks) happened since the last flush. ]*/
+                if ((persistentQueue->syncCount != 0) && (persistentQueue->unflushedCount >= persistentQueue->syncCount))
+                {
+                    (void)flush_segments(persistentQueue);
+                }
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+int IoTHubClient_PersistentQueue_MarkDone(PERSISTENT_QUEUE_HANDLE persistentQueue, const PERSISTENT_QUEUE_ENTRY* entry)
+{
+    int result;
+    if ((persistentQueue == NULL) || (entry == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_012: [ If persistentQueue or entry is NULL, or entry is not in a segment of the queue, IoTHubClient_PersistentQueue_MarkDone shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments persistentQueue=%p, entry=%p", persistentQueue, entry);
+        result = __LINE__;
+    }
+    else if ((entry->segmentId < persistentQueue->firstSegmentId) ||
+        (entry->segmentId - persistentQueue->firstSegmentId >= VECTOR_size(persistentQueue->segments)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_012: [ If persistentQueue or entry is NULL, or entry is not in a segment of the queue, IoTHubClient_PersistentQueue_MarkDone shall fail and return a non-zero value. ]*/
+        LogError("segment %lu is not part of the queue", (unsigned long)entry->segmentId);
+        result = __LINE__;
+    }
+    else
+    {
+        SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, entry->segmentId - persistentQueue->firstSegmentId);
+        FILE* file = open_segment(persistentQueue, entry->segmentId - persistentQueue->firstSegmentId);
+        int state;
+        if ((file == NULL) ||
+            (fseek(file, entry->offset + ENTRY_STATE_OFFSET, SEEK_SET) != 0) ||
+            ((state = fgetc(file)) == EOF))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_015: [ If the state of the entry cannot be read or written, IoTHubClient_PersistentQueue_MarkDone shall fail and return a non-zero value. ]*/
+            LogError("unable to read the state of the entry");
+            result = __LINE__;
+        }
+        else if (state == ENTRY_STATE_DONE)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_014: [ Marking an entry that is already done shall succeed and change nothing. ]*/
+            result = 0;
+        }
+        else if ((fseek(file, entry->offset + ENTRY_STATE_OFFSET, SEEK_SET) != 0) ||
+            (fputc(ENTRY_STATE_DONE, file) == EOF))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_015: [ If the state of the entry cannot be read or written, IoTHubClient_PersistentQueue_MarkDone shall fail and return a non-zero value. ]*/
+            LogError("unable to write the state of the entry");
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_013: [ IoTHubClient_PersistentQueue_MarkDone shall mark the entry done in its segment and delete the leading segments that have no pending entry left, except the one being appended to. ]*/
+            if (segment->pendingCount > 0)
+            {
+                segment->pendingCount--;
+            }
+            segment->isDirty = true;
+            persistentQueue->unflushedCount++;
+            if ((segment->pendingCount == 0) && (entry->segmentId == persistentQueue->firstSegmentId))
+            {
+                compact(persistentQueue);
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+IOTHUB_MESSAGE_HANDLE IoTHubClient_PersistentQueue_GetNextRecovered(PERSISTENT_QUEUE_HANDLE persistentQueue, PERSISTENT_QUEUE_ENTRY* entry)
+{
+    IOTHUB_MESSAGE_HANDLE result = NULL;
+    if ((persistentQueue == NULL) || (entry == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_016: [ If persistentQueue or entry is NULL, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL. ]*/
+        LogError("invalid arguments persistentQueue=%p, entry=%p", persistentQueue, entry);
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_017: [ IoTHubClient_PersistentQueue_GetNextRecovered shall return a new message rebuilt from the next pending entry of the segments found by IoTHubClient_PersistentQueue_Create, and fill entry. ]*/
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_018: [ When there is no such entry left, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL. ]*/
+        while ((result == NULL) && (persistentQueue->replaySegment < persistentQueue->recoveredSegmentCount))
+        {
+            SEGMENT* segment = (SEGMENT*)VECTOR_element(persistentQueue->segments, persistentQueue->replaySegment);
+            size_t bodySize;
+            unsigned char state;
+            long offset = persistentQueue->replayOffset;
+            FILE* file;
+
+            if (offset >= segment->size)
+            {
+                persistentQueue->replaySegment++;
+                persistentQueue->replayOffset = 0;
+            }
+            else if ((file = open_segment(persistentQueue, persistentQueue->replaySegment)) == NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_019: [ If the message cannot be rebuilt, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL and return the same entry on the next call. ]*/
+                LogError("unable to open segment %lu", (unsigned long)(persistentQueue->firstSegmentId + persistentQueue->replaySegment));
+                break;
+            }
+            else if (read_entry(persistentQueue, file, offset, &bodySize, &state) != 0)
+            {
+                persistentQueue->replaySegment++;
+                persistentQueue->replayOffset = 0;
+            }
+            else if (state != ENTRY_STATE_PENDING)
+            {
+                persistentQueue->replayOffset += (long)(ENTRY_HEADER_SIZE + bodySize);
+            }
+            else if ((result = deserialize_message(persistentQueue->scratch, bodySize)) == NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_019: [ If the message cannot be rebuilt, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL and return the same entry on the next call. ]*/
+                LogError("unable to rebuild the message at offset %ld of segment %lu", offset, (unsigned long)(persistentQueue->firstSegmentId + persistentQueue->replaySegment));
+                break;
+            }
+            else
+            {
+                entry->segmentId = persistentQueue->firstSegmentId + persistentQueue->replaySegment;
+                entry->offset = offset;
+                persistentQueue->replayOffset += (long)(ENTRY_HEADER_SIZE + bodySize);
+            }
+        }
+    }
+    return result;
+}
+
+int IoTHubClient_PersistentQueue_Flush(PERSISTENT_QUEUE_HANDLE persistentQueue)
+{
+    int result;
+    if (persistentQueue == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_020: [ If persistentQueue is NULL, IoTHubClient_PersistentQueue_Flush shall fail and return a non-zero value. ]*/
+        LogError("invalid argument persistentQueue=NULL");
+        result = __LINE__;
+    }
+    else if (persistentQueue->unflushedCount == 0)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_022: [ If nothing was written since the last flush, IoTHubClient_PersistentQueue_Flush shall return 0 without flushing. ]*/
+        result = 0;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_021: [ Otherwise IoTHubClient_PersistentQueue_Flush shall flush the segments written since they were last flushed and return 0, or a non-zero value if any flush fails. ]*/
+        result = flush_segments(persistentQueue);
+    }
+    return result;
+}
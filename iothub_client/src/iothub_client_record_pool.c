@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_record_pool.h"
+
+/*every record is preceded by a header telling where it came from; the union keeps the record aligned*/
+typedef union RECORD_HEADER_TAG
+{
+    struct RECORD_POOL_TAG* recordPool; /*NULL when the record was allocated with malloc*/
+    void* alignPointer;
+    uint64_t alignInteger;
+    long double alignFloat;
+} RECORD_HEADER;
+
+typedef struct FREE_RECORD_TAG
+{
+    struct FREE_RECORD_TAG* next;
+} FREE_RECORD;
+
+typedef struct RECORD_POOL_TAG
+{
+    unsigned char* block;
+    size_t recordSize;
+    size_t slotSize; /*header + record, rounded up to a multiple of the header size*/
+    FREE_RECORD* freeRecords;
+    RECORD_POOL_STATISTICS statistics;
+    int destroyed; /*set when IoTHubClient_RecordPool_Destroy was called while records were in use*/
+} RECORD_POOL;
+
+static void free_record_pool(RECORD_POOL* recordPool)
+{
+    free(recordPool->block);
+    free(recordPool);
+}
+
+RECORD_POOL_HANDLE IoTHubClient_RecordPool_Create(size_t recordSize, size_t capacity)
+{
+    RECORD_POOL* result;
+    size_t slotSize = sizeof(RECORD_HEADER) + ((recordSize + sizeof(RECORD_HEADER) - 1) / sizeof(RECORD_HEADER)) * sizeof(RECORD_HEADER);
+
+    if ((recordSize == 0) || (capacity == 0) || (capacity > SIZE_MAX / slotSize))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_001: [ If recordSize or capacity is 0, or the pool would not fit in memory, IoTHubClient_RecordPool_Create shall fail and return NULL. ]*/
+        LogError("invalid arguments recordSize=%zu, capacity=%zu", recordSize, capacity);
+        result = NULL;
+    }
+    else if ((result = (RECORD_POOL*)malloc(sizeof(RECORD_POOL))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_003: [ If any allocation fails, IoTHubClient_RecordPool_Create shall free everything it allocated and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_002: [ IoTHubClient_RecordPool_Create shall allocate the pool and a single block holding capacity records, and put all the records in the free list. ]*/
+    else if ((result->block = (unsigned char*)malloc(capacity * slotSize)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_003: [ If any allocation fails, IoTHubClient_RecordPool_Create shall free everything it allocated and return NULL. ]*/
+        LogError("unable to malloc the records block");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        size_t i;
+        result->recordSize = recordSize;
+        result->slotSize = slotSize;
+        result->freeRecords = NULL;
+        result->statistics.capacity = capacity;
+        result->statistics.inUse = 0;
+        result->statistics.hits = 0;
+        result->statistics.misses = 0;
+        result->destroyed = 0;
+
+        /*build the free list backwards so records are handed out in address order*/
+        for (i = capacity; i > 0; i--)
+        {
+            RECORD_HEADER* header = (RECORD_HEADER*)(result->block + (i - 1) * slotSize);
+            FREE_RECORD* freeRecord = (FREE_RECORD*)(header + 1);
+            header->recordPool = result;
+            freeRecord->next = result->freeRecords;
+            result->freeRecords = freeRecord;
+        }
+    }
+    return result;
+}
+
+void IoTHubClient_RecordPool_Destroy(RECORD_POOL_HANDLE recordPool)
+{
+    /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_004: [ If recordPool is NULL, IoTHubClient_RecordPool_Destroy shall do nothing. ]*/
+    if (recordPool != NULL)
+    {
+        if (recordPool->statistics.inUse == 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_005: [ If no record of the pool is in use, IoTHubClient_RecordPool_Destroy shall free the pool. ]*/
+            free_record_pool(recordPool);
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_006: [ Otherwise the pool shall be freed when its last record is freed. ]*/
+            recordPool->destroyed = 1;
+        }
+    }
+}
+
+void* IoTHubClient_RecordPool_Alloc(RECORD_POOL_HANDLE recordPool, size_t recordSize)
+{
+    void* result;
+    if ((recordPool != NULL) && (recordPool->freeRecords != NULL) && (recordSize <= recordPool->recordSize))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_007: [ If recordPool has a free record and recordSize is not larger than the record size of the pool, IoTHubClient_RecordPool_Alloc shall take the record from the free list and count a hit. ]*/
+        FREE_RECORD* freeRecord = recordPool->freeRecords;
+        recordPool->freeRecords = freeRecord->next;
+        recordPool->statistics.inUse++;
+        recordPool->statistics.hits++;
+        result = freeRecord;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_008: [ Otherwise IoTHubClient_RecordPool_Alloc shall allocate the record with malloc and, if recordPool is not NULL, count a miss. ]*/
+        RECORD_HEADER* header = (RECORD_HEADER*)malloc(sizeof(RECORD_HEADER) + recordSize);
+        if (header == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_009: [ If malloc fails, IoTHubClient_RecordPool_Alloc shall return NULL. ]*/
+            LogError("unable to malloc");
+            result = NULL;
+        }
+        else
+        {
+            header->recordPool = NULL;
+            result = header + 1;
+        }
+        if (recordPool != NULL)
+        {
+            recordPool->statistics.misses++;
+        }
+    }
+    return result;
+}
+
+void IoTHubClient_RecordPool_Free(void* record)
+{
+    /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_010: [ If record is NULL, IoTHubClient_RecordPool_Free shall do nothing. ]*/
+    if (record != NULL)
+    {
+        RECORD_HEADER* header = (RECORD_HEADER*)record - 1;
+        RECORD_POOL* recordPool = header->recordPool;
+        if (recordPool == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_011: [ If the record was allocated with malloc, IoTHubClient_RecordPool_Free shall free it. ]*/
+            free(header);
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_012: [ Otherwise IoTHubClient_RecordPool_Free shall put the record back in the free list of its pool. ]*/
+            FREE_RECORD* freeRecord = (FREE_RECORD*)record;
+            freeRecord->next = recordPool->freeRecords;
+            recordPool->freeRecords = freeRecord;
+            recordPool->statistics.inUse--;
+            if ((recordPool->destroyed) && (recordPool->statistics.inUse == 0))
+            {
+                /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_006: [ Otherwise the pool shall be freed when its last record is freed. ]*/
+                free_record_pool(recordPool);
+            }
+        }
+    }
+}
+
+int IoTHubClient_RecordPool_GetStatistics(RECORD_POOL_HANDLE recordPool, RECORD_POOL_STATISTICS* statistics)
+{
+    int result;
+    if ((recordPool == NULL) || (statistics == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_013: [ If recordPool or statistics is NULL, IoTHubClient_RecordPool_GetStatistics shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments recordPool=%p, statistics=%p", recordPool, statistics);
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_RECORD_POOL_41_014: [ Otherwise IoTHubClient_RecordPool_GetStatistics shall copy the capacity, the number of records in use, the hits and the misses of the pool to statistics and return 0. ]*/
+        *statistics = recordPool->statistics;
+        result = 0;
+    }
+    return result;
+}
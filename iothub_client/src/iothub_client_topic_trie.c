@@ -0,0 +1,256 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_topic_trie.h"
+
+#define TOPIC_TRIE_ROOT 0
+#define TOPIC_TRIE_NO_VALUE -1
+
+static bool is_level(const TOPIC_TRIE_NODE* node, const char* level, size_t levelLength)
+{
+    return (node->levelLength == levelLength) && (memcmp(node->level, level, levelLength) == 0);
+}
+
+static int validate_filter(const TOPIC_TRIE* trie, const char* filter)
+{
+    int result = 0;
+    size_t levelCount = 0;
+    size_t plusCount = 0;
+    const char* level = filter;
+
+    while ((result == 0) && (level != NULL))
+    {
+        size_t levelLength = strcspn(level, "/");
+        const char* next = (level[levelLength] == '/') ? (level + levelLength + 1) : NULL;
+
+        if ((levelLength == 1) && (level[0] == '+'))
+        {
+            plusCount++;
+        }
+        else if ((levelLength == 1) && (level[0] == '#'))
+        {
+            if (next != NULL)
+            {
+                result = __LINE__;
+            }
+        }
+        else if ((memchr(level, '+', levelLength) != NULL) || (memchr(level, '#', levelLength) != NULL))
+        {
+            result = __LINE__;
+        }
+
+        levelCount++;
+        level = next;
+    }
+
+    if (result != 0)
+    {
+        LogError("filter %s uses a wildcard that is not a whole level or a '#' that is not the last level", filter);
+    }
+    else if (plusCount > TOPIC_TRIE_MAX_CAPTURES)
+    {
+        LogError("filter %s has %zu '+' levels, at most %d can be captured", filter, plusCount, TOPIC_TRIE_MAX_CAPTURES);
+        result = __LINE__;
+    }
+    else if (trie->nodeCount + levelCount > TOPIC_TRIE_MAX_NODES)
+    {
+        /*counting every level as new is pessimistic, but it means a filter is either added whole or not at all*/
+        LogError("filter %s does not fit, %zu of %d nodes are used", filter, trie->nodeCount, TOPIC_TRIE_MAX_NODES);
+        result = __LINE__;
+    }
+    return result;
+}
+
+static bool match_levels(const TOPIC_TRIE* trie, uint8_t nodeIndex, const char* level, TOPIC_TRIE_MATCH* match)
+{
+    bool result = false;
+    const TOPIC_TRIE_NODE* node = &trie->nodes[nodeIndex];
+    uint8_t child;
+
+    if (level == NULL)
+    {
+        /*all the levels of the topic are consumed, either a filter ends here or a '#' child matches zero levels*/
+        if (node->value != TOPIC_TRIE_NO_VALUE)
+        {
+            match->value = node->value;
+            match->remainder = "";
+            result = true;
+        }
+        else
+        {
+            for (child = node->firstChild; (child != TOPIC_TRIE_ROOT) && !result; child = trie->nodes[child].nextSibling)
+            {
+                if (is_level(&trie->nodes[child], "#", 1))
+                {
+                    match->value = trie->nodes[child].value;
+                    match->remainder = "";
+                    result = true;
+                }
+            }
+        }
+    }
+    else
+    {
+        size_t levelLength = strcspn(level, "/");
+        const char* next = (level[levelLength] == '/') ? (level + levelLength + 1) : NULL;
+
+        /*literal levels first, then '+', then '#', backtracking when a branch does not reach a filter*/
+        for (child = node->firstChild; (child != TOPIC_TRIE_ROOT) && !result; child = trie->nodes[child].nextSibling)
+        {
+            if (!is_level(&trie->nodes[child], "+", 1) && !is_level(&trie->nodes[child], "#", 1) &&
+                is_level(&trie->nodes[child], level, levelLength))
+            {
+                result = match_levels(trie, child, next, match);
+            }
+        }
+
+        for (child = node->firstChild; (child != TOPIC_TRIE_ROOT) && !result; child = trie->nodes[child].nextSibling)
+        {
+            if (is_level(&trie->nodes[child], "+", 1))
+            {
+                size_t captureIndex = match->captureCount;
+                match->captures[captureIndex] = level;
+                match->captureLengths[captureIndex] = levelLength;
+                match->captureCount++;
+                result = match_levels(trie, child, next, match);
+                if (!result)
+                {
+                    match->captureCount = captureIndex;
+                }
+            }
+        }
+
+        for (child = node->firstChild; (child != TOPIC_TRIE_ROOT) && !result; child = trie->nodes[child].nextSibling)
+        {
+            if (is_level(&trie->nodes[child], "#", 1))
+            {
+                match->value = trie->nodes[child].value;
+                match->remainder = level;
+                result = true;
+            }
+        }
+    }
+    return result;
+}
+
+void IoTHubClient_TopicTrie_Init(TOPIC_TRIE* trie)
+{
+    if (trie == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_001: [ If trie is NULL, IoTHubClient_TopicTrie_Init shall do nothing. ]*/
+        LogError("invalid argument trie=NULL");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_002: [ IoTHubClient_TopicTrie_Init shall leave trie with only its root node, so that no topic matches. ]*/
+        trie->nodes[TOPIC_TRIE_ROOT].level = "";
+        trie->nodes[TOPIC_TRIE_ROOT].levelLength = 0;
+        trie->nodes[TOPIC_TRIE_ROOT].firstChild = TOPIC_TRIE_ROOT;
+        trie->nodes[TOPIC_TRIE_ROOT].nextSibling = TOPIC_TRIE_ROOT;
+        trie->nodes[TOPIC_TRIE_ROOT].value = TOPIC_TRIE_NO_VALUE;
+        trie->nodeCount = 1;
+    }
+}
+
+int IoTHubClient_TopicTrie_Add(TOPIC_TRIE* trie, const char* filter, int value)
+{
+    int result;
+    if ((trie == NULL) || (filter == NULL) || (filter[0] == '\0') || (value < 0))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_003: [ If trie or filter is NULL, filter is empty or value is negative, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments trie=%p, filter=%p, value=%d", trie, filter, value);
+        result = __LINE__;
+    }
+    /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_004: [ If a level of filter contains '+' or '#' but is not exactly "+" or "#", or "#" is not the last level, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+    /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_005: [ If filter has more than TOPIC_TRIE_MAX_CAPTURES "+" levels, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+    /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_006: [ If trie might not have a free node for every level of filter, IoTHubClient_TopicTrie_Add shall fail, leave trie unchanged and return a non-zero value. ]*/
+    else if (validate_filter(trie, filter) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        uint8_t nodeIndex = TOPIC_TRIE_ROOT;
+        const char* level = filter;
+
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_007: [ IoTHubClient_TopicTrie_Add shall walk trie one level of filter at a time, reusing the node of a level already present and adding a node pointing into filter otherwise; filter is not copied. ]*/
+        while (level != NULL)
+        {
+            size_t levelLength = strcspn(level, "/");
+            uint8_t child = trie->nodes[nodeIndex].firstChild;
+
+            while ((child != TOPIC_TRIE_ROOT) && !is_level(&trie->nodes[child], level, levelLength))
+            {
+                child = trie->nodes[child].nextSibling;
+            }
+
+            if (child == TOPIC_TRIE_ROOT)
+            {
+                child = (uint8_t)trie->nodeCount;
+                trie->nodes[child].level = level;
+                trie->nodes[child].levelLength = levelLength;
+                trie->nodes[child].firstChild = TOPIC_TRIE_ROOT;
+                trie->nodes[child].nextSibling = trie->nodes[nodeIndex].firstChild;
+                trie->nodes[child].value = TOPIC_TRIE_NO_VALUE;
+                trie->nodes[nodeIndex].firstChild = child;
+                trie->nodeCount++;
+            }
+
+            nodeIndex = child;
+            level = (level[levelLength] == '/') ? (level + levelLength + 1) : NULL;
+        }
+
+        if (trie->nodes[nodeIndex].value != TOPIC_TRIE_NO_VALUE)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_008: [ If filter is already in trie, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+            LogError("filter %s is already in the trie", filter);
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_009: [ Otherwise IoTHubClient_TopicTrie_Add shall store value at the node of the last level of filter and return 0. ]*/
+            trie->nodes[nodeIndex].value = value;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+int IoTHubClient_TopicTrie_Match(const TOPIC_TRIE* trie, const char* topic, TOPIC_TRIE_MATCH* match)
+{
+    int result;
+    if ((trie == NULL) || (topic == NULL) || (match == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_010: [ If trie, topic or match is NULL, IoTHubClient_TopicTrie_Match shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments trie=%p, topic=%p, match=%p", trie, topic, match);
+        result = __LINE__;
+    }
+    else
+    {
+        match->value = TOPIC_TRIE_NO_VALUE;
+        match->captureCount = 0;
+        match->remainder = "";
+
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_011: [ IoTHubClient_TopicTrie_Match shall compare topic to the filters of trie level by level, trying a literal level before "+" and "+" before "#" and backtracking when a branch does not end on a filter. ]*/
+        /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_012: [ On a match IoTHubClient_TopicTrie_Match shall set match->value to the value of the filter, match->captures/captureLengths to the topic levels matched by each "+", match->remainder to the part of topic matched by "#" (an empty string if none) and return 0, all pointing into topic. ]*/
+        if (match_levels(trie, TOPIC_TRIE_ROOT, topic, match))
+        {
+            result = 0;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_013: [ If no filter matches topic, IoTHubClient_TopicTrie_Match shall return a non-zero value. ]*/
+            match->captureCount = 0;
+            result = __LINE__;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stddef.h>
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_url_encode.h"
+
+#define URL_ENCODE_ESCAPE '%'
+#define URL_ENCODE_INVALID 0xFF
+
+static const char urlEncodeHexDigits[16] =
+{
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+static int isUnreserved(unsigned char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ||
+        ((c >= 'a') && (c <= 'z')) ||
+        ((c >= '0') && (c <= '9')) ||
+        (c == '-') || (c == '.') || (c == '_') || (c == '~');
+}
+
+static unsigned char hexValue(char c)
+{
+    unsigned char result;
+    if ((c >= '0') && (c <= '9'))
+    {
+        result = (unsigned char)(c - '0');
+    }
+    else if ((c >= 'A') && (c <= 'F'))
+    {
+        result = (unsigned char)(c - 'A' + 10);
+    }
+    else if ((c >= 'a') && (c <= 'f'))
+    {
+        result = (unsigned char)(c - 'a' + 10);
+    }
+    else
+    {
+        result = URL_ENCODE_INVALID;
+    }
+    return result;
+}
+
+size_t IoTHubClient_UrlEncode_GetEncodedLength(const char* source, size_t length)
+{
+    size_t result;
+    if (source == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_001: [ If source is NULL, IoTHubClient_UrlEncode_GetEncodedLength shall return 0. ]*/
+        result = 0;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_002: [ IoTHubClient_UrlEncode_GetEncodedLength shall return the number of characters needed to encode the first length characters of source: 1 for every unreserved character and 3 for every other one. ]*/
+        size_t i;
+        result = length;
+        for (i = 0; i < length; i++)
+        {
+            if (!isUnreserved((unsigned char)source[i]))
+            {
+                result += 2;
+            }
+        }
+    }
+    return result;
+}
+
+int IoTHubClient_UrlEncode_Encode(char* destination, const char* source, size_t length)
+{
+    int result;
+    if ((destination == NULL) || ((source == NULL) && (length != 0)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_003: [ If destination is NULL, or source is NULL while length is not 0, IoTHubClient_UrlEncode_Encode shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments destination=%p, source=%p, length=%zu", destination, source, length);
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_004: [ IoTHubClient_UrlEncode_Encode shall write the IoTHubClient_UrlEncode_GetEncodedLength(source, length) characters of the encoding of source at destination, using upper case hexadecimal digits and without a terminating '\0'. ]*/
+        size_t i;
+        for (i = 0; i < length; i++)
+        {
+            unsigned char c = (unsigned char)source[i];
+            if (isUnreserved(c))
+            {
+                *destination++ = (char)c;
+            }
+            else
+            {
+                *destination++ = URL_ENCODE_ESCAPE;
+                *destination++ = urlEncodeHexDigits[c >> 4];
+                *destination++ = urlEncodeHexDigits[c & 0x0F];
+            }
+        }
+        result = 0;
+    }
+    return result;
+}
+
+int IoTHubClient_UrlEncode_Decode(char* destination, const char* source, size_t length, size_t* decodedLength)
+{
+    int result;
+    if ((destination == NULL) || (decodedLength == NULL) || ((source == NULL) && (length != 0)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_005: [ If destination or decodedLength is NULL, or source is NULL while length is not 0, IoTHubClient_UrlEncode_Decode shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments destination=%p, source=%p, length=%zu, decodedLength=%p", destination, source, length, decodedLength);
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i = 0;
+        size_t written = 0;
+        result = 0;
+        while ((i < length) && (result == 0))
+        {
+            if (source[i] != URL_ENCODE_ESCAPE)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_006: [ IoTHubClient_UrlEncode_Decode shall copy every character of source other than '%' as it is. ]*/
+                destination[written++] = source[i++];
+            }
+            else
+            {
+                unsigned char high = (i + 2 < length) ? hexValue(source[i + 1]) : URL_ENCODE_INVALID;
+                unsigned char low = (i + 2 < length) ? hexValue(source[i + 2]) : URL_ENCODE_INVALID;
+                if ((high == URL_ENCODE_INVALID) || (low == URL_ENCODE_INVALID))
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_008: [ If a '%' is not followed by two hexadecimal digits, IoTHubClient_UrlEncode_Decode shall fail and return a non-zero value. ]*/
+                    LogError("invalid escape sequence at offset %zu", i);
+                    result = __LINE__;
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_007: [ IoTHubClient_UrlEncode_Decode shall replace every '%' followed by two hexadecimal digits, in upper or lower case, by the byte they encode. ]*/
+                    destination[written++] = (char)((high << 4) | low);
+                    i += 3;
+                }
+            }
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_URL_ENCODE_41_009: [ On success IoTHubClient_UrlEncode_Decode shall set decodedLength to the number of characters written at destination, without a terminating '\0', and return 0. ]*/
+        *decodedLength = written;
+    }
+    return result;
+}
@@ -0,0 +1,532 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "iothub_client_worker_pool_private.h"
+
+#define WORKER_POOL_ITEM_STATE_VALUES \
+    WORKER_POOL_ITEM_STATE_SCHEDULED, \
+    WORKER_POOL_ITEM_STATE_READY, \
+    WORKER_POOL_ITEM_STATE_RUNNING, \
+    WORKER_POOL_ITEM_STATE_DETACHED
+
+DEFINE_ENUM(WORKER_POOL_ITEM_STATE, WORKER_POOL_ITEM_STATE_VALUES)
+
+typedef struct WORKER_POOL_ITEM_TAG
+{
+    struct IOTHUB_CLIENT_WORKER_POOL_TAG* workerPool;
+    WORKER_POOL_DO_WORK doWork;
+    void* context;
+    size_t homeWorker; /*index of the worker whose ready queue receives this item, so it tends to run on the same thread*/
+    tickcounter_ms_t nextRun;
+    WORKER_POOL_ITEM_STATE state;
+    int signalled; /*set when IoTHubClient_WorkerPool_Signal is called while the item is running*/
+    int removed;
+    COND_HANDLE runCompleted; /*only created by IoTHubClient_WorkerPool_Remove while it waits for a run of the item to complete*/
+    DLIST_ENTRY entry; /*links the item in the scheduled list (SCHEDULED) or in a ready queue (READY)*/
+} WORKER_POOL_ITEM;
+
+typedef struct WORKER_TAG
+{
+    struct IOTHUB_CLIENT_WORKER_POOL_TAG* workerPool;
+    size_t index;
+    THREAD_HANDLE threadHandle;
+    DLIST_ENTRY readyQueue;
+} WORKER;
+
+typedef struct IOTHUB_CLIENT_WORKER_POOL_TAG
+{
+    LOCK_HANDLE lockHandle;
+    COND_HANDLE workCondition;
+    TICK_COUNTER_HANDLE tickCounter;
+    WORKER* workers;
+    size_t workerCount;
+    size_t nextHomeWorker;
+    DLIST_ENTRY scheduledItems; /*items waiting for their nextRun, ordered by nextRun*/
+    int stopThreads;
+} IOTHUB_CLIENT_WORKER_POOL;
+
+/*used by unittests only*/
+const size_t IoTHubClient_WorkerPool_ThreadTerminationOffset = offsetof(IOTHUB_CLIENT_WORKER_POOL, stopThreads);
+
+/*all the static functions below are called with the pool lock taken*/
+static void make_item_ready(WORKER_POOL_ITEM* item)
+{
+    IOTHUB_CLIENT_WORKER_POOL* workerPool = item->workerPool;
+    item->state = WORKER_POOL_ITEM_STATE_READY;
+    DList_InsertTailList(&(workerPool->workers[item->homeWorker].readyQueue), &(item->entry));
+    if (Condition_Post(workerPool->workCondition) != COND_OK)
+    {
+        LogError("unable to Condition_Post, the item will run when a worker wakes up");
+    }
+}
+
+static void schedule_item(WORKER_POOL_ITEM* item)
+{
+    /*walk from the tail since items are usually rescheduled later than everything else*/
+    PDLIST_ENTRY insertAfter = item->workerPool->scheduledItems.Blink;
+    while (insertAfter != &(item->workerPool->scheduledItems))
+    {
+        WORKER_POOL_ITEM* other = containingRecord(insertAfter, WORKER_POOL_ITEM, entry);
+        if (other->nextRun <= item->nextRun)
+        {
+            break;
+        }
+        insertAfter = insertAfter->Blink;
+    }
+    item->state = WORKER_POOL_ITEM_STATE_SCHEDULED;
+    DList_InsertHeadList(insertAfter, &(item->entry));
+}
+
+static void make_due_items_ready(IOTHUB_CLIENT_WORKER_POOL* workerPool, tickcounter_ms_t nowTick)
+{
+    while (DList_IsListEmpty(&(workerPool->scheduledItems)) == 0)
+    {
+        WORKER_POOL_ITEM* item = containingRecord(workerPool->scheduledItems.Flink, WORKER_POOL_ITEM, entry);
+        if (item->nextRun > nowTick)
+        {
+            break;
+        }
+        (void)DList_RemoveEntryList(&(item->entry));
+        make_item_ready(item);
+    }
+}
+
+static WORKER_POOL_ITEM* take_ready_item(WORKER* worker)
+{
+    WORKER_POOL_ITEM* result;
+    IOTHUB_CLIENT_WORKER_POOL* workerPool = worker->workerPool;
+
+    if (DList_IsListEmpty(&(worker->readyQueue)) == 0)
+    {
+        result = containingRecord(DList_RemoveHeadList(&(worker->readyQueue)), WORKER_POOL_ITEM, entry);
+    }
+    else
+    {
+        /*nothing of our own to do, steal the most recently queued item of another worker*/
+        size_t i;
+        result = NULL;
+        for (i = 1; i < workerPool->workerCount; i++)
+        {
+            WORKER* victim = &(workerPool->workers[(worker->index + i) % workerPool->workerCount]);
+            if (DList_IsListEmpty(&(victim->readyQueue)) == 0)
+            {
+                PDLIST_ENTRY stolen = victim->readyQueue.Blink;
+                (void)DList_RemoveEntryList(stolen);
+                result = containingRecord(stolen, WORKER_POOL_ITEM, entry);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+static int get_time_to_next_scheduled_item(IOTHUB_CLIENT_WORKER_POOL* workerPool, tickcounter_ms_t nowTick)
+{
+    int result;
+    if (DList_IsListEmpty(&(workerPool->scheduledItems)) != 0)
+    {
+        /*0 makes Condition_Wait wait until an item is added or signalled*/
+        result = 0;
+    }
+    else
+    {
+        WORKER_POOL_ITEM* item = containingRecord(workerPool->scheduledItems.Flink, WORKER_POOL_ITEM, entry);
+        result = (item->nextRun > nowTick) ? (int)(item->nextRun - nowTick) : 1;
+    }
+    return result;
+}
+
+static int worker_thread(void* threadArgument)
+{
+    WORKER* worker = (WORKER*)threadArgument;
+    IOTHUB_CLIENT_WORKER_POOL* workerPool = worker->workerPool;
+
+    if (Lock(workerPool->lockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock, worker %zu exits", worker->index);
+    }
+    else
+    {
+        int locked = 1;
+        while (workerPool->stopThreads == 0)
+        {
+            tickcounter_ms_t nowTick;
+            WORKER_POOL_ITEM* item;
+
+            if (tickcounter_get_current_ms(workerPool->tickCounter, &nowTick) != 0)
+            {
+                LogError("unable to get the current ms, scheduled items are not made ready");
+                nowTick = 0;
+            }
+            else
+            {
+                make_due_items_ready(workerPool, nowTick);
+            }
+
+            if ((item = take_ready_item(worker)) == NULL)
+            {
+                if (Condition_Wait(workerPool->workCondition, workerPool->lockHandle, get_time_to_next_scheduled_item(workerPool, nowTick)) == COND_ERROR)
+                {
+                    LogError("Condition_Wait failed");
+                }
+            }
+            else
+            {
+                tickcounter_ms_t runAfter;
+
+                /*the item is in no list while running, so no other worker can pick it up*/
+                item->state = WORKER_POOL_ITEM_STATE_RUNNING;
+                (void)Unlock(workerPool->lockHandle);
+
+                runAfter = item->doWork(item->context);
+
+                if (Lock(workerPool->lockHandle) != LOCK_OK)
+                {
+                    /*the item is lost to the pool, IoTHubClient_WorkerPool_Remove can no longer be told the run completed*/
+                    LogError("unable to Lock, worker %zu exits", worker->index);
+                    locked = 0;
+                    break;
+                }
+
+                if (item->removed)
+                {
+                    item->state = WORKER_POOL_ITEM_STATE_DETACHED;
+                    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_018: [ When the run of an item being removed completes, the worker shall post the condition IoTHubClient_WorkerPool_Remove waits on. ]*/
+                    if ((item->runCompleted != NULL) &&
+                        (Condition_Post(item->runCompleted) != COND_OK))
+                    {
+                        LogError("unable to Condition_Post, IoTHubClient_WorkerPool_Remove keeps waiting");
+                    }
+                }
+                else if (item->signalled || (runAfter == 0))
+                {
+                    item->signalled = 0;
+                    make_item_ready(item);
+                }
+                else if (tickcounter_get_current_ms(workerPool->tickCounter, &nowTick) != 0)
+                {
+                    LogError("unable to get the current ms, running the item again right away");
+                    make_item_ready(item);
+                }
+                else
+                {
+                    item->nextRun = nowTick + runAfter;
+                    schedule_item(item);
+                }
+            }
+        }
+
+        if (locked)
+        {
+            (void)Unlock(workerPool->lockHandle);
+        }
+    }
+
+    return 0;
+}
+
+static void detach_item(WORKER_POOL_ITEM* item)
+{
+    item->workerPool = NULL;
+    item->state = WORKER_POOL_ITEM_STATE_DETACHED;
+}
+
+static void stop_and_join_workers(IOTHUB_CLIENT_WORKER_POOL* workerPool, size_t startedWorkers)
+{
+    size_t i;
+    if (Lock(workerPool->lockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock - will still attempt to end the threads without locking");
+        workerPool->stopThreads = 1;
+    }
+    else
+    {
+        workerPool->stopThreads = 1;
+        for (i = 0; i < startedWorkers; i++)
+        {
+            (void)Condition_Post(workerPool->workCondition);
+        }
+        (void)Unlock(workerPool->lockHandle);
+    }
+
+    for (i = 0; i < startedWorkers; i++)
+    {
+        int res;
+        if (ThreadAPI_Join(workerPool->workers[i].threadHandle, &res) != THREADAPI_OK)
+        {
+            LogError("ThreadAPI_Join failed for worker %zu", i);
+        }
+    }
+}
+
+IOTHUB_CLIENT_WORKER_POOL_HANDLE IoTHubClient_WorkerPool_Create(size_t threadCount)
+{
+    IOTHUB_CLIENT_WORKER_POOL* result;
+
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_001: [ If threadCount is 0, IoTHubClient_WorkerPool_Create shall fail and return NULL. ]*/
+    if (threadCount == 0)
+    {
+        LogError("invalid arg size_t threadCount=%zu", threadCount);
+        result = NULL;
+    }
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_002: [ IoTHubClient_WorkerPool_Create shall allocate the pool, a lock, a condition, a tick counter and threadCount workers. ]*/
+    else if ((result = (IOTHUB_CLIENT_WORKER_POOL*)malloc(sizeof(IOTHUB_CLIENT_WORKER_POOL))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_003: [ If any of the allocations fail, IoTHubClient_WorkerPool_Create shall free everything it allocated and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else if ((result->lockHandle = Lock_Init()) == NULL)
+    {
+        LogError("unable to Lock_Init");
+        free(result);
+        result = NULL;
+    }
+    else if ((result->workCondition = Condition_Init()) == NULL)
+    {
+        LogError("unable to Condition_Init");
+        (void)Lock_Deinit(result->lockHandle);
+        free(result);
+        result = NULL;
+    }
+    else if ((result->tickCounter = tickcounter_create()) == NULL)
+    {
+        LogError("unable to tickcounter_create");
+        Condition_Deinit(result->workCondition);
+        (void)Lock_Deinit(result->lockHandle);
+        free(result);
+        result = NULL;
+    }
+    else if ((result->workers = (WORKER*)malloc(threadCount * sizeof(WORKER))) == NULL)
+    {
+        LogError("unable to malloc");
+        tickcounter_destroy(result->tickCounter);
+        Condition_Deinit(result->workCondition);
+        (void)Lock_Deinit(result->lockHandle);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        size_t i;
+        result->workerCount = threadCount;
+        result->nextHomeWorker = 0;
+        result->stopThreads = 0;
+        DList_InitializeListHead(&(result->scheduledItems));
+        for (i = 0; i < threadCount; i++)
+        {
+            result->workers[i].workerPool = result;
+            result->workers[i].index = i;
+            DList_InitializeListHead(&(result->workers[i].readyQueue));
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_004: [ IoTHubClient_WorkerPool_Create shall start threadCount threads by calling ThreadAPI_Create. ]*/
+        for (i = 0; i < threadCount; i++)
+        {
+            if (ThreadAPI_Create(&(result->workers[i].threadHandle), worker_thread, &(result->workers[i])) != THREADAPI_OK)
+            {
+                break;
+            }
+        }
+
+        if (i < threadCount)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_005: [ If starting any of the threads fails, IoTHubClient_WorkerPool_Create shall stop and join the threads already started, free all resources and return NULL. ]*/
+            LogError("unable to start worker thread %zu", i);
+            stop_and_join_workers(result, i);
+            free(result->workers);
+            tickcounter_destroy(result->tickCounter);
+            Condition_Deinit(result->workCondition);
+            (void)Lock_Deinit(result->lockHandle);
+            free(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+void IoTHubClient_WorkerPool_Destroy(IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool)
+{
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_006: [ If workerPool is NULL, IoTHubClient_WorkerPool_Destroy shall do nothing. ]*/
+    if (workerPool != NULL)
+    {
+        size_t i;
+
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_007: [ IoTHubClient_WorkerPool_Destroy shall signal all the threads to stop and join them. ]*/
+        stop_and_join_workers(workerPool, workerPool->workerCount);
+
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_008: [ IoTHubClient_WorkerPool_Destroy shall detach any item still attached to the pool, without freeing it, and free all the pool resources. ]*/
+        /*the handles still own their items and free them in IoTHubClient_WorkerPool_Remove*/
+        while (DList_IsListEmpty(&(workerPool->scheduledItems)) == 0)
+        {
+            LogError("destroying a worker pool that still has items attached, they are no longer run");
+            detach_item(containingRecord(DList_RemoveHeadList(&(workerPool->scheduledItems)), WORKER_POOL_ITEM, entry));
+        }
+        for (i = 0; i < workerPool->workerCount; i++)
+        {
+            while (DList_IsListEmpty(&(workerPool->workers[i].readyQueue)) == 0)
+            {
+                LogError("destroying a worker pool that still has items attached, they are no longer run");
+                detach_item(containingRecord(DList_RemoveHeadList(&(workerPool->workers[i].readyQueue)), WORKER_POOL_ITEM, entry));
+            }
+        }
+
+        free(workerPool->workers);
+        tickcounter_destroy(workerPool->tickCounter);
+        Condition_Deinit(workerPool->workCondition);
+        (void)Lock_Deinit(workerPool->lockHandle);
+        free(workerPool);
+    }
+}
+
+WORKER_POOL_ITEM_HANDLE IoTHubClient_WorkerPool_Add(IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool, WORKER_POOL_DO_WORK doWork, void* context)
+{
+    WORKER_POOL_ITEM* result;
+
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_009: [ If workerPool or doWork is NULL, IoTHubClient_WorkerPool_Add shall fail and return NULL. ]*/
+    if ((workerPool == NULL) || (doWork == NULL))
+    {
+        LogError("invalid arg IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool=%p, WORKER_POOL_DO_WORK doWork=%p", workerPool, doWork);
+        result = NULL;
+    }
+    else if ((result = (WORKER_POOL_ITEM*)malloc(sizeof(WORKER_POOL_ITEM))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_010: [ If any failure occurs, IoTHubClient_WorkerPool_Add shall fail and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else if (Lock(workerPool->lockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->workerPool = workerPool;
+        result->doWork = doWork;
+        result->context = context;
+        result->nextRun = 0;
+        result->signalled = 0;
+        result->removed = 0;
+        result->runCompleted = NULL;
+        /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_011: [ IoTHubClient_WorkerPool_Add shall assign the item to the workers in a round robin fashion and queue it to run as soon as possible. ]*/
+        result->homeWorker = workerPool->nextHomeWorker;
+        workerPool->nextHomeWorker = (workerPool->nextHomeWorker + 1) % workerPool->workerCount;
+        make_item_ready(result);
+        (void)Unlock(workerPool->lockHandle);
+    }
+
+    return result;
+}
+
+void IoTHubClient_WorkerPool_Signal(WORKER_POOL_ITEM_HANDLE item)
+{
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_012: [ If item is NULL, IoTHubClient_WorkerPool_Signal shall do nothing. ]*/
+    if (item != NULL)
+    {
+        if (item->workerPool == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_021: [ If the pool of the item was destroyed, IoTHubClient_WorkerPool_Signal shall do nothing. ]*/
+            LogError("the worker pool of the item was destroyed, the item is no longer run");
+        }
+        else if (Lock(item->workerPool->lockHandle) != LOCK_OK)
+        {
+            LogError("unable to Lock, the item will run at its next scheduled time");
+        }
+        else
+        {
+            if (item->state == WORKER_POOL_ITEM_STATE_SCHEDULED)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_013: [ If the item is waiting for its next run, IoTHubClient_WorkerPool_Signal shall queue it to run as soon as possible. ]*/
+                (void)DList_RemoveEntryList(&(item->entry));
+                make_item_ready(item);
+            }
+            else if (item->state == WORKER_POOL_ITEM_STATE_RUNNING)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_014: [ If the item is running, IoTHubClient_WorkerPool_Signal shall make it run again as soon as the current run completes. ]*/
+                item->signalled = 1;
+            }
+            else
+            {
+                /*already queued to run*/
+            }
+            (void)Unlock(item->workerPool->lockHandle);
+        }
+    }
+}
+
+void IoTHubClient_WorkerPool_Remove(WORKER_POOL_ITEM_HANDLE item)
+{
+    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_015: [ If item is NULL, IoTHubClient_WorkerPool_Remove shall do nothing. ]*/
+    if (item != NULL)
+    {
+        IOTHUB_CLIENT_WORKER_POOL* workerPool = item->workerPool;
+        if (workerPool == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_019: [ If the pool of the item was already destroyed, IoTHubClient_WorkerPool_Remove shall only free the item. ]*/
+            free(item);
+        }
+        else if (Lock(workerPool->lockHandle) != LOCK_OK)
+        {
+            LogError("unable to Lock, the item is leaked");
+        }
+        else
+        {
+            int leaked = 0;
+            item->removed = 1;
+
+            /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_016: [ If the item is running, IoTHubClient_WorkerPool_Remove shall create a condition for the item and wait on it, with the pool lock, until the run completes. ]*/
+            /*the doWork of the item commonly needs the lock the caller just released, so the caller must not hold it here*/
+            if (item->state == WORKER_POOL_ITEM_STATE_RUNNING)
+            {
+                if ((item->runCompleted = Condition_Init()) == NULL)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_020: [ If creating the condition or waiting on it fails, IoTHubClient_WorkerPool_Remove shall leave the item to the worker running it and not free it. ]*/
+                    LogError("unable to Condition_Init, the item is leaked");
+                    leaked = 1;
+                }
+                else
+                {
+                    /*0 waits until the worker posts the condition*/
+                    while ((leaked == 0) && (item->state == WORKER_POOL_ITEM_STATE_RUNNING))
+                    {
+                        if (Condition_Wait(item->runCompleted, workerPool->lockHandle, 0) == COND_ERROR)
+                        {
+                            LogError("Condition_Wait failed, the item is leaked");
+                            leaked = 1;
+                        }
+                    }
+
+                    if (leaked == 0)
+                    {
+                        Condition_Deinit(item->runCompleted);
+                        item->runCompleted = NULL;
+                    }
+                }
+            }
+
+            /*Codes_SRS_IOTHUBCLIENT_WORKER_POOL_41_017: [ IoTHubClient_WorkerPool_Remove shall detach the item from the pool and free it. ]*/
+            if ((leaked == 0) && (item->state != WORKER_POOL_ITEM_STATE_DETACHED))
+            {
+                (void)DList_RemoveEntryList(&(item->entry));
+            }
+            (void)Unlock(workerPool->lockHandle);
+
+            if (leaked == 0)
+            {
+                free(item);
+            }
+        }
+    }
+}
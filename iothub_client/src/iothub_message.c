@@ -22,9 +22,15 @@ typedef struct IOTHUB_MESSAGE_HANDLE_DATA_TAG
         BUFFER_HANDLE byteArray;
         STRING_HANDLE string;
     } value;
+    /* when value.byteArray is NULL for a IOTHUBMESSAGE_BYTEARRAY message, the content is caller owned memory */
+    const unsigned char* externalByteArray;
+    size_t externalSize;
+    IOTHUB_MESSAGE_RELEASE_CALLBACK releaseCallback;
+    void* releaseContext;
     MAP_HANDLE properties;
     char* messageId;
     char* correlationId;
+    int priority; /*only used by IoTHubClient_LL to choose which message to drop when its send queue is full, never sent to the hub*/
 }IOTHUB_MESSAGE_HANDLE_DATA;
 
 static bool ContainsOnlyUsAscii(const char* asciiValue)
@@ -119,12 +125,52 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromByteArray(const unsigned char* byt
                 result->contentType = IOTHUBMESSAGE_BYTEARRAY;
                 result->messageId = NULL;
                 result->correlationId = NULL;
+                result->priority = 0;
                 /*all is fine, return result*/
             }
         }
     }
     return result;
 }
+IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromByteArrayWithRelease(const unsigned char* byteArray, size_t size, IOTHUB_MESSAGE_RELEASE_CALLBACK releaseCallback, void* releaseContext)
+{
+    IOTHUB_MESSAGE_HANDLE_DATA* result;
+    if ((size != 0) && (byteArray == NULL))
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_41_001: [If size is not zero and byteArray is NULL, IoTHubMessage_CreateFromByteArrayWithRelease shall return NULL.] */
+        LogError("Attempted to create a Hub Message from a NULL pointer!");
+        result = NULL;
+    }
+    else if ((result = malloc(sizeof(IOTHUB_MESSAGE_HANDLE_DATA))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_41_002: [If there are any errors then IoTHubMessage_CreateFromByteArrayWithRelease shall return NULL.] */
+        LogError("unable to malloc");
+    }
+    /*Codes_SRS_IOTHUBMESSAGE_41_003: [IoTHubMessage_CreateFromByteArrayWithRelease shall call Map_Create to create the message properties.] */
+    else if ((result->properties = Map_Create(ValidateAsciiCharactersFilter)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_41_002: [If there are any errors then IoTHubMessage_CreateFromByteArrayWithRelease shall return NULL.] */
+        LogError("Map_Create failed");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_41_004: [IoTHubMessage_CreateFromByteArrayWithRelease shall not copy byteArray; the message shall refer to it until the message is destroyed.] */
+        /*Codes_SRS_IOTHUBMESSAGE_41_005: [The type of the new message shall be IOTHUBMESSAGE_BYTEARRAY.] */
+        result->contentType = IOTHUBMESSAGE_BYTEARRAY;
+        result->value.byteArray = NULL;
+        result->externalByteArray = byteArray;
+        result->externalSize = size;
+        result->releaseCallback = releaseCallback;
+        result->releaseContext = releaseContext;
+        result->messageId = NULL;
+        result->correlationId = NULL;
+        result->priority = 0;
+    }
+    return result;
+}
+
 IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromString(const char* source)
 {
     IOTHUB_MESSAGE_HANDLE_DATA* result;
@@ -161,6 +207,7 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromString(const char* source)
             result->contentType = IOTHUBMESSAGE_STRING;
             result->messageId = NULL;
             result->correlationId = NULL;
+            result->priority = 0;
         }
     }
     return result;
@@ -191,6 +238,8 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_Clone(IOTHUB_MESSAGE_HANDLE iotHubMessageHan
         {
             result->messageId = NULL;
             result->correlationId = NULL;
+            /*Codes_SRS_IOTHUBMESSAGE_41_011: [IoTHubMessage_Clone shall copy the priority of the message.] */
+            result->priority = source->priority;
             if (source->messageId != NULL && mallocAndStrcpy_s(&result->messageId, source->messageId) != 0)
             {
                 LogError("unable to Copy messageId");
@@ -211,7 +260,9 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_Clone(IOTHUB_MESSAGE_HANDLE iotHubMessageHan
             else if (source->contentType == IOTHUBMESSAGE_BYTEARRAY)
             {
                 /*Codes_SRS_IOTHUBMESSAGE_02_006: [IoTHubMessage_Clone shall clone to content by a call to BUFFER_clone] */
-                if ((result->value.byteArray = BUFFER_clone(source->value.byteArray)) == NULL)
+                /*Codes_SRS_IOTHUBMESSAGE_41_006: [If the message refers to caller owned memory, IoTHubMessage_Clone shall copy it by calling BUFFER_create; the clone shall not refer to the caller owned memory.] */
+                static const unsigned char emptyByteArray = 0x00;
+                if ((result->value.byteArray = ((source->value.byteArray == NULL) ? BUFFER_create((source->externalSize == 0) ? &emptyByteArray : source->externalByteArray, source->externalSize) : BUFFER_clone(source->value.byteArray))) == NULL)
                 {
                     /*Codes_SRS_IOTHUBMESSAGE_03_004: [IoTHubMessage_Clone shall return NULL if it fails for any reason.]*/
                     LogError("unable to BUFFER_clone");
@@ -328,10 +379,19 @@ IOTHUB_MESSAGE_RESULT IoTHubMessage_GetByteArray(IOTHUB_MESSAGE_HANDLE iotHubMes
         }
         else
         {
-            /*Codes_SRS_IOTHUBMESSAGE_01_011: [The pointer shall be obtained by using BUFFER_u_char and it shall be copied in the buffer argument.]*/
-            *buffer = BUFFER_u_char(handleData->value.byteArray);
-            /*Codes_SRS_IOTHUBMESSAGE_01_012: [The size of the associated data shall be obtained by using BUFFER_length and it shall be copied to the size argument.]*/
-            *size = BUFFER_length(handleData->value.byteArray);
+            if (handleData->value.byteArray == NULL)
+            {
+                /*Codes_SRS_IOTHUBMESSAGE_41_007: [If the message refers to caller owned memory, IoTHubMessage_GetByteArray shall return that memory and its size.] */
+                *buffer = handleData->externalByteArray;
+                *size = handleData->externalSize;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBMESSAGE_01_011: [The pointer shall be obtained by using BUFFER_u_char and it shall be copied in the buffer argument.]*/
+                *buffer = BUFFER_u_char(handleData->value.byteArray);
+                /*Codes_SRS_IOTHUBMESSAGE_01_012: [The size of the associated data shall be obtained by using BUFFER_length and it shall be copied to the size argument.]*/
+                *size = BUFFER_length(handleData->value.byteArray);
+            }
             result = IOTHUB_MESSAGE_OK;
         }
     }
@@ -497,6 +557,43 @@ const char* IoTHubMessage_GetMessageId(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle
     return result;
 }
 
+IOTHUB_MESSAGE_RESULT IoTHubMessage_SetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, int priority)
+{
+    IOTHUB_MESSAGE_RESULT result;
+    /* Codes_SRS_IOTHUBMESSAGE_41_009: [if the iotHubMessageHandle parameter is NULL then IoTHubMessage_SetPriority shall return IOTHUB_MESSAGE_INVALID_ARG.] */
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_SetPriority");
+        result = IOTHUB_MESSAGE_INVALID_ARG;
+    }
+    else
+    {
+        /* Codes_SRS_IOTHUBMESSAGE_41_010: [IoTHubMessage_SetPriority shall store priority in the message and return IOTHUB_MESSAGE_OK.] */
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        handleData->priority = priority;
+        result = IOTHUB_MESSAGE_OK;
+    }
+    return result;
+}
+
+int IoTHubMessage_GetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    int result;
+    /* Codes_SRS_IOTHUBMESSAGE_41_012: [if the iotHubMessageHandle parameter is NULL then IoTHubMessage_GetPriority shall return 0.] */
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_GetPriority");
+        result = 0;
+    }
+    else
+    {
+        /* Codes_SRS_IOTHUBMESSAGE_41_013: [IoTHubMessage_GetPriority shall return the priority of the message, 0 when it was never set.] */
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        result = handleData->priority;
+    }
+    return result;
+}
+
 void IoTHubMessage_Destroy(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
 {
     /*Codes_SRS_IOTHUBMESSAGE_01_004: [If iotHubMessageHandle is NULL, IoTHubMessage_Destroy shall do nothing.] */
@@ -506,7 +603,18 @@ void IoTHubMessage_Destroy(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
         IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
         if (handleData->contentType == IOTHUBMESSAGE_BYTEARRAY)
         {
-            BUFFER_delete(handleData->value.byteArray);
+            if (handleData->value.byteArray == NULL)
+            {
+                /*Codes_SRS_IOTHUBMESSAGE_41_008: [If the message refers to caller owned memory and releaseCallback is not NULL, IoTHubMessage_Destroy shall call releaseCallback passing releaseContext.] */
+                if (handleData->releaseCallback != NULL)
+                {
+                    handleData->releaseCallback(handleData->releaseContext);
+                }
+            }
+            else
+            {
+                BUFFER_delete(handleData->value.byteArray);
+            }
         }
         else
         {
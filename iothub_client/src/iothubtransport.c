@@ -9,17 +9,23 @@
 #include "iothubtransport.h"
 #include "iothub_client.h"
 #include "iothub_client_private.h"
+#include "iothub_client_worker_pool_private.h"
+#include "iothub_client_shared_transport_private.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/vector.h"
 
+#define TRANSPORT_DO_WORK_FREQ_MS 1
+
 typedef struct TRANSPORT_HANDLE_DATA_TAG
 {
 	TRANSPORT_LL_HANDLE transportLLHandle;
     THREAD_HANDLE workerThreadHandle;
     LOCK_HANDLE lockHandle;
     sig_atomic_t stopThread;
+	IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool; /* when set, DoWork is called by the pool instead of workerThreadHandle */
+	WORKER_POOL_ITEM_HANDLE workerPoolItem;
 	TRANSPORT_PROVIDER_FIELDS;
 	VECTOR_HANDLE clients;
 } TRANSPORT_HANDLE_DATA;
@@ -103,6 +109,8 @@ TRANSPORT_HANDLE  IoTHubTransport_Create(IOTHUB_CLIENT_TRANSPORT_PROVIDER protoc
 						/*Codes_SRS_IOTHUBTRANSPORT_17_001: [ IoTHubTransport_Create shall return a non-NULL handle on success.]*/
 						result->stopThread = 1;
 						result->workerThreadHandle = NULL; /* create thread when work needs to be done */
+						result->workerPool = NULL;
+						result->workerPoolItem = NULL;
                         result->IoTHubTransport_GetHostname = transportProtocol->IoTHubTransport_GetHostname;
 						result->IoTHubTransport_SetOption = transportProtocol->IoTHubTransport_SetOption;
 						result->IoTHubTransport_Create = transportProtocol->IoTHubTransport_Create;
@@ -152,6 +160,38 @@ static int transport_worker_thread(void* threadArgument)
 	return 0;
 }
 
+static tickcounter_ms_t transport_worker_pool_do_work(void* context)
+{
+	TRANSPORT_HANDLE_DATA* transportData = (TRANSPORT_HANDLE_DATA*)context;
+	tickcounter_ms_t result = TRANSPORT_DO_WORK_FREQ_MS;
+
+	/*Codes_SRS_IOTHUBTRANSPORT_41_004: [ When run by the worker pool, the transport shall do the same work as one iteration of the worker thread. ]*/
+	if (Lock(transportData->lockHandle) == LOCK_OK)
+	{
+		if (!transportData->stopThread)
+		{
+			size_t clientCount;
+			size_t i;
+
+			(transportData->IoTHubTransport_DoWork)(transportData->transportLLHandle, NULL);
+
+			/*Codes_SRS_IOTHUBTRANSPORT_41_007: [ The transport shall then ask to be run again after the shortest time returned by IoTHubClient_GetTimeToWait for the clients using it, or after 1 ms if there are none. ]*/
+			clientCount = VECTOR_size(transportData->clients);
+			for (i = 0; i < clientCount; i++)
+			{
+				IOTHUB_CLIENT_HANDLE* clientHandle = (IOTHUB_CLIENT_HANDLE*)VECTOR_element(transportData->clients, i);
+				tickcounter_ms_t clientTimeToWait = IoTHubClient_GetTimeToWait(*clientHandle);
+				if ((i == 0) || (clientTimeToWait < result))
+				{
+					result = clientTimeToWait;
+				}
+			}
+		}
+		(void)Unlock(transportData->lockHandle);
+	}
+	return result;
+}
+
 static bool find_by_handle(const void* element, const void* value)
 {
 	/* data stored at element is device handle */
@@ -163,7 +203,19 @@ static bool find_by_handle(const void* element, const void* value)
 static IOTHUB_CLIENT_RESULT start_worker_if_needed(TRANSPORT_HANDLE_DATA * transportData, IOTHUB_CLIENT_HANDLE clientHandle)
 {
 	IOTHUB_CLIENT_RESULT result;
-	if (transportData->workerThreadHandle == NULL)
+	if (transportData->workerPool != NULL)
+	{
+		if (transportData->workerPoolItem == NULL)
+		{
+			/*Codes_SRS_IOTHUBTRANSPORT_41_005: [ If a worker pool was set, IoTHubTransport_StartWorkerThread shall add the transport to the worker pool instead of starting a thread. ]*/
+			transportData->stopThread = 0;
+			if ((transportData->workerPoolItem = IoTHubClient_WorkerPool_Add(transportData->workerPool, transport_worker_pool_do_work, transportData)) == NULL)
+			{
+				LogError("unable to IoTHubClient_WorkerPool_Add");
+			}
+		}
+	}
+	else if (transportData->workerThreadHandle == NULL)
 	{
 		/*Codes_SRS_IOTHUBTRANSPORT_17_018: [ If the worker thread does not exist, IoTHubTransport_StartWorkerThread shall start the thread using ThreadAPI_Create. ]*/
 		transportData->stopThread = 0;
@@ -172,7 +224,7 @@ static IOTHUB_CLIENT_RESULT start_worker_if_needed(TRANSPORT_HANDLE_DATA * trans
 			transportData->workerThreadHandle = NULL;
 		}
 	}
-	if (transportData->workerThreadHandle != NULL)
+	if ((transportData->workerThreadHandle != NULL) || (transportData->workerPoolItem != NULL))
 	{
 		/*Codes_SRS_IOTHUBTRANSPORT_17_020: [ IoTHubTransport_StartWorkerThread shall search for IoTHubClient clientHandle in the list of IoTHubClient handles. ]*/
 		bool addToList = ((VECTOR_size(transportData->clients) == 0) || (VECTOR_find_if(transportData->clients, find_by_handle, clientHandle) == NULL));
@@ -222,6 +274,12 @@ static void wait_worker_thread(TRANSPORT_HANDLE_DATA * transportData)
 			transportData->workerThreadHandle = NULL;
 		}
 	}
+	else if (transportData->workerPoolItem != NULL)
+	{
+		/*Codes_SRS_IOTHUBTRANSPORT_41_006: [ If the transport was added to a worker pool, it shall be removed from the pool instead of joining the thread. ]*/
+		IoTHubClient_WorkerPool_Remove(transportData->workerPoolItem);
+		transportData->workerPoolItem = NULL;
+	}
 }
 
 static bool signal_end_worker_thread(TRANSPORT_HANDLE_DATA * transportData, IOTHUB_CLIENT_HANDLE clientHandle)
@@ -234,7 +292,7 @@ static bool signal_end_worker_thread(TRANSPORT_HANDLE_DATA * transportData, IOTH
 		VECTOR_erase(transportData->clients, element, 1);
 	}
 	/*Codes_SRS_IOTHUBTRANSPORT_17_025: [ If the worker thread does not exist, then IoTHubTransport_EndWorkerThread shall return. ]*/
-	if (transportData->workerThreadHandle != NULL)
+	if ((transportData->workerThreadHandle != NULL) || (transportData->workerPoolItem != NULL))
 	{
 		if (VECTOR_size(transportData->clients) == 0)
 		{
@@ -368,3 +426,59 @@ void IoTHubTransport_JoinWorkerThread(TRANSPORT_HANDLE transportHandle, IOTHUB_C
 		wait_worker_thread(transportData);
 	}
 }
+
+void IoTHubTransport_SignalWork(TRANSPORT_HANDLE transportHandle)
+{
+	/*Codes_SRS_IOTHUBTRANSPORT_41_008: [ If transportHandle is NULL, IoTHubTransport_SignalWork shall do nothing. ]*/
+	if (transportHandle == NULL)
+	{
+		LogError("invalid arg");
+	}
+	else
+	{
+		TRANSPORT_HANDLE_DATA* transportData = (TRANSPORT_HANDLE_DATA*)transportHandle;
+		/*Codes_SRS_IOTHUBTRANSPORT_41_009: [ If the transport was added to a worker pool, IoTHubTransport_SignalWork shall call IoTHubClient_WorkerPool_Signal so that the transport runs without waiting for its next scheduled time. ]*/
+		/*Codes_SRS_IOTHUBTRANSPORT_41_010: [ Otherwise IoTHubTransport_SignalWork shall do nothing, the worker thread calls DoWork every 1 ms. ]*/
+		if (transportData->workerPoolItem != NULL)
+		{
+			IoTHubClient_WorkerPool_Signal(transportData->workerPoolItem);
+		}
+	}
+}
+
+IOTHUB_CLIENT_RESULT IoTHubTransport_SetWorkerPool(TRANSPORT_HANDLE transportHandle, IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool)
+{
+	IOTHUB_CLIENT_RESULT result;
+	if (transportHandle == NULL || workerPool == NULL)
+	{
+		/*Codes_SRS_IOTHUBTRANSPORT_41_001: [ If transportHandle or workerPool is NULL, IoTHubTransport_SetWorkerPool shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+		LogError("Invalid NULL argument, transportHandle [%p], workerPool [%p].", transportHandle, workerPool);
+		result = IOTHUB_CLIENT_INVALID_ARG;
+	}
+	else
+	{
+		TRANSPORT_HANDLE_DATA * transportData = (TRANSPORT_HANDLE_DATA*)transportHandle;
+		if (Lock(transportData->lockHandle) != LOCK_OK)
+		{
+			LogError("Unable to lock");
+			result = IOTHUB_CLIENT_ERROR;
+		}
+		else
+		{
+			if ((transportData->workerThreadHandle != NULL) || (transportData->workerPoolItem != NULL))
+			{
+				/*Codes_SRS_IOTHUBTRANSPORT_41_002: [ If the worker thread was already started, IoTHubTransport_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]*/
+				LogError("The worker thread has already been started.");
+				result = IOTHUB_CLIENT_ERROR;
+			}
+			else
+			{
+				/*Codes_SRS_IOTHUBTRANSPORT_41_003: [ Otherwise IoTHubTransport_SetWorkerPool shall remember workerPool, to be used when the worker thread would have been started, and return IOTHUB_CLIENT_OK. ]*/
+				transportData->workerPool = workerPool;
+				result = IOTHUB_CLIENT_OK;
+			}
+			(void)Unlock(transportData->lockHandle);
+		}
+	}
+	return result;
+}
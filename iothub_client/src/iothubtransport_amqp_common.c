@@ -12,6 +12,7 @@
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/platform.h"
 #include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/tickcounter.h"
 #include "azure_c_shared_utility/urlencode.h"
 #include "azure_c_shared_utility/tlsio.h"
 #include "azure_c_shared_utility/vector.h"
@@ -30,6 +31,7 @@
 #include "iothub_client_ll.h"
 #include "iothub_client_options.h"
 #include "iothub_client_private.h"
+#include "iothub_client_record_pool.h"
 #include "iothubtransportamqp_auth.h"
 #ifdef WIP_C2D_METHODS_AMQP /* This feature is WIP, do not use yet */
 #include "iothubtransportamqp_methods.h"
@@ -52,6 +54,11 @@
 #define MESSAGE_SENDER_LINK_NAME_TAG "sender"
 #define MESSAGE_SENDER_SOURCE_NAME_TAG "source"
 #define MESSAGE_SENDER_MAX_LINK_SIZE UINT64_MAX
+// Message format of an AMQP message whose data sections each hold a whole encoded event (IoT Hub/Event Hubs batching).
+#define AMQP_BATCHED_MESSAGE_FORMAT 0x80013700
+// IoT Hub rejects device-to-cloud messages, batched or not, larger than 256 KB.
+#define AMQP_BATCH_MAX_SIZE (256 * 1024)
+#define AMQP_BATCH_INITIAL_CAPACITY 8
 
 typedef enum RESULT_TAG
 {
@@ -88,6 +95,26 @@ typedef struct AMQP_TRANSPORT_STATE_TAG
     bool is_trace_on;
     // Used to generate unique AMQP link names
     int link_count;
+    // Events are sent in batches of at most this many encoded bytes (0 = batching off, one transfer per event).
+    size_t batch_max_bytes;
+    // How long queued events can wait for a batch to fill up (0 = send whatever is queued on every DoWork).
+    size_t batch_linger_ms;
+    // Clock for batch_linger_ms, created when the option is first set.
+    TICK_COUNTER_HANDLE batch_tick_counter;
+    // AMQP session windows (in transfers), applied when the session is created.
+    uint32_t incoming_window;
+    uint32_t outgoing_window;
+    // Largest message the event sender and message receiver links accept, applied when the links are created.
+    uint64_t sender_max_message_size;
+    uint64_t receiver_max_message_size;
+    // Most devices that can wait on a CBS put-token at once (0 = no limit, all devices authenticate together).
+    size_t max_pending_authentications;
+    // Devices currently waiting on a CBS put-token started by the transport.
+    size_t pending_authentications;
+    // Time-to-ready of the devices authenticated by the transport, reported by IoTHubTransport_AMQP_Common_GetAuthenticationStatistics.
+    size_t devices_ready;
+    double total_time_to_ready;
+    double max_time_to_ready;
 
     /*here are the options from the xio layer if any is saved*/
     OPTIONHANDLER_HANDLE xioOptions;
@@ -128,6 +155,16 @@ typedef struct AMQP_TRANSPORT_DEVICE_STATE_TAG
     PDLIST_ENTRY waitingToSend;
     // Internal list with the items currently being processed/sent through uAMQP.
     DLIST_ENTRY inProgress;
+    // Set while queued events are held back waiting for a batch to fill up.
+    bool is_batch_lingering;
+    // When the events currently held back were first seen.
+    tickcounter_ms_t batch_linger_start;
+    // Application properties of the last event sent, reused while the next events carry the same ones.
+    UAMQP_APPLICATION_PROPERTIES_CACHE application_properties_cache;
+    // Set while the device holds one of the transport pending authentications.
+    bool is_authentication_pending;
+    // When the transport started authenticating the device, used to measure its time-to-ready (INDEFINITE_TIME once measured).
+    time_t authentication_start_time;
 #ifdef WIP_C2D_METHODS_AMQP /* This feature is WIP, do not use yet */
     // the methods portion
     IOTHUBTRANSPORT_AMQP_METHODS_HANDLE methods_handle;
@@ -138,6 +175,14 @@ typedef struct AMQP_TRANSPORT_DEVICE_STATE_TAG
 #endif
 } AMQP_TRANSPORT_DEVICE_STATE;
 
+// The events sent in one batched AMQP message, completed together when its disposition arrives.
+typedef struct AMQP_EVENT_BATCH_TAG
+{
+    IOTHUB_MESSAGE_LIST** members;
+    size_t count;
+    size_t capacity;
+} AMQP_EVENT_BATCH;
+
 
 // Auxiliary functions
 
@@ -327,8 +372,8 @@ static void on_message_send_complete(void* context, MESSAGE_SEND_RESULT send_res
     // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_151: [The callback 'on_message_send_complete' shall destroy the message handle (IOTHUB_MESSAGE_HANDLE) using IoTHubMessage_Destroy()]
     IoTHubMessage_Destroy(message->messageHandle);
 
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_152: [The callback 'on_message_send_complete' shall destroy the IOTHUB_MESSAGE_LIST instance]
-    free(message); 
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_152: [The callback 'on_message_send_complete' shall destroy the IOTHUB_MESSAGE_LIST instance using IoTHubClient_RecordPool_Free()]
+    IoTHubClient_RecordPool_Free(message);
 }
 
 static AMQP_VALUE on_message_received(const void* context, MESSAGE_HANDLE message)
@@ -495,16 +540,16 @@ static int subscribe_methods(AMQP_TRANSPORT_DEVICE_STATE* deviceState)
 }
 #endif
 
-static void set_session_options(SESSION_HANDLE session)
+static void set_session_options(AMQP_TRANSPORT_INSTANCE* transport_state)
 {
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_065: [IoTHubTransport_AMQP_Common_DoWork shall apply a default value of UINT_MAX for the parameter 'AMQP incoming window'] 
-    if (session_set_incoming_window(session, (uint32_t)DEFAULT_INCOMING_WINDOW_SIZE) != 0)
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_065: [IoTHubTransport_AMQP_Common_DoWork shall apply the `amqp_incoming_window` option, UINT_MAX by default, for the parameter 'AMQP incoming window'] 
+    if (session_set_incoming_window(transport_state->session, transport_state->incoming_window) != 0)
     {
         LogError("Failed to set the AMQP incoming window size.");
     }
 
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_115: [IoTHubTransport_AMQP_Common_DoWork shall apply a default value of 100 for the parameter 'AMQP outgoing window'] 
-    if (session_set_outgoing_window(session, DEFAULT_OUTGOING_WINDOW_SIZE) != 0)
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_115: [IoTHubTransport_AMQP_Common_DoWork shall apply the `amqp_outgoing_window` option, 100 by default, for the parameter 'AMQP outgoing window'] 
+    if (session_set_outgoing_window(transport_state->session, transport_state->outgoing_window) != 0)
     {
         LogError("Failed to set the AMQP outgoing window size.");
     }
@@ -579,7 +624,7 @@ static int establishConnection(AMQP_TRANSPORT_INSTANCE* transport_state)
                     }
                     else
                     {
-                        set_session_options(transport_state->session);
+                        set_session_options(transport_state);
 
                         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_066: [IoTHubTransport_AMQP_Common_DoWork shall establish the CBS connection using the cbs_create() AMQP API] 
                         if ((transport_state->cbs_connection.cbs_handle = cbs_create(transport_state->session, on_amqp_management_state_changed, NULL)) == NULL)
@@ -628,7 +673,7 @@ static int establishConnection(AMQP_TRANSPORT_INSTANCE* transport_state)
                     }
                     else
                     {
-                        set_session_options(transport_state->session);
+                        set_session_options(transport_state);
                     
                         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_199: [The value of the option `logtrace` saved by the transport instance shall be applied to each new connection instance using connection_set_trace().]
                         connection_set_trace(transport_state->connection, transport_state->is_trace_on);
@@ -733,6 +778,32 @@ static void on_event_sender_state_changed(void* context, MESSAGE_SENDER_STATE ne
 
         device_state->message_sender_state = new_state;
 
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_026: [When the event sender of a device opens after the transport authenticated the device, the transport shall count the device as ready and add how many seconds passed since it called authentication_authenticate() to the time-to-ready statistics; if `logtrace` is on it shall also log them.]
+        if (new_state == MESSAGE_SENDER_STATE_OPEN && device_state->authentication_start_time != INDEFINITE_TIME)
+        {
+            time_t current_time = get_time(NULL);
+
+            if (current_time != INDEFINITE_TIME)
+            {
+                AMQP_TRANSPORT_INSTANCE* transport_state = device_state->transport_state;
+                double time_to_ready = get_difftime(current_time, device_state->authentication_start_time);
+
+                transport_state->devices_ready++;
+                transport_state->total_time_to_ready += time_to_ready;
+                if (time_to_ready > transport_state->max_time_to_ready)
+                {
+                    transport_state->max_time_to_ready = time_to_ready;
+                }
+
+                if (transport_state->is_trace_on)
+                {
+                    LogInfo("Device ready [%s, %.0f seconds after authentication started]", STRING_c_str(device_state->deviceId), time_to_ready);
+                }
+            }
+
+            device_state->authentication_start_time = INDEFINITE_TIME;
+        }
+
         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_192: [If a message sender instance changes its state to MESSAGE_SENDER_STATE_ERROR (first transition only) the connection retry logic shall be triggered]
         if (new_state != previous_state && new_state == MESSAGE_SENDER_STATE_ERROR)
         {
@@ -781,8 +852,8 @@ static int createEventSender(AMQP_TRANSPORT_DEVICE_STATE* device_state)
     }
     else
     {
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_119: [IoTHubTransport_AMQP_Common_DoWork shall apply a default value of 65536 for the parameter 'Link MAX message size']
-        if (link_set_max_message_size(device_state->sender_link, MESSAGE_SENDER_MAX_LINK_SIZE) != RESULT_OK)
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_119: [IoTHubTransport_AMQP_Common_DoWork shall apply the `amqp_sender_max_message_size` or `amqp_receiver_max_message_size` option for the parameter 'Link MAX message size' of the event sender and message receiver links]
+        if (link_set_max_message_size(device_state->sender_link, device_state->transport_state->sender_max_message_size) != RESULT_OK)
         {
             LogError("Failed setting AMQP link max message size.");
         }
@@ -927,8 +998,8 @@ static int createMessageReceiver(AMQP_TRANSPORT_DEVICE_STATE* device_state)
     }
     else
     {
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_119: [IoTHubTransport_AMQP_Common_DoWork shall apply a default value of 65536 for the parameter 'Link MAX message size']
-        if (link_set_max_message_size(device_state->receiver_link, MESSAGE_RECEIVER_MAX_LINK_SIZE) != RESULT_OK)
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_119: [IoTHubTransport_AMQP_Common_DoWork shall apply the `amqp_sender_max_message_size` or `amqp_receiver_max_message_size` option for the parameter 'Link MAX message size' of the event sender and message receiver links]
+        if (link_set_max_message_size(device_state->receiver_link, device_state->transport_state->receiver_max_message_size) != RESULT_OK)
         {
             LogError("Failed setting AMQP link max message size for message receiver.");
         }
@@ -989,8 +1060,8 @@ static int sendPendingEvents(AMQP_TRANSPORT_DEVICE_STATE* device_state)
         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_086: [IoTHubTransport_AMQP_Common_DoWork shall move queued events to an "in-progress" list right before processing them for sending]
         trackEventInProgress(message, device_state);
 
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_193: [IoTHubTransport_AMQP_Common_DoWork shall get a MESSAGE_HANDLE instance out of the event's IOTHUB_MESSAGE_HANDLE instance by using message_create_from_iothub_message().]
-        if ((result = message_create_from_iothub_message(message->messageHandle, &amqp_message)) != RESULT_OK)
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_193: [IoTHubTransport_AMQP_Common_DoWork shall get a MESSAGE_HANDLE instance out of the event's IOTHUB_MESSAGE_HANDLE instance by using message_create_from_iothub_message_with_cache() and the application properties cache of the device.]
+        if ((result = message_create_from_iothub_message_with_cache(message->messageHandle, &device_state->application_properties_cache, &amqp_message)) != RESULT_OK)
         {
             LogError("Failed creating AMQP message (error=%d).", result);
             result = __LINE__;
@@ -1033,8 +1104,268 @@ static int sendPendingEvents(AMQP_TRANSPORT_DEVICE_STATE* device_state)
     return result;
 }
 
+static void on_batch_send_complete(void* context, MESSAGE_SEND_RESULT send_result)
+{
+    AMQP_EVENT_BATCH* batch = (AMQP_EVENT_BATCH*)context;
+    size_t i;
+
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_009: [When the disposition of a batch arrives, every event of the batch shall be completed with the result of the batch, as 'on_message_send_complete' does for a single event.]
+    for (i = 0; i < batch->count; i++)
+    {
+        on_message_send_complete(batch->members[i], send_result);
+    }
+
+    free(batch->members);
+    free(batch);
+}
+
+static int addEventToBatch(AMQP_EVENT_BATCH* batch, IOTHUB_MESSAGE_LIST* message)
+{
+    int result;
+
+    if (batch->count == batch->capacity)
+    {
+        size_t new_capacity = (batch->capacity == 0) ? AMQP_BATCH_INITIAL_CAPACITY : (batch->capacity * 2);
+        IOTHUB_MESSAGE_LIST** new_members = (IOTHUB_MESSAGE_LIST**)realloc(batch->members, new_capacity * sizeof(IOTHUB_MESSAGE_LIST*));
+
+        if (new_members == NULL)
+        {
+            LogError("Failed growing the batch to %zu events.", new_capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            batch->members = new_members;
+            batch->capacity = new_capacity;
+            result = RESULT_OK;
+        }
+    }
+    else
+    {
+        result = RESULT_OK;
+    }
+
+    if (result == RESULT_OK)
+    {
+        batch->members[batch->count++] = message;
+    }
+
+    return result;
+}
+
+static bool isEventBatchReady(AMQP_TRANSPORT_DEVICE_STATE* device_state)
+{
+    bool result;
+    AMQP_TRANSPORT_INSTANCE* transport_state = device_state->transport_state;
+
+    if (DList_IsListEmpty(device_state->waitingToSend))
+    {
+        device_state->is_batch_lingering = false;
+        result = false;
+    }
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_003: [If `amqp_batch_linger_ms` is 0, the queued events shall be sent on every DoWork.]
+    else if (transport_state->batch_linger_ms == 0)
+    {
+        result = true;
+    }
+    else
+    {
+        tickcounter_ms_t current_ms;
+
+        if (tickcounter_get_current_ms(transport_state->batch_tick_counter, &current_ms) != 0)
+        {
+            // Holding the events back without a clock could hold them forever.
+            LogError("Failed reading the batch linger clock, sending the queued events now.");
+            result = true;
+        }
+        else
+        {
+            PDLIST_ENTRY entry;
+            size_t queued_bytes = 0;
+
+            if (!device_state->is_batch_lingering)
+            {
+                device_state->is_batch_lingering = true;
+                device_state->batch_linger_start = current_ms;
+            }
+
+            for (entry = device_state->waitingToSend->Flink; entry != device_state->waitingToSend && queued_bytes < transport_state->batch_max_bytes; entry = entry->Flink)
+            {
+                queued_bytes += containingRecord(entry, IOTHUB_MESSAGE_LIST, entry)->byteCount;
+            }
+
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_004: [Otherwise the queued events shall be held back until they add up to `amqp_batch_max_bytes` or `amqp_batch_linger_ms` milliseconds have passed since they were first held back.]
+            result = (queued_bytes >= transport_state->batch_max_bytes) ||
+                (current_ms - device_state->batch_linger_start >= transport_state->batch_linger_ms);
+        }
+    }
+
+    return result;
+}
+
+static int sendEventBatch(AMQP_TRANSPORT_DEVICE_STATE* device_state)
+{
+    int result;
+    AMQP_EVENT_BATCH* batch;
+    MESSAGE_HANDLE batch_message;
+
+    if ((batch = (AMQP_EVENT_BATCH*)malloc(sizeof(AMQP_EVENT_BATCH))) == NULL)
+    {
+        LogError("Failed allocating the event batch.");
+        result = __LINE__;
+    }
+    else
+    {
+        batch->members = NULL;
+        batch->count = 0;
+        batch->capacity = 0;
+
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_005: [Each batch shall be a uAMQP message created with message_create() and set to the batched message format 0x80013700 with message_set_message_format().]
+        if ((batch_message = message_create()) == NULL)
+        {
+            LogError("Failed creating the batched AMQP message.");
+            result = __LINE__;
+        }
+        else
+        {
+            if (message_set_message_format(batch_message, AMQP_BATCHED_MESSAGE_FORMAT) != RESULT_OK)
+            {
+                LogError("Failed setting the format of the batched AMQP message.");
+                result = __LINE__;
+            }
+            else
+            {
+                IOTHUB_MESSAGE_LIST* message;
+                size_t batch_size = 0;
+                bool is_batch_full = false;
+
+                result = RESULT_OK;
+
+                while (result == RESULT_OK && !is_batch_full && (message = getNextEventToSend(device_state)) != NULL)
+                {
+                    BINARY_DATA encoded_event;
+
+                    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_006: [Each queued event shall be encoded with message_create_uamqp_encoding_from_iothub_message(), using the application properties cache of the device, and added to the batch as one data section with message_add_body_amqp_data(), until the next one would make the batch larger than `amqp_batch_max_bytes`; a batch always takes at least one event.]
+                    if (message_create_uamqp_encoding_from_iothub_message(message->messageHandle, &device_state->application_properties_cache, &encoded_event) != RESULT_OK)
+                    {
+                        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_007: [If an event cannot be encoded, it shall be completed with IOTHUB_CLIENT_CONFIRMATION_ERROR and the batch shall go on with the next event.]
+                        LogError("Failed encoding an event for the batch.");
+                        trackEventInProgress(message, device_state);
+                        on_message_send_complete(message, MESSAGE_SEND_ERROR);
+                    }
+                    else
+                    {
+                        if (batch->count > 0 && batch_size + encoded_event.length > device_state->transport_state->batch_max_bytes)
+                        {
+                            is_batch_full = true;
+                        }
+                        else if (addEventToBatch(batch, message) != RESULT_OK)
+                        {
+                            result = __LINE__;
+                        }
+                        else if (message_add_body_amqp_data(batch_message, encoded_event) != RESULT_OK)
+                        {
+                            LogError("Failed adding an event to the batched AMQP message.");
+                            batch->count--;
+                            result = __LINE__;
+                        }
+                        else
+                        {
+                            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_086: [IoTHubTransport_AMQP_Common_DoWork shall move queued events to an "in-progress" list right before processing them for sending]
+                            trackEventInProgress(message, device_state);
+                            batch_size += encoded_event.length;
+                        }
+
+                        free((void*)encoded_event.bytes);
+                    }
+                }
+
+                if (result == RESULT_OK && batch->count > 0)
+                {
+                    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_008: [The batch shall be sent with a single messagesender_send() call, completed by one disposition.]
+                    if (messagesender_send(device_state->message_sender, batch_message, on_batch_send_complete, batch) != RESULT_OK)
+                    {
+                        LogError("Failed sending the batched AMQP message.");
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        // The batch now belongs to on_batch_send_complete.
+                        batch = NULL;
+                    }
+                }
+
+                if (result != RESULT_OK)
+                {
+                    size_t i;
+
+                    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_010: [If the batch cannot be built or sent, its events shall be rolled back to the waitToSend list and IoTHubTransport_AMQP_Common_DoWork shall stop sending for the device.]
+                    for (i = 0; i < batch->count; i++)
+                    {
+                        rollEventBackToWaitList(batch->members[i], device_state);
+                    }
+                }
+            }
+
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_194: [IoTHubTransport_AMQP_Common_DoWork shall destroy the MESSAGE_HANDLE instance after messagesender_send() is invoked.]
+            message_destroy(batch_message);
+        }
+
+        if (batch != NULL)
+        {
+            free(batch->members);
+            free(batch);
+        }
+    }
+
+    return result;
+}
+
+static int sendPendingEventBatches(AMQP_TRANSPORT_DEVICE_STATE* device_state)
+{
+    int result = RESULT_OK;
+
+    if (isEventBatchReady(device_state))
+    {
+        // Once a batch is due, everything queued goes out, in as many batches as it takes.
+        while (result == RESULT_OK && !DList_IsListEmpty(device_state->waitingToSend))
+        {
+            result = sendEventBatch(device_state);
+        }
+
+        device_state->is_batch_lingering = false;
+    }
+
+    return result;
+}
+
+static bool isAuthenticationSlotAvailable(AMQP_TRANSPORT_INSTANCE* transport_state)
+{
+    return (transport_state->max_pending_authentications == 0 ||
+        transport_state->pending_authentications < transport_state->max_pending_authentications);
+}
+
+static void trackPendingAuthentication(AMQP_TRANSPORT_DEVICE_STATE* device_state)
+{
+    device_state->is_authentication_pending = true;
+    device_state->transport_state->pending_authentications++;
+}
+
+static void releasePendingAuthentication(AMQP_TRANSPORT_DEVICE_STATE* device_state)
+{
+    if (device_state->is_authentication_pending)
+    {
+        device_state->is_authentication_pending = false;
+        device_state->transport_state->pending_authentications--;
+    }
+}
+
 static void prepareDeviceForConnectionRetry(AMQP_TRANSPORT_DEVICE_STATE* device_state)
 {
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_024: [When the connection is retried or the device is unregistered, the pending authentication of the device, if any, shall be released.]
+    releasePendingAuthentication(device_state);
+    device_state->authentication_start_time = INDEFINITE_TIME;
+
     if (authentication_reset(device_state->authentication) != RESULT_OK)
     {
         LogError("Failed resetting the authenticatication state of device %s", STRING_c_str(device_state->deviceId));
@@ -1161,6 +1492,25 @@ TRANSPORT_LL_HANDLE IoTHubTransport_AMQP_Common_Create(const IOTHUBTRANSPORT_CON
             transport_state->xioOptions = NULL; 
             transport_state->link_count = 0;
 
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_022: [IoTHubTransport_AMQP_Common_Create shall not limit the number of pending authentications (`amqp_max_pending_authentications` set to 0).]
+            transport_state->max_pending_authentications = 0;
+            transport_state->pending_authentications = 0;
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_028: [IoTHubTransport_AMQP_Common_Create shall start with empty authentication statistics (no device ready and no time-to-ready).]
+            transport_state->devices_ready = 0;
+            transport_state->total_time_to_ready = 0;
+            transport_state->max_time_to_ready = 0;
+
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_001: [IoTHubTransport_AMQP_Common_Create shall leave batching off (`amqp_batch_max_bytes` and `amqp_batch_linger_ms` set to 0).]
+            transport_state->batch_max_bytes = 0;
+            transport_state->batch_linger_ms = 0;
+            transport_state->batch_tick_counter = NULL;
+
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_018: [IoTHubTransport_AMQP_Common_Create shall set the session windows and link max message sizes to their defaults: UINT_MAX incoming window, 100 outgoing window, UINT64_MAX for the sender and 65536 for the receiver.]
+            transport_state->incoming_window = (uint32_t)DEFAULT_INCOMING_WINDOW_SIZE;
+            transport_state->outgoing_window = DEFAULT_OUTGOING_WINDOW_SIZE;
+            transport_state->sender_max_message_size = MESSAGE_SENDER_MAX_LINK_SIZE;
+            transport_state->receiver_max_message_size = MESSAGE_RECEIVER_MAX_LINK_SIZE;
+
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_010: [If config->upperConfig->protocolGatewayHostName is NULL, IoTHubTransport_AMQP_Common_Create shall create an immutable string, referred to as iotHubHostFqdn, from the following pieces: config->iotHubName + "." + config->iotHubSuffix.] 
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_20_001: [If config->upperConfig->protocolGatewayHostName is not NULL, IoTHubTransport_AMQP_Common_Create shall use it as iotHubHostFqdn]
             if ((transport_state->iotHubHostFqdn = (config->upperConfig->protocolGatewayHostName != NULL ? STRING_construct(config->upperConfig->protocolGatewayHostName) : concat3Params(config->upperConfig->iotHubName, ".", config->upperConfig->iotHubSuffix))) == NULL)
@@ -1198,25 +1548,48 @@ static RESULT device_DoWork(AMQP_TRANSPORT_DEVICE_STATE* device_state)
     // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_243: [IoTHubTransport_AMQP_Common_DoWork shall retrieve the authenticatication status of the device using deviceauthentication_get_status()]
     AUTHENTICATION_STATUS auth_status = authentication_get_status(device_state->authentication);
 
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_023: [A device shall hold one of the transport pending authentications from the moment authentication_authenticate() or authentication_refresh() succeeds until its authentication status is no longer AUTHENTICATION_STATUS_IN_PROGRESS.]
+    if (auth_status != AUTHENTICATION_STATUS_IN_PROGRESS)
+    {
+        releasePendingAuthentication(device_state);
+    }
+
     switch (auth_status)
     {
         case AUTHENTICATION_STATUS_IDLE:
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_243: [If the device authentication status is AUTHENTICATION_STATUS_IDLE, IoTHubTransport_AMQP_Common_DoWork shall authenticate it using authentication_authenticate()]
-            if (authentication_authenticate(device_state->authentication) != RESULT_OK)
+            if (!isAuthenticationSlotAvailable(device_state->transport_state))
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_025: [If `amqp_max_pending_authentications` is not 0 and that many devices hold a pending authentication, IoTHubTransport_AMQP_Common_DoWork shall not authenticate or refresh the device, and shall process the next device; the device is retried on a later DoWork.]
+            }
+            else if (authentication_authenticate(device_state->authentication) != RESULT_OK)
             {
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_146: [If authentication_authenticate() fails, IoTHubTransport_AMQP_Common_DoWork shall fail and process the next device]
                 LogError("Failed authenticating AMQP connection [%s]", STRING_c_str(device_state->deviceId));
                 result = RESULT_RETRYABLE_ERROR;
             }
+            else
+            {
+                trackPendingAuthentication(device_state);
+                device_state->authentication_start_time = get_time(NULL);
+            }
             break;
         case AUTHENTICATION_STATUS_REFRESH_REQUIRED:
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_081: [If the device authentication status is AUTHENTICATION_STATUS_REFRESH_REQUIRED, IoTHubTransport_AMQP_Common_DoWork shall refresh it using authentication_refresh()]
-            if (authentication_refresh(device_state->authentication) != RESULT_OK)
+            if (!isAuthenticationSlotAvailable(device_state->transport_state))
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_025: [If `amqp_max_pending_authentications` is not 0 and that many devices hold a pending authentication, IoTHubTransport_AMQP_Common_DoWork shall not authenticate or refresh the device, and shall process the next device; the device is retried on a later DoWork.]
+            }
+            else if (authentication_refresh(device_state->authentication) != RESULT_OK)
             {
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_082: [**If authentication_refresh() fails, IoTHubTransport_AMQP_Common_DoWork shall fail and process the next device]
                 LogError("AMQP transport failed to refresh authentication [%s]", STRING_c_str(device_state->deviceId));
                 result = RESULT_RETRYABLE_ERROR;
             }
+            else
+            {
+                trackPendingAuthentication(device_state);
+            }
             break;
         case AUTHENTICATION_STATUS_OK:
 #ifdef WIP_C2D_METHODS_AMQP /* This feature is WIP, do not use yet */
@@ -1253,8 +1626,9 @@ static RESULT device_DoWork(AMQP_TRANSPORT_DEVICE_STATE* device_state)
                 result = RESULT_CRITICAL_ERROR;
             }
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_245: [IoTHubTransport_AMQP_Common_DoWork shall skip sending events if the state of the message_sender is not MESSAGE_SENDER_STATE_OPEN]
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_002: [If `amqp_batch_max_bytes` is not 0, IoTHubTransport_AMQP_Common_DoWork shall send the queued events in batched AMQP messages instead of one message per event.]
             else if (device_state->message_sender_state == MESSAGE_SENDER_STATE_OPEN &&
-                sendPendingEvents(device_state) != RESULT_OK)
+                (device_state->transport_state->batch_max_bytes == 0 ? sendPendingEvents(device_state) : sendPendingEventBatches(device_state)) != RESULT_OK)
             {
                 LogError("AMQP transport failed sending events [%s]", STRING_c_str(device_state->deviceId));
                 result = RESULT_CRITICAL_ERROR;
@@ -1561,6 +1935,78 @@ IOTHUB_CLIENT_RESULT IoTHubTransport_AMQP_Common_SetOption(TRANSPORT_LL_HANDLE h
             transport_state->cbs_connection.cbs_request_timeout = *((size_t*)value);
             result = IOTHUB_CLIENT_OK;
         }
+        else if (strcmp(OPTION_AMQP_BATCH_MAX_BYTES, option) == 0)
+        {
+            if (*((const size_t*)value) > AMQP_BATCH_MAX_SIZE)
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_012: [If `amqp_batch_max_bytes` is larger than 262144 (the largest message IoT Hub accepts), IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG.]
+                LogError("amqp_batch_max_bytes cannot be larger than %d", AMQP_BATCH_MAX_SIZE);
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_011: [If `optionName` is `amqp_batch_max_bytes`, IoTHubTransport_AMQP_Common_SetOption shall save the size_t value on the transport instance and return IOTHUB_CLIENT_OK; 0 turns batching off.]
+                transport_state->batch_max_bytes = *((const size_t*)value);
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(OPTION_AMQP_BATCH_LINGER_MS, option) == 0)
+        {
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_013: [If `optionName` is `amqp_batch_linger_ms` and the value is not 0, IoTHubTransport_AMQP_Common_SetOption shall create the batch linger clock using tickcounter_create(), if it does not exist yet.]
+            if (*((const size_t*)value) != 0 &&
+                transport_state->batch_tick_counter == NULL &&
+                (transport_state->batch_tick_counter = tickcounter_create()) == NULL)
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_014: [If tickcounter_create() fails, IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_ERROR and leave `amqp_batch_linger_ms` unchanged.]
+                LogError("Failed creating the clock for amqp_batch_linger_ms");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_016: [Otherwise IoTHubTransport_AMQP_Common_SetOption shall save the `amqp_batch_linger_ms` size_t value on the transport instance and return IOTHUB_CLIENT_OK.]
+                transport_state->batch_linger_ms = *((const size_t*)value);
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(OPTION_AMQP_INCOMING_WINDOW, option) == 0 || strcmp(OPTION_AMQP_OUTGOING_WINDOW, option) == 0)
+        {
+            if (*((const uint32_t*)value) == 0)
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_020: [If the `amqp_incoming_window` or `amqp_outgoing_window` value is 0, IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG.]
+                LogError("%s cannot be 0, no transfer could ever be sent", option);
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_019: [If `optionName` is `amqp_incoming_window` or `amqp_outgoing_window`, IoTHubTransport_AMQP_Common_SetOption shall save the uint32_t value on the transport instance, to be applied when the AMQP session is next created, and return IOTHUB_CLIENT_OK.]
+                if (strcmp(OPTION_AMQP_INCOMING_WINDOW, option) == 0)
+                {
+                    transport_state->incoming_window = *((const uint32_t*)value);
+                }
+                else
+                {
+                    transport_state->outgoing_window = *((const uint32_t*)value);
+                }
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_021: [If `optionName` is `amqp_sender_max_message_size` or `amqp_receiver_max_message_size`, IoTHubTransport_AMQP_Common_SetOption shall save the uint64_t value on the transport instance, to be applied when the links are next created, and return IOTHUB_CLIENT_OK.]
+        else if (strcmp(OPTION_AMQP_SENDER_MAX_MESSAGE_SIZE, option) == 0)
+        {
+            transport_state->sender_max_message_size = *((const uint64_t*)value);
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_AMQP_RECEIVER_MAX_MESSAGE_SIZE, option) == 0)
+        {
+            transport_state->receiver_max_message_size = *((const uint64_t*)value);
+            result = IOTHUB_CLIENT_OK;
+        }
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_027: [If `optionName` is `amqp_max_pending_authentications`, IoTHubTransport_AMQP_Common_SetOption shall save the size_t value on the transport instance and return IOTHUB_CLIENT_OK; 0 removes the limit.]
+        else if (strcmp(OPTION_AMQP_MAX_PENDING_AUTHENTICATIONS, option) == 0)
+        {
+            transport_state->max_pending_authentications = *((const size_t*)value);
+            result = IOTHUB_CLIENT_OK;
+        }
         else if (strcmp(OPTION_LOG_TRACE, option) == 0)
         {
             // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_198: [If `optionName` is `logtrace`, IoTHubTransport_AMQP_Common_SetOption shall save the value on the transport instance.]
@@ -1727,6 +2173,12 @@ IOTHUB_DEVICE_HANDLE IoTHubTransport_AMQP_Common_Register(TRANSPORT_LL_HANDLE ha
                 device_state->waitingToSend = waitingToSend;
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_226: [IoTHubTransport_AMQP_Common_Register shall initialize the device state inProgress list using DList_InitializeListHead().]
                 DList_InitializeListHead(&device_state->inProgress);
+                device_state->is_batch_lingering = false;
+                device_state->batch_linger_start = 0;
+                device_state->application_properties_cache.properties = NULL;
+                device_state->application_properties_cache.uamqp_map = NULL;
+                device_state->is_authentication_pending = false;
+                device_state->authentication_start_time = INDEFINITE_TIME;
 
                 device_state->deviceId = NULL;
                 device_state->authentication = NULL;
@@ -1878,6 +2330,9 @@ void IoTHubTransport_AMQP_Common_Unregister(IOTHUB_DEVICE_HANDLE deviceHandle)
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_029: [IoTHubTransport_AMQP_Common_Unregister shall destroy the AMQP message_sender link.]
                 destroyEventSender(device_state);
 
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_024: [When the connection is retried or the device is unregistered, the pending authentication of the device, if any, shall be released.]
+                releasePendingAuthentication(device_state);
+
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_025: [IoTHubTransport_AMQP_Common_Unregister shall destroy the AMQP message_receiver.] 
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_211: [IoTHubTransport_AMQP_Common_Unregister shall destroy the AMQP message_receiver link.]
                 destroyMessageReceiver(device_state);
@@ -1893,6 +2348,9 @@ void IoTHubTransport_AMQP_Common_Unregister(IOTHUB_DEVICE_HANDLE deviceHandle)
                 // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_217: [IoTHubTransport_AMQP_Common_Unregister shall destroy the authentication state of the device using authentication_destroy.]
                 authentication_destroy(device_state->authentication);
 
+                // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_017: [IoTHubTransport_AMQP_Common_Unregister shall release the application properties cache of the device using message_clear_application_properties_cache().]
+                message_clear_application_properties_cache(&device_state->application_properties_cache);
+
 #ifdef WIP_C2D_METHODS_AMQP /* This feature is WIP, do not use yet */
                 /* Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_01_012: [IoTHubTransport_AMQP_Common_Unregister shall destroy the C2D methods handler by calling iothubtransportamqp_methods_destroy.]*/
                 iothubtransportamqp_methods_destroy(device_state->methods_handle);
@@ -1942,6 +2400,12 @@ void IoTHubTransport_AMQP_Common_Destroy(TRANSPORT_LL_HANDLE handle)
             OptionHandler_Destroy(transport_state->xioOptions);
         }
 
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_015: [IoTHubTransport_AMQP_Common_Destroy shall destroy the batch linger clock, if it was created, using tickcounter_destroy().]
+        if (transport_state->batch_tick_counter != NULL)
+        {
+            tickcounter_destroy(transport_state->batch_tick_counter);
+        }
+
         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_150: [IoTHubTransport_AMQP_Common_Destroy shall destroy the transport instance]
         free(transport_state);
     }
@@ -1976,3 +2440,25 @@ STRING_HANDLE IoTHubTransport_AMQP_Common_GetHostname(TRANSPORT_LL_HANDLE handle
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(TRANSPORT_LL_HANDLE handle, AMQP_TRANSPORT_AUTHENTICATION_STATISTICS* statistics)
+{
+    IOTHUB_CLIENT_RESULT result;
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_029: [If `handle` or `statistics` is NULL, IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall return IOTHUB_CLIENT_INVALID_ARG.]
+    if (handle == NULL || statistics == NULL)
+    {
+        LogError("Invalid argument (handle=%p, statistics=%p)", handle, statistics);
+        result = IOTHUB_CLIENT_INVALID_ARG;
+    }
+    else
+    {
+        AMQP_TRANSPORT_INSTANCE* transport_state = (AMQP_TRANSPORT_INSTANCE*)handle;
+
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_030: [Otherwise IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall fill `statistics` with the number of pending authentications, the number of devices ready and their total and longest time-to-ready, and return IOTHUB_CLIENT_OK.]
+        statistics->pending_authentications = transport_state->pending_authentications;
+        statistics->devices_ready = transport_state->devices_ready;
+        statistics->total_time_to_ready = transport_state->total_time_to_ready;
+        statistics->max_time_to_ready = transport_state->max_time_to_ready;
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
@@ -10,6 +10,7 @@
 #include "azure_uamqp_c/message_receiver.h"
 #include "uamqp_messaging.h"
 #include "iothub_client_private.h"
+#include "iothub_client_record_pool.h"
 #include "iothub_client_version.h"
 #include "iothubtransport_amqp_messenger.h"
 
@@ -664,8 +665,8 @@ static void on_message_send_complete_callback(void* context, MESSAGE_SEND_RESULT
 		// Codes_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_129: [`MESSAGE_HANDLE->messageHandle` shall be destroyed using IoTHubMessage_Destroy()]
 		IoTHubMessage_Destroy(message->messageHandle);
 		
-		// Codes_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_130: [MESSAGE_HANDLE shall be destroyed using free()]
-		free(message);
+		// Codes_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_130: [MESSAGE_HANDLE shall be destroyed using IoTHubClient_RecordPool_Free()]
+		IoTHubClient_RecordPool_Free(message);
 	}
 }
 
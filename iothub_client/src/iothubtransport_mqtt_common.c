@@ -13,6 +13,10 @@
 #include "iothub_client_ll.h"
 #include "iothub_client_options.h"
 #include "iothub_client_private.h"
+#include "iothub_client_record_pool.h"
+#include "iothub_client_packet_id_index.h"
+#include "iothub_client_url_encode.h"
+#include "iothub_client_topic_trie.h"
 #include "azure_umqtt_c/mqtt_client.h"
 #include "azure_c_shared_utility/sastoken.h"
 #include "azure_c_shared_utility/tickcounter.h"
@@ -20,13 +24,13 @@
 #include "azure_c_shared_utility/tlsio.h"
 #include "azure_c_shared_utility/platform.h"
 
-#include "azure_c_shared_utility/string_tokenizer.h"
 #include "iothub_client_version.h"
 
 #include "iothubtransport_mqtt_common.h"
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #include <limits.h>
 #include <inttypes.h>
@@ -45,9 +49,7 @@
 #define STATUS_CODE_TIMEOUT_VALUE   408
 #define ERROR_TIME_FOR_RETRY_SECS   5
 #define WAIT_TIME_SECS              (ERROR_TIME_FOR_RETRY_SECS - 1)
-
-static const char TOPIC_DEVICE_TWIN_PREFIX[] = "$iothub/twin";
-static const char TOPIC_DEVICE_METHOD_PREFIX[] = "$iothub/methods";
+#define TOPIC_SCRATCH_MIN_SIZE      128
 
 static const char* TOPIC_GET_DESIRED_STATE = "$iothub/twin/res/#";
 static const char* TOPIC_NOTIFICATION_STATE = "$iothub/twin/PATCH/properties/desired/#";
@@ -75,6 +77,28 @@ static const char* REQUEST_ID_PROPERTY = "?$rid=";
 #define SUBSCRIBE_DEVICE_METHOD_TOPIC           0x0010
 #define SUBSCRIBE_TOPIC_COUNT                   4
 
+typedef enum RECEIVED_TOPIC_TAG
+{
+    RECEIVED_TOPIC_TWIN_PATCH,
+    RECEIVED_TOPIC_TWIN_RESPONSE,
+    RECEIVED_TOPIC_METHOD_REQUEST,
+    RECEIVED_TOPIC_CLOUD_TO_DEVICE
+} RECEIVED_TOPIC;
+
+typedef struct RECEIVED_TOPIC_FILTER_TAG
+{
+    const char* filter;
+    RECEIVED_TOPIC type;
+} RECEIVED_TOPIC_FILTER;
+
+/*the '+' levels are the fields read out of a received topic: twin response type and status, method name*/
+static const RECEIVED_TOPIC_FILTER receivedTopicFilters[] = {
+    { "$iothub/twin/PATCH/properties/desired/#", RECEIVED_TOPIC_TWIN_PATCH },
+    { "$iothub/twin/+/+/#", RECEIVED_TOPIC_TWIN_RESPONSE },
+    { "$iothub/methods/POST/+/#", RECEIVED_TOPIC_METHOD_REQUEST },
+    { "devices/+/messages/devicebound/#", RECEIVED_TOPIC_CLOUD_TO_DEVICE }
+};
+
 typedef struct SYSTEM_PROPERTY_INFO_TAG
 {
     const char* propName;
@@ -123,6 +147,12 @@ typedef struct RETRY_LOGIC_TAG
     size_t delayFromLastConnectToRetry;
 } RETRY_LOGIC;
 
+typedef struct PUBLISH_RATE_LIMIT_TAG
+{
+    size_t perSecond; /*0 means no limit*/
+    int64_t milliTokens; /*thousandths of a message or byte, goes negative when a message bigger than the bucket is let through*/
+} PUBLISH_RATE_LIMIT;
+
 typedef struct MQTT_TRANSPORT_CREDENTIALS_TAG
 {
     MQTT_TRANSPORT_CREDENTIAL_TYPE credential_type;
@@ -177,6 +207,7 @@ typedef struct MQTTTRANSPORT_HANDLE_DATA_TAG
 
     // Session - connection
     uint16_t packetId;
+    size_t pendingSubscribeAcks; /*SUBSCRIBEs sent on this connection that have not been acknowledged yet*/
 
     // Connection state control
     bool isRegistered;
@@ -195,12 +226,28 @@ typedef struct MQTTTRANSPORT_HANDLE_DATA_TAG
     // Internal lists for message tracking
     PDLIST_ENTRY waitingToSend;
     DLIST_ENTRY ack_waiting_queue;
+    PACKET_ID_INDEX ack_waiting_index;
 
     // Message tracking
     CONTROL_PACKET_TYPE currPacketState;
 
     // Telemetry specific
     DLIST_ENTRY telemetry_waitingForAck;
+    PACKET_ID_INDEX telemetry_waitingForAckIndex;
+    RECORD_POOL_HANDLE messageDetailsPool;
+    char* topicScratch; /*reused to build publish topics and decode received properties*/
+    size_t topicScratchSize;
+    TOPIC_TRIE receivedTopics;
+
+    // Telemetry pacing, 0 means no limit
+    size_t maxInFlight;
+    PUBLISH_RATE_LIMIT messageRateLimit;
+    PUBLISH_RATE_LIMIT byteRateLimit;
+    tickcounter_ms_t rateLimitRefillTime;
+
+    // Telemetry resend
+    size_t resendTimeoutSecs;
+    size_t maxSendCount;
 
     //Retry Logic
     RETRY_LOGIC* retryLogic;
@@ -216,6 +263,7 @@ typedef struct MQTT_DEVICE_TWIN_ITEM_TAG
     IOTHUB_DEVICE_TWIN* device_twin_data;
     DEVICE_TWIN_MSG_TYPE device_twin_msg_type;
     DLIST_ENTRY entry;
+    PACKET_ID_INDEX_ENTRY packetIdEntry;
 } MQTT_DEVICE_TWIN_ITEM;
 
 typedef struct MQTT_MESSAGE_DETAILS_LIST_TAG
@@ -226,6 +274,7 @@ typedef struct MQTT_MESSAGE_DETAILS_LIST_TAG
     void* context;
     uint16_t packet_id;
     DLIST_ENTRY entry;
+    PACKET_ID_INDEX_ENTRY packetIdEntry;
 } MQTT_MESSAGE_DETAILS_LIST, *PMQTT_MESSAGE_DETAILS_LIST;
 
 typedef struct DEVICE_METHOD_INFO_TAG
@@ -560,267 +609,227 @@ static const char* retrieve_mqtt_return_codes(CONNECT_RETURN_CODE rtn_code)
     }
 }
 
-static int retrieve_device_method_rid_info(const char* resp_topic, STRING_HANDLE method_name, STRING_HANDLE request_id)
+static void build_received_topics(TOPIC_TRIE* receivedTopics)
+{
+    size_t index;
+    IoTHubClient_TopicTrie_Init(receivedTopics);
+    for (index = 0; index < sizeof(receivedTopicFilters) / sizeof(receivedTopicFilters[0]); index++)
+    {
+        if (IoTHubClient_TopicTrie_Add(receivedTopics, receivedTopicFilters[index].filter, (int)receivedTopicFilters[index].type) != 0)
+        {
+            /*the filters are constants, this can only fail if TOPIC_TRIE_MAX_NODES is made too small for them*/
+            LogError("unable to add topic filter %s, such messages will be handled as cloud to device messages", receivedTopicFilters[index].filter);
+        }
+    }
+}
+
+static int parse_request_id(const char* remainder, const char** request_id, size_t* request_id_length)
 {
     int result;
-    STRING_TOKENIZER_HANDLE token_handle = STRING_TOKENIZER_create_from_char(resp_topic);
-    if (token_handle == NULL)
+    size_t prefix_length = strlen(REQUEST_ID_PROPERTY);
+    if (strncmp(remainder, REQUEST_ID_PROPERTY, prefix_length) != 0)
     {
-        LogError("Failed creating token from device twin topic.");
         result = __LINE__;
     }
     else
     {
-        STRING_HANDLE token_value;
-        if ((token_value = STRING_new()) == NULL)
-        {
-            LogError("Failed allocating new string .");
-            result = __LINE__;
-        }
-        else
-        {
-            size_t token_index = 0;
-            size_t request_id_length = strlen(REQUEST_ID_PROPERTY);
-            result = __LINE__;
-            while (STRING_TOKENIZER_get_next_token(token_handle, token_value, "/") == 0)
-            {
-                if (token_index == 3)
-                {
-                    if (STRING_concat_with_STRING(method_name, token_value) != 0)
-                    {
-                        LogError("Failed STRING_concat_with_STRING.");
-                        result = __LINE__;
-                        break;
-                    }
-                }
-                else if (token_index == 4)
-                {
-                    if (STRING_length(token_value) >= request_id_length)
-                    {
-                        const char* request_id_value = STRING_c_str(token_value);
-                        if (memcmp(request_id_value, REQUEST_ID_PROPERTY, request_id_length) == 0)
-                        {
-                            if (STRING_concat(request_id, request_id_value+request_id_length) != 0)
-                            {
-                                LogError("Failed STRING_concat failed.");
-                                result = __LINE__;
-                            }
-                            else
-                            {
-                                result = 0;
-                            }
-                            break;
-                        }
-                    }
-                }
-                token_index++;
-            }
-            STRING_delete(token_value);
-        }
-        STRING_TOKENIZER_destroy(token_handle);
+        *request_id = remainder + prefix_length;
+        *request_id_length = strcspn(*request_id, "&/");
+        result = (*request_id_length == 0) ? __LINE__ : 0;
     }
     return result;
 }
 
-static int parse_device_twin_topic_info(const char* resp_topic, bool* patch_msg, size_t* request_id, int* status_code)
+static void sendMsgComplete(IOTHUB_MESSAGE_LIST* iothubMsgList, PMQTTTRANSPORT_HANDLE_DATA transport_data, IOTHUB_CLIENT_CONFIRMATION_RESULT confirmResult)
 {
-    int result;
-    STRING_TOKENIZER_HANDLE token_handle = STRING_TOKENIZER_create_from_char(resp_topic);
-    if (token_handle == NULL)
+    DLIST_ENTRY messageCompleted;
+    DList_InitializeListHead(&messageCompleted);
+    DList_InsertTailList(&messageCompleted, &(iothubMsgList->entry));
+    IoTHubClient_LL_SendComplete(transport_data->llClientHandle, &messageCompleted, confirmResult);
+}
+
+static char* reserve_topic_scratch(PMQTTTRANSPORT_HANDLE_DATA transport_data, size_t size)
+{
+    char* result;
+    if (size <= transport_data->topicScratchSize)
     {
-        LogError("Failed creating token from device twin topic.");
-        result = __LINE__;
-        *status_code = 0;
-        *request_id = 0;
-        *patch_msg = false;
+        result = transport_data->topicScratch;
     }
     else
     {
-        STRING_HANDLE token_value;
-        if ((token_value = STRING_new()) == NULL)
+        size_t newSize = transport_data->topicScratchSize * 2;
+        if (newSize < size)
         {
-            LogError("Failed allocating new string .");
-            result = __LINE__;
-            *status_code = 0;
-            *request_id = 0;
-            *patch_msg = false;
+            newSize = size;
+        }
+        if (newSize < TOPIC_SCRATCH_MIN_SIZE)
+        {
+            newSize = TOPIC_SCRATCH_MIN_SIZE;
+        }
+
+        if ((result = (char*)realloc(transport_data->topicScratch, newSize)) == NULL)
+        {
+            LogError("unable to grow the topic buffer to %zu bytes", newSize);
         }
         else
         {
-            result = __LINE__;
-            size_t token_count = 0;
-            while (STRING_TOKENIZER_get_next_token(token_handle, token_value, "/") == 0)
-            {
-                if (token_count == 2)
-                {
-                    if (strcmp(STRING_c_str(token_value), "PATCH") == 0)
-                    {
-                        *patch_msg = true;
-                        *status_code = 0;
-                        *request_id = 0;
-                        result = 0;
-                        break;
-                    }
-                    else
-                    {
-                        *patch_msg = false;
-                    }
-                }
-                else if (token_count == 3)
-                {
-                    *status_code = atol(STRING_c_str(token_value));
-                    if (STRING_TOKENIZER_get_next_token(token_handle, token_value, "/?$rid=") == 0)
-                    {
-                        *request_id = (size_t)atol(STRING_c_str(token_value));
-                    }
-                    *patch_msg = false;
-                    result = 0;
-                    break;
-                }
-                token_count++;
-            }
-            STRING_delete(token_value);
+            transport_data->topicScratch = result;
+            transport_data->topicScratchSize = newSize;
         }
-        STRING_TOKENIZER_destroy(token_handle);
     }
     return result;
 }
 
-static IOTHUB_IDENTITY_TYPE retrieve_topic_type(const char* topic_resp)
+static const char* build_telemetry_topic(PMQTTTRANSPORT_HANDLE_DATA transport_data, IOTHUB_MESSAGE_HANDLE iothub_message_handle)
 {
-    IOTHUB_IDENTITY_TYPE type;
-    size_t dev_twin_topic_len = sizeof(TOPIC_DEVICE_TWIN_PREFIX)-1;
-    size_t dev_method_topic_len = sizeof(TOPIC_DEVICE_METHOD_PREFIX)-1;
-    size_t topic_len = strlen(topic_resp);
-    size_t len_to_use = (dev_twin_topic_len > dev_method_topic_len) ? dev_twin_topic_len : dev_method_topic_len;
+    const char* result;
+    const char* eventTopic = STRING_c_str(transport_data->topic_MqttEvent);
+    const char* const* propertyKeys = NULL;
+    const char* const* propertyValues = NULL;
+    size_t propertyCount = 0;
 
-    bool search_device_twin = true;
-    bool search_device_method = true;
-    if (topic_len < len_to_use)
+    // Construct Properties
+    MAP_HANDLE properties_map = IoTHubMessage_Properties(iothub_message_handle);
+    if ((properties_map != NULL) && (Map_GetInternals(properties_map, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK))
     {
-        search_device_twin = false;
-        search_device_method = false;
+        LogError("Failed to get the internals of the property map.");
+        result = NULL;
     }
     else
     {
-        size_t index = 0;
-        for (index = 0; index < len_to_use && (search_device_twin || search_device_method); index++)
+        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_017: [The telemetry topic shall be the event topic followed by the URL encoded key=value pairs of the message properties separated by '&'; its length shall be computed before anything is written and it shall be built in a buffer owned by the transport and reused for every publish.] */
+        size_t eventTopicLength = strlen(eventTopic);
+        size_t topicLength = eventTopicLength + ((propertyCount > 0) ? (propertyCount - 1) : 0);
+        size_t index;
+        char* topic;
+        for (index = 0; index < propertyCount; index++)
         {
-            if (search_device_twin)
-            {
-                if (index > dev_twin_topic_len)
-                {
-                    search_device_twin = false;
-                }
-                else
-                {
-                    if (index == dev_twin_topic_len)
-                    {
-                        break;
-                    }
-                    else if (TOUPPER(TOPIC_DEVICE_TWIN_PREFIX[index]) != TOUPPER(topic_resp[index]))
-                    {
-                        search_device_twin = false;
-                    }
-                }
-            }
-            if (search_device_method)
+            topicLength += IoTHubClient_UrlEncode_GetEncodedLength(propertyKeys[index], strlen(propertyKeys[index])) + 1 +
+                IoTHubClient_UrlEncode_GetEncodedLength(propertyValues[index], strlen(propertyValues[index]));
+        }
+
+        if ((topic = reserve_topic_scratch(transport_data, topicLength + 1)) == NULL)
+        {
+            result = NULL;
+        }
+        else
+        {
+            char* cursor = topic;
+            (void)memcpy(cursor, eventTopic, eventTopicLength);
+            cursor += eventTopicLength;
+            for (index = 0; index < propertyCount; index++)
             {
-                if (index > dev_method_topic_len)
+                size_t keyLength = strlen(propertyKeys[index]);
+                size_t valueLength = strlen(propertyValues[index]);
+                if (index > 0)
                 {
-                    search_device_method = false;
-                }
-                else
-                {
-                    if (index == dev_method_topic_len)
-                    {
-                        break;
-                    }
-                    else if (TOUPPER(TOPIC_DEVICE_METHOD_PREFIX[index]) != TOUPPER(topic_resp[index]))
-                    {
-                        search_device_method = false;
-                    }
+                    *cursor++ = *PROPERTY_SEPARATOR;
                 }
+                (void)IoTHubClient_UrlEncode_Encode(cursor, propertyKeys[index], keyLength);
+                cursor += IoTHubClient_UrlEncode_GetEncodedLength(propertyKeys[index], keyLength);
+                *cursor++ = '=';
+                (void)IoTHubClient_UrlEncode_Encode(cursor, propertyValues[index], valueLength);
+                cursor += IoTHubClient_UrlEncode_GetEncodedLength(propertyValues[index], valueLength);
             }
+            *cursor = '\0';
+            result = topic;
         }
     }
-    if (search_device_twin)
-    {
-        type = IOTHUB_TYPE_DEVICE_TWIN;
-    }
-    else if (search_device_method)
-    {
-        type = IOTHUB_TYPE_DEVICE_METHODS;
-    }
-    else
-    {
-        type = IOTHUB_TYPE_TELEMETRY;
-    }
-    return type;
+    return result;
 }
 
-static void sendMsgComplete(IOTHUB_MESSAGE_LIST* iothubMsgList, PMQTTTRANSPORT_HANDLE_DATA transport_data, IOTHUB_CLIENT_CONFIRMATION_RESULT confirmResult)
+static void set_rate_limit(PMQTTTRANSPORT_HANDLE_DATA transport_data, PUBLISH_RATE_LIMIT* rateLimit, size_t perSecond)
 {
-    DLIST_ENTRY messageCompleted;
-    DList_InitializeListHead(&messageCompleted);
-    DList_InsertTailList(&messageCompleted, &(iothubMsgList->entry));
-    IoTHubClient_LL_SendComplete(transport_data->llClientHandle, &messageCompleted, confirmResult);
+    rateLimit->perSecond = perSecond;
+    /*start with a full bucket, one second worth of publishes*/
+    rateLimit->milliTokens = (int64_t)perSecond * 1000;
+    (void)tickcounter_get_current_ms(transport_data->msgTickCounter, &transport_data->rateLimitRefillTime);
 }
 
-static STRING_HANDLE addPropertiesTouMqttMessage(IOTHUB_MESSAGE_HANDLE iothub_message_handle, const char* eventTopic)
+static void refill_rate_limit(PUBLISH_RATE_LIMIT* rateLimit, tickcounter_ms_t elapsed_ms)
 {
-    STRING_HANDLE result = STRING_construct(eventTopic);
-    const char* const* propertyKeys;
-    const char* const* propertyValues;
-    size_t propertyCount;
-
-    // Construct Properties
-    MAP_HANDLE properties_map = IoTHubMessage_Properties(iothub_message_handle);
-    if (properties_map != NULL)
+    if (rateLimit->perSecond != 0)
     {
-        if (Map_GetInternals(properties_map, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK)
+        /*perSecond tokens a second is perSecond milliTokens a millisecond*/
+        int64_t capacity = (int64_t)rateLimit->perSecond * 1000;
+        uint64_t missing = (uint64_t)(capacity - rateLimit->milliTokens);
+        if ((uint64_t)elapsed_ms >= (missing / rateLimit->perSecond) + 1)
         {
-            LogError("Failed to get the internals of the property map.");
-            STRING_delete(result);
-            result = NULL;
+            rateLimit->milliTokens = capacity;
         }
         else
         {
-            if (propertyCount != 0)
-            {
-                size_t index = 0;
-                for (index = 0; index < propertyCount && result != NULL; index++)
-                {
-                    if (STRING_sprintf(result, "%s=%s%s", propertyKeys[index], propertyValues[index], propertyCount - 1 == index ? "" : PROPERTY_SEPARATOR) != 0)
-                    {
-                        STRING_delete(result);
-                        result = NULL;
-                    }
-                }
-            }
+            rateLimit->milliTokens += (int64_t)elapsed_ms * (int64_t)rateLimit->perSecond;
         }
     }
+}
+
+static void refill_rate_limits(PMQTTTRANSPORT_HANDLE_DATA transport_data)
+{
+    tickcounter_ms_t current_ms;
+    if (((transport_data->messageRateLimit.perSecond != 0) || (transport_data->byteRateLimit.perSecond != 0)) &&
+        (tickcounter_get_current_ms(transport_data->msgTickCounter, &current_ms) == 0))
+    {
+        tickcounter_ms_t elapsed_ms = current_ms - transport_data->rateLimitRefillTime;
+        transport_data->rateLimitRefillTime = current_ms;
+        refill_rate_limit(&transport_data->messageRateLimit, elapsed_ms);
+        refill_rate_limit(&transport_data->byteRateLimit, elapsed_ms);
+    }
+}
+
+static bool rate_limit_allows(const PUBLISH_RATE_LIMIT* rateLimit, size_t cost)
+{
+    bool result;
+    if (rateLimit->perSecond == 0)
+    {
+        result = true;
+    }
+    else
+    {
+        /*a message bigger than the whole bucket only waits for a full bucket, and leaves it in debt*/
+        int64_t capacity = (int64_t)rateLimit->perSecond * 1000;
+        int64_t milliCost = (int64_t)cost * 1000;
+        result = rateLimit->milliTokens >= ((milliCost < capacity) ? milliCost : capacity);
+    }
     return result;
 }
 
+static void charge_telemetry_publish(PMQTTTRANSPORT_HANDLE_DATA transport_data, size_t messageLength)
+{
+    if (transport_data->messageRateLimit.perSecond != 0)
+    {
+        transport_data->messageRateLimit.milliTokens -= 1000;
+    }
+    if (transport_data->byteRateLimit.perSecond != 0)
+    {
+        transport_data->byteRateLimit.milliTokens -= (int64_t)messageLength * 1000;
+    }
+}
+
 static int publish_mqtt_telemetry_msg(PMQTTTRANSPORT_HANDLE_DATA transport_data, MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry, const unsigned char* payload, size_t len)
 {
     int result;
-    STRING_HANDLE msgTopic = addPropertiesTouMqttMessage(mqttMsgEntry->iotHubMessageEntry->messageHandle, STRING_c_str(transport_data->topic_MqttEvent));
+    const char* msgTopic = build_telemetry_topic(transport_data, mqttMsgEntry->iotHubMessageEntry->messageHandle);
     if (msgTopic == NULL)
     {
         result = __LINE__;
     }
     else
     {
-        MQTT_MESSAGE_HANDLE mqttMsg = mqttmessage_create(mqttMsgEntry->packet_id, STRING_c_str(msgTopic), DELIVER_AT_LEAST_ONCE, payload, len);
+        MQTT_MESSAGE_HANDLE mqttMsg = mqttmessage_create(mqttMsgEntry->packet_id, msgTopic, DELIVER_AT_LEAST_ONCE, payload, len);
         if (mqttMsg == NULL)
         {
             result = __LINE__;
         }
         else
         {
-            if (tickcounter_get_current_ms(transport_data->msgTickCounter, &mqttMsgEntry->msgPublishTime) != 0)
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_037: [ A telemetry message that is published again shall keep its packet id and shall be marked as a duplicate. ] */
+            if ((mqttMsgEntry->retryCount > 0) && (mqttmessage_setIsDuplicateMsg(mqttMsg, true) != 0))
+            {
+                LogError("Failed marking the message as a duplicate");
+                result = __LINE__;
+            }
+            else if (tickcounter_get_current_ms(transport_data->msgTickCounter, &mqttMsgEntry->msgPublishTime) != 0)
             {
                 LogError("Failed retrieving tickcounter info");
                 result = __LINE__;
@@ -839,7 +848,6 @@ static int publish_mqtt_telemetry_msg(PMQTTTRANSPORT_HANDLE_DATA transport_data,
             }
             mqttmessage_destroy(mqttMsg);
         }
-        STRING_delete(msgTopic);
     }
     return result;
 }
@@ -926,6 +934,7 @@ static int publish_device_twin_get_message(MQTTTRANSPORT_HANDLE_DATA* transport_
                 else
                 {
                     DList_InsertTailList(&transport_data->ack_waiting_queue, &mqtt_info->entry);
+                    (void)IoTHubClient_PacketIdIndex_Insert(&transport_data->ack_waiting_index, &mqtt_info->packetIdEntry, mqtt_info->packet_id);
                     result = 0;
                 }
                 mqttmessage_destroy(mqtt_get_msg);
@@ -983,14 +992,14 @@ static int publish_device_twin_message(MQTTTRANSPORT_HANDLE_DATA* transport_data
     return result;
 }
 
-static bool isSystemProperty(const char* tokenData)
+static bool isSystemProperty(const char* tokenData, size_t tokenLength)
 {
     bool result = false;
     size_t propCount = sizeof(sysPropList)/sizeof(sysPropList[0]);
     size_t index = 0;
     for (index = 0; index < propCount; index++)
     {
-        if (memcmp(tokenData, sysPropList[index].propName, sysPropList[index].propLength) == 0)
+        if ((tokenLength >= sysPropList[index].propLength) && (memcmp(tokenData, sysPropList[index].propName, sysPropList[index].propLength) == 0))
         {
             result = true;
             break;
@@ -999,99 +1008,80 @@ static bool isSystemProperty(const char* tokenData)
     return result;
 }
 
-static int extractMqttProperties(IOTHUB_MESSAGE_HANDLE IoTHubMessage, const char* topic_name)
+static int extractMqttProperties(PMQTTTRANSPORT_HANDLE_DATA transport_data, IOTHUB_MESSAGE_HANDLE IoTHubMessage, const char* topic_name)
 {
     int result;
-    STRING_HANDLE mqttTopic = STRING_construct(topic_name);
-    if (mqttTopic == NULL)
+    MAP_HANDLE propertyMap = IoTHubMessage_Properties(IoTHubMessage);
+    if (propertyMap == NULL)
     {
-        LogError("Failure constructing string topic name.");
+        LogError("Failure to retrieve IoTHubMessage_properties.");
         result = __LINE__;
     }
     else
     {
-        STRING_TOKENIZER_HANDLE token = STRING_TOKENIZER_create(mqttTopic);
-        if (token != NULL)
+        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_018: [The properties of a received message shall be parsed in place from the '&' separated key=value pairs that follow the last '/' of the topic; system properties and pairs without '=' or without a key shall be skipped.] */
+        const char* propertyBag = topic_name;
+        const char* cursor;
+        for (cursor = topic_name; (*cursor != '\0') && (*cursor != *PROPERTY_SEPARATOR); cursor++)
         {
-            MAP_HANDLE propertyMap = IoTHubMessage_Properties(IoTHubMessage);
-            if (propertyMap == NULL)
+            if (*cursor == '/')
             {
-                LogError("Failure to retrieve IoTHubMessage_properties.");
-                result = __LINE__;
+                propertyBag = cursor + 1;
             }
-            else
+        }
+
+        result = 0;
+        cursor = propertyBag;
+        while ((*cursor != '\0') && (result == 0))
+        {
+            const char* tokenEnd = strchr(cursor, *PROPERTY_SEPARATOR);
+            size_t tokenLength;
+            const char* equalSign;
+            if (tokenEnd == NULL)
             {
-                STRING_HANDLE output = STRING_new();
-                if (output == NULL)
+                tokenEnd = cursor + strlen(cursor);
+            }
+            tokenLength = tokenEnd - cursor;
+
+            if (((equalSign = (const char*)memchr(cursor, '=', tokenLength)) != NULL) && (equalSign != cursor) && !isSystemProperty(cursor, tokenLength))
+            {
+                size_t nameLength = equalSign - cursor;
+                size_t valueLength = tokenEnd - (equalSign + 1);
+                size_t decodedNameLength;
+                size_t decodedValueLength;
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_019: [Keys and values shall be URL decoded into the buffer owned by the transport before being added to the message properties.] */
+                char* propName = reserve_topic_scratch(transport_data, nameLength + valueLength + 2);
+                if (propName == NULL)
                 {
-                    LogError("Failure to allocate STRING_new.");
+                    result = __LINE__;
+                }
+                else if (IoTHubClient_UrlEncode_Decode(propName, cursor, nameLength, &decodedNameLength) != 0)
+                {
+                    LogError("Failure decoding a property name.");
                     result = __LINE__;
                 }
                 else
                 {
-                    result = 0;
-                    while (STRING_TOKENIZER_get_next_token(token, output, PROPERTY_SEPARATOR) == 0 && result == 0)
+                    char* propValue = propName + decodedNameLength + 1;
+                    propName[decodedNameLength] = '\0';
+                    if (IoTHubClient_UrlEncode_Decode(propValue, equalSign + 1, valueLength, &decodedValueLength) != 0)
                     {
-                        const char* tokenData = STRING_c_str(output);
-                        size_t tokenLen = strlen(tokenData);
-                        if (tokenData == NULL || tokenLen == 0)
+                        LogError("Failure decoding a property value.");
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        propValue[decodedValueLength] = '\0';
+                        if (Map_AddOrUpdate(propertyMap, propName, propValue) != MAP_OK)
                         {
-                            break;
-                        }
-                        else
-                        {
-                            if (!isSystemProperty(tokenData) )
-                            {
-                                const char* iterator = tokenData;
-                                while (iterator != NULL && *iterator != '\0' && result == 0)
-                                {
-                                    if (*iterator == '=')
-                                    {
-                                        size_t nameLen = iterator - tokenData;
-                                        char* propName = malloc(nameLen + 1);
-
-                                        size_t valLen = tokenLen - (nameLen + 1) + 1;
-                                        char* propValue = malloc(valLen + 1);
-
-                                        if (propName == NULL || propValue == NULL)
-                                        {
-                                            result = __LINE__;
-                                        }
-                                        else
-                                        {
-                                            strncpy(propName, tokenData, nameLen);
-                                            propName[nameLen] = '\0';
-
-                                            strncpy(propValue, iterator + 1, valLen);
-                                            propValue[valLen] = '\0';
-
-                                            if (Map_AddOrUpdate(propertyMap, propName, propValue) != MAP_OK)
-                                            {
-                                                LogError("Map_AddOrUpdate failed.");
-                                                result = __LINE__;
-                                            }
-                                        }
-                                        free(propName);
-                                        free(propValue);
-
-                                        break;
-                                    }
-                                    iterator++;
-                                }
-                            }
+                            LogError("Map_AddOrUpdate failed.");
+                            result = __LINE__;
                         }
                     }
-                    STRING_delete(output);
                 }
             }
-            STRING_TOKENIZER_destroy(token);
-        }
-        else
-        {
-            LogError("Unable to create Tokenizer object.");
-            result = __LINE__;
+            cursor = (*tokenEnd == '\0') ? tokenEnd : tokenEnd + 1;
         }
-        STRING_delete(mqttTopic);
     }
     return result;
 }
@@ -1110,94 +1100,101 @@ static void mqtt_notification_callback(MQTT_MESSAGE_HANDLE msgHandle, void* call
         else
         {
             PMQTTTRANSPORT_HANDLE_DATA transportData = (PMQTTTRANSPORT_HANDLE_DATA)callbackCtx;
+            TOPIC_TRIE_MATCH match;
+            RECEIVED_TOPIC type;
 
-            IOTHUB_IDENTITY_TYPE type = retrieve_topic_type(topic_resp);
-            if (type == IOTHUB_TYPE_DEVICE_TWIN)
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_038: [ `mqtt_notification_callback` shall classify the topic and locate its fields in one pass over it, by matching it against a trie of the received topic filters built when the transport is created. ] */
+            if (IoTHubClient_TopicTrie_Match(&transportData->receivedTopics, topic_resp, &match) == 0)
+            {
+                type = (RECEIVED_TOPIC)match.value;
+            }
+            else
             {
-                size_t request_id;
-                int status_code;
-                bool notification_msg;
-                if (parse_device_twin_topic_info(topic_resp, &notification_msg, &request_id, &status_code) != 0)
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_039: [ A topic that matches none of the filters shall be handled as a cloud to device message. ] */
+                type = RECEIVED_TOPIC_CLOUD_TO_DEVICE;
+            }
+
+            if (type == RECEIVED_TOPIC_TWIN_PATCH)
+            {
+                const APP_PAYLOAD* payload = mqttmessage_getApplicationMsg(msgHandle);
+                IoTHubClient_LL_RetrievePropertyComplete(transportData->llClientHandle, DEVICE_TWIN_UPDATE_PARTIAL, payload->message, payload->length);
+            }
+            else if (type == RECEIVED_TOPIC_TWIN_RESPONSE)
+            {
+                const char* request_id;
+                size_t request_id_length;
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_040: [ The status code and $rid of a twin response shall be read in place from the topic, without allocating. ] */
+                if (parse_request_id(match.remainder, &request_id, &request_id_length) != 0)
                 {
                     LogError("Failure: parsing device topic info");
                 }
                 else
                 {
-                    const APP_PAYLOAD* payload = mqttmessage_getApplicationMsg(msgHandle);
-                    if (notification_msg)
-                    {
-                        IoTHubClient_LL_RetrievePropertyComplete(transportData->llClientHandle, DEVICE_TWIN_UPDATE_PARTIAL, payload->message, payload->length);
-                    }
-                    else
+                    int status_code = atoi(match.captures[1]);
+                    unsigned long packet_id = strtoul(request_id, NULL, 10);
+
+                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_005: [ If type is IOTHUB_TYPE_DEVICE_TWIN and the message is a response, `mqtt_notification_callback` shall look the request up by its $rid (the packet id it was published with) in an index of ack_waiting_queue instead of walking the list. ] */
+                    PACKET_ID_INDEX_ENTRY* dev_twin_item = (packet_id <= UINT16_MAX) ? IoTHubClient_PacketIdIndex_Remove(&transportData->ack_waiting_index, (uint16_t)packet_id) : NULL;
+                    if (dev_twin_item != NULL)
                     {
-                        PDLIST_ENTRY dev_twin_item = transportData->ack_waiting_queue.Flink;
-                        while (dev_twin_item != &transportData->ack_waiting_queue)
+                        const APP_PAYLOAD* payload = mqttmessage_getApplicationMsg(msgHandle);
+                        MQTT_DEVICE_TWIN_ITEM* msg_entry = containingRecord(dev_twin_item, MQTT_DEVICE_TWIN_ITEM, packetIdEntry);
+                        (void)DList_RemoveEntryList(&msg_entry->entry);
+                        if (msg_entry->device_twin_msg_type == RETRIEVE_PROPERTIES)
                         {
-                            DLIST_ENTRY saveListEntry;
-                            saveListEntry.Flink = dev_twin_item->Flink;
-                            MQTT_DEVICE_TWIN_ITEM* msg_entry = containingRecord(dev_twin_item, MQTT_DEVICE_TWIN_ITEM, entry);
-                            if (request_id == msg_entry->packet_id)
-                            {
-                                (void)DList_RemoveEntryList(dev_twin_item);
-                                if (msg_entry->device_twin_msg_type == RETRIEVE_PROPERTIES)
-                                {
-                                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_054: [ If type is IOTHUB_TYPE_DEVICE_TWIN, then on success if msg_type is RETRIEVE_PROPERTIES then mqtt_notification_callback shall call IoTHubClient_LL_RetrievePropertyComplete... ] */
-                                    IoTHubClient_LL_RetrievePropertyComplete(transportData->llClientHandle, DEVICE_TWIN_UPDATE_COMPLETE, payload->message, payload->length);
-                                }
-                                else
-                                {
-                                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_055: [ if device_twin_msg_type is not RETRIEVE_PROPERTIES then mqtt_notification_callback shall call IoTHubClient_LL_ReportedStateComplete ] */
-                                    IoTHubClient_LL_ReportedStateComplete(transportData->llClientHandle, msg_entry->iothub_msg_id, status_code);
-                                }
-                                free(msg_entry);
-                                break;
-                            }
-                            dev_twin_item = saveListEntry.Flink;
+                            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_054: [ If type is IOTHUB_TYPE_DEVICE_TWIN, then on success if msg_type is RETRIEVE_PROPERTIES then mqtt_notification_callback shall call IoTHubClient_LL_RetrievePropertyComplete... ] */
+                            IoTHubClient_LL_RetrievePropertyComplete(transportData->llClientHandle, DEVICE_TWIN_UPDATE_COMPLETE, payload->message, payload->length);
                         }
+                        else
+                        {
+                            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_055: [ if device_twin_msg_type is not RETRIEVE_PROPERTIES then mqtt_notification_callback shall call IoTHubClient_LL_ReportedStateComplete ] */
+                            IoTHubClient_LL_ReportedStateComplete(transportData->llClientHandle, msg_entry->iothub_msg_id, status_code);
+                        }
+                        free(msg_entry);
                     }
                 }
             }
-            else if (type == IOTHUB_TYPE_DEVICE_METHODS)
+            else if (type == RECEIVED_TOPIC_METHOD_REQUEST)
             {
-                STRING_HANDLE method_name = STRING_new();
-                if (method_name == NULL)
+                const char* request_id;
+                size_t request_id_length;
+                char* method_name;
+                if (parse_request_id(match.remainder, &request_id, &request_id_length) != 0)
+                {
+                    LogError("Failure: retrieve device topic info");
+                }
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_041: [ The method name shall be copied out of the topic into the transport's reusable topic buffer, so that only the request id handed over to IoTHubClient_LL_DeviceMethodComplete is allocated. ] */
+                else if ((method_name = reserve_topic_scratch(transportData, match.captureLengths[0] + 1)) == NULL)
                 {
                     LogError("Failure: allocating method_name string value");
                 }
                 else
                 {
-                    DEVICE_METHOD_INFO* dev_method_info = malloc(sizeof(DEVICE_METHOD_INFO) );
+                    DEVICE_METHOD_INFO* dev_method_info;
+                    (void)memcpy(method_name, match.captures[0], match.captureLengths[0]);
+                    method_name[match.captureLengths[0]] = '\0';
+
+                    dev_method_info = malloc(sizeof(DEVICE_METHOD_INFO));
                     if (dev_method_info == NULL)
                     {
                         LogError("Failure: allocating DEVICE_METHOD_INFO object");
                     }
+                    else if ((dev_method_info->request_id = STRING_construct_n(request_id, request_id_length)) == NULL)
+                    {
+                        LogError("Failure constructing request_id string");
+                        free(dev_method_info);
+                    }
                     else
                     {
-                        dev_method_info->request_id = STRING_new();
-                        if (dev_method_info->request_id == NULL)
-                        {
-                            LogError("Failure constructing request_id string");
-                            free(dev_method_info);
-                        }
-                        else if (retrieve_device_method_rid_info(topic_resp, method_name, dev_method_info->request_id) != 0)
+                        /* CodesSRS_IOTHUB_MQTT_TRANSPORT_07_053: [ If type is IOTHUB_TYPE_DEVICE_METHODS, then on success mqtt_notification_callback shall call IoTHubClient_LL_DeviceMethodComplete. ] */
+                        const APP_PAYLOAD* payload = mqttmessage_getApplicationMsg(msgHandle);
+                        if (IoTHubClient_LL_DeviceMethodComplete(transportData->llClientHandle, method_name, payload->message, payload->length, (void*)dev_method_info) != 0)
                         {
-                            LogError("Failure: retrieve device topic info");
+                            LogError("Failure: IoTHubClient_LL_DeviceMethodComplete");
                             STRING_delete(dev_method_info->request_id);
                             free(dev_method_info);
                         }
-                        else
-                        {
-                            /* CodesSRS_IOTHUB_MQTT_TRANSPORT_07_053: [ If type is IOTHUB_TYPE_DEVICE_METHODS, then on success mqtt_notification_callback shall call IoTHubClient_LL_DeviceMethodComplete. ] */
-                            const APP_PAYLOAD* payload = mqttmessage_getApplicationMsg(msgHandle);
-                            if (IoTHubClient_LL_DeviceMethodComplete(transportData->llClientHandle, STRING_c_str(method_name), payload->message, payload->length, (void*)dev_method_info) != 0)
-                            {
-                                LogError("Failure: IoTHubClient_LL_DeviceMethodComplete");
-                                STRING_delete(dev_method_info->request_id);
-                                free(dev_method_info);
-                            }
-                        }
                     }
-                    STRING_delete(method_name);
                 }
             }
             else
@@ -1211,7 +1208,7 @@ static void mqtt_notification_callback(MQTT_MESSAGE_HANDLE msgHandle, void* call
                 else
                 {
                     // Will need to update this when the service has messages that can be rejected
-                    if (extractMqttProperties(IoTHubMessage, topic_resp) != 0)
+                    if (extractMqttProperties(transportData, IoTHubMessage, topic_resp) != 0)
                     {
                         LogError("failure extracting mqtt properties.");
                     }
@@ -1230,6 +1227,26 @@ static void mqtt_notification_callback(MQTT_MESSAGE_HANDLE msgHandle, void* call
     }
 }
 
+static void subscribe_all_topics_again(PMQTTTRANSPORT_HANDLE_DATA transport_data)
+{
+    if (transport_data->topic_MqttMessage != NULL)
+    {
+        transport_data->topics_ToSubscribe |= SUBSCRIBE_TELEMETRY_TOPIC;
+    }
+    if (transport_data->topic_GetState != NULL)
+    {
+        transport_data->topics_ToSubscribe |= SUBSCRIBE_GET_REPORTED_STATE_TOPIC;
+    }
+    if (transport_data->topic_NotifyState != NULL)
+    {
+        transport_data->topics_ToSubscribe |= SUBSCRIBE_NOTIFICATION_STATE_TOPIC;
+    }
+    if (transport_data->topic_DeviceMethods != NULL)
+    {
+        transport_data->topics_ToSubscribe |= SUBSCRIBE_DEVICE_METHOD_TOPIC;
+    }
+}
+
 static void mqtt_operation_complete_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLIENT_EVENT_RESULT actionResult, const void* msgInfo, void* callbackCtx)
 {
     (void)handle;
@@ -1245,20 +1262,14 @@ static void mqtt_operation_complete_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLI
                 const PUBLISH_ACK* puback = (const PUBLISH_ACK*)msgInfo;
                 if (puback != NULL)
                 {
-                    PDLIST_ENTRY currentListEntry = transport_data->telemetry_waitingForAck.Flink;
-                    while (currentListEntry != &transport_data->telemetry_waitingForAck)
+                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_004: [ On MQTT_CLIENT_ON_PUBLISH_ACK `mqtt_operation_complete_callback` shall look the acknowledged message up by its packet id in an index of telemetry_waitingForAck instead of walking the list, remove it and complete it with IOTHUB_CLIENT_CONFIRMATION_OK. ] */
+                    PACKET_ID_INDEX_ENTRY* packetIdEntry = IoTHubClient_PacketIdIndex_Remove(&transport_data->telemetry_waitingForAckIndex, puback->packetId);
+                    if (packetIdEntry != NULL)
                     {
-                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
-                        DLIST_ENTRY saveListEntry;
-                        saveListEntry.Flink = currentListEntry->Flink;
-
-                        if (puback->packetId == mqttMsgEntry->packet_id)
-                        {
-                            (void)DList_RemoveEntryList(currentListEntry); //First remove the item from Waiting for Ack List.
-                            sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_OK);
-                            free(mqttMsgEntry);
-                        }
-                        currentListEntry = saveListEntry.Flink;
+                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(packetIdEntry, MQTT_MESSAGE_DETAILS_LIST, packetIdEntry);
+                        (void)DList_RemoveEntryList(&mqttMsgEntry->entry); //First remove the item from Waiting for Ack List.
+                        sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_OK);
+                        IoTHubClient_RecordPool_Free(mqttMsgEntry);
                     }
                 }
                 else
@@ -1277,6 +1288,17 @@ static void mqtt_operation_complete_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLI
                         // The connect packet has been acked
                         transport_data->currPacketState = CONNACK_TYPE;
                         transport_data->isRecoverableError = true;
+                        if (!connack->isSessionPresent || (transport_data->pendingSubscribeAcks != 0))
+                        {
+                            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_035: [ If the CONNACK does not report a session present, or a SUBSCRIBE of the previous connection was not acknowledged, every topic the transport is subscribed to shall be subscribed again. ] */
+                            subscribe_all_topics_again(transport_data);
+                        }
+                        else
+                        {
+                            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_036: [ If the CONNACK reports a session present, the subscriptions of the session shall be kept and only the topics that were never subscribed shall be subscribed. ] */
+                            LogInfo("Resuming the MQTT session, subscriptions are kept");
+                        }
+                        transport_data->pendingSubscribeAcks = 0;
                         StopRetryTimer(transport_data->retryLogic);
                         IotHubClient_LL_ConnectionStatusCallBack(transport_data->llClientHandle, IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK);
                     }
@@ -1320,6 +1342,10 @@ static void mqtt_operation_complete_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLI
                             LogError("Subscribe delivery failure of subscribe %zu", index);
                         }
                     }
+                    if (transport_data->pendingSubscribeAcks > 0)
+                    {
+                        transport_data->pendingSubscribeAcks--;
+                    }
                     // The connect packet has been acked
                     transport_data->currPacketState = SUBACK_TYPE;
                 }
@@ -1368,22 +1394,6 @@ static void mqtt_error_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLIENT_EVENT_ERR
         transport_data->isConnected = false;
         transport_data->currPacketState = PACKET_TYPE_ERROR;
         transport_data->device_twin_get_sent = false;
-        if (transport_data->topic_MqttMessage != NULL)
-        {
-            transport_data->topics_ToSubscribe |= SUBSCRIBE_TELEMETRY_TOPIC;
-        }
-        if (transport_data->topic_GetState != NULL)
-        {
-            transport_data->topics_ToSubscribe |= SUBSCRIBE_GET_REPORTED_STATE_TOPIC;
-        }
-        if (transport_data->topic_NotifyState != NULL)
-        {
-            transport_data->topics_ToSubscribe |= SUBSCRIBE_NOTIFICATION_STATE_TOPIC;
-        }
-        if (transport_data->topic_DeviceMethods != NULL)
-        {
-            transport_data->topics_ToSubscribe |= SUBSCRIBE_DEVICE_METHOD_TOPIC;
-        }
     }
     else
     {
@@ -1438,6 +1448,7 @@ static void SubscribeToMqttProtocol(PMQTTTRANSPORT_HANDLE_DATA transport_data)
             else
             {
                 /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_018: [On success IoTHubTransport_MQTT_Common_Subscribe shall return 0.] */
+                transport_data->pendingSubscribeAcks++;
                 transport_data->topics_ToSubscribe &= ~topic_subscription;
                 transport_data->currPacketState = SUBSCRIBE_TYPE;
             }
@@ -1649,22 +1660,6 @@ static int InitializeConnection(PMQTTTRANSPORT_HANDLE_DATA transport_data)
                     transport_data->isConnected = false;
                     transport_data->currPacketState = UNKNOWN_TYPE;
                     transport_data->device_twin_get_sent = false;
-                    if (transport_data->topic_MqttMessage != NULL)
-                    {
-                        transport_data->topics_ToSubscribe |= SUBSCRIBE_TELEMETRY_TOPIC;
-                    }
-                    if (transport_data->topic_GetState != NULL)
-                    {
-                        transport_data->topics_ToSubscribe |= SUBSCRIBE_GET_REPORTED_STATE_TOPIC;
-                    }
-                    if (transport_data->topic_NotifyState != NULL)
-                    {
-                        transport_data->topics_ToSubscribe |= SUBSCRIBE_NOTIFICATION_STATE_TOPIC;
-                    }
-                    if (transport_data->topic_DeviceMethods != NULL)
-                    {
-                        transport_data->topics_ToSubscribe |= SUBSCRIBE_DEVICE_METHOD_TOPIC;
-                    }
                 }
             }
         }
@@ -1846,12 +1841,27 @@ static PMQTTTRANSPORT_HANDLE_DATA InitializeTransportHandleData(const IOTHUB_CLI
                     /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_010: [IoTHubTransport_MQTT_Common_Create shall allocate memory to save its internal state where all topics, hostname, device_id, device_key, sasTokenSr and client handle shall be saved.] */
                     DList_InitializeListHead(&(state->telemetry_waitingForAck));
                     DList_InitializeListHead(&(state->ack_waiting_queue));
+                    IoTHubClient_PacketIdIndex_Init(&(state->telemetry_waitingForAckIndex));
+                    IoTHubClient_PacketIdIndex_Init(&(state->ack_waiting_index));
+                    state->messageDetailsPool = NULL;
+                    state->topicScratch = NULL;
+                    state->topicScratchSize = 0;
+                    build_received_topics(&(state->receivedTopics));
+                    state->maxInFlight = 0;
+                    state->messageRateLimit.perSecond = 0;
+                    state->messageRateLimit.milliTokens = 0;
+                    state->byteRateLimit.perSecond = 0;
+                    state->byteRateLimit.milliTokens = 0;
+                    state->rateLimitRefillTime = 0;
+                    state->resendTimeoutSecs = RESEND_TIMEOUT_VALUE_MIN;
+                    state->maxSendCount = MAX_SEND_RECOUNT_LIMIT;
                     state->isDestroyCalled = false;
                     state->isRegistered = false;
                     state->isConnected = false;
                     state->device_twin_get_sent = false;
                     state->isRecoverableError = true;
                     state->packetId = 1;
+                    state->pendingSubscribeAcks = 0;
                     state->llClientHandle = NULL;
                     state->xioTransport = NULL;
                     state->portNum = 0;
@@ -1969,7 +1979,7 @@ void IoTHubTransport_MQTT_Common_Destroy(TRANSPORT_LL_HANDLE handle)
             PDLIST_ENTRY currentEntry = DList_RemoveHeadList(&transport_data->telemetry_waitingForAck);
             MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
             sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY);
-            free(mqttMsgEntry);
+            IoTHubClient_RecordPool_Free(mqttMsgEntry);
         }
         while (!DList_IsListEmpty(&transport_data->ack_waiting_queue))
         {
@@ -1978,6 +1988,8 @@ void IoTHubTransport_MQTT_Common_Destroy(TRANSPORT_LL_HANDLE handle)
             IoTHubClient_LL_ReportedStateComplete(transport_data->llClientHandle, mqtt_device_twin->iothub_msg_id, STATUS_CODE_TIMEOUT_VALUE);
             free(mqtt_device_twin);
         }
+        IoTHubClient_PacketIdIndex_Deinit(&transport_data->telemetry_waitingForAckIndex);
+        IoTHubClient_PacketIdIndex_Deinit(&transport_data->ack_waiting_index);
 
         switch (transport_data->transport_creds.credential_type)
         {
@@ -2006,6 +2018,11 @@ void IoTHubTransport_MQTT_Common_Destroy(TRANSPORT_LL_HANDLE handle)
 
         tickcounter_destroy(transport_data->msgTickCounter);
         DestroyRetryLogic(transport_data->retryLogic);
+        IoTHubClient_RecordPool_Destroy(transport_data->messageDetailsPool);
+        if (transport_data->topicScratch != NULL)
+        {
+            free(transport_data->topicScratch);
+        }
         free(transport_data);
     }
 }
@@ -2323,6 +2340,7 @@ IOTHUB_PROCESS_ITEM_RESULT IoTHubTransport_MQTT_Common_ProcessItem(TRANSPORT_LL_
                     }
                     else
                     {
+                        (void)IoTHubClient_PacketIdIndex_Insert(&transport_data->ack_waiting_index, &mqtt_info->packetIdEntry, mqtt_info->packet_id);
                         result = IOTHUB_PROCESS_OK;
                     }
                 }
@@ -2342,6 +2360,22 @@ IOTHUB_PROCESS_ITEM_RESULT IoTHubTransport_MQTT_Common_ProcessItem(TRANSPORT_LL_
     return result;
 }
 
+static void send_device_twin_get_once(PMQTTTRANSPORT_HANDLE_DATA transport_data)
+{
+    if ((transport_data->topic_NotifyState != NULL || transport_data->topic_GetState != NULL) &&
+        !transport_data->device_twin_get_sent)
+    {
+        if (publish_device_twin_get_message(transport_data) == 0)
+        {
+            transport_data->device_twin_get_sent = true;
+        }
+        else
+        {
+            LogError("Failure: sending device twin get property command.");
+        }
+    }
+}
+
 /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_054: [ IoTHubTransport_MQTT_Common_DoWork shall subscribe to the Notification and get_state Topics if they are defined. ] */
 void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
 {
@@ -2359,46 +2393,52 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
         {
             if (transport_data->currPacketState == CONNACK_TYPE || transport_data->currPacketState == SUBSCRIBE_TYPE)
             {
+                bool connackReceived = (transport_data->currPacketState == CONNACK_TYPE);
                 SubscribeToMqttProtocol(transport_data);
+                if (connackReceived && transport_data->currPacketState == PUBLISH_TYPE)
+                {
+                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_042: [ If the CONNACK reports a session present and no topic has to be subscribed, IoTHubTransport_MQTT_Common_DoWork shall send the device twin get property message right away when the device twin topics are subscribed. ] */
+                    send_device_twin_get_once(transport_data);
+                }
             }
             else if (transport_data->currPacketState == SUBACK_TYPE)
             {
-                if ((transport_data->topic_NotifyState != NULL || transport_data->topic_GetState != NULL) &&
-                    !transport_data->device_twin_get_sent)
-                {
-                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_055: [ IoTHubTransport_MQTT_Common_DoWork shall send a device twin get property message upon successfully retrieving a SUBACK on device twin topics. ] */
-                    if (publish_device_twin_get_message(transport_data) == 0)
-                    {
-                        transport_data->device_twin_get_sent = true;
-                    }
-                    else
-                    {
-                        LogError("Failure: sending device twin get property command.");
-                    }
-                }
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_055: [ IoTHubTransport_MQTT_Common_DoWork shall send a device twin get property message upon successfully retrieving a SUBACK on device twin topics. ] */
+                send_device_twin_get_once(transport_data);
                 // Publish can be called now
                 transport_data->currPacketState = PUBLISH_TYPE;
             }
             else if (transport_data->currPacketState == PUBLISH_TYPE)
             {
                 PDLIST_ENTRY currentListEntry = transport_data->telemetry_waitingForAck.Flink;
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_012: [telemetry_waitingForAck shall be kept in the order the messages were last published, so IoTHubTransport_MQTT_Common_DoWork shall read the tick counter once and stop at the first message that has not timed out.] */
+                PDLIST_ENTRY lastListEntry = transport_data->telemetry_waitingForAck.Blink;
+                tickcounter_ms_t current_ms = 0;
+                if (currentListEntry != &transport_data->telemetry_waitingForAck)
+                {
+                    (void)tickcounter_get_current_ms(transport_data->msgTickCounter, &current_ms);
+                }
                 while (currentListEntry != &transport_data->telemetry_waitingForAck)
                 {
                     MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
                     DLIST_ENTRY nextListEntry;
-                    nextListEntry.Flink = currentListEntry->Flink;
+                    /*messages resent below move past lastListEntry, they are not looked at again in this DoWork*/
+                    nextListEntry.Flink = (currentListEntry == lastListEntry) ? &transport_data->telemetry_waitingForAck : currentListEntry->Flink;
 
-                    tickcounter_ms_t current_ms;
-                    (void)tickcounter_get_current_ms(transport_data->msgTickCounter, &current_ms);
                     /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_033: [IoTHubTransport_MQTT_Common_DoWork shall iterate through the Waiting Acknowledge messages looking for any message that has been waiting longer than 2 min.]*/
-                    if (((current_ms - mqttMsgEntry->msgPublishTime) / 1000) > RESEND_TIMEOUT_VALUE_MIN)
+                    if (((current_ms - mqttMsgEntry->msgPublishTime) / 1000) <= transport_data->resendTimeoutSecs)
+                    {
+                        break;
+                    }
+                    else
                     {
                         /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_034: [If IoTHubTransport_MQTT_Common_DoWork has resent the message two times then it shall fail the message] */
-                        if (mqttMsgEntry->retryCount >= MAX_SEND_RECOUNT_LIMIT)
+                        if (mqttMsgEntry->retryCount >= transport_data->maxSendCount)
                         {
                             (void)DList_RemoveEntryList(currentListEntry);
+                            (void)IoTHubClient_PacketIdIndex_RemoveEntry(&transport_data->telemetry_waitingForAckIndex, &mqttMsgEntry->packetIdEntry);
                             sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT);
-                            free(mqttMsgEntry);
+                            IoTHubClient_RecordPool_Free(mqttMsgEntry);
                         }
                         else
                         {
@@ -2413,8 +2453,17 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
                                 if (publish_mqtt_telemetry_msg(transport_data, mqttMsgEntry, messagePayload, messageLength) != 0)
                                 {
                                     (void)DList_RemoveEntryList(currentListEntry);
+                                    (void)IoTHubClient_PacketIdIndex_RemoveEntry(&transport_data->telemetry_waitingForAckIndex, &mqttMsgEntry->packetIdEntry);
                                     sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_ERROR);
-                                    free(mqttMsgEntry);
+                                    IoTHubClient_RecordPool_Free(mqttMsgEntry);
+                                }
+                                else
+                                {
+                                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_013: [A message that was resent shall be moved to the end of telemetry_waitingForAck.] */
+                                    (void)DList_RemoveEntryList(currentListEntry);
+                                    DList_InsertTailList(&transport_data->telemetry_waitingForAck, currentListEntry);
+                                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_011: [A resent message shall be charged to the "mqtt_max_messages_per_second" and "mqtt_max_bytes_per_second" limits but shall never be delayed by them.] */
+                                    charge_telemetry_publish(transport_data, messageLength);
                                 }
                             }
                         }
@@ -2422,6 +2471,8 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
                     currentListEntry = nextListEntry.Flink;
                 }
 
+                refill_rate_limits(transport_data);
+
                 currentListEntry = transport_data->waitingToSend->Flink;
                 /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_027: [IoTHubTransport_MQTT_Common_DoWork shall inspect the "waitingToSend" DLIST passed in config structure.] */
                 while (currentListEntry != transport_data->waitingToSend)
@@ -2432,15 +2483,25 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
 
                     /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_027: [IoTHubTransport_MQTT_Common_DoWork shall inspect the "waitingToSend" DLIST passed in config structure.] */
                     size_t messageLength;
-                    const unsigned char* messagePayload = RetrieveMessagePayload(iothubMsgList->messageHandle, &messageLength);
-                    if (messageLength == 0 || messagePayload == NULL)
+                    const unsigned char* messagePayload;
+                    if ((transport_data->maxInFlight != 0) && (transport_data->telemetry_waitingForAckIndex.count >= transport_data->maxInFlight))
+                    {
+                        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_009: [While "mqtt_max_in_flight" messages are waiting for their PUBACK, IoTHubTransport_MQTT_Common_DoWork shall leave the remaining messages in "waitingToSend".] */
+                        break;
+                    }
+                    else if ((messagePayload = RetrieveMessagePayload(iothubMsgList->messageHandle, &messageLength)) == NULL || messageLength == 0)
                     {
                         LogError("Failure result from IoTHubMessage_GetData");
                     }
+                    else if (!rate_limit_allows(&transport_data->messageRateLimit, 1) || !rate_limit_allows(&transport_data->byteRateLimit, messageLength))
+                    {
+                        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_010: [When publishing the next message would exceed "mqtt_max_messages_per_second" or "mqtt_max_bytes_per_second", IoTHubTransport_MQTT_Common_DoWork shall leave it and the messages after it in "waitingToSend"; the limits are refilled continuously, up to one second worth of publishes.] */
+                        break;
+                    }
                     else
                     {
                         /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_029: [IoTHubTransport_MQTT_Common_DoWork shall create a MQTT_MESSAGE_HANDLE and pass this to a call to mqtt_client_publish.] */
-                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = (MQTT_MESSAGE_DETAILS_LIST*)malloc(sizeof(MQTT_MESSAGE_DETAILS_LIST));
+                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = (MQTT_MESSAGE_DETAILS_LIST*)IoTHubClient_RecordPool_Alloc(transport_data->messageDetailsPool, sizeof(MQTT_MESSAGE_DETAILS_LIST));
                         if (mqttMsgEntry == NULL)
                         {
                             LogError("Allocation Error: Failure allocating MQTT Message Detail List.");
@@ -2454,12 +2515,14 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
                             {
                                 (void)(DList_RemoveEntryList(currentListEntry));
                                 sendMsgComplete(iothubMsgList, transport_data, IOTHUB_CLIENT_CONFIRMATION_ERROR);
-                                free(mqttMsgEntry);
+                                IoTHubClient_RecordPool_Free(mqttMsgEntry);
                             }
                             else
                             {
                                 (void)(DList_RemoveEntryList(currentListEntry));
                                 DList_InsertTailList(&(transport_data->telemetry_waitingForAck), &(mqttMsgEntry->entry));
+                                (void)IoTHubClient_PacketIdIndex_Insert(&(transport_data->telemetry_waitingForAckIndex), &(mqttMsgEntry->packetIdEntry), mqttMsgEntry->packet_id);
+                                charge_telemetry_publish(transport_data, messageLength);
                             }
                         }
                     }
@@ -2557,6 +2620,65 @@ IOTHUB_CLIENT_RESULT IoTHubTransport_MQTT_Common_SetOption(TRANSPORT_LL_HANDLE h
             LogError("x509privatekey specified, but authentication method is not x509");
             result = IOTHUB_CLIENT_INVALID_ARG;
         }
+        else if (strcmp(OPTION_MESSAGE_POOL_SIZE, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_001: [If the option parameter is set to "message_pool_size" then the value shall be a size_t* giving the number of MQTT message details records to preallocate; 0 shall disable the pool.] */
+            size_t poolSize = *((const size_t*)value);
+            RECORD_POOL_HANDLE newPool = NULL;
+            if ((poolSize != 0) && ((newPool = IoTHubClient_RecordPool_Create(sizeof(MQTT_MESSAGE_DETAILS_LIST), poolSize)) == NULL))
+            {
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_002: [If creating the pool fails, IoTHubTransport_MQTT_Common_SetOption shall keep the current pool and return IOTHUB_CLIENT_ERROR.] */
+                LogError("unable to create a message pool of %zu records", poolSize);
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_003: [Otherwise IoTHubTransport_MQTT_Common_SetOption shall destroy the current pool, keep the new one and return IOTHUB_CLIENT_OK; messages in flight are released to the pool they came from.] */
+                IoTHubClient_RecordPool_Destroy(transport_data->messageDetailsPool);
+                transport_data->messageDetailsPool = newPool;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(OPTION_MQTT_MAX_IN_FLIGHT, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_006: [If the option parameter is set to "mqtt_max_in_flight" then the value shall be a size_t* giving the most telemetry messages that can wait for their PUBACK at the same time; 0 shall remove the limit.] */
+            transport_data->maxInFlight = *((const size_t*)value);
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_MQTT_MAX_MESSAGES_PER_SECOND, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_007: [If the option parameter is set to "mqtt_max_messages_per_second" then the value shall be a size_t* giving the most telemetry messages published per second; 0 shall remove the limit.] */
+            set_rate_limit(transport_data, &transport_data->messageRateLimit, *((const size_t*)value));
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_MQTT_MAX_BYTES_PER_SECOND, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_008: [If the option parameter is set to "mqtt_max_bytes_per_second" then the value shall be a size_t* giving the most telemetry payload bytes published per second; 0 shall remove the limit.] */
+            set_rate_limit(transport_data, &transport_data->byteRateLimit, *((const size_t*)value));
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_MQTT_RESEND_TIMEOUT, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_014: [If the option parameter is set to "mqtt_resend_timeout" then the value shall be a size_t* giving the number of seconds a telemetry message waits for its PUBACK before it is resent; the default is 60.] */
+            transport_data->resendTimeoutSecs = *((const size_t*)value);
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_MQTT_MAX_SEND_COUNT, option) == 0)
+        {
+            size_t maxSendCount = *((const size_t*)value);
+            if (maxSendCount == 0)
+            {
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_016: [If "mqtt_max_send_count" is 0, IoTHubTransport_MQTT_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG.] */
+                LogError("mqtt_max_send_count cannot be 0");
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_41_015: [If the option parameter is set to "mqtt_max_send_count" then the value shall be a size_t* giving how many times a telemetry message is published, first send included, before it is failed with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT; the default is 2.] */
+                transport_data->maxSendCount = maxSendCount;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
         else
         {
             /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_032: [IoTHubTransport_MQTT_Common_SetOption shall pass down the option to xio_setoption if the option parameter is not a known option string for the MQTT transport.] */
@@ -2614,7 +2736,7 @@ IOTHUB_DEVICE_HANDLE IoTHubTransport_MQTT_Common_Register(TRANSPORT_LL_HANDLE ha
             // Codes_SRS_IOTHUB_MQTT_TRANSPORT_17_003: [ IoTHubTransport_MQTT_Common_Register shall return NULL if deviceId or deviceKey do not match the deviceId and deviceKey passed in during IoTHubTransport_MQTT_Common_Create.]
             if (strcmp(STRING_c_str(transport_data->device_id), device->deviceId) != 0)
             {
-                LogError("IoTHubTransport_MQTT_Common_Register: deviceId does not match.");
+                LogError("IoTHubTransport_MQTT_Common_Register: deviceId [%s] does not match the device of the transport [%s]; an MQTT connection carries a single device, use AMQP or HTTP to share one connection between devices.", device->deviceId, STRING_c_str(transport_data->device_id));
                 result = NULL;
             }
             else if ( (transport_data->transport_creds.credential_type == DEVICE_KEY) && (strcmp(STRING_c_str(transport_data->transport_creds.CREDENTIAL_VALUE.deviceKey), device->deviceKey) != 0))
@@ -2626,7 +2748,7 @@ IOTHUB_DEVICE_HANDLE IoTHubTransport_MQTT_Common_Register(TRANSPORT_LL_HANDLE ha
             {
                 if (transport_data->isRegistered == true)
                 {
-                    LogError("Transport already has device registered by id: [%s]", device->deviceId);
+                    LogError("Transport already has device registered by id: [%s]; an MQTT connection carries a single device.", device->deviceId);
                     result = NULL;
                 }
                 else
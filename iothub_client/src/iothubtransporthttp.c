@@ -2,6 +2,7 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <string.h>
 #include "azure_c_shared_utility/gballoc.h"
 
 #include <time.h>
@@ -10,6 +11,7 @@
 #include "iothub_client_private.h"
 #include "iothub_transport_ll.h"
 #include "iothubtransporthttp.h"
+#include "iothub_client_base64.h"
 
 #include "azure_c_shared_utility/httpapiexsas.h"
 #include "azure_c_shared_utility/urlencode.h"
@@ -17,7 +19,6 @@
 #include "azure_c_shared_utility/httpapiex.h"
 #include "azure_c_shared_utility/httpapiexsas.h"
 #include "azure_c_shared_utility/strings.h"
-#include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/doublylinkedlist.h"
 #include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/httpheaders.h"
@@ -39,9 +40,6 @@ const char* IOTHUB_CORRELATION_ID = "iothub-correlationid";
 #define MAXIMUM_PAYLOAD_OVERHEAD 384
 #define MAXIMUM_PROPERTY_OVERHEAD 16
 
-/*forward declaration*/
-static int appendMapToJSON(STRING_HANDLE existing, const char* const* keys, const char* const* values, size_t count);
-
 typedef struct HTTPTRANSPORT_HANDLE_DATA_TAG
 {
     STRING_HANDLE hostName;
@@ -51,6 +49,14 @@ typedef struct HTTPTRANSPORT_HANDLE_DATA_TAG
     VECTOR_HANDLE perDeviceList;
 }HTTPTRANSPORT_HANDLE_DATA;
 
+/*a growable array of bytes where the batched events are serialized*/
+typedef struct PAYLOAD_BUFFER_TAG
+{
+    unsigned char* content;
+    size_t length;
+    size_t capacity;
+} PAYLOAD_BUFFER;
+
 typedef struct HTTPTRANSPORT_PERDEVICE_DATA_TAG
 {
     HTTPTRANSPORT_HANDLE_DATA* transportHandle;
@@ -71,6 +77,7 @@ typedef struct HTTPTRANSPORT_PERDEVICE_DATA_TAG
     IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle;
     PDLIST_ENTRY waitingToSend;
     DLIST_ENTRY eventConfirmations; /*holds items for event confirmations*/
+    PAYLOAD_BUFFER eventPayload; /*holds the batched events, kept between batches so that it is not reallocated every time*/
 } HTTPTRANSPORT_PERDEVICE_DATA;
 
 static void destroy_eventHTTPrelativePath(HTTPTRANSPORT_PERDEVICE_DATA* handleData)
@@ -453,6 +460,17 @@ static bool create_deviceSasToken(HTTPTRANSPORT_PERDEVICE_DATA* handleData, cons
 */
 
 /*Codes_SRS_TRANSPORTMULTITHTTP_17_137: [ IoTHubTransportHttp_Register shall search the devices list for any device matching name deviceId. If deviceId is found it shall return NULL. ]*/
+static void destroy_eventPayload(HTTPTRANSPORT_PERDEVICE_DATA* handleData)
+{
+    if (handleData->eventPayload.content != NULL)
+    {
+        free(handleData->eventPayload.content);
+        handleData->eventPayload.content = NULL;
+    }
+    handleData->eventPayload.length = 0;
+    handleData->eventPayload.capacity = 0;
+}
+
 static bool findDeviceHandle(const void* element, const void* value)
 {
     bool result;
@@ -573,6 +591,9 @@ static IOTHUB_DEVICE_HANDLE IoTHubTransportHttp_Register(TRANSPORT_LL_HANDLE han
                 result->iotHubClientHandle = iotHubClientHandle;
                 result->waitingToSend = waitingToSend;
                 DList_InitializeListHead(&(result->eventConfirmations));
+                result->eventPayload.content = NULL;
+                result->eventPayload.length = 0;
+                result->eventPayload.capacity = 0;
                 result->transportHandle = (HTTPTRANSPORT_HANDLE_DATA *) handle;
             }
             else
@@ -609,6 +630,7 @@ static void destroy_perDeviceData(HTTPTRANSPORT_PERDEVICE_DATA * perDeviceItem)
     destroy_messageHTTPrequestHeaders(perDeviceItem);
     destroy_abandonHTTPrelativePathBegin(perDeviceItem);
     destroy_SASObject(perDeviceItem);
+    destroy_eventPayload(perDeviceItem);
 }
 
 static IOTHUB_DEVICE_HANDLE* get_perDeviceDataItem(IOTHUB_DEVICE_HANDLE deviceHandle)
@@ -951,228 +973,284 @@ static int IoTHubTransportHttp_DeviceMethod_Response(IOTHUB_DEVICE_HANDLE handle
     return __LINE__;
 }
 
-/*produces a representation of the properties, if they exist*/
-/*if they do not exist, produces ""*/
-static int concat_Properties(STRING_HANDLE existing, MAP_HANDLE map, size_t* propertiesMessageSizeContribution)
+/*the JSON text that surrounds the serialization of an event in a batch*/
+#define EVENT_JSON_BODY_BYTEARRAY_BEGIN "{\"body\":\""
+#define EVENT_JSON_BODY_BYTEARRAY_END "\""
+#define EVENT_JSON_BODY_STRING_BEGIN "{\"body\":"
+#define EVENT_JSON_BODY_STRING_END ",\"base64Encoded\":false"
+#define EVENT_JSON_PROPERTIES_BEGIN ",\"properties\":{"
+#define EVENT_JSON_FIRST_PROPERTY_NAME_BEGIN "\"" IOTHUB_APP_PREFIX
+#define EVENT_JSON_PROPERTY_NAME_BEGIN ",\"" IOTHUB_APP_PREFIX
+#define EVENT_JSON_PROPERTY_NAME_END "\":\""
+#define EVENT_JSON_PROPERTY_VALUE_END "\""
+#define EVENT_JSON_PROPERTIES_END "}"
+#define EVENT_JSON_END "}," /*the last comma shall be replaced by a ']' by DaCr's suggestion (which is awesome enough to receive credits in the source code)*/
+
+#define CONST_STRLEN(s) (sizeof(s) - 1)
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+/*computes the length of source and the length of its JSON encoding (quotes included), escaping the same characters as STRING_new_JSON*/
+static int getJSONEncodedLength(const char* source, size_t* sourceLength, size_t* encodedLength)
 {
     int result;
-    const char*const* keys;
-    const char*const* values;
-    size_t count;
-    if (Map_GetInternals(map, &keys, &values, &count) != MAP_OK)
+    size_t i;
+    size_t length = 2; /*the opening and the closing quote*/
+    for (i = 0; source[i] != '\0'; i++)
+    {
+        unsigned char c = (unsigned char)source[i];
+        if (c >= 128)
+        {
+            /*same as STRING_new_JSON, only ASCII is encoded*/
+            break;
+        }
+        else if (c < 0x20)
+        {
+            length += 6; /*\u00XX*/
+        }
+        else if ((c == '"') || (c == '\\') || (c == '/'))
+        {
+            length += 2;
+        }
+        else
+        {
+            length++;
+        }
+    }
+
+    if (source[i] != '\0')
     {
+        LogError("a non-ASCII character was found in the string at position %zu", i);
         result = __LINE__;
-        LogError("error while Map_GetInternals");
     }
     else
     {
+        *sourceLength = i;
+        *encodedLength = length;
+        result = 0;
+    }
+    return result;
+}
 
-        if (count == 0)
+/*writes the JSON encoding of source at destination, destination has to have the length computed by getJSONEncodedLength*/
+static unsigned char* writeJSON(unsigned char* destination, const char* source)
+{
+    size_t i;
+    *destination++ = '"';
+    for (i = 0; source[i] != '\0'; i++)
+    {
+        unsigned char c = (unsigned char)source[i];
+        if (c < 0x20)
         {
-            /*Codes_SRS_TRANSPORTMULTITHTTP_17_064: [If IoTHubMessage does not have properties, then "properties":{...} shall be missing from the payload*/
-            /*no properties - do nothing with existing*/
-            result = 0;
-            *propertiesMessageSizeContribution = 0;
+            *destination++ = '\\';
+            *destination++ = 'u';
+            *destination++ = '0';
+            *destination++ = '0';
+            *destination++ = hexDigits[c >> 4];
+            *destination++ = hexDigits[c & 0x0F];
+        }
+        else if ((c == '"') || (c == '\\') || (c == '/'))
+        {
+            *destination++ = '\\';
+            *destination++ = c;
         }
         else
         {
-            /*Codes_SRS_TRANSPORTMULTITHTTP_17_058: [If IoTHubMessage has properties, then they shall be serialized at the same level as "body" using the following pattern: "properties":{"iothub-app-name1":"value1","iothub-app-name2":"value2*/
-            if (STRING_concat(existing, ",\"properties\":") != 0)
-            {
-                /*go ahead and return it*/
-                result = __LINE__;
-                LogError("failed STRING_concat");
-            }
-            else if (appendMapToJSON(existing, keys, values, count) != 0)
-            {
-                result = __LINE__;
-                LogError("unable to append the properties");
-            }
-            else
-            {
-                /*all is fine*/
-                size_t i;
-                *propertiesMessageSizeContribution = 0;
-                for (i = 0;i < count;i++)
-                {
-                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_063: [Every property name shall add to the message size the length of the property name + the length of the property value + 16 bytes.] */
-                    *propertiesMessageSizeContribution += (strlen(keys[i]) + strlen(values[i]) + MAXIMUM_PROPERTY_OVERHEAD);
-                }
-                result = 0;
-            }
+            *destination++ = c;
         }
     }
-    return result;
+    *destination++ = '"';
+    return destination;
+}
+
+static unsigned char* writeText(unsigned char* destination, const char* source, size_t length)
+{
+    (void)memcpy(destination, source, length);
+    return destination + length;
 }
 
-/*produces a JSON representation of the map : {"a": "value_of_a","b":"value_of_b"}*/
-static int appendMapToJSON(STRING_HANDLE existing, const char* const* keys, const char* const* values, size_t count) /*under consideration: move to MAP module when it has more than 1 user*/
+/*makes room for additionalLength more bytes in the payload, the capacity grows at least twice each time so a batch is reallocated only a few times*/
+static int ensurePayloadCapacity(PAYLOAD_BUFFER* payload, size_t additionalLength)
 {
     int result;
-    if (STRING_concat(existing, "{") != 0)
+    size_t neededCapacity = payload->length + additionalLength;
+    if (neededCapacity <= payload->capacity)
     {
-        /*go on and return it*/
-        result = __LINE__;
-        LogError("STRING_construct failed");
+        result = 0;
     }
     else
     {
-        size_t i;
-        for (i = 0; i < count; i++)
+        size_t newCapacity = 2 * payload->capacity;
+        unsigned char* newContent;
+        if (newCapacity < neededCapacity)
         {
-            if (!(
-                (STRING_concat(existing, (i == 0) ? "\"" IOTHUB_APP_PREFIX : ",\"" IOTHUB_APP_PREFIX) == 0) &&
-                (STRING_concat(existing, keys[i]) == 0) &&
-                (STRING_concat(existing, "\":\"") == 0) &&
-                (STRING_concat(existing, values[i]) == 0) &&
-                (STRING_concat(existing, "\"") == 0)
-                ))
-            {
-                LogError("unable to STRING_concat");
-                break;
-            }
+            newCapacity = neededCapacity;
         }
 
-        if (i < count)
+        if ((newContent = (unsigned char*)realloc(payload->content, newCapacity)) == NULL)
         {
+            LogError("unable to realloc the payload to %zu bytes", newCapacity);
             result = __LINE__;
-            /*error, let it go through*/
-        }
-        else if (STRING_concat(existing, "}") != 0)
-        {
-            result = __LINE__;
-            LogError("unable to STRING_concat");
         }
         else
         {
-            /*all is fine*/
+            payload->content = newContent;
+            payload->capacity = newCapacity;
             result = 0;
         }
     }
     return result;
 }
 
-/*makes the following string:{"body":"base64 encoding of the message content"[,"properties":{"a":"valueOfA"}]}*/
-/*return NULL if there was a failure, or a non-NULL STRING_HANDLE that contains the intended data*/
-static STRING_HANDLE make1EventJSONitem(PDLIST_ENTRY item, size_t *messageSizeContribution)
+#define APPEND_EVENT_RESULT_VALUES \
+    APPEND_EVENT_OK, /*the event was appended to the payload*/ \
+    APPEND_EVENT_DOES_NOT_FIT, /*the event was not appended because it would exceed the message size limit*/ \
+    APPEND_EVENT_ERROR /*the event was not appended because of an error*/
+
+DEFINE_ENUM(APPEND_EVENT_RESULT, APPEND_EVENT_RESULT_VALUES);
+
+/*appends the following string to the payload:{"body":"base64 encoding of the message content"[,"properties":{"a":"valueOfA"}]},*/
+/*the size of the item is computed from the message before anything is encoded, so an item that does not fit costs no encoding*/
+static APPEND_EVENT_RESULT append1EventJSONitem(PAYLOAD_BUFFER* payload, PDLIST_ENTRY item, size_t allMessagesSize, size_t *messageSizeContribution)
 {
-    STRING_HANDLE result; /*temp wants to contain :{"body":"base64 encoding of the message content"[,"properties":{"a":"valueOfA"}]}*/
+    APPEND_EVENT_RESULT result;
     IOTHUB_MESSAGE_LIST* message = containingRecord(item, IOTHUB_MESSAGE_LIST, entry);
     IOTHUBMESSAGE_CONTENT_TYPE contentType = IoTHubMessage_GetContentType(message->messageHandle);
+    const unsigned char* byteArraySource = NULL;
+    const char* stringSource = NULL;
+    size_t sourceLength = 0;
+    size_t encodedBodyLength = 0;
 
     switch (contentType)
     {
     case IOTHUBMESSAGE_BYTEARRAY:
     {
-        result = STRING_construct("{\"body\":\"");
-        if (result == NULL)
+        if (IoTHubMessage_GetByteArray(message->messageHandle, &byteArraySource, &sourceLength) != IOTHUB_MESSAGE_OK)
         {
-            LogError("unable to STRING_construct");
+            LogError("unable to get the data for the message.");
+            result = APPEND_EVENT_ERROR;
         }
         else
         {
-            const unsigned char* source;
-            size_t size;
-
-            if (IoTHubMessage_GetByteArray(message->messageHandle, &source, &size) != IOTHUB_MESSAGE_OK)
-            {
-                LogError("unable to get the data for the message.");
-                STRING_delete(result);
-                result = NULL;
-            }
-            else
-            {
-                STRING_HANDLE encoded = Base64_Encode_Bytes(source, size);
-                if (encoded == NULL)
-                {
-                    LogError("unable to Base64_Encode_Bytes.");
-                    STRING_delete(result);
-                    result = NULL;
-                }
-                else
-                {
-                    size_t propertiesSize;
-                    if (!(
-                        (STRING_concat_with_STRING(result, encoded) == 0) &&
-                        (STRING_concat(result, "\"") == 0) && /*\" because closing value*/
-                        (concat_Properties(result, IoTHubMessage_Properties(message->messageHandle), &propertiesSize) == 0) &&
-                        (STRING_concat(result, "},") == 0) /*the last comma shall be replaced by a ']' by DaCr's suggestion (which is awesome enough to receive credits in the source code)*/
-                        ))
-                    {
-                        STRING_delete(result);
-                        result = NULL;
-                        LogError("unable to STRING_concat_with_STRING.");
-                    }
-                    else
-                    {
-                        /*all is fine... */
-                        /*Codes_SRS_TRANSPORTMULTITHTTP_17_062: [The message size is computed from the length of the payload + 384.] */
-                        *messageSizeContribution = size + MAXIMUM_PAYLOAD_OVERHEAD + propertiesSize;
-                    }
-                    STRING_delete(encoded);
-                }
-            }
+            encodedBodyLength = CONST_STRLEN(EVENT_JSON_BODY_BYTEARRAY_BEGIN) + IoTHubClient_Base64_GetEncodedLength(sourceLength) + CONST_STRLEN(EVENT_JSON_BODY_BYTEARRAY_END);
+            result = APPEND_EVENT_OK;
         }
         break;
     }
     /*Codes_SRS_TRANSPORTMULTITHTTP_17_057: [If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false}] */
     case IOTHUBMESSAGE_STRING:
     {
-        result = STRING_construct("{\"body\":");
-        if (result == NULL)
+        size_t jsonLength;
+        if ((stringSource = IoTHubMessage_GetString(message->messageHandle)) == NULL)
+        {
+            LogError("unable to IoTHubMessage_GetString");
+            result = APPEND_EVENT_ERROR;
+        }
+        else if (getJSONEncodedLength(stringSource, &sourceLength, &jsonLength) != 0)
+        {
+            LogError("unable to JSON encode the string");
+            result = APPEND_EVENT_ERROR;
+        }
+        else
+        {
+            encodedBodyLength = CONST_STRLEN(EVENT_JSON_BODY_STRING_BEGIN) + jsonLength + CONST_STRLEN(EVENT_JSON_BODY_STRING_END);
+            result = APPEND_EVENT_OK;
+        }
+        break;
+    }
+    default:
+    {
+        LogError("an unknown message type was encountered (%d)", contentType);
+        result = APPEND_EVENT_ERROR; /*unknown message type*/
+        break;
+    }
+    }
+
+    if (result == APPEND_EVENT_OK)
+    {
+        const char*const* keys;
+        const char*const* values;
+        size_t count;
+        if (Map_GetInternals(IoTHubMessage_Properties(message->messageHandle), &keys, &values, &count) != MAP_OK)
         {
-            LogError("unable to STRING_construct");
+            LogError("error while Map_GetInternals");
+            result = APPEND_EVENT_ERROR;
         }
         else
         {
-            const char* source = IoTHubMessage_GetString(message->messageHandle);
-            if (source == NULL)
+            size_t i;
+            /*Codes_SRS_TRANSPORTMULTITHTTP_17_062: [The message size is computed from the length of the payload + 384.] */
+            size_t messageSize = sourceLength + MAXIMUM_PAYLOAD_OVERHEAD;
+            size_t itemLength = encodedBodyLength + CONST_STRLEN(EVENT_JSON_END);
+
+            /*Codes_SRS_TRANSPORTMULTITHTTP_17_064: [If IoTHubMessage does not have properties, then "properties":{...} shall be missing from the payload*/
+            if (count > 0)
             {
-                LogError("unable to IoTHubMessage_GetString");
-                STRING_delete(result);
-                result = NULL;
+                itemLength += CONST_STRLEN(EVENT_JSON_PROPERTIES_BEGIN) + CONST_STRLEN(EVENT_JSON_PROPERTIES_END);
+                for (i = 0; i < count; i++)
+                {
+                    size_t keyLength = strlen(keys[i]);
+                    size_t valueLength = strlen(values[i]);
+                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_063: [Every property name shall add to the message size the length of the property name + the length of the property value + 16 bytes.] */
+                    messageSize += keyLength + valueLength + MAXIMUM_PROPERTY_OVERHEAD;
+                    itemLength += ((i == 0) ? CONST_STRLEN(EVENT_JSON_FIRST_PROPERTY_NAME_BEGIN) : CONST_STRLEN(EVENT_JSON_PROPERTY_NAME_BEGIN)) +
+                        keyLength + CONST_STRLEN(EVENT_JSON_PROPERTY_NAME_END) + valueLength + CONST_STRLEN(EVENT_JSON_PROPERTY_VALUE_END);
+                }
+            }
+
+            *messageSizeContribution = messageSize;
+
+            /*Codes_SRS_TRANSPORTMULTITHTTP_41_001: [ The size of every message shall be computed before the message is encoded. A message that would exceed the message size limit shall not be encoded. ]*/
+            /*Codes_SRS_TRANSPORTMULTITHTTP_17_061: [The message size shall be limited to 255KB - 1 byte.]*/
+            if (allMessagesSize + messageSize > MAXIMUM_MESSAGE_SIZE)
+            {
+                result = APPEND_EVENT_DOES_NOT_FIT;
+            }
+            /*Codes_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]*/
+            else if (ensurePayloadCapacity(payload, itemLength) != 0)
+            {
+                LogError("unable to make room for %zu bytes in the payload", itemLength);
+                result = APPEND_EVENT_ERROR;
             }
             else
             {
-                STRING_HANDLE asJson = STRING_new_JSON(source);
-                if (asJson == NULL)
+                unsigned char* destination = payload->content + payload->length;
+                if (contentType == IOTHUBMESSAGE_BYTEARRAY)
                 {
-                    LogError("unable to STRING_new_JSON");
-                    STRING_delete(result);
-                    result = NULL;
+                    destination = writeText(destination, EVENT_JSON_BODY_BYTEARRAY_BEGIN, CONST_STRLEN(EVENT_JSON_BODY_BYTEARRAY_BEGIN));
+                    /*destination has room for the encoding and byteArraySource is only NULL for an empty message, so this cannot fail*/
+                    (void)IoTHubClient_Base64_Encode((char*)destination, byteArraySource, sourceLength, BASE64_ALPHABET_STANDARD);
+                    destination += IoTHubClient_Base64_GetEncodedLength(sourceLength);
+                    destination = writeText(destination, EVENT_JSON_BODY_BYTEARRAY_END, CONST_STRLEN(EVENT_JSON_BODY_BYTEARRAY_END));
                 }
                 else
                 {
-                    size_t propertiesSize;
-                    if (!(
-                        (STRING_concat_with_STRING(result, asJson) == 0) &&
-                        (STRING_concat(result, ",\"base64Encoded\":false") == 0) &&
-                        (concat_Properties(result, IoTHubMessage_Properties(message->messageHandle), &propertiesSize) == 0) &&
-                        (STRING_concat(result, "},") == 0) /*the last comma shall be replaced by a ']' by DaCr's suggestion (which is awesome enough to receive credits in the source code)*/
-                        ))
-                    {
-                        LogError("unable to STRING_concat_with_STRING");
-                        STRING_delete(result);
-                        result = NULL;
-                    }
-                    else
+                    destination = writeText(destination, EVENT_JSON_BODY_STRING_BEGIN, CONST_STRLEN(EVENT_JSON_BODY_STRING_BEGIN));
+                    destination = writeJSON(destination, stringSource);
+                    destination = writeText(destination, EVENT_JSON_BODY_STRING_END, CONST_STRLEN(EVENT_JSON_BODY_STRING_END));
+                }
+
+                if (count > 0)
+                {
+                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_058: [If IoTHubMessage has properties, then they shall be serialized at the same level as "body" using the following pattern: "properties":{"iothub-app-name1":"value1","iothub-app-name2":"value2*/
+                    destination = writeText(destination, EVENT_JSON_PROPERTIES_BEGIN, CONST_STRLEN(EVENT_JSON_PROPERTIES_BEGIN));
+                    for (i = 0; i < count; i++)
                     {
-                        /*result has the intended content*/
-                        /*Codes_SRS_TRANSPORTMULTITHTTP_17_062: [The message size is computed from the length of the payload + 384.] */
-                        *messageSizeContribution = strlen(source) + MAXIMUM_PAYLOAD_OVERHEAD + propertiesSize;
+                        destination = (i == 0) ?
+                            writeText(destination, EVENT_JSON_FIRST_PROPERTY_NAME_BEGIN, CONST_STRLEN(EVENT_JSON_FIRST_PROPERTY_NAME_BEGIN)) :
+                            writeText(destination, EVENT_JSON_PROPERTY_NAME_BEGIN, CONST_STRLEN(EVENT_JSON_PROPERTY_NAME_BEGIN));
+                        destination = writeText(destination, keys[i], strlen(keys[i]));
+                        destination = writeText(destination, EVENT_JSON_PROPERTY_NAME_END, CONST_STRLEN(EVENT_JSON_PROPERTY_NAME_END));
+                        destination = writeText(destination, values[i], strlen(values[i]));
+                        destination = writeText(destination, EVENT_JSON_PROPERTY_VALUE_END, CONST_STRLEN(EVENT_JSON_PROPERTY_VALUE_END));
                     }
-                    STRING_delete(asJson);
+                    destination = writeText(destination, EVENT_JSON_PROPERTIES_END, CONST_STRLEN(EVENT_JSON_PROPERTIES_END));
                 }
+
+                (void)writeText(destination, EVENT_JSON_END, CONST_STRLEN(EVENT_JSON_END));
+                payload->length += itemLength;
             }
         }
-        break;
-    }
-    default:
-    {
-        LogError("an unknown message type was encountered (%d)", contentType);
-        result = NULL; /*unknown message type*/
-        break;
-    }
     }
     return result;
 }
@@ -1186,121 +1264,84 @@ static STRING_HANDLE make1EventJSONitem(PDLIST_ENTRY item, size_t *messageSizeCo
 DEFINE_ENUM(MAKE_PAYLOAD_RESULT, MAKE_PAYLOAD_RESULT_VALUES);
 
 /*this function assembles several {"body":"base64 encoding of the message content"," base64Encoded": true} into 1 payload*/
+/*the payload buffer belongs to the device and is reused from one batch to the next, only its length is reset*/
 /*Codes_SRS_TRANSPORTMULTITHTTP_17_056: [IoTHubTransportHttp_DoWork shall build the following string:[{"body":"base64 encoding of the message1 content"},{"body":"base64 encoding of the message2 content"}...]]*/
-static MAKE_PAYLOAD_RESULT makePayload(HTTPTRANSPORT_PERDEVICE_DATA* deviceData, STRING_HANDLE* payload)
+static MAKE_PAYLOAD_RESULT makePayload(HTTPTRANSPORT_PERDEVICE_DATA* deviceData)
 {
     MAKE_PAYLOAD_RESULT result;
+    PAYLOAD_BUFFER* payload = &(deviceData->eventPayload);
     size_t allMessagesSize = 0;
-    *payload = STRING_construct("[");
-    if (*payload == NULL)
-    {
-        LogError("unable to STRING_construct");
-        result = MAKE_PAYLOAD_ERROR;
-    }
-    else
-    {
-        bool isFirst = true;
-        PDLIST_ENTRY actual;
-        bool keepGoing = true; /*keepGoing gets sometimes to false from within the loop*/
-                               /*either all the items enter the list or only some*/
-        result = MAKE_PAYLOAD_OK; /*optimistically initializing it*/
-        while (keepGoing && ((actual = deviceData->waitingToSend->Flink) != deviceData->waitingToSend))
+    bool isFirst = true;
+    PDLIST_ENTRY actual;
+    bool keepGoing = true; /*keepGoing gets sometimes to false from within the loop*/
+                           /*either all the items enter the list or only some*/
+    payload->length = 1; /*room for the opening '[', written once the payload has some content*/
+    result = MAKE_PAYLOAD_OK; /*optimistically initializing it*/
+    while (keepGoing && ((actual = deviceData->waitingToSend->Flink) != deviceData->waitingToSend))
+    {
+        size_t messageSize;
+        switch (append1EventJSONitem(payload, actual, allMessagesSize, &messageSize))
+        {
+        case APPEND_EVENT_OK:
+        {
+            /*the item was put nicely in the payload*/
+            PDLIST_ENTRY head = DList_RemoveHeadList(deviceData->waitingToSend); /*actually this is the same as "actual", but now it is removed*/
+            DList_InsertTailList(&(deviceData->eventConfirmations), head);
+            allMessagesSize += messageSize;
+            isFirst = false;
+            break;
+        }
+        case APPEND_EVENT_DOES_NOT_FIT:
         {
-            size_t messageSize;
-            STRING_HANDLE temp = make1EventJSONitem(actual, &messageSize);
             if (isFirst)
             {
-                isFirst = false;
-                /*Codes_SRS_TRANSPORTMULTITHTTP_17_067: [If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity.]*/
-                if (temp == NULL) /*first item failed to create, nothing to send*/
-                {
-                    result = MAKE_PAYLOAD_ERROR;
-                    STRING_delete(*payload);
-                    *payload = NULL;
-                    keepGoing = false;
-                }
-                else
-                {
-                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_065: [If the oldest message in waitingToSend causes the message size to exceed the message size limit then it shall be removed from waitingToSend, and IoTHubClient_LL_SendComplete shall be called. Parameter PDLIST_ENTRY completed shall point to a list containing only the oldest item, and parameter IOTHUB_CLIENT_CONFIRMATION_RESULT result shall be set to IOTHUB_CLIENT_CONFIRMATION_BATCHSTATE_FAILED.]*/
-                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_061: [The message size shall be limited to 255KB - 1 byte.]*/
-                    if (messageSize > MAXIMUM_MESSAGE_SIZE)
-                    {
-                        PDLIST_ENTRY head = DList_RemoveHeadList(deviceData->waitingToSend); /*actually this is the same as "actual", but now it is removed*/
-                        DList_InsertTailList(&(deviceData->eventConfirmations), head);
-                        result = MAKE_PAYLOAD_FIRST_ITEM_DOES_NOT_FIT;
-                        STRING_delete(*payload);
-                        *payload = NULL;
-                        keepGoing = false;
-                    }
-                    else
-                    {
-                        if (STRING_concat_with_STRING(*payload, temp) != 0)
-                        {
-                            /*Codes_SRS_TRANSPORTMULTITHTTP_17_067: [If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity.]*/
-                            result = MAKE_PAYLOAD_ERROR;
-                            STRING_delete(*payload);
-                            *payload = NULL;
-                            keepGoing = false;
-                        }
-                        else
-                        {
-                            /*first item was put nicely in the payload*/
-                            PDLIST_ENTRY head = DList_RemoveHeadList(deviceData->waitingToSend); /*actually this is the same as "actual", but now it is removed*/
-                            DList_InsertTailList(&(deviceData->eventConfirmations), head);
-                            allMessagesSize += messageSize;
-                        }
-                    }
-                    STRING_delete(temp);
-                }
+                /*Codes_SRS_TRANSPORTMULTITHTTP_17_065: [If the oldest message in waitingToSend causes the message size to exceed the message size limit then it shall be removed from waitingToSend, and IoTHubClient_LL_SendComplete shall be called. Parameter PDLIST_ENTRY completed shall point to a list containing only the oldest item, and parameter IOTHUB_CLIENT_CONFIRMATION_RESULT result shall be set to IOTHUB_CLIENT_CONFIRMATION_BATCHSTATE_FAILED.]*/
+                PDLIST_ENTRY head = DList_RemoveHeadList(deviceData->waitingToSend); /*actually this is the same as "actual", but now it is removed*/
+                DList_InsertTailList(&(deviceData->eventConfirmations), head);
+                result = MAKE_PAYLOAD_FIRST_ITEM_DOES_NOT_FIT;
             }
             else
             {
-                /*there is at least 1 item already in the payload*/
-                if (temp == NULL)
-                {
-                    /*there are multiple payloads encoded, the last one had an internal error, just go with those - closing the payload happens "after the loop"*/
-                    /*Codes_SRS_TRANSPORTMULTITHTTP_17_066: [If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload.]*/
-                    result = MAKE_PAYLOAD_OK;
-                    keepGoing = false;
-                }
-                else
-                {
-                    if (allMessagesSize + messageSize > MAXIMUM_MESSAGE_SIZE)
-                    {
-                        /*this item doesn't make it to the payload, but the payload is valid so far*/
-                        /*Codes_SRS_TRANSPORTMULTITHTTP_17_066: [If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload.]*/
-                        result = MAKE_PAYLOAD_OK;
-                        keepGoing = false;
-                    }
-                    else if (STRING_concat_with_STRING(*payload, temp) != 0)
-                    {
-                        /*should still send what there is so far...*/
-                        /*Codes_SRS_TRANSPORTMULTITHTTP_17_066: [If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload.]*/
-                        result = MAKE_PAYLOAD_OK;
-                        keepGoing = false;
-                    }
-                    else
-                    {
-                        /*cool, the payload made it there, let's continue... */
-                        PDLIST_ENTRY head = DList_RemoveHeadList(deviceData->waitingToSend); /*actually this is the same as "actual", but now it is removed*/
-                        DList_InsertTailList(&(deviceData->eventConfirmations), head);
-                        allMessagesSize += messageSize;
-                    }
-                    STRING_delete(temp);
-                }
+                /*this item doesn't make it to the payload, but the payload is valid so far*/
+                /*Codes_SRS_TRANSPORTMULTITHTTP_17_066: [If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload.]*/
+                result = MAKE_PAYLOAD_OK;
             }
+            keepGoing = false;
+            break;
         }
-
-        /*closing the payload*/
-        if (result == MAKE_PAYLOAD_OK)
+        default:
         {
-            ((char*)STRING_c_str(*payload))[STRING_length(*payload) - 1] = ']'; /*TODO - do this in STRING_HANDLE*/
+            if (isFirst)
+            {
+                /*Codes_SRS_TRANSPORTMULTITHTTP_17_067: [If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity.]*/
+                result = MAKE_PAYLOAD_ERROR;
+            }
+            else
+            {
+                /*there are multiple payloads encoded, the last one had an internal error, just go with those - closing the payload happens "after the loop"*/
+                /*Codes_SRS_TRANSPORTMULTITHTTP_17_066: [If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload.]*/
+                result = MAKE_PAYLOAD_OK;
+            }
+            keepGoing = false;
+            break;
         }
-        else
-        {
-            /*no need to close anything*/
         }
     }
+
+    if ((result == MAKE_PAYLOAD_OK) && isFirst)
+    {
+        result = MAKE_PAYLOAD_NO_ITEMS;
+    }
+    else if (result == MAKE_PAYLOAD_OK)
+    {
+        /*opening and closing the payload, the last "," is replaced by ']'*/
+        payload->content[0] = '[';
+        payload->content[payload->length - 1] = ']';
+    }
+    else
+    {
+        /*no need to close anything*/
+    }
     return result;
 }
 
@@ -1333,8 +1374,7 @@ static void DoEvent(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVI
             else
             {
                 /*Codes_SRS_TRANSPORTMULTITHTTP_17_059: [It shall inspect the "waitingToSend" DLIST passed in config structure.] */
-                STRING_HANDLE payload;
-                switch (makePayload(deviceData, &payload))
+                switch (makePayload(deviceData))
                 {
                 case MAKE_PAYLOAD_OK:
                 {
@@ -1348,7 +1388,7 @@ static void DoEvent(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVI
                     }
                     else
                     {
-                        if (BUFFER_build(temp, (const unsigned char*)STRING_c_str(payload), STRING_length(payload)) != 0)
+                        if (BUFFER_build(temp, deviceData->eventPayload.content, deviceData->eventPayload.length) != 0)
                         {
                             LogError("unable to BUFFER_build");
                             //items go back to waitingToSend
@@ -1393,7 +1433,6 @@ static void DoEvent(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVI
                         }
                         BUFFER_delete(temp);
                     }
-                    STRING_delete(payload);
                     break;
                 }
                 case MAKE_PAYLOAD_FIRST_ITEM_DOES_NOT_FIT:
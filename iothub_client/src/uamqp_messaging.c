@@ -1,6 +1,9 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 #include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include <string.h>
+#include <stdbool.h>
 #include "uamqp_messaging.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_uamqp_c/message.h"
@@ -102,7 +105,52 @@ static int addPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_message_hand
 	return result;
 }
 
-static int addApplicationPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_message_handle, MESSAGE_HANDLE uamqp_message)
+static bool isApplicationPropertiesCacheHit(const UAMQP_APPLICATION_PROPERTIES_CACHE* cache, const char* const* propertyKeys, const char* const* propertyValues, size_t propertyCount)
+{
+	bool result;
+	const char* const* cachedKeys;
+	const char* const* cachedValues;
+	size_t cachedCount;
+
+	if (cache->properties == NULL ||
+		Map_GetInternals(cache->properties, &cachedKeys, &cachedValues, &cachedCount) != MAP_OK ||
+		cachedCount != propertyCount)
+	{
+		result = false;
+	}
+	else
+	{
+		size_t i;
+
+		result = true;
+		for (i = 0; result && i < propertyCount; i++)
+		{
+			result = (strcmp(propertyKeys[i], cachedKeys[i]) == 0) && (strcmp(propertyValues[i], cachedValues[i]) == 0);
+		}
+	}
+
+	return result;
+}
+
+static void updateApplicationPropertiesCache(UAMQP_APPLICATION_PROPERTIES_CACHE* cache, MAP_HANDLE properties_map, AMQP_VALUE uamqp_map)
+{
+	message_clear_application_properties_cache(cache);
+
+	// Codes_SRS_UAMQP_MESSAGING_41_014: [On a cache miss the properties map shall be copied with Map_Clone() and the uAMQP map kept with amqpvalue_clone(), replacing what the cache held.]
+	if ((cache->properties = Map_Clone(properties_map)) == NULL)
+	{
+		// Codes_SRS_UAMQP_MESSAGING_41_015: [If the cache cannot be updated, it shall be left empty and the message shall still be created.]
+		LogError("Failed copying the application properties into the cache.");
+	}
+	else if ((cache->uamqp_map = amqpvalue_clone(uamqp_map)) == NULL)
+	{
+		LogError("Failed keeping the uAMQP application properties map in the cache.");
+		Map_Destroy(cache->properties);
+		cache->properties = NULL;
+	}
+}
+
+static int addApplicationPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_message_handle, UAMQP_APPLICATION_PROPERTIES_CACHE* cache, MESSAGE_HANDLE uamqp_message)
 {
 	int result = RESULT_OK;
 	MAP_HANDLE properties_map;
@@ -126,8 +174,17 @@ static int addApplicationPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_m
 	}
 	else
 	{
+		// Codes_SRS_UAMQP_MESSAGING_41_013: [If a cache is given and it holds the same properties (same keys and values, in the same order), its uAMQP map shall be set on the uAMQP message with message_set_application_properties() instead of building a new one.]
+		if (propertyCount != 0 && cache != NULL && isApplicationPropertiesCacheHit(cache, propertyKeys, propertyValues, propertyCount))
+		{
+			if (message_set_application_properties(uamqp_message, cache->uamqp_map) != 0)
+			{
+				LogError("Failed transferring the cached message properties to the uAMQP message.");
+				result = __LINE__;
+			}
+		}
 		// Codes_SRS_UAMQP_MESSAGING_09_085: [If the number of properties is greater than 0, message_create_from_iothub_message() shall iterate through all the properties and add them to the uAMQP message.]
-		if (propertyCount != 0)
+		else if (propertyCount != 0)
 		{
 			size_t i;
 			AMQP_VALUE uamqp_map;
@@ -187,6 +244,10 @@ static int addApplicationPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_m
 					}
 					else
 					{
+						if (cache != NULL)
+						{
+							updateApplicationPropertiesCache(cache, properties_map, uamqp_map);
+						}
 						result = RESULT_OK;
 					}
 				}
@@ -450,7 +511,7 @@ int IoTHubMessage_CreateFromUamqpMessage(MESSAGE_HANDLE uamqp_message, IOTHUB_ME
 	return result;
 }
 
-int message_create_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, MESSAGE_HANDLE* uamqp_message)
+static int createuAMQPMessageFromIoTHubMessage(IOTHUB_MESSAGE_HANDLE iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE* cache, MESSAGE_HANDLE* uamqp_message)
 {
 	int result = __LINE__;
 	// Codes_SRS_UAMQP_MESSAGING_09_047: [The content type of the IOTHUB_MESSAGE_HANDLE instance shall be obtained using IoTHubMessage_GetContentType().]
@@ -513,7 +574,7 @@ int message_create_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, MES
 			LogError("Failed setting properties of the uAMQP message.");
 			result = __LINE__;
 		}
-		else if (addApplicationPropertiesTouAMQPMessage(iothub_message, uamqp_message_tmp) != RESULT_OK)
+		else if (addApplicationPropertiesTouAMQPMessage(iothub_message, cache, uamqp_message_tmp) != RESULT_OK)
 		{
 			LogError("Failed setting application properties of the uAMQP message.");
 			result = __LINE__;
@@ -534,3 +595,197 @@ int message_create_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, MES
 
 	return result;
 }
+
+int message_create_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, MESSAGE_HANDLE* uamqp_message)
+{
+	return createuAMQPMessageFromIoTHubMessage(iothub_message, NULL, uamqp_message);
+}
+
+int message_create_from_iothub_message_with_cache(IOTHUB_MESSAGE_HANDLE iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE* cache, MESSAGE_HANDLE* uamqp_message)
+{
+	int result;
+
+	// Codes_SRS_UAMQP_MESSAGING_41_010: [If cache is NULL, message_create_from_iothub_message_with_cache() shall fail and return a non-zero value.]
+	if (cache == NULL)
+	{
+		LogError("Invalid argument (cache is NULL).");
+		result = __LINE__;
+	}
+	else
+	{
+		// Codes_SRS_UAMQP_MESSAGING_41_011: [message_create_from_iothub_message_with_cache() shall create the uAMQP message as message_create_from_iothub_message() does, except for the application properties.]
+		result = createuAMQPMessageFromIoTHubMessage(iothub_message, cache, uamqp_message);
+	}
+
+	return result;
+}
+
+void message_clear_application_properties_cache(UAMQP_APPLICATION_PROPERTIES_CACHE* cache)
+{
+	if (cache != NULL)
+	{
+		// Codes_SRS_UAMQP_MESSAGING_41_012: [message_clear_application_properties_cache() shall destroy the cached properties with Map_Destroy() and the cached uAMQP map with amqpvalue_destroy(), if any, and leave the cache empty.]
+		if (cache->properties != NULL)
+		{
+			Map_Destroy(cache->properties);
+			cache->properties = NULL;
+		}
+
+		if (cache->uamqp_map != NULL)
+		{
+			amqpvalue_destroy(cache->uamqp_map);
+			cache->uamqp_map = NULL;
+		}
+	}
+}
+
+static int encode_into_buffer(void* context, const unsigned char* bytes, size_t length)
+{
+	unsigned char** position = (unsigned char**)context;
+	(void)memcpy(*position, bytes, length);
+	*position += length;
+	return RESULT_OK;
+}
+
+int message_create_uamqp_encoding_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE* cache, BINARY_DATA* body_binary_data)
+{
+	int result;
+	MESSAGE_HANDLE uamqp_message = NULL;
+	PROPERTIES_HANDLE uamqp_message_properties = NULL;
+	AMQP_VALUE uamqp_application_properties = NULL;
+	// properties, application-properties and data, in the order AMQP requires for the sections of a message.
+	AMQP_VALUE sections[3];
+	size_t section_count = 0;
+	BINARY_DATA message_body;
+
+	// Codes_SRS_UAMQP_MESSAGING_41_001: [If iothub_message or body_binary_data are NULL, message_create_uamqp_encoding_from_iothub_message() shall fail and return a non-zero value.]
+	if (iothub_message == NULL || body_binary_data == NULL)
+	{
+		LogError("Invalid argument (iothub_message=%p, body_binary_data=%p).", iothub_message, body_binary_data);
+		result = __LINE__;
+	}
+	// Codes_SRS_UAMQP_MESSAGING_41_002: [The sections shall be obtained from a uAMQP message created with message_create_from_iothub_message(), so a batched event carries the same properties as an event sent alone.]
+	// Codes_SRS_UAMQP_MESSAGING_41_016: [If cache is not NULL, the application properties shall be taken from it as message_create_from_iothub_message_with_cache() does.]
+	else if (createuAMQPMessageFromIoTHubMessage(iothub_message, cache, &uamqp_message) != RESULT_OK)
+	{
+		// Codes_SRS_UAMQP_MESSAGING_41_003: [If any uAMQP function fails, message_create_uamqp_encoding_from_iothub_message() shall free everything it allocated and return a non-zero value.]
+		LogError("Failed creating the uAMQP message to encode.");
+		result = __LINE__;
+	}
+	// Codes_SRS_UAMQP_MESSAGING_41_004: [The properties of the uAMQP message, if any, shall be turned into a properties section using message_get_properties() and amqpvalue_create_properties().]
+	else if (message_get_properties(uamqp_message, &uamqp_message_properties) != 0 ||
+		(uamqp_message_properties != NULL && (sections[section_count++] = amqpvalue_create_properties(uamqp_message_properties)) == NULL))
+	{
+		LogError("Failed encoding the properties of the uAMQP message.");
+		result = __LINE__;
+	}
+	// Codes_SRS_UAMQP_MESSAGING_41_005: [The application properties of the uAMQP message, if any, shall be turned into an application-properties section using message_get_application_properties() and amqpvalue_create_application_properties().]
+	else if (message_get_application_properties(uamqp_message, &uamqp_application_properties) != 0 ||
+		(uamqp_application_properties != NULL && (sections[section_count++] = amqpvalue_create_application_properties(uamqp_application_properties)) == NULL))
+	{
+		LogError("Failed encoding the application properties of the uAMQP message.");
+		result = __LINE__;
+	}
+	// Codes_SRS_UAMQP_MESSAGING_41_006: [The body of the uAMQP message shall be turned into a data section using message_get_body_amqp_data() and amqpvalue_create_data().]
+	else if (message_get_body_amqp_data(uamqp_message, 0, &message_body) != 0)
+	{
+		LogError("Failed getting the body of the uAMQP message.");
+		result = __LINE__;
+	}
+	else
+	{
+		data body_data;
+		body_data.bytes = message_body.bytes;
+		body_data.length = (uint32_t)message_body.length;
+
+		if ((sections[section_count++] = amqpvalue_create_data(body_data)) == NULL)
+		{
+			LogError("Failed encoding the body of the uAMQP message.");
+			result = __LINE__;
+		}
+		else
+		{
+			size_t total_size = 0;
+			size_t i;
+
+			result = RESULT_OK;
+
+			// Codes_SRS_UAMQP_MESSAGING_41_007: [The size of the encoding shall be the sum of the sizes of the sections given by amqpvalue_get_encoded_size().]
+			for (i = 0; i < section_count && result == RESULT_OK; i++)
+			{
+				size_t section_size;
+				if (amqpvalue_get_encoded_size(sections[i], &section_size) != 0)
+				{
+					LogError("Failed getting the encoded size of section %zu.", i);
+					result = __LINE__;
+				}
+				else
+				{
+					total_size += section_size;
+				}
+			}
+
+			if (result == RESULT_OK)
+			{
+				unsigned char* encoding;
+
+				// Codes_SRS_UAMQP_MESSAGING_41_008: [The sections shall be encoded one after the other with amqpvalue_encode() into a buffer allocated with malloc(), which the caller owns.]
+				if ((encoding = (unsigned char*)malloc(total_size)) == NULL)
+				{
+					LogError("Failed allocating %zu bytes for the encoded message.", total_size);
+					result = __LINE__;
+				}
+				else
+				{
+					unsigned char* position = encoding;
+
+					for (i = 0; i < section_count && result == RESULT_OK; i++)
+					{
+						if (amqpvalue_encode(sections[i], encode_into_buffer, &position) != 0)
+						{
+							LogError("Failed encoding section %zu.", i);
+							result = __LINE__;
+						}
+					}
+
+					if (result != RESULT_OK)
+					{
+						free(encoding);
+					}
+					else
+					{
+						// Codes_SRS_UAMQP_MESSAGING_41_009: [On success message_create_uamqp_encoding_from_iothub_message() shall set body_binary_data to the buffer and its size and return 0.]
+						body_binary_data->bytes = encoding;
+						body_binary_data->length = total_size;
+					}
+				}
+			}
+		}
+	}
+
+	while (section_count > 0)
+	{
+		section_count--;
+		if (sections[section_count] != NULL)
+		{
+			amqpvalue_destroy(sections[section_count]);
+		}
+	}
+
+	if (uamqp_application_properties != NULL)
+	{
+		amqpvalue_destroy(uamqp_application_properties);
+	}
+
+	if (uamqp_message_properties != NULL)
+	{
+		properties_destroy(uamqp_message_properties);
+	}
+
+	if (uamqp_message != NULL)
+	{
+		message_destroy(uamqp_message);
+	}
+
+	return result;
+}
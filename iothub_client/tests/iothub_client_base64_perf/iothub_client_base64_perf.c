@@ -0,0 +1,309 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*micro-benchmark of IoTHubClient_Base64 against the implementations it replaced:
+  - c-utility's Base64_Encode_Bytes/Base64_Decoder (used by the HTTP transport and the blob upload)
+  - the character at a time codec that used to live in serializer/src/agenttypesystem.c (copied below as it was)*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "azure_c_shared_utility/base64.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/strings.h"
+#include "iothub_client_base64.h"
+
+/*a multiple of 3, so that no codec pads*/
+#define DATA_SIZE (3 * 1024 * 1024)
+#define MINIMUM_SECONDS 1.0
+
+/*the serializer codec (URL alphabet, 'A' is 0), as it was*/
+static char base64char(unsigned char val)
+{
+    char result;
+
+    if (val < 26)
+    {
+        result = 'A' + (char)val;
+    }
+    else if (val < 52)
+    {
+        result = 'a' + ((char)val - 26);
+    }
+    else if (val < 62)
+    {
+        result = '0' + ((char)val - 52);
+    }
+    else if (val == 62)
+    {
+        result = '-';
+    }
+    else
+    {
+        result = '_';
+    }
+
+    return result;
+}
+
+static int base64toValue(char base64charSource, unsigned char* value)
+{
+    int result;
+    if (('A' <= base64charSource) && (base64charSource <= 'Z'))
+    {
+        *value = base64charSource - 'A';
+        result = 0;
+    }
+    else if (('a' <= base64charSource) && (base64charSource <= 'z'))
+    {
+        *value = ('Z' - 'A') + 1 + (base64charSource - 'a');
+        result = 0;
+    }
+    else if (('0' <= base64charSource) && (base64charSource <= '9'))
+    {
+        *value = ('Z' - 'A') + 1 + ('z' - 'a') + 1 + (base64charSource - '0');
+        result = 0;
+    }
+    else if ('-' == base64charSource)
+    {
+        *value = 62;
+        result = 0;
+    }
+    else if ('_' == base64charSource)
+    {
+        *value = 63;
+        result = 0;
+    }
+    else
+    {
+        result = 1;
+    }
+    return result;
+}
+
+static int scan4base64char(const char* source, size_t sourceSize, unsigned char *destination0, unsigned char* destination1, unsigned char* destination2)
+{
+    int result;
+    if (sourceSize < 4)
+    {
+        result = 1;
+    }
+    else
+    {
+        unsigned char b0, b1, b2, b3;
+        if (
+            (base64toValue(source[0], &b0) == 0) &&
+            (base64toValue(source[1], &b1) == 0) &&
+            (base64toValue(source[2], &b2) == 0) &&
+            (base64toValue(source[3], &b3) == 0)
+            )
+        {
+            *destination0 = (b0 << 2) | ((b1 & 0x30) >> 4);
+            *destination1 = ((b1 & 0x0F) << 4) | ((b2 & 0x3C) >> 2);
+            *destination2 = ((b2 & 0x03) << 6) | (b3);
+            result = 0;
+        }
+        else
+        {
+            result = 2;
+        }
+    }
+    return result;
+}
+
+static void serializer_encode(char* destination, const unsigned char* source, size_t size)
+{
+    size_t currentPosition = 0;
+    while (size - currentPosition >= 3)
+    {
+        *destination++ = base64char(source[currentPosition] >> 2);
+        *destination++ = base64char(((source[currentPosition] & 3) << 4) | (source[currentPosition + 1] >> 4));
+        *destination++ = base64char(((source[currentPosition + 1] & 0x0F) << 2) | ((source[currentPosition + 2] >> 6) & 3));
+        *destination++ = base64char(source[currentPosition + 2] & 0x3F);
+        currentPosition += 3;
+    }
+}
+
+static int serializer_decode(unsigned char* destination, const char* source, size_t length)
+{
+    int result = 0;
+    size_t i;
+    for (i = 0; i < length; i += 4)
+    {
+        if (scan4base64char(source + i, length - i, destination, destination + 1, destination + 2) != 0)
+        {
+            result = __LINE__;
+            break;
+        }
+        destination += 3;
+    }
+    return result;
+}
+
+/*every benchmarked operation runs one round on (data, encoded, decoded) and returns 0 when it produced the expected output*/
+typedef struct BENCHMARK_DATA_TAG
+{
+    unsigned char* data;
+    char* standard;
+    char* url;
+    char* encoded;
+    unsigned char* decoded;
+} BENCHMARK_DATA;
+
+typedef int(*BENCHMARK_ROUND)(BENCHMARK_DATA* benchmarkData);
+
+static int round_c_utility_encode(BENCHMARK_DATA* benchmarkData)
+{
+    int result;
+    STRING_HANDLE encoded = Base64_Encode_Bytes(benchmarkData->data, DATA_SIZE);
+    if (encoded == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = (memcmp(STRING_c_str(encoded), benchmarkData->standard, DATA_SIZE / 3 * 4) == 0) ? 0 : __LINE__;
+        STRING_delete(encoded);
+    }
+    return result;
+}
+
+static int round_c_utility_decode(BENCHMARK_DATA* benchmarkData)
+{
+    int result;
+    BUFFER_HANDLE decoded = Base64_Decoder(benchmarkData->standard);
+    if (decoded == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = ((BUFFER_length(decoded) == DATA_SIZE) && (memcmp(BUFFER_u_char(decoded), benchmarkData->data, DATA_SIZE) == 0)) ? 0 : __LINE__;
+        BUFFER_delete(decoded);
+    }
+    return result;
+}
+
+static int round_serializer_encode(BENCHMARK_DATA* benchmarkData)
+{
+    serializer_encode(benchmarkData->encoded, benchmarkData->data, DATA_SIZE);
+    return (memcmp(benchmarkData->encoded, benchmarkData->url, DATA_SIZE / 3 * 4) == 0) ? 0 : __LINE__;
+}
+
+static int round_serializer_decode(BENCHMARK_DATA* benchmarkData)
+{
+    return ((serializer_decode(benchmarkData->decoded, benchmarkData->url, DATA_SIZE / 3 * 4) == 0) &&
+        (memcmp(benchmarkData->decoded, benchmarkData->data, DATA_SIZE) == 0)) ? 0 : __LINE__;
+}
+
+static int round_iothub_client_encode_standard(BENCHMARK_DATA* benchmarkData)
+{
+    return ((IoTHubClient_Base64_Encode(benchmarkData->encoded, benchmarkData->data, DATA_SIZE, BASE64_ALPHABET_STANDARD) == 0) &&
+        (memcmp(benchmarkData->encoded, benchmarkData->standard, DATA_SIZE / 3 * 4) == 0)) ? 0 : __LINE__;
+}
+
+static int round_iothub_client_decode_standard(BENCHMARK_DATA* benchmarkData)
+{
+    size_t decodedSize;
+    return ((IoTHubClient_Base64_Decode(benchmarkData->decoded, benchmarkData->standard, DATA_SIZE / 3 * 4, BASE64_ALPHABET_STANDARD, &decodedSize) == 0) &&
+        (decodedSize == DATA_SIZE) &&
+        (memcmp(benchmarkData->decoded, benchmarkData->data, DATA_SIZE) == 0)) ? 0 : __LINE__;
+}
+
+static int round_iothub_client_encode_url(BENCHMARK_DATA* benchmarkData)
+{
+    return ((IoTHubClient_Base64_Encode(benchmarkData->encoded, benchmarkData->data, DATA_SIZE, BASE64_ALPHABET_URL) == 0) &&
+        (memcmp(benchmarkData->encoded, benchmarkData->url, DATA_SIZE / 3 * 4) == 0)) ? 0 : __LINE__;
+}
+
+static int round_iothub_client_decode_url(BENCHMARK_DATA* benchmarkData)
+{
+    size_t decodedSize;
+    return ((IoTHubClient_Base64_Decode(benchmarkData->decoded, benchmarkData->url, DATA_SIZE / 3 * 4, BASE64_ALPHABET_URL, &decodedSize) == 0) &&
+        (decodedSize == DATA_SIZE) &&
+        (memcmp(benchmarkData->decoded, benchmarkData->data, DATA_SIZE) == 0)) ? 0 : __LINE__;
+}
+
+/*runs rounds for at least MINIMUM_SECONDS and prints the throughput in MB of binary data per second*/
+static int run_benchmark(const char* name, BENCHMARK_ROUND benchmarkRound, BENCHMARK_DATA* benchmarkData)
+{
+    int result = 0;
+    size_t rounds = 0;
+    double seconds;
+    clock_t start = clock();
+    do
+    {
+        if (benchmarkRound(benchmarkData) != 0)
+        {
+            result = __LINE__;
+            break;
+        }
+        rounds++;
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    } while (seconds < MINIMUM_SECONDS);
+
+    if (result != 0)
+    {
+        (void)printf("%-40s wrong output\r\n", name);
+    }
+    else
+    {
+        (void)printf("%-40s %10.1f MB/s\r\n", name, (double)rounds * DATA_SIZE / (1024 * 1024) / seconds);
+    }
+    return result;
+}
+
+int main(void)
+{
+    int result = 0;
+    BENCHMARK_DATA benchmarkData;
+    size_t i;
+
+    benchmarkData.data = (unsigned char*)malloc(DATA_SIZE);
+    benchmarkData.standard = (char*)malloc(DATA_SIZE / 3 * 4 + 1);
+    benchmarkData.url = (char*)malloc(DATA_SIZE / 3 * 4 + 1);
+    benchmarkData.encoded = (char*)malloc(DATA_SIZE / 3 * 4 + 1);
+    benchmarkData.decoded = (unsigned char*)malloc(DATA_SIZE);
+    if ((benchmarkData.data == NULL) || (benchmarkData.standard == NULL) || (benchmarkData.url == NULL) || (benchmarkData.encoded == NULL) || (benchmarkData.decoded == NULL))
+    {
+        (void)printf("failed to allocate the benchmark data\r\n");
+        result = __LINE__;
+    }
+    else
+    {
+        srand(42);
+        for (i = 0; i < DATA_SIZE; i++)
+        {
+            benchmarkData.data[i] = (unsigned char)rand();
+        }
+
+        /*the reference outputs come from the serializer codec, the standard alphabet only differs in characters 62 and 63*/
+        serializer_encode(benchmarkData.url, benchmarkData.data, DATA_SIZE);
+        benchmarkData.url[DATA_SIZE / 3 * 4] = '\0';
+        for (i = 0; i <= DATA_SIZE / 3 * 4; i++)
+        {
+            benchmarkData.standard[i] = (benchmarkData.url[i] == '-') ? '+' : (benchmarkData.url[i] == '_') ? '/' : benchmarkData.url[i];
+        }
+
+        (void)printf("encoding and decoding %d bytes\r\n", DATA_SIZE);
+        if ((run_benchmark("c-utility Base64_Encode_Bytes", round_c_utility_encode, &benchmarkData) != 0) ||
+            (run_benchmark("serializer base64char", round_serializer_encode, &benchmarkData) != 0) ||
+            (run_benchmark("IoTHubClient_Base64_Encode standard", round_iothub_client_encode_standard, &benchmarkData) != 0) ||
+            (run_benchmark("IoTHubClient_Base64_Encode URL", round_iothub_client_encode_url, &benchmarkData) != 0) ||
+            (run_benchmark("c-utility Base64_Decoder", round_c_utility_decode, &benchmarkData) != 0) ||
+            (run_benchmark("serializer scan4base64char", round_serializer_decode, &benchmarkData) != 0) ||
+            (run_benchmark("IoTHubClient_Base64_Decode standard", round_iothub_client_decode_standard, &benchmarkData) != 0) ||
+            (run_benchmark("IoTHubClient_Base64_Decode URL", round_iothub_client_decode_url, &benchmarkData) != 0))
+        {
+            result = __LINE__;
+        }
+    }
+
+    free(benchmarkData.data);
+    free(benchmarkData.standard);
+    free(benchmarkData.url);
+    free(benchmarkData.encoded);
+    free(benchmarkData.decoded);
+    return result;
+}
@@ -0,0 +1,427 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+
+#include "iothub_client_base64.h"
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/*the 256 byte values 0..255, long enough to go through the vector paths of the encoder and the decoder*/
+#define TEST_ALL_BYTES_SIZE 256
+static const char* TEST_ALL_BYTES_STANDARD =
+    "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+P0BBQkNERUZHSElKS0xNTk9QUVJTVFVWV1hZWltcXV5fYGFiY2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6e3x9fn+AgYKDhIWGh4iJiouMjY6PkJGSk5SVlpeYmZqbnJ2en6ChoqOkpaanqKmqq6ytrq+wsbKztLW2t7i5uru8vb6/wMHCw8TFxsfIycrLzM3Oz9DR0tPU1dbX2Nna29zd3t/g4eLj5OXm5+jp6uvs7e7v8PHy8/T19vf4+fr7/P3+/w==";
+static const char* TEST_ALL_BYTES_URL =
+    "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0-P0BBQkNERUZHSElKS0xNTk9QUVJTVFVWV1hZWltcXV5fYGFiY2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6e3x9fn-AgYKDhIWGh4iJiouMjY6PkJGSk5SVlpeYmZqbnJ2en6ChoqOkpaanqKmqq6ytrq-wsbKztLW2t7i5uru8vb6_wMHCw8TFxsfIycrLzM3Oz9DR0tPU1dbX2Nna29zd3t_g4eLj5OXm5-jp6uvs7e7v8PHy8_T19vf4-fr7_P3-_w==";
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static void fill_all_bytes(unsigned char* buffer)
+{
+    size_t i;
+    for (i = 0; i < TEST_ALL_BYTES_SIZE; i++)
+    {
+        buffer[i] = (unsigned char)i;
+    }
+}
+
+/*encodes source in a buffer one character larger than needed and checks the extra character is left alone*/
+static void assert_encodes_to(const unsigned char* source, size_t size, BASE64_ALPHABET alphabet, const char* expected)
+{
+    size_t expectedLength = strlen(expected);
+    char* destination = (char*)malloc(expectedLength + 1);
+    ASSERT_IS_NOT_NULL(destination);
+    destination[expectedLength] = '#';
+
+    ASSERT_ARE_EQUAL(size_t, expectedLength, IoTHubClient_Base64_GetEncodedLength(size));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_Base64_Encode(destination, source, size, alphabet));
+    ASSERT_IS_TRUE(memcmp(destination, expected, expectedLength) == 0);
+    ASSERT_ARE_EQUAL(char, '#', destination[expectedLength]);
+
+    free(destination);
+}
+
+static void assert_decodes_to(const char* source, BASE64_ALPHABET alphabet, const unsigned char* expected, size_t expectedSize)
+{
+    size_t length = strlen(source);
+    size_t decodedSize = 0;
+    unsigned char* destination = (unsigned char*)malloc(IoTHubClient_Base64_GetDecodedMaxLength(length) + 1);
+    ASSERT_IS_NOT_NULL(destination);
+
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_Base64_Decode(destination, source, length, alphabet, &decodedSize));
+    ASSERT_ARE_EQUAL(size_t, expectedSize, decodedSize);
+    ASSERT_IS_TRUE(memcmp(destination, expected, expectedSize) == 0);
+
+    free(destination);
+}
+
+static void assert_decode_fails(const char* source, BASE64_ALPHABET alphabet)
+{
+    size_t length = strlen(source);
+    size_t decodedSize = 0;
+    unsigned char* destination = (unsigned char*)malloc(IoTHubClient_Base64_GetDecodedMaxLength(length) + 1);
+    ASSERT_IS_NOT_NULL(destination);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_Base64_Decode(destination, source, length, alphabet, &decodedSize));
+
+    free(destination);
+}
+
+BEGIN_TEST_SUITE(iothub_client_base64_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_001: [ IoTHubClient_Base64_GetEncodedLength shall return 4 characters for every started group of 3 bytes. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_GetEncodedLength_rounds_up_to_whole_groups)
+{
+    // arrange
+
+    // act
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubClient_Base64_GetEncodedLength(0));
+    ASSERT_ARE_EQUAL(size_t, 4, IoTHubClient_Base64_GetEncodedLength(1));
+    ASSERT_ARE_EQUAL(size_t, 4, IoTHubClient_Base64_GetEncodedLength(2));
+    ASSERT_ARE_EQUAL(size_t, 4, IoTHubClient_Base64_GetEncodedLength(3));
+    ASSERT_ARE_EQUAL(size_t, 8, IoTHubClient_Base64_GetEncodedLength(4));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_002: [ If destination is NULL, or source is NULL while size is not 0, IoTHubClient_Base64_Encode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_with_NULL_destination_fails)
+{
+    // arrange
+    unsigned char source[] = { 'f' };
+
+    // act
+    int result = IoTHubClient_Base64_Encode(NULL, source, sizeof(source), BASE64_ALPHABET_STANDARD);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_002: [ If destination is NULL, or source is NULL while size is not 0, IoTHubClient_Base64_Encode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_with_NULL_source_and_non_zero_size_fails)
+{
+    // arrange
+    char destination[4];
+
+    // act
+    int result = IoTHubClient_Base64_Encode(destination, NULL, 1, BASE64_ALPHABET_STANDARD);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_003: [ IoTHubClient_Base64_Encode shall write the IoTHubClient_Base64_GetEncodedLength(size) characters of the padded encoding of source at destination, without a terminating '\0'. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_with_NULL_source_and_0_size_writes_nothing)
+{
+    // arrange
+    char destination[1] = { '#' };
+
+    // act
+    int result = IoTHubClient_Base64_Encode(destination, NULL, 0, BASE64_ALPHABET_STANDARD);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char, '#', destination[0]);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_003: [ IoTHubClient_Base64_Encode shall write the IoTHubClient_Base64_GetEncodedLength(size) characters of the padded encoding of source at destination, without a terminating '\0'. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_RFC4648_test_vectors_succeed)
+{
+    // arrange
+    const unsigned char* source = (const unsigned char*)"foobar";
+
+    // act
+    // assert
+    assert_encodes_to(source, 1, BASE64_ALPHABET_STANDARD, "Zg==");
+    assert_encodes_to(source, 2, BASE64_ALPHABET_STANDARD, "Zm8=");
+    assert_encodes_to(source, 3, BASE64_ALPHABET_STANDARD, "Zm9v");
+    assert_encodes_to(source, 4, BASE64_ALPHABET_STANDARD, "Zm9vYg==");
+    assert_encodes_to(source, 5, BASE64_ALPHABET_STANDARD, "Zm9vYmE=");
+    assert_encodes_to(source, 6, BASE64_ALPHABET_STANDARD, "Zm9vYmFy");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_003: [ IoTHubClient_Base64_Encode shall write the IoTHubClient_Base64_GetEncodedLength(size) characters of the padded encoding of source at destination, without a terminating '\0'. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_uses_the_alphabet_characters_for_62_and_63)
+{
+    // arrange
+    unsigned char source[] = { 0xFB, 0xFF, 0xBF };
+
+    // act
+    // assert
+    assert_encodes_to(source, sizeof(source), BASE64_ALPHABET_STANDARD, "+/+/");
+    assert_encodes_to(source, sizeof(source), BASE64_ALPHABET_URL, "-_-_");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_004: [ When the processor offers vector instructions, IoTHubClient_Base64_Encode shall encode the bulk of source with them. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_all_byte_values_succeeds)
+{
+    // arrange
+    unsigned char source[TEST_ALL_BYTES_SIZE];
+    fill_all_bytes(source);
+
+    // act
+    // assert
+    assert_encodes_to(source, sizeof(source), BASE64_ALPHABET_STANDARD, TEST_ALL_BYTES_STANDARD);
+    assert_encodes_to(source, sizeof(source), BASE64_ALPHABET_URL, TEST_ALL_BYTES_URL);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_004: [ When the processor offers vector instructions, IoTHubClient_Base64_Encode shall encode the bulk of source with them. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Encode_every_length_matches_the_encoding_of_all_bytes)
+{
+    // arrange
+    unsigned char source[TEST_ALL_BYTES_SIZE];
+    char destination[((TEST_ALL_BYTES_SIZE + 2) / 3) * 4];
+    size_t size;
+    fill_all_bytes(source);
+
+    // act
+    // assert
+    /*the whole groups of any prefix encode exactly like the start of the full encoding, whichever path encoded them*/
+    for (size = 0; size <= TEST_ALL_BYTES_SIZE; size++)
+    {
+        size_t wholeGroupsLength = (size / 3) * 4;
+        ASSERT_ARE_EQUAL(int, 0, IoTHubClient_Base64_Encode(destination, source, size, BASE64_ALPHABET_STANDARD));
+        ASSERT_IS_TRUE(memcmp(destination, TEST_ALL_BYTES_STANDARD, wholeGroupsLength) == 0);
+    }
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_005: [ IoTHubClient_Base64_GetDecodedMaxLength shall return 3 bytes for every started group of 4 characters. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_GetDecodedMaxLength_rounds_up_to_whole_groups)
+{
+    // arrange
+
+    // act
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubClient_Base64_GetDecodedMaxLength(0));
+    ASSERT_ARE_EQUAL(size_t, 3, IoTHubClient_Base64_GetDecodedMaxLength(2));
+    ASSERT_ARE_EQUAL(size_t, 3, IoTHubClient_Base64_GetDecodedMaxLength(4));
+    ASSERT_ARE_EQUAL(size_t, 6, IoTHubClient_Base64_GetDecodedMaxLength(5));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_006: [ If destination or decodedSize is NULL, or source is NULL while length is not 0, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_NULL_destination_fails)
+{
+    // arrange
+    size_t decodedSize;
+
+    // act
+    int result = IoTHubClient_Base64_Decode(NULL, "Zg==", 4, BASE64_ALPHABET_STANDARD, &decodedSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_006: [ If destination or decodedSize is NULL, or source is NULL while length is not 0, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_NULL_source_and_non_zero_length_fails)
+{
+    // arrange
+    unsigned char destination[3];
+    size_t decodedSize;
+
+    // act
+    int result = IoTHubClient_Base64_Decode(destination, NULL, 4, BASE64_ALPHABET_STANDARD, &decodedSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_006: [ If destination or decodedSize is NULL, or source is NULL while length is not 0, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_NULL_decodedSize_fails)
+{
+    // arrange
+    unsigned char destination[3];
+
+    // act
+    int result = IoTHubClient_Base64_Decode(destination, "Zg==", 4, BASE64_ALPHABET_STANDARD, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_007: [ If source contains a character that is not part of the alphabet (other than the padding of the last group), IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_characters_of_the_other_alphabet_fails)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decode_fails("-_-_", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("+/+/", BASE64_ALPHABET_URL);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_007: [ If source contains a character that is not part of the alphabet (other than the padding of the last group), IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_invalid_characters_fails)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decode_fails("Zm9v Zg==", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Zm=vYg==", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Zm9\xC3", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Z===", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("====", BASE64_ALPHABET_STANDARD);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_008: [ If the bits of the last group that do not make a whole byte are not zero, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_non_zero_unused_bits_fails)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decode_fails("Zh==", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Zm9=", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Zh", BASE64_ALPHABET_STANDARD);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_009: [ If the last group has a single character, IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_single_character_last_group_fails)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decode_fails("Z", BASE64_ALPHABET_STANDARD);
+    assert_decode_fails("Zm9vY", BASE64_ALPHABET_STANDARD);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_010: [ Otherwise IoTHubClient_Base64_Decode shall write the decoded bytes at destination, set decodedSize to their number and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_RFC4648_test_vectors_succeed)
+{
+    // arrange
+    const unsigned char* expected = (const unsigned char*)"foobar";
+
+    // act
+    // assert
+    assert_decodes_to("", BASE64_ALPHABET_STANDARD, expected, 0);
+    assert_decodes_to("Zg==", BASE64_ALPHABET_STANDARD, expected, 1);
+    assert_decodes_to("Zm8=", BASE64_ALPHABET_STANDARD, expected, 2);
+    assert_decodes_to("Zm9v", BASE64_ALPHABET_STANDARD, expected, 3);
+    assert_decodes_to("Zm9vYg==", BASE64_ALPHABET_STANDARD, expected, 4);
+    assert_decodes_to("Zm9vYmE=", BASE64_ALPHABET_STANDARD, expected, 5);
+    assert_decodes_to("Zm9vYmFy", BASE64_ALPHABET_STANDARD, expected, 6);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_010: [ Otherwise IoTHubClient_Base64_Decode shall write the decoded bytes at destination, set decodedSize to their number and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_without_padding_succeeds)
+{
+    // arrange
+    const unsigned char* expected = (const unsigned char*)"foobar";
+
+    // act
+    // assert
+    assert_decodes_to("Zg", BASE64_ALPHABET_STANDARD, expected, 1);
+    assert_decodes_to("Zm8", BASE64_ALPHABET_STANDARD, expected, 2);
+    assert_decodes_to("Zm9vYg", BASE64_ALPHABET_URL, expected, 4);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_010: [ Otherwise IoTHubClient_Base64_Decode shall write the decoded bytes at destination, set decodedSize to their number and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_all_byte_values_succeeds)
+{
+    // arrange
+    unsigned char expected[TEST_ALL_BYTES_SIZE];
+    fill_all_bytes(expected);
+
+    // act
+    // assert
+    assert_decodes_to(TEST_ALL_BYTES_STANDARD, BASE64_ALPHABET_STANDARD, expected, sizeof(expected));
+    assert_decodes_to(TEST_ALL_BYTES_URL, BASE64_ALPHABET_URL, expected, sizeof(expected));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_011: [ When the processor offers vector instructions, IoTHubClient_Base64_Decode shall decode the bulk of source with them. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_every_length_of_the_encoding_of_all_bytes_succeeds)
+{
+    // arrange
+    unsigned char expected[TEST_ALL_BYTES_SIZE];
+    unsigned char destination[TEST_ALL_BYTES_SIZE];
+    size_t groups;
+    fill_all_bytes(expected);
+
+    // act
+    // assert
+    /*any number of whole groups decodes to the start of the bytes, whichever path decoded them*/
+    for (groups = 0; groups <= TEST_ALL_BYTES_SIZE / 3; groups++)
+    {
+        size_t decodedSize;
+        ASSERT_ARE_EQUAL(int, 0, IoTHubClient_Base64_Decode(destination, TEST_ALL_BYTES_STANDARD, groups * 4, BASE64_ALPHABET_STANDARD, &decodedSize));
+        ASSERT_ARE_EQUAL(size_t, groups * 3, decodedSize);
+        ASSERT_IS_TRUE(memcmp(destination, expected, decodedSize) == 0);
+    }
+}
+
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_007: [ If source contains a character that is not part of the alphabet (other than the padding of the last group), IoTHubClient_Base64_Decode shall fail and return a non-zero value. ]*/
+/* Tests_SRS_IOTHUBCLIENT_BASE64_41_011: [ When the processor offers vector instructions, IoTHubClient_Base64_Decode shall decode the bulk of source with them. ]*/
+TEST_FUNCTION(IoTHubClient_Base64_Decode_with_an_invalid_character_at_any_position_fails)
+{
+    // arrange
+    const char invalidCharacters[] = { '*', '-', '_', '=', '@', '[', '`', '{', ' ', (char)0x80, (char)0xFF };
+    char source[((TEST_ALL_BYTES_SIZE + 2) / 3) * 4 + 1];
+    size_t length = strlen(TEST_ALL_BYTES_STANDARD);
+    size_t position;
+    (void)strcpy(source, TEST_ALL_BYTES_STANDARD);
+
+    // act
+    // assert
+    /*the last 4 characters hold the padding*/
+    for (position = 0; position < length - 4; position++)
+    {
+        size_t i;
+        for (i = 0; i < sizeof(invalidCharacters); i++)
+        {
+            source[position] = invalidCharacters[i];
+            assert_decode_fails(source, BASE64_ALPHABET_STANDARD);
+        }
+        source[position] = TEST_ALL_BYTES_STANDARD[position];
+    }
+}
+
+END_TEST_SUITE(iothub_client_base64_ut)
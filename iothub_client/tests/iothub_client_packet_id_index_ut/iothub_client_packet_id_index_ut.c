@@ -0,0 +1,418 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+#include <string.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_packet_id_index.h"
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/*enough entries for every packet id twice*/
+#define TEST_ENTRY_COUNT (2 * 65536)
+static PACKET_ID_INDEX_ENTRY test_entries[TEST_ENTRY_COUNT];
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+/*inserts test_entries[0..count-1] with packet ids 1..count*/
+static void insert_test_entries(PACKET_ID_INDEX* index, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PacketIdIndex_Insert(index, &test_entries[i], (uint16_t)(i + 1)));
+    }
+}
+
+BEGIN_TEST_SUITE(iothub_client_packet_id_index_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_001: [ If index is NULL, IoTHubClient_PacketIdIndex_Init shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Init_with_NULL_index_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_PacketIdIndex_Init(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_002: [ IoTHubClient_PacketIdIndex_Init shall make index empty, using its PACKET_ID_INDEX_INLINE_BUCKETS inline buckets. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Init_makes_an_empty_index_without_allocating)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    memset(&index, 0xAA, sizeof(index));
+
+    // act
+    IoTHubClient_PacketIdIndex_Init(&index);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+    ASSERT_ARE_EQUAL(size_t, PACKET_ID_INDEX_INLINE_BUCKETS, index.bucketCount);
+    ASSERT_IS_TRUE(index.buckets == index.inlineBuckets);
+    ASSERT_IS_NULL(IoTHubClient_PacketIdIndex_Remove(&index, 0xAAAA));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_003: [ If index is NULL, IoTHubClient_PacketIdIndex_Deinit shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Deinit_with_NULL_index_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_PacketIdIndex_Deinit(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_004: [ IoTHubClient_PacketIdIndex_Deinit shall free the bucket array if it was allocated and leave index empty; the entries themselves are not touched. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Deinit_with_inline_buckets_does_not_free)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    insert_test_entries(&index, PACKET_ID_INDEX_INLINE_BUCKETS);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubClient_PacketIdIndex_Deinit(&index);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+    ASSERT_IS_NULL(IoTHubClient_PacketIdIndex_Remove(&index, 1));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_004: [ IoTHubClient_PacketIdIndex_Deinit shall free the bucket array if it was allocated and leave index empty; the entries themselves are not touched. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Deinit_frees_the_allocated_buckets)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    insert_test_entries(&index, PACKET_ID_INDEX_INLINE_BUCKETS + 1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubClient_PacketIdIndex_Deinit(&index);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+    ASSERT_IS_TRUE(index.buckets == index.inlineBuckets);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_005: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_Insert shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_with_NULL_index_fails)
+{
+    // arrange
+    PACKET_ID_INDEX_ENTRY entry;
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_Insert(NULL, &entry, 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_005: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_Insert shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_with_NULL_entry_fails)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_Insert(&index, NULL, 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_006: [ IoTHubClient_PacketIdIndex_Insert shall store packetId in entry, link entry in the bucket selected by the low bits of packetId and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_within_the_inline_buckets_does_not_allocate)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+
+    // act
+    insert_test_entries(&index, PACKET_ID_INDEX_INLINE_BUCKETS);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, PACKET_ID_INDEX_INLINE_BUCKETS, index.count);
+    ASSERT_ARE_EQUAL(int, 1, (int)test_entries[0].packetId);
+    ASSERT_IS_TRUE(IoTHubClient_PacketIdIndex_Remove(&index, 1) == &test_entries[0]);
+    ASSERT_IS_TRUE(IoTHubClient_PacketIdIndex_Remove(&index, PACKET_ID_INDEX_INLINE_BUCKETS) == &test_entries[PACKET_ID_INDEX_INLINE_BUCKETS - 1]);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_007: [ When inserting would leave index with more entries than buckets and index has fewer buckets than packet ids, IoTHubClient_PacketIdIndex_Insert shall allocate twice as many buckets and move all the entries to them. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_beyond_the_bucket_count_doubles_the_buckets)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    size_t i;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    insert_test_entries(&index, PACKET_ID_INDEX_INLINE_BUCKETS);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(2 * PACKET_ID_INDEX_INLINE_BUCKETS * sizeof(PACKET_ID_INDEX_ENTRY*)));
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[PACKET_ID_INDEX_INLINE_BUCKETS], PACKET_ID_INDEX_INLINE_BUCKETS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 2 * PACKET_ID_INDEX_INLINE_BUCKETS, index.bucketCount);
+    for (i = 0; i <= PACKET_ID_INDEX_INLINE_BUCKETS; i++)
+    {
+        ASSERT_IS_TRUE(IoTHubClient_PacketIdIndex_Remove(&index, (uint16_t)(i + 1)) == &test_entries[i]);
+    }
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+
+    // cleanup
+    IoTHubClient_PacketIdIndex_Deinit(&index);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_007: [ When inserting would leave index with more entries than buckets and index has fewer buckets than packet ids, IoTHubClient_PacketIdIndex_Insert shall allocate twice as many buckets and move all the entries to them. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_stops_growing_at_one_bucket_per_packet_id)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+
+    // act
+    insert_test_entries(&index, TEST_ENTRY_COUNT);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 65536, index.bucketCount);
+    ASSERT_ARE_EQUAL(size_t, TEST_ENTRY_COUNT, index.count);
+
+    // cleanup
+    IoTHubClient_PacketIdIndex_Deinit(&index);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_008: [ If allocating the larger bucket array fails, IoTHubClient_PacketIdIndex_Insert shall keep the current buckets and still succeed. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Insert_when_growing_fails_still_succeeds)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    size_t i;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    insert_test_entries(&index, PACKET_ID_INDEX_INLINE_BUCKETS);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[PACKET_ID_INDEX_INLINE_BUCKETS], PACKET_ID_INDEX_INLINE_BUCKETS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, PACKET_ID_INDEX_INLINE_BUCKETS, index.bucketCount);
+    for (i = 0; i <= PACKET_ID_INDEX_INLINE_BUCKETS; i++)
+    {
+        ASSERT_IS_TRUE(IoTHubClient_PacketIdIndex_Remove(&index, (uint16_t)(i + 1)) == &test_entries[i]);
+    }
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_009: [ If index is NULL, IoTHubClient_PacketIdIndex_Remove shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Remove_with_NULL_index_fails)
+{
+    // arrange
+
+    // act
+    PACKET_ID_INDEX_ENTRY* result = IoTHubClient_PacketIdIndex_Remove(NULL, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_010: [ IoTHubClient_PacketIdIndex_Remove shall unlink and return the most recently inserted entry with packetId, or return NULL if there is none. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Remove_unknown_packet_id_returns_NULL)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    insert_test_entries(&index, 2);
+
+    // act
+    /*same bucket as packet id 1*/
+    PACKET_ID_INDEX_ENTRY* result = IoTHubClient_PacketIdIndex_Remove(&index, PACKET_ID_INDEX_INLINE_BUCKETS + 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, 2, index.count);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_010: [ IoTHubClient_PacketIdIndex_Remove shall unlink and return the most recently inserted entry with packetId, or return NULL if there is none. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_Remove_with_a_reused_packet_id_returns_the_most_recent_entry)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    (void)IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[0], 7);
+    (void)IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[1], 7);
+
+    // act
+    PACKET_ID_INDEX_ENTRY* first = IoTHubClient_PacketIdIndex_Remove(&index, 7);
+    PACKET_ID_INDEX_ENTRY* second = IoTHubClient_PacketIdIndex_Remove(&index, 7);
+    PACKET_ID_INDEX_ENTRY* third = IoTHubClient_PacketIdIndex_Remove(&index, 7);
+
+    // assert
+    ASSERT_IS_TRUE(first == &test_entries[1]);
+    ASSERT_IS_TRUE(second == &test_entries[0]);
+    ASSERT_IS_NULL(third);
+    ASSERT_ARE_EQUAL(size_t, 0, index.count);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_011: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_RemoveEntry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_RemoveEntry_with_NULL_index_fails)
+{
+    // arrange
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_RemoveEntry(NULL, &test_entries[0]);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_011: [ If index or entry is NULL, IoTHubClient_PacketIdIndex_RemoveEntry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_RemoveEntry_with_NULL_entry_fails)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_RemoveEntry(&index, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_012: [ If entry is not in index, IoTHubClient_PacketIdIndex_RemoveEntry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_RemoveEntry_entry_not_in_the_index_fails)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    (void)IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[0], 7);
+    test_entries[1].packetId = 7;
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_RemoveEntry(&index, &test_entries[1]);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, index.count);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PACKET_ID_INDEX_41_013: [ Otherwise IoTHubClient_PacketIdIndex_RemoveEntry shall unlink entry and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_PacketIdIndex_RemoveEntry_removes_that_entry_only)
+{
+    // arrange
+    PACKET_ID_INDEX index;
+    IoTHubClient_PacketIdIndex_Init(&index);
+    (void)IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[0], 7);
+    (void)IoTHubClient_PacketIdIndex_Insert(&index, &test_entries[1], 7);
+
+    // act
+    int result = IoTHubClient_PacketIdIndex_RemoveEntry(&index, &test_entries[0]);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, index.count);
+    ASSERT_IS_TRUE(IoTHubClient_PacketIdIndex_Remove(&index, 7) == &test_entries[1]);
+}
+
+END_TEST_SUITE(iothub_client_packet_id_index_ut)
@@ -0,0 +1,807 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#endif
+#include <string.h>
+#include <stdbool.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/map.h"
+#include "iothub_message.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_persistent_queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+    extern VECTOR_HANDLE real_VECTOR_create(size_t elementSize);
+    extern void real_VECTOR_destroy(VECTOR_HANDLE handle);
+    extern int real_VECTOR_push_back(VECTOR_HANDLE handle, const void* elements, size_t numElements);
+    extern void real_VECTOR_erase(VECTOR_HANDLE handle, void* elements, size_t numElements);
+    extern void* real_VECTOR_element(const VECTOR_HANDLE handle, size_t index);
+    extern void* real_VECTOR_front(const VECTOR_HANDLE handle);
+    extern void* real_VECTOR_back(const VECTOR_HANDLE handle);
+    extern size_t real_VECTOR_size(const VECTOR_HANDLE handle);
+#ifdef __cplusplus
+}
+#endif
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/*the queue works in the current directory, the tests remove its files before and after running*/
+#define TEST_DIRECTORY "."
+#define TEST_INDEX_FILE "./iothub_queue.idx"
+#define TEST_MAX_SEGMENT_COUNT 8
+#define TEST_SEGMENT_SIZE (1024 * 1024)
+
+#define TEST_MESSAGE_HANDLE (IOTHUB_MESSAGE_HANDLE)0x4242
+#define TEST_REBUILT_MESSAGE_HANDLE (IOTHUB_MESSAGE_HANDLE)0x4243
+#define TEST_MAP_HANDLE (MAP_HANDLE)0x4244
+
+/*the message handed to IoTHubClient_PersistentQueue_Append*/
+static const unsigned char* g_content;
+static size_t g_contentSize;
+static const char* g_messageId;
+static const char* g_correlationId;
+static int g_priority;
+static const char* const* g_keys;
+static const char* const* g_values;
+static size_t g_propertyCount;
+
+/*what IoTHubClient_PersistentQueue_GetNextRecovered rebuilt*/
+static unsigned char g_rebuiltContent[64];
+static size_t g_rebuiltContentSize;
+static char g_rebuiltMessageId[64];
+static int g_rebuiltPriority;
+static size_t g_rebuiltPropertyCount;
+
+static const unsigned char TEST_CONTENT_1[] = { 'o', 'n', 'e' };
+static const unsigned char TEST_CONTENT_2[] = { 't', 'w', 'o', '!' };
+static const char* const TEST_KEYS[] = { "k1", "k2" };
+static const char* const TEST_VALUES[] = { "v1", "v2" };
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static IOTHUB_MESSAGE_RESULT my_IoTHubMessage_GetByteArray(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, const unsigned char** buffer, size_t* size)
+{
+    (void)iotHubMessageHandle;
+    *buffer = g_content;
+    *size = g_contentSize;
+    return IOTHUB_MESSAGE_OK;
+}
+
+static const char* my_IoTHubMessage_GetMessageId(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    (void)iotHubMessageHandle;
+    return g_messageId;
+}
+
+static const char* my_IoTHubMessage_GetCorrelationId(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    (void)iotHubMessageHandle;
+    return g_correlationId;
+}
+
+static int my_IoTHubMessage_GetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    (void)iotHubMessageHandle;
+    return g_priority;
+}
+
+static MAP_RESULT my_Map_GetInternals(MAP_HANDLE handle, const char*const** keys, const char*const** values, size_t* count)
+{
+    (void)handle;
+    *keys = g_keys;
+    *values = g_values;
+    *count = g_propertyCount;
+    return MAP_OK;
+}
+
+static IOTHUB_MESSAGE_HANDLE my_IoTHubMessage_CreateFromByteArray(const unsigned char* byteArray, size_t size)
+{
+    ASSERT_IS_TRUE(size <= sizeof(g_rebuiltContent));
+    if (size > 0)
+    {
+        (void)memcpy(g_rebuiltContent, byteArray, size);
+    }
+    g_rebuiltContentSize = size;
+    return TEST_REBUILT_MESSAGE_HANDLE;
+}
+
+static IOTHUB_MESSAGE_RESULT my_IoTHubMessage_SetMessageId(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, const char* messageId)
+{
+    (void)iotHubMessageHandle;
+    (void)strcpy(g_rebuiltMessageId, messageId);
+    return IOTHUB_MESSAGE_OK;
+}
+
+static IOTHUB_MESSAGE_RESULT my_IoTHubMessage_SetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, int priority)
+{
+    (void)iotHubMessageHandle;
+    g_rebuiltPriority = priority;
+    return IOTHUB_MESSAGE_OK;
+}
+
+static MAP_RESULT my_Map_AddOrUpdate(MAP_HANDLE handle, const char* key, const char* value)
+{
+    (void)handle;
+    (void)key;
+    (void)value;
+    g_rebuiltPropertyCount++;
+    return MAP_OK;
+}
+
+static void set_test_message(const unsigned char* content, size_t contentSize, const char* messageId, int priority)
+{
+    g_content = content;
+    g_contentSize = contentSize;
+    g_messageId = messageId;
+    g_correlationId = NULL;
+    g_priority = priority;
+    g_keys = TEST_KEYS;
+    g_values = TEST_VALUES;
+    g_propertyCount = sizeof(TEST_KEYS) / sizeof(TEST_KEYS[0]);
+}
+
+static void make_test_segment_path(char* path, size_t segmentId)
+{
+    (void)sprintf(path, "%s/%08lu.iotq", TEST_DIRECTORY, (unsigned long)segmentId);
+}
+
+static bool test_segment_exists(size_t segmentId)
+{
+    char path[64];
+    FILE* file;
+    make_test_segment_path(path, segmentId);
+    file = fopen(path, "rb");
+    if (file != NULL)
+    {
+        (void)fclose(file);
+    }
+    return file != NULL;
+}
+
+static unsigned long read_test_index(void)
+{
+    unsigned long result = 0;
+    FILE* file = fopen(TEST_INDEX_FILE, "rb");
+    if (file != NULL)
+    {
+        if (fscanf(file, "%lu", &result) != 1)
+        {
+            result = 0;
+        }
+        (void)fclose(file);
+    }
+    return result;
+}
+
+static void remove_test_files(void)
+{
+    char path[64];
+    size_t i;
+    for (i = 0; i < TEST_MAX_SEGMENT_COUNT; i++)
+    {
+        make_test_segment_path(path, i);
+        (void)remove(path);
+    }
+    (void)remove(TEST_INDEX_FILE);
+}
+
+static PERSISTENT_QUEUE_HANDLE create_test_queue(size_t segmentSize, size_t syncCount)
+{
+    PERSISTENT_QUEUE_HANDLE result = IoTHubClient_PersistentQueue_Create(TEST_DIRECTORY, segmentSize, syncCount);
+    ASSERT_IS_NOT_NULL(result);
+    return result;
+}
+
+static PERSISTENT_QUEUE_ENTRY append_test_message(PERSISTENT_QUEUE_HANDLE persistentQueue, const unsigned char* content, size_t contentSize, const char* messageId)
+{
+    PERSISTENT_QUEUE_ENTRY result;
+    set_test_message(content, contentSize, messageId, 0);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PersistentQueue_Append(persistentQueue, TEST_MESSAGE_HANDLE, &result));
+    return result;
+}
+
+BEGIN_TEST_SUITE(iothub_client_persistent_queue_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUBMESSAGE_CONTENT_TYPE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(MAP_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(MAP_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(VECTOR_HANDLE, void*);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_create, real_VECTOR_create);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(VECTOR_create, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_destroy, real_VECTOR_destroy);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_push_back, real_VECTOR_push_back);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_erase, real_VECTOR_erase);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_element, real_VECTOR_element);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_front, real_VECTOR_front);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_back, real_VECTOR_back);
+    REGISTER_GLOBAL_MOCK_HOOK(VECTOR_size, real_VECTOR_size);
+
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_GetContentType, IOTHUBMESSAGE_BYTEARRAY);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetByteArray, my_IoTHubMessage_GetByteArray);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetMessageId, my_IoTHubMessage_GetMessageId);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetCorrelationId, my_IoTHubMessage_GetCorrelationId);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetPriority, my_IoTHubMessage_GetPriority);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_Properties, TEST_MAP_HANDLE);
+    REGISTER_GLOBAL_MOCK_HOOK(Map_GetInternals, my_Map_GetInternals);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_CreateFromByteArray, my_IoTHubMessage_CreateFromByteArray);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubMessage_CreateFromByteArray, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_SetMessageId, my_IoTHubMessage_SetMessageId);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_SetCorrelationId, IOTHUB_MESSAGE_OK);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_SetPriority, my_IoTHubMessage_SetPriority);
+    REGISTER_GLOBAL_MOCK_HOOK(Map_AddOrUpdate, my_Map_AddOrUpdate);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    remove_test_files();
+    g_rebuiltContentSize = 0;
+    g_rebuiltMessageId[0] = '\0';
+    g_rebuiltPriority = 0;
+    g_rebuiltPropertyCount = 0;
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    remove_test_files();
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_001: [ If directory is NULL or segmentSize is 0, IoTHubClient_PersistentQueue_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_with_NULL_directory_fails)
+{
+    // arrange
+
+    // act
+    PERSISTENT_QUEUE_HANDLE result = IoTHubClient_PersistentQueue_Create(NULL, TEST_SEGMENT_SIZE, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_001: [ If directory is NULL or segmentSize is 0, IoTHubClient_PersistentQueue_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_with_0_segmentSize_fails)
+{
+    // arrange
+
+    // act
+    PERSISTENT_QUEUE_HANDLE result = IoTHubClient_PersistentQueue_Create(TEST_DIRECTORY, 0, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_004: [ If any allocation fails, or a segment file cannot be read, IoTHubClient_PersistentQueue_Create shall release everything it opened and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_fails_when_allocating_the_queue_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    PERSISTENT_QUEUE_HANDLE result = IoTHubClient_PersistentQueue_Create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_004: [ If any allocation fails, or a segment file cannot be read, IoTHubClient_PersistentQueue_Create shall release everything it opened and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_fails_when_creating_the_segment_vector_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(NULL));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    PERSISTENT_QUEUE_HANDLE result = IoTHubClient_PersistentQueue_Create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_005: [ If persistentQueue is NULL, IoTHubClient_PersistentQueue_Destroy shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Destroy_with_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_PersistentQueue_Destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_007: [ If persistentQueue, message or entry is NULL, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Append_with_NULL_message_fails)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry;
+    umock_c_reset_all_calls();
+
+    // act
+    int result = IoTHubClient_PersistentQueue_Append(persistentQueue, NULL, &entry);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_FALSE(test_segment_exists(0));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_008: [ IoTHubClient_PersistentQueue_Append shall serialize the payload, message id, correlation id, priority and properties of message and write them at the end of the current segment as a pending entry, then fill entry. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Append_writes_the_entries_one_after_the_other)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+
+    // act
+    PERSISTENT_QUEUE_ENTRY entry1 = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    PERSISTENT_QUEUE_ENTRY entry2 = append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, entry1.segmentId);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry1.offset);
+    ASSERT_ARE_EQUAL(size_t, 0, entry2.segmentId);
+    ASSERT_IS_TRUE(entry2.offset > entry1.offset);
+    ASSERT_IS_TRUE(test_segment_exists(0));
+    ASSERT_IS_FALSE(test_segment_exists(1));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_011: [ If the message cannot be serialized or written, IoTHubClient_PersistentQueue_Append shall fail and return a non-zero value; after a failed write the next entry goes to a new segment. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Append_fails_when_the_properties_cannot_be_read)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry;
+    set_test_message(TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1", 0);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Properties(TEST_MESSAGE_HANDLE))
+        .SetReturn(NULL);
+
+    // act
+    int result = IoTHubClient_PersistentQueue_Append(persistentQueue, TEST_MESSAGE_HANDLE, &entry);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_009: [ IoTHubClient_PersistentQueue_Append shall start a new segment when the entry would make the current one larger than segmentSize. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Append_starts_a_new_segment_when_the_current_one_is_full)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(1, 1);
+
+    // act
+    PERSISTENT_QUEUE_ENTRY entry1 = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    PERSISTENT_QUEUE_ENTRY entry2 = append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, entry1.segmentId);
+    ASSERT_ARE_EQUAL(size_t, 1, entry2.segmentId);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry2.offset);
+    ASSERT_IS_TRUE(test_segment_exists(0));
+    ASSERT_IS_TRUE(test_segment_exists(1));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_012: [ If persistentQueue or entry is NULL, or entry is not in a segment of the queue, IoTHubClient_PersistentQueue_MarkDone shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_MarkDone_with_an_unknown_segment_fails)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    entry.segmentId = 5;
+
+    // act
+    int result = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_013: [ IoTHubClient_PersistentQueue_MarkDone shall mark the entry done in its segment and delete the leading segments that have no pending entry left, except the one being appended to. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_MarkDone_deletes_the_oldest_segment_once_it_is_done)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(1, 1);
+    PERSISTENT_QUEUE_ENTRY entry1 = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    PERSISTENT_QUEUE_ENTRY entry2 = append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+
+    // act
+    int result1 = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry1);
+    int result2 = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry2);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result1);
+    ASSERT_ARE_EQUAL(int, 0, result2);
+    ASSERT_IS_FALSE(test_segment_exists(0));
+    /*the segment being appended to stays*/
+    ASSERT_IS_TRUE(test_segment_exists(1));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_025: [ The index file shall be written and synced to the storage before any segment is deleted, and no segment shall be deleted if that fails. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_MarkDone_moves_the_index_past_the_deleted_segment)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(1, 1);
+    PERSISTENT_QUEUE_ENTRY entry1 = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    (void)append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+
+    // act
+    int result = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(test_segment_exists(0));
+    ASSERT_ARE_EQUAL(int, 1, (int)read_test_index());
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_013: [ IoTHubClient_PersistentQueue_MarkDone shall mark the entry done in its segment and delete the leading segments that have no pending entry left, except the one being appended to. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_MarkDone_keeps_a_done_segment_behind_a_pending_one)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(1, 1);
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    PERSISTENT_QUEUE_ENTRY entry2 = append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id3");
+
+    // act
+    int result = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry2);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(test_segment_exists(0));
+    ASSERT_IS_TRUE(test_segment_exists(1));
+    ASSERT_IS_TRUE(test_segment_exists(2));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_014: [ Marking an entry that is already done shall succeed and change nothing. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_MarkDone_twice_succeeds)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry));
+
+    // act
+    int result = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_016: [ If persistentQueue or entry is NULL, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_GetNextRecovered_with_NULL_entry_returns_NULL)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_MESSAGE_HANDLE result = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_018: [ When there is no such entry left, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_GetNextRecovered_does_not_return_entries_appended_by_the_same_queue)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry;
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+
+    // act
+    IOTHUB_MESSAGE_HANDLE result = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &entry);
+
+    // assert
+    ASSERT_IS_NULL(result);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_002: [ IoTHubClient_PersistentQueue_Create shall open the segments of directory, starting with the one named in its index file, and count their pending entries. The segments end at the first incomplete entry. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_006: [ Otherwise IoTHubClient_PersistentQueue_Destroy shall flush and close all the segments and free the queue. Pending entries stay in the directory. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_017: [ IoTHubClient_PersistentQueue_GetNextRecovered shall return a new message rebuilt from the next pending entry of the segments found by IoTHubClient_PersistentQueue_Create, and fill entry. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_018: [ When there is no such entry left, IoTHubClient_PersistentQueue_GetNextRecovered shall return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_GetNextRecovered_returns_the_pending_entries_left_by_a_previous_queue)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry1 = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    PERSISTENT_QUEUE_ENTRY entry2;
+    PERSISTENT_QUEUE_ENTRY recovered;
+    set_test_message(TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2", 7);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PersistentQueue_Append(persistentQueue, TEST_MESSAGE_HANDLE, &entry2));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry1));
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+    persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+
+    // act
+    IOTHUB_MESSAGE_HANDLE result1 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered);
+    IOTHUB_MESSAGE_HANDLE result2 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_REBUILT_MESSAGE_HANDLE, (void*)result1);
+    ASSERT_IS_NULL(result2);
+    ASSERT_ARE_EQUAL(size_t, entry2.segmentId, recovered.segmentId);
+    ASSERT_ARE_EQUAL(int, (int)entry2.offset, (int)recovered.offset);
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_CONTENT_2), g_rebuiltContentSize);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_CONTENT_2, g_rebuiltContent, sizeof(TEST_CONTENT_2)));
+    ASSERT_ARE_EQUAL(char_ptr, "id2", g_rebuiltMessageId);
+    ASSERT_ARE_EQUAL(int, 7, g_rebuiltPriority);
+    ASSERT_ARE_EQUAL(size_t, 2, g_rebuiltPropertyCount);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_023: [ IoTHubClient_PersistentQueue_Create shall close every segment once it is counted, a segment that is not appended to is opened again only to mark an entry done or to read it back. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_024: [ Before starting a new segment, IoTHubClient_PersistentQueue_Append shall sync and close the current one. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_reopens_the_closed_segments_to_read_them_back_and_mark_them_done)
+{
+    // arrange
+    PERSISTENT_QUEUE_ENTRY recovered1;
+    PERSISTENT_QUEUE_ENTRY recovered2;
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(1, 1);
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    (void)append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+    persistentQueue = create_test_queue(1, 1);
+
+    // act
+    IOTHUB_MESSAGE_HANDLE result1 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered1);
+    IOTHUB_MESSAGE_HANDLE result2 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered2);
+    int result3 = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &recovered2);
+    int result4 = IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &recovered1);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_REBUILT_MESSAGE_HANDLE, (void*)result1);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_REBUILT_MESSAGE_HANDLE, (void*)result2);
+    ASSERT_ARE_EQUAL(char_ptr, "id2", g_rebuiltMessageId);
+    ASSERT_ARE_EQUAL(size_t, 0, recovered1.segmentId);
+    ASSERT_ARE_EQUAL(size_t, 1, recovered2.segmentId);
+    ASSERT_ARE_EQUAL(int, 0, result3);
+    ASSERT_ARE_EQUAL(int, 0, result4);
+    ASSERT_IS_FALSE(test_segment_exists(0));
+    ASSERT_IS_FALSE(test_segment_exists(1));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_002: [ IoTHubClient_PersistentQueue_Create shall open the segments of directory, starting with the one named in its index file, and count their pending entries. The segments end at the first incomplete entry. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_ignores_a_torn_entry_at_the_end_of_a_segment)
+{
+    // arrange
+    static const unsigned char tornHeader[] = { 0x49, 0x4F, 0x54, 0x51, 0xFF };
+    char path[64];
+    FILE* segmentFile;
+    PERSISTENT_QUEUE_ENTRY recovered;
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+
+    make_test_segment_path(path, 0);
+    segmentFile = fopen(path, "ab");
+    ASSERT_IS_NOT_NULL(segmentFile);
+    ASSERT_ARE_EQUAL(size_t, sizeof(tornHeader), fwrite(tornHeader, 1, sizeof(tornHeader), segmentFile));
+    (void)fclose(segmentFile);
+    persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+
+    // act
+    IOTHUB_MESSAGE_HANDLE result1 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered);
+    IOTHUB_MESSAGE_HANDLE result2 = IoTHubClient_PersistentQueue_GetNextRecovered(persistentQueue, &recovered);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_REBUILT_MESSAGE_HANDLE, (void*)result1);
+    ASSERT_IS_NULL(result2);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_003: [ New entries shall never be appended to a segment found by IoTHubClient_PersistentQueue_Create, and the leading segments without pending entries shall be deleted. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_appends_after_the_recovered_segments)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+    persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+
+    // act
+    PERSISTENT_QUEUE_ENTRY entry = append_test_message(persistentQueue, TEST_CONTENT_2, sizeof(TEST_CONTENT_2), "id2");
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, entry.segmentId);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry.offset);
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_003: [ New entries shall never be appended to a segment found by IoTHubClient_PersistentQueue_Create, and the leading segments without pending entries shall be deleted. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Create_deletes_the_recovered_segments_that_are_done)
+{
+    // arrange
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+    PERSISTENT_QUEUE_ENTRY entry = append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_PersistentQueue_MarkDone(persistentQueue, &entry));
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+    ASSERT_IS_TRUE(test_segment_exists(0));
+
+    // act
+    persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 1);
+
+    // assert
+    ASSERT_IS_FALSE(test_segment_exists(0));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_020: [ If persistentQueue is NULL, IoTHubClient_PersistentQueue_Flush shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Flush_with_NULL_fails)
+{
+    // arrange
+
+    // act
+    int result = IoTHubClient_PersistentQueue_Flush(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_010: [ If syncCount is not 0, IoTHubClient_PersistentQueue_Append shall flush the segments once syncCount writes (entries or done marks) happened since the last flush. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_021: [ Otherwise IoTHubClient_PersistentQueue_Flush shall flush all the segments and return 0, or a non-zero value if any flush fails. ]*/
+/* Tests_SRS_IOTHUBCLIENT_PERSISTENT_QUEUE_41_022: [ If nothing was written since the last flush, IoTHubClient_PersistentQueue_Flush shall return 0 without flushing. ]*/
+TEST_FUNCTION(IoTHubClient_PersistentQueue_Flush_makes_unsynced_entries_visible_to_a_new_queue)
+{
+    // arrange
+    PERSISTENT_QUEUE_ENTRY recovered;
+    PERSISTENT_QUEUE_HANDLE persistentQueue = create_test_queue(TEST_SEGMENT_SIZE, 0);
+    PERSISTENT_QUEUE_HANDLE reader;
+    (void)append_test_message(persistentQueue, TEST_CONTENT_1, sizeof(TEST_CONTENT_1), "id1");
+
+    // act
+    int result1 = IoTHubClient_PersistentQueue_Flush(persistentQueue);
+    int result2 = IoTHubClient_PersistentQueue_Flush(persistentQueue);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result1);
+    ASSERT_ARE_EQUAL(int, 0, result2);
+    reader = create_test_queue(TEST_SEGMENT_SIZE, 0);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_REBUILT_MESSAGE_HANDLE, (void*)IoTHubClient_PersistentQueue_GetNextRecovered(reader, &recovered));
+
+    // cleanup
+    IoTHubClient_PersistentQueue_Destroy(reader);
+    IoTHubClient_PersistentQueue_Destroy(persistentQueue);
+}
+
+END_TEST_SUITE(iothub_client_persistent_queue_ut)
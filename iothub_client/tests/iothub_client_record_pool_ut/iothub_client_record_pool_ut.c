@@ -0,0 +1,431 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+#include <string.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_record_pool.h"
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#define TEST_RECORD_SIZE 24
+#define TEST_CAPACITY 2
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static RECORD_POOL_HANDLE create_test_pool(void)
+{
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, TEST_CAPACITY);
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static RECORD_POOL_STATISTICS get_test_statistics(RECORD_POOL_HANDLE recordPool)
+{
+    RECORD_POOL_STATISTICS result;
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_RecordPool_GetStatistics(recordPool, &result));
+    return result;
+}
+
+BEGIN_TEST_SUITE(iothub_client_record_pool_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_001: [ If recordSize or capacity is 0, or the pool would not fit in memory, IoTHubClient_RecordPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_with_0_recordSize_fails)
+{
+    // arrange
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(0, TEST_CAPACITY);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_001: [ If recordSize or capacity is 0, or the pool would not fit in memory, IoTHubClient_RecordPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_with_0_capacity_fails)
+{
+    // arrange
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, 0);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_001: [ If recordSize or capacity is 0, or the pool would not fit in memory, IoTHubClient_RecordPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_with_overflowing_capacity_fails)
+{
+    // arrange
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, SIZE_MAX / 2);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_002: [ IoTHubClient_RecordPool_Create shall allocate the pool and a single block holding capacity records, and put all the records in the free list. ]*/
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_014: [ Otherwise IoTHubClient_RecordPool_GetStatistics shall copy the capacity, the number of records in use, the hits and the misses of the pool to statistics and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_succeeds)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, TEST_CAPACITY);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = get_test_statistics(result);
+    ASSERT_ARE_EQUAL(size_t, TEST_CAPACITY, statistics.capacity);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.misses);
+
+    // cleanup
+    IoTHubClient_RecordPool_Destroy(result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_003: [ If any allocation fails, IoTHubClient_RecordPool_Create shall free everything it allocated and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_fails_when_allocating_the_block_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, TEST_CAPACITY);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_003: [ If any allocation fails, IoTHubClient_RecordPool_Create shall free everything it allocated and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Create_fails_when_allocating_the_pool_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    RECORD_POOL_HANDLE result = IoTHubClient_RecordPool_Create(TEST_RECORD_SIZE, TEST_CAPACITY);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_004: [ If recordPool is NULL, IoTHubClient_RecordPool_Destroy shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Destroy_with_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_RecordPool_Destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_005: [ If no record of the pool is in use, IoTHubClient_RecordPool_Destroy shall free the pool. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Destroy_frees_the_pool)
+{
+    // arrange
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(recordPool));
+
+    // act
+    IoTHubClient_RecordPool_Destroy(recordPool);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_006: [ Otherwise the pool shall be freed when its last record is freed. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Destroy_with_records_in_use_defers_the_free)
+{
+    // arrange
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+    void* record = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubClient_RecordPool_Destroy(recordPool);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    umock_c_reset_all_calls();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(recordPool));
+    IoTHubClient_RecordPool_Free(record);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_007: [ If recordPool has a free record and recordSize is not larger than the record size of the pool, IoTHubClient_RecordPool_Alloc shall take the record from the free list and count a hit. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Alloc_takes_records_from_the_pool)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+
+    // act
+    void* record1 = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+    void* record2 = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE - 1);
+
+    // assert
+    ASSERT_IS_NOT_NULL(record1);
+    ASSERT_IS_NOT_NULL(record2);
+    ASSERT_ARE_NOT_EQUAL(void_ptr, record1, record2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = get_test_statistics(recordPool);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.misses);
+
+    // cleanup
+    IoTHubClient_RecordPool_Free(record1);
+    IoTHubClient_RecordPool_Free(record2);
+    IoTHubClient_RecordPool_Destroy(recordPool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_008: [ Otherwise IoTHubClient_RecordPool_Alloc shall allocate the record with malloc and, if recordPool is not NULL, count a miss. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Alloc_uses_malloc_when_the_pool_is_exhausted)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+    void* record1 = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+    void* record2 = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+    umock_c_reset_all_calls();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    void* record3 = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+
+    // assert
+    ASSERT_IS_NOT_NULL(record3);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = get_test_statistics(recordPool);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.misses);
+
+    // cleanup
+    IoTHubClient_RecordPool_Free(record1);
+    IoTHubClient_RecordPool_Free(record2);
+    IoTHubClient_RecordPool_Free(record3);
+    IoTHubClient_RecordPool_Destroy(recordPool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_008: [ Otherwise IoTHubClient_RecordPool_Alloc shall allocate the record with malloc and, if recordPool is not NULL, count a miss. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Alloc_uses_malloc_for_oversized_records)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    void* record = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE + 1);
+
+    // assert
+    ASSERT_IS_NOT_NULL(record);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = get_test_statistics(recordPool);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.misses);
+
+    // cleanup
+    IoTHubClient_RecordPool_Free(record);
+    IoTHubClient_RecordPool_Destroy(recordPool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_008: [ Otherwise IoTHubClient_RecordPool_Alloc shall allocate the record with malloc and, if recordPool is not NULL, count a miss. ]*/
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_011: [ If the record was allocated with malloc, IoTHubClient_RecordPool_Free shall free it. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Alloc_with_NULL_pool_uses_malloc)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    void* record = IoTHubClient_RecordPool_Alloc(NULL, TEST_RECORD_SIZE);
+    IoTHubClient_RecordPool_Free(record);
+
+    // assert
+    ASSERT_IS_NOT_NULL(record);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_009: [ If malloc fails, IoTHubClient_RecordPool_Alloc shall return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Alloc_fails_when_malloc_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    void* record = IoTHubClient_RecordPool_Alloc(NULL, TEST_RECORD_SIZE);
+
+    // assert
+    ASSERT_IS_NULL(record);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_010: [ If record is NULL, IoTHubClient_RecordPool_Free shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Free_with_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_RecordPool_Free(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_012: [ Otherwise IoTHubClient_RecordPool_Free shall put the record back in the free list of its pool. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_Free_returns_the_record_to_the_pool)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+    void* record = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+    void* reusedRecord;
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubClient_RecordPool_Free(record);
+    reusedRecord = IoTHubClient_RecordPool_Alloc(recordPool, TEST_RECORD_SIZE);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, record, reusedRecord);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = get_test_statistics(recordPool);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.hits);
+
+    // cleanup
+    IoTHubClient_RecordPool_Free(reusedRecord);
+    IoTHubClient_RecordPool_Destroy(recordPool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_013: [ If recordPool or statistics is NULL, IoTHubClient_RecordPool_GetStatistics shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_GetStatistics_with_NULL_pool_fails)
+{
+    // arrange
+    RECORD_POOL_STATISTICS statistics;
+
+    // act
+    int result = IoTHubClient_RecordPool_GetStatistics(NULL, &statistics);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_RECORD_POOL_41_013: [ If recordPool or statistics is NULL, IoTHubClient_RecordPool_GetStatistics shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_RecordPool_GetStatistics_with_NULL_statistics_fails)
+{
+    // arrange
+    RECORD_POOL_HANDLE recordPool = create_test_pool();
+
+    // act
+    int result = IoTHubClient_RecordPool_GetStatistics(recordPool, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    IoTHubClient_RecordPool_Destroy(recordPool);
+}
+
+END_TEST_SUITE(iothub_client_record_pool_ut)
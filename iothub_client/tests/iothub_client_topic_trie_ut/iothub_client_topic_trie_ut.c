@@ -0,0 +1,525 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+#include <string.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_topic_trie.h"
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#define TEST_TWIN_PATCH_VALUE 1
+#define TEST_TWIN_RESPONSE_VALUE 2
+#define TEST_METHOD_VALUE 3
+#define TEST_C2D_VALUE 4
+
+static const char* TEST_TWIN_PATCH_FILTER = "$iothub/twin/PATCH/properties/desired/#";
+static const char* TEST_TWIN_RESPONSE_FILTER = "$iothub/twin/+/+/#";
+static const char* TEST_METHOD_FILTER = "$iothub/methods/POST/+/#";
+static const char* TEST_C2D_FILTER = "devices/+/messages/devicebound/#";
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+/*the filters the MQTT transport routes received publishes with*/
+static void add_test_filters(TOPIC_TRIE* trie)
+{
+    IoTHubClient_TopicTrie_Init(trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(trie, TEST_TWIN_PATCH_FILTER, TEST_TWIN_PATCH_VALUE));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(trie, TEST_TWIN_RESPONSE_FILTER, TEST_TWIN_RESPONSE_VALUE));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(trie, TEST_METHOD_FILTER, TEST_METHOD_VALUE));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(trie, TEST_C2D_FILTER, TEST_C2D_VALUE));
+    umock_c_reset_all_calls();
+}
+
+static void assert_capture(const TOPIC_TRIE_MATCH* match, size_t index, const char* expected)
+{
+    ASSERT_IS_TRUE(index < match->captureCount);
+    ASSERT_ARE_EQUAL(size_t, strlen(expected), match->captureLengths[index]);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(expected, match->captures[index], match->captureLengths[index]));
+}
+
+BEGIN_TEST_SUITE(iothub_client_topic_trie_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_001: [ If trie is NULL, IoTHubClient_TopicTrie_Init shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Init_with_NULL_trie_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_TopicTrie_Init(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_002: [ IoTHubClient_TopicTrie_Init shall leave trie with only its root node, so that no topic matches. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Init_makes_an_empty_trie)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    memset(&trie, 0xAA, sizeof(trie));
+
+    // act
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_TopicTrie_Match(&trie, "a/b", &match));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_003: [ If trie or filter is NULL, filter is empty or value is negative, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_NULL_trie_fails)
+{
+    // arrange
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(NULL, "a/b", 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_003: [ If trie or filter is NULL, filter is empty or value is negative, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_NULL_filter_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, NULL, 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_003: [ If trie or filter is NULL, filter is empty or value is negative, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_empty_filter_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "", 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_003: [ If trie or filter is NULL, filter is empty or value is negative, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_negative_value_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "a/b", -1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_004: [ If a level of filter contains '+' or '#' but is not exactly "+" or "#", or "#" is not the last level, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_partial_level_wildcard_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int plusResult = IoTHubClient_TopicTrie_Add(&trie, "a/b+/c", 0);
+    int hashResult = IoTHubClient_TopicTrie_Add(&trie, "a/b#", 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, plusResult);
+    ASSERT_ARE_NOT_EQUAL(int, 0, hashResult);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_004: [ If a level of filter contains '+' or '#' but is not exactly "+" or "#", or "#" is not the last level, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_hash_before_the_last_level_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "a/#/c", 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_005: [ If filter has more than TOPIC_TRIE_MAX_CAPTURES "+" levels, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_too_many_plus_levels_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    char filter[2 * (TOPIC_TRIE_MAX_CAPTURES + 1)];
+    size_t i;
+    for (i = 0; i < TOPIC_TRIE_MAX_CAPTURES + 1; i++)
+    {
+        filter[2 * i] = '+';
+        filter[2 * i + 1] = '/';
+    }
+    filter[sizeof(filter) - 1] = '\0';
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, filter, 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_006: [ If trie might not have a free node for every level of filter, IoTHubClient_TopicTrie_Add shall fail, leave trie unchanged and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_with_too_many_levels_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    char filter[2 * TOPIC_TRIE_MAX_NODES];
+    size_t i;
+    for (i = 0; i < TOPIC_TRIE_MAX_NODES; i++)
+    {
+        filter[2 * i] = 'a';
+        filter[2 * i + 1] = '/';
+    }
+    filter[sizeof(filter) - 1] = '\0';
+    IoTHubClient_TopicTrie_Init(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, filter, 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_007: [ IoTHubClient_TopicTrie_Add shall walk trie one level of filter at a time, reusing the node of a level already present and adding a node pointing into filter otherwise; filter is not copied. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_shares_the_common_levels_without_allocating)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/b/c", 0));
+    umock_c_reset_all_calls();
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "a/b/d", 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 5, trie.nodeCount);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_008: [ If filter is already in trie, IoTHubClient_TopicTrie_Add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_same_filter_twice_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/+", 0));
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "a/+", 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Match(&trie, "a/b", &match));
+    ASSERT_ARE_EQUAL(int, 0, match.value);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_009: [ Otherwise IoTHubClient_TopicTrie_Add shall store value at the node of the last level of filter and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Add_filter_that_is_a_prefix_of_another_succeeds)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/b/c", 0));
+
+    // act
+    int result = IoTHubClient_TopicTrie_Add(&trie, "a/b", 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Match(&trie, "a/b", &match));
+    ASSERT_ARE_EQUAL(int, 1, match.value);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Match(&trie, "a/b/c", &match));
+    ASSERT_ARE_EQUAL(int, 0, match.value);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_010: [ If trie, topic or match is NULL, IoTHubClient_TopicTrie_Match shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_with_NULL_arguments_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int nullTrieResult = IoTHubClient_TopicTrie_Match(NULL, "a/b", &match);
+    int nullTopicResult = IoTHubClient_TopicTrie_Match(&trie, NULL, &match);
+    int nullMatchResult = IoTHubClient_TopicTrie_Match(&trie, "a/b", NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, nullTrieResult);
+    ASSERT_ARE_NOT_EQUAL(int, 0, nullTopicResult);
+    ASSERT_ARE_NOT_EQUAL(int, 0, nullMatchResult);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_011: [ IoTHubClient_TopicTrie_Match shall compare topic to the filters of trie level by level, trying a literal level before "+" and "+" before "#" and backtracking when a branch does not end on a filter. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_prefers_the_literal_level)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "$iothub/twin/PATCH/properties/desired/?$version=3", &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, TEST_TWIN_PATCH_VALUE, match.value);
+    ASSERT_ARE_EQUAL(size_t, 0, match.captureCount);
+    ASSERT_ARE_EQUAL(char_ptr, "?$version=3", match.remainder);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_011: [ IoTHubClient_TopicTrie_Match shall compare topic to the filters of trie level by level, trying a literal level before "+" and "+" before "#" and backtracking when a branch does not end on a filter. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_backtracks_to_the_plus_level)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "$iothub/twin/PATCH/204/?$rid=7", &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, TEST_TWIN_RESPONSE_VALUE, match.value);
+    ASSERT_ARE_EQUAL(size_t, 2, match.captureCount);
+    assert_capture(&match, 0, "PATCH");
+    assert_capture(&match, 1, "204");
+    ASSERT_ARE_EQUAL(char_ptr, "?$rid=7", match.remainder);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_011: [ IoTHubClient_TopicTrie_Match shall compare topic to the filters of trie level by level, trying a literal level before "+" and "+" before "#" and backtracking when a branch does not end on a filter. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_falls_back_to_the_hash_level)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/+/c", 0));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/#", 1));
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "a/b/d", &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 1, match.value);
+    ASSERT_ARE_EQUAL(size_t, 0, match.captureCount);
+    ASSERT_ARE_EQUAL(char_ptr, "b/d", match.remainder);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_012: [ On a match IoTHubClient_TopicTrie_Match shall set match->value to the value of the filter, match->captures/captureLengths to the topic levels matched by each "+", match->remainder to the part of topic matched by "#" (an empty string if none) and return 0, all pointing into topic. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_method_topic_captures_the_method_name)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    const char* topic = "$iothub/methods/POST/method_name/?$rid=b";
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, topic, &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, TEST_METHOD_VALUE, match.value);
+    ASSERT_ARE_EQUAL(size_t, 1, match.captureCount);
+    assert_capture(&match, 0, "method_name");
+    ASSERT_IS_TRUE(match.captures[0] == topic + strlen("$iothub/methods/POST/"));
+    ASSERT_IS_TRUE(match.remainder == topic + strlen("$iothub/methods/POST/method_name/"));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_012: [ On a match IoTHubClient_TopicTrie_Match shall set match->value to the value of the filter, match->captures/captureLengths to the topic levels matched by each "+", match->remainder to the part of topic matched by "#" (an empty string if none) and return 0, all pointing into topic. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_hash_matches_no_level)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "devices/thisIsDeviceID/messages/devicebound", &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, TEST_C2D_VALUE, match.value);
+    assert_capture(&match, 0, "thisIsDeviceID");
+    ASSERT_ARE_EQUAL(char_ptr, "", match.remainder);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_012: [ On a match IoTHubClient_TopicTrie_Match shall set match->value to the value of the filter, match->captures/captureLengths to the topic levels matched by each "+", match->remainder to the part of topic matched by "#" (an empty string if none) and return 0, all pointing into topic. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_without_hash_has_an_empty_remainder)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/+", 5));
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "a/", &match);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 5, match.value);
+    assert_capture(&match, 0, "");
+    ASSERT_ARE_EQUAL(char_ptr, "", match.remainder);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_013: [ If no filter matches topic, IoTHubClient_TopicTrie_Match shall return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_unknown_topic_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "devices/thisIsDeviceID/messages/events/", &match);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, match.captureCount);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_013: [ If no filter matches topic, IoTHubClient_TopicTrie_Match shall return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_is_case_sensitive)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    add_test_filters(&trie);
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "$IOTHUB/methods/POST/method_name/?$rid=b", &match);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_TOPIC_TRIE_41_013: [ If no filter matches topic, IoTHubClient_TopicTrie_Match shall return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_TopicTrie_Match_topic_longer_than_a_filter_without_hash_fails)
+{
+    // arrange
+    TOPIC_TRIE trie;
+    TOPIC_TRIE_MATCH match;
+    IoTHubClient_TopicTrie_Init(&trie);
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_TopicTrie_Add(&trie, "a/+", 0));
+
+    // act
+    int result = IoTHubClient_TopicTrie_Match(&trie, "a/b/c", &match);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+END_TEST_SUITE(iothub_client_topic_trie_ut)
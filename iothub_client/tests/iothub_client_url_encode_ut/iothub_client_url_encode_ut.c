@@ -0,0 +1,256 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+
+#include "iothub_client_url_encode.h"
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+/*encodes source in a buffer one character larger than needed and checks the extra character is left alone*/
+static void assert_encodes_to(const char* source, const char* expected)
+{
+    size_t length = strlen(source);
+    size_t expectedLength = strlen(expected);
+    char* destination = (char*)malloc(expectedLength + 1);
+    ASSERT_IS_NOT_NULL(destination);
+    destination[expectedLength] = '#';
+
+    ASSERT_ARE_EQUAL(size_t, expectedLength, IoTHubClient_UrlEncode_GetEncodedLength(source, length));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_UrlEncode_Encode(destination, source, length));
+    ASSERT_IS_TRUE(memcmp(destination, expected, expectedLength) == 0);
+    ASSERT_ARE_EQUAL(char, '#', destination[expectedLength]);
+
+    free(destination);
+}
+
+static void assert_decodes_to(const char* source, const char* expected)
+{
+    size_t length = strlen(source);
+    size_t decodedLength = 0;
+    char* destination = (char*)malloc(length + 1);
+    ASSERT_IS_NOT_NULL(destination);
+
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_UrlEncode_Decode(destination, source, length, &decodedLength));
+    ASSERT_ARE_EQUAL(size_t, strlen(expected), decodedLength);
+    ASSERT_IS_TRUE(memcmp(destination, expected, decodedLength) == 0);
+
+    free(destination);
+}
+
+static void assert_decode_fails(const char* source)
+{
+    size_t length = strlen(source);
+    size_t decodedLength = 0;
+    char* destination = (char*)malloc(length + 1);
+    ASSERT_IS_NOT_NULL(destination);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_UrlEncode_Decode(destination, source, length, &decodedLength));
+
+    free(destination);
+}
+
+BEGIN_TEST_SUITE(iothub_client_url_encode_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_001: [ If source is NULL, IoTHubClient_UrlEncode_GetEncodedLength shall return 0. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_GetEncodedLength_with_NULL_source_returns_0)
+{
+    // arrange
+
+    // act
+    size_t result = IoTHubClient_UrlEncode_GetEncodedLength(NULL, 3);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_002: [ IoTHubClient_UrlEncode_GetEncodedLength shall return the number of characters needed to encode the first length characters of source: 1 for every unreserved character and 3 for every other one. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_GetEncodedLength_counts_3_for_reserved_characters)
+{
+    // arrange
+
+    // act
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubClient_UrlEncode_GetEncodedLength("", 0));
+    ASSERT_ARE_EQUAL(size_t, 4, IoTHubClient_UrlEncode_GetEncodedLength("a-._~", 4));
+    ASSERT_ARE_EQUAL(size_t, 5, IoTHubClient_UrlEncode_GetEncodedLength("a b", 3));
+    ASSERT_ARE_EQUAL(size_t, 9, IoTHubClient_UrlEncode_GetEncodedLength("&=/", 3));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_003: [ If destination is NULL, or source is NULL while length is not 0, IoTHubClient_UrlEncode_Encode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Encode_with_NULL_destination_fails)
+{
+    // arrange
+
+    // act
+    int result = IoTHubClient_UrlEncode_Encode(NULL, "a", 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_003: [ If destination is NULL, or source is NULL while length is not 0, IoTHubClient_UrlEncode_Encode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Encode_with_NULL_source_and_non_zero_length_fails)
+{
+    // arrange
+    char destination[3];
+
+    // act
+    int result = IoTHubClient_UrlEncode_Encode(destination, NULL, 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_004: [ IoTHubClient_UrlEncode_Encode shall write the IoTHubClient_UrlEncode_GetEncodedLength(source, length) characters of the encoding of source at destination, using upper case hexadecimal digits and without a terminating '\0'. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Encode_leaves_unreserved_characters_alone)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_encodes_to("AZaz09-._~", "AZaz09-._~");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_004: [ IoTHubClient_UrlEncode_Encode shall write the IoTHubClient_UrlEncode_GetEncodedLength(source, length) characters of the encoding of source at destination, using upper case hexadecimal digits and without a terminating '\0'. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Encode_escapes_reserved_characters)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_encodes_to("$.to", "%24.to");
+    assert_encodes_to("a b&c=d/e", "a%20b%26c%3Dd%2Fe");
+    assert_encodes_to("\xC3\xA9", "%C3%A9");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_005: [ If destination or decodedLength is NULL, or source is NULL while length is not 0, IoTHubClient_UrlEncode_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Decode_with_NULL_arguments_fails)
+{
+    // arrange
+    char destination[4];
+    size_t decodedLength;
+
+    // act
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_UrlEncode_Decode(NULL, "a", 1, &decodedLength));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_UrlEncode_Decode(destination, NULL, 1, &decodedLength));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubClient_UrlEncode_Decode(destination, "a", 1, NULL));
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_006: [ IoTHubClient_UrlEncode_Decode shall copy every character of source other than '%' as it is. ]*/
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_009: [ On success IoTHubClient_UrlEncode_Decode shall set decodedLength to the number of characters written at destination, without a terminating '\0', and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Decode_copies_plain_characters)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decodes_to("", "");
+    assert_decodes_to("propName", "propName");
+    assert_decodes_to("a+b", "a+b");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_007: [ IoTHubClient_UrlEncode_Decode shall replace every '%' followed by two hexadecimal digits, in upper or lower case, by the byte they encode. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Decode_replaces_escape_sequences)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decodes_to("%24.to", "$.to");
+    assert_decodes_to("%2Fdevices%2fid", "/devices/id");
+    assert_decodes_to("a%20b%26c%3Dd", "a b&c=d");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_008: [ If a '%' is not followed by two hexadecimal digits, IoTHubClient_UrlEncode_Decode shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Decode_with_invalid_escape_sequence_fails)
+{
+    // arrange
+
+    // act
+    // assert
+    assert_decode_fails("%");
+    assert_decode_fails("abc%2");
+    assert_decode_fails("%G0");
+    assert_decode_fails("%0x");
+}
+
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_004: [ IoTHubClient_UrlEncode_Encode shall write the IoTHubClient_UrlEncode_GetEncodedLength(source, length) characters of the encoding of source at destination, using upper case hexadecimal digits and without a terminating '\0'. ]*/
+/* Tests_SRS_IOTHUBCLIENT_URL_ENCODE_41_007: [ IoTHubClient_UrlEncode_Decode shall replace every '%' followed by two hexadecimal digits, in upper or lower case, by the byte they encode. ]*/
+TEST_FUNCTION(IoTHubClient_UrlEncode_Decode_reverses_Encode_for_every_byte)
+{
+    // arrange
+    char source[255];
+    char encoded[3 * 255];
+    char decoded[3 * 255];
+    size_t decodedLength = 0;
+    size_t i;
+    for (i = 0; i < sizeof(source); i++)
+    {
+        source[i] = (char)(i + 1);
+    }
+
+    // act
+    size_t encodedLength = IoTHubClient_UrlEncode_GetEncodedLength(source, sizeof(source));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubClient_UrlEncode_Encode(encoded, source, sizeof(source)));
+    int result = IoTHubClient_UrlEncode_Decode(decoded, encoded, encodedLength, &decodedLength);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(source), decodedLength);
+    ASSERT_IS_TRUE(memcmp(source, decoded, sizeof(source)) == 0);
+}
+
+END_TEST_SUITE(iothub_client_url_encode_ut)
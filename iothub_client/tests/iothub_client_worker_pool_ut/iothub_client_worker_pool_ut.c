@@ -0,0 +1,753 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+#include <string.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_worker_pool_private.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void real_DList_InitializeListHead(PDLIST_ENTRY listHead);
+    int real_DList_IsListEmpty(const PDLIST_ENTRY listHead);
+    void real_DList_InsertTailList(PDLIST_ENTRY listHead, PDLIST_ENTRY listEntry);
+    void real_DList_InsertHeadList(PDLIST_ENTRY listHead, PDLIST_ENTRY listEntry);
+    void real_DList_AppendTailList(PDLIST_ENTRY listHead, PDLIST_ENTRY ListToAppend);
+    int real_DList_RemoveEntryList(PDLIST_ENTRY listEntry);
+    PDLIST_ENTRY real_DList_RemoveHeadList(PDLIST_ENTRY listHead);
+
+    extern const size_t IoTHubClient_WorkerPool_ThreadTerminationOffset;
+
+#ifdef __cplusplus
+}
+#endif
+
+static TEST_MUTEX_HANDLE test_serialize_mutex;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#define TEST_MAX_THREADS 4
+
+static LOCK_HANDLE TEST_LOCK_HANDLE = (LOCK_HANDLE)0x4201;
+static COND_HANDLE TEST_COND_HANDLE = (COND_HANDLE)0x4202;
+static TICK_COUNTER_HANDLE TEST_TICK_COUNTER_HANDLE = (TICK_COUNTER_HANDLE)0x4203;
+static THREAD_HANDLE TEST_THREAD_HANDLE = (THREAD_HANDLE)0x4204;
+static void* TEST_CONTEXT = (void*)0x4205;
+static COND_HANDLE TEST_ITEM_COND_HANDLE = (COND_HANDLE)0x4206;
+
+static THREAD_START_FUNC g_thread_func[TEST_MAX_THREADS];
+static void* g_thread_func_arg[TEST_MAX_THREADS];
+static size_t g_threads_created;
+static size_t g_fail_thread_create_at;
+
+static IOTHUB_CLIENT_WORKER_POOL_HANDLE g_worker_pool;
+static tickcounter_ms_t g_current_ms;
+static int g_last_wait_timeout;
+static size_t g_wait_count;
+
+static size_t g_do_work_count;
+static void* g_do_work_last_context;
+static tickcounter_ms_t g_do_work_run_after;
+static WORKER_POOL_ITEM_HANDLE g_item_to_signal_while_running;
+static WORKER_POOL_ITEM_HANDLE g_item_to_remove_while_running;
+
+static THREADAPI_RESULT my_ThreadAPI_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg)
+{
+    THREADAPI_RESULT result;
+    if ((g_fail_thread_create_at != 0) && (g_threads_created + 1 == g_fail_thread_create_at))
+    {
+        result = THREADAPI_ERROR;
+    }
+    else
+    {
+        *threadHandle = TEST_THREAD_HANDLE;
+        g_thread_func[g_threads_created] = func;
+        g_thread_func_arg[g_threads_created] = arg;
+        g_threads_created++;
+        result = THREADAPI_OK;
+    }
+    return result;
+}
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = g_current_ms;
+    return 0;
+}
+
+static COND_RESULT my_Condition_Wait(COND_HANDLE handle, LOCK_HANDLE lock, int timeout_milliseconds)
+{
+    COND_RESULT result;
+    (void)lock;
+    if (handle == TEST_ITEM_COND_HANDLE)
+    {
+        /*the run being waited for cannot complete while the test runs it on this thread*/
+        result = COND_ERROR;
+    }
+    else
+    {
+        g_last_wait_timeout = timeout_milliseconds;
+        g_wait_count++;
+        *(int*)(((char*)g_worker_pool) + IoTHubClient_WorkerPool_ThreadTerminationOffset) = 1; /*tell the thread to stop*/
+        result = COND_OK;
+    }
+    return result;
+}
+
+static tickcounter_ms_t test_do_work(void* context)
+{
+    g_do_work_count++;
+    g_do_work_last_context = context;
+    if (g_item_to_signal_while_running != NULL)
+    {
+        WORKER_POOL_ITEM_HANDLE item = g_item_to_signal_while_running;
+        g_item_to_signal_while_running = NULL;
+        IoTHubClient_WorkerPool_Signal(item);
+    }
+    if (g_item_to_remove_while_running != NULL)
+    {
+        WORKER_POOL_ITEM_HANDLE item = g_item_to_remove_while_running;
+        g_item_to_remove_while_running = NULL;
+        IoTHubClient_WorkerPool_Remove(item);
+    }
+    return g_do_work_run_after;
+}
+
+static void run_worker(size_t index)
+{
+    *(int*)(((char*)g_worker_pool) + IoTHubClient_WorkerPool_ThreadTerminationOffset) = 0;
+    (void)g_thread_func[index](g_thread_func_arg[index]);
+}
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+BEGIN_TEST_SUITE(iothub_client_worker_pool_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+
+    test_serialize_mutex = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(test_serialize_mutex);
+
+    umock_c_init(on_umock_c_error);
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(THREAD_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(THREAD_START_FUNC, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(THREADAPI_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PDLIST_ENTRY, void*);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock_Init, NULL);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock, LOCK_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Condition_Init, TEST_COND_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Condition_Init, NULL);
+    REGISTER_GLOBAL_MOCK_RETURN(Condition_Post, COND_OK);
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Wait, my_Condition_Wait);
+
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, TEST_TICK_COUNTER_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(tickcounter_create, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
+
+    REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Create, my_ThreadAPI_Create);
+    REGISTER_GLOBAL_MOCK_RETURN(ThreadAPI_Join, THREADAPI_OK);
+
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InitializeListHead, real_DList_InitializeListHead);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_IsListEmpty, real_DList_IsListEmpty);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InsertTailList, real_DList_InsertTailList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InsertHeadList, real_DList_InsertHeadList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_AppendTailList, real_DList_AppendTailList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_RemoveEntryList, real_DList_RemoveEntryList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_RemoveHeadList, real_DList_RemoveHeadList);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(test_serialize_mutex);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(test_serialize_mutex))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+    umock_c_reset_all_calls();
+
+    memset(g_thread_func, 0, sizeof(g_thread_func));
+    memset(g_thread_func_arg, 0, sizeof(g_thread_func_arg));
+    g_threads_created = 0;
+    g_fail_thread_create_at = 0;
+    g_worker_pool = NULL;
+    g_current_ms = 0;
+    g_last_wait_timeout = -1;
+    g_wait_count = 0;
+    g_do_work_count = 0;
+    g_do_work_last_context = NULL;
+    g_do_work_run_after = 10;
+    g_item_to_signal_while_running = NULL;
+    g_item_to_remove_while_running = NULL;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(test_serialize_mutex);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_001: [ If threadCount is 0, IoTHubClient_WorkerPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Create_with_0_threads_fails)
+{
+    // arrange
+
+    // act
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE result = IoTHubClient_WorkerPool_Create(0);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_002: [ IoTHubClient_WorkerPool_Create shall allocate the pool, a lock, a condition, a tick counter and threadCount workers. ]*/
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_004: [ IoTHubClient_WorkerPool_Create shall start threadCount threads by calling ThreadAPI_Create. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Create_succeeds)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE result = IoTHubClient_WorkerPool_Create(2);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, 2, g_threads_created);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(result);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_003: [ If any of the allocations fail, IoTHubClient_WorkerPool_Create shall free everything it allocated and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Create_tickcounter_create_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create())
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE result = IoTHubClient_WorkerPool_Create(2);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_005: [ If starting any of the threads fails, IoTHubClient_WorkerPool_Create shall stop and join the threads already started, free all resources and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Create_second_thread_fails_joins_first)
+{
+    // arrange
+    g_fail_thread_create_at = 2;
+
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_res();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE result = IoTHubClient_WorkerPool_Create(2);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_006: [ If workerPool is NULL, IoTHubClient_WorkerPool_Destroy shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Destroy_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_WorkerPool_Destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_007: [ IoTHubClient_WorkerPool_Destroy shall signal all the threads to stop and join them. ]*/
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_008: [ IoTHubClient_WorkerPool_Destroy shall detach any item still attached to the pool, without freeing it, and free all the pool resources. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Destroy_joins_threads_and_detaches_items)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(2);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_res();
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_res();
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_009: [ If workerPool or doWork is NULL, IoTHubClient_WorkerPool_Add shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Add_NULL_doWork_fails)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    umock_c_reset_all_calls();
+
+    // act
+    WORKER_POOL_ITEM_HANDLE result = IoTHubClient_WorkerPool_Add(worker_pool, NULL, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_010: [ If any failure occurs, IoTHubClient_WorkerPool_Add shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Add_Lock_fails)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    umock_c_reset_all_calls();
+
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE))
+        .SetReturn(LOCK_ERROR);
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    WORKER_POOL_ITEM_HANDLE result = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_011: [ IoTHubClient_WorkerPool_Add shall assign the item to the workers in a round robin fashion and queue it to run as soon as possible. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Add_succeeds)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    umock_c_reset_all_calls();
+
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    // act
+    WORKER_POOL_ITEM_HANDLE result = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(result);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_011: [ IoTHubClient_WorkerPool_Add shall assign the item to the workers in a round robin fashion and queue it to run as soon as possible. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_worker_runs_item_and_waits_until_next_run)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_current_ms();
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*nothing scheduled*/
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*the item is ready*/
+    EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_current_ms();
+    EXPECTED_CALL(DList_InsertHeadList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_current_ms();
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*the item is scheduled but not due*/
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*nothing ready*/
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, TEST_LOCK_HANDLE, 10));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    // act
+    run_worker(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_do_work_count);
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, g_do_work_last_context);
+    ASSERT_ARE_EQUAL(int, 10, g_last_wait_timeout);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+TEST_FUNCTION(IoTHubClient_WorkerPool_worker_runs_due_item_again)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    run_worker(0);
+    g_current_ms = 10;
+
+    // act
+    run_worker(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_do_work_count);
+    ASSERT_ARE_EQUAL(int, 10, g_last_wait_timeout);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+TEST_FUNCTION(IoTHubClient_WorkerPool_idle_worker_steals_item_of_another_worker)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(2);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT); /*queued on worker 0*/
+    g_worker_pool = worker_pool;
+
+    // act
+    run_worker(1);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_do_work_count);
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, g_do_work_last_context);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+TEST_FUNCTION(IoTHubClient_WorkerPool_worker_with_no_items_waits_forever)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    g_worker_pool = worker_pool;
+
+    // act
+    run_worker(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, g_do_work_count);
+    ASSERT_ARE_EQUAL(int, 0, g_last_wait_timeout);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_012: [ If item is NULL, IoTHubClient_WorkerPool_Signal shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Signal_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_WorkerPool_Signal(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_013: [ If the item is waiting for its next run, IoTHubClient_WorkerPool_Signal shall queue it to run as soon as possible. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Signal_scheduled_item_runs_it_right_away)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    run_worker(0);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    // act
+    IoTHubClient_WorkerPool_Signal(item);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    run_worker(0); /*g_current_ms did not move, the item only runs because it was signalled*/
+    ASSERT_ARE_EQUAL(size_t, 2, g_do_work_count);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_014: [ If the item is running, IoTHubClient_WorkerPool_Signal shall make it run again as soon as the current run completes. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Signal_running_item_runs_it_again)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    g_item_to_signal_while_running = item;
+
+    // act
+    run_worker(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_do_work_count);
+    ASSERT_ARE_EQUAL(size_t, 1, g_wait_count);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_015: [ If item is NULL, IoTHubClient_WorkerPool_Remove shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Remove_NULL_does_nothing)
+{
+    // arrange
+
+    // act
+    IoTHubClient_WorkerPool_Remove(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_017: [ IoTHubClient_WorkerPool_Remove shall detach the item from the pool and free it. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Remove_scheduled_item_succeeds)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    run_worker(0);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(item));
+
+    // act
+    IoTHubClient_WorkerPool_Remove(item);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    run_worker(0); /*the item is no longer run*/
+    ASSERT_ARE_EQUAL(size_t, 1, g_do_work_count);
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_021: [ If the pool of the item was destroyed, IoTHubClient_WorkerPool_Signal shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Signal_after_Destroy_does_nothing)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubClient_WorkerPool_Signal(item);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Remove(item);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_019: [ If the pool of the item was already destroyed, IoTHubClient_WorkerPool_Remove shall only free the item. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Remove_after_Destroy_frees_the_item)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(item));
+
+    // act
+    IoTHubClient_WorkerPool_Remove(item);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_016: [ If the item is running, IoTHubClient_WorkerPool_Remove shall create a condition for the item and wait on it, with the pool lock, until the run completes. ]*/
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_018: [ When the run of an item being removed completes, the worker shall post the condition IoTHubClient_WorkerPool_Remove waits on. ]*/
+/* Tests_SRS_IOTHUBCLIENT_WORKER_POOL_41_020: [ If creating the condition or waiting on it fails, IoTHubClient_WorkerPool_Remove shall leave the item to the worker running it and not free it. ]*/
+TEST_FUNCTION(IoTHubClient_WorkerPool_Remove_running_item_waits_on_a_condition)
+{
+    // arrange
+    IOTHUB_CLIENT_WORKER_POOL_HANDLE worker_pool = IoTHubClient_WorkerPool_Create(1);
+    WORKER_POOL_ITEM_HANDLE item = IoTHubClient_WorkerPool_Add(worker_pool, test_do_work, TEST_CONTEXT);
+    g_worker_pool = worker_pool;
+    g_item_to_remove_while_running = item;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_current_ms();
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*nothing scheduled*/
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*the item is ready*/
+    EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)); /*IoTHubClient_WorkerPool_Remove, called by the running item*/
+    STRICT_EXPECTED_CALL(Condition_Init())
+        .SetReturn(TEST_ITEM_COND_HANDLE);
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_ITEM_COND_HANDLE, TEST_LOCK_HANDLE, 0));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE)); /*the run completed*/
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_ITEM_COND_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_current_ms();
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, TEST_LOCK_HANDLE, 0));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    // act
+    run_worker(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_do_work_count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_WorkerPool_Destroy(worker_pool);
+    my_gballoc_free(item); /*left to the worker by the failed wait*/
+}
+
+END_TEST_SUITE(iothub_client_worker_pool_ut)
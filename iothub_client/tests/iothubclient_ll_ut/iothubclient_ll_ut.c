@@ -43,12 +43,15 @@ void* my_gballoc_realloc(void* ptr, size_t size)
 
 #include "iothub_client_version.h"
 #include "iothub_message.h"
+#include "iothub_client_persistent_queue.h"
 
 #undef ENABLE_MOCKS
 
 #include "iothub_transport_ll.h"
 #include "iothub_client_ll.h"
 #include "iothub_client_private.h"
+#include "iothub_client_options.h"
+#include "iothub_client_record_pool.h"
 
 #define ENABLE_MOCKS
 
@@ -157,14 +160,36 @@ static const char* TEST_STRING_VALUE = "Test string value";
 #define TEST_RETRY_TIMEOUT_SECS             60
 
 #define TEST_METHOD_ID                      (METHOD_HANDLE)0x61
+#define TEST_PERSISTENT_QUEUE_HANDLE        (PERSISTENT_QUEUE_HANDLE)0x62
+#define TEST_PERSISTENT_QUEUE_DIRECTORY     "theQueueDirectory"
 
 static const char* TEST_METHOD_NAME = "method_name";
 static const char* TEST_CHAR = "TestChar";
 static tickcounter_ms_t g_current_ms = 0;
+static PDLIST_ENTRY g_waitingToSend = NULL; /*the list IoTHubClient_LL handed to the transport*/
 static const char* TEST_DEVICE_METHOD_RESPONSE = "{ device:method, response:true}";
 
 static size_t g_fail_constbuffer_create;
 
+/*records the calls to the event confirmation batch callback, the array it gets is only valid during the call*/
+#define TEST_MAX_BATCH_CALLS 4
+#define TEST_MAX_BATCH_CONFIRMATIONS 40
+static size_t g_batch_call_count;
+static size_t g_batch_sizes[TEST_MAX_BATCH_CALLS];
+static IOTHUB_CLIENT_EVENT_CONFIRMATION g_batch_confirmations[TEST_MAX_BATCH_CALLS][TEST_MAX_BATCH_CONFIRMATIONS];
+static void* g_batch_context;
+
+static void test_event_confirmation_batch_callback(const IOTHUB_CLIENT_EVENT_CONFIRMATION* confirmations, size_t confirmationCount, void* userContextCallback)
+{
+    if ((g_batch_call_count < TEST_MAX_BATCH_CALLS) && (confirmationCount <= TEST_MAX_BATCH_CONFIRMATIONS))
+    {
+        g_batch_sizes[g_batch_call_count] = confirmationCount;
+        memcpy(g_batch_confirmations[g_batch_call_count], confirmations, confirmationCount * sizeof(IOTHUB_CLIENT_EVENT_CONFIRMATION));
+    }
+    g_batch_context = userContextCallback;
+    g_batch_call_count++;
+}
+
 const unsigned char TEST_REPORTED_STATE[] = { 0x01, 0x02, 0x03 };
 const size_t TEST_REPORTED_SIZE = sizeof(TEST_REPORTED_STATE) / sizeof(TEST_REPORTED_STATE[0]);
 
@@ -311,7 +336,7 @@ static IOTHUB_DEVICE_HANDLE my_FAKE_IoTHubTransport_Register(TRANSPORT_LL_HANDLE
     (void)handle;
     (void)device;
     (void)iotHubClientHandle;
-    (void)waitingToSend;
+    g_waitingToSend = waitingToSend;
     return (IOTHUB_DEVICE_HANDLE)my_gballoc_malloc(1);
 }
 
@@ -426,11 +451,14 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_TRANSPORT_PROVIDER, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_DEVICE_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUBMESSAGE_CONTENT_TYPE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_RESULT, int);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_DEVICE_TWIN_STATE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(CONSTBUFFER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_IDENTITY_TYPE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(BUFFER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(METHOD_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PERSISTENT_QUEUE_HANDLE, void*);
 
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_RESULT, int);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_PROCESS_ITEM_RESULT, int);
@@ -484,6 +512,14 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     REGISTER_GLOBAL_MOCK_RETURN(deviceMethodCallback, 200);
 
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_PersistentQueue_Create, TEST_PERSISTENT_QUEUE_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_PersistentQueue_Create, NULL);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_PersistentQueue_Append, 0);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_PersistentQueue_Append, __LINE__);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_PersistentQueue_MarkDone, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_PersistentQueue_GetNextRecovered, NULL);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_PersistentQueue_Flush, 0);
+
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_Clone, (IOTHUB_MESSAGE_HANDLE)0x44);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubMessage_Clone, NULL);
 
@@ -546,6 +582,8 @@ TEST_FUNCTION_INITIALIZE(method_init)
 {
     TEST_MUTEX_ACQUIRE(test_serialize_mutex);
     umock_c_reset_all_calls();
+    g_batch_call_count = 0;
+    g_batch_context = NULL;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -1429,6 +1467,9 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_succeeds)
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
 
@@ -1450,6 +1491,61 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_succeeds)
     IoTHubClient_LL_Destroy(handle);
 }
 
+/*Tests_SRS_IOTHUBCLIENT_LL_41_008: [ IoTHubClient_LL_SendEventAsync_TakeOwnership shall add eventMessageHandle itself to waitingToSend, without cloning it. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_010: [ Otherwise eventMessageHandle shall be destroyed by IoTHubClient_LL once the message has been sent, has timed out or the handle is destroyed, and IoTHubClient_LL_SendEventAsync_TakeOwnership shall return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_TakeOwnership_does_not_clone_the_message)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_TakeOwnership(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_41_007: [ IoTHubClient_LL_SendEventAsync_TakeOwnership shall validate its arguments and fail the same way IoTHubClient_LL_SendEventAsync does. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_009: [ If IoTHubClient_LL_SendEventAsync_TakeOwnership fails, the ownership of eventMessageHandle shall remain with the caller. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_TakeOwnership_fails_does_not_destroy_the_message)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(NULL);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_TakeOwnership(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
 /*Tests_SRS_IOTHUBCLIENT_LL_02_010: [IoTHubClient_LL_Destroy shall call the underlaying layer's _Destroy function and shall free the resources allocated by IoTHubClient (if any).] */
 /*Tests_SRS_IOTHUBCLIENT_LL_02_033: [Otherwise, IoTHubClient_LL_Destroy shall complete all the event message callbacks that are in the waitingToSend list with the result IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY.] */
 TEST_FUNCTION(IoTHubClient_LL_Destroy_after_sendEvent_succeeds)
@@ -1512,6 +1608,9 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails)
     (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &thisIsNotZero); /*this forces _SendEventAsync to query the currentTime. If that fails, _SendEvent should fail as well*/
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
 
@@ -1529,7 +1628,7 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails)
     umock_c_negative_tests_snapshot();
 
     // act
-    size_t calls_cannot_fail[] = { 3 };
+    size_t calls_cannot_fail[] = { 0, 1, 5 }; /*the payload size is best effort*/
     size_t count = umock_c_negative_tests_call_count();
     for (size_t index = 0; index < count; index++)
     {
@@ -1630,7 +1729,7 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_1_items_with_callback_succeeds)
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     DLIST_ENTRY temp;
     DList_InitializeListHead(&temp);
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
     one->callback = eventConfirmationCallback;
     one->context = (void*)1;
@@ -1641,7 +1740,7 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_1_items_with_callback_succeeds)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying one*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1665,19 +1764,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback_succeeds)
     DLIST_ENTRY temp;
     DList_InitializeListHead(&temp);
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
     one->callback = eventConfirmationCallback;
     one->context = (void*)1;
     DList_InsertTailList(&temp, &(one->entry));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
     two->callback = eventConfirmationCallback;
     two->context = (void*)2;
     DList_InsertTailList(&temp, &(two->entry));
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
     three->callback = eventConfirmationCallback;
     three->context = (void*)3;
@@ -1689,19 +1788,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback_succeeds)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying one*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)2));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying two*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying three*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1725,19 +1824,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback__but_batch
     DLIST_ENTRY temp;
     DList_InitializeListHead(&temp);
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
     one->callback = eventConfirmationCallback;
     one->context = (void*)1;
     DList_InsertTailList(&temp, &(one->entry));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
     two->callback = eventConfirmationCallback;
     two->context = (void*)2;
     DList_InsertTailList(&temp, &(two->entry));
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
     three->callback = eventConfirmationCallback;
     three->context = (void*)3;
@@ -1750,19 +1849,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback__but_batch
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)1));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying one*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)2));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying two*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying three*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -2055,19 +2154,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_without_callback_suc
     DLIST_ENTRY temp;
     DList_InitializeListHead(&temp);
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
     one->callback = test_event_confirmation_callback;
     one->context = (void*)1;
     DList_InsertTailList(&temp, &(one->entry));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
     two->callback = NULL;
     two->context = NULL;
     DList_InsertTailList(&temp, &(two->entry));
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
     three->callback = test_event_confirmation_callback;
     three->context = (void*)3;
@@ -2079,18 +2178,18 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_without_callback_suc
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying one*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying two*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying three*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -2114,19 +2213,19 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_with_callback_but_ba
     DLIST_ENTRY temp;
     DList_InitializeListHead(&temp);
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
     one->callback = NULL;
     one->context = NULL;
     DList_InsertTailList(&temp, &(one->entry));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
     two->callback = NULL;
     two->context = NULL;
     DList_InsertTailList(&temp, &(two->entry));
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
     three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
     three->callback = test_event_confirmation_callback;
     three->context = (void*)3;
@@ -2137,18 +2236,18 @@ TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_with_callback_but_ba
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying one*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying two*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*destroying three*/
 
     STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -2626,1194 +2725,2389 @@ TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_can_be_reverted_back_to_z
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_calls_timeout_callback)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_012: [ OPTION_MESSAGE_POOL_SIZE - IoTHubClient_LL_SetOption shall replace the message pool with one holding value records (a pointer to size_t); 0 disables the pool. Records still in use are returned to the pool they came from. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_014: [ OPTION_MESSAGE_POOL_SIZE shall also be passed to the transport, which may pool its own per message records; the transport not supporting the option is not an error. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_succeeds)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 1 messages that will expire*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    size_t poolSize = 4;
     umock_c_reset_all_calls();
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
-
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-        .IgnoreArgument(1);
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, &poolSize))
+        .IgnoreArgument_handle()
+        .SetReturn(IOTHUB_CLIENT_INVALID_ARG);
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_042: [ By default, messages shall not timeout. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_defaults_to_zero)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_014: [ OPTION_MESSAGE_POOL_SIZE shall also be passed to the transport, which may pool its own per message records; the transport not supporting the option is not an error. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_succeeds_when_the_transport_fails_the_option)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-
-    /*send 1 messages that will expire*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    size_t poolSize = 4;
     umock_c_reset_all_calls();
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-
-    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => would result in timeout, except the fact that messageTimeout option has never been set, therefore no timeout shall be called*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, &poolSize))
+        .IgnoreArgument_handle()
+        .SetReturn(IOTHUB_CLIENT_ERROR);
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_only_removes_the_message_if_it_has_NULL_callback)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_013: [ If creating the message pool fails, IoTHubClient_LL_SetOption shall keep the current pool and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_fails_when_creating_the_pool_fails)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 1 messages that will expire*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, NULL, NULL); /*this is a message with a NULL callback*/
+    size_t poolSize = 4;
     umock_c_reset_all_calls();
 
-    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
-
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-        .IgnoreArgument(1);
-
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_when_exactly_on_the_edge_does_not_call_the_callback) /*because "more"*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_015: [ If iotHubClientHandle or statistics is NULL, IoTHubClient_LL_GetMessagePoolStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetMessagePoolStatistics_with_NULL_handle_fails)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+    IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS statistics;
 
-    /*send 1 messages that will expire*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
-    umock_c_reset_all_calls();
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetMessagePoolStatistics(NULL, &statistics);
 
-    tickcounter_ms_t eleven = 11; /*11 = 10 (receive time) + 1 (timeout) => NO timeout*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &eleven, sizeof(eleven));
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+/*Tests_SRS_IOTHUBCLIENT_LL_41_016: [ If no message pool is configured, IoTHubClient_LL_GetMessagePoolStatistics shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetMessagePoolStatistics_without_a_pool_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS statistics;
+    umock_c_reset_all_calls();
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetMessagePoolStatistics(handle, &statistics);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_with_timeouts_at_11_and_12_calls_1_timeout) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_011: [ IoTHubClient_LL_SendEventAsync shall take the record added to waitingToSend from the message pool if one was configured with OPTION_MESSAGE_POOL_SIZE, and allocate it otherwise. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_017: [ Otherwise IoTHubClient_LL_GetMessagePoolStatistics shall fill statistics with the capacity, records in use, hits and misses of the message pool and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_takes_the_record_from_the_message_pool)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS statistics;
+    size_t poolSize = 4;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
     (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
-
-    tickcounter_ms_t two = 2;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &two);
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
     umock_c_reset_all_calls();
 
-    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetMessagePoolStatistics(handle, &statistics);
 
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-        .IgnoreArgument(1);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 4, statistics.capacity);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.inUse);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.misses);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
-    /*because we're at time = 12 in this test, the second message is untouched*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_029: [ If value is not a IOTHUB_CLIENT_QUEUE_FULL_POLICY, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_send_queue_full_policy_with_invalid_value_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = (IOTHUB_CLIENT_QUEUE_FULL_POLICY)42;
+    umock_c_reset_all_calls();
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_044: [ Messages already delivered to IoTHubClient_LL shall not have their timeouts modified by a new call to IoTHubClient_LL_SetOption. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_with_timeouts_at_11_and_12_calls_2_timeouts) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_018: [ If iotHubClientHandle or status is NULL, IoTHubClient_LL_GetSendQueueStatus shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetSendQueueStatus_with_NULL_handle_fails)
 {
     //arrange
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
 
-    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendQueueStatus(NULL, &status);
 
-    tickcounter_ms_t two = 2;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &two);
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
 
+/*Tests_SRS_IOTHUBCLIENT_LL_41_018: [ If iotHubClientHandle or status is NULL, IoTHubClient_LL_GetSendQueueStatus shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetSendQueueStatus_with_NULL_status_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendQueueStatus(handle, NULL);
 
-    tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
-
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
-
-    timeIsNow = 13; /*13 > 10 (receive time) + 2 (timeout) => timeout!!!*/
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
-
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)(TEST_DEVICEMESSAGE_HANDLE_2))); /*calling the callback*/
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-        .IgnoreArgument(1);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
+/*Tests_SRS_IOTHUBCLIENT_LL_41_019: [ Otherwise IoTHubClient_LL_GetSendQueueStatus shall fill status with the number of messages accepted by IoTHubClient_LL_SendEventAsync whose confirmation callback has not been called yet and the sum of their payload sizes, and return IOTHUB_CLIENT_OK. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_021: [ IoTHubClient_LL_SendEventAsync shall add the payload size of eventMessageHandle to the send queue status. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_adds_the_message_to_the_send_queue_status)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    size_t eleven = 11;
+    umock_c_reset_all_calls();
 
-    /*because we're at time = 13 in this test, the second message times out too*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&eleven, sizeof(eleven));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE))
+        .SetReturn(IOTHUBMESSAGE_STRING);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetString(TEST_MESSAGE_HANDLE))
+        .SetReturn("abc");
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     //act
-    IoTHubClient_LL_DoWork(handle);
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result1 = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendQueueStatus(handle, &status);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 2, status.messageCount);
+    ASSERT_ARE_EQUAL(size_t, 14, status.byteCount);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_043: [ Calling IoTHubClient_LL_SetOption with value set to "0" shall disable the timeout mechanism for all new messages. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_044: [ Messages already delivered to IoTHubClient_LL shall not have their timeouts modified by a new call to IoTHubClient_LL_SetOption. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_one_with_timeout_one_without_call_1_callback) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_020: [ When the confirmation callback of a message is called, for whatever reason, the message and its payload size shall be removed from the send queue status. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_removes_the_message_from_the_send_queue_status)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
-
-    tickcounter_ms_t zero = 0;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &zero); /*essentially no timeout*/
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
-
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    DLIST_ENTRY completed;
+    size_t eleven = 11;
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&eleven, sizeof(eleven));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    /*the transport takes the message out of waitingToSend, like it does when sending it*/
+    DList_InitializeListHead(&completed);
+    DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
     umock_c_reset_all_calls();
 
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-
-    {/*this scope happen in the first _DoWork call*/
-        tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
-        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
-
-        STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
-        STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
-            .IgnoreArgument(1);
-    }
-
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
-
-    {/*this scope happen in the second _DoWork call*/
-        tickcounter_ms_t timeIsNow = 999999999UL; /*some very big number*/
-        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
-    }
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
 
     //act
-    IoTHubClient_LL_DoWork(handle);
-    IoTHubClient_LL_DoWork(handle);
+    IoTHubClient_LL_SendComplete(handle, &completed, IOTHUB_CLIENT_CONFIRMATION_OK);
 
     ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 0, status.messageCount);
+    ASSERT_ARE_EQUAL(size_t, 0, status.byteCount);
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_when_tickcounter_fails_in_do_work_no_timeout_callbacks_are_called) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_026: [ OPTION_SEND_QUEUE_MAX_MESSAGES - IoTHubClient_LL_SetOption shall limit the number of messages in the send queue to value (a pointer to size_t); 0 removes the limit. Messages already queued are not dropped. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_023: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_REJECT, or if all the queued messages have already been handed to the transport, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_send_queue_and_the_reject_policy_fails)
 {
     //arrange
-
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    tickcounter_ms_t one = 1;
-    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
-
-    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
-    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
-    "the message has been received at time=10*/
-    tickcounter_ms_t ten = 10;
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
-    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
-
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    size_t maxMessages = 1;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    {/*this scope happen in the _DoWork call*/
-        tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!! (well - normally - but here the code doesn't call any callbacks because time cannot be obtained*/
-        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow))
-            .SetReturn(__LINE__);
-    }
-
-    /*we don't care what happens in the Transport, so let's ignore all those calls*/
-    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     //act
-    IoTHubClient_LL_DoWork(handle);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
 
     ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 1, status.messageCount);
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-#ifndef DONT_USE_UPLOADTOBLOB
-/*Tests_SRS_IOTHUBCLIENT_LL_02_061: [ If iotHubClientHandle is NULL then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
-TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_handle_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_027: [ OPTION_SEND_QUEUE_MAX_BYTES - IoTHubClient_LL_SetOption shall limit the sum of the payload sizes of the messages in the send queue to value (a pointer to size_t); 0 removes the limit. Messages already queued are not dropped. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_022: [ If the payload of the message alone is larger than OPTION_SEND_QUEUE_MAX_BYTES, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL whatever the policy. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_message_larger_than_the_send_queue_fails)
 {
     //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxBytes = 10;
+    size_t eleven = 11;
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_BYTES, &maxBytes);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&eleven, sizeof(eleven));
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(NULL, "irrelevantFileName", (const unsigned char*)"a", 1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
-#endif
 
-#ifndef DONT_USE_UPLOADTOBLOB
-/*Tests_SRS_IOTHUBCLIENT_LL_02_062: [ If destinationFileName is NULL then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
-TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_fileName_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_028: [ OPTION_SEND_QUEUE_FULL_POLICY - IoTHubClient_LL_SetOption shall set what IoTHubClient_LL_SendEventAsync does when a message would exceed either limit of the send queue. value is a pointer to IOTHUB_CLIENT_QUEUE_FULL_POLICY. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_024: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST, IoTHubClient_LL_SendEventAsync shall drop the message at the head of waitingToSend until the new message fits. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_send_queue_and_the_drop_oldest_policy_drops_the_oldest_message)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(h, NULL, (const unsigned char*)"a", 1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 1, status.messageCount);
 
     ///cleanup
-    IoTHubClient_LL_Destroy(h);
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_063: [ If source is NULL and size is greater than 0 then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
-TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_source_and_size_greater_than_0_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_025: [ If the policy is IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY, IoTHubClient_LL_SendEventAsync shall drop the oldest of the messages in waitingToSend with the lowest priority until the new message fits. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_send_queue_and_the_drop_lowest_priority_policy_drops_the_lowest_priority_message)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 2;
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE))
+        .SetReturn(3);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(IGNORED_PTR_ARG))
+        .SetReturn(5);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(IGNORED_PTR_ARG))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(IGNORED_PTR_ARG))
+        .SetReturn(5);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(IGNORED_PTR_ARG))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, (void*)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(h, "someFileName.txt", NULL, 1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)3);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
-    IoTHubClient_LL_Destroy(h);
+    IoTHubClient_LL_Destroy(handle);
 }
-#endif 
 
-/* Tests_SRS_IOTHUBCLIENT_LL_10_016: [ Otherwise IoTHubClient_LL_SendReportedState shall succeed and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SendReportedState_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_030: [ If the new message has a lower priority than all the messages in waitingToSend, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_send_queue_and_the_lowest_priority_fails)
 {
     //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = IOTHUB_CLIENT_QUEUE_FULL_DROP_LOWEST_PRIORITY;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    setup_iothubclient_ll_sendreportedstate_mocks();
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(IGNORED_PTR_ARG))
+        .SetReturn(5);
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
+    ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_10_012: [ IoTHubClient_LL_SendReportedState shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL. ] */
-TEST_FUNCTION(IoTHubClient_LL_SendReportedState_NULL_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_053: [ If dropping all the messages in waitingToSend that the policy allows to drop would still not make room for the new message, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_QUEUE_FULL without dropping any message. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_when_the_messages_handed_to_the_transport_fill_the_send_queue_fails_without_dropping)
 {
     //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    DLIST_ENTRY inFlight;
+    size_t maxBytes = 10;
+    size_t eight = 8;
+    size_t two = 2;
+    size_t five = 5;
+    IOTHUB_CLIENT_QUEUE_FULL_POLICY policy = IOTHUB_CLIENT_QUEUE_FULL_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_MAX_BYTES, &maxBytes);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_SEND_QUEUE_FULL_POLICY, &policy);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&eight, sizeof(eight));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&two, sizeof(two));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+
+    /*the transport is sending the first message, dropping the second one only gives back 2 of the 5 bytes needed*/
+    DList_InitializeListHead(&inFlight);
+    DList_InsertTailList(&inFlight, DList_RemoveHeadList(g_waitingToSend));
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_size(&five, sizeof(five));
+
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(NULL, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)3);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 2, status.messageCount);
+    ASSERT_ARE_EQUAL(size_t, 10, status.byteCount);
 
     ///cleanup
+    DList_InsertTailList(g_waitingToSend, DList_RemoveHeadList(&inFlight));
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_10_013: [ IoTHubClient_LL_SendReportedState shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter reportedState is NULL] */
-TEST_FUNCTION(IoTHubClient_LL_SendReportedState_reported_state_NULL_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_calls_timeout_callback)
 {
     //arrange
+
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 1 messages that will expire*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
+        .IgnoreArgument(1);
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, NULL, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    IoTHubClient_LL_DoWork(handle);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-TEST_FUNCTION(IoTHubClient_LL_SendReportedState_reported_size_0_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_02_042: [ By default, messages shall not timeout. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_defaults_to_zero)
 {
     //arrange
+
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+
+    /*send 1 messages that will expire*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+
+    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => would result in timeout, except the fact that messageTimeout option has never been set, therefore no timeout shall be called*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, 0, iothub_reported_state_callback, NULL);
+    IoTHubClient_LL_DoWork(handle);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_10_015: [ If any error is encountered IoTHubClient_LL_SendReportedState shall return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SendReportedState_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_only_removes_the_message_if_it_has_NULL_callback)
 {
     //arrange
-    int negativeTestsInitResult = umock_c_negative_tests_init();
-    ASSERT_ARE_EQUAL(int, 0, negativeTestsInitResult);
 
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 1 messages that will expire*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, NULL, NULL); /*this is a message with a NULL callback*/
     umock_c_reset_all_calls();
 
-    setup_iothubclient_ll_sendreportedstate_mocks();
+    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
 
-    umock_c_negative_tests_snapshot();
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
+        .IgnoreArgument(1);
 
-    size_t calls_cannot_fail[] = { 4 };
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
-    size_t count = umock_c_negative_tests_call_count();
-    for (size_t index = 0; index < count; index++)
-    {
-        if (should_skip_index(index, calls_cannot_fail, sizeof(calls_cannot_fail) / sizeof(calls_cannot_fail[0])) != 0)
-        {
-            continue;
-        }
-        umock_c_negative_tests_reset();
-        umock_c_negative_tests_fail_call(index);
+    //act
+    IoTHubClient_LL_DoWork(handle);
 
-        char tmp_msg[128];
-        sprintf(tmp_msg, "IoTHubClient_LL_SendReportedState failure in test %zu/%zu", index, count);
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-        //act
-        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
-        //assert
-        ASSERT_ARE_NOT_EQUAL_WITH_MSG(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result, tmp_msg);
-    }
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_when_exactly_on_the_edge_does_not_call_the_callback) /*because "more"*/
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
 
-    //cleanup
+    /*send 1 messages that will expire*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    tickcounter_ms_t eleven = 11; /*11 = 10 (receive time) + 1 (timeout) => NO timeout*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &eleven, sizeof(eleven));
+
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    //act
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
     IoTHubClient_LL_Destroy(handle);
-    umock_c_negative_tests_deinit();
 }
 
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_with_timeouts_at_11_and_12_calls_1_timeout) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+{
+    //arrange
 
-/*Tests_SRS_IOTHUBCLIENT_LL_07_008: [ IoTHubClient_LL_DoWork shall iterate the message queue and execute the underlying transports IoTHubTransport_ProcessItem function for each item. ] */
-/*Tests_SRS_IOTHUBCLIENT_LL_07_011: [ If 'IoTHubTransport_ProcessItem' returns IOTHUB_PROCESS_OK IoTHubClient_LL_DoWork shall add the IOTHUB_QUEUE_DATA_ITEM to the ack queue. ]*/
-TEST_FUNCTION(IoTHubClient_LL_DoWork_SendReportedState_succeed)
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+
+    tickcounter_ms_t two = 2;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &two);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
+    umock_c_reset_all_calls();
+
+    tickcounter_ms_t twelve = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
+        .IgnoreArgument(1);
+
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    /*because we're at time = 12 in this test, the second message is untouched*/
+
+    //act
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_044: [ Messages already delivered to IoTHubClient_LL shall not have their timeouts modified by a new call to IoTHubClient_LL_SetOption. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_with_timeouts_at_11_and_12_calls_2_timeouts) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+
+    tickcounter_ms_t two = 2;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &two);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
+
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
-        .IgnoreAllArguments();
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_ProcessItem(IGNORED_PTR_ARG, IOTHUB_TYPE_DEVICE_TWIN, IGNORED_PTR_ARG))
+    tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
-        .IgnoreArgument_item_type()
-        .IgnoreArgument(3);
+        .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
 
-    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
         .IgnoreArgument(1);
 
-    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    timeIsNow = 13; /*13 > 10 (receive time) + 2 (timeout) => timeout!!!*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
-        .IgnoreArgument(2);
+        .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, h))
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)(TEST_DEVICEMESSAGE_HANDLE_2))); /*calling the callback*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
         .IgnoreArgument(1);
 
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+
+    /*because we're at time = 13 in this test, the second message times out too*/
+
     //act
-    IoTHubClient_LL_DoWork(h);
+    IoTHubClient_LL_DoWork(handle);
+    IoTHubClient_LL_DoWork(handle);
 
     ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a tickcounter_ms_t. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_043: [ Calling IoTHubClient_LL_SetOption with value set to "0" shall disable the timeout mechanism for all new messages. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_044: [ Messages already delivered to IoTHubClient_LL shall not have their timeouts modified by a new call to IoTHubClient_LL_SetOption. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_2_messages_one_with_timeout_one_without_call_1_callback) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+{
+    //arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+
+    tickcounter_ms_t zero = 0;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &zero); /*essentially no timeout*/
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)(TEST_DEVICEMESSAGE_HANDLE_2));
+
+    umock_c_reset_all_calls();
+
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+
+    {/*this scope happen in the first _DoWork call*/
+        tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!!*/
+        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
+
+        STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)) /*this is removing the item from waitingToSend*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE)); /*calling the callback*/
+        STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG)) /*destroying the message clone*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*destroying the IOTHUB_MESSAGE_LIST*/
+            .IgnoreArgument(1);
+    }
+
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    {/*this scope happen in the second _DoWork call*/
+        tickcounter_ms_t timeIsNow = 999999999UL; /*some very big number*/
+        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow));
+    }
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    //act
+    IoTHubClient_LL_DoWork(handle);
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_messageTimeout_when_tickcounter_fails_in_do_work_no_timeout_callbacks_are_called) /*test wants to see that message that did not timeout yet do not have their callbacks called*/
+{
+    //arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+
+    /*send 2 messages that will expire at 12 and 13, both of these messages are send at time=10*/
+    /*because sending messages stamps the message's timeout, the call to tickcounter_get_current_ms needs to be here, so the test can says
+    "the message has been received at time=10*/
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+
+    umock_c_reset_all_calls();
+
+    {/*this scope happen in the _DoWork call*/
+        tickcounter_ms_t timeIsNow = 12; /*12 > 10 (receive time) + 1 (timeout) => timeout!!! (well - normally - but here the code doesn't call any callbacks because time cannot be obtained*/
+        STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .CopyOutArgumentBuffer(2, &timeIsNow, sizeof(timeIsNow))
+            .SetReturn(__LINE__);
+    }
+
+    /*we don't care what happens in the Transport, so let's ignore all those calls*/
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    //act
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+#ifndef DONT_USE_UPLOADTOBLOB
+/*Tests_SRS_IOTHUBCLIENT_LL_02_061: [ If iotHubClientHandle is NULL then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_handle_fails)
+{
+    //arrange
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(NULL, "irrelevantFileName", (const unsigned char*)"a", 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+
+    ///cleanup
+}
+#endif
+
+#ifndef DONT_USE_UPLOADTOBLOB
+/*Tests_SRS_IOTHUBCLIENT_LL_02_062: [ If destinationFileName is NULL then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_fileName_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(h, NULL, (const unsigned char*)"a", 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_063: [ If source is NULL and size is greater than 0 then IoTHubClient_LL_UploadToBlob shall fail and return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_UploadToBlob_with_NULL_source_and_size_greater_than_0_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_UploadToBlob(h, "someFileName.txt", NULL, 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+#endif 
+
+/* Tests_SRS_IOTHUBCLIENT_LL_10_016: [ Otherwise IoTHubClient_LL_SendReportedState shall succeed and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SendReportedState_succeeds)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    setup_iothubclient_ll_sendreportedstate_mocks();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_10_012: [ IoTHubClient_LL_SendReportedState shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL. ] */
+TEST_FUNCTION(IoTHubClient_LL_SendReportedState_NULL_fails)
+{
+    //arrange
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(NULL, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_10_013: [ IoTHubClient_LL_SendReportedState shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter reportedState is NULL] */
+TEST_FUNCTION(IoTHubClient_LL_SendReportedState_reported_state_NULL_fail)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, NULL, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+TEST_FUNCTION(IoTHubClient_LL_SendReportedState_reported_size_0_fail)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, 0, iothub_reported_state_callback, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_10_015: [ If any error is encountered IoTHubClient_LL_SendReportedState shall return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SendReportedState_fail)
+{
+    //arrange
+    int negativeTestsInitResult = umock_c_negative_tests_init();
+    ASSERT_ARE_EQUAL(int, 0, negativeTestsInitResult);
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    setup_iothubclient_ll_sendreportedstate_mocks();
+
+    umock_c_negative_tests_snapshot();
+
+    size_t calls_cannot_fail[] = { 4 };
+
+    size_t count = umock_c_negative_tests_call_count();
+    for (size_t index = 0; index < count; index++)
+    {
+        if (should_skip_index(index, calls_cannot_fail, sizeof(calls_cannot_fail) / sizeof(calls_cannot_fail[0])) != 0)
+        {
+            continue;
+        }
+        umock_c_negative_tests_reset();
+        umock_c_negative_tests_fail_call(index);
+
+        char tmp_msg[128];
+        sprintf(tmp_msg, "IoTHubClient_LL_SendReportedState failure in test %zu/%zu", index, count);
+
+        //act
+        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL_WITH_MSG(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result, tmp_msg);
+    }
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+    umock_c_negative_tests_deinit();
+}
+
+
+/*Tests_SRS_IOTHUBCLIENT_LL_07_008: [ IoTHubClient_LL_DoWork shall iterate the message queue and execute the underlying transports IoTHubTransport_ProcessItem function for each item. ] */
+/*Tests_SRS_IOTHUBCLIENT_LL_07_011: [ If 'IoTHubTransport_ProcessItem' returns IOTHUB_PROCESS_OK IoTHubClient_LL_DoWork shall add the IOTHUB_QUEUE_DATA_ITEM to the ack queue. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_SendReportedState_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_ProcessItem(IGNORED_PTR_ARG, IOTHUB_TYPE_DEVICE_TWIN, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument_item_type()
+        .IgnoreArgument(3);
+
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, h))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_DoWork(h);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_07_010: [ If 'IoTHubTransport_ProcessItem' returns IOTHUB_PROCESS_CONTINUE or IOTHUB_PROCESS_NOT_CONNECTED IoTHubClient_LL_DoWork shall continue on to call the underlaying layer's _DoWork function. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_SendReportedState_continue_processing_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
+        .IgnoreArgument_tick_counter()
+        .IgnoreArgument_current_ms();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_ProcessItem(IGNORED_PTR_ARG, IOTHUB_TYPE_DEVICE_TWIN, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument_item_type()
+        .IgnoreArgument(3)
+        .SetReturn(IOTHUB_PROCESS_CONTINUE);
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, h))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_DoWork(h);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_12_017: [ `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_INVALID_ARG` if parameter `iotHubClientHandle` is `NULL`. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(NULL, deviceMethodCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_12_018: [ If `deviceMethodCallback` is `NULL`, then `IoTHubClient_LL_SetDeviceMethodCallback` shall call the underlying layer's `IoTHubTransport_Unsubscribe_DeviceMethod` function and return `IOTHUB_CLIENT_OK`. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_NULL_callback_Unsubscribe_and_succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_12_019: [ If `deviceMethodCallback` is not `NULL`, then `IoTHubClient_LL_SetDeviceMethodCallback` shall call the underlying layer's `IoTHubTransport_Subscribe_DeviceMethod` function. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_non_NULL_succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, deviceMethodCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_12_020: [ If the underlying layer's `IoTHubTransport_Subscribe_DeviceMethod` function fails, then `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_ERROR`. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_12_021: [ If adding the information fails for any reason, `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_ERROR`. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_fails_when_underlying_transport_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, deviceMethodCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_07_003: [ IoTHubClient_LL_ReportedStateComplete shall enumerate through the IOTHUB_DEVICE_TWIN structures in queue_handle. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_07_009: [ IoTHubClient_LL_ReportedStateComplete shall remove the IOTHUB_QUEUE_DATA_ITEM item from the ack queue.]*/
+TEST_FUNCTION(IoTHubClient_LL_ReportedStateComplete_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    IoTHubClient_LL_DoWork(h);
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(iothub_reported_state_callback(IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_ReportedStateComplete(h, 2, TEST_DEVICE_STATUS_CODE);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_07_002: [ if handle is NULL then IoTHubClient_LL_ReportedStateComplete shall do nothing. ]*/
+TEST_FUNCTION(IoTHubClient_LL_ReportedStateComplete_NULL_fail)
+{
+    //arrange
+
+    //act
+    IoTHubClient_LL_ReportedStateComplete(NULL, 2, TEST_DEVICE_STATUS_CODE);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_018: [ If deviceMethodCallback is not NULL IoTHubClient_LL_DeviceMethodComplete shall execute deviceMethodCallback and return the status. ] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(h, deviceMethodCallback, (void*)1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    umock_c_reset_all_calls();
+
+    size_t len = 1;
+    unsigned char* resp = (unsigned char*)my_gballoc_malloc(len);
+    resp[0] = 0xa;
+
+    STRICT_EXPECTED_CALL(deviceMethodCallback(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_method_name()
+        .IgnoreArgument_payload()
+        .IgnoreArgument_size()
+        .IgnoreArgument_userContextCallback()
+        .CopyOutArgumentBuffer_response(&resp, sizeof(unsigned char**))
+        .CopyOutArgumentBuffer_resp_size(&len, sizeof(size_t));
+
+    EXPECTED_CALL(FAKE_IoTHubTransport_DeviceMethod_Response(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument_ptr();
+
+    //act
+    int status = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+
+    //assert
+    ASSERT_ARE_EQUAL(int, 0, status);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_018: [ If deviceMethodCallback is not NULL IoTHubClient_LL_DeviceMethodComplete shall execute deviceMethodCallback and return the status. ] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_payload_NULL_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(h, deviceMethodCallback, (void*)1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    umock_c_reset_all_calls();
+
+    size_t len = 0;
+    unsigned char* resp = NULL;
+
+    STRICT_EXPECTED_CALL(deviceMethodCallback(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_method_name()
+        .IgnoreArgument_payload()
+        .IgnoreArgument_size()
+        .IgnoreArgument_userContextCallback()
+        .CopyOutArgumentBuffer_response(&resp, sizeof(unsigned char**))
+        .CopyOutArgumentBuffer_resp_size(&len, sizeof(size_t));
+
+    //act
+    int status = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+
+    //assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, status);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_019: [ If deviceMethodCallback is NULL IoTHubClient_LL_DeviceMethodComplete shall return 404. ] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_No_callback_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    int result = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+
+    //assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_017: [ If `handle` or response is NULL then `IoTHubClient_LL_DeviceMethodComplete` shall return 500. ] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_handle_NULL_succeed)
+{
+    //arrange
+
+    //act
+    int result = IoTHubClient_LL_DeviceMethodComplete(NULL, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+
+    //assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_001: [ IoTHubClient_LL_SetDeviceTwinCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_iothubclienthandle_NULL_fail)
+{
+    //arrange
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(NULL, iothub_device_twin_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_016: [ If deviceTwinCallback is set and DEVICE_TWIN_UPDATE_COMPLETE has been encountered then IoTHubClient_LL_RetrievePropertyComplete shall call deviceTwinCallback.] */
+TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(iothub_device_twin_callback(DEVICE_TWIN_UPDATE_COMPLETE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_update_state()
+        .IgnoreArgument_userContextCallback()
+        .IgnoreArgument_payLoad()
+        .IgnoreArgument_size();
+
+    //act
+    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_013: [ If handle is NULL then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
+TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_iothubclienthandle_NULL_fail)
+{
+    //arrange
+
+    //act
+    IoTHubClient_LL_RetrievePropertyComplete(NULL, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_014: [ If deviceTwinCallback is NULL then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
+TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_deviceTwincallback_NULL_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+
+    umock_c_reset_all_calls();
+
+    //act
+    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_015: [ If the the update_state parameter is DEVICE_TWIN_UPDATE_PARTIAL and a DEVICE_TWIN_UPDATE_COMPLETE has not been previously recieved then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
+TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_update_partial_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    umock_c_reset_all_calls();
+
+    //act
+    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_PARTIAL, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_016: [ If deviceTwinCallback is set and DEVICE_TWIN_UPDATE_COMPLETE has been encountered then IoTHubClient_LL_RetrievePropertyComplete shall call deviceTwinCallback.] */
+TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_update_partial_before_complete_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(iothub_device_twin_callback(DEVICE_TWIN_UPDATE_PARTIAL, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_update_state()
+        .IgnoreArgument_userContextCallback()
+        .IgnoreArgument_payLoad()
+        .IgnoreArgument_size();
+
+    //act
+    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_PARTIAL, NULL, 0);
+    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_006: [ If deviceTwinCallback is NULL, then IoTHubClient_LL_SetDeviceTwinCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_unsubscribe_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceTwin(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, NULL, NULL);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_002: [ If deviceTwinCallback is not NULL, then IoTHubClient_LL_SetDeviceTwinCallback shall call the underlying layer's _Subscribe function.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_subscribe_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceTwin(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_003: [ If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetDeviceTwinCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_subscribe_fail)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceTwin(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle()
+        .SetReturn(__LINE__);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Test_SRS_IOTHUBCLIENT_LL_07_021: [ If handle is NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall return IOTHUB_CLIENT_INVALID_ARG.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_handle_NULL_fail)
+{
+    //arrange
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(NULL, iothub_client_inbound_device_method_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_025: [ If any error is encountered then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_subscribe_fail)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(__LINE__);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, iothub_client_inbound_device_method_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_022: [ If inboundDeviceMethodCallback is NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall call the underlying layer's IoTHubTransport_Unsubscribe_DeviceMethod function and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_inbound_device_method_cb_NULL_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, NULL, 0);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_023: [ If inboundDeviceMethodCallback is non-NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall call the underlying layer's IoTHubTransport_Subscribe_DeviceMethod function.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_succeed)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, iothub_client_inbound_device_method_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_026: [ If handle or methodId is NULL then IoTHubClient_LL_DeviceMethodResponse shall return IOTHUB_CLIENT_INVALID_ARG.] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_handle_NULL_fail)
+{
+    //arrange
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(NULL, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_07_026: [ If handle or methodId is NULL then IoTHubClient_LL_DeviceMethodResponse shall return IOTHUB_CLIENT_INVALID_ARG.] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_method_id_NULL_fail)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(h, NULL, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
     IoTHubClient_LL_Destroy(h);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_07_010: [ If 'IoTHubTransport_ProcessItem' returns IOTHUB_PROCESS_CONTINUE or IOTHUB_PROCESS_NOT_CONNECTED IoTHubClient_LL_DoWork shall continue on to call the underlaying layer's _DoWork function. ]*/
-TEST_FUNCTION(IoTHubClient_LL_DoWork_SendReportedState_continue_processing_succeed)
+/* Tests_SRS_IOTHUBCLIENT_LL_07_027: [ IoTHubClient_LL_DeviceMethodResponse shall call the IoTHubTransport_DeviceMethod_Response transport function.] */
+TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_succeed)
 {
     //arrange
     IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
-        .IgnoreArgument_tick_counter()
-        .IgnoreArgument_current_ms();
-
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_ProcessItem(IGNORED_PTR_ARG, IOTHUB_TYPE_DEVICE_TWIN, IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .IgnoreArgument_item_type()
-        .IgnoreArgument(3)
-        .SetReturn(IOTHUB_PROCESS_CONTINUE);
-
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, h))
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DeviceMethod_Response(IGNORED_PTR_ARG, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE))
         .IgnoreArgument(1);
 
     //act
-    IoTHubClient_LL_DoWork(h);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(h, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
 
-    ///assert
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(h);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_12_017: [ `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_INVALID_ARG` if parameter `iotHubClientHandle` is `NULL`. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_NULL_iotHubClientHandle_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_001: [ If handle or time_to_next_timeout is NULL then IoTHubClient_LL_GetTimeToNextTimeout shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetTimeToNextTimeout_with_NULL_handle_fails)
 {
-    ///arrange
+    //arrange
+    tickcounter_ms_t time_to_next_timeout;
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(NULL, deviceMethodCallback, (void*)1);
+    //act
+    int result = IoTHubClient_LL_GetTimeToNextTimeout(NULL, &time_to_next_timeout);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_12_018: [ If `deviceMethodCallback` is `NULL`, then `IoTHubClient_LL_SetDeviceMethodCallback` shall call the underlying layer's `IoTHubTransport_Unsubscribe_DeviceMethod` function and return `IOTHUB_CLIENT_OK`. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_NULL_callback_Unsubscribe_and_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_002: [ If no message waiting to be sent has a timeout then IoTHubClient_LL_GetTimeToNextTimeout shall return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetTimeToNextTimeout_without_message_timeouts_fails)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t time_to_next_timeout;
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceMethod(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, NULL, (void*)1);
+    //act
+    int result = IoTHubClient_LL_GetTimeToNextTimeout(handle, &time_to_next_timeout);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_12_019: [ If `deviceMethodCallback` is not `NULL`, then `IoTHubClient_LL_SetDeviceMethodCallback` shall call the underlying layer's `IoTHubTransport_Subscribe_DeviceMethod` function. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_with_non_NULL_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_003: [ Otherwise IoTHubClient_LL_GetTimeToNextTimeout shall set time_to_next_timeout to the number of milliseconds until the earliest message timeout (0 if it is already due) and return 0. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetTimeToNextTimeout_returns_the_earliest_timeout_succeeds)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t five = 5;
+    tickcounter_ms_t ten = 10;
+    tickcounter_ms_t eleven = 11;
+    tickcounter_ms_t twelve = 12;
+    tickcounter_ms_t time_to_next_timeout = 0;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &five);
+
+    /*messages time out after 15 and 16*/
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &eleven, sizeof(eleven));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, deviceMethodCallback, (void*)1);
+    //act
+    int result = IoTHubClient_LL_GetTimeToNextTimeout(handle, &time_to_next_timeout);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 4, (int)time_to_next_timeout); /*15 is due once the tick counter passes it, that is at 16*/
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_12_020: [ If the underlying layer's `IoTHubTransport_Subscribe_DeviceMethod` function fails, then `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_ERROR`. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_12_021: [ If adding the information fails for any reason, `IoTHubClient_LL_SetDeviceMethodCallback` shall fail and return `IOTHUB_CLIENT_ERROR`. ]*/
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_fails_when_underlying_transport_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_004: [ IoTHubClient_LL_SendEventAsync shall keep track of whether the messages in waitingToSend are in the order in which they timeout. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_006: [ Otherwise IoTHubClient_LL_DoWork shall inspect all the messages in waitingToSend and find out again whether the remaining ones are in timeout order. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_times_out_a_message_queued_behind_a_later_timeout)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t five = 5;
+    tickcounter_ms_t one = 1;
+    tickcounter_ms_t ten = 10;
+    tickcounter_ms_t twelve = 12;
+
+    /*the first message times out after 15, the second one after 11*/
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &five);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE_2);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
-        .SetReturn(1);
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(handle, deviceMethodCallback, (void*)1);
+    //act
+    IoTHubClient_LL_DoWork(handle);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_07_003: [ IoTHubClient_LL_ReportedStateComplete shall enumerate through the IOTHUB_DEVICE_TWIN structures in queue_handle. ]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_07_009: [ IoTHubClient_LL_ReportedStateComplete shall remove the IOTHUB_QUEUE_DATA_ITEM item from the ack queue.]*/
-TEST_FUNCTION(IoTHubClient_LL_ReportedStateComplete_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_006: [ Otherwise IoTHubClient_LL_DoWork shall inspect all the messages in waitingToSend and find out again whether the remaining ones are in timeout order. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_times_out_a_message_the_transport_put_back_at_the_tail)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendReportedState(h, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t five = 5;
+    tickcounter_ms_t ten = 10;
+    tickcounter_ms_t eleven = 11;
+    tickcounter_ms_t sixteen = 16;
+    PDLIST_ENTRY first;
 
-    IoTHubClient_LL_DoWork(h);
+    /*messages time out after 15 and 16*/
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &five);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &eleven, sizeof(eleven));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE_2);
 
+    /*the transport takes the first message out and then puts it back at the tail, like AMQP does when the connection drops*/
+    first = DList_RemoveHeadList(g_waitingToSend);
+    DList_InsertTailList(g_waitingToSend, first);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(iothub_reported_state_callback(IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
-        .IgnoreArgument(2);
-
+        .CopyOutArgumentBuffer(2, &sixteen, sizeof(sixteen));
     STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
     //act
-    IoTHubClient_LL_ReportedStateComplete(h, 2, TEST_DEVICE_STATUS_CODE);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
-}
-
-/*Tests_SRS_IOTHUBCLIENT_LL_07_002: [ if handle is NULL then IoTHubClient_LL_ReportedStateComplete shall do nothing. ]*/
-TEST_FUNCTION(IoTHubClient_LL_ReportedStateComplete_NULL_fail)
-{
-    //arrange
-
-    //act
-    IoTHubClient_LL_ReportedStateComplete(NULL, 2, TEST_DEVICE_STATUS_CODE);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_018: [ If deviceMethodCallback is not NULL IoTHubClient_LL_DeviceMethodComplete shall execute deviceMethodCallback and return the status. ] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_052: [ IoTHubClient_LL shall tell the tail of waitingToSend apart by a sequence number given to every message added to waitingToSend, not by the address of its record. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_times_out_a_message_whose_record_was_reused_at_the_tail)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(h, deviceMethodCallback, (void*)1);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t five = 5;
+    tickcounter_ms_t ten = 10;
+    tickcounter_ms_t eleven = 11;
+    tickcounter_ms_t thirteen = 13;
+    PDLIST_ENTRY last;
+    IOTHUB_MESSAGE_LIST* reused;
 
+    /*messages time out after 15 and 16*/
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &five);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &eleven, sizeof(eleven));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE_2);
+
+    /*the transport takes the tail out and the same record comes back at the tail for a newer message that times out after 12*/
+    last = g_waitingToSend->Blink;
+    (void)DList_RemoveEntryList(last);
+    reused = containingRecord(last, IOTHUB_MESSAGE_LIST, entry);
+    reused->ms_timesOutAfter = 12;
+    reused->sequenceNumber += 1;
+    DList_InsertTailList(g_waitingToSend, last);
     umock_c_reset_all_calls();
 
-    size_t len = 1;
-    unsigned char* resp = (unsigned char*)my_gballoc_malloc(len);
-    resp[0] = 0xa;
-
-    STRICT_EXPECTED_CALL(deviceMethodCallback(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_method_name()
-        .IgnoreArgument_payload()
-        .IgnoreArgument_size()
-        .IgnoreArgument_userContextCallback()
-        .CopyOutArgumentBuffer_response(&resp, sizeof(unsigned char**))
-        .CopyOutArgumentBuffer_resp_size(&len, sizeof(size_t));
-
-    EXPECTED_CALL(FAKE_IoTHubTransport_DeviceMethod_Response(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &thirteen, sizeof(thirteen));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
-        .IgnoreArgument_ptr();
+        .IgnoreArgument(1);
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
     //act
-    int status = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_ARE_EQUAL(int, 0, status);
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_018: [ If deviceMethodCallback is not NULL IoTHubClient_LL_DeviceMethodComplete shall execute deviceMethodCallback and return the status. ] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_payload_NULL_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_040: [ OPTION_PERSISTENT_QUEUE_DIRECTORY - IoTHubClient_LL_SetOption shall open a persistent queue in the directory value (a const char*) with the stored segment size and sync count. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_persistent_queue_directory_opens_the_persistent_queue_with_the_defaults)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback(h, deviceMethodCallback, (void*)1);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    size_t len = 0;
-    unsigned char* resp = NULL;
-
-    STRICT_EXPECTED_CALL(deviceMethodCallback(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_method_name()
-        .IgnoreArgument_payload()
-        .IgnoreArgument_size()
-        .IgnoreArgument_userContextCallback()
-        .CopyOutArgumentBuffer_response(&resp, sizeof(unsigned char**))
-        .CopyOutArgumentBuffer_resp_size(&len, sizeof(size_t));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Create(TEST_PERSISTENT_QUEUE_DIRECTORY, 1024 * 1024, 1));
 
     //act
-    int status = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
 
-    //assert
-    ASSERT_ARE_NOT_EQUAL(int, 0, status);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_019: [ If deviceMethodCallback is NULL IoTHubClient_LL_DeviceMethodComplete shall return 404. ] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_No_callback_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_039: [ OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE, OPTION_PERSISTENT_QUEUE_SYNC_COUNT and OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW - IoTHubClient_LL_SetOption shall store value (a pointer to size_t) to be used by the persistent queue opened next. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_persistent_queue_directory_uses_the_segment_size_and_sync_count_set_before)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t segmentSize = 4096;
+    size_t syncCount = 8;
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_SEGMENT_SIZE, &segmentSize));
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_SYNC_COUNT, &syncCount));
     umock_c_reset_all_calls();
 
-    //act
-    int result = IoTHubClient_LL_DeviceMethodComplete(h, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
-
-    //assert
-    ASSERT_ARE_EQUAL(int, 0, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
-}
-
-/* Tests_SRS_IOTHUBCLIENT_LL_07_017: [ If `handle` or response is NULL then `IoTHubClient_LL_DeviceMethodComplete` shall return 500. ] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodComplete_handle_NULL_succeed)
-{
-    //arrange
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Create(TEST_PERSISTENT_QUEUE_DIRECTORY, 4096, 8));
 
     //act
-    int result = IoTHubClient_LL_DeviceMethodComplete(NULL, TEST_METHOD_NAME, (const unsigned char*)TEST_STRING_VALUE, strlen(TEST_STRING_VALUE), TEST_METHOD_ID);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
 
-    //assert
-    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-}
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_001: [ IoTHubClient_LL_SetDeviceTwinCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_iothubclienthandle_NULL_fail)
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_41_041: [ If a persistent queue is already open, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_persistent_queue_directory_twice_fails)
 {
     //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
+    umock_c_reset_all_calls();
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(NULL, iothub_device_twin_callback, (void*)1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_016: [ If deviceTwinCallback is set and DEVICE_TWIN_UPDATE_COMPLETE has been encountered then IoTHubClient_LL_RetrievePropertyComplete shall call deviceTwinCallback.] */
-TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_038: [ If opening the persistent queue fails, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_persistent_queue_directory_fails_when_the_queue_cannot_be_opened)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(iothub_device_twin_callback(DEVICE_TWIN_UPDATE_COMPLETE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_update_state()
-        .IgnoreArgument_userContextCallback()
-        .IgnoreArgument_payLoad()
-        .IgnoreArgument_size();
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Create(TEST_PERSISTENT_QUEUE_DIRECTORY, IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
 
     //act
-    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
 
-    //assert
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_013: [ If handle is NULL then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
-TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_iothubclienthandle_NULL_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_032: [ If a persistent queue is open, IoTHubClient_LL_SendEventAsync shall append the message to it before adding it to waitingToSend. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_appends_the_message_to_the_persistent_queue)
 {
     //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Append(TEST_PERSISTENT_QUEUE_HANDLE, (IOTHUB_MESSAGE_HANDLE)0x44, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     //act
-    IoTHubClient_LL_RetrievePropertyComplete(NULL, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
 
-    //assert
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_014: [ If deviceTwinCallback is NULL then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
-TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_deviceTwincallback_NULL_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_033: [ If appending the message to the persistent queue fails, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails_when_appending_to_the_persistent_queue_fails)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Append(TEST_PERSISTENT_QUEUE_HANDLE, (IOTHUB_MESSAGE_HANDLE)0x44, IGNORED_PTR_ARG))
+        .SetReturn(__LINE__);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)0x44));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
     //act
-    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
 
-    //assert
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 0, status.messageCount);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_015: [ If the the update_state parameter is DEVICE_TWIN_UPDATE_PARTIAL and a DEVICE_TWIN_UPDATE_COMPLETE has not been previously recieved then IoTHubClient_LL_RetrievePropertyComplete shall do nothing.] */
-TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_update_partial_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_034: [ When the confirmation callback of a persisted message is called with any result but IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, its entry shall be marked done in the persistent queue. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_marks_the_message_done_in_the_persistent_queue)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY completed;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
 
+    /*the transport takes the message out of waitingToSend, like it does when sending it*/
+    DList_InitializeListHead(&completed);
+    DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_MarkDone(TEST_PERSISTENT_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+
     //act
-    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_PARTIAL, NULL, 0);
+    IoTHubClient_LL_SendComplete(handle, &completed, IOTHUB_CLIENT_CONFIRMATION_OK);
 
-    //assert
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_016: [ If deviceTwinCallback is set and DEVICE_TWIN_UPDATE_COMPLETE has been encountered then IoTHubClient_LL_RetrievePropertyComplete shall call deviceTwinCallback.] */
-TEST_FUNCTION(IoTHubClient_LL_RetrievePropertyComplete_update_partial_before_complete_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_037: [ IoTHubClient_LL_Destroy shall close the persistent queue after completing the messages, leaving the messages completed with IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY pending in it. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Destroy_leaves_the_waiting_messages_pending_in_the_persistent_queue)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, NULL);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(iothub_device_twin_callback(DEVICE_TWIN_UPDATE_PARTIAL, IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_update_state()
-        .IgnoreArgument_userContextCallback()
-        .IgnoreArgument_payLoad()
-        .IgnoreArgument_size();
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unregister(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
+#ifndef DONT_USE_UPLOADTOBLOB
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_UploadToBlob_Destroy(IGNORED_PTR_ARG));
+#endif
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Destroy(TEST_PERSISTENT_QUEUE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(handle));
 
     //act
-    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_PARTIAL, NULL, 0);
-    IoTHubClient_LL_RetrievePropertyComplete(h, DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0);
+    IoTHubClient_LL_Destroy(handle);
 
-    //assert
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_006: [ If deviceTwinCallback is NULL, then IoTHubClient_LL_SetDeviceTwinCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_unsubscribe_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_035: [ IoTHubClient_LL_DoWork shall add the messages recovered by the persistent queue to waitingToSend, without a confirmation callback, as long as fewer than OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW messages are in the send queue. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_042: [ After the underlying layer's _DoWork, IoTHubClient_LL_DoWork shall flush the persistent queue if it was not flushed by IoTHubClient_LL_DoWork in the last 100 ms, so the done marks written by the transport reach the disk in batches. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_replays_recovered_messages_up_to_the_replay_window)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+    size_t replayWindow = 1;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW, &replayWindow);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceTwin(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_GetNextRecovered(TEST_PERSISTENT_QUEUE_HANDLE, IGNORED_PTR_ARG))
+        .SetReturn(TEST_DEVICEMESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_DEVICEMESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Flush(TEST_PERSISTENT_QUEUE_HANDLE));
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, NULL, NULL);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetSendQueueStatus(handle, &status));
+    ASSERT_ARE_EQUAL(size_t, 1, status.messageCount);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_002: [ If deviceTwinCallback is not NULL, then IoTHubClient_LL_SetDeviceTwinCallback shall call the underlying layer's _Subscribe function.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_subscribe_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_035: [ IoTHubClient_LL_DoWork shall add the messages recovered by the persistent queue to waitingToSend, without a confirmation callback, as long as fewer than OPTION_PERSISTENT_QUEUE_REPLAY_WINDOW messages are in the send queue. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_stops_replaying_when_no_recovered_message_is_left)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceTwin(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_GetNextRecovered(TEST_PERSISTENT_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_Flush(TEST_PERSISTENT_QUEUE_HANDLE));
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_003: [ If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetDeviceTwinCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceTwinCallback_subscribe_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_042: [ After the underlying layer's _DoWork, IoTHubClient_LL_DoWork shall flush the persistent queue if it was not flushed by IoTHubClient_LL_DoWork in the last 100 ms, so the done marks written by the transport reach the disk in batches. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_does_not_flush_the_persistent_queue_again_within_100_ms)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t soonAfter;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_PERSISTENT_QUEUE_DIRECTORY, TEST_PERSISTENT_QUEUE_DIRECTORY);
+    IoTHubClient_LL_DoWork(handle);
+    soonAfter = g_current_ms + 99;
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceTwin(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle()
-        .SetReturn(__LINE__);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &soonAfter, sizeof(soonAfter));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_PersistentQueue_GetNextRecovered(TEST_PERSISTENT_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &soonAfter, sizeof(soonAfter));
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceTwinCallback(h, iothub_device_twin_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Test_SRS_IOTHUBCLIENT_LL_07_021: [ If handle is NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall return IOTHUB_CLIENT_INVALID_ARG.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_handle_NULL_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_043: [ If iotHubClientHandle is NULL, IoTHubClient_LL_SetEventConfirmationBatchCallback shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetEventConfirmationBatchCallback_with_NULL_handle_fails)
 {
     //arrange
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(NULL, iothub_client_inbound_device_method_callback, (void*)1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetEventConfirmationBatchCallback(NULL, test_event_confirmation_batch_callback, (void*)0x42);
 
-    //assert
+    ///assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_025: [ If any error is encountered then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_subscribe_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_044: [ While a batch callback is set, IoTHubClient_LL_SendEventAsync shall accept a NULL eventConfirmationCallback with a non-NULL userContextCallback. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_NULL_callback_and_a_context_succeeds_with_a_batch_callback)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, (void*)0x42);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn(__LINE__);
-
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, iothub_client_inbound_device_method_callback, (void*)1);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 0, g_batch_call_count);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_022: [ If inboundDeviceMethodCallback is NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall call the underlying layer's IoTHubTransport_Unsubscribe_DeviceMethod function and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_inbound_device_method_cb_NULL_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_045: [ When a message sent without a confirmation callback completes while a batch callback is set, its context and result shall be appended to the pending confirmations instead. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_41_049: [ IoTHubClient_LL_SendComplete shall pass the confirmations collected from completed to the batch callback in one call. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_passes_the_confirmations_to_the_batch_callback_in_one_call)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY completed;
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, (void*)0x42);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)3);
+
+    /*the transport takes the messages out of waitingToSend, like it does when sending them*/
+    DList_InitializeListHead(&completed);
+    DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
+    DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
+    DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe_DeviceMethod(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&completed));
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, NULL, 0);
+    IoTHubClient_LL_SendComplete(handle, &completed, IOTHUB_CLIENT_CONFIRMATION_OK);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_call_count);
+    ASSERT_ARE_EQUAL(size_t, 2, g_batch_sizes[0]);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)0x42, g_batch_context);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_batch_confirmations[0][0].userContextCallback);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_OK, g_batch_confirmations[0][0].result);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)3, g_batch_confirmations[0][1].userContextCallback);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_OK, g_batch_confirmations[0][1].result);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_023: [ If inboundDeviceMethodCallback is non-NULL then IoTHubClient_LL_SetDeviceMethodCallback_Ex shall call the underlying layer's IoTHubTransport_Subscribe_DeviceMethod function.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetDeviceMethodCallback_Ex_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_046: [ When EVENT_CONFIRMATION_BATCH_SIZE confirmations are pending, they shall be passed to the batch callback right away. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_splits_a_long_list_in_batches_of_32)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY completed;
+    size_t i;
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, NULL);
+    DList_InitializeListHead(&completed);
+    for (i = 0; i < 33; i++)
+    {
+        (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)(i + 1));
+        DList_InsertTailList(&completed, DList_RemoveHeadList(g_waitingToSend));
+    }
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe_DeviceMethod(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetDeviceMethodCallback_Ex(h, iothub_client_inbound_device_method_callback, (void*)1);
+    IoTHubClient_LL_SendComplete(handle, &completed, IOTHUB_CLIENT_CONFIRMATION_ERROR);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_batch_call_count);
+    ASSERT_ARE_EQUAL(size_t, 32, g_batch_sizes[0]);
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_sizes[1]);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)32, g_batch_confirmations[0][31].userContextCallback);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)33, g_batch_confirmations[1][0].userContextCallback);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_ERROR, g_batch_confirmations[1][0].result);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_026: [ If handle or methodId is NULL then IoTHubClient_LL_DeviceMethodResponse shall return IOTHUB_CLIENT_INVALID_ARG.] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_handle_NULL_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_048: [ IoTHubClient_LL_DoWork shall end by passing the pending confirmations, such as those of the messages that timed out, to the batch callback. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_passes_the_timed_out_messages_to_the_batch_callback)
 {
     //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    tickcounter_ms_t ten = 10;
+    tickcounter_ms_t twelve = 12;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, NULL);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)2);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(NULL, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_call_count);
+    ASSERT_ARE_EQUAL(size_t, 2, g_batch_sizes[0]);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, g_batch_confirmations[0][0].result);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)2, g_batch_confirmations[0][1].userContextCallback);
 
-    //cleanup
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_026: [ If handle or methodId is NULL then IoTHubClient_LL_DeviceMethodResponse shall return IOTHUB_CLIENT_INVALID_ARG.] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_method_id_NULL_fail)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_050: [ IoTHubClient_LL_Destroy shall pass the pending confirmations to the batch callback after completing the messages in waitingToSend. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Destroy_passes_the_waiting_messages_to_the_batch_callback)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, NULL);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)2);
     umock_c_reset_all_calls();
 
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(h, NULL, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
-
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    IoTHubClient_LL_Destroy(handle);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_call_count);
+    ASSERT_ARE_EQUAL(size_t, 2, g_batch_sizes[0]);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_batch_confirmations[0][0].userContextCallback);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, g_batch_confirmations[0][0].result);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_07_027: [ IoTHubClient_LL_DeviceMethodResponse shall call the IoTHubTransport_DeviceMethod_Response transport function.] */
-TEST_FUNCTION(IoTHubClient_LL_DeviceMethodResponse_succeed)
+/*Tests_SRS_IOTHUBCLIENT_LL_41_051: [ IoTHubClient_LL_SetEventConfirmationBatchCallback shall pass the pending confirmations to the previous batch callback, then store batchCallback and userContextCallback (NULL stops batching) and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetEventConfirmationBatchCallback_with_NULL_passes_the_pending_confirmations_first)
 {
     //arrange
-    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_LIST* message;
+    (void)IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, test_event_confirmation_batch_callback, (void*)0x42);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
+
+    /*some transports complete a message themselves, outside of IoTHubClient_LL_SendComplete*/
+    message = containingRecord(DList_RemoveHeadList(g_waitingToSend), IOTHUB_MESSAGE_LIST, entry);
+    message->callback(IOTHUB_CLIENT_CONFIRMATION_OK, message->context);
+    IoTHubMessage_Destroy(message->messageHandle);
+    IoTHubClient_RecordPool_Free(message);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DeviceMethod_Response(IGNORED_PTR_ARG, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE))
-        .IgnoreArgument(1);
-
     //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_DeviceMethodResponse(h, TEST_METHOD_ID, (const unsigned char*)TEST_DEVICE_METHOD_RESPONSE, strlen(TEST_DEVICE_METHOD_RESPONSE), TEST_DEVICE_STATUS_CODE);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetEventConfirmationBatchCallback(handle, NULL, NULL);
 
-    //assert
+    ///assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_call_count);
+    ASSERT_ARE_EQUAL(size_t, 1, g_batch_sizes[0]);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_batch_confirmations[0][0].userContextCallback);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)0x42, g_batch_context);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, NULL, (void*)2));
 
-    //cleanup
-    IoTHubClient_LL_Destroy(h);
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
 END_TEST_SUITE(iothubclient_ll_ut)
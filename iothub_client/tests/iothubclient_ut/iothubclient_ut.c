@@ -36,6 +36,8 @@ void* my_gballoc_realloc(void* ptr, size_t size)
 #undef ENABLE_MOCKS
 
 #include "iothub_client.h"
+#include "iothub_client_options.h"
+#include "iothub_client_shared_transport_private.h"
 
 #define ENABLE_MOCKS
 #include "azure_c_shared_utility/gballoc.h"
@@ -43,10 +45,14 @@ void* my_gballoc_realloc(void* ptr, size_t size)
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/condition.h"
 
 #include "iothub_client_ll.h"
+#include "iothub_client_private.h"
+#include "iothub_client_worker_pool_private.h"
 
 MOCKABLE_FUNCTION(, void, test_event_confirmation_callback, IOTHUB_CLIENT_CONFIRMATION_RESULT, result, void*, userContextCallback);
+MOCKABLE_FUNCTION(, void, test_event_confirmation_batch_callback, const IOTHUB_CLIENT_EVENT_CONFIRMATION*, confirmations, size_t, confirmationCount, void*, userContextCallback);
 MOCKABLE_FUNCTION(, IOTHUBMESSAGE_DISPOSITION_RESULT, test_message_confirmation_callback, IOTHUB_MESSAGE_HANDLE, message, void*, userContextCallback);
 MOCKABLE_FUNCTION(, void, test_device_twin_callback, DEVICE_TWIN_UPDATE_STATE, update_state, const unsigned char*, payLoad, size_t, size, void*, userContextCallback);
 MOCKABLE_FUNCTION(, void, test_connection_status_callback, IOTHUB_CLIENT_CONNECTION_STATUS, result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON, reason, void*, userContextCallback);
@@ -72,8 +78,10 @@ static TEST_MUTEX_HANDLE g_dllByDll;
 
 #ifdef __cplusplus
 extern "C" const size_t IoTHubClient_ThreadTerminationOffset;
+extern "C" const size_t IoTHubClient_DispatchThreadTerminationOffset;
 #else
 extern const size_t IoTHubClient_ThreadTerminationOffset;
+extern const size_t IoTHubClient_DispatchThreadTerminationOffset;
 #endif
 
 typedef struct LOCK_TEST_INFO_TAG
@@ -85,7 +93,10 @@ static LOCK_TEST_INFO g_transport_lock;
 
 static THREAD_START_FUNC g_thread_func;
 static void* g_thread_func_arg;
+static WORKER_POOL_DO_WORK g_worker_pool_do_work;
+static void* g_worker_pool_do_work_context;
 static IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK g_eventConfirmationCallback;
+static IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK g_eventConfirmationBatchCallback;
 static IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK g_deviceTwinCallback;
 static IOTHUB_CLIENT_REPORTED_STATE_CALLBACK g_reportedStateCallback;
 static IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK g_connectionStatusCallback;
@@ -111,6 +122,9 @@ static IOTHUB_CLIENT_DEVICE_CONFIG* TEST_CLIENT_DEVICE_CONFIG = (IOTHUB_CLIENT_D
 static METHOD_HANDLE TEST_METHOD_ID = (METHOD_HANDLE)0x111B;
 static STRING_HANDLE TEST_STRING_HANDLE = (STRING_HANDLE)0x111C;
 static BUFFER_HANDLE TEST_BUFFER_HANDLE = (BUFFER_HANDLE)0x111D;
+static COND_HANDLE TEST_COND_HANDLE = (COND_HANDLE)0x111E;
+static IOTHUB_CLIENT_WORKER_POOL_HANDLE TEST_WORKER_POOL_HANDLE = (IOTHUB_CLIENT_WORKER_POOL_HANDLE)0x111F;
+static WORKER_POOL_ITEM_HANDLE TEST_WORKER_POOL_ITEM_HANDLE = (WORKER_POOL_ITEM_HANDLE)0x1120;
 
 static const char* TEST_CONNECTION_STRING = "Test_connection_string";
 static const char* TEST_DEVICE_ID = "theidofTheDevice";
@@ -184,10 +198,34 @@ static void my_ThreadAPI_Sleep(unsigned int milliseconds)
     }
 }
 
+static COND_RESULT my_Condition_Wait(COND_HANDLE handle, LOCK_HANDLE lock, int timeout_milliseconds)
+{
+    (void)handle;
+    (void)lock;
+    (void)timeout_milliseconds;
+    g_thread_loop_count++;
+    if ((g_how_thread_loops > 0) && (g_how_thread_loops == g_thread_loop_count))
+    {
+        *(sig_atomic_t*)(((char*)g_thread_func_arg) + IoTHubClient_ThreadTerminationOffset) = 1; /*tell the thread to stop*/
+        *(int*)(((char*)g_thread_func_arg) + IoTHubClient_DispatchThreadTerminationOffset) = 1; /*and the dispatch thread, if that is the one waiting*/
+    }
+    return COND_OK;
+}
+
+static WORKER_POOL_ITEM_HANDLE my_IoTHubClient_WorkerPool_Add(IOTHUB_CLIENT_WORKER_POOL_HANDLE workerPool, WORKER_POOL_DO_WORK doWork, void* context)
+{
+    (void)workerPool;
+    g_worker_pool_do_work = doWork;
+    g_worker_pool_do_work_context = context;
+    return TEST_WORKER_POOL_ITEM_HANDLE;
+}
+
+static IOTHUB_CLIENT_STATUS g_send_status;
+
 static IOTHUB_CLIENT_RESULT my_IoTHubClient_LL_GetSendStatus(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATUS *iotHubClientStatus)
 {
     (void)iotHubClientHandle;
-    *iotHubClientStatus = IOTHUB_CLIENT_SEND_STATUS_IDLE;
+    *iotHubClientStatus = g_send_status;
     return IOTHUB_CLIENT_OK;
 }
 
@@ -200,6 +238,14 @@ static IOTHUB_CLIENT_RESULT my_IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_H
     return IOTHUB_CLIENT_OK;
 }
 
+static IOTHUB_CLIENT_RESULT my_IoTHubClient_LL_SetEventConfirmationBatchCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK batchCallback, void* userContextCallback)
+{
+    (void)iotHubClientHandle;
+    g_eventConfirmationBatchCallback = batchCallback;
+    g_userContextCallback = userContextCallback;
+    return IOTHUB_CLIENT_OK;
+}
+
 static IOTHUB_CLIENT_RESULT my_IoTHubClient_LL_SetDeviceTwinCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK deviceTwinCallback, void* userContextCallback)
 {
     (void)iotHubClientHandle;
@@ -342,6 +388,8 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_LL_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(THREAD_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_EVENT_CONFIRMATION_BATCH_CALLBACK, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const IOTHUB_CLIENT_EVENT_CONFIRMATION*, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_CONFIRMATION_RESULT, int);
     REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_TRANSPORT_PROVIDER, void*);
@@ -372,6 +420,11 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(METHOD_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(STRING_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(BUFFER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_WORKER_POOL_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(WORKER_POOL_ITEM_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(WORKER_POOL_DO_WORK, void*);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
@@ -385,6 +438,10 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_CreateWithTransport, NULL);
     REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_LL_SendEventAsync, my_IoTHubClient_LL_SendEventAsync);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_SendEventAsync, IOTHUB_CLIENT_ERROR);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_LL_SendEventAsync_TakeOwnership, my_IoTHubClient_LL_SendEventAsync);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_SendEventAsync_TakeOwnership, IOTHUB_CLIENT_ERROR);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_LL_SetEventConfirmationBatchCallback, my_IoTHubClient_LL_SetEventConfirmationBatchCallback);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_SetEventConfirmationBatchCallback, IOTHUB_CLIENT_ERROR);
     REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_LL_GetSendStatus, my_IoTHubClient_LL_GetSendStatus);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_GetSendStatus, IOTHUB_CLIENT_ERROR);
     REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_LL_GetLastMessageReceiveTime, my_IoTHubClient_LL_GetLastMessageReceiveTime);
@@ -409,6 +466,7 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_UploadToBlob, IOTHUB_CLIENT_ERROR);
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_LL_GetRetryPolicy, IOTHUB_CLIENT_OK);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_LL_GetRetryPolicy, IOTHUB_CLIENT_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_LL_GetTimeToNextTimeout, __LINE__);
 
     REGISTER_GLOBAL_MOCK_HOOK(IoTHubTransport_GetLock, my_IoTHubTransport_GetLock);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubTransport_GetLock, NULL);
@@ -434,6 +492,12 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(Unlock, LOCK_ERROR);
 
     REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Sleep, my_ThreadAPI_Sleep);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Condition_Init, TEST_COND_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Condition_Init, NULL);
+    REGISTER_GLOBAL_MOCK_RETURN(Condition_Post, COND_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Condition_Post, COND_ERROR);
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Wait, my_Condition_Wait);
     REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Join, my_ThreadAPI_Join);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(ThreadAPI_Join, THREADAPI_ERROR);
 
@@ -457,6 +521,9 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(singlylinkedlist_add, NULL);
 
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubTransport_SignalEndWorkerThread, true);
+
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_WorkerPool_Add, my_IoTHubClient_WorkerPool_Add);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubClient_WorkerPool_Add, NULL);
 }
 
 TEST_SUITE_CLEANUP(suite_cleanup)
@@ -473,14 +540,18 @@ TEST_FUNCTION_INITIALIZE(method_init)
 
     g_thread_func = NULL;
     g_thread_func_arg = NULL;
+    g_worker_pool_do_work = NULL;
+    g_worker_pool_do_work_context = NULL;
     g_userContextCallback = NULL;
     g_how_thread_loops = 0;
     g_thread_loop_count = 0;
     g_queue_element = NULL;
     g_queue_element_size = 0;
     g_queue_number_items = 0;
+    g_send_status = IOTHUB_CLIENT_SEND_STATUS_IDLE;
     
     g_eventConfirmationCallback = NULL;
+    g_eventConfirmationBatchCallback = NULL;
     g_deviceTwinCallback = NULL;
     g_reportedStateCallback = NULL;
     g_connectionStatusCallback = NULL;
@@ -511,6 +582,9 @@ static void setup_create_iothub_instance(bool use_ll_create)
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG) );
     STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Init());
     STRICT_EXPECTED_CALL(singlylinkedlist_create());
     STRICT_EXPECTED_CALL(Lock_Init());
     if (use_ll_create)
@@ -528,6 +602,9 @@ static void setup_iothubclient_createwithtransport()
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG) );
     STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Init());
     STRICT_EXPECTED_CALL(singlylinkedlist_create());
 
     STRICT_EXPECTED_CALL(IoTHubTransport_GetLock(TEST_TRANSPORT_HANDLE));
@@ -546,6 +623,7 @@ static void setup_iothubclient_sendeventasync(bool use_threads)
         .IgnoreArgument_handle();
     if (use_threads)
     {
+        STRICT_EXPECTED_CALL(Condition_Init());
         EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     }
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
@@ -554,6 +632,10 @@ static void setup_iothubclient_sendeventasync(bool use_threads)
         .IgnoreArgument(1)
         .IgnoreArgument(3)
         .IgnoreArgument(4);
+    if (use_threads)
+    {
+        STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    }
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
 }
@@ -569,6 +651,7 @@ static void setup_iothubclient_uploadtoblobasync()
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is adding UPLOADTOBLOB_SAVED_DATA to the list of UPLOADTOBLOB_SAVED_DATAs to be cleaned*/
         .IgnoreArgument(1)
@@ -821,7 +904,7 @@ TEST_FUNCTION(IoTHubClient_CreateWithTransport_fail)
     client_config.deviceSasToken = TEST_DEVICE_SAS;
     client_config.protocol = TEST_TRANSPORT_PROVIDER;
 
-    size_t calls_cannot_fail[] = { 7 };
+    size_t calls_cannot_fail[] = { 9 };
 
     // act
     size_t count = umock_c_negative_tests_call_count();
@@ -885,6 +968,9 @@ TEST_FUNCTION(IoTHubClient_Destroy_succeed)
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
     STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG) );
@@ -938,6 +1024,40 @@ TEST_FUNCTION(IoTHubClient_SendEventAsync_succeed)
     IoTHubClient_Destroy(iothub_handle);
 }
 
+/* Tests_SRS_IOTHUBCLIENT_41_014: [ IoTHubClient_SendEventAsync_TakeOwnership shall behave like IoTHubClient_SendEventAsync. ] */
+/* Tests_SRS_IOTHUBCLIENT_41_015: [ IoTHubClient_SendEventAsync_TakeOwnership shall call IoTHubClient_LL_SendEventAsync_TakeOwnership instead of IoTHubClient_LL_SendEventAsync. ] */
+TEST_FUNCTION(IoTHubClient_SendEventAsync_TakeOwnership_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_SendEventAsync_TakeOwnership(IGNORED_PTR_ARG, TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(3)
+        .IgnoreArgument(4);
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SendEventAsync_TakeOwnership(iothub_handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    my_gballoc_free(g_userContextCallback);
+    IoTHubClient_Destroy(iothub_handle);
+}
+
 /* Tests_SRS_IOTHUBCLIENT_01_010: [If starting the thread fails, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_ERROR.] */
 /* Tests_SRS_IOTHUBCLIENT_01_011: [If iotHubClientHandle is NULL, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_INVALID_ARG.] */
 /* Tests_SRS_IOTHUBCLIENT_01_013: [When IoTHubClient_LL_SendEventAsync is called, IoTHubClient_SendEventAsync shall return the result of IoTHubClient_LL_SendEventAsync.] */
@@ -984,6 +1104,7 @@ TEST_FUNCTION(IoTHubClient_SendEventAsync_fail)
 }
 
 /* Tests_SRS_IOTHUBCLIENT_07_001: [ IoTHubClient_SendEventAsync shall allocate a IOTHUB_QUEUE_CONTEXT object to be sent to the IoTHubClient_LL_SendEventAsync function as a user context. ] */
+/* Tests_SRS_IOTHUBCLIENT_41_022: [ Each callback received from IoTHubClient_LL shall be queued, together with the user callback set at that time, under a lock that only guards the queue. ]*/
 TEST_FUNCTION(IoTHubClient_SendEventAsync_event_confirm_callback_succeed)
 {
     // arrange
@@ -991,8 +1112,12 @@ TEST_FUNCTION(IoTHubClient_SendEventAsync_event_confirm_callback_succeed)
     (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, NULL);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_push_back(TEST_VECTOR_HANDLE, IGNORED_PTR_ARG, 1))
         .IgnoreArgument_elements();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG) );
 
     // act
@@ -1101,6 +1226,7 @@ TEST_FUNCTION(IoTHubClient_SetMessageCallback_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetMessageCallback(TEST_IOTHUB_CLIENT_HANDLE, test_message_confirmation_callback, NULL));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -1187,6 +1313,7 @@ TEST_FUNCTION(IoTHubClient_SetConnectionStatusCallback_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument_size();
@@ -1218,6 +1345,7 @@ TEST_FUNCTION(IoTHubClient_SetConnectionStatusCallback_fail)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument_size();
@@ -1273,6 +1401,7 @@ TEST_FUNCTION(IoTHubClient_SetRetryPolicy_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetRetryPolicy(TEST_IOTHUB_CLIENT_HANDLE, retry_policy, retry_in_seconds))
         .IgnoreArgument(2);
@@ -1319,6 +1448,7 @@ TEST_FUNCTION(IoTHubClient_GetRetryPolicy_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_GetRetryPolicy(TEST_IOTHUB_CLIENT_HANDLE, &retry_policy, &retry_in_seconds));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -1627,6 +1757,7 @@ TEST_FUNCTION(IoTHubClient_SetDeviceTwinCallback_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument_size();
@@ -1705,8 +1836,12 @@ TEST_FUNCTION(IoTHubClient_SetDeviceTwinCallback_device_twin_callback_succeed)
     (void)IoTHubClient_SetDeviceTwinCallback(iothub_handle, test_device_twin_callback, NULL);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_push_back(TEST_VECTOR_HANDLE, IGNORED_PTR_ARG, 1))
         .IgnoreArgument_elements();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
 
     // act
     g_deviceTwinCallback(DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0, g_userContextCallback);
@@ -1746,12 +1881,14 @@ TEST_FUNCTION(IoTHubClient_SendReportedState_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .IgnoreArgument_size();
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SendReportedState(TEST_IOTHUB_CLIENT_HANDLE, reported_state, 1, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument_reportedStateCallback()
         .IgnoreArgument_userContextCallback();
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
 
@@ -1829,8 +1966,12 @@ TEST_FUNCTION(IoTHubClient_SendReportedState_report_state_callback_succeed)
     IOTHUB_CLIENT_RESULT result = IoTHubClient_SendReportedState(iothub_handle, reported_state, 1, test_report_state_callback, NULL);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_push_back(TEST_VECTOR_HANDLE, IGNORED_PTR_ARG, 1))
         .IgnoreArgument_elements();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG) );
 
     // act
@@ -1874,6 +2015,7 @@ TEST_FUNCTION(IoTHubClient_SetDeviceMethodCallback_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetDeviceMethodCallback(TEST_IOTHUB_CLIENT_HANDLE, test_method_callback, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -1965,6 +2107,7 @@ TEST_FUNCTION(IoTHubClient_SetDeviceMethodCallback_Ex_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetDeviceMethodCallback_Ex(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1997,6 +2140,7 @@ TEST_FUNCTION(IoTHubClient_SetDeviceMethodCallback_Ex_NonNULL_callback_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetDeviceMethodCallback_Ex(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2029,7 +2173,11 @@ TEST_FUNCTION(IoTHubClient_call_inbound_device_callback_succeed)
     STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
         .IgnoreArgument_psz();
     EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     EXPECTED_CALL(VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument_ptr();
 
@@ -2076,6 +2224,7 @@ TEST_FUNCTION(IoTHubClient_SetDeviceMethodCallback_Ex_remove_succeed)
 
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
     EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubClient_LL_SetDeviceMethodCallback_Ex(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -2273,11 +2422,9 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_incoming_method_callback_succeed)
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE)).SetReturn(1);
-
-    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
-
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
     STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
@@ -2288,16 +2435,25 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_incoming_method_callback_succeed)
         .IgnoreArgument_method_name()
         .IgnoreArgument_payload()
         .IgnoreArgument_size();
-    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-    STRICT_EXPECTED_CALL(ThreadAPI_Sleep(1));
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -2333,19 +2489,25 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_device_twin_succeed)
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE)).SetReturn(1);
-
-    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
-
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
     STRICT_EXPECTED_CALL(test_device_twin_callback(DEVICE_TWIN_UPDATE_COMPLETE, NULL, 0, NULL));
+    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-
-    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-    STRICT_EXPECTED_CALL(ThreadAPI_Sleep(1));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -2363,7 +2525,7 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_device_twin_succeed)
 }
 
 /* Tests_SRS_IOTHUBCLIENT_07_001: [ IoTHubClient_SendEventAsync shall allocate a IOTHUB_QUEUE_CONTEXT object to be sent to the IoTHubClient_LL_SendEventAsync function as a user context. ]*/
-/* Tests_SRS_IOTHUBCLIENT_01_037: [The thread created by IoTHubClient_Create shall call IoTHubClient_LL_DoWork every 1 ms.] */
+/* Tests_SRS_IOTHUBCLIENT_01_037: [The thread created by IoTHubClient_SendEvent or IoTHubClient_SetMessageCallback shall call IoTHubClient_LL_DoWork every 1 ms, unless a longer idle wait is configured with OPTION_DO_WORK_FREQUENCY_IN_MS.] */
 /* Tests_SRS_IOTHUBCLIENT_01_038: [The thread shall exit when IoTHubClient_Destroy is called.] */
 /* Tests_SRS_IOTHUBCLIENT_01_039: [All calls to IoTHubClient_LL_DoWork shall be protected by the lock created in IotHubClient_Create.] */
 /* Tests_SRS_IOTHUBCLIENT_02_072: [ All threads marked as disposable (upon completion of a file upload) shall be joined and the data structures build for them shall be freed. ]*/
@@ -2386,19 +2548,25 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_event_confirm_succeed)
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE)).SetReturn(1);
-
-    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
-
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
     STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, NULL));
+    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-
-    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-    STRICT_EXPECTED_CALL(ThreadAPI_Sleep(1));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
@@ -2416,6 +2584,8 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_event_confirm_succeed)
 }
 
 /* Tests_SRS_IOTHUBCLIENT_07_003: [ IoTHubClient_SendReportedState shall allocate a IOTHUB_QUEUE_CONTEXT object to be sent to the IoTHubClient_LL_SendReportedState function as a user context. ] */
+/* Tests_SRS_IOTHUBCLIENT_41_024: [ Dispatching shall take all the queued callbacks at once by swapping the queue with an empty one under the queue lock. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_025: [ The callbacks of a batch shall be called in the order they were queued, without holding the serializing lock or the queue lock. ]*/
 TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_reported_state_succeed)
 {
     // arrange
@@ -2436,26 +2606,213 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_reported_state_succeed)
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE)).SetReturn(1);
-
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
+    STRICT_EXPECTED_CALL(test_report_state_callback(REPORTED_STATE_STATUS_CODE, NULL));
+    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    ASSERT_IS_NOT_NULL(g_thread_func);
+    g_thread_func(g_thread_func_arg);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_005: [ If the value of "do_work_freq_ms" is 0 or greater than 100 then IoTHubClient_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_SetOption_do_work_freq_out_of_range_fails)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    tickcounter_ms_t zero_freq = 0;
+    tickcounter_ms_t too_big_freq = 101;
+    umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-    STRICT_EXPECTED_CALL(test_report_state_callback(REPORTED_STATE_STATUS_CODE, NULL));
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
 
-    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &zero_freq);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &too_big_freq);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_001: [ Between calls to IoTHubClient_LL_DoWork the thread shall wait on a condition for at most the configured do work frequency (1 ms by default), or until the next message timeout reported by IoTHubClient_LL_GetTimeToNextTimeout is due, whichever comes first. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_006: [ Otherwise IoTHubClient_SetOption shall save the value to be used by the thread and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_waits_do_work_freq_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 50))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    g_thread_func(g_thread_func_arg);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_036: [ While IoTHubClient_LL_GetSendStatus reports items being sent, the thread shall wait for at most 1 ms so that their acknowledgements are picked up without delay. ]*/
+TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_waits_1_ms_while_sending_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+    g_send_status = IOTHUB_CLIENT_SEND_STATUS_BUSY;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    g_thread_func(g_thread_func_arg);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_001: [ Between calls to IoTHubClient_LL_DoWork the thread shall wait on a condition for at most the configured do work frequency (1 ms by default), or until the next message timeout reported by IoTHubClient_LL_GetTimeToNextTimeout is due, whichever comes first. ]*/
+TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_waits_until_next_timeout_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    tickcounter_ms_t time_to_next_timeout = 3;
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout()
+        .CopyOutArgumentBuffer(2, &time_to_next_timeout, sizeof(time_to_next_timeout))
+        .SetReturn(0);
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 3))
+        .IgnoreArgument_lock();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
-    STRICT_EXPECTED_CALL(ThreadAPI_Sleep(1));
     STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
     STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument_handle();
 
     // act
-    ASSERT_IS_NOT_NULL(g_thread_func);
     g_thread_func(g_thread_func_arg);
 
     // assert
@@ -2465,4 +2822,747 @@ TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_reported_state_succeed)
     IoTHubClient_Destroy(iothub_handle);
 }
 
+/* Tests_SRS_IOTHUBCLIENT_41_002: [ IoTHubClient_SendEventAsync, IoTHubClient_SendReportedState and IoTHubClient_DeviceMethodResponse shall signal the condition when the call to the IoTHubClient_LL layer succeeds so that the thread processes the new item without waiting. ]*/
+TEST_FUNCTION(IoTHubClient_DeviceMethodResponse_signals_worker_thread_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    (void)IoTHubClient_SetDeviceMethodCallback_Ex(iothub_handle, test_incoming_method_callback, CALLBACK_CONTEXT);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DeviceMethodResponse(TEST_IOTHUB_CLIENT_HANDLE, TEST_METHOD_ID, TEST_DEVICE_METHOD_RESPONSE, TEST_DEVICE_RESP_LENGTH, REPORTED_STATE_STATUS_CODE));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_DeviceMethodResponse(iothub_handle, TEST_METHOD_ID, TEST_DEVICE_METHOD_RESPONSE, TEST_DEVICE_RESP_LENGTH, REPORTED_STATE_STATUS_CODE);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_004: [ IoTHubClient_Destroy shall signal the condition after asking the thread to stop and shall free the condition after the thread has been joined. ]*/
+TEST_FUNCTION(IoTHubClient_Destroy_with_worker_thread_signals_and_frees_condition_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientHandle();
+    STRICT_EXPECTED_CALL(singlylinkedlist_destroy(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_res();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubClient_Destroy(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_029: [ If optionName is OPTION_DISPATCH_CALLBACKS_ON_THREAD and value is true, IoTHubClient_SetOption shall start a thread dispatching the user callbacks, unless it runs already. ]*/
+TEST_FUNCTION(IoTHubClient_SetOption_dispatch_callbacks_on_thread_starts_thread_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    bool dispatch_on_thread = true;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Init());
+    EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_030: [ If value is false and the dispatch thread runs already, IoTHubClient_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_SetOption_dispatch_callbacks_on_thread_false_after_start_fails)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    bool dispatch_on_thread = true;
+    bool dispatch_on_worker = false;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_worker);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_026: [ If callbacks are dispatched on their own thread, the worker thread shall not dispatch them. ]*/
+TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_with_dispatch_thread_does_not_dispatch_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    bool dispatch_on_thread = true;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    g_thread_func(g_thread_func_arg);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_023: [ If callbacks are dispatched on their own thread, queueing a callback shall wake that thread up. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_025: [ The callbacks of a batch shall be called in the order they were queued, without holding the serializing lock or the queue lock. ]*/
+TEST_FUNCTION(IoTHubClient_dispatch_thread_dispatches_queued_callbacks_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    bool dispatch_on_thread = true;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+    THREAD_START_FUNC dispatch_thread_func = g_thread_func;
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_push_back(TEST_VECTOR_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_elements();
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    g_eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, g_userContextCallback);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, NULL));
+    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 0))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    dispatch_thread_func(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_028: [ IoTHubClient_Destroy shall stop and join the thread dispatching callbacks (if any) before taking the serializing lock. ]*/
+TEST_FUNCTION(IoTHubClient_Destroy_with_dispatch_thread_joins_it_first_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    bool dispatch_on_thread = true;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DISPATCH_CALLBACKS_ON_THREAD, &dispatch_on_thread);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Post(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_res();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientHandle();
+    STRICT_EXPECTED_CALL(singlylinkedlist_destroy(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Condition_Deinit(TEST_COND_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubClient_Destroy(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_016: [ If iotHubClientHandle is NULL, IoTHubClient_GetMessagePoolStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_GetMessagePoolStatistics_handle_NULL_fail)
+{
+    // arrange
+    IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS statistics;
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_GetMessagePoolStatistics(NULL, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_017: [ IoTHubClient_GetMessagePoolStatistics shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_018: [ IoTHubClient_GetMessagePoolStatistics shall call IoTHubClient_LL_GetMessagePoolStatistics and return its result. ]*/
+TEST_FUNCTION(IoTHubClient_GetMessagePoolStatistics_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    IOTHUB_CLIENT_MESSAGE_POOL_STATISTICS statistics;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetMessagePoolStatistics(TEST_IOTHUB_CLIENT_HANDLE, &statistics))
+        .SetReturn(IOTHUB_CLIENT_ERROR);
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_GetMessagePoolStatistics(iothub_handle, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_019: [ If iotHubClientHandle is NULL, IoTHubClient_GetSendQueueStatus shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_GetSendQueueStatus_handle_NULL_fail)
+{
+    // arrange
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_GetSendQueueStatus(NULL, &status);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_020: [ IoTHubClient_GetSendQueueStatus shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_021: [ IoTHubClient_GetSendQueueStatus shall call IoTHubClient_LL_GetSendQueueStatus and return its result. ]*/
+TEST_FUNCTION(IoTHubClient_GetSendQueueStatus_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    IOTHUB_CLIENT_SEND_QUEUE_STATUS status;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendQueueStatus(TEST_IOTHUB_CLIENT_HANDLE, &status));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_GetSendQueueStatus(iothub_handle, &status);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_031: [ If iotHubClientHandle is NULL, IoTHubClient_SetEventConfirmationBatchCallback shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_SetEventConfirmationBatchCallback_handle_NULL_fail)
+{
+    // arrange
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetEventConfirmationBatchCallback(NULL, test_event_confirmation_batch_callback, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_032: [ IoTHubClient_SetEventConfirmationBatchCallback shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_033: [ If the transport is shared or batchCallback is NULL, IoTHubClient_SetEventConfirmationBatchCallback shall call IoTHubClient_LL_SetEventConfirmationBatchCallback with batchCallback and userContextCallback and return its result. ]*/
+TEST_FUNCTION(IoTHubClient_SetEventConfirmationBatchCallback_NULL_callback_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_SetEventConfirmationBatchCallback(TEST_IOTHUB_CLIENT_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetEventConfirmationBatchCallback(iothub_handle, NULL, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_034: [ Otherwise IoTHubClient_SetEventConfirmationBatchCallback shall call IoTHubClient_LL_SetEventConfirmationBatchCallback with its own batch callback, which queues every batch to be dispatched to batchCallback like the other user callbacks, and return its result. ]*/
+TEST_FUNCTION(IoTHubClient_SetEventConfirmationBatchCallback_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_SetEventConfirmationBatchCallback(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG, iothub_handle))
+        .IgnoreArgument_batchCallback();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetEventConfirmationBatchCallback(iothub_handle, test_event_confirmation_batch_callback, (void*)0x42);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_NOT_NULL(g_eventConfirmationBatchCallback);
+    ASSERT_IS_TRUE(g_eventConfirmationBatchCallback != test_event_confirmation_batch_callback);
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_035: [ When IoTHubClient_LL reports a batch of confirmations, the whole batch shall be copied and queued as one callback, dispatched with a single call to the batch callback. ]*/
+TEST_FUNCTION(IoTHubClient_ScheduleWork_Thread_event_confirm_batch_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_EVENT_CONFIRMATION confirmations[2] = { { (void*)1, IOTHUB_CLIENT_CONFIRMATION_OK }, { (void*)2, IOTHUB_CLIENT_CONFIRMATION_ERROR } };
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, (void*)1);
+    (void)IoTHubClient_SetEventConfirmationBatchCallback(iothub_handle, test_event_confirmation_batch_callback, (void*)0x42);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(2 * sizeof(IOTHUB_CLIENT_EVENT_CONFIRMATION)));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_push_back(TEST_VECTOR_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_elements();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    g_eventConfirmationBatchCallback(confirmations, 2, g_userContextCallback);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    umock_c_reset_all_calls();
+
+    g_how_thread_loops = 1;
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_element(TEST_VECTOR_HANDLE, 0));
+    STRICT_EXPECTED_CALL(test_event_confirmation_batch_callback(IGNORED_PTR_ARG, 2, (void*)0x42))
+        .IgnoreArgument_confirmations();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(VECTOR_clear(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Condition_Wait(TEST_COND_HANDLE, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument_lock();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    ASSERT_IS_NOT_NULL(g_thread_func);
+    g_thread_func(g_thread_func_arg);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_010: [ If iotHubClientHandle or workerPool is NULL, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_SetWorkerPool_handle_NULL_fail)
+{
+    // arrange
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetWorkerPool(NULL, TEST_WORKER_POOL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_011: [ If the client was created with IoTHubClient_CreateWithTransport, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_SetWorkerPool_with_shared_transport_fail)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_CreateWithTransport(TEST_TRANSPORT_HANDLE, TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetWorkerPool(iothub_handle, TEST_WORKER_POOL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_012: [ If the worker thread was already started, IoTHubClient_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_SetWorkerPool_after_thread_started_fail)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SetWorkerPool(iothub_handle, TEST_WORKER_POOL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_008: [ If a worker pool was set, the client shall be added to the worker pool instead of starting a thread. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_013: [ Otherwise IoTHubClient_SetWorkerPool shall remember workerPool, to be used when the worker thread would have been started, and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_SendEventAsync_with_worker_pool_adds_to_pool_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    IOTHUB_CLIENT_RESULT set_result = IoTHubClient_SetWorkerPool(iothub_handle, TEST_WORKER_POOL_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_WorkerPool_Add(TEST_WORKER_POOL_HANDLE, IGNORED_PTR_ARG, iothub_handle))
+        .IgnoreArgument_doWork();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_SendEventAsync(TEST_IOTHUB_CLIENT_HANDLE, TEST_MESSAGE_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(IoTHubClient_WorkerPool_Signal(TEST_WORKER_POOL_ITEM_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, set_result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_IS_NOT_NULL(g_worker_pool_do_work);
+    ASSERT_IS_NULL(g_thread_func);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_038: [ If the transport connection is shared, signalling work shall call IoTHubTransport_SignalWork. ]*/
+TEST_FUNCTION(IoTHubClient_SendEventAsync_with_shared_transport_signals_transport_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_CreateWithTransport(TEST_TRANSPORT_HANDLE, TEST_CLIENT_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubTransport_StartWorkerThread(TEST_TRANSPORT_HANDLE, iothub_handle));
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_SendEventAsync(IGNORED_PTR_ARG, TEST_MESSAGE_HANDLE, NULL, NULL))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubTransport_SignalWork(TEST_TRANSPORT_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_037: [ IoTHubClient_GetTimeToWait shall return the time the worker thread of the client would wait before calling IoTHubClient_LL_DoWork again. ]*/
+TEST_FUNCTION(IoTHubClient_GetTimeToWait_returns_do_work_freq_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_CreateWithTransport(TEST_TRANSPORT_HANDLE, TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+
+    // act
+    tickcounter_ms_t result = IoTHubClient_GetTimeToWait(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 50, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_037: [ IoTHubClient_GetTimeToWait shall return the time the worker thread of the client would wait before calling IoTHubClient_LL_DoWork again. ]*/
+/* Tests_SRS_IOTHUBCLIENT_41_036: [ While IoTHubClient_LL_GetSendStatus reports items being sent, the thread shall wait for at most 1 ms so that their acknowledgements are picked up without delay. ]*/
+TEST_FUNCTION(IoTHubClient_GetTimeToWait_while_sending_returns_1_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_CreateWithTransport(TEST_TRANSPORT_HANDLE, TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    umock_c_reset_all_calls();
+
+    g_send_status = IOTHUB_CLIENT_SEND_STATUS_BUSY;
+
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+
+    // act
+    tickcounter_ms_t result = IoTHubClient_GetTimeToWait(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 1, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_007: [ Each time the worker pool runs the client it shall do the same work as one iteration of the worker thread and ask to be run again after the same time the worker thread would wait. ]*/
+TEST_FUNCTION(IoTHubClient_worker_pool_do_work_returns_do_work_freq_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    tickcounter_ms_t do_work_freq = 50;
+    (void)IoTHubClient_SetWorkerPool(iothub_handle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    (void)IoTHubClient_SetOption(iothub_handle, OPTION_DO_WORK_FREQUENCY_IN_MS, &do_work_freq);
+    /*the work signalled by the send above is picked up by a first run*/
+    (void)g_worker_pool_do_work(g_worker_pool_do_work_context);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_DoWork(TEST_IOTHUB_CLIENT_HANDLE));
+    STRICT_EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetSendStatus(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientStatus();
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_GetTimeToNextTimeout(TEST_IOTHUB_CLIENT_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument_time_to_next_timeout();
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    // act
+    tickcounter_ms_t run_after = g_worker_pool_do_work(g_worker_pool_do_work_context);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 50, (int)run_after);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubClient_Destroy(iothub_handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_41_009: [ If the client was added to a worker pool, IoTHubClient_Destroy shall remove it from the pool after unlocking the serializing lock. ]*/
+TEST_FUNCTION(IoTHubClient_Destroy_with_worker_pool_removes_item_succeed)
+{
+    // arrange
+    IOTHUB_CLIENT_HANDLE iothub_handle = IoTHubClient_Create(TEST_CLIENT_CONFIG);
+    (void)IoTHubClient_SetWorkerPool(iothub_handle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubClient_SendEventAsync(iothub_handle, TEST_MESSAGE_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(singlylinkedlist_get_head_item(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_WorkerPool_Signal(TEST_WORKER_POOL_ITEM_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument_iotHubClientHandle();
+    STRICT_EXPECTED_CALL(singlylinkedlist_destroy(TEST_SLL_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(IoTHubClient_WorkerPool_Remove(TEST_WORKER_POOL_ITEM_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_size(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(VECTOR_destroy(TEST_VECTOR_HANDLE));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubClient_Destroy(iothub_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+}
+
 END_TEST_SUITE(iothubclient_ut)
@@ -96,6 +96,15 @@ static size_t whenShallSTRING_concat_with_STRING_fail;
 static MAP_FILTER_CALLBACK g_mapFilterFunc;
 
 static const unsigned char c[1] = { '3' };
+static size_t releaseCallbackCount;
+static void* releaseCallbackContext;
+
+static void TestReleaseCallback(void* releaseContext)
+{
+    releaseCallbackCount++;
+    releaseCallbackContext = releaseContext;
+}
+
 static const char* TEST_MESSAGE_ID = "3820ADAE-E3CA-4065-843A-A6BDE950D8DC";
 static const char* TEST_MESSAGE_ID2 = "052BA01A-ECBF-48CF-BC7B-64B315D898B7";
 
@@ -414,6 +423,9 @@ BEGIN_TEST_SUITE(iothubmessage_ut)
         currentBUFFER_create_call = 0;
         whenShallBUFFER_create_fail = 0;
 
+        releaseCallbackCount = 0;
+        releaseCallbackContext = NULL;
+
         currentBUFFER_clone_call = 0;
         whenShallBUFFER_clone_fail = 0;
 
@@ -750,6 +762,149 @@ BEGIN_TEST_SUITE(iothubmessage_ut)
         ///cleanup
     }
 
+    /*Tests_SRS_IOTHUBMESSAGE_41_003: [IoTHubMessage_CreateFromByteArrayWithRelease shall call Map_Create to create the message properties.] */
+    /*Tests_SRS_IOTHUBMESSAGE_41_004: [IoTHubMessage_CreateFromByteArrayWithRelease shall not copy byteArray; the message shall refer to it until the message is destroyed.] */
+    /*Tests_SRS_IOTHUBMESSAGE_41_005: [The type of the new message shall be IOTHUBMESSAGE_BYTEARRAY.] */
+    TEST_FUNCTION(IoTHubMessage_CreateFromByteArrayWithRelease_happy_path)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(c, 1, TestReleaseCallback, (void*)0x42);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(h);
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(IOTHUBMESSAGE_CONTENT_TYPE, IOTHUBMESSAGE_BYTEARRAY, IoTHubMessage_GetContentType(h));
+        ASSERT_ARE_EQUAL(size_t, 0, releaseCallbackCount);
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_41_001: [If size is not zero and byteArray is NULL, IoTHubMessage_CreateFromByteArrayWithRelease shall return NULL.] */
+    TEST_FUNCTION(IoTHubMessage_CreateFromByteArrayWithRelease_fails_when_size_non_zero_buffer_NULL)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(NULL, 1, TestReleaseCallback, NULL);
+
+        ///assert
+        ASSERT_IS_NULL(h);
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(size_t, 0, releaseCallbackCount);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_41_002: [If there are any errors then IoTHubMessage_CreateFromByteArrayWithRelease shall return NULL.] */
+    TEST_FUNCTION(IoTHubMessage_CreateFromByteArrayWithRelease_fails_when_Map_Create_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        whenShallMap_Create_fail = currentMap_Create_call + 1;
+        STRICT_EXPECTED_CALL(mocks, Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(c, 1, TestReleaseCallback, NULL);
+
+        ///assert
+        ASSERT_IS_NULL(h);
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(size_t, 0, releaseCallbackCount);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_41_007: [If the message refers to caller owned memory, IoTHubMessage_GetByteArray shall return that memory and its size.] */
+    TEST_FUNCTION(IoTHubMessage_GetByteArray_with_caller_owned_memory_returns_that_memory)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(c, 1, TestReleaseCallback, NULL);
+        const unsigned char* byteArray;
+        size_t size;
+        mocks.ResetAllCalls();
+
+        ///act
+        auto r = IoTHubMessage_GetByteArray(h, &byteArray, &size);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, r);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)c, (void*)byteArray);
+        ASSERT_ARE_EQUAL(size_t, 1, size);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_41_006: [If the message refers to caller owned memory, IoTHubMessage_Clone shall copy it by calling BUFFER_create; the clone shall not refer to the caller owned memory.] */
+    TEST_FUNCTION(IoTHubMessage_Clone_with_caller_owned_memory_copies_it)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(c, 1, TestReleaseCallback, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_create(c, 1));
+        STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto r = IoTHubMessage_Clone(h);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(r);
+        mocks.AssertActualAndExpectedCalls();
+        IoTHubMessage_Destroy(h);
+        ASSERT_ARE_EQUAL(size_t, 1, releaseCallbackCount);
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_41_008: [If the message refers to caller owned memory and releaseCallback is not NULL, IoTHubMessage_Destroy shall call releaseCallback passing releaseContext.] */
+    TEST_FUNCTION(IoTHubMessage_Destroy_with_caller_owned_memory_calls_releaseCallback)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArrayWithRelease(c, 1, TestReleaseCallback, (void*)0x42);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(h));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(NULL));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(NULL));
+
+        ///act
+        IoTHubMessage_Destroy(h);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(size_t, 1, releaseCallbackCount);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)0x42, releaseCallbackContext);
+
+        ///cleanup
+    }
+
     /*Tests_SRS_IOTHUBMESSAGE_01_003: [IoTHubMessage_Destroy shall free all resources associated with iotHubMessageHandle.]  */
     TEST_FUNCTION(IoTHubMessage_Destroy_destroys_a_BYTEARRAY_IoTHubMEssage)
     {
@@ -1524,4 +1679,84 @@ BEGIN_TEST_SUITE(iothubmessage_ut)
         IoTHubMessage_Destroy(h);
     }
 
+    /* Tests_SRS_IOTHUBMESSAGE_41_009: [if the iotHubMessageHandle parameter is NULL then IoTHubMessage_SetPriority shall return IOTHUB_MESSAGE_INVALID_ARG.] */
+    TEST_FUNCTION(IoTHubMessage_SetPriority_NULL_handle_Fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(NULL, 1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_INVALID_ARG, result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /* Tests_SRS_IOTHUBMESSAGE_41_010: [IoTHubMessage_SetPriority shall store priority in the message and return IOTHUB_MESSAGE_OK.] */
+    /* Tests_SRS_IOTHUBMESSAGE_41_013: [IoTHubMessage_GetPriority shall return the priority of the message, 0 when it was never set.] */
+    TEST_FUNCTION(IoTHubMessage_SetPriority_SUCCEED)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        int defaultPriority = IoTHubMessage_GetPriority(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(h, 7);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, result);
+        ASSERT_ARE_EQUAL(int, 0, defaultPriority);
+        ASSERT_ARE_EQUAL(int, 7, IoTHubMessage_GetPriority(h));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /* Tests_SRS_IOTHUBMESSAGE_41_012: [if the iotHubMessageHandle parameter is NULL then IoTHubMessage_GetPriority shall return 0.] */
+    TEST_FUNCTION(IoTHubMessage_GetPriority_NULL_handle_returns_0)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        int result = IoTHubMessage_GetPriority(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /* Tests_SRS_IOTHUBMESSAGE_41_011: [IoTHubMessage_Clone shall copy the priority of the message.] */
+    TEST_FUNCTION(IoTHubMessage_Clone_copies_the_priority)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("c, 1");
+        (void)IoTHubMessage_SetPriority(h, -3);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto r = IoTHubMessage_Clone(h);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(r);
+        ASSERT_ARE_EQUAL(int, -3, IoTHubMessage_GetPriority(r));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+        IoTHubMessage_Destroy(h);
+    }
+
 END_TEST_SUITE(iothubmessage_ut)
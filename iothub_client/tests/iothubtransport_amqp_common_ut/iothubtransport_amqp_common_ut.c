@@ -69,6 +69,7 @@ extern "C"
 #include "azure_c_shared_utility/tlsio.h"
 #include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/agenttime.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 #include "azure_uamqp_c/cbs.h"
 #include "azure_uamqp_c/link.h"
@@ -89,6 +90,7 @@ extern "C"
 #include "iothub_client_version.h"
 #undef ENABLE_MOCKS
 
+#include "iothub_client_record_pool.h"
 #include "iothubtransport_amqp_common.h"
 
 #ifdef __cplusplus
@@ -250,6 +252,10 @@ static TEST_MUTEX_HANDLE g_dllByDll;
 
 #define TEST_UNDERLYING_IO_TRANSPORT        ((XIO_HANDLE)0x4261)
 #define TEST_TRANSPORT_PROVIDER             ((TRANSPORT_PROVIDER*)0x4263)
+#define TEST_BATCH_MESSAGE                  ((MESSAGE_HANDLE)0x4264)
+#define TEST_TICK_COUNTER_HANDLE            ((TICK_COUNTER_HANDLE)0x4265)
+#define TEST_EVENT_MESSAGE_HANDLE           ((IOTHUB_MESSAGE_HANDLE)0x4266)
+#define TEST_ENCODED_EVENT_SIZE             10
 
 static const unsigned char* TEST_DEVICE_METHOD_RESPONSE = (const unsigned char*)0x62;
 static size_t TEST_DEVICE_RESP_LENGTH = 1;
@@ -304,6 +310,145 @@ static IOTHUBTRANSPORT_CONFIG* create_transport_config(IOTHUB_CLIENT_TRANSPORT_P
     return &config;
 }
 
+static ON_MESSAGE_SENDER_STATE_CHANGED g_on_message_sender_state_changed;
+static void* g_on_message_sender_state_changed_context;
+static ON_MESSAGE_SEND_COMPLETE g_on_message_send_complete[2];
+static void* g_on_message_send_complete_context[2];
+static size_t g_messagesender_send_count;
+static tickcounter_ms_t g_current_ms;
+
+static MESSAGE_SENDER_HANDLE my_messagesender_create(LINK_HANDLE link, ON_MESSAGE_SENDER_STATE_CHANGED on_message_sender_state_changed, void* context)
+{
+    (void)link;
+    g_on_message_sender_state_changed = on_message_sender_state_changed;
+    g_on_message_sender_state_changed_context = context;
+    return TEST_MESSAGE_SENDER;
+}
+
+static int my_messagesender_send(MESSAGE_SENDER_HANDLE message_sender, MESSAGE_HANDLE message, ON_MESSAGE_SEND_COMPLETE on_message_send_complete, void* callback_context)
+{
+    (void)message_sender, message;
+    if (g_messagesender_send_count < 2)
+    {
+        g_on_message_send_complete[g_messagesender_send_count] = on_message_send_complete;
+        g_on_message_send_complete_context[g_messagesender_send_count] = callback_context;
+    }
+    g_messagesender_send_count++;
+    return 0;
+}
+
+static int my_message_create_uamqp_encoding_from_iothub_message(IOTHUB_MESSAGE_HANDLE iothub_message, UAMQP_APPLICATION_PROPERTIES_CACHE* cache, BINARY_DATA* body_binary_data)
+{
+    (void)iothub_message, cache;
+    body_binary_data->bytes = (const unsigned char*)my_gballoc_malloc(TEST_ENCODED_EVENT_SIZE);
+    body_binary_data->length = TEST_ENCODED_EVENT_SIZE;
+    return 0;
+}
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = g_current_ms;
+    return 0;
+}
+
+static size_t g_event_confirmation_count;
+static IOTHUB_CLIENT_CONFIRMATION_RESULT g_event_confirmation_result;
+
+static void on_event_confirmation(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+    (void)userContextCallback;
+    g_event_confirmation_count++;
+    g_event_confirmation_result = result;
+}
+
+static void add_event_to_send(PDLIST_ENTRY waitingToSend, size_t byteCount)
+{
+    IOTHUB_MESSAGE_LIST* message = (IOTHUB_MESSAGE_LIST*)IoTHubClient_RecordPool_Alloc(NULL, sizeof(IOTHUB_MESSAGE_LIST));
+    message->messageHandle = TEST_EVENT_MESSAGE_HANDLE;
+    message->callback = on_event_confirmation;
+    message->context = NULL;
+    message->byteCount = byteCount;
+    DList_InsertTailList(waitingToSend, &message->entry);
+}
+
+static time_t g_current_time;
+
+static time_t my_get_time(time_t* currentTime)
+{
+    (void)currentTime;
+    return g_current_time;
+}
+
+static double my_get_difftime(time_t stopTime, time_t startTime)
+{
+    return (double)(stopTime - startTime);
+}
+
+static AUTHENTICATION_STATUS g_authentication_status;
+static size_t g_authentication_authenticate_count;
+
+static AUTHENTICATION_STATUS my_authentication_get_status(AUTHENTICATION_STATE_HANDLE authentication_state)
+{
+    (void)authentication_state;
+    return g_authentication_status;
+}
+
+static int my_authentication_authenticate(AUTHENTICATION_STATE_HANDLE authentication_state)
+{
+    (void)authentication_state;
+    g_authentication_authenticate_count++;
+    return 0;
+}
+
+static TRANSPORT_LL_HANDLE create_transport_with_devices_to_authenticate(IOTHUB_DEVICE_HANDLE* device_handles, PDLIST_ENTRY waitingToSend, size_t max_pending_authentications)
+{
+    TRANSPORT_LL_HANDLE handle;
+    IOTHUB_DEVICE_CONFIG device_config;
+
+    device_config.deviceKey = "cucu";
+    device_config.deviceSasToken = NULL;
+
+    g_authentication_status = AUTHENTICATION_STATUS_IDLE;
+    g_authentication_authenticate_count = 0;
+
+    DList_InitializeListHead(waitingToSend);
+    handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    device_config.deviceId = "blah1";
+    device_handles[0] = IoTHubTransport_AMQP_Common_Register(handle, &device_config, TEST_IOTHUB_CLIENT_LL_HANDLE, waitingToSend);
+    device_config.deviceId = "blah2";
+    device_handles[1] = IoTHubTransport_AMQP_Common_Register(handle, &device_config, TEST_IOTHUB_CLIENT_LL_HANDLE, waitingToSend);
+    (void)IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_MAX_PENDING_AUTHENTICATIONS, &max_pending_authentications);
+
+    return handle;
+}
+
+static TRANSPORT_LL_HANDLE create_transport_with_open_event_sender(PDLIST_ENTRY waitingToSend, size_t batch_max_bytes, size_t batch_linger_ms)
+{
+    TRANSPORT_LL_HANDLE handle;
+    IOTHUB_DEVICE_CONFIG device_config;
+
+    device_config.deviceId = "blah";
+    device_config.deviceKey = "cucu";
+    device_config.deviceSasToken = NULL;
+
+    g_messagesender_send_count = 0;
+    g_event_confirmation_count = 0;
+    g_current_ms = 0;
+
+    DList_InitializeListHead(waitingToSend);
+    handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    (void)IoTHubTransport_AMQP_Common_Register(handle, &device_config, TEST_IOTHUB_CLIENT_LL_HANDLE, waitingToSend);
+    (void)IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_MAX_BYTES, &batch_max_bytes);
+    (void)IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_LINGER_MS, &batch_linger_ms);
+
+    // connects and creates the event sender, then opens it
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    g_on_message_sender_state_changed(g_on_message_sender_state_changed_context, MESSAGE_SENDER_STATE_OPEN, MESSAGE_SENDER_STATE_OPENING);
+
+    return handle;
+}
+
 BEGIN_TEST_SUITE(iothubtransport_amqp_common_ut)
 
 TEST_SUITE_INITIALIZE(TestClassInitialize)
@@ -336,6 +481,7 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_UMOCK_ALIAS_TYPE(MAP_RESULT, int);
     REGISTER_UMOCK_ALIAS_TYPE(AMQP_TYPE, int);
     REGISTER_UMOCK_ALIAS_TYPE(VECTOR_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(time_t, uint64_t);
     REGISTER_UMOCK_ALIAS_TYPE(const VECTOR_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(PREDICATE_FUNCTION, void*);
     REGISTER_UMOCK_ALIAS_TYPE(PDLIST_ENTRY, void*);
@@ -365,6 +511,8 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_UMOCK_ALIAS_TYPE(MESSAGE_SENDER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(fields, void*);
     REGISTER_UMOCK_ALIAS_TYPE(METHOD_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_MESSAGE_SEND_COMPLETE, void*);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
@@ -385,7 +533,8 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_RETURN(saslmechanism_create, TEST_SASL_MECHANISM);
     REGISTER_GLOBAL_MOCK_RETURN(connection_create2, TEST_CONNECTION_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(cbs_create, TEST_CBS_HANDLE);
-    REGISTER_GLOBAL_MOCK_RETURN(authentication_get_status, AUTHENTICATION_STATUS_OK);
+    REGISTER_GLOBAL_MOCK_HOOK(authentication_get_status, my_authentication_get_status);
+    REGISTER_GLOBAL_MOCK_HOOK(authentication_authenticate, my_authentication_authenticate);
     REGISTER_GLOBAL_MOCK_RETURN(messaging_create_source, TEST_MESSAGING_SOURCE);
     REGISTER_GLOBAL_MOCK_RETURN(messaging_create_target, TEST_MESSAGING_TARGET);
     REGISTER_GLOBAL_MOCK_RETURN(BUFFER_new, TEST_BUFFER_HANDLE);
@@ -393,7 +542,13 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_map, TEST_AMQP_MAP);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_symbol, TEST_AMQP_VALUE);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_string, TEST_AMQP_VALUE);
-    REGISTER_GLOBAL_MOCK_RETURN(messagesender_create, TEST_MESSAGE_SENDER);
+    REGISTER_GLOBAL_MOCK_HOOK(messagesender_create, my_messagesender_create);
+    REGISTER_GLOBAL_MOCK_HOOK(messagesender_send, my_messagesender_send);
+    REGISTER_GLOBAL_MOCK_RETURN(message_create, TEST_BATCH_MESSAGE);
+    REGISTER_GLOBAL_MOCK_HOOK(message_create_uamqp_encoding_from_iothub_message, my_message_create_uamqp_encoding_from_iothub_message);
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, TEST_TICK_COUNTER_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(tickcounter_create, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
 
     REGISTER_GLOBAL_MOCK_HOOK(VECTOR_create, my_VECTOR_create);
     REGISTER_GLOBAL_MOCK_HOOK(VECTOR_destroy, my_VECTOR_destroy);
@@ -411,6 +566,9 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_HOOK(DList_InsertTailList, my_DList_InsertTailList);
     REGISTER_GLOBAL_MOCK_HOOK(DList_IsListEmpty, my_DList_IsListEmpty);
     REGISTER_GLOBAL_MOCK_HOOK(DList_InitializeListHead, my_DList_InitializeListHead);
+
+    REGISTER_GLOBAL_MOCK_HOOK(get_time, my_get_time);
+    REGISTER_GLOBAL_MOCK_HOOK(get_difftime, my_get_difftime);
 }
 
 TEST_SUITE_CLEANUP(TestClassCleanup)
@@ -428,6 +586,8 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
         ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
     }
 
+    g_authentication_status = AUTHENTICATION_STATUS_OK;
+    g_current_time = 0;
     umock_c_reset_all_calls();
 }
 
@@ -690,6 +850,7 @@ TEST_FUNCTION(IoTHubTransport_AMQP_Common_Unregister_destroys_the_methods_handle
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG));
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG));
     EXPECTED_CALL(authentication_destroy(IGNORED_PTR_ARG));
+    EXPECTED_CALL(message_clear_application_properties_cache(IGNORED_PTR_ARG));
 
 #ifdef WIP_C2D_METHODS_AMQP /* This feature is WIP, do not use yet */
     STRICT_EXPECTED_CALL(iothubtransportamqp_methods_destroy(TEST_IOTHUBTRANSPORTAMQP_METHODS));
@@ -1303,4 +1464,421 @@ TEST_FUNCTION(on_methods_error_does_nothing)
 }
 #endif
 
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_011: [If `optionName` is `amqp_batch_max_bytes`, IoTHubTransport_AMQP_Common_SetOption shall save the size_t value on the transport instance and return IOTHUB_CLIENT_OK; 0 turns batching off.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_amqp_batch_max_bytes_succeeds)
+{
+    // arrange
+    size_t batch_max_bytes = 64 * 1024;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_MAX_BYTES, &batch_max_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_012: [If `amqp_batch_max_bytes` is larger than 262144 (the largest message IoT Hub accepts), IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_amqp_batch_max_bytes_too_large_fails)
+{
+    // arrange
+    size_t batch_max_bytes = 256 * 1024 + 1;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_MAX_BYTES, &batch_max_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_013: [If `optionName` is `amqp_batch_linger_ms` and the value is not 0, IoTHubTransport_AMQP_Common_SetOption shall create the batch linger clock using tickcounter_create(), if it does not exist yet.]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_016: [Otherwise IoTHubTransport_AMQP_Common_SetOption shall save the `amqp_batch_linger_ms` size_t value on the transport instance and return IOTHUB_CLIENT_OK.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_amqp_batch_linger_ms_creates_the_clock_once)
+{
+    // arrange
+    size_t batch_linger_ms = 20;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_create());
+
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_LINGER_MS, &batch_linger_ms);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_LINGER_MS, &batch_linger_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_014: [If tickcounter_create() fails, IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_ERROR and leave `amqp_batch_linger_ms` unchanged.]
+TEST_FUNCTION(when_tickcounter_create_fails_IoTHubTransport_AMQP_Common_SetOption_amqp_batch_linger_ms_fails)
+{
+    // arrange
+    size_t batch_linger_ms = 20;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_create())
+        .SetReturn(NULL);
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_BATCH_LINGER_MS, &batch_linger_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_019: [If `optionName` is `amqp_incoming_window` or `amqp_outgoing_window`, IoTHubTransport_AMQP_Common_SetOption shall save the uint32_t value on the transport instance, to be applied when the AMQP session is next created, and return IOTHUB_CLIENT_OK.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_session_windows_succeed)
+{
+    // arrange
+    uint32_t window = 5000;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_INCOMING_WINDOW, &window);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_OUTGOING_WINDOW, &window);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_020: [If the `amqp_incoming_window` or `amqp_outgoing_window` value is 0, IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_session_window_0_fails)
+{
+    // arrange
+    uint32_t window = 0;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_INCOMING_WINDOW, &window);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_OUTGOING_WINDOW, &window);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_INVALID_ARG, result1);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_INVALID_ARG, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_021: [If `optionName` is `amqp_sender_max_message_size` or `amqp_receiver_max_message_size`, IoTHubTransport_AMQP_Common_SetOption shall save the uint64_t value on the transport instance, to be applied when the links are next created, and return IOTHUB_CLIENT_OK.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_link_max_message_sizes_succeed)
+{
+    // arrange
+    uint64_t max_message_size = 256 * 1024;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_SENDER_MAX_MESSAGE_SIZE, &max_message_size);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_RECEIVER_MAX_MESSAGE_SIZE, &max_message_size);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_027: [If `optionName` is `amqp_max_pending_authentications`, IoTHubTransport_AMQP_Common_SetOption shall save the size_t value on the transport instance and return IOTHUB_CLIENT_OK; 0 removes the limit.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_SetOption_amqp_max_pending_authentications_succeeds)
+{
+    // arrange
+    size_t max_pending_authentications = 50;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_SetOption(handle, OPTION_AMQP_MAX_PENDING_AUTHENTICATIONS, &max_pending_authentications);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_022: [IoTHubTransport_AMQP_Common_Create shall not limit the number of pending authentications (`amqp_max_pending_authentications` set to 0).]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_authenticates_all_devices_when_there_is_no_limit)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    IOTHUB_DEVICE_HANDLE device_handles[2];
+    TRANSPORT_LL_HANDLE handle = create_transport_with_devices_to_authenticate(device_handles, &waitingToSend, 0);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_authentication_authenticate_count);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_023: [A device shall hold one of the transport pending authentications from the moment authentication_authenticate() or authentication_refresh() succeeds until its authentication status is no longer AUTHENTICATION_STATUS_IN_PROGRESS.]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_025: [If `amqp_max_pending_authentications` is not 0 and that many devices hold a pending authentication, IoTHubTransport_AMQP_Common_DoWork shall not authenticate or refresh the device, and shall process the next device; the device is retried on a later DoWork.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_defers_authentications_over_the_limit)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    IOTHUB_DEVICE_HANDLE device_handles[2];
+    TRANSPORT_LL_HANDLE handle = create_transport_with_devices_to_authenticate(device_handles, &waitingToSend, 1);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    g_authentication_status = AUTHENTICATION_STATUS_IN_PROGRESS;
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_authentication_authenticate_count);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_024: [When the connection is retried or the device is unregistered, the pending authentication of the device, if any, shall be released.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_Unregister_releases_the_pending_authentication)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    IOTHUB_DEVICE_HANDLE device_handles[2];
+    TRANSPORT_LL_HANDLE handle = create_transport_with_devices_to_authenticate(device_handles, &waitingToSend, 1);
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_Unregister(device_handles[0]);
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_authentication_authenticate_count);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_029: [If `handle` or `statistics` is NULL, IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall return IOTHUB_CLIENT_INVALID_ARG.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_GetAuthenticationStatistics_NULL_handle_fails)
+{
+    // arrange
+    AMQP_TRANSPORT_AUTHENTICATION_STATISTICS statistics;
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(NULL, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_INVALID_ARG, result);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_029: [If `handle` or `statistics` is NULL, IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall return IOTHUB_CLIENT_INVALID_ARG.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_GetAuthenticationStatistics_NULL_statistics_fails)
+{
+    // arrange
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(handle, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_028: [IoTHubTransport_AMQP_Common_Create shall start with empty authentication statistics (no device ready and no time-to-ready).]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_030: [Otherwise IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall fill `statistics` with the number of pending authentications, the number of devices ready and their total and longest time-to-ready, and return IOTHUB_CLIENT_OK.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_GetAuthenticationStatistics_after_Create_succeeds)
+{
+    // arrange
+    AMQP_TRANSPORT_AUTHENTICATION_STATISTICS statistics;
+    TRANSPORT_LL_HANDLE handle = IoTHubTransport_AMQP_Common_Create(create_transport_config(TEST_get_iothub_client_transport_provider), TEST_amqp_get_io_transport);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(handle, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.pending_authentications);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.devices_ready);
+    ASSERT_IS_TRUE(statistics.total_time_to_ready == 0);
+    ASSERT_IS_TRUE(statistics.max_time_to_ready == 0);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_026: [When the event sender of a device opens after the transport authenticated the device, the transport shall count the device as ready and add how many seconds passed since it called authentication_authenticate() to the time-to-ready statistics; if `logtrace` is on it shall also log them.]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_030: [Otherwise IoTHubTransport_AMQP_Common_GetAuthenticationStatistics shall fill `statistics` with the number of pending authentications, the number of devices ready and their total and longest time-to-ready, and return IOTHUB_CLIENT_OK.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_GetAuthenticationStatistics_reports_the_time_to_ready)
+{
+    // arrange
+    AMQP_TRANSPORT_AUTHENTICATION_STATISTICS pending_statistics;
+    AMQP_TRANSPORT_AUTHENTICATION_STATISTICS ready_statistics;
+    DLIST_ENTRY waitingToSend;
+    IOTHUB_DEVICE_HANDLE device_handles[2];
+    TRANSPORT_LL_HANDLE handle = create_transport_with_devices_to_authenticate(device_handles, &waitingToSend, 0);
+    g_current_time = 10;
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    (void)IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(handle, &pending_statistics);
+
+    // creates the event senders
+    g_authentication_status = AUTHENTICATION_STATUS_OK;
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    umock_c_reset_all_calls();
+
+    // act
+    g_current_time = 15;
+    g_on_message_sender_state_changed(g_on_message_sender_state_changed_context, MESSAGE_SENDER_STATE_OPEN, MESSAGE_SENDER_STATE_OPENING);
+    /*a device is ready only once*/
+    g_on_message_sender_state_changed(g_on_message_sender_state_changed_context, MESSAGE_SENDER_STATE_OPEN, MESSAGE_SENDER_STATE_OPENING);
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_AMQP_Common_GetAuthenticationStatistics(handle, &ready_statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, pending_statistics.pending_authentications);
+    ASSERT_ARE_EQUAL(size_t, 0, pending_statistics.devices_ready);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 0, ready_statistics.pending_authentications);
+    ASSERT_ARE_EQUAL(size_t, 1, ready_statistics.devices_ready);
+    ASSERT_IS_TRUE(ready_statistics.total_time_to_ready == 5);
+    ASSERT_IS_TRUE(ready_statistics.max_time_to_ready == 5);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_002: [If `amqp_batch_max_bytes` is not 0, IoTHubTransport_AMQP_Common_DoWork shall send the queued events in batched AMQP messages instead of one message per event.]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_008: [The batch shall be sent with a single messagesender_send() call, completed by one disposition.]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_009: [When the disposition of a batch arrives, every event of the batch shall be completed with the result of the batch, as 'on_message_send_complete' does for a single event.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_sends_the_waiting_events_in_one_batch)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    TRANSPORT_LL_HANDLE handle = create_transport_with_open_event_sender(&waitingToSend, 1024, 0);
+    add_event_to_send(&waitingToSend, TEST_ENCODED_EVENT_SIZE);
+    add_event_to_send(&waitingToSend, TEST_ENCODED_EVENT_SIZE);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    g_on_message_send_complete[0](g_on_message_send_complete_context[0], MESSAGE_SEND_OK);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_messagesender_send_count);
+    ASSERT_ARE_EQUAL(size_t, 2, g_event_confirmation_count);
+    ASSERT_ARE_EQUAL(int, IOTHUB_CLIENT_CONFIRMATION_OK, g_event_confirmation_result);
+    ASSERT_IS_TRUE(DList_IsListEmpty(&waitingToSend) != 0);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_006: [Each queued event shall be encoded with message_create_uamqp_encoding_from_iothub_message(), using the application properties cache of the device, and added to the batch as one data section with message_add_body_amqp_data(), until the next one would make the batch larger than `amqp_batch_max_bytes`; a batch always takes at least one event.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_starts_a_new_batch_when_an_event_does_not_fit)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    TRANSPORT_LL_HANDLE handle = create_transport_with_open_event_sender(&waitingToSend, TEST_ENCODED_EVENT_SIZE + 1, 0);
+    add_event_to_send(&waitingToSend, TEST_ENCODED_EVENT_SIZE);
+    add_event_to_send(&waitingToSend, TEST_ENCODED_EVENT_SIZE);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    g_on_message_send_complete[0](g_on_message_send_complete_context[0], MESSAGE_SEND_OK);
+    g_on_message_send_complete[1](g_on_message_send_complete_context[1], MESSAGE_SEND_OK);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_messagesender_send_count);
+    ASSERT_ARE_EQUAL(size_t, 2, g_event_confirmation_count);
+
+    // cleanup
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_004: [Otherwise the queued events shall be held back until they add up to `amqp_batch_max_bytes` or `amqp_batch_linger_ms` milliseconds have passed since they were first held back.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_holds_a_small_batch_until_the_linger_elapses)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    TRANSPORT_LL_HANDLE handle = create_transport_with_open_event_sender(&waitingToSend, 1024, 100);
+    add_event_to_send(&waitingToSend, TEST_ENCODED_EVENT_SIZE);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    g_current_ms = 99;
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, g_messagesender_send_count);
+
+    g_current_ms = 100;
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    ASSERT_ARE_EQUAL(size_t, 1, g_messagesender_send_count);
+
+    // cleanup
+    g_on_message_send_complete[0](g_on_message_send_complete_context[0], MESSAGE_SEND_OK);
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_COMMON_41_004: [Otherwise the queued events shall be held back until they add up to `amqp_batch_max_bytes` or `amqp_batch_linger_ms` milliseconds have passed since they were first held back.]
+TEST_FUNCTION(IoTHubTransport_AMQP_Common_DoWork_does_not_hold_a_full_batch)
+{
+    // arrange
+    DLIST_ENTRY waitingToSend;
+    TRANSPORT_LL_HANDLE handle = create_transport_with_open_event_sender(&waitingToSend, 1024, 100);
+    add_event_to_send(&waitingToSend, 1024);
+    umock_c_reset_all_calls();
+
+    // act
+    IoTHubTransport_AMQP_Common_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_messagesender_send_count);
+
+    // cleanup
+    g_on_message_send_complete[0](g_on_message_send_complete_context[0], MESSAGE_SEND_OK);
+    IoTHubTransport_AMQP_Common_Destroy(handle);
+}
+
 END_TEST_SUITE(iothubtransport_amqp_common_ut)
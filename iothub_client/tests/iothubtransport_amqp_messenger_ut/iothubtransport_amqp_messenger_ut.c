@@ -48,6 +48,7 @@ void real_free(void* ptr)
 #include "azure_uamqp_c/message_sender.h"
 #include "azure_uamqp_c/message_receiver.h"
 #include "iothub_client_private.h"
+#include "iothub_client_record_pool.h"
 #include "iothub_client_version.h"
 #include "iothub_message.h"
 #include "uamqp_messaging.h"
@@ -620,7 +621,7 @@ static void set_expected_calls_for_on_message_send_complete()
     EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
     EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_IOTHUB_MESSAGE_HANDLE));
-    EXPECTED_CALL(free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(IoTHubClient_RecordPool_Free(IGNORED_PTR_ARG));
 }
 
 static void set_expected_calls_for_message_do_work_send_pending_events(MESSENGER_CONFIG* config, MESSENGER_HANDLE messenger_handle, PDLIST_ENTRY in_progress_list)
@@ -745,6 +746,7 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 
     REGISTER_GLOBAL_MOCK_HOOK(malloc, TEST_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(free, TEST_free);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubClient_RecordPool_Free, real_free);
     REGISTER_GLOBAL_MOCK_HOOK(messagesender_create, TEST_messagesender_create);
     REGISTER_GLOBAL_MOCK_HOOK(messagesender_send, TEST_messagesender_send);
     REGISTER_GLOBAL_MOCK_HOOK(messagereceiver_create, TEST_messagereceiver_create);
@@ -1562,7 +1564,7 @@ TEST_FUNCTION(messenger_do_work_destroy_message_receiver)
 // Tests_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_107: [If no failure occurs, `MESSAGE_HANDLE->callback` shall be invoked with result IOTHUB_CLIENT_CONFIRMATION_OK]
 // Tests_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_128: [MESSAGE_HANDLE shall be removed from `instance->in_progress_list`]
 // Tests_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_129: [`MESSAGE_HANDLE->messageHandle` shall be destroyed using IoTHubMessage_Destroy()]
-// Tests_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_130: [MESSAGE_HANDLE shall be destroyed using free()]
+// Tests_SRS_IOTHUBTRANSPORT_AMQP_MESSENGER_09_130: [MESSAGE_HANDLE shall be destroyed using IoTHubClient_RecordPool_Free()]
 TEST_FUNCTION(messenger_do_work_on_event_send_complete_OK)
 {
     // arrange
@@ -10,6 +10,8 @@
 
 #include "iothub_client.h"
 #include "iothubtransport.h"
+#include "iothub_client_worker_pool_private.h"
+#include "iothub_client_shared_transport_private.h"
 
 #include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/doublylinkedlist.h"
@@ -60,6 +62,8 @@ static size_t doWorkCallCount = 0;
 extern "C" const size_t IoTHubTransport_ThreadTerminationOffset;
 static THREAD_START_FUNC threadFunc;
 static void* threadFuncArg;
+static WORKER_POOL_DO_WORK workerPoolDoWork;
+static void* workerPoolDoWorkContext;
 
 #define TEST_DEVICE_ID "theidofTheDevice"
 #define TEST_DEVICE_KEY "theKeyoftheDevice"
@@ -68,8 +72,12 @@ static void* threadFuncArg;
 #define TEST_AUTHORIZATIONKEY "theAuthorizationKey"
 #define TEST_IOTHUB_CLIENT_HANDLE1 (IOTHUB_CLIENT_HANDLE)0xDEAD
 #define TEST_IOTHUB_CLIENT_HANDLE2 (IOTHUB_CLIENT_HANDLE)0xDEAF
+#define TEST_CLIENT1_TIME_TO_WAIT 50
+#define TEST_CLIENT2_TIME_TO_WAIT 20
 #define TEST_LOCK_HANDLE (LOCK_HANDLE)0x4443
 #define TEST_THREAD_HANDLE (THREAD_HANDLE)0x4442
+#define TEST_WORKER_POOL_HANDLE (IOTHUB_CLIENT_WORKER_POOL_HANDLE)0x4444
+#define TEST_WORKER_POOL_ITEM_HANDLE (WORKER_POOL_ITEM_HANDLE)0x4445
 
 
 
@@ -362,6 +370,21 @@ public:
         }
     MOCK_VOID_METHOD_END();
 
+    /* worker pool mocks */
+    MOCK_STATIC_METHOD_3(, WORKER_POOL_ITEM_HANDLE, IoTHubClient_WorkerPool_Add, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool, WORKER_POOL_DO_WORK, doWork, void*, context);
+    workerPoolDoWork = doWork;
+    workerPoolDoWorkContext = context;
+    MOCK_METHOD_END(WORKER_POOL_ITEM_HANDLE, TEST_WORKER_POOL_ITEM_HANDLE);
+    MOCK_STATIC_METHOD_1(, void, IoTHubClient_WorkerPool_Signal, WORKER_POOL_ITEM_HANDLE, item);
+    MOCK_VOID_METHOD_END();
+    MOCK_STATIC_METHOD_1(, void, IoTHubClient_WorkerPool_Remove, WORKER_POOL_ITEM_HANDLE, item);
+    MOCK_VOID_METHOD_END();
+
+    /* IoTHubClient mocks */
+    MOCK_STATIC_METHOD_1(, tickcounter_ms_t, IoTHubClient_GetTimeToWait, IOTHUB_CLIENT_HANDLE, iotHubClientHandle);
+    tickcounter_ms_t result2 = (iotHubClientHandle == TEST_IOTHUB_CLIENT_HANDLE1) ? TEST_CLIENT1_TIME_TO_WAIT : TEST_CLIENT2_TIME_TO_WAIT;
+    MOCK_METHOD_END(tickcounter_ms_t, result2);
+
     /* Lock mocks */
     MOCK_STATIC_METHOD_0(, LOCK_HANDLE, Lock_Init);
     MOCK_METHOD_END(LOCK_HANDLE, TEST_LOCK_HANDLE);
@@ -437,6 +460,12 @@ DECLARE_GLOBAL_MOCK_METHOD_2(CIotHubTransportMocks, , THREADAPI_RESULT, ThreadAP
 DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , void, ThreadAPI_Exit, int, res);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , void, ThreadAPI_Sleep, unsigned int, milliseconds);
 
+DECLARE_GLOBAL_MOCK_METHOD_3(CIotHubTransportMocks, , WORKER_POOL_ITEM_HANDLE, IoTHubClient_WorkerPool_Add, IOTHUB_CLIENT_WORKER_POOL_HANDLE, workerPool, WORKER_POOL_DO_WORK, doWork, void*, context);
+DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , void, IoTHubClient_WorkerPool_Signal, WORKER_POOL_ITEM_HANDLE, item);
+DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , void, IoTHubClient_WorkerPool_Remove, WORKER_POOL_ITEM_HANDLE, item);
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , tickcounter_ms_t, IoTHubClient_GetTimeToWait, IOTHUB_CLIENT_HANDLE, iotHubClientHandle);
+
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CIotHubTransportMocks, , LOCK_HANDLE, Lock_Init);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIotHubTransportMocks, , LOCK_RESULT, Lock, LOCK_HANDLE, handle);
@@ -497,7 +526,8 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     checkProtocolGatewayIsNull = false;
     howManyDoWorkCalls = 0;
     doWorkCallCount = 0;
-
+    workerPoolDoWork = NULL;
+    workerPoolDoWorkContext = NULL;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -1382,5 +1412,219 @@ TEST_FUNCTION(IoTHubTransport_worker_thread_runs_lock_fails)
     IoTHubTransport_Destroy(transportHandle);
 }
 
+//Tests_SRS_IOTHUBTRANSPORT_41_001: [ If transportHandle or workerPool is NULL, IoTHubTransport_SetWorkerPool shall return IOTHUB_CLIENT_INVALID_ARG. ]
+TEST_FUNCTION(IoTHubTransport_SetWorkerPool_null_transport_returns_bad_arg)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_SetWorkerPool(NULL, TEST_WORKER_POOL_HANDLE);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)result, (int)IOTHUB_CLIENT_INVALID_ARG);
+    mocks.AssertActualAndExpectedCalls();
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_002: [ If the worker thread was already started, IoTHubTransport_SetWorkerPool shall return IOTHUB_CLIENT_ERROR. ]
+TEST_FUNCTION(IoTHubTransport_SetWorkerPool_after_thread_started_fails)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)result, (int)IOTHUB_CLIENT_ERROR);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_003: [ Otherwise IoTHubTransport_SetWorkerPool shall remember workerPool, to be used when the worker thread would have been started, and return IOTHUB_CLIENT_OK. ]
+//Tests_SRS_IOTHUBTRANSPORT_41_005: [ If a worker pool was set, IoTHubTransport_StartWorkerThread shall add the transport to the worker pool instead of starting a thread. ]
+TEST_FUNCTION(IoTHubTransport_StartWorkerThread_with_worker_pool_adds_to_pool)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    IOTHUB_CLIENT_RESULT setResult = IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_WorkerPool_Add(TEST_WORKER_POOL_HANDLE, IGNORED_PTR_ARG, transportHandle))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)setResult, (int)IOTHUB_CLIENT_OK);
+    ASSERT_ARE_EQUAL(int, (int)result, (int)IOTHUB_CLIENT_OK);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_004: [ When run by the worker pool, the transport shall do the same work as one iteration of the worker thread. ]
+//Tests_SRS_IOTHUBTRANSPORT_41_007: [ The transport shall then ask to be run again after the shortest time returned by IoTHubClient_GetTimeToWait for the clients using it, or after 1 ms if there are none. ]
+TEST_FUNCTION(IoTHubTransport_worker_pool_do_work_calls_DoWork_and_returns_client_time_to_wait)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    (void)IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, FAKE_IoTHubTransport_DoWork((TRANSPORT_LL_HANDLE)(0x42), NULL));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_GetTimeToWait(TEST_IOTHUB_CLIENT_HANDLE1));
+    STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+
+    ///act
+    tickcounter_ms_t runAfter = workerPoolDoWork(workerPoolDoWorkContext);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, TEST_CLIENT1_TIME_TO_WAIT, (int)runAfter);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_007: [ The transport shall then ask to be run again after the shortest time returned by IoTHubClient_GetTimeToWait for the clients using it, or after 1 ms if there are none. ]
+TEST_FUNCTION(IoTHubTransport_worker_pool_do_work_returns_shortest_client_time_to_wait)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    (void)IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE2);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, FAKE_IoTHubTransport_DoWork((TRANSPORT_LL_HANDLE)(0x42), NULL));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_GetTimeToWait(TEST_IOTHUB_CLIENT_HANDLE1));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_GetTimeToWait(TEST_IOTHUB_CLIENT_HANDLE2));
+    STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+
+    ///act
+    tickcounter_ms_t runAfter = workerPoolDoWork(workerPoolDoWorkContext);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, TEST_CLIENT2_TIME_TO_WAIT, (int)runAfter);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE2);
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_008: [ If transportHandle is NULL, IoTHubTransport_SignalWork shall do nothing. ]
+TEST_FUNCTION(IoTHubTransport_SignalWork_null_transport_does_nothing)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+
+    ///act
+    IoTHubTransport_SignalWork(NULL);
+
+    ///assert
+    mocks.AssertActualAndExpectedCalls();
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_009: [ If the transport was added to a worker pool, IoTHubTransport_SignalWork shall call IoTHubClient_WorkerPool_Signal so that the transport runs without waiting for its next scheduled time. ]
+TEST_FUNCTION(IoTHubTransport_SignalWork_with_worker_pool_signals_item)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    (void)IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_WorkerPool_Signal(TEST_WORKER_POOL_ITEM_HANDLE));
+
+    ///act
+    IoTHubTransport_SignalWork(transportHandle);
+
+    ///assert
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_010: [ Otherwise IoTHubTransport_SignalWork shall do nothing, the worker thread calls DoWork every 1 ms. ]
+TEST_FUNCTION(IoTHubTransport_SignalWork_without_worker_pool_does_nothing)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    mocks.ResetAllCalls();
+
+    ///act
+    IoTHubTransport_SignalWork(transportHandle);
+
+    ///assert
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_Destroy(transportHandle);
+}
+
+//Tests_SRS_IOTHUBTRANSPORT_41_006: [ If the transport was added to a worker pool, it shall be removed from the pool instead of joining the thread. ]
+TEST_FUNCTION(IoTHubTransport_JoinWorkerThread_with_worker_pool_removes_item)
+{
+    CIotHubTransportMocks mocks;
+    ///arrange
+    auto transportHandle = IoTHubTransport_Create(TEST_CONFIG.protocol, TEST_CONFIG.iotHubName, TEST_CONFIG.iotHubSuffix);
+    (void)IoTHubTransport_SetWorkerPool(transportHandle, TEST_WORKER_POOL_HANDLE);
+    (void)IoTHubTransport_StartWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    (void)IoTHubTransport_SignalEndWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_WorkerPool_Remove(TEST_WORKER_POOL_ITEM_HANDLE));
+
+    ///act
+    IoTHubTransport_JoinWorkerThread(transportHandle, TEST_IOTHUB_CLIENT_HANDLE1);
+
+    ///assert
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransport_Destroy(transportHandle);
+}
+
 END_TEST_SUITE(iothubtransport_ut)
 
@@ -394,6 +394,9 @@ static const char* TEST_VALUES1_AA_B[] = { "b" };
 static size_t currentmalloc_call;
 static size_t whenShallmalloc_fail;
 
+static size_t currentrealloc_call;
+static size_t whenShallrealloc_fail;
+
 /*different STRING constructors*/
 static size_t currentSTRING_new_call;
 static size_t whenShallSTRING_new_fail;
@@ -566,7 +569,8 @@ public:
     MOCK_METHOD_END(void*, result2);
 
     MOCK_STATIC_METHOD_2(, void*, gballoc_realloc, void*, ptr, size_t, size)
-        MOCK_METHOD_END(void*, BASEIMPLEMENTATION::gballoc_realloc(ptr, size));
+        currentrealloc_call++;
+    MOCK_METHOD_END(void*, (((whenShallrealloc_fail > 0) && (currentrealloc_call == whenShallrealloc_fail)) ? NULL : BASEIMPLEMENTATION::gballoc_realloc(ptr, size)));
 
     MOCK_STATIC_METHOD_1(, void, gballoc_free, void*, ptr)
         BASEIMPLEMENTATION::gballoc_free(ptr);
@@ -1723,6 +1727,34 @@ static void setupDoWorkLoopForNextDevice(CIoTHubTransportHttpMocks &mocks, size_
         .IgnoreArgument(1);
 }
 
+/*sizing and encoding 1 event of a batch, isPayloadGrowing is true when the event does not fit in the capacity of the payload of the device*/
+static void setupBatchedEventItem(CIoTHubTransportHttpMocks &mocks, IOTHUB_MESSAGE_LIST* message, MAP_HANDLE properties, bool isStringMessage, bool isPayloadGrowing)
+{
+    (void)mocks;
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message->messageHandle));
+    if (isStringMessage)
+    {
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message->messageHandle));
+    }
+    else
+    {
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message->messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+    }
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message->messageHandle));
+    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(properties, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3)
+        .IgnoreArgument(4);
+    if (isPayloadGrowing)
+    {
+        STRICT_EXPECTED_CALL(mocks, gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments();
+    }
+}
+
 //
 //static void setupInitHappyPathUpThroughHostName(CIoTHubTransportHttpMocks &mocks, bool deallocateCreated)
 //{
@@ -1856,6 +1888,9 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     currentmalloc_call = 0;
     whenShallmalloc_fail = 0;
 
+    currentrealloc_call = 0;
+    whenShallrealloc_fail = 0;
+
     currentSTRING_new_call = 0;
     whenShallSTRING_new_fail = 0;
 
@@ -4769,51 +4804,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_2devices_2nd_has_1_event_item_as_string
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message10, TEST_MAP_EMPTY, true, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -4822,15 +4814,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_2devices_2nd_has_1_event_item_as_string
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -8300,55 +8288,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_happy_path_succeeds)
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -8357,15 +8298,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_happy_path_succeeds)
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -8427,55 +8364,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_ht
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -8484,15 +8374,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_ht
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -8553,55 +8439,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_HT
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -8610,15 +8449,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_HT
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -8680,55 +8515,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -8737,15 +8525,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         whenShallBUFFER_build_fail = 1;
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
@@ -8788,55 +8572,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -8845,7 +8582,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         whenShallBUFFER_new_fail = 1;
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
     }
@@ -8866,8 +8603,9 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
     IoTHubTransportHttp_Destroy(handle);
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]
 //Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_with_STRING_fails_it_fails)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_growing_the_payload_fails_it_fails)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -8884,291 +8622,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_wi
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
+    /*this is first batched payload, growing the payload for it fails*/
+    whenShallrealloc_fail = currentrealloc_call + 1;
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        whenShallSTRING_concat_with_STRING_fail = 7;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_it_fails)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        whenShallSTRING_concat_fail = currentSTRING_concat_call + 2;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_it_fails_2)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-
-        whenShallSTRING_concat_fail = currentSTRING_concat_call + 1;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_with_STRING_it_fails_2)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        whenShallSTRING_concat_with_STRING_fail = 6;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_Base64_Encode_Bytes_it_fails)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        whenShallBase64_Encode_Bytes_fail = 1;
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
+    ENABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -9198,101 +8656,16 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_IoTHubMessage_Ge
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .SetReturn(IOTHUB_MESSAGE_ERROR);
-
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_construct_fails_it_fails)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        whenShallSTRING_construct_fail = currentSTRING_construct_call + 2;
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_construct_it_fails)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message1.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
+    /*this is first batched payload*/
+    {
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3)
+            .SetReturn(IOTHUB_MESSAGE_ERROR);
 
-    /*starting to prepare the "big" payload*/
-    whenShallSTRING_construct_fail = currentSTRING_construct_call + 1;
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
+        /*end of the first batched payload*/
+    }
 
     ENABLE_BATCHING();
 
@@ -9306,6 +8679,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_construct
     IoTHubTransportHttp_Destroy(handle);
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_17_067: [ If there is no valid payload, IoTHubTransportHttp_DoWork shall advance to the next activity. ]
 //Tests_SRS_TRANSPORTMULTITHTTP_17_055: [ If updating Content-Type fails for any reason, then _DoWork shall advance to the next action. ]
 TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_HTTP_headers_fails_it_fails)
 {
@@ -9357,51 +8731,14 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_bigger_than_256K_path
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message4.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message4.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(bigBufferOverflow, TEST_BIG_BUFFER_1_OVERFLOW_SIZE));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message4.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
+    /*this is first batched payload, it is sized but never encoded*/
+    setupBatchedEventItem(mocks, &message4, TEST_MAP_EMPTY, false, false);
 
-    {
-        /*adding the first payload to the "big" payload*/
-        /*building the list of messages to be notified because this is 100% fail (>256K)*/
-        STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message4.entry)))
-            .IgnoreArgument(1);
-    }
+    /*building the list of messages to be notified because this is 100% fail (>256K)*/
+    STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message4.entry)))
+        .IgnoreArgument(1);
 
     STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_ERROR))
         .IgnoreArgument(2);
@@ -9437,56 +8774,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_almost255_happy_path_
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message5.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message5.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(bigBufferFit, TEST_BIG_BUFFER_1_FIT_SIZE));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message5.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message5, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -9495,15 +8784,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_almost255_happy_path_
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -9566,95 +8851,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_makes_1_batch_succee
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG))
-        .ExpectedAtLeastTimes(2);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*this is second batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message2.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer2, buffer2_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the second payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
-
-    {
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message2, TEST_MAP_EMPTY, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -9667,15 +8868,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_makes_1_batch_succee
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -9737,88 +8934,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG))
-        .ExpectedAtLeastTimes(2);
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
-
-    /*this is second batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message2.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer2, buffer2_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        whenShallSTRING_concat_fail = currentSTRING_concat_call + 4;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the second batched payload*/
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
-    {
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    /*this is second batched payload, growing the payload for it fails*/
+    setupBatchedEventItem(mocks, &message2, TEST_MAP_EMPTY, false, true);
+    whenShallrealloc_fail = currentrealloc_call + 2;
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -9827,15 +8948,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -9889,103 +9006,28 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
-    mocks.ResetAllCalls();
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG))
-        .ExpectedAtLeastTimes(2);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);;
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
-
-    /*this is second batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message2.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer2, buffer2_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+    mocks.ResetAllCalls();
+    setupDoWorkLoopOnceForOneDevice(mocks);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the second batched payload*/
-    }
+    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
 
-    {
-        /*adding the second payload to the "big" payload*/
-        whenShallSTRING_concat_with_STRING_fail = currentSTRING_concat_with_STRING_call + 4;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
+        .IgnoreArgument(1);
 
-    {
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    /*this is first batched payload*/
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
+
+    /*this is second batched payload, getting its properties fails*/
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message2.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message2.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3);
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3)
+        .IgnoreArgument(4)
+        .SetReturn(MAP_ERROR);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -9994,15 +9036,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
         .IgnoreArgument(1);
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -10047,6 +9085,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_066: [ If at any point during construction of the string there are errors, IoTHubTransportHttp_DoWork shall use the so far constructed string as payload. ]
+//Tests_SRS_TRANSPORTMULTITHTTP_41_001: [ The size of every message shall be computed before the message is encoded. A message that would exceed the message size limit shall not be encoded. ]
 TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_the_second_one_does_not_fit_256K_makes_1_batch_of_the_first_item_succeeds)
 {
     ///arrange
@@ -10064,92 +9103,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_the_second_one_does_
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG))
-        .ExpectedAtLeastTimes(2);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message1.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(buffer1, buffer1_size));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
+    setupBatchedEventItem(mocks, &message1, TEST_MAP_EMPTY, false, true);
 
     /*this is second batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message5.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(message5.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL(mocks, Base64_Encode_Bytes(bigBufferFit, TEST_BIG_BUFFER_1_FIT_SIZE));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message5.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the second payload to the "big" payload*/
-    }
-
-    {
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(mocks, &message5, TEST_MAP_EMPTY, false, false);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -10157,15 +9115,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_the_second_one_does_
     STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message1.entry)))
         .IgnoreArgument(1);
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL(mocks, BUFFER_new());
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -10361,71 +9315,17 @@ TEST_FUNCTION(IoTHubTransportHttp_GetSendStatus_deviceData_is_not_found_fails)
     IoTHubMessage_Destroy(eventMessageHandle);
 }
 
-void setupIrrelevantMocksForProperties(CIoTHubTransportHttpMocks *mocks, IOTHUB_MESSAGE_HANDLE messageHandle) /*these are copy pasted from TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items))*/
+void setupIrrelevantMocksForProperties(CIoTHubTransportHttpMocks *mocks, IOTHUB_MESSAGE_LIST* message, MAP_HANDLE properties) /*these are copy pasted from TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items))*/
 {
+    IOTHUB_MESSAGE_HANDLE messageHandle = message->messageHandle;
     (void)(*mocks);
     STRICT_EXPECTED_CALL((*mocks), DList_IsListEmpty(&waitingToSend));
 
     STRICT_EXPECTED_CALL((*mocks), HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL((*mocks), STRING_construct("["));
-    STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetContentType(messageHandle));
-        STRICT_EXPECTED_CALL((*mocks), STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetByteArray(messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-
-        switch ((uintptr_t)messageHandle)
-        {
-        case((uintptr_t)TEST_IOTHUB_MESSAGE_HANDLE_11) :
-        {
-            STRICT_EXPECTED_CALL((*mocks), Base64_Encode_Bytes(buffer11, buffer11_size));
-            break;
-        }
-        default:
-        {
-            STRICT_EXPECTED_CALL((*mocks), Base64_Encode_Bytes(buffer6, buffer6_size));
-            break;
-        }
-        }
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL((*mocks), STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(*mocks, message, properties, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL((*mocks), DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -10450,15 +9350,11 @@ void setupIrrelevantMocksForProperties(CIoTHubTransportHttpMocks *mocks, IOTHUB_
 
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL((*mocks), BUFFER_new());
         STRICT_EXPECTED_CALL((*mocks), BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL((*mocks), STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL((*mocks), BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -10505,32 +9401,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_with_properties_succ
 
     setupDoWorkLoopOnceForOneDevice(mocks);
 
-    setupIrrelevantMocksForProperties(&mocks, message6.messageHandle);
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message6.messageHandle));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"properties\":"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "{"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"iothub-app-"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_VALUES1[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\":\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_KEYS1[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "}"))
-        .IgnoreArgument(1);
+    setupIrrelevantMocksForProperties(&mocks, &message6, TEST_MAP_1_PROPERTY);
 
     ENABLE_BATCHING();
 
@@ -10560,32 +9431,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_with_1_properties_at
 
     setupDoWorkLoopOnceForOneDevice(mocks);
 
-    setupIrrelevantMocksForProperties(&mocks, message11.messageHandle);
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message11.messageHandle));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY_A_B, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG));
-
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"properties\":"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "{"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"iothub-app-"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_VALUES1_A_B[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\":\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_KEYS1_A_B[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "}"))
-        .IgnoreArgument(1);
+    setupIrrelevantMocksForProperties(&mocks, &message11, TEST_MAP_1_PROPERTY_A_B);
 
     ENABLE_BATCHING();
 
@@ -10664,7 +9510,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_fails_when_Map_GetIn
     IoTHubTransportHttp_Destroy(handle);
 }
 
-void setupIrrelevantMocksForProperties2(CIoTHubTransportHttpMocks *mocks, IOTHUB_MESSAGE_HANDLE h1, IOTHUB_MESSAGE_HANDLE h2) /*these are copy pasted from TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items))*/
+void setupIrrelevantMocksForProperties2(CIoTHubTransportHttpMocks *mocks, IOTHUB_MESSAGE_LIST* m1, MAP_HANDLE p1, IOTHUB_MESSAGE_LIST* m2, MAP_HANDLE p2) /*these are copy pasted from TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items))*/
 {
     (void)(*mocks);
     STRICT_EXPECTED_CALL((*mocks), DList_IsListEmpty(&waitingToSend));
@@ -10672,82 +9518,11 @@ void setupIrrelevantMocksForProperties2(CIoTHubTransportHttpMocks *mocks, IOTHUB
     STRICT_EXPECTED_CALL((*mocks), HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL((*mocks), STRING_construct("["));
-    STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetContentType(h1));
-        STRICT_EXPECTED_CALL((*mocks), STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetByteArray(message6.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL((*mocks), Base64_Encode_Bytes(buffer6, buffer6_size));
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-    }
+    setupBatchedEventItem(*mocks, m1, p1, false, true);
 
     /*this is second batched payload*/
-    {
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetContentType(h2));
-        STRICT_EXPECTED_CALL((*mocks), STRING_construct("{\"body\":\""));
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), IoTHubMessage_GetByteArray(message7.messageHandle, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-
-        STRICT_EXPECTED_CALL((*mocks), Base64_Encode_Bytes(buffer7, buffer7_size));
-        STRICT_EXPECTED_CALL((*mocks), STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the second payload to the "big" payload*/
-        STRICT_EXPECTED_CALL((*mocks), STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL((*mocks), STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
+    setupBatchedEventItem(*mocks, m2, p2, false, true);
 
     /*building the list of messages to be notified if HTTP is fine*/
     STRICT_EXPECTED_CALL((*mocks), DList_RemoveHeadList(IGNORED_PTR_ARG))
@@ -10761,15 +9536,11 @@ void setupIrrelevantMocksForProperties2(CIoTHubTransportHttpMocks *mocks, IOTHUB
 
 
     {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
         STRICT_EXPECTED_CALL((*mocks), BUFFER_new());
         STRICT_EXPECTED_CALL((*mocks), BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL((*mocks), STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL((*mocks), STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL((*mocks), BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -10799,88 +9570,24 @@ void setupIrrelevantMocksForProperties2(CIoTHubTransportHttpMocks *mocks, IOTHUB
     /*once the event has been succesfull...*/
 
     STRICT_EXPECTED_CALL((*mocks), IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_OK))
-        .IgnoreArgument(2);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_064: [ If IoTHubMessage does not have properties, then "properties":{...} shall be missing from the payload. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_with_properties_succeeds)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message6.entry));
-    DList_InsertTailList(&(waitingToSend), &(message7.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    setupIrrelevantMocksForProperties2(&mocks, message6.messageHandle, message7.messageHandle);
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message6.messageHandle));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
-
-    EXPECTED_CALL(mocks, STRING_new_with_memory(IGNORED_PTR_ARG))
-        .ExpectedAtLeastTimes(2);
-
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"properties\":"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "{")) /*opening of the properties*/
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"iothub-app-"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_VALUES1[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\":\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_KEYS1[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\""))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "}"))/*closing of the properties*/
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message7.messageHandle));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_2_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
+        .IgnoreArgument(2);
+}
 
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"properties\":"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "{")) /*opening of the properties*/
-        .IgnoreArgument(1);
+//Tests_SRS_TRANSPORTMULTITHTTP_17_064: [ If IoTHubMessage does not have properties, then "properties":{...} shall be missing from the payload. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_with_properties_succeeds)
+{
+    ///arrange
+    CIoTHubTransportHttpMocks mocks;
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
+    DList_InsertTailList(&(waitingToSend), &(message7.entry));
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"iothub-app-"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_VALUES2[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\":\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_KEYS2[0]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\""))
-        .IgnoreArgument(1);
+    mocks.ResetAllCalls();
 
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"iothub-app-"))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_VALUES2[1]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\":\""))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_KEYS2[1]))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\""))
-        .IgnoreArgument(1);
+    setupDoWorkLoopOnceForOneDevice(mocks);
 
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "}"))/*closing of the properties*/
-        .IgnoreArgument(1);
+    setupIrrelevantMocksForProperties2(&mocks, &message6, TEST_MAP_1_PROPERTY, &message7, TEST_MAP_2_PROPERTY);
 
     ENABLE_BATCHING();
 
@@ -10925,14 +9632,15 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items)
     IoTHubTransportHttp_Destroy(handle);
 }
 
-#define THRESHOLD1 32 /*between THRESHOLD1 and THRESHOLD2 of STRING_concat fails there still is produced a payload, consisting of only REDKEY, REDVALUE*/
+#define THRESHOLD1 32 /*the batch payload is not made of STRINGs anymore, a STRING_concat failing anywhere up to THRESHOLD1 + 1 still produces the whole payload*/
 #define THRESHOLD2 17
-#define THRESHOLD3 7 /*below 7, STRING_concat would fail not in producing properties*/
+#define THRESHOLD3 7
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_058: [ If IoTHubMessage has properties, then they shall be serialized at the same level as "body" using the following pattern: "properties":{"iothub-app-name1":"value1","iothub-app-name2":"value2"} ]
+//Tests_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]
 TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_THRESHOLD1_succeeds)
 {
-    for (size_t i = THRESHOLD1 + 1; i > THRESHOLD1; i--)
+    for (size_t i = THRESHOLD1 + 1; i > 0; i--)
     {
         ///arrange
         currentSTRING_concat_call = 0;
@@ -10948,7 +9656,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_THRESHOLD1_succeeds)
 
         setupDoWorkLoopOnceForOneDevice(mocks);
 
-        whenShallSTRING_concat_fail = i;
+        whenShallSTRING_concat_fail = currentSTRING_concat_call + i;
 
         ENABLE_BATCHING();
 
@@ -10961,6 +9669,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_THRESHOLD1_succeeds)
 
         ///cleanup
         IoTHubTransportHttp_Destroy(handle);
+        whenShallSTRING_concat_fail = 0;
         if (last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest != NULL)
         {
             BASEIMPLEMENTATION::BUFFER_delete(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest);
@@ -10969,44 +9678,62 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_THRESHOLD1_succeeds)
     }
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_058: [ If IoTHubMessage has properties, then they shall be serialized at the same level as "body" using the following pattern: "properties":{"iothub-app-name1":"value1","iothub-app-name2":"value2"} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_only_1_when_properties_for_second_fail)
+//Tests_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_only_1_when_growing_the_payload_for_the_second_fails)
 {
-    for (size_t i = THRESHOLD1; i > THRESHOLD2; i--)
-    {
-        ///arrange
-        currentSTRING_concat_call = 0;
-        whenShallSTRING_concat_fail = 0;
-        BASEIMPLEMENTATION::DList_InitializeListHead(&waitingToSend);
-        CNiceCallComparer<CIoTHubTransportHttpMocks> mocks; /*a very e2e test... */
-        DList_InsertTailList(&(waitingToSend), &(message6.entry));
-        DList_InsertTailList(&(waitingToSend), &(message7.entry));
-        auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-        (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
+    ///arrange
+    CNiceCallComparer<CIoTHubTransportHttpMocks> mocks; /*a very e2e test... */
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
+    DList_InsertTailList(&(waitingToSend), &(message7.entry));
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
-        mocks.ResetAllCalls();
+    mocks.ResetAllCalls();
 
-        setupDoWorkLoopOnceForOneDevice(mocks);
+    setupDoWorkLoopOnceForOneDevice(mocks);
 
-        whenShallSTRING_concat_fail = i;
+    whenShallrealloc_fail = currentrealloc_call + 2;
 
-        ENABLE_BATCHING();
+    ENABLE_BATCHING();
 
-        ///act
-        IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    ///act
+    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
 
-        ///assert
-        ASSERT_ARE_EQUAL(int, 0, memcmp(BASEIMPLEMENTATION::BUFFER_u_char(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest), TEST_1_ITEM_STRING, sizeof(TEST_1_ITEM_STRING) - 1));
-        mocks.AssertActualAndExpectedCalls();
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, memcmp(BASEIMPLEMENTATION::BUFFER_u_char(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest), TEST_1_ITEM_STRING, sizeof(TEST_1_ITEM_STRING) - 1));
+    mocks.AssertActualAndExpectedCalls();
 
-        ///cleanup
-        IoTHubTransportHttp_Destroy(handle);
-        if (last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest != NULL)
-        {
-            BASEIMPLEMENTATION::BUFFER_delete(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest);
-            last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest = NULL;
-        }
-    }
+    ///cleanup
+    IoTHubTransportHttp_Destroy(handle);
+}
+
+//Tests_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_nothing_when_growing_the_payload_for_the_first_fails)
+{
+    ///arrange
+    CNiceCallComparer<CIoTHubTransportHttpMocks> mocks; /*a very e2e test... */
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
+    DList_InsertTailList(&(waitingToSend), &(message7.entry));
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
+
+    mocks.ResetAllCalls();
+
+    setupDoWorkLoopOnceForOneDevice(mocks);
+
+    whenShallrealloc_fail = currentrealloc_call + 1;
+
+    ENABLE_BATCHING();
+
+    ///act
+    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    ///assert
+    ASSERT_IS_NULL(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransportHttp_Destroy(handle);
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_058: [ If IoTHubMessage has properties, then they shall be serialized at the same level as "body" using the following pattern: "properties":{"iothub-app-name1":"value1","iothub-app-name2":"value2"} ]
@@ -11022,9 +9749,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_nothing)
         DList_InsertTailList(&(waitingToSend), &(message6.entry));
         DList_InsertTailList(&(waitingToSend), &(message7.entry));
         auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+        (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
         mocks.ResetAllCalls();
 
-        whenShallSTRING_concat_fail = i;
+        whenShallSTRING_concat_fail = currentSTRING_concat_call + i;
+        /*the first item cannot be added to the payload, so there is nothing to send*/
+        whenShallrealloc_fail = currentrealloc_call + 1;
 
         ENABLE_BATCHING();
 
@@ -11037,6 +9767,8 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_nothing)
 
         ///cleanup
         IoTHubTransportHttp_Destroy(handle);
+        whenShallSTRING_concat_fail = 0;
+        whenShallrealloc_fail = 0;
         if (last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest != NULL)
         {
             BASEIMPLEMENTATION::BUFFER_delete(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest);
@@ -11045,6 +9777,37 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_send_nothing)
     }
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_41_002: [ The payload shall be built in a single buffer that is grown to at least twice its capacity when the next item does not fit in it, and every item shall be encoded directly in that buffer. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_reuses_the_payload_buffer_for_the_next_batch)
+{
+    ///arrange
+    CNiceCallComparer<CIoTHubTransportHttpMocks> mocks; /*a very e2e test... */
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
+    DList_InsertTailList(&(waitingToSend), &(message7.entry));
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
+    ENABLE_BATCHING();
+    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
+
+    mocks.ResetAllCalls();
+
+    setupDoWorkLoopOnceForOneDevice(mocks);
+
+    /*the payload of the previous batch is big enough for this one, so it does not have to grow*/
+    whenShallrealloc_fail = currentrealloc_call + 1;
+
+    ///act
+    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, memcmp(BASEIMPLEMENTATION::BUFFER_u_char(last_BUFFER_HANDLE_to_HTTPAPIEX_ExecuteRequest), TEST_1_ITEM_STRING, sizeof(TEST_1_ITEM_STRING) - 1));
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransportHttp_Destroy(handle);
+}
+
 //Tests_SRS_TRANSPORTMULTITHTTP_17_114: [ If handle parameter is NULL then IoTHubTransportHttp_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]
 TEST_FUNCTION(IoTHubTransportHttp_SetOption_with_NULL_handle_fails)
 {
@@ -13000,143 +11763,17 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
     STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "iothub-app-" TEST_RED_KEY, TEST_RED_VALUE))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, BUFFER_new());
-    STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(1);
-
-    EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
-    EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
-
-    DISABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_buffer_fails_2)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message6.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3);
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Free(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/octet-stream"))
-        .IgnoreArgument(1);
-
-    /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
-
-    /*this is making http headers*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("iothub-app-"));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_RED_KEY))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "iothub-app-" TEST_RED_KEY, TEST_RED_VALUE))
-        .IgnoreArgument(1);
-
-    whenShallBUFFER_new_fail = currentBUFFER_new_call + 1;
-    STRICT_EXPECTED_CALL(mocks, BUFFER_new());
-
-    EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
-    EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
-
-    DISABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_1)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message6.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3);
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Free(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/octet-stream"))
-        .IgnoreArgument(1);
-
-    /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .IgnoreArgument(4);
-
-    /*this is making http headers*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("iothub-app-"));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_RED_KEY))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "iothub-app-" TEST_RED_KEY, TEST_RED_VALUE))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, BUFFER_new());
+    STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
         .IgnoreArgument(1)
-        .SetReturn(HTTP_HEADERS_ERROR);
+        .IgnoreArgument(2)
+        .IgnoreArgument(3)
+        .SetReturn(1);
 
     EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
     EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
@@ -13154,7 +11791,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_2)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_buffer_fails_2)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13193,8 +11830,14 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
     STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_RED_KEY))
-        .IgnoreArgument(1)
-        .SetReturn(1111); /*unpredictable value which is an error*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "iothub-app-" TEST_RED_KEY, TEST_RED_VALUE))
+        .IgnoreArgument(1);
+
+    whenShallBUFFER_new_fail = currentBUFFER_new_call + 1;
+    STRICT_EXPECTED_CALL(mocks, BUFFER_new());
 
     EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
     EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
@@ -13212,7 +11855,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_3)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_1)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13247,8 +11890,16 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(4);
 
     /*this is making http headers*/
-    whenShallSTRING_construct_fail = currentSTRING_construct_call + 1;
     STRICT_EXPECTED_CALL(mocks, STRING_construct("iothub-app-"));
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_RED_KEY))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "iothub-app-" TEST_RED_KEY, TEST_RED_VALUE))
+        .IgnoreArgument(1)
+        .SetReturn(HTTP_HEADERS_ERROR);
 
     EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
     EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
@@ -13266,7 +11917,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_map_fails)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_2)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13298,8 +11949,18 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
-        .IgnoreArgument(4)
-        .SetReturn(MAP_ERROR);
+        .IgnoreArgument(4);
+
+    /*this is making http headers*/
+    STRICT_EXPECTED_CALL(mocks, STRING_construct("iothub-app-"));
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, TEST_RED_KEY))
+        .IgnoreArgument(1)
+        .SetReturn(1111); /*unpredictable value which is an error*/
+
+    EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
+    EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
 
     DISABLE_BATCHING();
 
@@ -13314,7 +11975,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_fails_4)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_headers_fail_3)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13339,120 +12000,21 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/octet-stream"))
-        .IgnoreArgument(1)
-        .SetReturn(HTTP_HEADERS_ERROR);
-
-    DISABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_fails_5)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message6.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3);
-
-    whenShallHTTPHeaders_Clone_fail = currentHTTPHeaders_Clone_call + 1;
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    DISABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_IoTHubMessage_GetByteArray_fails)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message6.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    /*no properties, so no more headers*/
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
-        .SetReturn(IOTHUB_MESSAGE_ERROR);
-
-    DISABLE_BATCHING();
-
-    ///act
-    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
-
-    ///assert
-    mocks.AssertActualAndExpectedCalls();
-
-    ///cleanup
-    IoTHubTransportHttp_Destroy(handle);
-}
-
-//Tests_SRS_TRANSPORTMULTITHTTP_17_075: [ If the oldest message in waitingToSend causes the message to exceed the message size limit then it shall be removed from waitingToSend, and IoTHubClient_LL_SendComplete shall be called. Parameter PDLIST_ENTRY completed shall point to a list containing only the oldest item, and parameter IOTHUB_BATCHSTATE result shall be set to IOTHUB_CLIENT_CONFIRMATION_ERROR. ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_overlimit_calls_SendComplete_with_BATCHSTATE_FAILED)
-{
-    ///arrange
-    CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message9.entry));
-    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
-    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
-
-    mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_9));
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_9, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3);
+        .IgnoreArgument(4);
 
-    /*ooops - over 256K*/
+    /*this is making http headers*/
+    whenShallSTRING_construct_fail = currentSTRING_construct_call + 1;
+    STRICT_EXPECTED_CALL(mocks, STRING_construct("iothub-app-"));
 
-    /*building the list of messages to be notified if HTTP is fine*/
-    STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message9.entry)))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_ERROR))
-        .IgnoreArgument(2);
+    EXPECTED_CALL(mocks, IoTHubMessage_GetMessageId(IGNORED_PTR_ARG));
+    EXPECTED_CALL(mocks, IoTHubMessage_GetCorrelationId(IGNORED_PTR_ARG));
 
     DISABLE_BATCHING();
 
@@ -13466,118 +12028,43 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
     IoTHubTransportHttp_Destroy(handle);
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_happy_path_succeeds)
+//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_map_fails)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message10.entry));
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
     mocks.ResetAllCalls();
-
-    setupDoWorkLoopOnceForOneDevice(mocks);
-
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
-
-    {
-        /*adding the first payload to the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*closing the "big" payload*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-    }
-
-    /*building the list of messages to be notified if HTTP is fine*/
-    STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message10.entry)))
-        .IgnoreArgument(1);
-
-    {
-        /*this is building the HTTP payload... from a STRING_HANDLE (as it comes as "big payload"), into an array of bytes*/
-        STRICT_EXPECTED_CALL(mocks, BUFFER_new());
-        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2)
-            .IgnoreArgument(3);
-    }
-
-    /*executing HTTP goodies*/
-    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG)) /*because relativePath*/
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, HTTPAPIEX_SAS_ExecuteRequest2(
-        IGNORED_PTR_ARG,                                    /*sasObject handle                                             */
-        IGNORED_PTR_ARG,
-        HTTPAPI_REQUEST_POST,                                                           /*HTTPAPI_REQUEST_TYPE requestType,                  */
-        "/devices/" TEST_DEVICE_ID EVENT_ENDPOINT API_VERSION,                 /*const char* relativePath,                          */
-        IGNORED_PTR_ARG,                                                                /*HTTP_HEADERS_HANDLE requestHttpHeadersHandle,      */
-        IGNORED_PTR_ARG,                                                                /*BUFFER_HANDLE requestContent,                      */
-        IGNORED_PTR_ARG,                                                                /*unsigned int* statusCode,                          */
-        NULL,                                                                           /*HTTP_HEADERS_HANDLE responseHttpHeadersHandle,     */
-        NULL                                                                            /*BUFFER_HANDLE responseContent)                     */
-        ))
-        .IgnoreArgument(1)
+
+    setupDoWorkLoopOnceForOneDevice(mocks);
+
+    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
-        .IgnoreArgument(5)
-        .IgnoreArgument(6)
-        .CopyOutArgumentBuffer(7, &httpStatus200, sizeof(httpStatus200));
+        .IgnoreArgument(3);
 
-    /*once the event has been succesfull...*/
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
 
-    STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_OK))
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/octet-stream"))
+        .IgnoreArgument(1);
 
-    ENABLE_BATCHING();
+    /*no properties, so no more headers*/
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3)
+        .IgnoreArgument(4)
+        .SetReturn(MAP_ERROR);
+
+    DISABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -13589,12 +12076,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_happy_path_
     IoTHubTransportHttp_Destroy(handle);
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_string_concat_fails_it_fails)
+//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_fails_4)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message10.entry));
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
@@ -13604,44 +12091,21 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_string
 
     STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
 
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4);
-        whenShallSTRING_concat_fail = currentSTRING_concat_call + 2;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "},")) /* this extra "," is going to be harshly overwritten by a "]"*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/octet-stream"))
+        .IgnoreArgument(1)
+        .SetReturn(HTTP_HEADERS_ERROR);
 
-    ENABLE_BATCHING();
+    DISABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -13653,12 +12117,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_string
     IoTHubTransportHttp_Destroy(handle);
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_Map_GetInternals_fails_it_fails)
+//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_http_fails_5)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message10.entry));
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
@@ -13668,42 +12132,16 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_Map_Ge
 
     STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
 
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+    whenShallHTTPHeaders_Clone_fail = currentHTTPHeaders_Clone_call + 1;
+    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(2)
-            .IgnoreArgument(3)
-            .IgnoreArgument(4)
-            .SetReturn(MAP_ERROR);
-        /*end of the first batched payload*/
-    }
-
-    ENABLE_BATCHING();
+    DISABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -13715,12 +12153,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_Map_Ge
     IoTHubTransportHttp_Destroy(handle);
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING_concat_fails_it_fails_2)
+//Tests_SRS_TRANSPORTMULTITHTTP_17_079: [ If any HTTP header operation fails, _DoWork shall advance to the next action. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_does_nothing_when_IoTHubMessage_GetByteArray_fails)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message10.entry));
+    DList_InsertTailList(&(waitingToSend), &(message6.entry));
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
@@ -13730,37 +12168,13 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
 
     STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
 
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
-
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        whenShallSTRING_concat_fail = currentSTRING_concat_call + 1;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
-            .IgnoreArgument(1);
-        /*end of the first batched payload*/
-    }
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_6, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3)
+        .SetReturn(IOTHUB_MESSAGE_ERROR);
 
-    ENABLE_BATCHING();
+    DISABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -13772,12 +12186,12 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
     IoTHubTransportHttp_Destroy(handle);
 }
 
-//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING_concat_with_STRING_fails_it_fails)
+//Tests_SRS_TRANSPORTMULTITHTTP_17_075: [ If the oldest message in waitingToSend causes the message to exceed the message size limit then it shall be removed from waitingToSend, and IoTHubClient_LL_SendComplete shall be called. Parameter PDLIST_ENTRY completed shall point to a list containing only the oldest item, and parameter IOTHUB_BATCHSTATE result shall be set to IOTHUB_CLIENT_CONFIRMATION_ERROR. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_overlimit_calls_SendComplete_with_BATCHSTATE_FAILED)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
-    DList_InsertTailList(&(waitingToSend), &(message10.entry));
+    DList_InsertTailList(&(waitingToSend), &(message9.entry));
     auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
     (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
 
@@ -13785,36 +12199,25 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
 
     setupDoWorkLoopOnceForOneDevice(mocks);
 
-    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
-
-    STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
-        .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
 
-    /*this is first batched payload*/
-    {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE_9));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE_9, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .IgnoreArgument(3);
 
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+    /*ooops - over 256K*/
 
-        whenShallSTRING_concat_with_STRING_fail = currentSTRING_concat_with_STRING_call + 1;
-        STRICT_EXPECTED_CALL(mocks, STRING_concat_with_STRING(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-        /*end of the first batched payload*/
-    }
+    /*building the list of messages to be notified if HTTP is fine*/
+    STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message9.entry)))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_ERROR))
+        .IgnoreArgument(2);
 
-    ENABLE_BATCHING();
+    DISABLE_BATCHING();
 
     ///act
     IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
@@ -13827,7 +12230,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING_new_JSON_fails_it_fails)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_happy_path_succeeds)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13844,25 +12247,52 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+    /*this is first batched payload*/
+    setupBatchedEventItem(mocks, &message10, TEST_MAP_EMPTY, true, true);
+
+    /*building the list of messages to be notified if HTTP is fine*/
+    STRICT_EXPECTED_CALL(mocks, DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DList_InsertTailList(IGNORED_PTR_ARG, &(message10.entry)))
         .IgnoreArgument(1);
 
-    /*this is first batched payload*/
     {
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+        /*this is building the HTTP payload... from the batch payload of the device, into a BUFFER_HANDLE*/
+        STRICT_EXPECTED_CALL(mocks, BUFFER_new());
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
-
-        whenShallSTRING_new_JSON_fail = currentSTRING_new_JSON_call + 1;
-        STRICT_EXPECTED_CALL(mocks, STRING_new_JSON(string10));
 
-        /*end of the first batched payload*/
+        STRICT_EXPECTED_CALL(mocks, BUFFER_build(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
     }
 
+    /*executing HTTP goodies*/
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG)) /*because relativePath*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, HTTPAPIEX_SAS_ExecuteRequest2(
+        IGNORED_PTR_ARG,                                    /*sasObject handle                                             */
+        IGNORED_PTR_ARG,
+        HTTPAPI_REQUEST_POST,                                                           /*HTTPAPI_REQUEST_TYPE requestType,                  */
+        "/devices/" TEST_DEVICE_ID EVENT_ENDPOINT API_VERSION,                 /*const char* relativePath,                          */
+        IGNORED_PTR_ARG,                                                                /*HTTP_HEADERS_HANDLE requestHttpHeadersHandle,      */
+        IGNORED_PTR_ARG,                                                                /*BUFFER_HANDLE requestContent,                      */
+        IGNORED_PTR_ARG,                                                                /*unsigned int* statusCode,                          */
+        NULL,                                                                           /*HTTP_HEADERS_HANDLE responseHttpHeadersHandle,     */
+        NULL                                                                            /*BUFFER_HANDLE responseContent)                     */
+        ))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2)
+        .IgnoreArgument(5)
+        .IgnoreArgument(6)
+        .CopyOutArgumentBuffer(7, &httpStatus200, sizeof(httpStatus200));
+
+    /*once the event has been succesfull...*/
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_SendComplete(TEST_IOTHUB_CLIENT_LL_HANDLE, IGNORED_PTR_ARG, IOTHUB_CLIENT_CONFIRMATION_OK))
+        .IgnoreArgument(2);
+
     ENABLE_BATCHING();
 
     ///act
@@ -13876,7 +12306,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_IoTHubMessage_GetString_it_fails)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_Map_GetInternals_fails_it_fails)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13893,20 +12323,16 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_IoTHub
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
     {
         STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle))
-            .SetReturn((const char*)NULL);
-
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .SetReturn(MAP_ERROR);
         /*end of the first batched payload*/
     }
 
@@ -13923,7 +12349,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_IoTHub
 }
 
 //Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
-TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING_construct_it_fails)
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_IoTHubMessage_GetString_it_fails)
 {
     ///arrange
     CIoTHubTransportHttpMocks mocks;
@@ -13940,16 +12366,11 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
     STRICT_EXPECTED_CALL(mocks, HTTPHeaders_ReplaceHeaderNameValuePair(IGNORED_PTR_ARG, "Content-Type", "application/vnd.microsoft.iothub.json"))
         .IgnoreArgument(1);
 
-    /*starting to prepare the "big" payload*/
-    STRICT_EXPECTED_CALL(mocks, STRING_construct("["));
-    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     /*this is first batched payload*/
     {
         STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(message10.messageHandle));
-        whenShallSTRING_construct_fail = currentSTRING_construct_call + 2;
-        STRICT_EXPECTED_CALL(mocks, STRING_construct("{\"body\":"));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetString(message10.messageHandle))
+            .SetReturn((const char*)NULL);
 
         /*end of the first batched payload*/
     }
@@ -13966,6 +12387,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_STRING
     IoTHubTransportHttp_Destroy(handle);
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_17_057: [ If a messages to be send has type IOTHUBMESSAGE_STRING, then its serialization shall be {"body":"JSON encoding of the string", "base64Encoded":false} ]
 //Tests_SRS_TRANSPORTMULTITHTTP_17_091: [ The HTTP header value of iothub-messageid shall be set in the IoTHub_SetMessageId. ]
 TEST_FUNCTION(IoTHubTransportHttp_DoWork_SetMessageId_SUCCEED)
 {
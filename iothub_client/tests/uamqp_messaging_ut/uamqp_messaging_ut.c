@@ -60,6 +60,8 @@ static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
 #define TEST_MAP_HANDLE (MAP_HANDLE)0x103
 #define TEST_AMQP_VALUE (AMQP_VALUE)0x104
 #define TEST_PROPERTIES_HANDLE (PROPERTIES_HANDLE)0x107
+#define TEST_CACHED_MAP_HANDLE (MAP_HANDLE)0x108
+#define TEST_CACHED_AMQP_VALUE (AMQP_VALUE)0x109
 
 static char** TEST_MAP_KEYS;
 static char** TEST_MAP_VALUES;
@@ -99,6 +101,22 @@ int test_amqpvalue_get_string(AMQP_VALUE value, const char** string_value)
 	return saved_amqpvalue_get_string_return;
 }
 
+#define TEST_SECTION_ENCODING "\x00\x53\x75\xa0"
+#define TEST_SECTION_ENCODED_SIZE 4
+
+int test_amqpvalue_get_encoded_size(AMQP_VALUE value, size_t* encoded_size)
+{
+	(void)value;
+	*encoded_size = TEST_SECTION_ENCODED_SIZE;
+	return 0;
+}
+
+int test_amqpvalue_encode(AMQP_VALUE value, AMQPVALUE_ENCODER_OUTPUT encoder_output, void* context)
+{
+	(void)value;
+	return encoder_output(context, (const unsigned char*)TEST_SECTION_ENCODING, TEST_SECTION_ENCODED_SIZE);
+}
+
 
 // Helpers to set EXPECTED_CALLS
 void set_exp_calls_for_addPropertiesTouAMQPMessage(bool has_message_id, bool has_correlation_id, bool message_handle_has_properties)
@@ -198,6 +216,119 @@ static void set_exp_calls_for_message_create_from_iothub_message(size_t number_o
 	set_exp_calls_for_addApplicationPropertiesTouAMQPMessage(number_of_app_properties);
 }
 
+static void set_exp_calls_for_message_create_from_iothub_message_with_cache(bool is_cache_filled, bool is_cache_hit, bool is_cache_update_failing)
+{
+	static size_t number_of_app_properties = 1;
+	static size_t number_of_cached_app_properties;
+	BINARY_DATA test_binary_data;
+	test_binary_data.bytes = (const unsigned char*)TEST_STRING;
+	test_binary_data.length = strlen(TEST_STRING);
+
+	number_of_cached_app_properties = is_cache_hit ? 1 : 2;
+
+	STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_IOTHUB_MESSAGE_HANDLE)).SetReturn(IOTHUBMESSAGE_BYTEARRAY);
+	STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_IOTHUB_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(2).IgnoreArgument(3).SetReturn(IOTHUB_MESSAGE_OK);
+	STRICT_EXPECTED_CALL(message_create()).SetReturn(TEST_MESSAGE_HANDLE);
+	STRICT_EXPECTED_CALL(message_add_body_amqp_data(TEST_MESSAGE_HANDLE, test_binary_data))
+		.IgnoreArgument(2).SetReturn(0);
+	set_exp_calls_for_addPropertiesTouAMQPMessage(true, true, true);
+
+	STRICT_EXPECTED_CALL(IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE));
+	STRICT_EXPECTED_CALL(Map_GetInternals(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(2).IgnoreArgument(3).IgnoreArgument(4)
+		.CopyOutArgumentBuffer_keys(&TEST_MAP_KEYS, sizeof(char**))
+		.CopyOutArgumentBuffer_values(&TEST_MAP_VALUES, sizeof(char**))
+		.CopyOutArgumentBuffer_count(&number_of_app_properties, sizeof(size_t));
+
+	if (is_cache_filled)
+	{
+		STRICT_EXPECTED_CALL(Map_GetInternals(TEST_CACHED_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(2).IgnoreArgument(3).IgnoreArgument(4)
+			.CopyOutArgumentBuffer_keys(&TEST_MAP_KEYS, sizeof(char**))
+			.CopyOutArgumentBuffer_values(&TEST_MAP_VALUES, sizeof(char**))
+			.CopyOutArgumentBuffer_count(&number_of_cached_app_properties, sizeof(size_t));
+	}
+
+	if (is_cache_hit)
+	{
+		STRICT_EXPECTED_CALL(message_set_application_properties(TEST_MESSAGE_HANDLE, TEST_CACHED_AMQP_VALUE));
+	}
+	else
+	{
+		STRICT_EXPECTED_CALL(amqpvalue_create_map()).SetReturn(TEST_AMQP_VALUE);
+		STRICT_EXPECTED_CALL(amqpvalue_create_string(TEST_MAP_KEYS[0]));
+		STRICT_EXPECTED_CALL(amqpvalue_create_string(TEST_MAP_VALUES[0]));
+		STRICT_EXPECTED_CALL(amqpvalue_set_map_value(TEST_AMQP_VALUE, TEST_AMQP_VALUE, TEST_AMQP_VALUE));
+		STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+		STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+		STRICT_EXPECTED_CALL(message_set_application_properties(TEST_MESSAGE_HANDLE, TEST_AMQP_VALUE));
+		if (is_cache_filled)
+		{
+			STRICT_EXPECTED_CALL(Map_Destroy(TEST_CACHED_MAP_HANDLE));
+			STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_CACHED_AMQP_VALUE));
+		}
+		if (is_cache_update_failing)
+		{
+			STRICT_EXPECTED_CALL(Map_Clone(TEST_MAP_HANDLE)).SetReturn(NULL);
+		}
+		else
+		{
+			STRICT_EXPECTED_CALL(Map_Clone(TEST_MAP_HANDLE)).SetReturn(TEST_CACHED_MAP_HANDLE);
+			STRICT_EXPECTED_CALL(amqpvalue_clone(TEST_AMQP_VALUE)).SetReturn(TEST_CACHED_AMQP_VALUE);
+		}
+		STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+	}
+}
+
+static void set_exp_calls_for_message_create_uamqp_encoding_from_iothub_message(bool has_application_properties)
+{
+	static AMQP_VALUE test_application_properties = TEST_AMQP_VALUE;
+	static BINARY_DATA test_body;
+	size_t section_count = has_application_properties ? 3 : 2;
+	size_t i;
+
+	test_body.bytes = (const unsigned char*)TEST_STRING;
+	test_body.length = strlen(TEST_STRING);
+
+	set_exp_calls_for_message_create_from_iothub_message(has_application_properties ? 1 : 0, IOTHUBMESSAGE_BYTEARRAY, true, true, true);
+	STRICT_EXPECTED_CALL(message_get_properties(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG))
+		.CopyOutArgumentBuffer_properties(&TEST_PROPERTIES_HANDLE_PTR, sizeof(PROPERTIES_HANDLE));
+	STRICT_EXPECTED_CALL(amqpvalue_create_properties(TEST_PROPERTIES_HANDLE));
+	if (has_application_properties)
+	{
+		STRICT_EXPECTED_CALL(message_get_application_properties(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG))
+			.CopyOutArgumentBuffer_application_properties(&test_application_properties, sizeof(AMQP_VALUE));
+		STRICT_EXPECTED_CALL(amqpvalue_create_application_properties(TEST_AMQP_VALUE));
+	}
+	else
+	{
+		STRICT_EXPECTED_CALL(message_get_application_properties(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG));
+	}
+	STRICT_EXPECTED_CALL(message_get_body_amqp_data(TEST_MESSAGE_HANDLE, 0, IGNORED_PTR_ARG))
+		.CopyOutArgumentBuffer_binary_data(&test_body, sizeof(BINARY_DATA));
+	EXPECTED_CALL(amqpvalue_create_data(IGNORED_PTR_ARG));
+	for (i = 0; i < section_count; i++)
+	{
+		STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
+	}
+	STRICT_EXPECTED_CALL(gballoc_malloc(section_count * TEST_SECTION_ENCODED_SIZE));
+	for (i = 0; i < section_count; i++)
+	{
+		STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+	}
+	for (i = 0; i < section_count; i++)
+	{
+		STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+	}
+	if (has_application_properties)
+	{
+		STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+	}
+	STRICT_EXPECTED_CALL(properties_destroy(TEST_PROPERTIES_HANDLE));
+	STRICT_EXPECTED_CALL(message_destroy(TEST_MESSAGE_HANDLE));
+}
+
 static void set_exp_calls_for_IoTHubMessage_CreateFromUamqpMessage(size_t number_of_properties, bool has_message_id, bool has_correlation_id, bool has_properties)
 {
 	static BINARY_DATA test_binary_data;
@@ -310,6 +441,13 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 	REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
 	REGISTER_UMOCK_ALIAS_TYPE(MAP_RESULT, int);
 	REGISTER_UMOCK_ALIAS_TYPE(AMQP_TYPE, int);
+	REGISTER_UMOCK_ALIAS_TYPE(data, void*);
+	REGISTER_UMOCK_ALIAS_TYPE(AMQPVALUE_ENCODER_OUTPUT, void*);
+
+	REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, real_malloc);
+	REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, real_free);
+	REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_encoded_size, test_amqpvalue_get_encoded_size);
+	REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_encode, test_amqpvalue_encode);
 
 	REGISTER_GLOBAL_MOCK_HOOK(properties_get_message_id, test_properties_get_message_id);
 	REGISTER_GLOBAL_MOCK_HOOK(properties_get_correlation_id, test_properties_get_correlation_id);
@@ -375,6 +513,16 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 	REGISTER_GLOBAL_MOCK_RETURN(properties_create, TEST_PROPERTIES_HANDLE);
 	REGISTER_GLOBAL_MOCK_FAIL_RETURN(properties_create, NULL);
 
+	REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_properties, TEST_AMQP_VALUE);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_create_properties, NULL);
+	REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_application_properties, TEST_AMQP_VALUE);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_create_application_properties, NULL);
+	REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_data, TEST_AMQP_VALUE);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_create_data, NULL);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_get_encoded_size, 1);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_encode, 1);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
 	// Initialization of variables.
 	TEST_MAP_KEYS = (char**)real_malloc(sizeof(char*) * 5);
 	ASSERT_IS_NOT_NULL_WITH_MSG(TEST_MAP_KEYS, "Could not allocate memory for TEST_MAP_KEYS");
@@ -813,4 +961,216 @@ TEST_FUNCTION(IoTHubMessage_CreateFromUamqpMessage_no_app_properties_success)
 	// cleanup
 }
 
+// Tests_SRS_UAMQP_MESSAGING_41_001: [If iothub_message or body_binary_data are NULL, message_create_uamqp_encoding_from_iothub_message() shall fail and return a non-zero value.]
+TEST_FUNCTION(message_create_uamqp_encoding_from_iothub_message_NULL_arguments_fail)
+{
+	// arrange
+	BINARY_DATA encoding;
+	umock_c_reset_all_calls();
+
+	// act
+	int result1 = message_create_uamqp_encoding_from_iothub_message(NULL, NULL, &encoding);
+	int result2 = message_create_uamqp_encoding_from_iothub_message(TEST_IOTHUB_MESSAGE_HANDLE, NULL, NULL);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_NOT_EQUAL(int, 0, result1);
+	ASSERT_ARE_NOT_EQUAL(int, 0, result2);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_002: [The sections shall be obtained from a uAMQP message created with message_create_from_iothub_message(), so a batched event carries the same properties as an event sent alone.]
+// Tests_SRS_UAMQP_MESSAGING_41_004: [The properties of the uAMQP message, if any, shall be turned into a properties section using message_get_properties() and amqpvalue_create_properties().]
+// Tests_SRS_UAMQP_MESSAGING_41_005: [The application properties of the uAMQP message, if any, shall be turned into an application-properties section using message_get_application_properties() and amqpvalue_create_application_properties().]
+// Tests_SRS_UAMQP_MESSAGING_41_006: [The body of the uAMQP message shall be turned into a data section using message_get_body_amqp_data() and amqpvalue_create_data().]
+// Tests_SRS_UAMQP_MESSAGING_41_007: [The size of the encoding shall be the sum of the sizes of the sections given by amqpvalue_get_encoded_size().]
+// Tests_SRS_UAMQP_MESSAGING_41_008: [The sections shall be encoded one after the other with amqpvalue_encode() into a buffer allocated with malloc(), which the caller owns.]
+// Tests_SRS_UAMQP_MESSAGING_41_009: [On success message_create_uamqp_encoding_from_iothub_message() shall set body_binary_data to the buffer and its size and return 0.]
+TEST_FUNCTION(message_create_uamqp_encoding_from_iothub_message_success)
+{
+	// arrange
+	BINARY_DATA encoding;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_uamqp_encoding_from_iothub_message(true);
+
+	// act
+	int result = message_create_uamqp_encoding_from_iothub_message(TEST_IOTHUB_MESSAGE_HANDLE, NULL, &encoding);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 3 * TEST_SECTION_ENCODED_SIZE, encoding.length);
+	ASSERT_ARE_EQUAL(int, 0, memcmp(encoding.bytes, TEST_SECTION_ENCODING TEST_SECTION_ENCODING TEST_SECTION_ENCODING, encoding.length));
+
+	// cleanup
+	real_free((void*)encoding.bytes);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_005: [The application properties of the uAMQP message, if any, shall be turned into an application-properties section using message_get_application_properties() and amqpvalue_create_application_properties().]
+TEST_FUNCTION(message_create_uamqp_encoding_from_iothub_message_without_application_properties_success)
+{
+	// arrange
+	BINARY_DATA encoding;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_uamqp_encoding_from_iothub_message(false);
+
+	// act
+	int result = message_create_uamqp_encoding_from_iothub_message(TEST_IOTHUB_MESSAGE_HANDLE, NULL, &encoding);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 2 * TEST_SECTION_ENCODED_SIZE, encoding.length);
+
+	// cleanup
+	real_free((void*)encoding.bytes);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_003: [If any uAMQP function fails, message_create_uamqp_encoding_from_iothub_message() shall free everything it allocated and return a non-zero value.]
+TEST_FUNCTION(when_encoding_a_section_fails_message_create_uamqp_encoding_from_iothub_message_fails)
+{
+	// arrange
+	BINARY_DATA encoding;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_from_iothub_message(0, IOTHUBMESSAGE_BYTEARRAY, true, true, true);
+	STRICT_EXPECTED_CALL(message_get_properties(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG))
+		.CopyOutArgumentBuffer_properties(&TEST_PROPERTIES_HANDLE_PTR, sizeof(PROPERTIES_HANDLE));
+	STRICT_EXPECTED_CALL(amqpvalue_create_properties(TEST_PROPERTIES_HANDLE));
+	STRICT_EXPECTED_CALL(message_get_application_properties(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG));
+	STRICT_EXPECTED_CALL(message_get_body_amqp_data(TEST_MESSAGE_HANDLE, 0, IGNORED_PTR_ARG));
+	EXPECTED_CALL(amqpvalue_create_data(IGNORED_PTR_ARG));
+	STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
+	STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
+	STRICT_EXPECTED_CALL(gballoc_malloc(2 * TEST_SECTION_ENCODED_SIZE));
+	STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+	STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+	STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
+	STRICT_EXPECTED_CALL(properties_destroy(TEST_PROPERTIES_HANDLE));
+	STRICT_EXPECTED_CALL(message_destroy(TEST_MESSAGE_HANDLE));
+
+	// act
+	encoding.bytes = NULL;
+	encoding.length = 0;
+	int result = message_create_uamqp_encoding_from_iothub_message(TEST_IOTHUB_MESSAGE_HANDLE, NULL, &encoding);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	ASSERT_IS_NULL(encoding.bytes);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_010: [If cache is NULL, message_create_from_iothub_message_with_cache() shall fail and return a non-zero value.]
+TEST_FUNCTION(message_create_from_iothub_message_with_cache_NULL_cache_fails)
+{
+	// arrange
+	MESSAGE_HANDLE uamqp_message = NULL;
+	umock_c_reset_all_calls();
+
+	// act
+	int result = message_create_from_iothub_message_with_cache(TEST_IOTHUB_MESSAGE_HANDLE, NULL, &uamqp_message);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	ASSERT_IS_NULL(uamqp_message);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_011: [message_create_from_iothub_message_with_cache() shall create the uAMQP message as message_create_from_iothub_message() does, except for the application properties.]
+// Tests_SRS_UAMQP_MESSAGING_41_014: [On a cache miss the properties map shall be copied with Map_Clone() and the uAMQP map kept with amqpvalue_clone(), replacing what the cache held.]
+TEST_FUNCTION(message_create_from_iothub_message_with_cache_fills_an_empty_cache)
+{
+	// arrange
+	UAMQP_APPLICATION_PROPERTIES_CACHE cache = { NULL, NULL };
+	MESSAGE_HANDLE uamqp_message = NULL;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_from_iothub_message_with_cache(false, false, false);
+
+	// act
+	int result = message_create_from_iothub_message_with_cache(TEST_IOTHUB_MESSAGE_HANDLE, &cache, &uamqp_message);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_MESSAGE_HANDLE, (void*)uamqp_message);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_MAP_HANDLE, (void*)cache.properties);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_AMQP_VALUE, (void*)cache.uamqp_map);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_013: [If a cache is given and it holds the same properties (same keys and values, in the same order), its uAMQP map shall be set on the uAMQP message with message_set_application_properties() instead of building a new one.]
+TEST_FUNCTION(message_create_from_iothub_message_with_cache_reuses_the_cached_map)
+{
+	// arrange
+	UAMQP_APPLICATION_PROPERTIES_CACHE cache = { TEST_CACHED_MAP_HANDLE, TEST_CACHED_AMQP_VALUE };
+	MESSAGE_HANDLE uamqp_message = NULL;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_from_iothub_message_with_cache(true, true, false);
+
+	// act
+	int result = message_create_from_iothub_message_with_cache(TEST_IOTHUB_MESSAGE_HANDLE, &cache, &uamqp_message);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_MAP_HANDLE, (void*)cache.properties);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_AMQP_VALUE, (void*)cache.uamqp_map);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_014: [On a cache miss the properties map shall be copied with Map_Clone() and the uAMQP map kept with amqpvalue_clone(), replacing what the cache held.]
+TEST_FUNCTION(message_create_from_iothub_message_with_cache_replaces_a_cache_with_other_properties)
+{
+	// arrange
+	UAMQP_APPLICATION_PROPERTIES_CACHE cache = { TEST_CACHED_MAP_HANDLE, TEST_CACHED_AMQP_VALUE };
+	MESSAGE_HANDLE uamqp_message = NULL;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_from_iothub_message_with_cache(true, false, false);
+
+	// act
+	int result = message_create_from_iothub_message_with_cache(TEST_IOTHUB_MESSAGE_HANDLE, &cache, &uamqp_message);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_MAP_HANDLE, (void*)cache.properties);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_CACHED_AMQP_VALUE, (void*)cache.uamqp_map);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_015: [If the cache cannot be updated, it shall be left empty and the message shall still be created.]
+TEST_FUNCTION(when_Map_Clone_fails_message_create_from_iothub_message_with_cache_leaves_the_cache_empty)
+{
+	// arrange
+	UAMQP_APPLICATION_PROPERTIES_CACHE cache = { NULL, NULL };
+	MESSAGE_HANDLE uamqp_message = NULL;
+	umock_c_reset_all_calls();
+	set_exp_calls_for_message_create_from_iothub_message_with_cache(false, false, true);
+
+	// act
+	int result = message_create_from_iothub_message_with_cache(TEST_IOTHUB_MESSAGE_HANDLE, &cache, &uamqp_message);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_MESSAGE_HANDLE, (void*)uamqp_message);
+	ASSERT_IS_NULL(cache.properties);
+	ASSERT_IS_NULL(cache.uamqp_map);
+}
+
+// Tests_SRS_UAMQP_MESSAGING_41_012: [message_clear_application_properties_cache() shall destroy the cached properties with Map_Destroy() and the cached uAMQP map with amqpvalue_destroy(), if any, and leave the cache empty.]
+TEST_FUNCTION(message_clear_application_properties_cache_destroys_the_cached_maps)
+{
+	// arrange
+	UAMQP_APPLICATION_PROPERTIES_CACHE cache = { TEST_CACHED_MAP_HANDLE, TEST_CACHED_AMQP_VALUE };
+	umock_c_reset_all_calls();
+	STRICT_EXPECTED_CALL(Map_Destroy(TEST_CACHED_MAP_HANDLE));
+	STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_CACHED_AMQP_VALUE));
+
+	// act
+	message_clear_application_properties_cache(&cache);
+
+	// assert
+	ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	ASSERT_IS_NULL(cache.properties);
+	ASSERT_IS_NULL(cache.uamqp_map);
+}
+
 END_TEST_SUITE(uamqp_messaging_ut)
@@ -82,6 +82,12 @@ typedef struct IOTHUB_REGISTRY_STATISTIC_TAG
     size_t disabledDeviceCount;
 } IOTHUB_REGISTRY_STATISTICS;
 
+/** @brief Callback receiving the devices of IoTHubRegistryManager_EnumerateDevices.
+*          The device and its strings are only valid during the callback.
+*          Return 0 to continue the enumeration, any other value to stop it.
+*/
+typedef int(*IOTHUB_DEVICE_ENUMERATION_CALLBACK)(void* context, const IOTHUB_DEVICE* device);
+
 /** @brief Structure to store IoTHub authentication information
 */
 typedef struct IOTHUB_REGISTRYMANAGER_TAG
@@ -91,6 +97,7 @@ typedef struct IOTHUB_REGISTRYMANAGER_TAG
     char* iothubSuffix;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_REGISTRYMANAGER;
 
 /** @brief Handle to hide struct and use it in consequent APIs
@@ -174,6 +181,23 @@ extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_DeleteDevice(IOTHUB_R
 */
 extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetDeviceList(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, size_t numberOfDevices, SINGLYLINKEDLIST_HANDLE deviceList);
 
+/**
+* @brief	Enumerates all the devices registered on the IoTHub, requesting
+*           them one page at a time and following the continuation token
+*           of every page, so the memory used does not depend on the number
+*           of devices. The devices are read with a device query, which does
+*           not return the symmetric keys; use IoTHubRegistryManager_GetDevice
+*           to get them.
+*
+* @param	registryManagerHandle   The handle created by a call to the create function.
+* @param	pageSize            Number of devices requested per page, between 1 and 1000.
+* @param	deviceCallback      Callback called with every device, see IOTHUB_DEVICE_ENUMERATION_CALLBACK.
+* @param	context             User context passed to deviceCallback.
+*
+* @return	IOTHUB_REGISTRYMANAGER_RESULT_OK upon success or an error code upon failure.
+*/
+extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_EnumerateDevices(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, size_t pageSize, IOTHUB_DEVICE_ENUMERATION_CALLBACK deviceCallback, void* context);
+
 /**
 * @brief	Gets the registry statistic info.
 *
@@ -184,6 +208,39 @@ extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetDeviceList(IOTHUB_
 */
 extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetStatistics(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, IOTHUB_REGISTRY_STATISTICS* registryStatistics);
 
+/**
+* @brief	Creates or updates a batch of devices, sending them to the IoTHub
+*           in bulk requests of up to 100 devices each.
+*
+* @param	registryManagerHandle   The handle created by a call to the create function.
+* @param	devices             Array of IOTHUB_REGISTRY_DEVICE_CREATE structures containing
+*                               the device Id, primaryKey (optional), secondaryKey (optional)
+*                               and authentication method of every device.
+* @param	deviceCount         Number of devices in the array.
+* @param	deviceResults       Array of deviceCount elements that receives the result of
+*                               every device.
+*
+* @return	IOTHUB_REGISTRYMANAGER_RESULT_OK if every device succeeded, otherwise the
+*           result of the first device that failed.
+*/
+extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_BulkCreateOrUpdate(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults);
+
+/**
+* @brief	Deletes a batch of devices, sending them to the IoTHub in bulk
+*           requests of up to 100 devices each.
+*
+* @param	registryManagerHandle   The handle created by a call to the create function.
+* @param	devices             Array of IOTHUB_REGISTRY_DEVICE_CREATE structures, only the
+*                               device Id of every device is used.
+* @param	deviceCount         Number of devices in the array.
+* @param	deviceResults       Array of deviceCount elements that receives the result of
+*                               every device.
+*
+* @return	IOTHUB_REGISTRYMANAGER_RESULT_OK if every device succeeded, otherwise the
+*           result of the first device that failed.
+*/
+extern IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_BulkDelete(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults);
+
 #ifdef __cplusplus
 }
 #endif
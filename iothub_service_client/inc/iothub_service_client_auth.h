@@ -38,6 +38,7 @@ extern "C"
 #endif
 
 #include "azure_c_shared_utility/macro_utils.h"
+#include "iothub_service_client_http_session.h"
 
 /** @brief Structure to store IoTHub authentication information
 */
@@ -48,6 +49,7 @@ typedef struct IOTHUB_SERVICE_CLIENT_AUTH_TAG
     char* iothubSuffix;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_SERVICE_CLIENT_AUTH;
 
 /** @brief Handle to hide struct and use it in consequent APIs
@@ -0,0 +1,87 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_service_client_http_session.h
+*	@brief	 A pool of persistent HTTPS sessions shared by the HTTP based
+*			 Service client modules (registry manager, device twin and
+*			 device method).
+*
+*	@details The pool belongs to an IOTHUB_SERVICE_CLIENT_AUTH_HANDLE. It keeps
+*			 the HTTPAPIEX handles of finished requests open, so the next
+*			 request reuses their TCP and TLS connection, and it caches the
+*			 SAS token of the hub, creating a new one only when the cached
+*			 one is about to expire. Requests can be executed from several
+*			 threads, every request takes a session of its own from the pool.
+*			 The pool is reference counted, every Service client module
+*			 handle keeps a reference so it can outlive the auth handle.
+*/
+
+#ifndef IOTHUB_SERVICE_CLIENT_HTTP_SESSION_H
+#define IOTHUB_SERVICE_CLIENT_HTTP_SESSION_H
+
+#include "azure_c_shared_utility/httpapiex.h"
+#include "azure_c_shared_utility/httpheaders.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#endif
+
+/** @brief Handle to hide struct and use it in consequent APIs
+*/
+typedef struct IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_TAG* IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE;
+
+/**
+* @brief	Creates a pool of HTTPS sessions to an IoT Hub.
+*
+* @param	hostname			The host name of the IoT Hub.
+* @param	sharedAccessKey		The shared access key used to sign the SAS tokens.
+* @param	keyName				The name of the shared access policy.
+*
+* @return	A non-NULL @c IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE holding one
+*			reference, @c NULL on failure.
+*/
+MOCKABLE_FUNCTION(, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, IoTHubServiceClientHttpSession_CreatePool, const char*, hostname, const char*, sharedAccessKey, const char*, keyName);
+
+/**
+* @brief	Takes one more reference to a pool.
+*
+* @param	sessionPoolHandle	The handle created by a call to the create function.
+*
+* @return	@p sessionPoolHandle, @c NULL on failure.
+*/
+MOCKABLE_FUNCTION(, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, IoTHubServiceClientHttpSession_ClonePool, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, sessionPoolHandle);
+
+/**
+* @brief	Releases one reference to a pool, closing its sessions when the
+*			last reference is released.
+*
+* @param	sessionPoolHandle	The handle created by a call to the create function.
+*/
+MOCKABLE_FUNCTION(, void, IoTHubServiceClientHttpSession_DestroyPool, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, sessionPoolHandle);
+
+/**
+* @brief	Executes an HTTP request on a session of the pool, authorized
+*			with the cached SAS token.
+*
+* @param	sessionPoolHandle			The handle created by a call to the create function.
+* @param	requestType					The HTTP verb of the request.
+* @param	relativePath				The path of the request, relative to the host name.
+* @param	requestHttpHeadersHandle	The request headers, the Authorization header is set by the pool.
+* @param	requestContent				The request body, can be @c NULL.
+* @param	statusCode					Receives the HTTP status code of the response.
+* @param	responseHttpHeadersHandle	Receives the response headers, can be @c NULL.
+* @param	responseContent				Receives the response body, can be @c NULL.
+*
+* @return	HTTPAPIEX_OK on success, an error code otherwise.
+*/
+MOCKABLE_FUNCTION(, HTTPAPIEX_RESULT, IoTHubServiceClientHttpSession_ExecuteRequest, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, sessionPoolHandle, HTTPAPI_REQUEST_TYPE, requestType, const char*, relativePath, HTTP_HEADERS_HANDLE, requestHttpHeadersHandle, BUFFER_HANDLE, requestContent, unsigned int*, statusCode, HTTP_HEADERS_HANDLE, responseHttpHeadersHandle, BUFFER_HANDLE, responseContent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IOTHUB_SERVICE_CLIENT_HTTP_SESSION_H
@@ -10,13 +10,13 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/uniqueid.h"
 #include "azure_c_shared_utility/connection_string_parser.h"
 
 #include "parson.h"
 #include "iothub_devicemethod.h"
+#include "iothub_service_client_http_session.h"
 #include "iothub_sc_version.h"
 
 #define IOTHUB_DEVICE_METHOD_REQUEST_MODE_VALUES    \
@@ -46,6 +46,7 @@ typedef struct IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_TAG
     char* hostname;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_SERVICE_CLIENT_DEVICE_METHOD;
 
 static IOTHUB_DEVICE_METHOD_RESULT parseResponseJson(BUFFER_HANDLE responseJson, int* responseStatus, unsigned char** responsePayload, size_t* responsePayloadSize)
@@ -236,58 +237,13 @@ static IOTHUB_DEVICE_METHOD_RESULT sendHttpRequestDeviceMethod(IOTHUB_SERVICE_CL
 {
     IOTHUB_DEVICE_METHOD_RESULT result;
 
-    STRING_HANDLE uriResouce;
-    STRING_HANDLE accessKey;
-    STRING_HANDLE keyName;
-    HTTPAPIEX_SAS_HANDLE httpExApiSasHandle;
-    HTTPAPIEX_HANDLE httpExApiHandle;
     HTTP_HEADERS_HANDLE httpHeader;
 
-    if ((uriResouce = STRING_construct(serviceClientDeviceMethodHandle->hostname)) == NULL)
-    {
-        LogError("STRING_construct failed for uriResource");
-        result = IOTHUB_DEVICE_METHOD_ERROR;
-    }
-    else if ((accessKey = STRING_construct(serviceClientDeviceMethodHandle->sharedAccessKey)) == NULL)
-    {
-        LogError("STRING_construct failed for accessKey");
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_METHOD_ERROR;
-    }
-    else if ((keyName = STRING_construct(serviceClientDeviceMethodHandle->keyName)) == NULL)
-    {
-        LogError("STRING_construct failed for keyName");
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_METHOD_ERROR;
-    }
-    else if ((httpHeader = createHttpHeader()) == NULL)
+    if ((httpHeader = createHttpHeader()) == NULL)
     {
         LogError("HttpHeader creation failed");
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
         result = IOTHUB_DEVICE_METHOD_ERROR;
     }
-    else if ((httpExApiSasHandle = HTTPAPIEX_SAS_Create(accessKey, uriResouce, keyName)) == NULL)
-    {
-        LogError("HTTPAPIEX_SAS_Create failed");
-        HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_METHOD_HTTPAPI_ERROR;
-    }
-    else if ((httpExApiHandle = HTTPAPIEX_Create(serviceClientDeviceMethodHandle->hostname)) == NULL)
-    {
-        LogError("HTTPAPIEX_Create failed");
-        HTTPAPIEX_SAS_Destroy(httpExApiSasHandle);
-        HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_METHOD_HTTPAPI_ERROR;
-    }
     else 
     {
         HTTPAPI_REQUEST_TYPE httpApiRequestType = HTTPAPI_REQUEST_GET;
@@ -316,9 +272,9 @@ static IOTHUB_DEVICE_METHOD_RESULT sendHttpRequestDeviceMethod(IOTHUB_SERVICE_CL
                 LogError("Failure creating relative path");
                 result = IOTHUB_DEVICE_METHOD_ERROR;
             }
-            else if (HTTPAPIEX_SAS_ExecuteRequest(httpExApiSasHandle, httpExApiHandle, httpApiRequestType, STRING_c_str(relativePath), httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
+            else if (IoTHubServiceClientHttpSession_ExecuteRequest(serviceClientDeviceMethodHandle->httpSessionPool, httpApiRequestType, STRING_c_str(relativePath), httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
             {
-                LogError("HTTPAPIEX_SAS_ExecuteRequest failed");
+                LogError("IoTHubServiceClientHttpSession_ExecuteRequest failed");
                 STRING_delete(relativePath);
                 result = IOTHUB_DEVICE_METHOD_HTTPAPI_ERROR;
             }
@@ -336,12 +292,7 @@ static IOTHUB_DEVICE_METHOD_RESULT sendHttpRequestDeviceMethod(IOTHUB_SERVICE_CL
                 }
             }
         }
-        HTTPAPIEX_Destroy(httpExApiHandle);
-        HTTPAPIEX_SAS_Destroy(httpExApiSasHandle);
         HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
     }
     return result;
 }
@@ -425,6 +376,17 @@ IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_HANDLE IoTHubDeviceMethod_Create(IOTHUB_SERV
                     free(result);
                     result = NULL;
                 }
+                /*Codes_SRS_IOTHUBDEVICEMETHOD_41_001: [ IoTHubDeviceMethod_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool. ]*/
+                else if ((result->httpSessionPool = IoTHubServiceClientHttpSession_ClonePool(serviceClientAuth->httpSessionPool)) == NULL)
+                {
+                    /*Codes_SRS_IOTHUBDEVICEMETHOD_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubDeviceMethod_Create shall do clean up and return NULL. ]*/
+                    LogError("IoTHubServiceClientHttpSession_ClonePool failed");
+                    free(result->hostname);
+                    free(result->sharedAccessKey);
+                    free(result->keyName);
+                    free(result);
+                    result = NULL;
+                }
             }
         }
     }
@@ -439,6 +401,8 @@ void IoTHubDeviceMethod_Destroy(IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_HANDLE servi
         /*Codes_SRS_IOTHUBDEVICEMETHOD_12_017: [ If the serviceClientDeviceMethodHandle input parameter is not NULL IoTHubDeviceMethod_Destroy shall free the memory of it and return ]*/
         IOTHUB_SERVICE_CLIENT_DEVICE_METHOD* serviceClientDeviceMethod = (IOTHUB_SERVICE_CLIENT_DEVICE_METHOD*)serviceClientDeviceMethodHandle;
 
+        /*Codes_SRS_IOTHUBDEVICEMETHOD_41_003: [ IoTHubDeviceMethod_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ]*/
+        IoTHubServiceClientHttpSession_DestroyPool(serviceClientDeviceMethod->httpSessionPool);
         free(serviceClientDeviceMethod->hostname);
         free(serviceClientDeviceMethod->sharedAccessKey);
         free(serviceClientDeviceMethod->keyName);
@@ -478,9 +442,9 @@ IOTHUB_DEVICE_METHOD_RESULT  IoTHubDeviceMethod_Invoke(IOTHUB_SERVICE_CLIENT_DEV
         }
         /*Codes_SRS_IOTHUBDEVICEMETHOD_12_039: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using methodPayloadBuffer ]*/
         /*Codes_SRS_IOTHUBDEVICEMETHOD_12_040: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using the following HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling HTTPAPIEX_ExecuteRequest ]*/
+        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall execute the request on a session of the HTTP session pool of the service client ]*/
+        /*Codes_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
         else if (sendHttpRequestDeviceMethod(serviceClientDeviceMethodHandle, IOTHUB_DEVICEMETHOD_REQUEST_INVOKE, deviceId, httpPayloadBuffer, responseBuffer) != IOTHUB_DEVICE_METHOD_OK)
         {
             /*Codes_SRS_IOTHUBDEVICEMETHOD_12_044: [ If any of the call fails during the HTTP creation IoTHubDeviceMethod_Invoke shall fail and return IOTHUB_DEVICE_METHOD_HTTPAPI_ERROR ]*/
@@ -10,13 +10,13 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/uniqueid.h"
 #include "azure_c_shared_utility/connection_string_parser.h"
 
 #include "parson.h"
 #include "iothub_devicetwin.h"
+#include "iothub_service_client_http_session.h"
 #include "iothub_sc_version.h"
 
 #define IOTHUB_TWIN_REQUEST_MODE_VALUES    \
@@ -55,6 +55,7 @@ typedef struct IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_TAG
     char* hostname;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_SERVICE_CLIENT_DEVICE_TWIN;
 
 static const char* generateGuid(void)
@@ -152,67 +153,15 @@ static IOTHUB_DEVICE_TWIN_RESULT sendHttpRequestTwin(IOTHUB_SERVICE_CLIENT_DEVIC
 {
     IOTHUB_DEVICE_TWIN_RESULT result;
 
-    STRING_HANDLE uriResouce;
-    STRING_HANDLE accessKey;
-    STRING_HANDLE keyName;
-    HTTPAPIEX_SAS_HANDLE httpExApiSasHandle;
-    HTTPAPIEX_HANDLE httpExApiHandle;
     HTTP_HEADERS_HANDLE httpHeader;
 
-    if ((uriResouce = STRING_construct(serviceClientDeviceTwinHandle->hostname)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_024: [ If any of the HTTPAPI call fails IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
-        LogError("STRING_construct failed for uriResource");
-        result = IOTHUB_DEVICE_TWIN_ERROR;
-    }
-    else if ((accessKey = STRING_construct(serviceClientDeviceTwinHandle->sharedAccessKey)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_024: [ If any of the call fails during the HTTP creation IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
-        LogError("STRING_construct failed for accessKey");
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_TWIN_ERROR;
-    }
-    else if ((keyName = STRING_construct(serviceClientDeviceTwinHandle->keyName)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_024: [ If any of the call fails during the HTTP creation IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
-        LogError("STRING_construct failed for keyName");
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_TWIN_ERROR;
-    }
     /*Codes_SRS_IOTHUBDEVICETWIN_12_020: [ IoTHubDeviceTwin_GetTwin shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-    else if ((httpHeader = createHttpHeader(iotHubTwinRequestMode)) == NULL)
+    if ((httpHeader = createHttpHeader(iotHubTwinRequestMode)) == NULL)
     {
         /*Codes_SRS_IOTHUBDEVICETWIN_12_024: [ If any of the call fails during the HTTP creation IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
         LogError("HttpHeader creation failed");
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
         result = IOTHUB_DEVICE_TWIN_ERROR;
     }
-    /*Codes_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-    else if ((httpExApiSasHandle = HTTPAPIEX_SAS_Create(accessKey, uriResouce, keyName)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_025: [ If any of the HTTPAPI call fails IoTHubDeviceTwin_GetTwin shall fail and return IOTHUB_DEVICE_TWIN_HTTPAPI_ERROR ]*/
-        LogError("HTTPAPIEX_SAS_Create failed");
-        HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_TWIN_HTTPAPI_ERROR;
-    }
-    /*Codes_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-    else if ((httpExApiHandle = HTTPAPIEX_Create(serviceClientDeviceTwinHandle->hostname)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_025: [ If any of the HTTPAPI call fails IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
-        LogError("HTTPAPIEX_Create failed");
-        HTTPAPIEX_SAS_Destroy(httpExApiSasHandle);
-        HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
-        result = IOTHUB_DEVICE_TWIN_HTTPAPI_ERROR;
-    }
     else 
     {
         HTTPAPI_REQUEST_TYPE httpApiRequestType = HTTPAPI_REQUEST_GET;
@@ -257,11 +206,13 @@ static IOTHUB_DEVICE_TWIN_RESULT sendHttpRequestTwin(IOTHUB_SERVICE_CLIENT_DEVIC
                 LogError("Failure creating relative path");
                 result = IOTHUB_DEVICE_TWIN_ERROR;
             }
-            /*Codes_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
-            else if (HTTPAPIEX_SAS_ExecuteRequest(httpExApiSasHandle, httpExApiHandle, httpApiRequestType, STRING_c_str(relativePath), httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
+            /*Codes_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+            /*Codes_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+            /*Codes_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
+            else if (IoTHubServiceClientHttpSession_ExecuteRequest(serviceClientDeviceTwinHandle->httpSessionPool, httpApiRequestType, STRING_c_str(relativePath), httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
             {
                 /*Codes_SRS_IOTHUBDEVICETWIN_12_025: [ If any of the HTTPAPI call fails IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
-                LogError("HTTPAPIEX_SAS_ExecuteRequest failed");
+                LogError("IoTHubServiceClientHttpSession_ExecuteRequest failed");
                 STRING_delete(relativePath);
                 result = IOTHUB_DEVICE_TWIN_HTTPAPI_ERROR;
             }
@@ -281,12 +232,7 @@ static IOTHUB_DEVICE_TWIN_RESULT sendHttpRequestTwin(IOTHUB_SERVICE_CLIENT_DEVIC
                 }
             }
         }
-        HTTPAPIEX_Destroy(httpExApiHandle);
-        HTTPAPIEX_SAS_Destroy(httpExApiSasHandle);
         HTTPHeaders_Free(httpHeader);
-        STRING_delete(keyName);
-        STRING_delete(accessKey);
-        STRING_delete(uriResouce);
     }
     return result;
 }
@@ -370,6 +316,17 @@ IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_HANDLE IoTHubDeviceTwin_Create(IOTHUB_SERVICE_
                     free(result);
                     result = NULL;
                 }
+                /*Codes_SRS_IOTHUBDEVICETWIN_41_001: [ IoTHubDeviceTwin_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool. ]*/
+                else if ((result->httpSessionPool = IoTHubServiceClientHttpSession_ClonePool(serviceClientAuth->httpSessionPool)) == NULL)
+                {
+                    /*Codes_SRS_IOTHUBDEVICETWIN_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubDeviceTwin_Create shall do clean up and return NULL. ]*/
+                    LogError("IoTHubServiceClientHttpSession_ClonePool failed");
+                    free(result->hostname);
+                    free(result->sharedAccessKey);
+                    free(result->keyName);
+                    free(result);
+                    result = NULL;
+                }
             }
         }
     }
@@ -384,6 +341,8 @@ void IoTHubDeviceTwin_Destroy(IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_HANDLE serviceCl
         /*Codes_SRS_IOTHUBDEVICETWIN_12_017: [ If the serviceClientDeviceTwinHandle input parameter is not NULL IoTHubDeviceTwin_Destroy shall free the memory of it and return ]*/
         IOTHUB_SERVICE_CLIENT_DEVICE_TWIN* serviceClientDeviceTwin = (IOTHUB_SERVICE_CLIENT_DEVICE_TWIN*)serviceClientDeviceTwinHandle;
 
+        /*Codes_SRS_IOTHUBDEVICETWIN_41_003: [ IoTHubDeviceTwin_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ]*/
+        IoTHubServiceClientHttpSession_DestroyPool(serviceClientDeviceTwin->httpSessionPool);
         free(serviceClientDeviceTwin->hostname);
         free(serviceClientDeviceTwin->sharedAccessKey);
         free(serviceClientDeviceTwin->keyName);
@@ -440,9 +399,9 @@ char* IoTHubDeviceTwin_GetTwin(IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_HANDLE serviceC
         }
         /*Codes_SRS_IOTHUBDEVICETWIN_12_019: [ IoTHubDeviceTwin_GetTwin shall create HTTP GET request URL using the given deviceId using the following format: url/twins/[deviceId] ]*/
         /*Codes_SRS_IOTHUBDEVICETWIN_12_020: [ IoTHubDeviceTwin_GetTwin shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-        /*Codes_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+        /*Codes_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+        /*Codes_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+        /*Codes_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
         else if (sendHttpRequestTwin(serviceClientDeviceTwinHandle, IOTHUB_TWIN_REQUEST_GET, deviceId, NULL, responseBuffer) != IOTHUB_DEVICE_TWIN_OK)
         {
             /*Codes_SRS_IOTHUBDEVICETWIN_12_024: [ If any of the call fails during the HTTP creation IoTHubDeviceTwin_GetTwin shall fail and return NULL ]*/
@@ -498,9 +457,9 @@ char* IoTHubDeviceTwin_UpdateTwin(IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_HANDLE servi
         }
         /*CodesSRS_IOTHUBDEVICETWIN_12_039: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using deviceTwinJson ]*/
         /*CodesSRS_IOTHUBDEVICETWIN_12_040: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using the createdfollowing HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-        /*CodesSRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-        /*CodesSRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-        /*CodesSRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling HTTPAPIEX_ExecuteRequest ]*/
+        /*CodesSRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+        /*CodesSRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+        /*CodesSRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
         else if (sendHttpRequestTwin(serviceClientDeviceTwinHandle, IOTHUB_TWIN_REQUEST_UPDATE, deviceId, updateJson, responseBuffer) != IOTHUB_DEVICE_TWIN_OK)
         {
             /*CodesSRS_IOTHUBDEVICETWIN_12_044: [ If any of the call fails during the HTTP creation IoTHubDeviceTwin_UpdateTwin shall fail and return NULL ]*/
@@ -10,11 +10,11 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
 #include "azure_c_shared_utility/connection_string_parser.h"
 
 #include "parson.h"
 #include "iothub_registrymanager.h"
+#include "iothub_service_client_http_session.h"
 #include "iothub_sc_version.h"
 
 #define IOTHUB_REQUEST_MODE_VALUES    \
@@ -23,7 +23,9 @@
     IOTHUB_REQUEST_UPDATE,            \
     IOTHUB_REQUEST_DELETE,            \
     IOTHUB_REQUEST_GET_DEVICE_LIST,   \
-    IOTHUB_REQUEST_GET_STATISTICS     \
+    IOTHUB_REQUEST_GET_STATISTICS,    \
+    IOTHUB_REQUEST_BULK,              \
+    IOTHUB_REQUEST_QUERY_DEVICES      \
 
 DEFINE_ENUM(IOTHUB_REQUEST_MODE, IOTHUB_REQUEST_MODE_VALUES);
 
@@ -39,8 +41,11 @@ DEFINE_ENUM(IOTHUB_REQUEST_MODE, IOTHUB_REQUEST_MODE_VALUES);
 #define  HTTP_HEADER_VAL_CONTENT_TYPE  "application/json; charset=utf-8"
 #define  HTTP_HEADER_KEY_IFMATCH  "If-Match"
 #define  HTTP_HEADER_VAL_IFMATCH  "*"
+#define  HTTP_HEADER_KEY_MAX_ITEM_COUNT  "x-ms-max-item-count"
+#define  HTTP_HEADER_KEY_CONTINUATION  "x-ms-continuation"
 
 static size_t IOTHUB_DEVICES_MAX_REQUEST = 1000;
+static size_t IOTHUB_DEVICES_MAX_BULK_REQUEST = 100;
 
 static void* DEVICE_JSON_DEFAULT_VALUE_NULL = NULL;
 static const char* DEVICE_JSON_KEY_DEVICE_NAME = "deviceId";
@@ -67,6 +72,18 @@ static const char* DEVICE_JSON_KEY_DEVICE_CONFIGURATION = "configuration";
 static const char* DEVICE_JSON_KEY_DEVICE_DEVICEROPERTIES = "deviceProperties";
 static const char* DEVICE_JSON_KEY_DEVICE_SERVICEPROPERTIES = "serviceProperties";
 
+static const char* DEVICE_JSON_KEY_BULK_DEVICE_NAME = "id";
+static const char* DEVICE_JSON_KEY_BULK_IMPORT_MODE = "importMode";
+static const char* DEVICE_JSON_KEY_BULK_ERRORS = "errors";
+static const char* DEVICE_JSON_KEY_BULK_ERROR_CODE = "errorCode";
+static const char* DEVICE_JSON_KEY_BULK_IS_SUCCESSFUL = "isSuccessful";
+
+static const char* DEVICE_JSON_KEY_QUERY_STATUSUPDATEDTIME = "statusUpdateTime";
+static const char* DEVICE_JSON_KEY_QUERY_DEVICE_ETAG = "deviceEtag";
+static const char* DEVICE_JSON_KEY_QUERY_AUTHENTICATION_TYPE = "authenticationType";
+static const char* DEVICE_JSON_KEY_QUERY_PRIMARY_THUMBPRINT = "x509Thumbprint.primaryThumbprint";
+static const char* DEVICE_JSON_KEY_QUERY_SECONDARY_THUMBPRINT = "x509Thumbprint.secondaryThumbprint";
+
 static const char* DEVICE_JSON_KEY_TOTAL_DEVICECOUNT = "totalDeviceCount";
 static const char* DEVICE_JSON_KEY_ENABLED_DEVICECCOUNT = "enabledDeviceCount";
 static const char* DEVICE_JSON_KEY_DISABLED_DEVICECOUNT = "disabledDeviceCount";
@@ -78,12 +95,21 @@ static const char* DEVICE_JSON_DEFAULT_VALUE_DISCONNECTED = "Disconnected";
 static const char* DEVICE_JSON_DEFAULT_VALUE_TIME = "0001-01-01T00:00:00";
 static const char* DEVICE_JSON_DEFAULT_VALUE_TRUE = "true";
 static const char* DEVICE_JSON_DEFAULT_VALUE_FALSE = "false";
+static const char* DEVICE_JSON_DEFAULT_VALUE_IMPORT_MODE_CREATE_OR_UPDATE = "createOrUpdate";
+static const char* DEVICE_JSON_DEFAULT_VALUE_IMPORT_MODE_DELETE = "delete";
+static const char* DEVICE_JSON_DEFAULT_VALUE_DEVICE_ALREADY_EXISTS = "DeviceAlreadyExists";
+static const char* DEVICE_JSON_DEFAULT_VALUE_DEVICE_NOT_FOUND = "DeviceNotFound";
+static const char* DEVICE_JSON_QUERY_VALUE_ENABLED = "enabled";
+static const char* DEVICE_JSON_QUERY_VALUE_AUTHENTICATION_SAS = "sas";
+static const char* DEVICE_QUERY_ALL_DEVICES = "{\"query\":\"SELECT * FROM devices\"}";
 
 static const char* URL_API_VERSION = "api-version=2016-11-14";
 
 static const char* RELATIVE_PATH_FMT_CRUD = "/devices/%s?%s";
 static const char* RELATIVE_PATH_FMT_LIST = "/devices/?top=%s&%s";
 static const char* RELATIVE_PATH_FMT_STAT = "/statistics/devices?%s";
+static const char* RELATIVE_PATH_FMT_BULK = "/devices?%s";
+static const char* RELATIVE_PATH_FMT_QUERY = "/devices/query?%s";
 
 static int strHasNoWhitespace(const char* s)
 {
@@ -969,6 +995,283 @@ static IOTHUB_REGISTRYMANAGER_RESULT parseStatisticsJson(BUFFER_HANDLE jsonBuffe
     return result;
 }
 
+static BUFFER_HANDLE constructBulkDeviceJson(const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, const char* importMode)
+{
+    BUFFER_HANDLE result = NULL;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_007: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall create a JSON array for every chunk, with one object per device holding "id" and "importMode", using the following parson APIs: json_value_init_array, json_value_get_array, json_value_init_object, json_value_get_object, json_object_set_string, json_object_dotset_string, json_array_append_value ] */
+    JSON_Value* root_value = NULL;
+    JSON_Array* root_array = NULL;
+
+    if ((root_value = json_value_init_array()) == NULL)
+    {
+        LogError("json_value_init_array failed");
+    }
+    else if ((root_array = json_value_get_array(root_value)) == NULL)
+    {
+        LogError("json_value_get_array failed");
+    }
+    else
+    {
+        size_t i;
+        unsigned char is_error = 0;
+
+        for (i = 0; (i < deviceCount) && (is_error == 0); i++)
+        {
+            const IOTHUB_REGISTRY_DEVICE_CREATE* device = &devices[i];
+            JSON_Value* device_value;
+            JSON_Object* device_object;
+
+            if ((device_value = json_value_init_object()) == NULL)
+            {
+                LogError("json_value_init_object failed");
+                is_error = 1;
+            }
+            else
+            {
+                if ((device_object = json_value_get_object(device_value)) == NULL)
+                {
+                    LogError("json_value_get_object failed");
+                    is_error = 1;
+                }
+                else if (json_object_set_string(device_object, DEVICE_JSON_KEY_BULK_DEVICE_NAME, device->deviceId) != JSONSuccess)
+                {
+                    LogError("json_object_set_string failed for id");
+                    is_error = 1;
+                }
+                else if (json_object_set_string(device_object, DEVICE_JSON_KEY_BULK_IMPORT_MODE, importMode) != JSONSuccess)
+                {
+                    LogError("json_object_set_string failed for importMode");
+                    is_error = 1;
+                }
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_014: [ IoTHubRegistryManager_BulkCreateOrUpdate shall set the keys of every device whose primaryKey or secondaryKey is not NULL in the same way as IoTHubRegistryManager_CreateDevice, depending on its authMethod ] */
+                else if (strcmp(importMode, DEVICE_JSON_DEFAULT_VALUE_IMPORT_MODE_CREATE_OR_UPDATE) == 0)
+                {
+                    const char* primaryKeyName = (device->authMethod == IOTHUB_REGISTRYMANAGER_AUTH_SPK) ? DEVICE_JSON_KEY_DEVICE_PRIMARY_KEY : DEVICE_JSON_KEY_DEVICE_PRIMARY_THUMBPRINT;
+                    const char* secondaryKeyName = (device->authMethod == IOTHUB_REGISTRYMANAGER_AUTH_SPK) ? DEVICE_JSON_KEY_DEVICE_SECONDARY_KEY : DEVICE_JSON_KEY_DEVICE_SECONDARY_THUMBPRINT;
+
+                    if ((device->primaryKey != NULL) && (json_object_dotset_string(device_object, primaryKeyName, device->primaryKey) != JSONSuccess))
+                    {
+                        LogError("json_object_dotset_string failed for primary key");
+                        is_error = 1;
+                    }
+                    else if ((device->secondaryKey != NULL) && (json_object_dotset_string(device_object, secondaryKeyName, device->secondaryKey) != JSONSuccess))
+                    {
+                        LogError("json_object_dotset_string failed for secondary key");
+                        is_error = 1;
+                    }
+                }
+
+                if (is_error != 0)
+                {
+                    json_value_free(device_value);
+                }
+                else if (json_array_append_value(root_array, device_value) != JSONSuccess)
+                {
+                    LogError("json_array_append_value failed");
+                    json_value_free(device_value);
+                    is_error = 1;
+                }
+            }
+        }
+
+        if (is_error == 0)
+        {
+            char* serialized_string;
+            if ((serialized_string = json_serialize_to_string(root_value)) == NULL)
+            {
+                LogError("json_serialize_to_string failed");
+            }
+            else
+            {
+                if ((result = BUFFER_create((const unsigned char*)serialized_string, strlen(serialized_string))) == NULL)
+                {
+                    LogError("Buffer_Create failed");
+                }
+                json_free_serialized_string(serialized_string);
+            }
+        }
+    }
+
+    if (root_value != NULL)
+        json_value_free(root_value);
+
+    return result;
+}
+
+static void parseBulkResultJson(BUFFER_HANDLE jsonBuffer, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults)
+{
+    const char* bufferStr = NULL;
+    JSON_Value* root_value = NULL;
+    JSON_Object* root_object = NULL;
+    JSON_Array* errors_array = NULL;
+    size_t errorCount = 0;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_010: [ If the response of a chunk carries an "errors" array in its JSON, whatever its HTTP status code, IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of the chunk to IOTHUB_REGISTRYMANAGER_OK, then set the result of every device named by "deviceId" in the array to IOTHUB_REGISTRYMANAGER_DEVICE_EXIST if its "errorCode" is "DeviceAlreadyExists", IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST if it is "DeviceNotFound" and IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR otherwise ] */
+    if ((bufferStr = (const char*)BUFFER_u_char(jsonBuffer)) == NULL)
+    {
+        LogError("BUFFER_u_char failed");
+    }
+    else if ((root_value = json_parse_string(bufferStr)) == NULL)
+    {
+        LogError("json_parse_string failed");
+    }
+    else if ((root_object = json_value_get_object(root_value)) == NULL)
+    {
+        LogError("json_value_get_object failed");
+    }
+    else if (((errors_array = json_object_get_array(root_object, DEVICE_JSON_KEY_BULK_ERRORS)) != NULL) &&
+        ((errorCount = json_array_get_count(errors_array)) > 0))
+    {
+        size_t i;
+
+        for (i = 0; i < deviceCount; i++)
+        {
+            deviceResults[i] = IOTHUB_REGISTRYMANAGER_OK;
+        }
+
+        for (i = 0; i < errorCount; i++)
+        {
+            JSON_Object* error_object;
+            const char* deviceId;
+            const char* errorCode;
+
+            if (((error_object = json_array_get_object(errors_array, i)) == NULL) ||
+                ((deviceId = json_object_get_string(error_object, DEVICE_JSON_KEY_DEVICE_NAME)) == NULL))
+            {
+                LogError("Bulk response error %zu has no deviceId", i);
+            }
+            else
+            {
+                size_t j;
+                errorCode = json_object_get_string(error_object, DEVICE_JSON_KEY_BULK_ERROR_CODE);
+
+                for (j = 0; j < deviceCount; j++)
+                {
+                    if (strcmp(devices[j].deviceId, deviceId) == 0)
+                    {
+                        if ((errorCode != NULL) && (strcmp(errorCode, DEVICE_JSON_DEFAULT_VALUE_DEVICE_ALREADY_EXISTS) == 0))
+                        {
+                            deviceResults[j] = IOTHUB_REGISTRYMANAGER_DEVICE_EXIST;
+                        }
+                        else if ((errorCode != NULL) && (strcmp(errorCode, DEVICE_JSON_DEFAULT_VALUE_DEVICE_NOT_FOUND) == 0))
+                        {
+                            deviceResults[j] = IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST;
+                        }
+                        else
+                        {
+                            LogError("Bulk operation failed for device %s with error %s", deviceId, (errorCode == NULL) ? "<unknown>" : errorCode);
+                            deviceResults[j] = IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_027: [ If the response of a chunk has no error in its "errors" array but its "isSuccessful" is false, IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of the chunk to IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ] */
+    else if (json_object_get_boolean(root_object, DEVICE_JSON_KEY_BULK_IS_SUCCESSFUL) == 0)
+    {
+        size_t i;
+
+        LogError("Bulk response is not successful but names no device");
+        for (i = 0; i < deviceCount; i++)
+        {
+            deviceResults[i] = IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR;
+        }
+    }
+
+    if (root_value != NULL)
+        json_value_free(root_value);
+}
+
+static IOTHUB_REGISTRYMANAGER_RESULT parseDeviceQueryPageJson(BUFFER_HANDLE jsonBuffer, IOTHUB_DEVICE_ENUMERATION_CALLBACK deviceCallback, void* context, int* isStopped)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    const char* bufferStr = NULL;
+    JSON_Value* root_value = NULL;
+    JSON_Array* device_array = NULL;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_020: [ IoTHubRegistryManager_EnumerateDevices shall parse every page with the following parson APIs: json_parse_string, json_value_get_array, json_array_get_count, json_array_get_object, json_object_get_string, json_object_dotget_string, json_object_get_number, and free it with json_value_free before requesting the next page ] */
+    if ((bufferStr = (const char*)BUFFER_u_char(jsonBuffer)) == NULL)
+    {
+        LogError("BUFFER_u_char failed");
+        result = IOTHUB_REGISTRYMANAGER_ERROR;
+    }
+    else if ((root_value = json_parse_string(bufferStr)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_021: [ If any of the parson API fails, IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_JSON_ERROR ] */
+        LogError("json_parse_string failed");
+        result = IOTHUB_REGISTRYMANAGER_JSON_ERROR;
+    }
+    else if ((device_array = json_value_get_array(root_value)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_021: [ If any of the parson API fails, IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_JSON_ERROR ] */
+        LogError("json_value_get_array failed");
+        result = IOTHUB_REGISTRYMANAGER_JSON_ERROR;
+    }
+    else
+    {
+        size_t array_count = json_array_get_count(device_array);
+        size_t i;
+
+        result = IOTHUB_REGISTRYMANAGER_OK;
+        for (i = 0; (i < array_count) && (result == IOTHUB_REGISTRYMANAGER_OK) && (*isStopped == 0); i++)
+        {
+            JSON_Object* device_object;
+
+            if ((device_object = json_array_get_object(device_array, i)) == NULL)
+            {
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_021: [ If any of the parson API fails, IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_JSON_ERROR ] */
+                LogError("json_array_get_object failed");
+                result = IOTHUB_REGISTRYMANAGER_JSON_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_022: [ IoTHubRegistryManager_EnumerateDevices shall reuse one IOTHUB_DEVICE structure for all the devices, pointing its string fields into the parsed page, and pass it to deviceCallback, so the structure and its strings are only valid during the callback ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_023: [ IoTHubRegistryManager_EnumerateDevices shall populate deviceId, eTag (from "deviceEtag"), connectionState, connectionStateUpdatedTime, status, statusReason, statusUpdatedTime, lastActivityTime and cloudToDeviceMessageCount from the device twin returned by the query, set authMethod from "authenticationType" and primaryKey and secondaryKey from "x509Thumbprint", and leave the other fields NULL, false or 0 ] */
+                IOTHUB_DEVICE device;
+                const char* connectionState = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_CONNECTIONSTATE);
+                const char* status = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_STATUS);
+                const char* authenticationType = json_object_get_string(device_object, DEVICE_JSON_KEY_QUERY_AUTHENTICATION_TYPE);
+
+                (void)memset(&device, 0, sizeof(IOTHUB_DEVICE));
+                device.deviceId = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_NAME);
+                device.eTag = json_object_get_string(device_object, DEVICE_JSON_KEY_QUERY_DEVICE_ETAG);
+                device.connectionStateUpdatedTime = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_CONNECTIONSTATEUPDATEDTIME);
+                device.statusReason = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_STATUSREASON);
+                device.statusUpdatedTime = json_object_get_string(device_object, DEVICE_JSON_KEY_QUERY_STATUSUPDATEDTIME);
+                device.lastActivityTime = json_object_get_string(device_object, DEVICE_JSON_KEY_DEVICE_LASTACTIVITYTIME);
+                device.cloudToDeviceMessageCount = (size_t)json_object_get_number(device_object, DEVICE_JSON_KEY_DEVICE_CLOUDTODEVICEMESSAGECOUNT);
+                device.connectionState = ((connectionState != NULL) && (strcmp(connectionState, DEVICE_JSON_DEFAULT_VALUE_CONNECTED) == 0)) ? IOTHUB_DEVICE_CONNECTION_STATE_CONNECTED : IOTHUB_DEVICE_CONNECTION_STATE_DISCONNECTED;
+                device.status = ((status != NULL) && (strcmp(status, DEVICE_JSON_QUERY_VALUE_ENABLED) == 0)) ? IOTHUB_DEVICE_STATUS_ENABLED : IOTHUB_DEVICE_STATUS_DISABLED;
+                if ((authenticationType == NULL) || (strcmp(authenticationType, DEVICE_JSON_QUERY_VALUE_AUTHENTICATION_SAS) == 0))
+                {
+                    device.authMethod = IOTHUB_REGISTRYMANAGER_AUTH_SPK;
+                }
+                else
+                {
+                    device.authMethod = IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT;
+                    device.primaryKey = json_object_dotget_string(device_object, DEVICE_JSON_KEY_QUERY_PRIMARY_THUMBPRINT);
+                    device.secondaryKey = json_object_dotget_string(device_object, DEVICE_JSON_KEY_QUERY_SECONDARY_THUMBPRINT);
+                }
+
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_024: [ If deviceCallback returns a non-zero value IoTHubRegistryManager_EnumerateDevices shall stop the enumeration and return IOTHUB_REGISTRYMANAGER_OK ] */
+                if (deviceCallback(context, &device) != 0)
+                {
+                    *isStopped = 1;
+                }
+            }
+        }
+    }
+
+    if (root_value != NULL)
+        json_value_free(root_value);
+
+    return result;
+}
+
 static IOTHUB_REGISTRYMANAGER_RESULT createRelativePath(IOTHUB_REQUEST_MODE iotHubRequestMode, const char* deviceName, size_t numberOfDevices, char* relativePath)
 {
     IOTHUB_REGISTRYMANAGER_RESULT result;
@@ -1009,6 +1312,28 @@ static IOTHUB_REGISTRYMANAGER_RESULT createRelativePath(IOTHUB_REQUEST_MODE iotH
             result = IOTHUB_REGISTRYMANAGER_ERROR;
         }
     }
+    else if (iotHubRequestMode == IOTHUB_REQUEST_BULK)
+    {
+        if (snprintf(relativePath, 256, RELATIVE_PATH_FMT_BULK, URL_API_VERSION) > 0)
+        {
+            result = IOTHUB_REGISTRYMANAGER_OK;
+        }
+        else
+        {
+            result = IOTHUB_REGISTRYMANAGER_ERROR;
+        }
+    }
+    else if (iotHubRequestMode == IOTHUB_REQUEST_QUERY_DEVICES)
+    {
+        if (snprintf(relativePath, 256, RELATIVE_PATH_FMT_QUERY, URL_API_VERSION) > 0)
+        {
+            result = IOTHUB_REGISTRYMANAGER_OK;
+        }
+        else
+        {
+            result = IOTHUB_REGISTRYMANAGER_ERROR;
+        }
+    }
     else
     {
         if (snprintf(relativePath, 256, RELATIVE_PATH_FMT_CRUD, deviceName, URL_API_VERSION) > 0)
@@ -1083,68 +1408,20 @@ static IOTHUB_REGISTRYMANAGER_RESULT sendHttpRequestCRUD(IOTHUB_REGISTRYMANAGER_
 {
     IOTHUB_REGISTRYMANAGER_RESULT result;
 
-    STRING_HANDLE uriResouce = NULL;
-    STRING_HANDLE accessKey = NULL;
-    STRING_HANDLE keyName = NULL;
-    HTTPAPIEX_SAS_HANDLE httpExApiSasHandle = NULL;
-    HTTPAPIEX_HANDLE httpExApiHandle = NULL;
     HTTP_HEADERS_HANDLE httpHeader = NULL;
 
-    if ((uriResouce = STRING_construct(registryManagerHandle->hostname)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_099: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_103: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        LogError("STRING_construct failed for uriResource");
-        result = IOTHUB_REGISTRYMANAGER_ERROR;
-    }
-    else if ((accessKey = STRING_construct(registryManagerHandle->sharedAccessKey)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_099: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_103: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        LogError("STRING_construct failed for accessKey");
-        result = IOTHUB_REGISTRYMANAGER_ERROR;
-    }
-    else if ((keyName = STRING_construct(registryManagerHandle->keyName)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_099: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_103: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
-        LogError("STRING_construct failed for keyName");
-        result = IOTHUB_REGISTRYMANAGER_ERROR;
-    }
     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_015: [ IoTHubRegistryManager_CreateDevice shall create an HTTP PUT request using the following HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_027: [ IoTHubRegistryManager_GetDevice shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_043: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the created JSON ] */
     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_044: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the createdfollowing HTTP headers : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_054: [ IoTHubRegistryManager_DeleteDevice shall add the following headers to the created HTTP GET request : authorization=sasToken, Request-Id=1001, Accept=application/json, Content-Type=application/json, charset=utf-8 ] */
-    else if ((httpHeader = createHttpHeader(iotHubRequestMode)) == NULL)
+    if ((httpHeader = createHttpHeader(iotHubRequestMode)) == NULL)
     {
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_019: [ If any of the HTTPAPI call fails IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_104: [ If any of the HTTPAPI call fails IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
         LogError("HttpHeader creation failed");
         result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
     }
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_016: [ IoTHubRegistryManager_CreateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_028: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    else if ((httpExApiSasHandle = HTTPAPIEX_SAS_Create(accessKey, uriResouce, keyName)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_019: [ If any of the HTTPAPI call fails IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_104: [ If any of the HTTPAPI call fails IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
-        LogError("HTTPAPIEX_SAS_Create failed");
-        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
-    }
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_017: [ IoTHubRegistryManager_CreateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_029: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    else if ((httpExApiHandle = HTTPAPIEX_Create(registryManagerHandle->hostname)) == NULL)
-    {
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_019: [ If any of the HTTPAPI call fails IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_104: [ If any of the HTTPAPI call fails IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
-        LogError("HTTPAPIEX_Create failed");
-        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
-    }
     else 
     {
         HTTPAPI_REQUEST_TYPE httpApiRequestType = HTTPAPI_REQUEST_GET;
@@ -1164,6 +1441,11 @@ static IOTHUB_REGISTRYMANAGER_RESULT sendHttpRequestCRUD(IOTHUB_REGISTRYMANAGER_
         {
             httpApiRequestType = HTTPAPI_REQUEST_GET;
         }
+        else if (iotHubRequestMode == IOTHUB_REQUEST_BULK)
+        {
+            /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_008: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall send every chunk in an HTTP POST request to url/devices?api-version by calling IoTHubServiceClientHttpSession_ExecuteRequest, one chunk after the other on the keep-alive sessions of the HTTP session pool of the service client ] */
+            httpApiRequestType = HTTPAPI_REQUEST_POST;
+        }
         else
         {
             is_error = 1;
@@ -1184,14 +1466,14 @@ static IOTHUB_REGISTRYMANAGER_RESULT sendHttpRequestCRUD(IOTHUB_REGISTRYMANAGER_
                 result = IOTHUB_REGISTRYMANAGER_ERROR;
             }
             /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_014: [ IoTHubRegistryManager_CreateDevice shall create an HTTP PUT request using the created JSON ] */
-            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_018: [ IoTHubRegistryManager_CreateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
-            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ] */
-            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
-            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling HTTPAPIEX_ExecuteRequest ] */
-            else if (HTTPAPIEX_SAS_ExecuteRequest(httpExApiSasHandle, httpExApiHandle, httpApiRequestType, relativePath, httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
+            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_018: [ IoTHubRegistryManager_CreateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
+            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
+            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
+            /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
+            else if (IoTHubServiceClientHttpSession_ExecuteRequest(registryManagerHandle->httpSessionPool, httpApiRequestType, relativePath, httpHeader, deviceJsonBuffer, &statusCode, NULL, responseBuffer) != HTTPAPIEX_OK)
             {
                 /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_019: [ If any of the HTTPAPI call fails IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
-                LogError("HTTPAPIEX_SAS_ExecuteRequest failed");
+                LogError("IoTHubServiceClientHttpSession_ExecuteRequest failed");
                 result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
             }
             else
@@ -1225,11 +1507,130 @@ static IOTHUB_REGISTRYMANAGER_RESULT sendHttpRequestCRUD(IOTHUB_REGISTRYMANAGER_
     }
 
     HTTPHeaders_Free(httpHeader);
-    HTTPAPIEX_Destroy(httpExApiHandle);
-    HTTPAPIEX_SAS_Destroy(httpExApiSasHandle);
-    STRING_delete(keyName);
-    STRING_delete(accessKey);
-    STRING_delete(uriResouce);
+    return result;
+}
+
+static IOTHUB_REGISTRYMANAGER_RESULT sendDeviceQueryRequest(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const char* pageSize, const char* continuationToken, BUFFER_HANDLE queryBuffer, HTTP_HEADERS_HANDLE responseHeaders, BUFFER_HANDLE responseBuffer)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    HTTP_HEADERS_HANDLE httpHeader = NULL;
+    char relativePath[256];
+    unsigned int statusCode;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_017: [ IoTHubRegistryManager_EnumerateDevices shall request the devices one page at a time with an HTTP POST request of the query "SELECT * FROM devices" to url/devices/query?api-version, with the headers of IoTHubRegistryManager_GetDeviceList plus "x-ms-max-item-count" set to pageSize and, from the second page on, "x-ms-continuation" set to the continuation token of the previous page ] */
+    if ((httpHeader = createHttpHeader(IOTHUB_REQUEST_QUERY_DEVICES)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_018: [ If any of the HTTPAPI call fails IoTHubRegistryManager_EnumerateDevices shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
+        LogError("HttpHeader creation failed");
+        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
+    }
+    else if (HTTPHeaders_AddHeaderNameValuePair(httpHeader, HTTP_HEADER_KEY_MAX_ITEM_COUNT, pageSize) != HTTP_HEADERS_OK)
+    {
+        LogError("HTTPHeaders_AddHeaderNameValuePair failed for x-ms-max-item-count header");
+        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
+    }
+    else if ((continuationToken != NULL) && (HTTPHeaders_AddHeaderNameValuePair(httpHeader, HTTP_HEADER_KEY_CONTINUATION, continuationToken) != HTTP_HEADERS_OK))
+    {
+        LogError("HTTPHeaders_AddHeaderNameValuePair failed for x-ms-continuation header");
+        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
+    }
+    else if (createRelativePath(IOTHUB_REQUEST_QUERY_DEVICES, NULL, 0, relativePath) != IOTHUB_REGISTRYMANAGER_OK)
+    {
+        LogError("Failure creating relative path");
+        result = IOTHUB_REGISTRYMANAGER_ERROR;
+    }
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_017: [ IoTHubRegistryManager_EnumerateDevices shall request the devices one page at a time with an HTTP POST request of the query "SELECT * FROM devices" to url/devices/query?api-version, with the headers of IoTHubRegistryManager_GetDeviceList plus "x-ms-max-item-count" set to pageSize and, from the second page on, "x-ms-continuation" set to the continuation token of the previous page ] */
+    else if (IoTHubServiceClientHttpSession_ExecuteRequest(registryManagerHandle->httpSessionPool, HTTPAPI_REQUEST_POST, relativePath, httpHeader, queryBuffer, &statusCode, responseHeaders, responseBuffer) != HTTPAPIEX_OK)
+    {
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_018: [ If any of the HTTPAPI call fails IoTHubRegistryManager_EnumerateDevices shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
+        LogError("IoTHubServiceClientHttpSession_ExecuteRequest failed");
+        result = IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR;
+    }
+    else if (statusCode > 300)
+    {
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_019: [ IoTHubRegistryManager_EnumerateDevices shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ] */
+        LogError("Http Failure status code %d.", statusCode);
+        result = IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR;
+    }
+    else
+    {
+        result = IOTHUB_REGISTRYMANAGER_OK;
+    }
+
+    if (httpHeader != NULL)
+    {
+        HTTPHeaders_Free(httpHeader);
+    }
+    return result;
+}
+
+static IOTHUB_REGISTRYMANAGER_RESULT sendBulkRequest(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, const char* importMode, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result = IOTHUB_REGISTRYMANAGER_OK;
+    size_t chunkStart;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_006: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall split the devices array into chunks of at most 100 devices ] */
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_011: [ If a chunk fails IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall continue with the next chunk ] */
+    for (chunkStart = 0; chunkStart < deviceCount; chunkStart += IOTHUB_DEVICES_MAX_BULK_REQUEST)
+    {
+        const IOTHUB_REGISTRY_DEVICE_CREATE* chunkDevices = &devices[chunkStart];
+        IOTHUB_REGISTRYMANAGER_RESULT* chunkResults = &deviceResults[chunkStart];
+        size_t chunkCount = deviceCount - chunkStart;
+        IOTHUB_REGISTRYMANAGER_RESULT chunkResult;
+        BUFFER_HANDLE bulkJsonBuffer = NULL;
+        BUFFER_HANDLE responseBuffer = NULL;
+        size_t i;
+
+        if (chunkCount > IOTHUB_DEVICES_MAX_BULK_REQUEST)
+        {
+            chunkCount = IOTHUB_DEVICES_MAX_BULK_REQUEST;
+        }
+
+        if ((bulkJsonBuffer = constructBulkDeviceJson(chunkDevices, chunkCount, importMode)) == NULL)
+        {
+            LogError("Json creation failed");
+            chunkResult = IOTHUB_REGISTRYMANAGER_JSON_ERROR;
+        }
+        else if ((responseBuffer = BUFFER_new()) == NULL)
+        {
+            LogError("BUFFER_new failed for responseBuffer");
+            chunkResult = IOTHUB_REGISTRYMANAGER_ERROR;
+        }
+        else
+        {
+            chunkResult = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_BULK, NULL, bulkJsonBuffer, 0, responseBuffer);
+        }
+
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_009: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of a chunk to the result of its request: IOTHUB_REGISTRYMANAGER_JSON_ERROR if the JSON creation fails, IOTHUB_REGISTRYMANAGER_ERROR if BUFFER_new fails, IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR if the HTTP request fails, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR if the HTTP status code is greater than 300 and IOTHUB_REGISTRYMANAGER_OK otherwise ] */
+        for (i = 0; i < chunkCount; i++)
+        {
+            chunkResults[i] = chunkResult;
+        }
+
+        if (((chunkResult == IOTHUB_REGISTRYMANAGER_OK) || (chunkResult == IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR)) &&
+            (BUFFER_length(responseBuffer) > 0))
+        {
+            parseBulkResultJson(responseBuffer, chunkDevices, chunkCount, chunkResults);
+        }
+
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_012: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_OK if every device succeeded, otherwise the result of the first device that failed ] */
+        for (i = 0; (i < chunkCount) && (result == IOTHUB_REGISTRYMANAGER_OK); i++)
+        {
+            result = chunkResults[i];
+        }
+
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_013: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall do clean up before return ] */
+        if (responseBuffer != NULL)
+        {
+            BUFFER_delete(responseBuffer);
+        }
+        if (bulkJsonBuffer != NULL)
+        {
+            BUFFER_delete(bulkJsonBuffer);
+        }
+    }
+
     return result;
 }
 
@@ -1335,6 +1736,19 @@ IOTHUB_REGISTRYMANAGER_HANDLE IoTHubRegistryManager_Create(IOTHUB_SERVICE_CLIENT
                     free(result);
                     result = NULL;
                 }
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_001: [ IoTHubRegistryManager_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool, so all its requests reuse the sessions and SAS token of the pool. ] */
+                else if ((result->httpSessionPool = IoTHubServiceClientHttpSession_ClonePool(serviceClientAuth->httpSessionPool)) == NULL)
+                {
+                    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubRegistryManager_Create shall do clean up and return NULL. ] */
+                    LogError("IoTHubServiceClientHttpSession_ClonePool failed");
+                    free(result->hostname);
+                    free(result->iothubName);
+                    free(result->iothubSuffix);
+                    free(result->sharedAccessKey);
+                    free(result->keyName);
+                    free(result);
+                    result = NULL;
+                }
             }
         }
     }
@@ -1349,6 +1763,8 @@ void IoTHubRegistryManager_Destroy(IOTHUB_REGISTRYMANAGER_HANDLE registryManager
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_006 : [ If the registryManagerHandle input parameter is not NULL IoTHubRegistryManager_Destroy shall free the memory of it and return ] */
         IOTHUB_REGISTRYMANAGER* regManHandle = (IOTHUB_REGISTRYMANAGER*)registryManagerHandle;
 
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_003: [ IoTHubRegistryManager_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ] */
+        IoTHubServiceClientHttpSession_DestroyPool(regManHandle->httpSessionPool);
         free(regManHandle->hostname);
         free(regManHandle->iothubName);
         free(regManHandle->iothubSuffix);
@@ -1425,9 +1841,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_CreateDevice(IOTHUB_REGISTRY
                 }
                 /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_014: [ IoTHubRegistryManager_CreateDevice shall create an HTTP PUT request using the created JSON ] */
                 /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_015: [ IoTHubRegistryManager_CreateDevice shall create an HTTP PUT request using the following HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_016: [ IoTHubRegistryManager_CreateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_017: [ IoTHubRegistryManager_CreateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_018: [ IoTHubRegistryManager_CreateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_016: [ IoTHubRegistryManager_CreateDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_017: [ IoTHubRegistryManager_CreateDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_018: [ IoTHubRegistryManager_CreateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
                 else if ((result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_CREATE, deviceCreateInfo->deviceId, deviceJsonBuffer, 0, responseBuffer)) == IOTHUB_REGISTRYMANAGER_ERROR)
                 {
                     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_019: [ If any of the HTTPAPI call fails IoTHubRegistryManager_CreateDevice shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ] */
@@ -1483,9 +1899,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetDevice(IOTHUB_REGISTRYMAN
         }
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_026: [ IoTHubRegistryManager_GetDevice shall create HTTP GET request URL using the given deviceId using the following format: url/devices/[deviceId]?api-version=2016-11-14  ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_027: [ IoTHubRegistryManager_GetDevice shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_028: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_029: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_028: [ IoTHubRegistryManager_GetDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_029: [ IoTHubRegistryManager_GetDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
         else if ((result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_GET, deviceId, NULL, 0, responseBuffer)) == IOTHUB_REGISTRYMANAGER_ERROR)
         {
             /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_031: [ If any of the HTTPAPI call fails IoTHubRegistryManager_GetDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
@@ -1580,9 +1996,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_UpdateDevice(IOTHUB_REGISTRY
                 }
                 /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_043: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the created JSON ] */
                 /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_044: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the createdfollowing HTTP headers : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
                 else if ((result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_UPDATE, deviceUpdate->deviceId, deviceJsonBuffer, 0, responseBuffer)) == IOTHUB_REGISTRYMANAGER_ERROR)
                 {
                     /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_103: [ If any of the call fails during the HTTP creation IoTHubRegistryManager_UpdateDevice shall fail and return IOTHUB_REGISTRYMANAGER_ERROR ] */
@@ -1620,9 +2036,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_DeleteDevice(IOTHUB_REGISTRY
     {
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_053: [ IoTHubRegistryManager_DeleteDevice shall create HTTP DELETE request URL using the given deviceId using the following format : url / devices / [deviceId] ? api - version  ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_054: [ IoTHubRegistryManager_DeleteDevice shall add the following headers to the created HTTP GET request : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling HTTPAPIEX_ExecuteRequest ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_058: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_059: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is less or equal than 300 then return IOTHUB_REGISTRYMANAGER_OK ] */
         result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_DELETE, deviceId, NULL, 0, NULL);
@@ -1659,9 +2075,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetDeviceList(IOTHUB_REGISTR
         }
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_062: [ IoTHubRegistryManager_GetDeviceList shall create HTTP GET request for numberOfDevices using the follwoing format: url/devices/?top=[numberOfDevices]&api-version ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_063: [ IoTHubRegistryManager_GetDeviceList shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_064: [ IoTHubRegistryManager_GetDeviceList shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_065: [ IoTHubRegistryManager_GetDeviceList shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_066: [ IoTHubRegistryManager_GetDeviceList shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_064: [ IoTHubRegistryManager_GetDeviceList shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_065: [ IoTHubRegistryManager_GetDeviceList shall execute the request on a session of the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_066: [ IoTHubRegistryManager_GetDeviceList shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_067: [ IoTHubRegistryManager_GetDeviceList shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_ERROR ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_068: [ IoTHubRegistryManager_GetDeviceList shall verify the received HTTP status code and if it is less or equal than 300 then try to parse the response JSON to deviceList ] */
         else if ((result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_GET_DEVICE_LIST, NULL, NULL, numberOfDevices, responseBuffer)) == IOTHUB_REGISTRYMANAGER_ERROR)
@@ -1711,9 +2127,9 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetStatistics(IOTHUB_REGISTR
         }
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_075: [ IoTHubRegistryManager_GetStatistics shall create HTTP GET request for statistics using the following format: url/statistics/devices?api-version ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_076: [ IoTHubRegistryManager_GetStatistics shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_077: [ IoTHubRegistryManager_GetStatistics shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_078: [ IoTHubRegistryManager_GetStatistics shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_079: [ IoTHubRegistryManager_GetStatistics shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_077: [ IoTHubRegistryManager_GetStatistics shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_078: [ IoTHubRegistryManager_GetStatistics shall execute the request on a session of the HTTP session pool of the service client ] */
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_079: [ IoTHubRegistryManager_GetStatistics shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_080: [ IoTHubRegistryManager_GetStatistics shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_ERROR ] */
         /*Codes_SRS_IOTHUBREGISTRYMANAGER_12_081: [ IoTHubRegistryManager_GetStatistics shall verify the received HTTP status code and if it is less or equal than 300 then use the following parson APIs to parse the response JSON to registry statistics structure: json_parse_string, json_value_get_object, json_object_get_string, json_object_dotget_string ] */
         else if ((result = sendHttpRequestCRUD(registryManagerHandle, IOTHUB_REQUEST_GET_STATISTICS, NULL, NULL, 0, responseBuffer)) == IOTHUB_REGISTRYMANAGER_ERROR)
@@ -1736,3 +2152,177 @@ IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_GetStatistics(IOTHUB_REGISTR
     }
     return result;
 }
+
+static IOTHUB_REGISTRYMANAGER_RESULT verifyBulkInput(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults, bool verifyAuthMethod)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_004: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall verify the input parameters and if any of them are NULL or deviceCount is 0 then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ] */
+    if ((registryManagerHandle == NULL) || (devices == NULL) || (deviceResults == NULL))
+    {
+        LogError("Input parameter cannot be NULL");
+        result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+    }
+    else if (deviceCount == 0)
+    {
+        LogError("deviceCount cannot be 0");
+        result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+    }
+    else
+    {
+        size_t i;
+
+        /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_005: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_INVALID_ARG without sending any request if the deviceId of any device is NULL or contains space(s), or, for IoTHubRegistryManager_BulkCreateOrUpdate, if its authMethod is not "IOTHUB_REGISTRYMANAGER_AUTH_SPK" or "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ] */
+        result = IOTHUB_REGISTRYMANAGER_OK;
+        for (i = 0; (i < deviceCount) && (result == IOTHUB_REGISTRYMANAGER_OK); i++)
+        {
+            if (devices[i].deviceId == NULL)
+            {
+                LogError("deviceId of device %zu cannot be NULL", i);
+                result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+            }
+            else if ((strHasNoWhitespace(devices[i].deviceId)) != 0)
+            {
+                LogError("deviceId of device %zu cannot contain spaces", i);
+                result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+            }
+            else if (verifyAuthMethod &&
+                     !((devices[i].authMethod == IOTHUB_REGISTRYMANAGER_AUTH_SPK) ||
+                       (devices[i].authMethod == IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT)))
+            {
+                LogError("Invalid authorization type specified for device %zu", i);
+                result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_BulkCreateOrUpdate(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    if ((result = verifyBulkInput(registryManagerHandle, devices, deviceCount, deviceResults, true)) == IOTHUB_REGISTRYMANAGER_OK)
+    {
+        result = sendBulkRequest(registryManagerHandle, devices, deviceCount, DEVICE_JSON_DEFAULT_VALUE_IMPORT_MODE_CREATE_OR_UPDATE, deviceResults);
+    }
+    return result;
+}
+
+IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_BulkDelete(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, IOTHUB_REGISTRYMANAGER_RESULT* deviceResults)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    if ((result = verifyBulkInput(registryManagerHandle, devices, deviceCount, deviceResults, false)) == IOTHUB_REGISTRYMANAGER_OK)
+    {
+        result = sendBulkRequest(registryManagerHandle, devices, deviceCount, DEVICE_JSON_DEFAULT_VALUE_IMPORT_MODE_DELETE, deviceResults);
+    }
+    return result;
+}
+
+IOTHUB_REGISTRYMANAGER_RESULT IoTHubRegistryManager_EnumerateDevices(IOTHUB_REGISTRYMANAGER_HANDLE registryManagerHandle, size_t pageSize, IOTHUB_DEVICE_ENUMERATION_CALLBACK deviceCallback, void* context)
+{
+    IOTHUB_REGISTRYMANAGER_RESULT result;
+
+    char pageSizeStr[32];
+
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_015: [ IoTHubRegistryManager_EnumerateDevices shall verify the registryManagerHandle input parameter and if it is NULL, or if pageSize is not between 1 and 1000, then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ] */
+    if (registryManagerHandle == NULL)
+    {
+        LogError("Input parameter cannot be NULL");
+        result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+    }
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_015: [ IoTHubRegistryManager_EnumerateDevices shall verify the registryManagerHandle input parameter and if it is NULL, or if pageSize is not between 1 and 1000, then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ] */
+    else if ((pageSize == 0) || (pageSize > IOTHUB_DEVICES_MAX_REQUEST))
+    {
+        LogError("pageSize has to be between 1 and 1000");
+        result = IOTHUB_REGISTRYMANAGER_INVALID_ARG;
+    }
+    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_016: [ If deviceCallback is NULL IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_CALLBACK_NOT_SET ] */
+    else if (deviceCallback == NULL)
+    {
+        LogError("deviceCallback cannot be NULL");
+        result = IOTHUB_REGISTRYMANAGER_CALLBACK_NOT_SET;
+    }
+    else if (snprintf(pageSizeStr, sizeof(pageSizeStr), "%zu", pageSize) <= 0)
+    {
+        LogError("Failure formatting pageSize");
+        result = IOTHUB_REGISTRYMANAGER_ERROR;
+    }
+    else
+    {
+        BUFFER_HANDLE queryBuffer;
+
+        if ((queryBuffer = BUFFER_create((const unsigned char*)DEVICE_QUERY_ALL_DEVICES, strlen(DEVICE_QUERY_ALL_DEVICES))) == NULL)
+        {
+            LogError("BUFFER_create failed for queryBuffer");
+            result = IOTHUB_REGISTRYMANAGER_ERROR;
+        }
+        else
+        {
+            char* continuationToken = NULL;
+            int isStopped = 0;
+
+            do
+            {
+                HTTP_HEADERS_HANDLE responseHeaders = NULL;
+                BUFFER_HANDLE responseBuffer = NULL;
+
+                if ((responseHeaders = HTTPHeaders_Alloc()) == NULL)
+                {
+                    LogError("HTTPHeaders_Alloc failed for responseHeaders");
+                    result = IOTHUB_REGISTRYMANAGER_ERROR;
+                }
+                else if ((responseBuffer = BUFFER_new()) == NULL)
+                {
+                    LogError("BUFFER_new failed for responseBuffer");
+                    result = IOTHUB_REGISTRYMANAGER_ERROR;
+                }
+                else if ((result = sendDeviceQueryRequest(registryManagerHandle, pageSizeStr, continuationToken, queryBuffer, responseHeaders, responseBuffer)) != IOTHUB_REGISTRYMANAGER_OK)
+                {
+                    LogError("Failure sending HTTP request for device query");
+                }
+                else if ((result = parseDeviceQueryPageJson(responseBuffer, deviceCallback, context, &isStopped)) != IOTHUB_REGISTRYMANAGER_OK)
+                {
+                    LogError("Failure parsing device query page");
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_025: [ IoTHubRegistryManager_EnumerateDevices shall request the next page as long as the response has a non-empty "x-ms-continuation" header, and return IOTHUB_REGISTRYMANAGER_OK after the last page ] */
+                    const char* nextContinuationToken = HTTPHeaders_FindHeaderValue(responseHeaders, HTTP_HEADER_KEY_CONTINUATION);
+
+                    if (continuationToken != NULL)
+                    {
+                        free(continuationToken);
+                        continuationToken = NULL;
+                    }
+
+                    if ((isStopped == 0) && (nextContinuationToken != NULL) && (nextContinuationToken[0] != '\0') &&
+                        (mallocAndStrcpy_s(&continuationToken, nextContinuationToken) != 0))
+                    {
+                        LogError("mallocAndStrcpy_s failed for continuationToken");
+                        continuationToken = NULL;
+                        result = IOTHUB_REGISTRYMANAGER_ERROR;
+                    }
+                }
+
+                /*Codes_SRS_IOTHUBREGISTRYMANAGER_41_026: [ IoTHubRegistryManager_EnumerateDevices shall do clean up before return ] */
+                if (responseBuffer != NULL)
+                {
+                    BUFFER_delete(responseBuffer);
+                }
+                if (responseHeaders != NULL)
+                {
+                    HTTPHeaders_Free(responseHeaders);
+                }
+            } while ((result == IOTHUB_REGISTRYMANAGER_OK) && (continuationToken != NULL));
+
+            if (continuationToken != NULL)
+            {
+                free(continuationToken);
+            }
+            BUFFER_delete(queryBuffer);
+        }
+    }
+    return result;
+}
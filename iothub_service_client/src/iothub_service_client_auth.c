@@ -211,6 +211,19 @@ IOTHUB_SERVICE_CLIENT_AUTH_HANDLE IoTHubServiceClientAuth_CreateFromConnectionSt
                         free(result);
                         result = NULL;
                     }
+                    /*Codes_SRS_IOTHUBSERVICECLIENT_41_001: [** IoTHubServiceClientAuth_CreateFromConnectionString shall create the pool of HTTP sessions shared by the Service client modules by calling IoTHubServiceClientHttpSession_CreatePool with hostName, sharedAccessKey and keyName. **] */
+                    else if ((result->httpSessionPool = IoTHubServiceClientHttpSession_CreatePool(result->hostname, result->sharedAccessKey, result->keyName)) == NULL)
+                    {
+                        /*Codes_SRS_IOTHUBSERVICECLIENT_41_002: [** If the IoTHubServiceClientHttpSession_CreatePool fails, IoTHubServiceClientAuth_CreateFromConnectionString shall do clean up and return NULL. **] */
+                        LogError("IoTHubServiceClientHttpSession_CreatePool failed");
+                        free(result->hostname);
+                        free(result->keyName);
+                        free(result->sharedAccessKey);
+                        free(result->iothubName);
+                        free(result->iothubSuffix);
+                        free(result);
+                        result = NULL;
+                    }
                     /*Codes_SRS_IOTHUBSERVICECLIENT_12_006: [** If the IOTHUB_SERVICE_CLIENT_AUTH has been populated IoTHubServiceClientAuth_CreateFromConnectionString shall do clean up and return with a IOTHUB_SERVICE_CLIENT_AUTH_HANDLE to it **] */
                     STRING_delete(token_key_string);
                     STRING_delete(token_value_string);
@@ -233,6 +246,8 @@ void IoTHubServiceClientAuth_Destroy(IOTHUB_SERVICE_CLIENT_AUTH_HANDLE serviceCl
         /*Codes_SRS_IOTHUBSERVICECLIENT_12_008: [** If the serviceClientHandle input parameter is not NULL IoTHubServiceClient_Destroy shall free the memory of it and return **]*/
         IOTHUB_SERVICE_CLIENT_AUTH* authInfo = (IOTHUB_SERVICE_CLIENT_AUTH*)serviceClientHandle;
 
+        /*Codes_SRS_IOTHUBSERVICECLIENT_41_003: [** IoTHubServiceClient_Destroy shall release its reference to the pool of HTTP sessions by calling IoTHubServiceClientHttpSession_DestroyPool. **]*/
+        IoTHubServiceClientHttpSession_DestroyPool(authInfo->httpSessionPool);
         free(authInfo->hostname);
         free(authInfo->iothubName);
         free(authInfo->iothubSuffix);
@@ -0,0 +1,288 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/agenttime.h"
+#include "azure_c_shared_utility/sastoken.h"
+#include "azure_c_shared_utility/httpapiex.h"
+#include "azure_c_shared_utility/httpheaders.h"
+
+#include "iothub_service_client_http_session.h"
+
+#define  HTTP_HEADER_KEY_AUTHORIZATION  "Authorization"
+
+#define HTTP_SESSION_POOL_MAX_IDLE_SESSIONS 8
+#define HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS 3600
+#define HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS 300
+
+#define HTTP_STATUS_CODE_UNAUTHORIZED 401
+
+typedef struct IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_TAG
+{
+    char* hostname;
+    STRING_HANDLE uriResource;
+    STRING_HANDLE sharedAccessKey;
+    STRING_HANDLE keyName;
+    LOCK_HANDLE lock;
+    size_t refCount;
+    STRING_HANDLE sasToken;
+    size_t sasTokenExpiry;
+    HTTPAPIEX_HANDLE idleSessions[HTTP_SESSION_POOL_MAX_IDLE_SESSIONS];
+    size_t idleSessionCount;
+} IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL;
+
+static void free_pool(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL* sessionPool)
+{
+    size_t index;
+
+    for (index = 0; index < sessionPool->idleSessionCount; index++)
+    {
+        HTTPAPIEX_Destroy(sessionPool->idleSessions[index]);
+    }
+    if (sessionPool->lock != NULL)
+    {
+        (void)Lock_Deinit(sessionPool->lock);
+    }
+    STRING_delete(sessionPool->sasToken);
+    STRING_delete(sessionPool->keyName);
+    STRING_delete(sessionPool->sharedAccessKey);
+    STRING_delete(sessionPool->uriResource);
+    free(sessionPool->hostname);
+    free(sessionPool);
+}
+
+/*must be called under the lock of the pool*/
+static int refresh_sas_token(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL* sessionPool)
+{
+    int result;
+    time_t currentTime;
+
+    if ((currentTime = get_time(NULL)) == INDEFINITE_TIME)
+    {
+        LogError("get_time failed");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t secondsSinceEpoch = (size_t)get_difftime(currentTime, (time_t)0);
+
+        if ((sessionPool->sasToken != NULL) && (secondsSinceEpoch + HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS < sessionPool->sasTokenExpiry))
+        {
+            result = 0;
+        }
+        else
+        {
+            size_t expiry = secondsSinceEpoch + HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS;
+            STRING_HANDLE sasToken;
+
+            if ((sasToken = SASToken_Create(sessionPool->sharedAccessKey, sessionPool->uriResource, sessionPool->keyName, expiry)) == NULL)
+            {
+                LogError("SASToken_Create failed");
+                result = __LINE__;
+            }
+            else
+            {
+                STRING_delete(sessionPool->sasToken);
+                sessionPool->sasToken = sasToken;
+                sessionPool->sasTokenExpiry = expiry;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE IoTHubServiceClientHttpSession_CreatePool(const char* hostname, const char* sharedAccessKey, const char* keyName)
+{
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL* result;
+
+    if ((hostname == NULL) || (sharedAccessKey == NULL) || (keyName == NULL))
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_001: [ If any of the input parameters is NULL IoTHubServiceClientHttpSession_CreatePool shall return NULL. ]*/
+        LogError("Input parameter cannot be NULL");
+        result = NULL;
+    }
+    /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_002: [ IoTHubServiceClientHttpSession_CreatePool shall allocate memory for a new pool and copy hostname by calling mallocAndStrcpy_s. ]*/
+    else if ((result = (IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL*)malloc(sizeof(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_005: [ If any of the calls fails IoTHubServiceClientHttpSession_CreatePool shall do clean up and return NULL. ]*/
+        LogError("Malloc failed for IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL");
+    }
+    else
+    {
+        (void)memset(result, 0, sizeof(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL));
+
+        if (mallocAndStrcpy_s(&result->hostname, hostname) != 0)
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_005: [ If any of the calls fails IoTHubServiceClientHttpSession_CreatePool shall do clean up and return NULL. ]*/
+            LogError("mallocAndStrcpy_s failed for hostName");
+            free_pool(result);
+            result = NULL;
+        }
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_003: [ IoTHubServiceClientHttpSession_CreatePool shall create the STRING_HANDLEs of the URI resource (the host name), the shared access key and the key name used to create SAS tokens by calling STRING_construct. ]*/
+        else if (((result->uriResource = STRING_construct(hostname)) == NULL) ||
+            ((result->sharedAccessKey = STRING_construct(sharedAccessKey)) == NULL) ||
+            ((result->keyName = STRING_construct(keyName)) == NULL))
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_005: [ If any of the calls fails IoTHubServiceClientHttpSession_CreatePool shall do clean up and return NULL. ]*/
+            LogError("STRING_construct failed");
+            free_pool(result);
+            result = NULL;
+        }
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_004: [ IoTHubServiceClientHttpSession_CreatePool shall create the lock of the pool by calling Lock_Init. ]*/
+        else if ((result->lock = Lock_Init()) == NULL)
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_005: [ If any of the calls fails IoTHubServiceClientHttpSession_CreatePool shall do clean up and return NULL. ]*/
+            LogError("Lock_Init failed");
+            free_pool(result);
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_006: [ Otherwise IoTHubServiceClientHttpSession_CreatePool shall return the pool holding one reference, no session and no SAS token. ]*/
+            result->refCount = 1;
+        }
+    }
+    return result;
+}
+
+IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE IoTHubServiceClientHttpSession_ClonePool(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPoolHandle)
+{
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result;
+
+    if (sessionPoolHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_007: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_ClonePool shall return NULL. ]*/
+        LogError("sessionPoolHandle cannot be NULL");
+        result = NULL;
+    }
+    else if (Lock(sessionPoolHandle->lock) != LOCK_OK)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_007: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_ClonePool shall return NULL. ]*/
+        LogError("Lock failed");
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_008: [ IoTHubServiceClientHttpSession_ClonePool shall increment the reference count of the pool under its lock and return sessionPoolHandle. ]*/
+        sessionPoolHandle->refCount++;
+        (void)Unlock(sessionPoolHandle->lock);
+        result = sessionPoolHandle;
+    }
+    return result;
+}
+
+void IoTHubServiceClientHttpSession_DestroyPool(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPoolHandle)
+{
+    /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_009: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_DestroyPool shall return. ]*/
+    if (sessionPoolHandle != NULL)
+    {
+        if (Lock(sessionPoolHandle->lock) != LOCK_OK)
+        {
+            LogError("Lock failed");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_010: [ IoTHubServiceClientHttpSession_DestroyPool shall decrement the reference count of the pool under its lock. ]*/
+            size_t refCount = --sessionPoolHandle->refCount;
+            (void)Unlock(sessionPoolHandle->lock);
+
+            if (refCount == 0)
+            {
+                /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_011: [ When the reference count reaches 0 IoTHubServiceClientHttpSession_DestroyPool shall destroy the idle sessions by calling HTTPAPIEX_Destroy, delete the cached SAS token and the STRING_HANDLEs, deinit the lock and free the pool. ]*/
+                free_pool(sessionPoolHandle);
+            }
+        }
+    }
+}
+
+HTTPAPIEX_RESULT IoTHubServiceClientHttpSession_ExecuteRequest(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPoolHandle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath, HTTP_HEADERS_HANDLE requestHttpHeadersHandle, BUFFER_HANDLE requestContent, unsigned int* statusCode, HTTP_HEADERS_HANDLE responseHttpHeadersHandle, BUFFER_HANDLE responseContent)
+{
+    HTTPAPIEX_RESULT result;
+
+    if ((sessionPoolHandle == NULL) || (relativePath == NULL) || (requestHttpHeadersHandle == NULL) || (statusCode == NULL))
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_012: [ If sessionPoolHandle, relativePath, requestHttpHeadersHandle or statusCode is NULL IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_INVALID_ARG. ]*/
+        LogError("Input parameter cannot be NULL");
+        result = HTTPAPIEX_INVALID_ARG;
+    }
+    else if (Lock(sessionPoolHandle->lock) != LOCK_OK)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_013: [ If Lock fails IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_ERROR. ]*/
+        LogError("Lock failed");
+        result = HTTPAPIEX_ERROR;
+    }
+    /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_014: [ If the pool has no SAS token, or the cached one expires in less than HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS seconds, IoTHubServiceClientHttpSession_ExecuteRequest shall create a new one valid for HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS seconds by calling SASToken_Create and cache it in place of the old one. ]*/
+    else if (refresh_sas_token(sessionPoolHandle) != 0)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_016: [ If getting the time, creating the SAS token or setting the header fails IoTHubServiceClientHttpSession_ExecuteRequest shall unlock the pool and return HTTPAPIEX_ERROR. ]*/
+        (void)Unlock(sessionPoolHandle->lock);
+        result = HTTPAPIEX_ERROR;
+    }
+    /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_015: [ IoTHubServiceClientHttpSession_ExecuteRequest shall set the Authorization header of requestHttpHeadersHandle to the cached SAS token by calling HTTPHeaders_ReplaceHeaderNameValuePair. ]*/
+    else if (HTTPHeaders_ReplaceHeaderNameValuePair(requestHttpHeadersHandle, HTTP_HEADER_KEY_AUTHORIZATION, STRING_c_str(sessionPoolHandle->sasToken)) != HTTP_HEADERS_OK)
+    {
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_016: [ If getting the time, creating the SAS token or setting the header fails IoTHubServiceClientHttpSession_ExecuteRequest shall unlock the pool and return HTTPAPIEX_ERROR. ]*/
+        LogError("HTTPHeaders_ReplaceHeaderNameValuePair failed for Authorization header");
+        (void)Unlock(sessionPoolHandle->lock);
+        result = HTTPAPIEX_ERROR;
+    }
+    else
+    {
+        HTTPAPIEX_HANDLE session = NULL;
+        size_t usedTokenExpiry = sessionPoolHandle->sasTokenExpiry;
+
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_017: [ IoTHubServiceClientHttpSession_ExecuteRequest shall take the most recently used idle session of the pool, if any, and unlock the pool before executing the request. ]*/
+        if (sessionPoolHandle->idleSessionCount > 0)
+        {
+            session = sessionPoolHandle->idleSessions[--sessionPoolHandle->idleSessionCount];
+        }
+        (void)Unlock(sessionPoolHandle->lock);
+
+        /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_018: [ If the pool has no idle session IoTHubServiceClientHttpSession_ExecuteRequest shall open a new one by calling HTTPAPIEX_Create with the host name, and return HTTPAPIEX_ERROR if it fails. ]*/
+        if ((session == NULL) && ((session = HTTPAPIEX_Create(sessionPoolHandle->hostname)) == NULL))
+        {
+            LogError("HTTPAPIEX_Create failed");
+            result = HTTPAPIEX_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_019: [ IoTHubServiceClientHttpSession_ExecuteRequest shall execute the request on the session by calling HTTPAPIEX_ExecuteRequest and return its result. ]*/
+            result = HTTPAPIEX_ExecuteRequest(session, requestType, relativePath, requestHttpHeadersHandle, requestContent, statusCode, responseHttpHeadersHandle, responseContent);
+
+            if (Lock(sessionPoolHandle->lock) != LOCK_OK)
+            {
+                LogError("Lock failed, the session is not returned to the pool");
+                HTTPAPIEX_Destroy(session);
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_021: [ If the status code of the response is 401 IoTHubServiceClientHttpSession_ExecuteRequest shall mark the cached SAS token as expired, so the next request creates a new one. ]*/
+                if ((result == HTTPAPIEX_OK) && (*statusCode == HTTP_STATUS_CODE_UNAUTHORIZED) && (sessionPoolHandle->sasTokenExpiry == usedTokenExpiry))
+                {
+                    sessionPoolHandle->sasTokenExpiry = 0;
+                }
+
+                /*Codes_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_020: [ If HTTPAPIEX_ExecuteRequest succeeds and the pool has less than HTTP_SESSION_POOL_MAX_IDLE_SESSIONS idle sessions, IoTHubServiceClientHttpSession_ExecuteRequest shall return the session to the pool; otherwise it shall destroy the session by calling HTTPAPIEX_Destroy. ]*/
+                if ((result == HTTPAPIEX_OK) && (sessionPoolHandle->idleSessionCount < HTTP_SESSION_POOL_MAX_IDLE_SESSIONS))
+                {
+                    sessionPoolHandle->idleSessions[sessionPoolHandle->idleSessionCount++] = session;
+                    session = NULL;
+                }
+                (void)Unlock(sessionPoolHandle->lock);
+
+                if (session != NULL)
+                {
+                    HTTPAPIEX_Destroy(session);
+                }
+            }
+        }
+    }
+    return result;
+}
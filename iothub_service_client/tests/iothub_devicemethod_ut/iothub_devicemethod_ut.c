@@ -52,7 +52,7 @@ static int my_mallocAndStrcpy_s(char** destination, const char* source)
 
 #include "azure_c_shared_utility/httpheaders.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
+#include "iothub_service_client_http_session.h"
 #include "azure_c_shared_utility/uniqueid.h"
 #include "parson.h"
 
@@ -143,28 +143,6 @@ void my_BUFFER_delete(BUFFER_HANDLE handle)
     my_gballoc_free(handle);
 }
 
-HTTPAPIEX_HANDLE my_HTTPAPIEX_Create(const char* hostName)
-{
-    (void)hostName;
-    return (HTTPAPIEX_HANDLE)my_gballoc_malloc(1);
-}
-
-void my_HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
-{
-    my_gballoc_free(handle);
-}
-
-HTTPAPIEX_SAS_HANDLE my_HTTPAPIEX_SAS_Create(STRING_HANDLE key, STRING_HANDLE uriResource, STRING_HANDLE keyName)
-{
-    (void)key, uriResource, keyName;
-    return (HTTPAPIEX_SAS_HANDLE)my_gballoc_malloc(1);
-}
-
-void my_HTTPAPIEX_SAS_Destroy(HTTPAPIEX_SAS_HANDLE handle)
-{
-    my_gballoc_free(handle);
-}
-
 char* my_json_serialize_to_string(const JSON_Value *value)
 {
     (void)value;
@@ -193,8 +171,11 @@ typedef struct IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_TAG
     char* hostname;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_SERVICE_CLIENT_DEVICE_METHOD;
 
+static IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE TEST_HTTP_SESSION_POOL_HANDLE = (IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE)0x4646;
+
 static IOTHUB_SERVICE_CLIENT_AUTH TEST_IOTHUB_SERVICE_CLIENT_AUTH;
 static IOTHUB_SERVICE_CLIENT_AUTH_HANDLE TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE = &TEST_IOTHUB_SERVICE_CLIENT_AUTH;
 
@@ -286,7 +267,7 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(HTTP_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_HANDLE, void*);
-    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_SAS_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(JSON_Value_Type, int);
 
 
@@ -327,18 +308,11 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_OK);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_ERROR);
 
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Create, my_HTTPAPIEX_Create);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_Create, NULL);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Destroy, my_HTTPAPIEX_Destroy);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Create, my_HTTPAPIEX_SAS_Create);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_Create, NULL);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Destroy, my_HTTPAPIEX_SAS_Destroy);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ClonePool, TEST_HTTP_SESSION_POOL_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ClonePool, NULL);
 
-    REGISTER_GLOBAL_MOCK_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_OK);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_ERROR);
 
     REGISTER_GLOBAL_MOCK_HOOK(json_parse_string, my_json_parse_string);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_parse_string, NULL);
@@ -385,7 +359,9 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.iothubSuffix = TEST_IOTHUBSUFFIX;
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.keyName = TEST_SHAREDACCESSKEYNAME;
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.sharedAccessKey = TEST_SHAREDACCESSKEY;
+    TEST_IOTHUB_SERVICE_CLIENT_AUTH.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
 
+    TEST_IOTHUB_SERVICE_CLIENT_DEVICE_METHOD.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -484,6 +460,7 @@ TEST_FUNCTION(IoTHubDeviceMethod_Create_return_null_if_input_parameter_serviceCl
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_010: [ IoTHubDeviceMethod_Create shall allocate memory and copy iothubSuffix to result->iothubSuffix by calling mallocAndStrcpy_s. ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_012: [ IoTHubDeviceMethod_Create shall allocate memory and copy sharedAccessKey to result->sharedAccessKey by calling mallocAndStrcpy_s. ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_014: [ IoTHubDeviceMethod_Create shall allocate memory and copy keyName to `result->keyName` by calling mallocAndStrcpy_s. ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_41_001: [ IoTHubDeviceMethod_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool. ]*/
 TEST_FUNCTION(IoTHubDeviceMethod_Create_happy_path)
 {
     // arrange
@@ -498,6 +475,8 @@ TEST_FUNCTION(IoTHubDeviceMethod_Create_happy_path)
     
     EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
+
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
     
     // act
     IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_HANDLE result = IoTHubDeviceMethod_Create(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE);
@@ -523,6 +502,7 @@ TEST_FUNCTION(IoTHubDeviceMethod_Create_happy_path)
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_011: [ If the mallocAndStrcpy_s fails, IoTHubDeviceMethod_Create shall do clean up and return NULL. ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_013: [ If the mallocAndStrcpy_s fails, IoTHubDeviceMethod_Create shall do clean up and return NULL. ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_015: [ If the mallocAndStrcpy_s fails, IoTHubDeviceMethod_Create shall do clean up and return NULL. ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubDeviceMethod_Create shall do clean up and return NULL. ]*/
 TEST_FUNCTION(IoTHubDeviceMethod_Create_non_happy_path)
 {
     // arrange
@@ -541,6 +521,7 @@ TEST_FUNCTION(IoTHubDeviceMethod_Create_non_happy_path)
     EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, (const char*)(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE->keyName)))
         .IgnoreArgument(1);
 
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
 
     umock_c_negative_tests_snapshot();
 
@@ -576,6 +557,7 @@ TEST_FUNCTION(IoTHubDeviceMethod_Destroy_return_if_input_parameter_serviceClient
 }
 
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_017: [ If the serviceClientdevicemethodHandle input parameter is not NULL IoTHubDeviceMethod_Destroy shall free the memory of it and return ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_41_003: [ IoTHubDeviceMethod_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ]*/
 TEST_FUNCTION(IoTHubDeviceMethod_Destroy_do_clean_up_and_return_if_input_parameter_serviceClientdevicemethodHandle_is_not_NULL)
 
 {
@@ -584,6 +566,7 @@ TEST_FUNCTION(IoTHubDeviceMethod_Destroy_do_clean_up_and_return_if_input_paramet
 
     umock_c_reset_all_calls();
 
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_DestroyPool(TEST_HTTP_SESSION_POOL_HANDLE));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
@@ -746,9 +729,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_return_NULL_if_input_parameter_responseP
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_034: [ IoTHubDeviceMethod_Invoke shall allocate memory for response buffer by calling BUFFER_new ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_039: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using methodPayloadBuffer ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_040: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using the following HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_049: [ Otherwise IoTHubDeviceMethod_Invoke shall save the received status and payload to the corresponding out parameter and return with IOTHUB_DEVICE_METHOD_OK ]*/
 TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path)
 {
@@ -761,10 +744,6 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -780,13 +759,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
@@ -794,20 +769,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .SetReturn(TEST_UNSIGNED_CHAR_PTR);
@@ -864,9 +828,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path)
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_034: [ IoTHubDeviceMethod_Invoke shall allocate memory for response buffer by calling BUFFER_new ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_039: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using methodPayloadBuffer ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_040: [ IoTHubDeviceMethod_Invoke shall create an HTTP POST request using the following HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_041: [ IoTHubDeviceMethod_Invoke shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_042: [ IoTHubDeviceMethod_Invoke shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICEMETHOD_12_043: [ IoTHubDeviceMethod_Invoke shall execute the HTTP POST request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICEMETHOD_12_049: [ Otherwise IoTHubDeviceMethod_Invoke shall save the received status and payload to the corresponding out parameter and return with IOTHUB_DEVICE_METHOD_OK ]*/
 TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path_http_return_not_equal_200)
 {
@@ -879,10 +843,6 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path_http_return_not_equal_200)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -898,13 +858,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path_http_return_not_equal_200)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeBadRequest, sizeof(httpStatusCodeBadRequest))
         .SetReturn(HTTPAPIEX_OK);
@@ -912,20 +868,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_happy_path_http_return_not_equal_200)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
@@ -970,10 +915,6 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_non_happy_path)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -989,13 +930,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_non_happy_path)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
@@ -1003,20 +940,9 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_non_happy_path)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .SetReturn(TEST_UNSIGNED_CHAR_PTR);
@@ -1059,7 +985,6 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_non_happy_path)
     unsigned char* responsePayload;
     size_t responsePayloadSize;
 
-
     // act
     umock_c_negative_tests_snapshot();
 
@@ -1079,22 +1004,17 @@ TEST_FUNCTION(IoTHubDeviceMethod_Invoke_non_happy_path)
         /// act
         if (
             (i != 2)  && /*STRING_delete*/
-            (i != 10) && /*UniqueId_Generate*/
-            (i != 14) && /*gballoc_free*/
-            (i != 17) && /*STRING_c_str*/
-            (i != 19) && /*STRING_delete*/
-            (i != 20) && /*HTTPAPIEX_Destroy*/
-            (i != 21) && /*HTTPAPIEX_SAS_Destroy*/
-            (i != 22) && /*HTTPHeaders_Free*/
-            (i != 23) && /*STRING_delete*/
-            (i != 24) && /*STRING_delete*/
-            (i != 25) && /*STRING_delete*/
-            (i != 27) && /*BUFFER_length*/
-            (i != 35) && /*json_value_get_number*/
-            (i != 36) && /*STRING_delete*/
-            (i != 37) && /*json_value_free*/
-            (i != 38) && /*BUFFER_delete*/
-            (i != 39)    /*BUFFER_delete*/
+            (i != 7) && /*UniqueId_Generate*/
+            (i != 11) && /*gballoc_free*/
+            (i != 12) && /*STRING_c_str*/
+            (i != 14) && /*STRING_delete*/
+            (i != 15) && /*HTTPHeaders_Free*/
+            (i != 17) && /*BUFFER_length*/
+            (i != 25) && /*json_value_get_number*/
+            (i != 26) && /*STRING_delete*/
+            (i != 27) && /*json_value_free*/
+            (i != 28) && /*BUFFER_delete*/
+            (i != 29)    /*BUFFER_delete*/
             )
         {
             result = IoTHubDeviceMethod_Invoke(TEST_IOTHUB_SERVICE_CLIENT_DEVICE_METHOD_HANDLE, deviceId, methodName, methodPayload, timeout, &responseStatus, &responsePayload, &responsePayloadSize);
@@ -53,7 +53,7 @@ static int my_mallocAndStrcpy_s(char** destination, const char* source)
 
 #include "azure_c_shared_utility/httpheaders.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
+#include "iothub_service_client_http_session.h"
 #include "azure_c_shared_utility/uniqueid.h"
 
 #undef ENABLE_MOCKS
@@ -117,28 +117,6 @@ void my_BUFFER_delete(BUFFER_HANDLE handle)
     my_gballoc_free(handle);
 }
 
-HTTPAPIEX_HANDLE my_HTTPAPIEX_Create(const char* hostName)
-{
-    (void)hostName;
-    return (HTTPAPIEX_HANDLE)my_gballoc_malloc(1);
-}
-
-void my_HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
-{
-    my_gballoc_free(handle);
-}
-
-HTTPAPIEX_SAS_HANDLE my_HTTPAPIEX_SAS_Create(STRING_HANDLE key, STRING_HANDLE uriResource, STRING_HANDLE keyName)
-{
-    (void)key, uriResource, keyName;
-    return (HTTPAPIEX_SAS_HANDLE)my_gballoc_malloc(1);
-}
-
-void my_HTTPAPIEX_SAS_Destroy(HTTPAPIEX_SAS_HANDLE handle)
-{
-    my_gballoc_free(handle);
-}
-
 #include "iothub_devicetwin.h"
 #include "iothub_service_client_auth.h"
 
@@ -147,8 +125,11 @@ typedef struct IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_TAG
     char* hostname;
     char* sharedAccessKey;
     char* keyName;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE httpSessionPool;
 } IOTHUB_SERVICE_CLIENT_DEVICE_TWIN;
 
+static IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE TEST_HTTP_SESSION_POOL_HANDLE = (IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE)0x4646;
+
 static IOTHUB_SERVICE_CLIENT_AUTH TEST_IOTHUB_SERVICE_CLIENT_AUTH;
 static IOTHUB_SERVICE_CLIENT_AUTH_HANDLE TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE = &TEST_IOTHUB_SERVICE_CLIENT_AUTH;
 
@@ -235,7 +216,7 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(HTTP_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_HANDLE, void*);
-    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_SAS_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, void*);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
@@ -265,18 +246,11 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
     REGISTER_GLOBAL_MOCK_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_OK);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_ERROR);
 
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Create, my_HTTPAPIEX_Create);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_Create, NULL);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Destroy, my_HTTPAPIEX_Destroy);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Create, my_HTTPAPIEX_SAS_Create);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_Create, NULL);
-
-    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Destroy, my_HTTPAPIEX_SAS_Destroy);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ClonePool, TEST_HTTP_SESSION_POOL_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ClonePool, NULL);
 
-    REGISTER_GLOBAL_MOCK_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_OK);
-    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_ERROR);
 }
 
 TEST_SUITE_CLEANUP(TestClassCleanup)
@@ -300,7 +274,9 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.iothubSuffix = TEST_IOTHUBSUFFIX;
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.keyName = TEST_SHAREDACCESSKEYNAME;
     TEST_IOTHUB_SERVICE_CLIENT_AUTH.sharedAccessKey = TEST_SHAREDACCESSKEY;
+    TEST_IOTHUB_SERVICE_CLIENT_AUTH.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
 
+    TEST_IOTHUB_SERVICE_CLIENT_DEVICE_TWIN.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -399,6 +375,7 @@ TEST_FUNCTION(IoTHubDeviceTwin_Create_return_null_if_input_parameter_serviceClie
 /*Tests_SRS_IOTHUBDEVICETWIN_12_010: [ IoTHubDeviceTwin_Create shall allocate memory and copy iothubSuffix to result->iothubSuffix by calling mallocAndStrcpy_s. ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_012: [ IoTHubDeviceTwin_Create shall allocate memory and copy sharedAccessKey to result->sharedAccessKey by calling mallocAndStrcpy_s. ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_014: [ IoTHubDeviceTwin_Create shall allocate memory and copy keyName to `result->keyName` by calling mallocAndStrcpy_s. ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_41_001: [ IoTHubDeviceTwin_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool. ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_Create_happy_path)
 {
     // arrange
@@ -413,6 +390,8 @@ TEST_FUNCTION(IoTHubDeviceTwin_Create_happy_path)
     
     EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
+
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
     
     // act
     IOTHUB_SERVICE_CLIENT_DEVICE_TWIN_HANDLE result = IoTHubDeviceTwin_Create(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE);
@@ -438,6 +417,7 @@ TEST_FUNCTION(IoTHubDeviceTwin_Create_happy_path)
 /*Tests_SRS_IOTHUBDEVICETWIN_12_011: [ If the mallocAndStrcpy_s fails, IoTHubDeviceTwin_Create shall do clean up and return NULL. ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_013: [ If the mallocAndStrcpy_s fails, IoTHubDeviceTwin_Create shall do clean up and return NULL. ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_015: [ If the mallocAndStrcpy_s fails, IoTHubDeviceTwin_Create shall do clean up and return NULL. ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubDeviceTwin_Create shall do clean up and return NULL. ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_Create_non_happy_path)
 {
     // arrange
@@ -456,6 +436,7 @@ TEST_FUNCTION(IoTHubDeviceTwin_Create_non_happy_path)
     EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, (const char*)(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE->keyName)))
         .IgnoreArgument(1);
 
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
 
     umock_c_negative_tests_snapshot();
 
@@ -491,6 +472,7 @@ TEST_FUNCTION(IoTHubDeviceTwin_Destroy_return_if_input_parameter_serviceClientDe
 }
 
 /*Tests_SRS_IOTHUBDEVICETWIN_12_017: [ If the serviceClientDeviceTwinHandle input parameter is not NULL IoTHubDeviceTwin_Destroy shall free the memory of it and return ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_41_003: [ IoTHubDeviceTwin_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_Destroy_do_clean_up_and_return_if_input_parameter_serviceClientDeviceTwinHandle_is_not_NULL)
 {
     // arrange
@@ -498,6 +480,7 @@ TEST_FUNCTION(IoTHubDeviceTwin_Destroy_do_clean_up_and_return_if_input_parameter
 
     umock_c_reset_all_calls();
 
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_DestroyPool(TEST_HTTP_SESSION_POOL_HANDLE));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
@@ -543,19 +526,15 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_return_NULL_if_input_parameter_deviceId_i
 
 /*Tests_SRS_IOTHUBDEVICETWIN_12_019: [ IoTHubDeviceTwin_GetTwin shall create HTTP GET request URL using the given deviceId using the following format: url/twins/[deviceId] ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_020: [ IoTHubDeviceTwin_GetTwin shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_030: [ Otherwise IoTHubDeviceTwin_GetTwin shall save the received deviceTwin to the out parameter and return with it ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_200)
 {
     // arrange
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -571,33 +550,18 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_200)
     
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
 
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -624,19 +588,15 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_200)
 
 /*Tests_SRS_IOTHUBDEVICETWIN_12_019: [ IoTHubDeviceTwin_GetTwin shall create HTTP GET request URL using the given deviceId using the following format: url/twins/[deviceId] ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_020: [ IoTHubDeviceTwin_GetTwin shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_021: [ IoTHubDeviceTwin_GetTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_022: [ IoTHubDeviceTwin_GetTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_023: [ IoTHubDeviceTwin_GetTwin shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_030: [ Otherwise IoTHubDeviceTwin_GetTwin shall save the received deviceTwin to the out parameter and return with it ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_400)
 {
     // arrange
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -653,13 +613,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_400)
 
     EXPECTED_CALL(gballoc_free(IGNORED_NUM_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeBadRequest, sizeof(httpStatusCodeBadRequest))
         .SetReturn(HTTPAPIEX_OK);
@@ -667,20 +623,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_happy_path_status_code_400)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -704,10 +649,6 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_non_happy_path)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(UniqueId_Generate(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
 
@@ -724,33 +665,18 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_non_happy_path)
 
     EXPECTED_CALL(gballoc_free(IGNORED_NUM_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
 
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -776,17 +702,11 @@ TEST_FUNCTION(IoTHubDeviceTwin_GetTwin_non_happy_path)
 
         /// act
         if (
-            (i != 7) && /*gballoc_malloc*/
-            (i != 13) && /*STRING_c_str*/
-            (i != 15) && /*HTTPHeaders_Free*/
-            (i != 16) && /*HTTPAPIEX_Destroy*/
-            (i != 17) && /*HTTPAPIEX_SAS_Destroy*/
-            (i != 18) && /*STRING_delete*/
-            (i != 19) && /*STRING_delete*/
-            (i != 20) && /*STRING_delete*/
-            (i != 21) && /*BUFFER_u_char*/
-            (i != 22) && /*mallocAndStrcpy_s*/
-            (i != 23)    /*BUFFER_delete*/
+            (i != 4) && /*gballoc_malloc*/
+            (i != 10) && /*HTTPHeaders_Free*/
+            (i != 11) && /*STRING_delete*/
+            (i != 12) && /*STRING_delete*/
+            (i != 13)    /*BUFFER_delete*/
             )
         {
             const char* deviceId = " ";
@@ -847,9 +767,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_return_NULL_if_input_parameter_deviceT
 /*Tests_SRS_IOTHUBDEVICETWIN_12_034: [ IoTHubDeviceTwin_UpdateTwin shall allocate memory for response buffer by calling BUFFER_new ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_039: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using deviceTwinJson ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_040: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using the createdfollowing HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_047: [ Otherwise IoTHubDeviceTwin_UpdateTwin shall save the received updated device twin to the out parameter and return with it ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_200)
 {
@@ -859,10 +779,6 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_200)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -880,13 +796,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_200)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
@@ -894,20 +806,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_200)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -939,9 +840,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_200)
 /*Tests_SRS_IOTHUBDEVICETWIN_12_034: [ IoTHubDeviceTwin_UpdateTwin shall allocate memory for response buffer by calling BUFFER_new ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_039: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using deviceTwinJson ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_040: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTP PATCH request using the createdfollowing HTTP headers: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-/*Tests_SRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling HTTPAPIEX_ExecuteRequest ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_041: [ IoTHubDeviceTwin_UpdateTwin shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_042: [ IoTHubDeviceTwin_UpdateTwin shall execute the request on a session of the HTTP session pool of the service client ]*/
+/*Tests_SRS_IOTHUBDEVICETWIN_12_043: [ IoTHubDeviceTwin_UpdateTwin shall execute the HTTP PATCH request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
 /*Tests_SRS_IOTHUBDEVICETWIN_12_047: [ Otherwise IoTHubDeviceTwin_UpdateTwin shall save the received updated device twin to the out parameter and return with it ]*/
 TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_400)
 {
@@ -951,10 +852,6 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_400)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -972,13 +869,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_400)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeBadRequest, sizeof(httpStatusCodeBadRequest))
         .SetReturn(HTTPAPIEX_OK);
@@ -986,20 +879,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_happy_path_status_code_400)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
     EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -1032,10 +914,6 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_non_happy_path)
 
     EXPECTED_CALL(BUFFER_new());
 
-    EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-    EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
     EXPECTED_CALL(HTTPHeaders_Alloc());
     EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
         .IgnoreArgument(1);
@@ -1053,13 +931,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_non_happy_path)
 
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreAllArguments();
-    EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
     EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG));
 
-    EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments()
         .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
         .SetReturn(HTTPAPIEX_OK);
@@ -1067,21 +941,9 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_non_happy_path)
     EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
     EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-
     EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
@@ -1110,20 +972,15 @@ TEST_FUNCTION(IoTHubDeviceTwin_UpdateTwin_non_happy_path)
 
         /// act
         if (
-            (i != 7)  && /*gballoc_malloc*/
-            (i != 8)  && /*UniqueId_Generate*/
-            (i != 13) && /*gballoc_free*/
-            (i != 16) && /*STRING_c_str*/
-            (i != 18) && /*STRING_delete*/
-            (i != 19) && /*STRING_delete*/
-            (i != 20) && /*STRING_delete*/
-            (i != 21) && /*BUFFER_u_char*/
-            (i != 22) && /*mallocAndStrcpy_s*/
-            (i != 23) && /*BUFFER_delete*/
-            (i != 24) && /*BUFFER_delete*/
-            (i != 25) && /*BUFFER_delete*/
-            (i != 27) && /*BUFFER_delete*/
-            (i != 28)    /*BUFFER_delete*/
+            (i != 4)  && /*gballoc_malloc*/
+            (i != 5)  && /*UniqueId_Generate*/
+            (i != 10) && /*gballoc_free*/
+            (i != 11) && /*STRING_c_str*/
+            (i != 13) && /*STRING_delete*/
+            (i != 14) && /*BUFFER_u_char*/
+            (i != 15) && /*BUFFER_delete*/
+            (i != 17) && /*BUFFER_delete*/
+            (i != 18)    /*BUFFER_delete*/
             )
         {
             const char* deviceId = " ";
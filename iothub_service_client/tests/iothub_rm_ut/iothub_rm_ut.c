@@ -4,9 +4,11 @@
 #ifdef __cplusplus
 #include <cstdlib>
 #include <cstddef>
+#include <cstring>
 #else
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #endif
 
 #include "testrunnerswitcher.h"
@@ -17,7 +19,7 @@
 #define ENABLE_MOCKS
 #include "azure_c_shared_utility/httpheaders.h"
 #include "azure_c_shared_utility/httpapiex.h"
-#include "azure_c_shared_utility/httpapiexsas.h"
+#include "iothub_service_client_http_session.h"
 #include "azure_c_shared_utility/strings.h"
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "parson.h"
@@ -27,12 +29,16 @@ MOCKABLE_FUNCTION(, JSON_Value*, json_parse_string, const char *, string);
 MOCKABLE_FUNCTION(, const char*, json_object_get_string, const JSON_Object *, object, const char *, name);
 MOCKABLE_FUNCTION(, JSON_Object*, json_value_get_object, const JSON_Value *, value);
 MOCKABLE_FUNCTION(, double, json_object_get_number, const JSON_Object*, object, const char*, name);
+MOCKABLE_FUNCTION(, int, json_object_get_boolean, const JSON_Object*, object, const char*, name);
 MOCKABLE_FUNCTION(, char*, json_serialize_to_string, const JSON_Value*, value);
 MOCKABLE_FUNCTION(, void, json_free_serialized_string, char*, string);
 MOCKABLE_FUNCTION(, const char*, json_object_dotget_string, const JSON_Object*, object, const char*, name);
 MOCKABLE_FUNCTION(, JSON_Status, json_object_set_string, JSON_Object*, object, const char*, name, const char*, string);
 MOCKABLE_FUNCTION(, JSON_Status, json_object_dotset_string, JSON_Object*, object, const char*, name, const char*, string);
 MOCKABLE_FUNCTION(, JSON_Value*, json_value_init_object);
+MOCKABLE_FUNCTION(, JSON_Value*, json_value_init_array);
+MOCKABLE_FUNCTION(, JSON_Status, json_array_append_value, JSON_Array*, array, JSON_Value*, value);
+MOCKABLE_FUNCTION(, JSON_Array*, json_object_get_array, const JSON_Object*, object, const char*, name);
 MOCKABLE_FUNCTION(, JSON_Array*, json_array_get_array, const JSON_Array*, array, size_t, index);
 MOCKABLE_FUNCTION(, JSON_Object*, json_array_get_object, const JSON_Array*, array, size_t, index);
 MOCKABLE_FUNCTION(, JSON_Array*, json_value_get_array, const JSON_Value*, value);
@@ -82,28 +88,6 @@ void my_BUFFER_delete(BUFFER_HANDLE handle)
     free(handle);
 }
 
-HTTPAPIEX_HANDLE my_HTTPAPIEX_Create(const char* hostName)
-{
-    (void)hostName;
-    return (HTTPAPIEX_HANDLE)malloc(1);
-}
-
-void my_HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
-{
-    free(handle);
-}
-
-HTTPAPIEX_SAS_HANDLE my_HTTPAPIEX_SAS_Create(STRING_HANDLE key, STRING_HANDLE uriResource, STRING_HANDLE keyName)
-{
-    (void)key, uriResource, keyName;
-    return (HTTPAPIEX_SAS_HANDLE)malloc(1);
-}
-
-void my_HTTPAPIEX_SAS_Destroy(HTTPAPIEX_SAS_HANDLE handle)
-{
-    free(handle);
-}
-
 static void* my_gballoc_malloc(size_t size)
 {
     return malloc(size);
@@ -397,6 +381,7 @@ static JSON_Status TEST_JSON_STATUS = 0;
 
 static char* TEST_CHAR_PTR = "TestString";
 static unsigned char* TEST_UNSIGNED_CHAR_PTR = (unsigned char*)"TestString";
+static const size_t TEST_RESPONSE_LENGTH = 10;
 static const char* TEST_CONST_CHAR_PTR = "TestConstChar";
 
 static STRING_HANDLE TEST_STRING_HANDLE = (STRING_HANDLE)0x4242;
@@ -408,7 +393,7 @@ static const unsigned int httpStatusCodeOk = 200;
 static const unsigned int httpStatusCodeBadRequest = 400;
 static const unsigned int httpStatusCodeDeviceExists = 409;
 static const HTTPAPIEX_HANDLE TEST_HTTPAPIEX_HANDLE = (HTTPAPIEX_HANDLE)0x4343;
-static HTTPAPIEX_SAS_HANDLE TEST_HTTPAPIEX_SAS_HANDLE = (HTTPAPIEX_SAS_HANDLE)0x4444;
+static IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE TEST_HTTP_SESSION_POOL_HANDLE = (IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE)0x4646;
 static const HTTP_HEADERS_HANDLE TEST_HTTP_HEADERS_HANDLE = (HTTP_HEADERS_HANDLE)0x4545;
 static const HTTP_HEADERS_RESULT TEST_HTTP_HEADERS_RESULT = (HTTP_HEADERS_RESULT)0x1;
 static HTTPAPIEX_RESULT TEST_HTTPAPIEX_RESULT = (HTTPAPIEX_RESULT)0x1;
@@ -432,6 +417,24 @@ static const char* TEST_DEVICE_JSON_KEY_DEVICE_CONFIGURATION = "configuration";
 static const char* TEST_DEVICE_JSON_KEY_DEVICE_DEVICEROPERTIES = "deviceProperties";
 static const char* TEST_DEVICE_JSON_KEY_DEVICE_SERVICEPROPERTIES = "serviceProperties";
 
+static const char* TEST_DEVICE_JSON_KEY_BULK_DEVICE_NAME = "id";
+static const char* TEST_DEVICE_JSON_KEY_BULK_IMPORT_MODE = "importMode";
+static const char* TEST_DEVICE_JSON_KEY_BULK_ERRORS = "errors";
+static const char* TEST_DEVICE_JSON_KEY_BULK_ERROR_CODE = "errorCode";
+static const char* TEST_DEVICE_JSON_KEY_BULK_IS_SUCCESSFUL = "isSuccessful";
+static const char* TEST_IMPORT_MODE_CREATE_OR_UPDATE = "createOrUpdate";
+static const char* TEST_IMPORT_MODE_DELETE = "delete";
+static const char* TEST_BULK_ERROR_CODE_DEVICE_ALREADY_EXISTS = "DeviceAlreadyExists";
+static const char* TEST_BULK_ERROR_CODE_DEVICE_NOT_FOUND = "DeviceNotFound";
+static const char* TEST_SECOND_DEVICE_ID = "theSecondDeviceId";
+static const char* TEST_DEVICE_JSON_KEY_QUERY_STATUSUPDATEDTIME = "statusUpdateTime";
+static const char* TEST_DEVICE_JSON_KEY_QUERY_DEVICE_ETAG = "deviceEtag";
+static const char* TEST_DEVICE_JSON_KEY_QUERY_AUTHENTICATION_TYPE = "authenticationType";
+static const char* TEST_QUERY_AUTHENTICATION_TYPE_SAS = "sas";
+static const char* TEST_QUERY_STATUS_ENABLED = "enabled";
+static const char* TEST_CONTINUATION_TOKEN = "theContinuationToken";
+static const char* TEST_PAGE_SIZE = "100";
+
 static const char* TEST_DEVICE_JSON_KEY_TOTAL_DEVICECOUNT = "totalDeviceCount";
 static const char* TEST_DEVICE_JSON_KEY_ENABLED_DEVICECCOUNT = "enabledDeviceCount";
 static const char* TEST_DEVICE_JSON_KEY_DISABLED_DEVICECOUNT = "disabledDeviceCount";
@@ -460,6 +463,8 @@ static const char* TEST_HTTP_HEADER_KEY_CONTENT_TYPE = "Content-Type";
 static const char* TEST_HTTP_HEADER_VAL_CONTENT_TYPE = "application/json; charset=utf-8";
 static const char* TEST_HTTP_HEADER_KEY_IFMATCH = "If-Match";
 static const char* TEST_HTTP_HEADER_VAL_IFMATCH = "*";
+static const char* TEST_HTTP_HEADER_KEY_MAX_ITEM_COUNT = "x-ms-max-item-count";
+static const char* TEST_HTTP_HEADER_KEY_CONTINUATION = "x-ms-continuation";
 
 DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
 
@@ -470,6 +475,171 @@ static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
     ASSERT_FAIL(temp_str);
 }
 
+static void setup_bulk_chunk_expected_calls(const IOTHUB_REGISTRY_DEVICE_CREATE* devices, size_t deviceCount, const char* importMode, const unsigned int* statusCode, size_t responseLength)
+{
+    STRICT_EXPECTED_CALL(json_value_init_array());
+    STRICT_EXPECTED_CALL(json_value_get_array(TEST_JSON_VALUE));
+    for (size_t i = 0; i < deviceCount; i++)
+    {
+        STRICT_EXPECTED_CALL(json_value_init_object());
+        STRICT_EXPECTED_CALL(json_value_get_object(TEST_JSON_VALUE));
+        STRICT_EXPECTED_CALL(json_object_set_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_DEVICE_NAME, devices[i].deviceId));
+        STRICT_EXPECTED_CALL(json_object_set_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_IMPORT_MODE, importMode));
+        if ((strcmp(importMode, TEST_IMPORT_MODE_CREATE_OR_UPDATE) == 0) && (devices[i].primaryKey != NULL))
+        {
+            STRICT_EXPECTED_CALL(json_object_dotset_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_PRIMARY_KEY, devices[i].primaryKey));
+        }
+        if ((strcmp(importMode, TEST_IMPORT_MODE_CREATE_OR_UPDATE) == 0) && (devices[i].secondaryKey != NULL))
+        {
+            STRICT_EXPECTED_CALL(json_object_dotset_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_SECONDARY_KEY, devices[i].secondaryKey));
+        }
+        STRICT_EXPECTED_CALL(json_array_append_value(TEST_JSON_ARRAY, TEST_JSON_VALUE));
+    }
+    STRICT_EXPECTED_CALL(json_serialize_to_string(TEST_JSON_VALUE));
+    STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(json_free_serialized_string(TEST_CHAR_PTR));
+    STRICT_EXPECTED_CALL(json_value_free(TEST_JSON_VALUE));
+
+    STRICT_EXPECTED_CALL(BUFFER_new());
+
+    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_REQUEST_ID, TEST_HTTP_HEADER_VAL_REQUEST_ID))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_USER_AGENT, TEST_HTTP_HEADER_VAL_USER_AGENT))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_ACCEPT, TEST_HTTP_HEADER_VAL_ACCEPT))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(TEST_HTTP_SESSION_POOL_HANDLE, HTTPAPI_REQUEST_POST, "/devices?api-version=2016-11-14", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(4)
+        .IgnoreArgument(5)
+        .IgnoreArgument(6)
+        .IgnoreArgument(7)
+        .IgnoreArgument(8)
+        .CopyOutArgumentBuffer_statusCode(statusCode, sizeof(*statusCode))
+        .SetReturn(HTTPAPIEX_OK);
+
+    STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(BUFFER_length(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(responseLength);
+}
+
+static void setup_bulk_chunk_cleanup_expected_calls(void)
+{
+    STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+}
+
+static size_t g_enumerated_device_count;
+static int g_enumeration_callback_result;
+static IOTHUB_DEVICE_STATUS g_enumerated_device_status;
+static IOTHUB_DEVICE_CONNECTION_STATE g_enumerated_device_connection_state;
+static IOTHUB_REGISTRYMANAGER_AUTH_METHOD g_enumerated_device_auth_method;
+
+static int test_device_enumeration_callback(void* context, const IOTHUB_DEVICE* device)
+{
+    (void)context;
+    g_enumerated_device_count++;
+    g_enumerated_device_status = device->status;
+    g_enumerated_device_connection_state = device->connectionState;
+    g_enumerated_device_auth_method = device->authMethod;
+    return g_enumeration_callback_result;
+}
+
+static void setup_enumerate_devices_page_expected_calls(bool withContinuationToken, const char* nextContinuationToken)
+{
+    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
+    STRICT_EXPECTED_CALL(BUFFER_new());
+
+    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_REQUEST_ID, TEST_HTTP_HEADER_VAL_REQUEST_ID))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_USER_AGENT, TEST_HTTP_HEADER_VAL_USER_AGENT))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_ACCEPT, TEST_HTTP_HEADER_VAL_ACCEPT))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_MAX_ITEM_COUNT, TEST_PAGE_SIZE))
+        .IgnoreArgument(1);
+    if (withContinuationToken)
+    {
+        STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTINUATION, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+    }
+
+    STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(TEST_HTTP_SESSION_POOL_HANDLE, HTTPAPI_REQUEST_POST, "/devices/query?api-version=2016-11-14", IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(4)
+        .IgnoreArgument(5)
+        .IgnoreArgument(6)
+        .IgnoreArgument(7)
+        .IgnoreArgument(8)
+        .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
+        .SetReturn(HTTPAPIEX_OK);
+
+    STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(TEST_UNSIGNED_CHAR_PTR);
+    STRICT_EXPECTED_CALL(json_parse_string(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(TEST_JSON_VALUE);
+    STRICT_EXPECTED_CALL(json_value_get_array(TEST_JSON_VALUE));
+    STRICT_EXPECTED_CALL(json_array_get_count(TEST_JSON_ARRAY))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(json_array_get_object(TEST_JSON_ARRAY, 0));
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_CONNECTIONSTATE))
+        .SetReturn(TEST_DEVICE_JSON_DEFAULT_VALUE_CONNECTED);
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_STATUS))
+        .SetReturn(TEST_QUERY_STATUS_ENABLED);
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_QUERY_AUTHENTICATION_TYPE))
+        .SetReturn(TEST_QUERY_AUTHENTICATION_TYPE_SAS);
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_NAME))
+        .SetReturn(TEST_DEVICE_ID);
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_QUERY_DEVICE_ETAG));
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_CONNECTIONSTATEUPDATEDTIME));
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_STATUSREASON));
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_QUERY_STATUSUPDATEDTIME));
+    STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_LASTACTIVITYTIME));
+    STRICT_EXPECTED_CALL(json_object_get_number(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_CLOUDTODEVICEMESSAGECOUNT));
+    STRICT_EXPECTED_CALL(json_value_free(TEST_JSON_VALUE));
+
+    STRICT_EXPECTED_CALL(HTTPHeaders_FindHeaderValue(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTINUATION))
+        .IgnoreArgument(1)
+        .SetReturn(nextContinuationToken);
+    if (withContinuationToken)
+    {
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+    }
+    if ((g_enumeration_callback_result == 0) && (nextContinuationToken != NULL))
+    {
+        STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, nextContinuationToken))
+            .IgnoreArgument(1);
+    }
+
+    STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+}
+
 BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
     TEST_SUITE_INITIALIZE(TestClassInitialize)
@@ -495,7 +665,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_HANDLE, void*);
         REGISTER_UMOCK_ALIAS_TYPE(HTTP_HANDLE, void*);
         REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_HANDLE, void*);
-        REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_SAS_HANDLE, void*);
+        REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, void*);
 
         REGISTER_UMOCK_ALIAS_TYPE(JSON_Value, void*);
         REGISTER_UMOCK_ALIAS_TYPE(JSON_Object, void*);
@@ -553,21 +723,23 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         REGISTER_GLOBAL_MOCK_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_OK);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPHeaders_AddHeaderNameValuePair, HTTP_HEADERS_ERROR);
 
-        REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Create, my_HTTPAPIEX_Create);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_Create, NULL);
+        REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ClonePool, TEST_HTTP_SESSION_POOL_HANDLE);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ClonePool, NULL);
 
-        REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Destroy, my_HTTPAPIEX_Destroy);
+        REGISTER_GLOBAL_MOCK_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_OK);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubServiceClientHttpSession_ExecuteRequest, HTTPAPIEX_ERROR);
 
-        REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Create, my_HTTPAPIEX_SAS_Create);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_Create, NULL);
+        REGISTER_GLOBAL_MOCK_RETURN(json_value_init_object, TEST_JSON_VALUE);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_value_init_object, NULL);
 
-        REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_SAS_Destroy, my_HTTPAPIEX_SAS_Destroy);
+        REGISTER_GLOBAL_MOCK_RETURN(json_value_init_array, TEST_JSON_VALUE);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_value_init_array, NULL);
 
-        REGISTER_GLOBAL_MOCK_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_OK);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_SAS_ExecuteRequest, HTTPAPIEX_ERROR);
+        REGISTER_GLOBAL_MOCK_RETURN(json_array_append_value, JSONSuccess);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_array_append_value, JSONFailure);
 
-        REGISTER_GLOBAL_MOCK_RETURN(json_value_init_object, TEST_JSON_VALUE);
-        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_value_init_object, NULL);
+        REGISTER_GLOBAL_MOCK_RETURN(json_object_get_array, TEST_JSON_ARRAY);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_object_get_array, NULL);
 
         REGISTER_GLOBAL_MOCK_RETURN(json_value_get_object, TEST_JSON_OBJECT);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_value_get_object, NULL);
@@ -578,6 +750,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         REGISTER_GLOBAL_MOCK_RETURN(json_object_get_number, 42);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_object_get_number, -1);
 
+        REGISTER_GLOBAL_MOCK_RETURN(json_object_get_boolean, 1);
+        REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_object_get_boolean, -1);
+
         REGISTER_GLOBAL_MOCK_RETURN(json_object_dotget_string, TEST_CONST_CHAR_PTR);
         REGISTER_GLOBAL_MOCK_FAIL_RETURN(json_object_dotget_string, NULL);
 
@@ -630,12 +805,17 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         TEST_IOTHUB_SERVICE_CLIENT_AUTH.iothubSuffix = TEST_IOTHUBSUFFIX;
         TEST_IOTHUB_SERVICE_CLIENT_AUTH.keyName = TEST_SHAREDACCESSKEYNAME;
         TEST_IOTHUB_SERVICE_CLIENT_AUTH.sharedAccessKey = TEST_SHAREDACCESSKEY;
+        TEST_IOTHUB_SERVICE_CLIENT_AUTH.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
 
         TEST_IOTHUB_REGISTRYMANAGER.hostname = TEST_HOSTNAME;
         TEST_IOTHUB_REGISTRYMANAGER.iothubName = TEST_IOTHUBNAME;
         TEST_IOTHUB_REGISTRYMANAGER.iothubSuffix = TEST_IOTHUBSUFFIX;
         TEST_IOTHUB_REGISTRYMANAGER.keyName = TEST_SHAREDACCESSKEYNAME;
         TEST_IOTHUB_REGISTRYMANAGER.sharedAccessKey = TEST_SHAREDACCESSKEY;
+        TEST_IOTHUB_REGISTRYMANAGER.httpSessionPool = TEST_HTTP_SESSION_POOL_HANDLE;
+
+        g_enumerated_device_count = 0;
+        g_enumeration_callback_result = 0;
 
         TEST_IOTHUB_REGISTRY_DEVICE_CREATE.deviceId = TEST_DEVICE_ID;
         TEST_IOTHUB_REGISTRY_DEVICE_CREATE.primaryKey = TEST_PRIMARYKEY;
@@ -750,6 +930,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_089: [ IoTHubRegistryManager_Create shall allocate memory and copy iothubSuffix to result->iothubSuffix by calling mallocAndStrcpy_s. ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_091: [ IoTHubRegistryManager_Create shall allocate memory and copy sharedAccessKey to result->sharedAccessKey by calling mallocAndStrcpy_s. ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_093: [ IoTHubRegistryManager_Create shall allocate memory and copy keyName to result->keyName by calling mallocAndStrcpy_s. ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_001: [ IoTHubRegistryManager_Create shall take a reference to the HTTP session pool of serviceClientHandle by calling IoTHubServiceClientHttpSession_ClonePool, so all its requests reuse the sessions and SAS token of the pool. ] */
     TEST_FUNCTION(IoTHubRegistryManager_Create_happy_path)
     {
         // arrange
@@ -771,6 +952,8 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
+
         // act
         IOTHUB_REGISTRYMANAGER_HANDLE result = IoTHubRegistryManager_Create(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE);
 
@@ -797,6 +980,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_090: [ If the mallocAndStrcpy_s fails, IoTHubRegistryManager_Create shall do clean up and return NULL. ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_092: [ If the mallocAndStrcpy_s fails, IoTHubRegistryManager_Create shall do clean up and return NULL. ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_094: [ If the mallocAndStrcpy_s fails, IoTHubRegistryManager_Create shall do clean up and return NULL. ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_002: [ If the IoTHubServiceClientHttpSession_ClonePool fails, IoTHubRegistryManager_Create shall do clean up and return NULL. ] */
     TEST_FUNCTION(IoTHubRegistryManager_Create_non_happy_path)
     {
         // arrange
@@ -821,7 +1005,8 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, (const char*)(TEST_IOTHUB_SERVICE_CLIENT_AUTH_HANDLE->keyName)))
             .IgnoreArgument(1);
 
-        
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ClonePool(TEST_HTTP_SESSION_POOL_HANDLE));
+
         umock_c_negative_tests_snapshot();
 
         ///act
@@ -855,6 +1040,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     }
 
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_006 : [ If the registryManagerHandle input parameter is not NULL IoTHubRegistryManager_Destroy shall free the memory of it and return ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_003: [ IoTHubRegistryManager_Destroy shall release its reference to the HTTP session pool by calling IoTHubServiceClientHttpSession_DestroyPool ] */
     TEST_FUNCTION(IoTHubRegistryManager_Destroy_do_clean_up_and_return_if_input_parameter_registryManagerHandle_is_not_NULL)
     {
         // arrange
@@ -862,6 +1048,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         umock_c_reset_all_calls();
 
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_DestroyPool(TEST_HTTP_SESSION_POOL_HANDLE));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
@@ -977,8 +1164,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
     }
 
-
-
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_010: [ IoTHubRegistryManager_CreateDevice shall create a flat "key1:value2,key2:value2..." JSON representation from the given deviceCreateInfo parameter using the following parson APIs: json_value_init_object, json_value_get_object, json_object_set_string, json_object_dotset_string ]*/
     /* Tests__SRS_IOTHUBREGISTRYMANAGER_06_002: [ IoTHubRegistryManager_CreateDevice shall, if deviceCreateInfo->authMethod is equal to "IOTHUB_REGISTRYMANAGER_AUTH_SPK", set "authorization.symmetricKey.primaryKey" to deviceCreateInfo->primaryKey and "authorization.symmetricKey.secondaryKey" to deviceCreateInfo->secondaryKey ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_024: [ If the deviceInfo out parameter is not NULL IoTHubRegistryManager_CreateDevice shall save the received deviceInfo to the out parameter and return IOTHUB_REGISTRYMANAGER_OK ]*/
@@ -1010,10 +1195,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1026,35 +1207,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -1195,10 +1360,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1211,35 +1372,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -1354,7 +1499,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         free((void*)deviceInfo.serviceProperties);
     }
 
-
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_020: [ IoTHubRegistryManager_CreateDevice shall verify the received HTTP status code and if it is 409 then return IOTHUB_REGISTRYMANAGER_DEVICE_EXIST ]*/
     TEST_FUNCTION(IoTHubRegistryManager_CreateDevice_happy_path_status_code_409)
     {
@@ -1385,10 +1529,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1401,35 +1541,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeDeviceExists, sizeof(httpStatusCodeDeviceExists))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1480,10 +1604,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1496,35 +1616,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeBadRequest, sizeof(httpStatusCodeBadRequest))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1581,10 +1685,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1597,35 +1697,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeBadRequest, sizeof(httpStatusCodeBadRequest))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1648,15 +1732,10 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
             if (
                 (i != 8) && /*json_free_serialized_string*/
                 (i != 10) && /*json_value_free*/
-                (i != 24) && /*HTTPHeaders_Free*/
-                (i != 25) && /*HTTPAPIEX_Destroy*/
-                (i != 26) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 27) && /*STRING_delete*/
-                (i != 28) && /*STRING_delete*/
-                (i != 29) && /*STRING_delete*/
-                (i != 30) && /*BUFFER_delete*/
-                (i != 31) && /*BUFFER_delete*/
-                (i != 32) /*gballoc_free*/
+                (i != 19) && /*HTTPHeaders_Free*/
+                (i != 20) && /*BUFFER_delete*/
+                (i != 21) && /*BUFFER_delete*/
+                (i != 22) /*gballoc_free*/
                 )
             {
                 IOTHUB_DEVICE deviceInfo;
@@ -1700,9 +1779,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_026: [ IoTHubRegistryManager_GetDevice shall create HTTP GET request URL using the given deviceId using the following format: url/devices/[deviceId]?api-version=2016-11-14  ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_027: [ IoTHubRegistryManager_GetDevice shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_028: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_029: [ IoTHubRegistryManager_GetDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_028: [ IoTHubRegistryManager_GetDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_029: [ IoTHubRegistryManager_GetDevice shall execute the request on a session of the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_030: [ IoTHubRegistryManager_GetDevice shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_06_008: [ IoTHubRegistryManager_GetDevice shall, if json was found for authorization.symetricKey.primaryKey, set the device info authMethod to "IOTHUB_REGISTRYMANAGER_AUTH_SPK" ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_06_012: [ IoTHubRegistryManager_GetDevice shall, if json was found for authorization.x509Thumbprint.secondaryThumbprint, set the device info authMethod to "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_06_010: [ IoTHubRegistryManager_GetDevice shall, if json was found for authorization.symetricKey.secondaryKey, set the device info authMethod to "IOTHUB_REGISTRYMANAGER_AUTH_SPK" ] */
@@ -1711,10 +1790,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         ///arrange
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1727,35 +1802,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -1837,7 +1896,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-
         ///act
         IOTHUB_DEVICE deviceInfo;
         IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_GetDevice(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, TEST_DEVICE_ID, &deviceInfo);
@@ -1867,10 +1925,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         ///arrange
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -1883,35 +1937,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -1965,7 +2003,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(json_object_dotget_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_SECONDARY_THUMBPRINT))
             .SetReturn(TEST_SECONDARYKEY);
 
-
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1999,7 +2036,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-
         ///act
         IOTHUB_DEVICE deviceInfo;
         IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_GetDevice(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, TEST_DEVICE_ID, &deviceInfo);
@@ -2038,10 +2074,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2054,35 +2086,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -2177,31 +2193,26 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
             umock_c_negative_tests_fail_call(i);
             /// act
             if (
-                (i != 13) && /*HTTPHeaders_Free*/
-                (i != 14) && /*HTTPAPIEX_Destroy*/
-                (i != 15) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 16) && /*STRING_delete*/
-                (i != 17) && /*STRING_delete*/
-                (i != 18) && /*STRING_delete*/
-                (i != 19) && /*BUFFER_u_char*/
+                (i != 8) && /*HTTPHeaders_Free*/
+                (i != 9) && /*BUFFER_u_char*/
+                (i != 12) && /*json_object_get_string*/
+                (i != 13) && /*json_object_dotget_string*/
+                (i != 14) && /*json_object_dotget_string*/
+                (i != 15) && /*json_object_get_string*/
+                (i != 16) && /*json_object_get_string*/
+                (i != 17) && /*json_object_get_string*/
+                (i != 18) && /*json_object_get_string*/
+                (i != 19) && /*json_object_get_string*/
+                (i != 20) && /*json_object_get_string*/
+                (i != 21) && /*json_object_get_string*/
                 (i != 22) && /*json_object_get_string*/
-                (i != 23) && /*json_object_dotget_string*/
-                (i != 24) && /*json_object_dotget_string*/
+                (i != 23) && /*json_object_get_string*/
+                (i != 24) && /*json_object_get_string*/
                 (i != 25) && /*json_object_get_string*/
                 (i != 26) && /*json_object_get_string*/
                 (i != 27) && /*json_object_get_string*/
-                (i != 28) && /*json_object_get_string*/
-                (i != 29) && /*json_object_get_string*/
-                (i != 30) && /*json_object_get_string*/
-                (i != 31) && /*json_object_get_string*/
-                (i != 32) && /*json_object_get_string*/
-                (i != 33) && /*json_object_get_string*/
-                (i != 34) && /*json_object_get_string*/
-                (i != 35) && /*json_object_get_string*/
-                (i != 36) && /*json_object_get_string*/
-                (i != 37) && /*json_object_get_string*/
-                (i != 51) && /*json_value_free*/
-                (i != 52) /*BUFFER_delete*/
+                (i != 41) && /*json_value_free*/
+                (i != 42) /*BUFFER_delete*/
                 )
             {
                 IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_GetDevice(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, TEST_DEVICE_ID, deviceInfo);
@@ -2275,9 +2286,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_101: [ IoTHubRegistryManager_UpdateDevice shall allocate memory for response buffer by calling BUFFER_new ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_043: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the created JSON ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_044: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the createdfollowing HTTP headers : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_105: [ IoTHubRegistryManager_UpdateDevice shall do clean up before return ] */
     TEST_FUNCTION(IoTHubRegistryManager_UpdateDevice_happy_path)
     {
@@ -2308,10 +2319,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2326,35 +2333,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_IFMATCH, TEST_HTTP_HEADER_VAL_IFMATCH))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -2379,9 +2370,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_101: [ IoTHubRegistryManager_UpdateDevice shall allocate memory for response buffer by calling BUFFER_new ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_043: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the created JSON ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_044: [ IoTHubRegistryManager_UpdateDevice shall create an HTTP PUT request using the createdfollowing HTTP headers : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling HTTPAPIEX_ExecuteRequest ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_045: [ IoTHubRegistryManager_UpdateDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_046: [ IoTHubRegistryManager_UpdateDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_047: [ IoTHubRegistryManager_UpdateDevice shall execute the HTTP PUT request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_105: [ IoTHubRegistryManager_UpdateDevice shall do clean up before return ] */
     TEST_FUNCTION(IoTHubRegistryManager_UpdateDevice_happy_path_with_thumbprint)
     {
@@ -2412,10 +2403,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2430,35 +2417,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_IFMATCH, TEST_HTTP_HEADER_VAL_IFMATCH))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -2520,10 +2491,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2538,35 +2505,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_IFMATCH, TEST_HTTP_HEADER_VAL_IFMATCH))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_PUT, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -2590,15 +2541,10 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
                 (i != 8) && /*json_free_serialized_string*/
                 (i != 9) && /*json_object_clear*/
                 (i != 10) && /*json_value_free*/
-                (i != 25) && /*HTTPHeaders_Free*/
-                (i != 26) && /*HTTPAPIEX_Destroy*/
-                (i != 27) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 28) && /*STRING_delete*/
-                (i != 29) && /*STRING_delete*/
-                (i != 30) && /*STRING_delete*/
-                (i != 31) && /*BUFFER_delete*/
-                (i != 32) && /*BUFFER_delete*/
-                (i != 33) /*gballoc_free*/
+                (i != 20) && /*HTTPHeaders_Free*/
+                (i != 21) && /*BUFFER_delete*/
+                (i != 22) && /*BUFFER_delete*/
+                (i != 23) /*gballoc_free*/
                 )
             {
                 printf("i is = %zu\n", i);
@@ -2641,17 +2587,14 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_053: [ IoTHubRegistryManager_DeleteDevice shall create HTTP DELETE request URL using the given deviceId using the following format : url / devices / [deviceId] ? api - version  ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_054: [ IoTHubRegistryManager_DeleteDevice shall add the following headers to the created HTTP GET request : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling HTTPAPIEX_ExecuteRequest ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_058: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_059: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is less or equal than 300 then return IOTHUB_REGISTRYMANAGER_OK ] */
     TEST_FUNCTION(IoTHubRegistryManager_DeleteDevice_happy_path)
     {
         ///arrange
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
@@ -2667,35 +2610,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_IFMATCH, TEST_HTTP_HEADER_VAL_IFMATCH))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_DELETE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_DELETE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         ///act
         IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_DeleteDevice(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, TEST_DEVICE_ID);
@@ -2707,9 +2634,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_053: [ IoTHubRegistryManager_DeleteDevice shall create HTTP DELETE request URL using the given deviceId using the following format : url / devices / [deviceId] ? api - version  ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_054: [ IoTHubRegistryManager_DeleteDevice shall add the following headers to the created HTTP GET request : authorization = sasToken, Request - Id = 1001, Accept = application / json, Content - Type = application / json, charset = utf - 8 ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ] */
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling HTTPAPIEX_ExecuteRequest ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_055: [ IoTHubRegistryManager_DeleteDevice shall authorize the request with the SAS token cached by the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_056: [ IoTHubRegistryManager_DeleteDevice shall execute the request on a session of the HTTP session pool of the service client ] */
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_057: [ IoTHubRegistryManager_DeleteDevice shall execute the HTTP DELETE request by calling IoTHubServiceClientHttpSession_ExecuteRequest ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_058: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ] */
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_059: [ IoTHubRegistryManager_DeleteDevice shall verify the received HTTP status code and if it is less or equal than 300 then return IOTHUB_REGISTRYMANAGER_OK ] */
     TEST_FUNCTION(IoTHubRegistryManager_DeleteDevice_non_happy_path)
@@ -2718,10 +2645,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         int umockc_result = umock_c_negative_tests_init();
         ASSERT_ARE_EQUAL(int, 0, umockc_result);
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2736,35 +2659,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_IFMATCH, TEST_HTTP_HEADER_VAL_IFMATCH))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_DELETE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_DELETE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         umock_c_negative_tests_snapshot();
 
@@ -2777,12 +2684,7 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
             /// act
             if (
-                (i != 13) && /*HTTPHeaders_Free*/
-                (i != 14) && /*HTTPAPIEX_Destroy*/
-                (i != 15) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 16) && /*STRING_delete*/
-                (i != 17) && /*STRING_delete*/
-                (i != 18) /*STRING_delete*/
+                (i != 8) && /*HTTPHeaders_Free*/
                 )
             {
                 IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_DeleteDevice(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, TEST_DEVICE_ID);
@@ -2864,9 +2766,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_062: [ IoTHubRegistryManager_GetDeviceList shall create HTTP GET request for numberOfDevices using the follwoing format: url/devices/?top=[numberOfDevices]&api-version ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_063: [ IoTHubRegistryManager_GetDeviceList shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_064: [ IoTHubRegistryManager_GetDeviceList shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_065: [ IoTHubRegistryManager_GetDeviceList shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_066: [ IoTHubRegistryManager_GetDeviceList shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_064: [ IoTHubRegistryManager_GetDeviceList shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_065: [ IoTHubRegistryManager_GetDeviceList shall execute the request on a session of the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_066: [ IoTHubRegistryManager_GetDeviceList shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_067: [ IoTHubRegistryManager_GetDeviceList shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_ERROR ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_068: [ IoTHubRegistryManager_GetDeviceList shall verify the received HTTP status code and if it is less or equal than 300 then try to parse the response JSON to deviceList ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_069: [ IoTHubRegistryManager_GetDeviceList shall use the following parson APIs to parse the response JSON: json_parse_string, json_value_get_object, json_object_get_string, json_object_dotget_string  ]*/
@@ -2886,10 +2788,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -2902,35 +2800,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -3082,10 +2964,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -3098,35 +2976,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -3183,7 +3045,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(json_object_dotget_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_SECONDARY_THUMBPRINT))
             .SetReturn(TEST_SECONDARYKEY);
 
-
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
         STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -3272,7 +3133,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         }
     }
 
-
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_110: [ If the BUFFER_new fails, IoTHubRegistryManager_GetDeviceList shall do clean up and return NULL ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_070: [ If any of the parson API fails, IoTHubRegistryManager_GetDeviceList shall return IOTHUB_REGISTRYMANAGER_JSON_ERROR ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_072: [ If populating the deviceList parameter fails IoTHubRegistryManager_GetDeviceList shall return IOTHUB_REGISTRYMANAGER_ERROR ]*/
@@ -3285,10 +3145,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -3301,35 +3157,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -3437,31 +3277,26 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
             /// act
             if (
-                (i != 13) && /*HTTPHeaders_Free*/
-                (i != 14) && /*HTTPAPIEX_Destroy*/
-                (i != 15) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 16) && /*STRING_delete*/
-                (i != 17) && /*STRING_delete*/
-                (i != 18) && /*STRING_delete*/
-                (i != 22) && /*json_array_get_count*/
+                (i != 8) && /*HTTPHeaders_Free*/
+                (i != 12) && /*json_array_get_count*/
+                (i != 15) && /*json_object_get_string*/
+                (i != 16) && /*json_object_dotget_string*/
+                (i != 17) && /*json_object_dotget_string*/
+                (i != 18) && /*json_object_get_string*/
+                (i != 19) && /*json_object_get_string*/
+                (i != 20) && /*json_object_get_string*/
+                (i != 21) && /*json_object_get_string*/
+                (i != 22) && /*json_object_get_string*/
+                (i != 23) && /*json_object_get_string*/
+                (i != 24) && /*json_object_get_string*/
                 (i != 25) && /*json_object_get_string*/
-                (i != 26) && /*json_object_dotget_string*/
-                (i != 27) && /*json_object_dotget_string*/
+                (i != 26) && /*json_object_get_string*/
+                (i != 27) && /*json_object_get_string*/
                 (i != 28) && /*json_object_get_string*/
                 (i != 29) && /*json_object_get_string*/
                 (i != 30) && /*json_object_get_string*/
-                (i != 31) && /*json_object_get_string*/
-                (i != 32) && /*json_object_get_string*/
-                (i != 33) && /*json_object_get_string*/
-                (i != 34) && /*json_object_get_string*/
-                (i != 35) && /*json_object_get_string*/
-                (i != 36) && /*json_object_get_string*/
-                (i != 37) && /*json_object_get_string*/
-                (i != 38) && /*json_object_get_string*/
-                (i != 39) && /*json_object_get_string*/
-                (i != 40) && /*json_object_get_string*/
-                (i != 56) && /*json_value_free*/
-                (i != 57) /*BUFFER_delete*/
+                (i != 46) && /*json_value_free*/
+                (i != 47) /*BUFFER_delete*/
                 )
             {
                 IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_GetDeviceList(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 10, deviceList);
@@ -3508,7 +3343,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
                 singlylinkedlist_destroy(deviceList);
             }
 
-
             //if (deviceList != NULL)
             //{
             //    LIST_INSTANCE* list_instance = (LIST_INSTANCE*)deviceList;
@@ -3594,9 +3428,9 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_112: [ IoTHubRegistryManager_GetStatistics shall allocate memory for response buffer by calling BUFFER_new ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_075: [ IoTHubRegistryManager_GetStatistics shall create HTTP GET request for statistics using the following format: url/statistics/devices?api-version ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_076: [ IoTHubRegistryManager_GetStatistics shall add the following headers to the created HTTP GET request: authorization=sasToken,Request-Id=1001,Accept=application/json,Content-Type=application/json,charset=utf-8 ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_077: [ IoTHubRegistryManager_GetStatistics shall create an HTTPAPIEX_SAS_HANDLE handle by calling HTTPAPIEX_SAS_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_078: [ IoTHubRegistryManager_GetStatistics shall create an HTTPAPIEX_HANDLE handle by calling HTTPAPIEX_Create ]*/
-    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_079: [ IoTHubRegistryManager_GetStatistics shall execute the HTTP GET request by calling HTTPAPIEX_ExecuteRequest ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_077: [ IoTHubRegistryManager_GetStatistics shall authorize the request with the SAS token cached by the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_078: [ IoTHubRegistryManager_GetStatistics shall execute the request on a session of the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_079: [ IoTHubRegistryManager_GetStatistics shall execute the HTTP GET request by calling IoTHubServiceClientHttpSession_ExecuteRequest ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_080: [ IoTHubRegistryManager_GetStatistics shall verify the received HTTP status code and if it is greater than 300 then return IOTHUB_REGISTRYMANAGER_ERROR ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_081: [ IoTHubRegistryManager_GetStatistics shall verify the received HTTP status code and if it is less or equal than 300 then use the following parson APIs to parse the response JSON to registry statistics structure: json_parse_string, json_value_get_object, json_object_get_string, json_object_dotget_string ]*/
     /* Tests_SRS_IOTHUBREGISTRYMANAGER_12_083: [ IoTHubRegistryManager_GetStatistics shall save the registry statistics to the out value and return IOTHUB_REGISTRYMANAGER_OK ]*/
@@ -3606,10 +3440,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         ///arrange
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -3622,35 +3452,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -3696,10 +3510,6 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
         STRICT_EXPECTED_CALL(BUFFER_new());
 
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
-        STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
-
         STRICT_EXPECTED_CALL(HTTPHeaders_Alloc());
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_HTTP_HEADER_VAL_AUTHORIZATION))
             .IgnoreArgument(1);
@@ -3712,35 +3522,19 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair(IGNORED_PTR_ARG, TEST_HTTP_HEADER_KEY_CONTENT_TYPE, TEST_HTTP_HEADER_VAL_CONTENT_TYPE))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
-
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_ExecuteRequest(IGNORED_PTR_ARG, IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(IoTHubServiceClientHttpSession_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .IgnoreArgument(2)
+            .IgnoreArgument(3)
             .IgnoreArgument(4)
             .IgnoreArgument(5)
             .IgnoreArgument(6)
             .IgnoreArgument(7)
             .IgnoreArgument(8)
-            .IgnoreArgument(9)
             .CopyOutArgumentBuffer_statusCode(&httpStatusCodeOk, sizeof(httpStatusCodeOk))
             .SetReturn(HTTPAPIEX_OK);
 
         STRICT_EXPECTED_CALL(HTTPHeaders_Free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(HTTPAPIEX_SAS_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
@@ -3776,17 +3570,12 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
 
             /// act
             if (
-                (i != 13) && /*HTTPHeaders_Free*/
-                (i != 14) && /*HTTPAPIEX_Destroy*/
-                (i != 15) && /*HTTPAPIEX_SAS_Destroy*/
-                (i != 16) && /*STRING_delete*/
-                (i != 17) && /*STRING_delete*/
-                (i != 18) && /*STRING_delete*/
-                (i != 22) && /*json_object_get_number*/
-                (i != 23) && /*json_object_get_number*/
-                (i != 24) && /*json_object_get_number*/
-                (i != 26) && /*json_value_free*/
-                (i != 27) /*BUFFER_delete*/
+                (i != 8) && /*HTTPHeaders_Free*/
+                (i != 12) && /*json_object_get_number*/
+                (i != 13) && /*json_object_get_number*/
+                (i != 14) && /*json_object_get_number*/
+                (i != 16) && /*json_value_free*/
+                (i != 17) /*BUFFER_delete*/
                 )
             {
                 IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_GetStatistics(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_STATISTICS);
@@ -3801,5 +3590,506 @@ BEGIN_TEST_SUITE(iothub_registrymanager_ut)
         }
         umock_c_negative_tests_deinit();
     }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_004: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall verify the input parameters and if any of them are NULL or deviceCount is 0 then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_registryManagerHandle_is_NULL)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(NULL, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_004: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall verify the input parameters and if any of them are NULL or deviceCount is 0 then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_devices_is_NULL)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, NULL, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_004: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall verify the input parameters and if any of them are NULL or deviceCount is 0 then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_deviceResults_is_NULL)
+    {
+        ///arrange
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_004: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall verify the input parameters and if any of them are NULL or deviceCount is 0 then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkDelete_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_deviceCount_is_zero)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkDelete(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 0, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_005: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_INVALID_ARG without sending any request if the deviceId of any device is NULL or contains space(s), or, for IoTHubRegistryManager_BulkCreateOrUpdate, if its authMethod is not "IOTHUB_REGISTRYMANAGER_AUTH_SPK" or "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_a_deviceId_contains_space)
+    {
+        ///arrange
+        IOTHUB_REGISTRY_DEVICE_CREATE devices[2];
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[2];
+        devices[0] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1].deviceId = "aaa bbb";
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, devices, 2, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_005: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_INVALID_ARG without sending any request if the deviceId of any device is NULL or contains space(s), or, for IoTHubRegistryManager_BulkCreateOrUpdate, if its authMethod is not "IOTHUB_REGISTRYMANAGER_AUTH_SPK" or "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_an_authMethod_is_invalid)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+        TEST_IOTHUB_REGISTRY_DEVICE_CREATE.authMethod = (IOTHUB_REGISTRYMANAGER_AUTH_METHOD)12345;
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_005: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_INVALID_ARG without sending any request if the deviceId of any device is NULL or contains space(s), or, for IoTHubRegistryManager_BulkCreateOrUpdate, if its authMethod is not "IOTHUB_REGISTRYMANAGER_AUTH_SPK" or "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkDelete_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_a_deviceId_is_NULL)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+        TEST_IOTHUB_REGISTRY_DEVICE_CREATE.deviceId = NULL;
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkDelete(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_007: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall create a JSON array for every chunk, with one object per device holding "id" and "importMode", using the following parson APIs: json_value_init_array, json_value_get_array, json_value_init_object, json_value_get_object, json_object_set_string, json_object_dotset_string, json_array_append_value ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_014: [ IoTHubRegistryManager_BulkCreateOrUpdate shall set the keys of every device whose primaryKey or secondaryKey is not NULL in the same way as IoTHubRegistryManager_CreateDevice, depending on its authMethod ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_008: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall send every chunk in an HTTP POST request to url/devices?api-version by calling IoTHubServiceClientHttpSession_ExecuteRequest, one chunk after the other on the keep-alive sessions of the HTTP session pool of the service client ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_009: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of a chunk to the result of its request: IOTHUB_REGISTRYMANAGER_JSON_ERROR if the JSON creation fails, IOTHUB_REGISTRYMANAGER_ERROR if BUFFER_new fails, IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR if the HTTP request fails, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR if the HTTP status code is greater than 300 and IOTHUB_REGISTRYMANAGER_OK otherwise ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_012: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_OK if every device succeeded, otherwise the result of the first device that failed ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_013: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall do clean up before return ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_happy_path)
+    {
+        ///arrange
+        IOTHUB_REGISTRY_DEVICE_CREATE devices[2];
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[2] = { IOTHUB_REGISTRYMANAGER_ERROR, IOTHUB_REGISTRYMANAGER_ERROR };
+        devices[0] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1].deviceId = TEST_SECOND_DEVICE_ID;
+        devices[1].primaryKey = NULL;
+        devices[1].secondaryKey = NULL;
+
+        setup_bulk_chunk_expected_calls(devices, 2, TEST_IMPORT_MODE_CREATE_OR_UPDATE, &httpStatusCodeOk, 0);
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, devices, 2, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[0]);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[1]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_005: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_INVALID_ARG without sending any request if the deviceId of any device is NULL or contains space(s), or, for IoTHubRegistryManager_BulkCreateOrUpdate, if its authMethod is not "IOTHUB_REGISTRYMANAGER_AUTH_SPK" or "IOTHUB_REGISTRYMANAGER_AUTH_X509_THUMBPRINT" ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_007: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall create a JSON array for every chunk, with one object per device holding "id" and "importMode", using the following parson APIs: json_value_init_array, json_value_get_array, json_value_init_object, json_value_get_object, json_object_set_string, json_object_dotset_string, json_array_append_value ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkDelete_happy_path)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1] = { IOTHUB_REGISTRYMANAGER_ERROR };
+        TEST_IOTHUB_REGISTRY_DEVICE_CREATE.authMethod = (IOTHUB_REGISTRYMANAGER_AUTH_METHOD)12345;
+
+        setup_bulk_chunk_expected_calls(&TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, TEST_IMPORT_MODE_DELETE, &httpStatusCodeOk, 0);
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkDelete(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[0]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_006: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall split the devices array into chunks of at most 100 devices ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_011: [ If a chunk fails IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall continue with the next chunk ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_012: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_OK if every device succeeded, otherwise the result of the first device that failed ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkDelete_sends_101_devices_in_2_chunks_and_continues_after_a_failed_chunk)
+    {
+        ///arrange
+        IOTHUB_REGISTRY_DEVICE_CREATE devices[101];
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[101];
+        for (size_t i = 0; i < 101; i++)
+        {
+            devices[i] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        }
+
+        setup_bulk_chunk_expected_calls(devices, 100, TEST_IMPORT_MODE_DELETE, &httpStatusCodeBadRequest, TEST_RESPONSE_LENGTH);
+        STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_UNSIGNED_CHAR_PTR);
+        STRICT_EXPECTED_CALL(json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(NULL);
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        setup_bulk_chunk_expected_calls(&devices[100], 1, TEST_IMPORT_MODE_DELETE, &httpStatusCodeOk, 0);
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkDelete(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, devices, 101, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR, deviceResults[0]);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR, deviceResults[99]);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[100]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_010: [ If the response of a chunk carries an "errors" array in its JSON, whatever its HTTP status code, IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of the chunk to IOTHUB_REGISTRYMANAGER_OK, then set the result of every device named by "deviceId" in the array to IOTHUB_REGISTRYMANAGER_DEVICE_EXIST if its "errorCode" is "DeviceAlreadyExists", IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST if it is "DeviceNotFound" and IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR otherwise ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_012: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_OK if every device succeeded, otherwise the result of the first device that failed ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_reports_the_result_of_every_device_of_a_rejected_chunk)
+    {
+        ///arrange
+        IOTHUB_REGISTRY_DEVICE_CREATE devices[2];
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[2];
+        devices[0] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1].deviceId = TEST_SECOND_DEVICE_ID;
+
+        setup_bulk_chunk_expected_calls(devices, 2, TEST_IMPORT_MODE_CREATE_OR_UPDATE, &httpStatusCodeBadRequest, TEST_RESPONSE_LENGTH);
+        STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_UNSIGNED_CHAR_PTR);
+        STRICT_EXPECTED_CALL(json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_JSON_VALUE);
+        STRICT_EXPECTED_CALL(json_value_get_object(TEST_JSON_VALUE));
+        STRICT_EXPECTED_CALL(json_object_get_array(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_ERRORS));
+        STRICT_EXPECTED_CALL(json_array_get_count(TEST_JSON_ARRAY))
+            .SetReturn(1);
+        STRICT_EXPECTED_CALL(json_array_get_object(TEST_JSON_ARRAY, 0));
+        STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_NAME))
+            .SetReturn(TEST_SECOND_DEVICE_ID);
+        STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_ERROR_CODE))
+            .SetReturn(TEST_BULK_ERROR_CODE_DEVICE_ALREADY_EXISTS);
+        STRICT_EXPECTED_CALL(json_value_free(TEST_JSON_VALUE));
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, devices, 2, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_DEVICE_EXIST, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[0]);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_DEVICE_EXIST, deviceResults[1]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_010: [ If the response of a chunk carries an "errors" array in its JSON, whatever its HTTP status code, IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of the chunk to IOTHUB_REGISTRYMANAGER_OK, then set the result of every device named by "deviceId" in the array to IOTHUB_REGISTRYMANAGER_DEVICE_EXIST if its "errorCode" is "DeviceAlreadyExists", IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST if it is "DeviceNotFound" and IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR otherwise ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_012: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall return IOTHUB_REGISTRYMANAGER_OK if every device succeeded, otherwise the result of the first device that failed ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkDelete_reports_the_errors_of_a_chunk_accepted_with_status_200)
+    {
+        ///arrange
+        IOTHUB_REGISTRY_DEVICE_CREATE devices[2];
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[2];
+        devices[0] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1] = TEST_IOTHUB_REGISTRY_DEVICE_CREATE;
+        devices[1].deviceId = TEST_SECOND_DEVICE_ID;
+
+        setup_bulk_chunk_expected_calls(devices, 2, TEST_IMPORT_MODE_DELETE, &httpStatusCodeOk, TEST_RESPONSE_LENGTH);
+        STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_UNSIGNED_CHAR_PTR);
+        STRICT_EXPECTED_CALL(json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_JSON_VALUE);
+        STRICT_EXPECTED_CALL(json_value_get_object(TEST_JSON_VALUE));
+        STRICT_EXPECTED_CALL(json_object_get_array(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_ERRORS));
+        STRICT_EXPECTED_CALL(json_array_get_count(TEST_JSON_ARRAY))
+            .SetReturn(1);
+        STRICT_EXPECTED_CALL(json_array_get_object(TEST_JSON_ARRAY, 0));
+        STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_DEVICE_NAME))
+            .SetReturn(TEST_SECOND_DEVICE_ID);
+        STRICT_EXPECTED_CALL(json_object_get_string(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_ERROR_CODE))
+            .SetReturn(TEST_BULK_ERROR_CODE_DEVICE_NOT_FOUND);
+        STRICT_EXPECTED_CALL(json_value_free(TEST_JSON_VALUE));
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkDelete(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, devices, 2, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, deviceResults[0]);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_DEVICE_NOT_EXIST, deviceResults[1]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_027: [ If the response of a chunk has no error in its "errors" array but its "isSuccessful" is false, IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of the chunk to IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_fails_a_chunk_accepted_with_status_200_that_is_not_successful)
+    {
+        ///arrange
+        IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+
+        setup_bulk_chunk_expected_calls(&TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, TEST_IMPORT_MODE_CREATE_OR_UPDATE, &httpStatusCodeOk, TEST_RESPONSE_LENGTH);
+        STRICT_EXPECTED_CALL(BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_UNSIGNED_CHAR_PTR);
+        STRICT_EXPECTED_CALL(json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(TEST_JSON_VALUE);
+        STRICT_EXPECTED_CALL(json_value_get_object(TEST_JSON_VALUE));
+        STRICT_EXPECTED_CALL(json_object_get_array(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_ERRORS));
+        STRICT_EXPECTED_CALL(json_array_get_count(TEST_JSON_ARRAY))
+            .SetReturn(0);
+        STRICT_EXPECTED_CALL(json_object_get_boolean(TEST_JSON_OBJECT, TEST_DEVICE_JSON_KEY_BULK_IS_SUCCESSFUL))
+            .SetReturn(0);
+        STRICT_EXPECTED_CALL(json_value_free(TEST_JSON_VALUE));
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR, result);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR, deviceResults[0]);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_009: [ IoTHubRegistryManager_BulkCreateOrUpdate and IoTHubRegistryManager_BulkDelete shall set the result of every device of a chunk to the result of its request: IOTHUB_REGISTRYMANAGER_JSON_ERROR if the JSON creation fails, IOTHUB_REGISTRYMANAGER_ERROR if BUFFER_new fails, IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR if the HTTP request fails, IOTHUB_REGISTRYMANAGER_HTTP_STATUS_ERROR if the HTTP status code is greater than 300 and IOTHUB_REGISTRYMANAGER_OK otherwise ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_BulkCreateOrUpdate_non_happy_path)
+    {
+        ///arrange
+        int umockc_result = umock_c_negative_tests_init();
+        ASSERT_ARE_EQUAL(int, 0, umockc_result);
+
+        setup_bulk_chunk_expected_calls(&TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, TEST_IMPORT_MODE_CREATE_OR_UPDATE, &httpStatusCodeOk, 0);
+        setup_bulk_chunk_cleanup_expected_calls();
+
+        umock_c_negative_tests_snapshot();
+
+        ///act
+        for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+        {
+            /// arrange
+            IOTHUB_REGISTRYMANAGER_RESULT deviceResults[1];
+            umock_c_negative_tests_reset();
+            umock_c_negative_tests_fail_call(i);
+
+            /// act
+            if (
+                (i != 11) && /*json_free_serialized_string*/
+                (i != 12) && /*json_value_free*/
+                (i != 21) && /*HTTPHeaders_Free*/
+                (i != 22) && /*BUFFER_length*/
+                (i != 23) && /*BUFFER_delete*/
+                (i != 24) /*BUFFER_delete*/
+                )
+            {
+                IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_BulkCreateOrUpdate(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, &TEST_IOTHUB_REGISTRY_DEVICE_CREATE, 1, deviceResults);
+
+                /// assert
+                ASSERT_ARE_NOT_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+                ASSERT_ARE_EQUAL(int, result, deviceResults[0]);
+            }
+
+            ///cleanup
+        }
+        umock_c_negative_tests_deinit();
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_015: [ IoTHubRegistryManager_EnumerateDevices shall verify the registryManagerHandle input parameter and if it is NULL, or if pageSize is not between 1 and 1000, then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_registryManagerHandle_is_NULL)
+    {
+        ///arrange
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(NULL, 100, test_device_enumeration_callback, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_015: [ IoTHubRegistryManager_EnumerateDevices shall verify the registryManagerHandle input parameter and if it is NULL, or if pageSize is not between 1 and 1000, then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_pageSize_is_zero)
+    {
+        ///arrange
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 0, test_device_enumeration_callback, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_015: [ IoTHubRegistryManager_EnumerateDevices shall verify the registryManagerHandle input parameter and if it is NULL, or if pageSize is not between 1 and 1000, then return IOTHUB_REGISTRYMANAGER_INVALID_ARG ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_return_IOTHUB_REGISTRYMANAGER_INVALID_ARG_if_input_parameter_pageSize_is_1001)
+    {
+        ///arrange
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 1001, test_device_enumeration_callback, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_016: [ If deviceCallback is NULL IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_CALLBACK_NOT_SET ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_return_IOTHUB_REGISTRYMANAGER_CALLBACK_NOT_SET_if_deviceCallback_is_NULL)
+    {
+        ///arrange
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 100, NULL, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_CALLBACK_NOT_SET, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_017: [ IoTHubRegistryManager_EnumerateDevices shall request the devices one page at a time with an HTTP POST request of the query "SELECT * FROM devices" to url/devices/query?api-version, with the headers of IoTHubRegistryManager_GetDeviceList plus "x-ms-max-item-count" set to pageSize and, from the second page on, "x-ms-continuation" set to the continuation token of the previous page ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_020: [ IoTHubRegistryManager_EnumerateDevices shall parse every page with the following parson APIs: json_parse_string, json_value_get_array, json_array_get_count, json_array_get_object, json_object_get_string, json_object_dotget_string, json_object_get_number, and free it with json_value_free before requesting the next page ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_022: [ IoTHubRegistryManager_EnumerateDevices shall reuse one IOTHUB_DEVICE structure for all the devices, pointing its string fields into the parsed page, and pass it to deviceCallback, so the structure and its strings are only valid during the callback ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_023: [ IoTHubRegistryManager_EnumerateDevices shall populate deviceId, eTag (from "deviceEtag"), connectionState, connectionStateUpdatedTime, status, statusReason, statusUpdatedTime, lastActivityTime and cloudToDeviceMessageCount from the device twin returned by the query, set authMethod from "authenticationType" and primaryKey and secondaryKey from "x509Thumbprint", and leave the other fields NULL, false or 0 ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_025: [ IoTHubRegistryManager_EnumerateDevices shall request the next page as long as the response has a non-empty "x-ms-continuation" header, and return IOTHUB_REGISTRYMANAGER_OK after the last page ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_026: [ IoTHubRegistryManager_EnumerateDevices shall do clean up before return ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_happy_path_follows_the_continuation_token)
+    {
+        ///arrange
+        STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        setup_enumerate_devices_page_expected_calls(false, TEST_CONTINUATION_TOKEN);
+        setup_enumerate_devices_page_expected_calls(true, NULL);
+        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 100, test_device_enumeration_callback, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+        ASSERT_ARE_EQUAL(size_t, 2, g_enumerated_device_count);
+        ASSERT_ARE_EQUAL(int, IOTHUB_DEVICE_STATUS_ENABLED, g_enumerated_device_status);
+        ASSERT_ARE_EQUAL(int, IOTHUB_DEVICE_CONNECTION_STATE_CONNECTED, g_enumerated_device_connection_state);
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_AUTH_SPK, g_enumerated_device_auth_method);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_024: [ If deviceCallback returns a non-zero value IoTHubRegistryManager_EnumerateDevices shall stop the enumeration and return IOTHUB_REGISTRYMANAGER_OK ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_stops_when_the_callback_returns_non_zero)
+    {
+        ///arrange
+        g_enumeration_callback_result = 1;
+
+        STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        setup_enumerate_devices_page_expected_calls(false, TEST_CONTINUATION_TOKEN);
+        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 100, test_device_enumeration_callback, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+        ASSERT_ARE_EQUAL(size_t, 1, g_enumerated_device_count);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_018: [ If any of the HTTPAPI call fails IoTHubRegistryManager_EnumerateDevices shall fail and return IOTHUB_REGISTRYMANAGER_HTTPAPI_ERROR ]*/
+    /* Tests_SRS_IOTHUBREGISTRYMANAGER_41_021: [ If any of the parson API fails, IoTHubRegistryManager_EnumerateDevices shall return IOTHUB_REGISTRYMANAGER_JSON_ERROR ]*/
+    TEST_FUNCTION(IoTHubRegistryManager_EnumerateDevices_non_happy_path)
+    {
+        ///arrange
+        int umockc_result = umock_c_negative_tests_init();
+        ASSERT_ARE_EQUAL(int, 0, umockc_result);
+
+        STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        setup_enumerate_devices_page_expected_calls(false, NULL);
+        STRICT_EXPECTED_CALL(BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        umock_c_negative_tests_snapshot();
+
+        ///act
+        for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+        {
+            /// arrange
+            umock_c_negative_tests_reset();
+            umock_c_negative_tests_fail_call(i);
+
+            /// act
+            if (
+                (i != 11) && /*HTTPHeaders_Free*/
+                (i != 15) && /*json_array_get_count*/
+                (i != 17) && /*json_object_get_string*/
+                (i != 18) && /*json_object_get_string*/
+                (i != 19) && /*json_object_get_string*/
+                (i != 20) && /*json_object_get_string*/
+                (i != 21) && /*json_object_get_string*/
+                (i != 22) && /*json_object_get_string*/
+                (i != 23) && /*json_object_get_string*/
+                (i != 24) && /*json_object_get_string*/
+                (i != 25) && /*json_object_get_string*/
+                (i != 26) && /*json_object_get_number*/
+                (i != 27) && /*json_value_free*/
+                (i != 28) && /*HTTPHeaders_FindHeaderValue*/
+                (i != 29) && /*BUFFER_delete*/
+                (i != 30) && /*HTTPHeaders_Free*/
+                (i != 31) /*BUFFER_delete*/
+                )
+            {
+                IOTHUB_REGISTRYMANAGER_RESULT result = IoTHubRegistryManager_EnumerateDevices(TEST_IOTHUB_REGISTRYMANAGER_HANDLE, 100, test_device_enumeration_callback, NULL);
+
+                /// assert
+                ASSERT_ARE_NOT_EQUAL(int, IOTHUB_REGISTRYMANAGER_OK, result);
+            }
+
+            ///cleanup
+        }
+        umock_c_negative_tests_deinit();
+    }
 #endif
     END_TEST_SUITE(iothub_registrymanager_ut)
@@ -16,6 +16,7 @@
 #include "azure_c_shared_utility/connection_string_parser.h"
 
 #include "iothub_service_client_auth.h"
+#include "iothub_service_client_http_session.h"
 
 extern "C" int gballoc_init(void);
 extern "C" void gballoc_deinit(void);
@@ -56,6 +57,8 @@ static STRING_TOKENIZER_HANDLE TEST_STRING_TOKENIZER_HANDLE_NULL = (STRING_TOKEN
 static STRING_HANDLE TEST_KEY_STRING_HANDLE = (STRING_HANDLE)0x4545;
 static STRING_HANDLE TEST_VALUE_STRING_HANDLE = (STRING_HANDLE)0x4646;
 
+static IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE TEST_HTTP_SESSION_POOL_HANDLE = (IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE)0x4747;
+
 static const char* TEST_CHAR_PTR = "TestString";
 static const char* TEST_CONNECTION_STRING = "HostName=aaa.bbb.net;SharedAccessKeyName=xxx;SharedAccessKey=yyy";
 static size_t currentmalloc_call;
@@ -129,6 +132,12 @@ public:
     /* Connection string parser mock */
     MOCK_STATIC_METHOD_1(, MAP_HANDLE, connectionstringparser_parse, STRING_HANDLE, connectionString)
     MOCK_METHOD_END(MAP_HANDLE, TEST_MAP_HANDLE);
+
+    /* HTTP session pool mocks */
+    MOCK_STATIC_METHOD_3(, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, IoTHubServiceClientHttpSession_CreatePool, const char*, hostname, const char*, sharedAccessKey, const char*, keyName)
+        MOCK_METHOD_END(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, TEST_HTTP_SESSION_POOL_HANDLE);
+    MOCK_STATIC_METHOD_1(, void, IoTHubServiceClientHttpSession_DestroyPool, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, sessionPoolHandle)
+        MOCK_VOID_METHOD_END();
 };
 
 DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubServiceClientAuthMocks, , int, mallocAndStrcpy_s, char**, destination, const char*, source);
@@ -152,6 +161,9 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubServiceClientAuthMocks, , void, STRING_TOKEN
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubServiceClientAuthMocks, , MAP_HANDLE, connectionstringparser_parse, STRING_HANDLE, connectionString);
 
+DECLARE_GLOBAL_MOCK_METHOD_3(CIoTHubServiceClientAuthMocks, , IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, IoTHubServiceClientHttpSession_CreatePool, const char*, hostname, const char*, sharedAccessKey, const char*, keyName);
+DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubServiceClientAuthMocks, , void, IoTHubServiceClientHttpSession_DestroyPool, IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE, sessionPoolHandle);
+
 BEGIN_TEST_SUITE(iothub_service_client_auth_ut)
 
 TEST_SUITE_INITIALIZE(TestClassInitialize)
@@ -1261,7 +1273,108 @@ TEST_FUNCTION(IoTHubServiceClientAuth_CreateFromConnectionString_do_clean_up_if_
     mocks.AssertActualAndExpectedCalls();
 }
 
+/* Tests_SRS_IOTHUBSERVICECLIENT_41_002: [** If the IoTHubServiceClientHttpSession_CreatePool fails, IoTHubServiceClientAuth_CreateFromConnectionString shall do clean up and return NULL. **] */
+TEST_FUNCTION(IoTHubServiceClientAuth_CreateFromConnectionString_do_clean_up_if_IoTHubServiceClientHttpSession_CreatePool_fails)
+{
+    // arrange
+    CIoTHubServiceClientAuthMocks mocks;
+
+    whenShallmalloc_fail = 0;
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_construct(TEST_CHAR_PTR));
+
+    STRICT_EXPECTED_CALL(mocks, connectionstringparser_parse(TEST_STRING_HANDLE))
+        .SetReturn(TEST_MAP_HANDLE);
+
+    STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(TEST_MAP_HANDLE, (const char*)"HostName"))
+        .SetReturn(TEST_CONST_CHAR_PTR);
+
+    STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(TEST_MAP_HANDLE, (const char*)"SharedAccessKeyName"))
+        .SetReturn(TEST_CONST_CHAR_PTR);
+
+    STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(TEST_MAP_HANDLE, (const char*)"SharedAccessKey"))
+        .SetReturn(TEST_CONST_CHAR_PTR);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_construct(TEST_CONST_CHAR_PTR));
+
+    STRICT_EXPECTED_CALL(mocks, STRING_TOKENIZER_create(TEST_STRING_HANDLE))
+        .SetReturn(TEST_STRING_TOKENIZER_HANDLE);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_new())
+        .SetReturn(TEST_STRING_HANDLE);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_new())
+        .SetReturn(TEST_STRING_HANDLE);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_TOKENIZER_get_next_token(TEST_STRING_TOKENIZER_HANDLE, TEST_STRING_HANDLE, "."))
+        .SetReturn(0);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_TOKENIZER_get_next_token(TEST_STRING_TOKENIZER_HANDLE, TEST_STRING_HANDLE, "0"))
+        .SetReturn(0);
+
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(0);
+
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(0);
+
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(0);
+
+    EXPECTED_CALL(mocks, STRING_c_str(TEST_STRING_HANDLE))
+        .SetReturn(TEST_CHAR_PTR);
+
+    EXPECTED_CALL(mocks, STRING_c_str(TEST_STRING_HANDLE))
+        .SetReturn(TEST_CHAR_PTR);
+
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(0);
+
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(0);
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubServiceClientHttpSession_CreatePool(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments()
+        .SetReturn((IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE)NULL);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, STRING_TOKENIZER_destroy(TEST_STRING_TOKENIZER_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, Map_Destroy(TEST_MAP_HANDLE));
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
+
+    // act
+    IOTHUB_SERVICE_CLIENT_AUTH_HANDLE result = IoTHubServiceClientAuth_CreateFromConnectionString(TEST_CHAR_PTR);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, NULL, result);
+
+    mocks.AssertActualAndExpectedCalls();
+}
+
 /* Tests_SRS_IOTHUBSERVICECLIENT_12_006: [** If the IOTHUB_SERVICE_CLIENT_AUTH has been populated IoTHubServiceClientAuth_CreateFromConnectionString shall return with a IOTHUB_SERVICE_CLIENT_AUTH_HANDLE to it **]*/
+/* Tests_SRS_IOTHUBSERVICECLIENT_41_001: [** IoTHubServiceClientAuth_CreateFromConnectionString shall create the pool of HTTP sessions shared by the Service client modules by calling IoTHubServiceClientHttpSession_CreatePool with hostName, sharedAccessKey and keyName. **] */
 TEST_FUNCTION(IoTHubServiceClientAuth_CreateFromConnectionString_succeed)
 {
     // arrange
@@ -1322,6 +1435,9 @@ TEST_FUNCTION(IoTHubServiceClientAuth_CreateFromConnectionString_succeed)
     
     EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .SetReturn(0);
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubServiceClientHttpSession_CreatePool(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     
     STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
     STRICT_EXPECTED_CALL(mocks, STRING_delete(TEST_STRING_HANDLE));
@@ -1357,6 +1473,7 @@ TEST_FUNCTION(IoTHubServiceClient_Destroy_return_if_input_parameter_serviceClien
 }
 
 /* Tests_SRS_IOTHUBSERVICECLIENT_12_008 : [** If the serviceClientHandle input parameter is not NULL IoTHubServiceClient_Destroy shall free the memory of it and return **] */
+/* Tests_SRS_IOTHUBSERVICECLIENT_41_003: [** IoTHubServiceClient_Destroy shall release its reference to the pool of HTTP sessions by calling IoTHubServiceClientHttpSession_DestroyPool. **]*/
 TEST_FUNCTION(IoTHubServiceClient_Destroy_do_clean_up_and_return_if_input_parameter_serviceClientHandle_is_not_NULL)
 {
     // arrange
@@ -1438,6 +1555,9 @@ TEST_FUNCTION(IoTHubServiceClient_Destroy_do_clean_up_and_return_if_input_parame
         .IgnoreAllArguments()
         .SetReturn(0);
 
+    STRICT_EXPECTED_CALL(mocks, IoTHubServiceClientHttpSession_CreatePool(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
     STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
@@ -1451,6 +1571,7 @@ TEST_FUNCTION(IoTHubServiceClient_Destroy_do_clean_up_and_return_if_input_parame
     STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
         .IgnoreAllArguments();
 
+    STRICT_EXPECTED_CALL(mocks, IoTHubServiceClientHttpSession_DestroyPool(TEST_HTTP_SESSION_POOL_HANDLE));
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
@@ -0,0 +1,760 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#else
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+static int my_mallocAndStrcpy_s(char** destination, const char* source)
+{
+    size_t l = strlen(source);
+    *destination = (char*)my_gballoc_malloc(l + 1);
+    strcpy(*destination, source);
+    return 0;
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umock_c_negative_tests.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_c.h"
+
+#define ENABLE_MOCKS
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/agenttime.h"
+#include "azure_c_shared_utility/sastoken.h"
+#include "azure_c_shared_utility/httpheaders.h"
+#include "azure_c_shared_utility/httpapiex.h"
+
+#undef ENABLE_MOCKS
+
+#include "iothub_service_client_http_session.h"
+
+TEST_DEFINE_ENUM_TYPE(HTTPAPIEX_RESULT, HTTPAPIEX_RESULT_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTPAPIEX_RESULT, HTTPAPIEX_RESULT_VALUES);
+TEST_DEFINE_ENUM_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT_VALUES);
+TEST_DEFINE_ENUM_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE_VALUES);
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#define TEST_INDEFINITE_TIME ((time_t)(-1))
+#define TEST_SAS_TOKEN_LIFETIME_SECS 3600
+#define TEST_SAS_TOKEN_RENEWAL_MARGIN_SECS 300
+
+static const char* TEST_HOSTNAME = "theHostName";
+static const char* TEST_SHAREDACCESSKEY = "theSharedAccessKey";
+static const char* TEST_SHAREDACCESSKEYNAME = "theSharedAccessKeyName";
+static const char* TEST_RELATIVE_PATH = "/devices/theDeviceId?api-version=2016-11-14";
+static const char* TEST_SAS_TOKEN = "SharedAccessSignature sr=theHostName&sig=theSignature&se=4600&skn=theSharedAccessKeyName";
+static const char* TEST_HTTP_HEADER_KEY_AUTHORIZATION = "Authorization";
+
+static LOCK_HANDLE TEST_LOCK_HANDLE = (LOCK_HANDLE)0x4242;
+static HTTP_HEADERS_HANDLE TEST_HTTP_HEADERS_HANDLE = (HTTP_HEADERS_HANDLE)0x4343;
+static BUFFER_HANDLE TEST_REQUEST_BUFFER_HANDLE = (BUFFER_HANDLE)0x4444;
+static BUFFER_HANDLE TEST_RESPONSE_BUFFER_HANDLE = (BUFFER_HANDLE)0x4545;
+
+static const time_t TEST_TIME = (time_t)1000;
+static const unsigned int httpStatusCodeOk = 200;
+static const unsigned int httpStatusCodeUnauthorized = 401;
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    (void)error_code;
+    ASSERT_FAIL("umock_c reported error");
+}
+
+static STRING_HANDLE my_STRING_construct(const char* psz)
+{
+    (void)psz;
+    return (STRING_HANDLE)my_gballoc_malloc(1);
+}
+
+static void my_STRING_delete(STRING_HANDLE handle)
+{
+    my_gballoc_free(handle);
+}
+
+static STRING_HANDLE my_SASToken_Create(STRING_HANDLE key, STRING_HANDLE scope, STRING_HANDLE keyName, size_t expiry)
+{
+    (void)key;
+    (void)scope;
+    (void)keyName;
+    (void)expiry;
+    return (STRING_HANDLE)my_gballoc_malloc(1);
+}
+
+static HTTPAPIEX_HANDLE my_HTTPAPIEX_Create(const char* hostName)
+{
+    (void)hostName;
+    return (HTTPAPIEX_HANDLE)my_gballoc_malloc(1);
+}
+
+static void my_HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
+{
+    my_gballoc_free(handle);
+}
+
+static double my_get_difftime(time_t stopTime, time_t startTime)
+{
+    return difftime(stopTime, startTime);
+}
+
+static IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE create_test_pool(void)
+{
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(TEST_HOSTNAME, TEST_SHAREDACCESSKEY, TEST_SHAREDACCESSKEYNAME);
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static void set_expected_calls_for_new_sas_token(time_t currentTime)
+{
+    STRICT_EXPECTED_CALL(get_time(NULL))
+        .SetReturn(currentTime);
+    STRICT_EXPECTED_CALL(get_difftime(currentTime, (time_t)0));
+    STRICT_EXPECTED_CALL(SASToken_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, (size_t)currentTime + TEST_SAS_TOKEN_LIFETIME_SECS))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2)
+        .IgnoreArgument(3);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+}
+
+static void set_expected_calls_for_cached_sas_token(time_t currentTime)
+{
+    STRICT_EXPECTED_CALL(get_time(NULL))
+        .SetReturn(currentTime);
+    STRICT_EXPECTED_CALL(get_difftime(currentTime, (time_t)0));
+}
+
+static void set_expected_calls_for_request(bool newSession, const unsigned int* statusCode)
+{
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(TEST_HTTP_HEADERS_HANDLE, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_SAS_TOKEN));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    if (newSession)
+    {
+        STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
+    }
+    STRICT_EXPECTED_CALL(HTTPAPIEX_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, TEST_RELATIVE_PATH, TEST_HTTP_HEADERS_HANDLE, TEST_REQUEST_BUFFER_HANDLE, IGNORED_PTR_ARG, NULL, TEST_RESPONSE_BUFFER_HANDLE))
+        .IgnoreArgument(1)
+        .IgnoreArgument(6)
+        .CopyOutArgumentBuffer(6, statusCode, sizeof(*statusCode));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+}
+
+static HTTPAPIEX_RESULT execute_test_request(IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPoolHandle, unsigned int* statusCode)
+{
+    return IoTHubServiceClientHttpSession_ExecuteRequest(sessionPoolHandle, HTTPAPI_REQUEST_GET, TEST_RELATIVE_PATH, TEST_HTTP_HEADERS_HANDLE, TEST_REQUEST_BUFFER_HANDLE, statusCode, NULL, TEST_RESPONSE_BUFFER_HANDLE);
+}
+
+BEGIN_TEST_SUITE(iothub_srv_client_http_session_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_c_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_TYPE(HTTPAPIEX_RESULT, HTTPAPIEX_RESULT);
+    REGISTER_TYPE(HTTP_HEADERS_RESULT, HTTP_HEADERS_RESULT);
+    REGISTER_TYPE(HTTPAPI_REQUEST_TYPE, HTTPAPI_REQUEST_TYPE);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(BUFFER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(STRING_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(time_t, long long);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+    REGISTER_GLOBAL_MOCK_HOOK(mallocAndStrcpy_s, my_mallocAndStrcpy_s);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(mallocAndStrcpy_s, 42);
+
+    REGISTER_GLOBAL_MOCK_HOOK(STRING_construct, my_STRING_construct);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(STRING_construct, NULL);
+
+    REGISTER_GLOBAL_MOCK_HOOK(STRING_delete, my_STRING_delete);
+
+    REGISTER_GLOBAL_MOCK_RETURN(STRING_c_str, TEST_SAS_TOKEN);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(STRING_c_str, NULL);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock_Init, NULL);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock, LOCK_ERROR);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Unlock, LOCK_ERROR);
+
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Deinit, LOCK_OK);
+
+    REGISTER_GLOBAL_MOCK_RETURN(get_time, TEST_TIME);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(get_time, TEST_INDEFINITE_TIME);
+
+    REGISTER_GLOBAL_MOCK_HOOK(get_difftime, my_get_difftime);
+
+    REGISTER_GLOBAL_MOCK_HOOK(SASToken_Create, my_SASToken_Create);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(SASToken_Create, NULL);
+
+    REGISTER_GLOBAL_MOCK_RETURN(HTTPHeaders_ReplaceHeaderNameValuePair, HTTP_HEADERS_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPHeaders_ReplaceHeaderNameValuePair, HTTP_HEADERS_ERROR);
+
+    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Create, my_HTTPAPIEX_Create);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_Create, NULL);
+
+    REGISTER_GLOBAL_MOCK_HOOK(HTTPAPIEX_Destroy, my_HTTPAPIEX_Destroy);
+
+    REGISTER_GLOBAL_MOCK_RETURN(HTTPAPIEX_ExecuteRequest, HTTPAPIEX_OK);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(HTTPAPIEX_ExecuteRequest, HTTPAPIEX_ERROR);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    umock_c_negative_tests_deinit();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_001: [ If any of the input parameters is NULL IoTHubServiceClientHttpSession_CreatePool shall return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_CreatePool_return_NULL_if_input_parameter_hostname_is_NULL)
+{
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(NULL, TEST_SHAREDACCESSKEY, TEST_SHAREDACCESSKEYNAME);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_001: [ If any of the input parameters is NULL IoTHubServiceClientHttpSession_CreatePool shall return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_CreatePool_return_NULL_if_input_parameter_sharedAccessKey_is_NULL)
+{
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(TEST_HOSTNAME, NULL, TEST_SHAREDACCESSKEYNAME);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_001: [ If any of the input parameters is NULL IoTHubServiceClientHttpSession_CreatePool shall return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_CreatePool_return_NULL_if_input_parameter_keyName_is_NULL)
+{
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(TEST_HOSTNAME, TEST_SHAREDACCESSKEY, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_002: [ IoTHubServiceClientHttpSession_CreatePool shall allocate memory for a new pool and copy hostname by calling mallocAndStrcpy_s. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_003: [ IoTHubServiceClientHttpSession_CreatePool shall create the STRING_HANDLEs of the URI resource (the host name), the shared access key and the key name used to create SAS tokens by calling STRING_construct. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_004: [ IoTHubServiceClientHttpSession_CreatePool shall create the lock of the pool by calling Lock_Init. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_006: [ Otherwise IoTHubServiceClientHttpSession_CreatePool shall return the pool holding one reference, no session and no SAS token. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_CreatePool_happy_path)
+{
+    ///arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, TEST_HOSTNAME))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
+    STRICT_EXPECTED_CALL(Lock_Init());
+
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(TEST_HOSTNAME, TEST_SHAREDACCESSKEY, TEST_SHAREDACCESSKEYNAME);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(result);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_005: [ If any of the calls fails IoTHubServiceClientHttpSession_CreatePool shall do clean up and return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_CreatePool_non_happy_path)
+{
+    ///arrange
+    int umockc_result = umock_c_negative_tests_init();
+    ASSERT_ARE_EQUAL(int, 0, umockc_result);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mallocAndStrcpy_s(IGNORED_PTR_ARG, TEST_HOSTNAME))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_HOSTNAME));
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEY));
+    STRICT_EXPECTED_CALL(STRING_construct(TEST_SHAREDACCESSKEYNAME));
+    STRICT_EXPECTED_CALL(Lock_Init());
+
+    umock_c_negative_tests_snapshot();
+
+    ///act
+    for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+    {
+        /// arrange
+        umock_c_negative_tests_reset();
+        umock_c_negative_tests_fail_call(i);
+
+        /// act
+        IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_CreatePool(TEST_HOSTNAME, TEST_SHAREDACCESSKEY, TEST_SHAREDACCESSKEYNAME);
+
+        /// assert
+        ASSERT_IS_NULL(result);
+    }
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_007: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_ClonePool shall return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ClonePool_return_NULL_if_input_parameter_sessionPoolHandle_is_NULL)
+{
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_ClonePool(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_007: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_ClonePool shall return NULL. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ClonePool_return_NULL_if_Lock_fails)
+{
+    ///arrange
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE))
+        .SetReturn(LOCK_ERROR);
+
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_ClonePool(sessionPool);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_008: [ IoTHubServiceClientHttpSession_ClonePool shall increment the reference count of the pool under its lock and return sessionPoolHandle. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_010: [ IoTHubServiceClientHttpSession_DestroyPool shall decrement the reference count of the pool under its lock. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ClonePool_keeps_the_pool_alive_until_the_last_reference_is_released)
+{
+    ///arrange
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+
+    ///act
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE result = IoTHubServiceClientHttpSession_ClonePool(sessionPool);
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(void_ptr, sessionPool, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(result);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_009: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_DestroyPool shall return. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_DestroyPool_return_if_input_parameter_sessionPoolHandle_is_NULL)
+{
+    ///act
+    IoTHubServiceClientHttpSession_DestroyPool(NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_009: [ If sessionPoolHandle is NULL or Lock fails IoTHubServiceClientHttpSession_DestroyPool shall return. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_DestroyPool_return_if_Lock_fails)
+{
+    ///arrange
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE))
+        .SetReturn(LOCK_ERROR);
+
+    ///act
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_010: [ IoTHubServiceClientHttpSession_DestroyPool shall decrement the reference count of the pool under its lock. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_011: [ When the reference count reaches 0 IoTHubServiceClientHttpSession_DestroyPool shall destroy the idle sessions by calling HTTPAPIEX_Destroy, delete the cached SAS token and the STRING_HANDLEs, deinit the lock and free the pool. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_DestroyPool_frees_the_pool_when_the_last_reference_is_released)
+{
+    ///arrange
+    unsigned int statusCode;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+    (void)execute_test_request(sessionPool, &statusCode);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(Lock_Deinit(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_012: [ If sessionPoolHandle, relativePath, requestHttpHeadersHandle or statusCode is NULL IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_return_HTTPAPIEX_INVALID_ARG_if_input_parameter_sessionPoolHandle_is_NULL)
+{
+    ///arrange
+    unsigned int statusCode;
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(NULL, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_012: [ If sessionPoolHandle, relativePath, requestHttpHeadersHandle or statusCode is NULL IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_return_HTTPAPIEX_INVALID_ARG_if_input_parameter_relativePath_is_NULL)
+{
+    ///arrange
+    unsigned int statusCode;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    ///act
+    HTTPAPIEX_RESULT result = IoTHubServiceClientHttpSession_ExecuteRequest(sessionPool, HTTPAPI_REQUEST_GET, NULL, TEST_HTTP_HEADERS_HANDLE, TEST_REQUEST_BUFFER_HANDLE, &statusCode, NULL, TEST_RESPONSE_BUFFER_HANDLE);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_012: [ If sessionPoolHandle, relativePath, requestHttpHeadersHandle or statusCode is NULL IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_return_HTTPAPIEX_INVALID_ARG_if_input_parameter_requestHttpHeadersHandle_is_NULL)
+{
+    ///arrange
+    unsigned int statusCode;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    ///act
+    HTTPAPIEX_RESULT result = IoTHubServiceClientHttpSession_ExecuteRequest(sessionPool, HTTPAPI_REQUEST_GET, TEST_RELATIVE_PATH, NULL, TEST_REQUEST_BUFFER_HANDLE, &statusCode, NULL, TEST_RESPONSE_BUFFER_HANDLE);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_012: [ If sessionPoolHandle, relativePath, requestHttpHeadersHandle or statusCode is NULL IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_return_HTTPAPIEX_INVALID_ARG_if_input_parameter_statusCode_is_NULL)
+{
+    ///arrange
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_013: [ If Lock fails IoTHubServiceClientHttpSession_ExecuteRequest shall return HTTPAPIEX_ERROR. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_return_HTTPAPIEX_ERROR_if_Lock_fails)
+{
+    ///arrange
+    unsigned int statusCode;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE))
+        .SetReturn(LOCK_ERROR);
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_014: [ If the pool has no SAS token, or the cached one expires in less than HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS seconds, IoTHubServiceClientHttpSession_ExecuteRequest shall create a new one valid for HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS seconds by calling SASToken_Create and cache it in place of the old one. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_015: [ IoTHubServiceClientHttpSession_ExecuteRequest shall set the Authorization header of requestHttpHeadersHandle to the cached SAS token by calling HTTPHeaders_ReplaceHeaderNameValuePair. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_017: [ IoTHubServiceClientHttpSession_ExecuteRequest shall take the most recently used idle session of the pool, if any, and unlock the pool before executing the request. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_018: [ If the pool has no idle session IoTHubServiceClientHttpSession_ExecuteRequest shall open a new one by calling HTTPAPIEX_Create with the host name, and return HTTPAPIEX_ERROR if it fails. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_019: [ IoTHubServiceClientHttpSession_ExecuteRequest shall execute the request on the session by calling HTTPAPIEX_ExecuteRequest and return its result. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_first_request_creates_the_SAS_token_and_the_session)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME);
+    set_expected_calls_for_request(true, &httpStatusCodeOk);
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(int, httpStatusCodeOk, statusCode);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_014: [ If the pool has no SAS token, or the cached one expires in less than HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS seconds, IoTHubServiceClientHttpSession_ExecuteRequest shall create a new one valid for HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS seconds by calling SASToken_Create and cache it in place of the old one. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_017: [ IoTHubServiceClientHttpSession_ExecuteRequest shall take the most recently used idle session of the pool, if any, and unlock the pool before executing the request. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_020: [ If HTTPAPIEX_ExecuteRequest succeeds and the pool has less than HTTP_SESSION_POOL_MAX_IDLE_SESSIONS idle sessions, IoTHubServiceClientHttpSession_ExecuteRequest shall return the session to the pool; otherwise it shall destroy the session by calling HTTPAPIEX_Destroy. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_next_request_reuses_the_SAS_token_and_the_session)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+    (void)execute_test_request(sessionPool, &statusCode);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_cached_sas_token(TEST_TIME + TEST_SAS_TOKEN_LIFETIME_SECS - TEST_SAS_TOKEN_RENEWAL_MARGIN_SECS - 1);
+    set_expected_calls_for_request(false, &httpStatusCodeOk);
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_014: [ If the pool has no SAS token, or the cached one expires in less than HTTP_SESSION_SAS_TOKEN_RENEWAL_MARGIN_SECS seconds, IoTHubServiceClientHttpSession_ExecuteRequest shall create a new one valid for HTTP_SESSION_SAS_TOKEN_LIFETIME_SECS seconds by calling SASToken_Create and cache it in place of the old one. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_renews_the_SAS_token_before_it_expires)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+    (void)execute_test_request(sessionPool, &statusCode);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME + TEST_SAS_TOKEN_LIFETIME_SECS - TEST_SAS_TOKEN_RENEWAL_MARGIN_SECS);
+    set_expected_calls_for_request(false, &httpStatusCodeOk);
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_021: [ If the status code of the response is 401 IoTHubServiceClientHttpSession_ExecuteRequest shall mark the cached SAS token as expired, so the next request creates a new one. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_renews_the_SAS_token_after_an_unauthorized_response)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME);
+    set_expected_calls_for_request(true, &httpStatusCodeUnauthorized);
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME);
+    set_expected_calls_for_request(false, &httpStatusCodeOk);
+
+    ///act
+    HTTPAPIEX_RESULT result1 = execute_test_request(sessionPool, &statusCode);
+    HTTPAPIEX_RESULT result2 = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result1);
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_019: [ IoTHubServiceClientHttpSession_ExecuteRequest shall execute the request on the session by calling HTTPAPIEX_ExecuteRequest and return its result. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_020: [ If HTTPAPIEX_ExecuteRequest succeeds and the pool has less than HTTP_SESSION_POOL_MAX_IDLE_SESSIONS idle sessions, IoTHubServiceClientHttpSession_ExecuteRequest shall return the session to the pool; otherwise it shall destroy the session by calling HTTPAPIEX_Destroy. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_destroys_the_session_if_HTTPAPIEX_ExecuteRequest_fails)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME);
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(HTTPHeaders_ReplaceHeaderNameValuePair(TEST_HTTP_HEADERS_HANDLE, TEST_HTTP_HEADER_KEY_AUTHORIZATION, TEST_SAS_TOKEN));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(TEST_HOSTNAME));
+    STRICT_EXPECTED_CALL(HTTPAPIEX_ExecuteRequest(IGNORED_PTR_ARG, HTTPAPI_REQUEST_GET, TEST_RELATIVE_PATH, TEST_HTTP_HEADERS_HANDLE, TEST_REQUEST_BUFFER_HANDLE, IGNORED_PTR_ARG, NULL, TEST_RESPONSE_BUFFER_HANDLE))
+        .IgnoreArgument(1)
+        .IgnoreArgument(6)
+        .SetReturn(HTTPAPIEX_ERROR);
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(Unlock(TEST_LOCK_HANDLE));
+    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+    ///assert
+    ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_016: [ If getting the time, creating the SAS token or setting the header fails IoTHubServiceClientHttpSession_ExecuteRequest shall unlock the pool and return HTTPAPIEX_ERROR. ]*/
+/*Tests_SRS_IOTHUBSERVICECLIENTHTTPSESSION_41_018: [ If the pool has no idle session IoTHubServiceClientHttpSession_ExecuteRequest shall open a new one by calling HTTPAPIEX_Create with the host name, and return HTTPAPIEX_ERROR if it fails. ]*/
+TEST_FUNCTION(IoTHubServiceClientHttpSession_ExecuteRequest_non_happy_path)
+{
+    ///arrange
+    unsigned int statusCode = 0;
+    IOTHUB_SERVICE_CLIENT_HTTP_SESSION_POOL_HANDLE sessionPool = create_test_pool();
+
+    int umockc_result = umock_c_negative_tests_init();
+    ASSERT_ARE_EQUAL(int, 0, umockc_result);
+
+    STRICT_EXPECTED_CALL(Lock(TEST_LOCK_HANDLE));
+    set_expected_calls_for_new_sas_token(TEST_TIME);
+    set_expected_calls_for_request(true, &httpStatusCodeOk);
+
+    umock_c_negative_tests_snapshot();
+
+    ///act
+    for (size_t i = 0; i < umock_c_negative_tests_call_count(); i++)
+    {
+        /// arrange
+        umock_c_negative_tests_reset();
+        umock_c_negative_tests_fail_call(i);
+
+        /// act
+        if (
+            (i != 2) && /*get_difftime*/
+            (i != 4) && /*STRING_delete*/
+            (i != 5) && /*STRING_c_str*/
+            (i != 7) && /*Unlock*/
+            (i != 10) && /*Lock*/
+            (i != 11)    /*Unlock*/
+            )
+        {
+            HTTPAPIEX_RESULT result = execute_test_request(sessionPool, &statusCode);
+
+            /// assert
+            ASSERT_ARE_EQUAL(HTTPAPIEX_RESULT, HTTPAPIEX_ERROR, result);
+        }
+    }
+
+    ///cleanup
+    umock_c_negative_tests_deinit();
+    IoTHubServiceClientHttpSession_DestroyPool(sessionPool);
+}
+
+END_TEST_SUITE(iothub_srv_client_http_session_ut)
@@ -27,6 +27,7 @@
 
 #include "jsonencoder.h"
 #include "multitree.h"
+#include "iothub_client_base64.h"
 
 #include "azure_c_shared_utility/xlogging.h"
 
@@ -83,54 +84,6 @@ static void NoFreeFunction(void* value)
 
 
 #define IS_DIGIT(a) (('0'<=(a)) &&((a)<='9'))
-#define splitInt(intVal, bytePos)   (char)((intVal >> (bytePos << 3)) & 0xFF)
-#define joinChars(a, b, c, d) (uint32_t)( (uint32_t)a + ((uint32_t)b << 8) + ((uint32_t)c << 16) + ((uint32_t)d << 24))
-
-static char base64char(unsigned char val)
-{
-    char result;
-
-    if (val < 26)
-    {
-        result = 'A' + (char)val;
-    }
-    else if (val < 52)
-    {
-        result = 'a' + ((char)val - 26);
-    }
-    else if (val < 62)
-    {
-        result = '0' + ((char)val - 52);
-    }
-    else if (val == 62)
-    {
-        result = '-';
-    }
-    else
-    {
-        result = '_';
-    }
-
-    return result;
-}
-
-static char base64b16(unsigned char val)
-{
-    const uint32_t base64b16values[4] = {
-        joinChars('A', 'E', 'I', 'M'),
-        joinChars('Q', 'U', 'Y', 'c'),
-        joinChars('g', 'k', 'o', 's'),
-        joinChars('w', '0', '4', '8')
-    };
-    return splitInt(base64b16values[val >> 2], (val & 0x03));
-}
-
-static char base64b8(unsigned char val)
-{
-    const uint32_t base64b8values = joinChars('A', 'Q', 'g', 'w');
-    return splitInt(base64b8values, val);
-};
-
 /*creates an AGENT_DATA_TYPE containing a EDM_BOOLEAN from a int*/
 AGENT_DATA_TYPES_RESULT Create_EDM_BOOLEAN_from_int(AGENT_DATA_TYPE* agentData, int v)
 {
@@ -509,167 +462,6 @@ static int ValidateDecimal(const char* v, size_t vlen)
     return result;
 }
 
-/*return 0 if everything went ok*/
-/*takes 1 base64char and returns its value*/
-static int base64toValue(char base64charSource, unsigned char* value)
-{
-    int result;
-    if (('A' <= base64charSource) && (base64charSource <= 'Z'))
-    {
-        *value = base64charSource - 'A';
-        result = 0;
-    }
-    else if (('a' <= base64charSource) && (base64charSource <= 'z'))
-    {
-        *value = ('Z' - 'A') +1+ (base64charSource - 'a');
-        result = 0;
-    }
-    else if (('0' <= base64charSource) && (base64charSource <= '9'))
-    {
-        *value = ('Z' - 'A') +1+('z'-'a')+1 +(base64charSource - '0');
-        result = 0;
-    }
-    else if ('-' == base64charSource)
-    {
-        *value = 62;
-        result = 0;
-    }
-    else if ('_' == base64charSource)
-    {
-        *value = 63;
-        result = 0;
-    }
-    else
-    {
-        result = 1;
-    }
-    return result;
-}
-
-/*returns 0 if everything went ok*/
-/*scans 4 base64 characters and returns 3 usual bytes*/
-static int scan4base64char(const char* source, size_t sourceSize, unsigned char *destination0, unsigned char* destination1, unsigned char* destination2)
-{
-    int result;
-    if (sourceSize < 4)
-    {
-        result = 1;
-    }
-    else
-    {
-        unsigned char b0, b1, b2, b3;
-        if (
-            (base64toValue(source[0], &b0) == 0) &&
-            (base64toValue(source[1], &b1) == 0) &&
-            (base64toValue(source[2], &b2) == 0) &&
-            (base64toValue(source[3], &b3) == 0)
-            )
-        {
-            *destination0 = (b0 << 2) | ((b1 & 0x30) >> 4);
-            *destination1 = ((b1 & 0x0F)<<4) | ((b2 & 0x3C) >>2 );
-            *destination2 = ((b2 & 0x03) << 6) | (b3);
-            result = 0;
-        }
-        else
-        {
-            result = 2;
-        }
-    }
-    return result;
-}
-
-/*return 0 if the character is one of ( 'A' / 'E' / 'I' / 'M' / 'Q' / 'U' / 'Y' / 'c' / 'g' / 'k' / 'o' / 's' / 'w' / '0' / '4' / '8' )*/
-static int base64b16toValue(unsigned char source, unsigned char* destination)
-{
-    unsigned char i;
-    for (i = 0; i <= 15; i++)
-    {
-        if (base64b16(i) == source)
-        {
-            *destination = i;
-            return 0;
-        }
-    }
-    return 1;
-}
-
-/*return 0 if the character is one of ( 'A' / 'Q' / 'g' / 'w' )*/
-static int base64b8toValue(unsigned char source, unsigned char* destination)
-{
-    unsigned char i;
-    for (i = 0; i <= 3; i++)
-    {
-        if (base64b8(i) == source)
-        {
-            *destination = i;
-            return 0;
-        }
-    }
-    return 1;
-}
-
-
-/*returns 0 if everything went ok*/
-/*scans 2 base64 characters + 1 special + 1 optional = and returns 2 usual bytes*/
-int scanbase64b16(const char* source, size_t sourceSize, size_t *consumed, unsigned char* destination0, unsigned char* destination1)
-{
-    int result;
-    if (sourceSize < 3)
-    {
-        result = 1;
-    }
-    else
-    {
-        unsigned char c0, c1, c2;
-        *consumed = 0;
-        if (
-            (base64toValue(source[0], &c0) == 0) &&
-            (base64toValue(source[1], &c1) == 0) &&
-            (base64b16toValue(source[2], &c2) == 0)
-            )
-        {
-            *consumed = 3 + ((sourceSize>=3)&&(source[3] == '=')); /*== produce 1 or 0 ( in C )*/
-            *destination0 = (c0 << 2) | ((c1 & 0x30) >> 4);
-            *destination1 = ((c1 &0x0F) <<4) | c2;
-            result = 0;
-        }
-        else
-        {
-            result = 2;
-        }
-    }
-    return result;
-}
-
-/*return 0 if everything is ok*/
-/*Reads base64b8    = base64char ( 'A' / 'Q' / 'g' / 'w' ) [ "==" ]*/
-int scanbase64b8(const char* source, size_t sourceSize, size_t *consumed, unsigned char* destination0)
-{
-    int result;
-    if (sourceSize < 2)
-    {
-        result = 1;
-    }
-    else
-    {
-        unsigned char c0, c1;
-        if (
-            (base64toValue(source[0], &c0) == 0) &&
-            (base64b8toValue(source[1], &c1) == 0)
-            )
-        {
-            *consumed = 2 + (((sourceSize>=4) && (source[2] == '=') && (source[3] == '='))?2:0); /*== produce 1 or 0 ( in C )*/
-            *destination0 = (c0 << 2) | (c1 & 3);
-            result = 0;
-        }
-        else
-        {
-            result = 2;
-        }
-    }
-    return result;
-}
-
 /*Codes_SRS_AGENT_TYPE_SYSTEM_99_039:[ Creates an AGENT_DATA_TYPE containing an EDM_DECIMAL from a null-terminated string.]*/
 AGENT_DATA_TYPES_RESULT Create_EDM_DECIMAL_from_charz(AGENT_DATA_TYPE* agentData, const char* v)
 {
@@ -2217,80 +2009,32 @@ AGENT_DATA_TYPES_RESULT AgentDataTypes_ToString(STRING_HANDLE destination, const
             }
             case EDM_BINARY_TYPE:
             {
-                size_t currentPosition = 0;
                 char* temp;
                 /*binary types */
                 /*Codes_SRS_AGENT_TYPE_SYSTEM_99_099:[EDM_BINARY:= *(4base64char)[base64b16 / base64b8]]*/
-                /*the following will happen*/
-                /*1. the "data" of the binary shall be "eaten" 3 characters at a time and produce 4 base64 encoded characters for as long as there are more than 3 characters still to process*/
-                /*2. the remaining characters (1 or 2) shall be encoded.*/
-                /*there's a level of assumption that 'a' corresponds to 0b000000 and that '_' corresponds to 0b111111*/
+                /*the data is encoded with the URL and filename safe base64 alphabet ('-' and '_' for 62 and 63)*/
                 /*the encoding will use the optional [=] or [==] at the end of the encoded string, so that other less standard aware libraries can do their work*/
-                /*these are the bits of the 3 normal bytes to be encoded*/
+                size_t encodedSize = IoTHubClient_Base64_GetEncodedLength(value->value.edmBinary.size);
                 size_t neededSize = 2; /*2 because starting and ending quotes */
-                neededSize += (value->value.edmBinary.size == 0) ? (0) : ((((value->value.edmBinary.size-1) / 3) + 1) * 4);
+                neededSize += encodedSize;
                 neededSize += 1; /*+1 because \0 at the end of the string*/
                 if ((temp = (char*)malloc(neededSize))==NULL)
                 {
                     result = AGENT_DATA_TYPES_ERROR;
                 }
+                else if (IoTHubClient_Base64_Encode(temp + 1, value->value.edmBinary.data, value->value.edmBinary.size, BASE64_ALPHABET_URL) != 0)
+                {
+                    free(temp);
+                    result = AGENT_DATA_TYPES_ERROR;
+                    LogError("(result = %s)", ENUM_TO_STRING(AGENT_DATA_TYPES_RESULT, result));
+                }
                 else
                 {
-                    /*b0            b1(+1)          b2(+2)
-                      7 6 5 4 3 2 1 0 7 6 5 4 3 2 1 0 7 6 5 4 3 2 1 0
-                      |----c1---| |----c2---| |----c3---| |----c4---|
-                    */
-
-                    size_t destinationPointer = 0;
-                    temp[destinationPointer++] = '"';
-                    while (value->value.edmBinary.size - currentPosition >= 3)
-                    {
-                        char c1 = base64char(value->value.edmBinary.data[currentPosition] >> 2);
-                        char c2 = base64char(
-                            ((value->value.edmBinary.data[currentPosition] & 3) << 4) |
-                                (value->value.edmBinary.data[currentPosition + 1] >> 4)
-                        );
-                        char c3 = base64char(
-                            ((value->value.edmBinary.data[currentPosition + 1] & 0x0F) << 2) |
-                                ((value->value.edmBinary.data[currentPosition + 2] >> 6) & 3)
-                        );
-                        char c4 = base64char(
-                            value->value.edmBinary.data[currentPosition + 2] & 0x3F
-                        );
-                        currentPosition += 3;
-                        temp[destinationPointer++] = c1;
-                        temp[destinationPointer++] = c2;
-                        temp[destinationPointer++] = c3;
-                        temp[destinationPointer++] = c4;
-
-                    }
-                    if (value->value.edmBinary.size - currentPosition == 2)
-                    {
-                        char c1 = base64char(value->value.edmBinary.data[currentPosition] >> 2);
-                        char c2 = base64char(
-                            ((value->value.edmBinary.data[currentPosition] & 0x03) << 4) |
-                                (value->value.edmBinary.data[currentPosition + 1] >> 4)
-                        );
-                        char c3 = base64b16(value->value.edmBinary.data[currentPosition + 1] & 0x0F);
-                        temp[destinationPointer++] = c1;
-                        temp[destinationPointer++] = c2;
-                        temp[destinationPointer++] = c3;
-                        temp[destinationPointer++] = '=';
-                    }
-                    else if (value->value.edmBinary.size - currentPosition == 1)
-                    {
-                        char c1 = base64char(value->value.edmBinary.data[currentPosition] >> 2);
-                        char c2 = base64b8(value->value.edmBinary.data[currentPosition] & 0x03);
-                        temp[destinationPointer++] = c1;
-                        temp[destinationPointer++] = c2;
-                        temp[destinationPointer++] = '=';
-                        temp[destinationPointer++] = '=';
-                    }
-                    
-                    /*closing quote*/
-                    temp[destinationPointer++] = '"';
+                    /*opening and closing quotes*/
+                    temp[0] = '"';
+                    temp[encodedSize + 1] = '"';
                     /*null terminating the string*/
-                    temp[destinationPointer] = '\0';
+                    temp[encodedSize + 2] = '\0';
 
                     if (STRING_concat(destination, temp) != 0)
                     {
@@ -3867,31 +3611,26 @@ result = AGENT_DATA_TYPES_OK;
             case EDM_BINARY_TYPE:
             {
                 size_t sourceLength = strlen(source);
-                if (sourceLength < 2)
+                if ((sourceLength < 2) || (source[0] != '"') || (source[sourceLength - 1] != '"')) /*if it doesn't start and end with a quote then... */
                 {
                     result = AGENT_DATA_TYPES_INVALID_ARG;
                 }
-                else if (sourceLength == 2)
-                {
-                    agentData->type = EDM_BINARY_TYPE;
-                    agentData->value.edmBinary.data = NULL;
-                    agentData->value.edmBinary.size = 0;
-                    result = AGENT_DATA_TYPES_OK;
-                }
                 else
                 {
-                    size_t sourcePosition = 0;
-                    if (source[sourcePosition++] != '"') /*if it doesn't start with a quote then... */
+                    if (sourceLength == 2)
                     {
-                        result = AGENT_DATA_TYPES_INVALID_ARG;
+                        /*Codes_SRS_AGENT_TYPE_SYSTEM_41_001: [ When there are no characters between the quotes, CreateAgentDataType_From_String shall produce an EDM_BINARY with size 0 and data NULL without allocating any memory. ]*/
+                        agentData->type = EDM_BINARY_TYPE;
+                        agentData->value.edmBinary.data = NULL;
+                        agentData->value.edmBinary.size = 0;
+                        result = AGENT_DATA_TYPES_OK;
                     }
                     else
                     {
-                        /*1. read groups of 4 base64 character and transfer those into groups of 3 "normal" characters.
-                        2. read the end of the string and produce from that the ending characters*/
+                        /*the characters between the quotes are decoded with the URL and filename safe base64 alphabet, the ending [=] or [==] being optional*/
 
                         /*compute the amount of memory to allocate*/
-                        agentData->value.edmBinary.size = (((sourceLength - 2) + 4) / 4) * 3; /*this is overallocation, shall be trimmed later*/
+                        agentData->value.edmBinary.size = IoTHubClient_Base64_GetDecodedMaxLength(sourceLength - 2); /*this is overallocation, shall be trimmed later*/
                         agentData->value.edmBinary.data = (unsigned char*)malloc(agentData->value.edmBinary.size); /*this is overallocation, shall be trimmed later*/
                         if (agentData->value.edmBinary.data == NULL)
                         {
@@ -3899,35 +3638,8 @@ result = AGENT_DATA_TYPES_OK;
                         }
                         else
                         {
-
-                            size_t destinationPosition = 0;
-                            size_t consumed;
-                            /*read and store "solid" groups of 4 base64 chars*/
-                            while (scan4base64char(source + sourcePosition, sourceLength - sourcePosition, agentData->value.edmBinary.data + destinationPosition, agentData->value.edmBinary.data + destinationPosition + 1, agentData->value.edmBinary.data + destinationPosition + 2) == 0)
-                            {
-                                sourcePosition += 4;
-                                destinationPosition += 3;
-                            }
-
-                            if (scanbase64b16(source + sourcePosition, sourceLength - sourcePosition, &consumed, agentData->value.edmBinary.data + destinationPosition, agentData->value.edmBinary.data + destinationPosition + 1) == 0)
-                            {
-                                sourcePosition += consumed;
-                                destinationPosition += 2;
-                                
-                            }
-                            else if (scanbase64b8(source + sourcePosition, sourceLength - sourcePosition, &consumed, agentData->value.edmBinary.data + destinationPosition) == 0)
-                            {
-                                sourcePosition += consumed;
-                                destinationPosition += 1;
-                            }
-
-                            if (source[sourcePosition++] != '"') /*if it doesn't end with " then bail out*/
-                            { 
-                                free(agentData->value.edmBinary.data);
-                                agentData->value.edmBinary.data = NULL;
-                                result = AGENT_DATA_TYPES_INVALID_ARG;
-                            }
-                            else if (sourcePosition != sourceLength)
+                            size_t destinationPosition;
+                            if (IoTHubClient_Base64_Decode(agentData->value.edmBinary.data, source + 1, sourceLength - 2, BASE64_ALPHABET_URL, &destinationPosition) != 0)
                             {
                                 free(agentData->value.edmBinary.data);
                                 agentData->value.edmBinary.data = NULL;
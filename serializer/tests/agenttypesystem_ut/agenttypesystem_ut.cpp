@@ -13325,6 +13325,38 @@ BEGIN_TEST_SUITE(AgentTypeSystem_ut)
             }
         }
 
+        /*Tests_SRS_AGENT_TYPE_SYSTEM_41_001: [ When there are no characters between the quotes, CreateAgentDataType_From_String shall produce an EDM_BINARY with size 0 and data NULL without allocating any memory. ]*/
+        TEST_FUNCTION(CreateAgentDataType_From_String_for_an_empty_EDM_BINARY_succeeds)
+        {
+            ///arrange
+            AGENT_DATA_TYPE ag;
+
+            ///act
+            auto result = CreateAgentDataType_From_String("\"\"", EDM_BINARY_TYPE, &ag);
+
+            ///assert
+            ASSERT_ARE_EQUAL(AGENT_DATA_TYPES_RESULT, AGENT_DATA_TYPES_OK, result);
+            ASSERT_ARE_EQUAL(AGENT_DATA_TYPE_TYPE, EDM_BINARY_TYPE, ag.type);
+            ASSERT_ARE_EQUAL(size_t, (size_t)0, ag.value.edmBinary.size);
+            ASSERT_IS_NULL(ag.value.edmBinary.data);
+
+            ///cleanup
+            Destroy_AGENT_DATA_TYPE(&ag);
+        }
+
+        /*Tests_SRS_AGENT_TYPE_SYSTEM_99_087:[ CreateAgentDataType_From_String shall return AGENT_DATA_TYPES_INVALID_ARG if source is not a valid string for a value of type type.]*/
+        TEST_FUNCTION(CreateAgentDataType_From_String_for_a_2_character_EDM_BINARY_without_quotes_fails)
+        {
+            ///arrange
+            AGENT_DATA_TYPE ag;
+
+            ///act
+            auto result = CreateAgentDataType_From_String("AA", EDM_BINARY_TYPE, &ag);
+
+            ///assert
+            ASSERT_ARE_EQUAL(AGENT_DATA_TYPES_RESULT, AGENT_DATA_TYPES_INVALID_ARG, result);
+        }
+
         /*validating base64 decode with invalid base64 encoded strings*/
         TEST_FUNCTION(CreateAgentDataType_From_String_for_a_EDM_BINARY_when_input_string_contains_1_garbage_character_inserted_fails)
         {